@@ -0,0 +1,9 @@
+% Micro benchmark: assert, call and retract dynamic facts.
+
+:- dynamic fact/2.
+
+top :-
+    forall(between(1, 2000, I), assertz(fact(I, I))),
+    forall(between(1, 2000, I), fact(I, _)),
+    forall(between(1, 1000, I), retract(fact(I, _))),
+    retractall(fact(_, _)).
@@ -0,0 +1,13 @@
+% Micro benchmark: atom creation and lookup.  New atoms are created
+% and become garbage, so this also exercises atom garbage collection.
+
+top :-
+    nb_getval(bench_atom_gen, G0),
+    G is G0+1,
+    nb_setval(bench_atom_gen, G),
+    forall(between(1, 2000, I),
+           ( atomic_list_concat([bench, G, I], '_', A),
+             atom_length(A, _)
+           )).
+
+:- nb_setval(bench_atom_gen, 0).
@@ -0,0 +1,8 @@
+% Micro benchmark: findall/3 and copying answers from the findall
+% buffer.
+
+top :-
+    findall(X-f(X), between(1, 5000, X), L),
+    length(L, 5000),
+    findall(X, member(X, L), L2),
+    length(L2, 5000).
@@ -0,0 +1,12 @@
+% Micro benchmark: create short lived data such that the garbage
+% collector must reclaim most of the global stack.
+
+top :-
+    garbage(200).
+
+garbage(0) :- !.
+garbage(N) :-
+    numlist(1, 500, L),
+    msort(L, _),
+    N1 is N-1,
+    garbage(N1).
@@ -0,0 +1,11 @@
+% Micro benchmark: just-in-time indexing.  The facts are added with a
+% new key to force the creation of a new index on the second argument,
+% which is then used for a series of lookups.
+
+:- dynamic edge/2.
+
+top :-
+    retractall(edge(_,_)),
+    forall(between(1, 1000, I),
+           ( J is I*7 mod 1000, assertz(edge(I, J)) )),
+    forall(between(1, 1000, J), (edge(_, J) -> true ; true)).
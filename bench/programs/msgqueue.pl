@@ -0,0 +1,8 @@
+% Micro benchmark: sending and receiving terms through a message
+% queue.  Requires multi-threading.
+
+top :-
+    message_queue_create(Q),
+    forall(between(1, 1000, I), thread_send_message(Q, msg(I, [I]))),
+    forall(between(1, 1000, I), thread_get_message(Q, msg(I, _))),
+    message_queue_destroy(Q).
@@ -0,0 +1,20 @@
+% Naive reverse of a 30 element list: the classic LIPS benchmark.
+
+top :-
+    range(1, 30, L),
+    nrev(L, _).
+
+nrev([], []).
+nrev([H|T], R) :-
+    nrev(T, RT),
+    app(RT, [H], R).
+
+app([], L, L).
+app([H|T], L, [H|R]) :-
+    app(T, L, R).
+
+range(N, N, [N]) :- !.
+range(M, N, [M|Ns]) :-
+    M < N,
+    M1 is M+1,
+    range(M1, N, Ns).
@@ -0,0 +1,36 @@
+% All solutions of the 8 queens problem by generate and test using
+% select/3 permutations with early pruning.
+
+top :-
+    findall(Qs, queens(8, Qs), L),
+    length(L, 92).
+
+queens(N, Qs) :-
+    numlist(1, N, Ns),
+    queens(Ns, [], Qs).
+
+queens([], Qs, Qs).
+queens(Unplaced, Safe, Qs) :-
+    sel(Q, Unplaced, Rest),
+    \+ attack(Q, Safe),
+    queens(Rest, [Q|Safe], Qs).
+
+attack(X, Xs) :-
+    attack(X, 1, Xs).
+
+attack(X, N, [Y|_]) :-
+    X =:= Y+N.
+attack(X, N, [Y|_]) :-
+    X =:= Y-N.
+attack(X, N, [_|Ys]) :-
+    N1 is N+1,
+    attack(X, N1, Ys).
+
+sel(X, [X|T], T).
+sel(X, [H|T], [H|R]) :-
+    sel(X, T, R).
+
+numlist(N, N, [N]) :- !.
+numlist(L, H, [L|T]) :-
+    L1 is L+1,
+    numlist(L1, H, T).
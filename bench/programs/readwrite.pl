@@ -0,0 +1,20 @@
+% Micro benchmark: writing terms using writeq/1 and reading them back
+% using read_term/3.
+
+top :-
+    numlist(1, 50, L),
+    T = t(L, "a string", 'Quoted atom', 3.14, f(_X, _Y, g(h))),
+    with_output_to(string(S),
+                   forall(between(1, 100, _),
+                          ( writeq(T), write('.\n') ))),
+    setup_call_cleanup(
+        open_string(S, In),
+        read_all(In),
+        close(In)).
+
+read_all(In) :-
+    read_term(In, T, []),
+    (   T == end_of_file
+    ->  true
+    ;   read_all(In)
+    ).
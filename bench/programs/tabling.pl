@@ -0,0 +1,18 @@
+% Micro benchmark: tabled left recursion over a chain of 100 nodes.
+
+:- table path/2.
+
+top :-
+    abolish_all_tables,
+    aggregate_all(count, path(_,_), Count),
+    Count =:= 100*101//2.
+
+path(X, Y) :-
+    path(X, Z),
+    edge(Z, Y).
+path(X, Y) :-
+    edge(X, Y).
+
+edge(X, Y) :-
+    between(0, 99, X),
+    Y is X+1.
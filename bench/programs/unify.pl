@@ -0,0 +1,23 @@
+% Micro benchmark: unification and ==/2 on large ground terms that are
+% equal but do not share structure.  The terms are about 10Mb each.
+
+:- initialization(setup).
+
+setup :-
+    term(A), nb_setval(unify_a, A),
+    term(B), nb_setval(unify_b, B).
+
+term(t(List, Wide)) :-
+    numlist(1, 100000, L),
+    maplist(elem, L, List),
+    length(Args, 1000000),
+    maplist(=(a), Args),
+    Wide =.. [w|Args].
+
+elem(I, f(I, a, g(I, "s"))).
+
+top :-
+    nb_getval(unify_a, A),
+    nb_getval(unify_b, B),
+    A = B,
+    A == B.
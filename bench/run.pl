@@ -0,0 +1,224 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(bench,
+          [ run/0,
+            run/1                       % +Options
+          ]).
+:- use_module(library(main)).
+:- use_module(library(lists)).
+:- use_module(library(option)).
+:- use_module(library(apply)).
+
+/** <module> SWI-Prolog benchmark suite
+
+This file runs the programs in the directory `programs`.  Each program
+is loaded into the module bench_<name> and defines top/0, which runs one
+iteration of the benchmark.  The suite contains classical Prolog
+benchmarks as well as micro benchmarks for specific subsystems.
+
+Running this file as a script runs all benchmarks:
+
+    swipl bench/run.pl [--speedup=F] [--format=text|csv|json]
+                       [--output=File] [Program ...]
+
+The `bench` target of the CMake build runs the suite on the freshly
+built system and writes bench-results.csv in the build directory.
+
+This file is also the default program for profile guided optimization
+(PGO_PROGRAM).
+*/
+
+%!  program(?Name, ?Iterations, ?Condition)
+%
+%   Benchmark programs.  Iterations is the number of times top/0 is
+%   called for a speedup of 1.  Iterations are chosen such that each
+%   program takes 0.1 to 0.2 seconds on a typical current machine.
+%   The program is skipped if Condition is not true.
+
+program(nrev,      6000, true).
+program(tak,         40, true).
+program(queens,      30, true).
+program(deriv,    30000, true).
+program(crypt,       50, true).
+program(assert,      60, true).
+program(jit,        150, true).
+program(findall,    150, true).
+program(unify,       10, true).
+program(atoms,       60, true).
+program(msgqueue,   300, current_prolog_flag(threads, true)).
+program(tabling,     50, true).
+program(readwrite,   60, true).
+program(gc,          30, true).
+
+%!  run is det.
+%!  run(+Options) is det.
+%
+%   Run the benchmark suite.  Options:
+%
+%     - speedup(+Factor)
+%       Divide the number of iterations by Factor.  Default is 1.
+%     - programs(+List)
+%       Only run the named programs.
+%     - format(+Format)
+%       One of `text` (default), `csv` or `json`.
+%     - output(+File)
+%       Write the results to File rather than current output.
+
+run :-
+    run([]).
+
+run(Options) :-
+    option(speedup(Speedup), Options, 1),
+    option(format(Format), Options, text),
+    must_be(oneof([text,csv,json]), Format),
+    (   option(programs(Names), Options)
+    ->  true
+    ;   findall(Name, program(Name, _, _), Names)
+    ),
+    maplist(load_program, Names),
+    findall(Result,
+            ( member(Name, Names),
+              run_program(Name, Speedup, Result)
+            ),
+            Results),
+    (   option(output(File), Options)
+    ->  setup_call_cleanup(
+            open(File, write, Out),
+            report(Format, Out, Results),
+            close(Out))
+    ;   report(Format, current_output, Results)
+    ).
+
+load_program(Name) :-
+    (   program(Name, _, _)
+    ->  true
+    ;   existence_error(benchmark, Name)
+    ),
+    module_property(bench, file(Me)),
+    file_directory_name(Me, Dir),
+    atomic_list_concat([Dir, programs, Name], /, File),
+    program_module(Name, M),
+    load_files(M:File, [silent(true), if(not_loaded)]).
+
+program_module(Name, Module) :-
+    atom_concat(bench_, Name, Module).
+
+%!  run_program(+Name, +Speedup, -Result) is semidet.
+%
+%   Run a single program.  Fails silently if the condition of the
+%   program is false.  Result is a dict holding the measurements.
+
+run_program(Name, Speedup, Result) :-
+    program(Name, Iterations0, Condition),
+    call(Condition),
+    Iterations is max(1, round(Iterations0/Speedup)),
+    program_module(Name, M),
+    (   catch(M:top, E, (print_message(error, E), fail))
+    ->  true
+    ;   print_message(error, format('Benchmark ~w failed', [Name])),
+        fail
+    ),
+    garbage_collect,
+    statistics(cputime, T0),
+    statistics(inferences, I0),
+    get_time(W0),
+    forall(between(1, Iterations, _), M:top),
+    get_time(W1),
+    statistics(inferences, I1),
+    statistics(cputime, T1),
+    Time is T1-T0,
+    Wall is W1-W0,
+    Inferences is I1-I0,
+    Result = bench{program:Name, iterations:Iterations,
+                   time:Time, wall:Wall, inferences:Inferences}.
+
+
+                 /*******************************
+                 *           REPORTING          *
+                 *******************************/
+
+report(text, Out, Results) :-
+    format(Out, '~w~t~12|~t~w~24|~t~w~34|~t~w~44|~t~w~58|~n',
+           [program, iterations, time, wall, inferences]),
+    format(Out, '~`-t~58|~n', []),
+    forall(member(R, Results),
+           format(Out, '~w~t~12|~t~D~24|~t~3f~34|~t~3f~44|~t~D~58|~n',
+                  [ R.program, R.iterations, R.time, R.wall,
+                    R.inferences ])),
+    format(Out, '~`-t~58|~n', []),
+    foldl(sum_time, Results, 0, Total),
+    format(Out, '~w~t~24|~t~3f~34|~n', [total, Total]).
+report(csv, Out, Results) :-
+    format(Out, 'program,iterations,time,wall,inferences~n', []),
+    forall(member(R, Results),
+           format(Out, '~w,~d,~6f,~6f,~d~n',
+                  [ R.program, R.iterations, R.time, R.wall,
+                    R.inferences ])).
+report(json, Out, Results) :-
+    current_prolog_flag(version, Version),
+    format(Out, '{ "version": ~d,~n  "results": [~n', [Version]),
+    report_json(Results, Out),
+    format(Out, '  ]~n}~n', []).
+
+report_json([], _).
+report_json([R|T], Out) :-
+    (   T == []
+    ->  Sep = ''
+    ;   Sep = ','
+    ),
+    format(Out,
+           '    { "program": "~w", "iterations": ~d, \c
+                  "time": ~6f, "wall": ~6f, "inferences": ~d }~w~n',
+           [ R.program, R.iterations, R.time, R.wall, R.inferences,
+             Sep ]),
+    report_json(T, Out).
+
+sum_time(R, T0, T) :-
+    T is T0+R.time.
+
+
+                 /*******************************
+                 *            MAIN              *
+                 *******************************/
+
+:- initialization(main, main).
+
+main(Argv) :-
+    argv_options(Argv, Programs, Options0),
+    (   Programs == []
+    ->  Options = Options0
+    ;   Options = [programs(Programs)|Options0]
+    ),
+    run(Options).
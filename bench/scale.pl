@@ -0,0 +1,306 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(bench_scale,
+          [ scale/0,
+            scale/1                     % +Options
+          ]).
+:- use_module(library(main)).
+:- use_module(library(lists)).
+:- use_module(library(option)).
+:- use_module(library(apply)).
+
+/** <module> Multi-threaded scalability benchmarks
+
+This file runs operations that access shared resources of the system
+at an increasing number of threads.  The total amount of work is fixed
+and divided over the threads, so a system that scales perfectly shows
+a throughput that grows linearly with the number of threads up to the
+number of cores.  A throughput that stays flat or drops reveals
+contention.
+
+    swipl bench/scale.pl [--threads=N] [--ops=Count]
+                         [--format=text|csv] [--output=File]
+                         [Operation ...]
+
+The operations are:
+
+  - atom
+    Create atoms from text, exercising the atom table (lookupBlob()).
+  - functor
+    Create compound terms with new names, exercising the functor table.
+  - assert
+    Add and remove clauses of a single shared dynamic predicate,
+    exercising the clause list and clause garbage collection.
+  - queue
+    Send and receive messages through a single shared message queue.
+  - table
+    Evaluate goals of a shared tabled predicate.
+  - mutex
+    Run a goal using with_mutex/2 on a single mutex.
+*/
+
+%!  operation(?Name, ?Ops)
+%
+%   Operations and the default total number of times they are executed.
+
+operation(atom,    400000).
+operation(functor, 200000).
+operation(assert,  200000).
+operation(queue,   400000).
+operation(table,    20000).
+operation(mutex,   400000).
+
+%!  scale is det.
+%!  scale(+Options) is det.
+%
+%   Run the scalability benchmarks.  Options:
+%
+%     - threads(+Max)
+%       Run with 1, 2, 4, ... upto Max threads.  Default is the number
+%       of CPUs (flag `cpu_count`), with a minimum of 4.
+%     - ops(+Count)
+%       Total number of operations per run, overruling the default of
+%       each operation.
+%     - operations(+List)
+%       Only run the listed operations.
+%     - format(+Format)
+%       One of `text` (default) or `csv`.
+%     - output(+File)
+%       Write the results to File rather than current output.
+
+scale :-
+    scale([]).
+
+scale(Options) :-
+    (   current_prolog_flag(threads, true)
+    ->  true
+    ;   throw(error(feature_error(threads), _))
+    ),
+    current_prolog_flag(cpu_count, CPUs),
+    DefMax is max(4, CPUs),
+    option(threads(Max), Options, DefMax),
+    option(format(Format), Options, text),
+    must_be(oneof([text,csv]), Format),
+    (   option(operations(Names), Options)
+    ->  maplist(must_be_operation, Names)
+    ;   findall(Name, operation(Name, _), Names)
+    ),
+    thread_counts(1, Max, Counts),
+    findall(Result,
+            ( member(Name, Names),
+              (   option(ops(Ops), Options)
+              ->  true
+              ;   operation(Name, Ops)
+              ),
+              member(N, Counts),
+              run_operation(Name, N, Ops, Result)
+            ),
+            Results),
+    (   option(output(File), Options)
+    ->  setup_call_cleanup(
+            open(File, write, Out),
+            report(Format, Out, Results),
+            close(Out))
+    ;   report(Format, current_output, Results)
+    ).
+
+must_be_operation(Name) :-
+    (   operation(Name, _)
+    ->  true
+    ;   existence_error(operation, Name)
+    ).
+
+thread_counts(N, Max, [N|T]) :-
+    N < Max,
+    !,
+    N2 is N*2,
+    thread_counts(N2, Max, T).
+thread_counts(_, Max, [Max]).
+
+%!  run_operation(+Name, +Threads, +Ops, -Result) is det.
+%
+%   Run Ops operations of type Name divided over Threads threads.  The
+%   threads are created and set up before the clock is started and all
+%   threads start working at the same time.
+
+run_operation(Name, Threads, Ops, Result) :-
+    PerThread is max(1, Ops // Threads),
+    setup(Name),
+    message_queue_create(Ready),
+    message_queue_create(Go),
+    numlist(1, Threads, Ids),
+    maplist(create_worker(Name, PerThread, Ready, Go), Ids, Workers),
+    forall(member(_, Workers), thread_get_message(Ready, ready)),
+    get_time(T0),
+    forall(member(_, Workers), thread_send_message(Go, go)),
+    maplist(thread_join, Workers, Statuses),
+    get_time(T1),
+    message_queue_destroy(Ready),
+    message_queue_destroy(Go),
+    cleanup(Name),
+    (   exclude(==(true), Statuses, [])
+    ->  true
+    ;   print_message(error, format('~w: worker failed: ~p',
+                                    [Name, Statuses]))
+    ),
+    Wall is T1-T0,
+    Total is PerThread*Threads,
+    (   Wall > 0
+    ->  Throughput is Total/Wall
+    ;   Throughput = 0
+    ),
+    Result = scale(Name, Threads, Total, Wall, Throughput).
+
+create_worker(Name, Count, Ready, Go, Id, Worker) :-
+    thread_create(worker(Name, Id, Count, Ready, Go), Worker, []).
+
+worker(Name, Id, Count, Ready, Go) :-
+    thread_send_message(Ready, ready),
+    thread_get_message(Go, go),
+    work(Name, Id, Count).
+
+
+                 /*******************************
+                 *          OPERATIONS          *
+                 *******************************/
+
+:- dynamic
+    shared_fact/2.
+
+:- table
+    shared_path/2 as shared.
+
+setup(queue) :-
+    !,
+    message_queue_create(_, [alias(bench_scale_queue)]).
+setup(table) :-
+    !,
+    abolish_all_tables.
+setup(_).
+
+cleanup(queue) :-
+    !,
+    message_queue_destroy(bench_scale_queue).
+cleanup(assert) :-
+    !,
+    retractall(shared_fact(_,_)),
+    garbage_collect_clauses.
+cleanup(table) :-
+    !,
+    abolish_all_tables.
+cleanup(_).
+
+work(atom, Id, Count) :-
+    forall(between(1, Count, I),
+           ( format(atom(A), 'scale_~d_~d', [Id, I]),
+             atom_length(A, _)
+           )).
+work(functor, Id, Count) :-
+    forall(between(1, Count, I),
+           ( format(atom(Name), 'f~d_~d', [Id, I mod 1000]),
+             functor(_, Name, 3)
+           )).
+work(assert, Id, Count) :-
+    forall(between(1, Count, I),
+           ( assertz(shared_fact(Id, I)),
+             retract(shared_fact(Id, I))
+           )).
+work(queue, Id, Count) :-
+    forall(between(1, Count, I),
+           ( thread_send_message(bench_scale_queue, msg(Id, I)),
+             thread_get_message(bench_scale_queue, msg(_, _))
+           )).
+work(table, Id, Count) :-
+    forall(between(1, Count, I),
+           ( From is (Id*7919+I) mod 200,
+             forall(shared_path(From, _), true)
+           )).
+work(mutex, _Id, Count) :-
+    forall(between(1, Count, I),
+           with_mutex(bench_scale_mutex, succ(I, _))).
+
+shared_path(X, Y) :-
+    shared_edge(X, Y).
+shared_path(X, Y) :-
+    shared_path(X, Z),
+    shared_edge(Z, Y).
+
+shared_edge(X, Y) :-
+    X < 200,
+    Y is X+1.
+
+
+                 /*******************************
+                 *           REPORTING          *
+                 *******************************/
+
+report(text, Out, Results) :-
+    format(Out, '~w~t~10|~t~w~19|~t~w~31|~t~w~41|~t~w~55|~t~w~64|~n',
+           [operation, threads, ops, wall, 'ops/sec', speedup]),
+    format(Out, '~`-t~64|~n', []),
+    forall(member(scale(Name, Threads, Ops, Wall, Throughput), Results),
+           ( base_throughput(Results, Name, Base),
+             Speedup is Throughput/Base,
+             format(Out, '~w~t~10|~t~D~19|~t~D~31|~t~3f~41|~t~D~55|~t~2f~64|~n',
+                    [ Name, Threads, Ops, Wall, round(Throughput),
+                      Speedup ])
+           )).
+report(csv, Out, Results) :-
+    format(Out, 'operation,threads,ops,wall,throughput~n', []),
+    forall(member(scale(Name, Threads, Ops, Wall, Throughput), Results),
+           format(Out, '~w,~d,~d,~6f,~1f~n',
+                  [Name, Threads, Ops, Wall, Throughput])).
+
+base_throughput(Results, Name, Base) :-
+    memberchk(scale(Name, 1, _, _, Base0), Results),
+    Base0 > 0,
+    !,
+    Base = Base0.
+base_throughput(_, _, 1).
+
+
+                 /*******************************
+                 *            MAIN              *
+                 *******************************/
+
+:- initialization(main, main).
+
+main(Argv) :-
+    argv_options(Argv, Operations, Options0),
+    (   Operations == []
+    ->  Options = Options0
+    ;   Options = [operations(Operations)|Options0]
+    ),
+    scale(Options).
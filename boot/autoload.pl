@@ -264,6 +264,21 @@ read_index([H|T], M) :-
     !,
     read_index(H, M),
     read_index(T, M).
+read_index(Index, M) :-
+    file_directory_name(Index, Dir),
+    fast_index_file(Index, FastIndex),
+    time_file(Index, IndexTime),
+    time_file(FastIndex, FastTime),
+    FastTime >= IndexTime,
+    catch(setup_call_cleanup(
+              open(FastIndex, read, In, [type(binary)]),
+              fast_read(In, Terms),
+              close(In)),
+          _, fail),
+    is_list(Terms),
+    !,
+    print_message(silent, autoload(read_index(Dir))),
+    assert_index_list(Terms, Dir, M).
 read_index(Index, M) :-
     print_message(silent, autoload(read_index(Dir))),
     file_directory_name(Index, Dir),
@@ -292,6 +307,25 @@ assert_index(Term, Dir, _) :-
     print_message(error, illegal_autoload_index(Dir, Term)),
     fail.
 
+assert_index_list([], _, _).
+assert_index_list([H|T], Dir, M) :-
+    (   assert_index(H, Dir, M)
+    ->  true
+    ;   true
+    ),
+    assert_index_list(T, Dir, M).
+
+%!  fast_index_file(+Index, -FastIndex) is det.
+%
+%   FastIndex is the name of the binary  version of the index file
+%   Index. This file holds the index/4   terms of Index as a list in
+%   the fast_write/2 format. It is  created by make_library_index/1
+%   and used if it is not older than Index.
+
+fast_index_file(Index, FastIndex) :-
+    file_name_extension(Base, _, Index),
+    file_name_extension(Base, fast, FastIndex).
+
 
                 /********************************
                 *       CREATE INDEX.pl         *
@@ -355,6 +389,8 @@ make_library_index2(Dir, Patterns) :-
     (   library_index_out_of_date(AbsIndex, Files)
     ->  do_make_library_index(AbsIndex, DirS, Files),
         flag('$modified_index', _, true)
+    ;   fast_index_out_of_date(AbsIndex)
+    ->  make_fast_index(AbsIndex)
     ;   true
     ).
 
@@ -393,6 +429,15 @@ library_index_out_of_date(Index, Files) :-
     ),
     !.
 
+fast_index_out_of_date(Index) :-
+    fast_index_file(Index, FastIndex),
+    (   \+ exists_file(FastIndex)
+    ->  true
+    ;   time_file(Index, IndexTime),
+        time_file(FastIndex, FastTime),
+        FastTime < IndexTime
+    ).
+
 
 do_make_library_index(Index, Dir, Files) :-
     ensure_slash(Dir, DirS),
@@ -404,7 +449,38 @@ do_make_library_index(Index, Dir, Files) :-
           index_files(Files, DirS, Out)
         ),
         Catcher,
-        install_index(Out, Catcher, StagedIndex, Index)).
+        install_index(Out, Catcher, StagedIndex, Index)),
+    make_fast_index(Index).
+
+%!  make_fast_index(+Index) is det.
+%
+%   Create the binary version of Index.  Failure to create it is not
+%   an error as read_index/2 falls back to the Prolog index file.
+
+make_fast_index(Index) :-
+    fast_index_file(Index, FastIndex),
+    catch(( setup_call_cleanup(
+                open(Index, read, In),
+                read_index_terms(In, Terms),
+                close(In)),
+            '$stage_file'(FastIndex, StagedFast),
+            setup_call_catcher_cleanup(
+                open(StagedFast, write, Out, [type(binary)]),
+                fast_write(Out, Terms),
+                Catcher,
+                install_index(Out, Catcher, StagedFast, FastIndex))
+          ), E,
+          print_message(silent, E)),
+    !.
+make_fast_index(_).
+
+read_index_terms(In, Terms) :-
+    read(In, Term),
+    (   Term == end_of_file
+    ->  Terms = []
+    ;   Terms = [Term|Rest],
+        read_index_terms(In, Rest)
+    ).
 
 install_index(Out, Catcher, StagedIndex, Index) :-
     catch(close(Out), Error, true),
@@ -41,7 +41,8 @@ system:'$gc' :-
 %!  gc_loop
 %
 %   Wait for signals from other threads  to perform global GC operations
-%   and do them for them.
+%   and do them for them.  This thread also builds clause indexes that
+%   are requested in the background (see the flag `index_background`).
 %
 %   When using [tcmalloc](https://github.com/google/tcmalloc)   we  call
 %   MallocExtension_MarkThreadIdle() to transfer the   collected  memory
@@ -52,9 +53,9 @@ gc_loop :-
     thread_idle('$gc_wait'(Action), short),
     (   Action == abort
     ->  true
-    ;   process(Action)
-    ->  '$gc_clear'(Action),
-        fail
+    ;   '$gc_clear'(Action),            % requests during process/1 must
+        process(Action)                 % cause another run
+    ->  fail
     ;   print_message(warning, gc(ignored(Action))),
         fail
     ).
@@ -63,3 +64,5 @@ process(garbage_collect_atoms) :-
     garbage_collect_atoms.
 process(garbage_collect_clauses) :-
     garbage_collect_clauses.
+process(build_indexes) :-
+    '$build_indexes'.
@@ -700,8 +700,9 @@ initialization(Goal, When) :-
     ).
 
 '$run_init_goal'(Goal, Ctx) :-
-    (   catch_with_backtrace('$run_init_goal'(Goal), E,
-                             '$initialization_error'(E, Goal, Ctx))
+    (   '$startup_trace'(initialization, Goal,
+                         catch_with_backtrace('$run_init_goal'(Goal), E,
+                                              '$initialization_error'(E, Goal, Ctx)))
     ->  true
     ;   '$initialization_failure'(Goal, Ctx)
     ).
@@ -716,6 +717,21 @@ initialization(Goal, When) :-
     prolog:sandbox_allowed_goal(Goal),
     call(Goal).
 
+%!  '$startup_trace'(+Category, +Name, :Goal)
+%
+%   Call Goal. If Prolog was started  using --startup-trace=File, record
+%   the wall time used by Goal as an event of type Category with Name.
+%   Goal is called as once/1.
+
+'$startup_trace'(Category, Name, Goal) :-
+    '$startup_tracing',
+    !,
+    get_time(Start),
+    call_cleanup(once(Goal),
+                 '$startup_trace_event'(Category, Name, Start)).
+'$startup_trace'(_, _, Goal) :-
+    once(Goal).
+
 '$initialization_context'(Source, Ctx) :-
     (   source_location(File, Line)
     ->  Ctx = File:Line,
@@ -1753,6 +1769,7 @@ compiling :-
 '$read_clause_option'(syntax_errors(_)).
 '$read_clause_option'(term_position(_)).
 '$read_clause_option'(process_comment(_)).
+'$read_clause_option'(canonical(_)).
 
 '$expanded_term'(In, Raw, RawLayout, Read, RLayout, Term, TLayout,
                  Stream, Parents, Options) :-
@@ -2436,7 +2453,9 @@ load_files(Module:Files, Options) :-
     '$qlf_file'(File, FullFile, Absolute, Mode, Options),
     (   Mode == qcompile
     ->  qcompile(Module:File, Options)
-    ;   '$do_load_file_2'(File, Absolute, Module, Action, Options)
+    ;   '$startup_trace'(load, Absolute,
+                         '$do_load_file_2'(File, Absolute, Module,
+                                           Action, Options))
     ).
 
 '$do_load_file_2'(File, Absolute, Module, Action, Options) :-
@@ -3404,7 +3423,9 @@ load_files(Module:Files, Options) :-
     (   '$pattr_directive'(Goal, Module)
     ->  true
     ;   Term = error(_,_),
-        catch(Module:Goal, Term, '$exception_in_directive'(Term))
+        '$startup_trace'(directive, Module:Goal,
+                         catch(Module:Goal, Term,
+                               '$exception_in_directive'(Term)))
     ->  true
     ;   '$print_message'(warning, goal_failed(directive, Module:Goal)),
         fail
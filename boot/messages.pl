@@ -296,6 +296,8 @@ syntax_error(list_rest) -->
     [ 'Unexpected comma or bar in rest of list' ].
 syntax_error(cannot_start_term) -->
     [ 'Illegal start of term' ].
+syntax_error(canonical_syntax) -->
+    [ 'End of term expected (operators are not allowed in canonical syntax)' ].
 syntax_error(punct(Punct, End)) -->
     [ 'Unexpected `~w\' before `~w\''-[Punct, End] ].
 syntax_error(undefined_char_escape(C)) -->
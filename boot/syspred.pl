@@ -60,6 +60,7 @@
             predicate_property/2,
             '$predicate_property'/2,
             (dynamic)/2,                        % :Predicates, +Options
+            transaction/1,                      % :Goal
             clause_property/2,
             current_module/1,                   % ?Module
             module_property/2,                  % ?Module, ?Property
@@ -80,6 +81,7 @@
             tmp_file_stream/3,                  % +Enc, -File, -Stream
             call_with_depth_limit/3,            % :Goal, +Limit, -Result
             call_with_inference_limit/3,        % :Goal, +Limit, -Result
+            call_range/4,                       % :Goal, +Arg, +Low, +High
             numbervars/3,                       % +Term, +Start, -End
             term_string/3,                      % ?Term, ?String, +Options
             nb_setval/2,                        % +Var, +Value
@@ -92,6 +94,7 @@
 
 :- meta_predicate
     dynamic(:, +),
+    transaction(0),
     use_foreign_library(:),
     use_foreign_library(:, +).
 
@@ -678,6 +681,32 @@ call_with_inference_limit(G, Limit, Result) :-
     ;   system:'$inference_limit_false'(OLimit)
     ).
 
+%!  call_range(:Goal, +Arg, +Low, +High)
+%
+%   True when Goal is true and argument Arg   of Goal is in the range
+%   [Low,High] in the standard order  of   terms.  If  Arg is unbound,
+%   Low and High are numbers or  atoms   and  the predicate has only
+%   constants for Arg, the distinct values in range are enumerated from
+%   a sorted index and Goal is called  with   Arg  bound to each value.
+%   Otherwise, this falls back to calling Goal and filtering the
+%   results. The order of the solutions is undefined.
+
+:- meta_predicate
+    call_range(0, +, +, +).
+
+call_range(M:Goal, Arg, Low, High) :-
+    '$must_be'(callable, Goal),
+    '$must_be'(integer, Arg),
+    arg(Arg, Goal, V),
+    (   var(V),
+        '$range_keys'(M:Goal, Arg, Low, High, Keys)
+    ->  '$member'(V, Keys),
+        call(M:Goal)
+    ;   call(M:Goal),
+        Low @=< V,
+        V @=< High
+    ).
+
 
                 /********************************
                 *           DATA BASE           *
@@ -857,6 +886,8 @@ define_or_generate(Pred) :-
     '$get_predicate_attribute'(Pred, (volatile), 1).
 '$predicate_property'((thread_local), Pred) :-
     '$get_predicate_attribute'(Pred, (thread_local), 1).
+'$predicate_property'(concurrent, Pred) :-
+    '$get_predicate_attribute'(Pred, concurrent, 1).
 '$predicate_property'((multifile), Pred) :-
     '$get_predicate_attribute'(Pred, (multifile), 1).
 '$predicate_property'(imported_from(Module), Pred) :-
@@ -883,6 +914,12 @@ define_or_generate(Pred) :-
     '$get_predicate_attribute'(Pred, last_modified_generation, Gen).
 '$predicate_property'(indexed(Indices), Pred) :-
     '$get_predicate_attribute'(Pred, indexed, Indices).
+'$predicate_property'(index_statistics(Stats), Pred) :-
+    '$get_predicate_attribute'(Pred, index_statistics, Stats).
+'$predicate_property'(call_counting, Pred) :-
+    '$get_predicate_attribute'(Pred, call_counting, 1).
+'$predicate_property'(call_counts(Counts), Pred) :-
+    '$get_predicate_attribute'(Pred, call_counts, Counts).
 '$predicate_property'(noprofile, Pred) :-
     '$get_predicate_attribute'(Pred, noprofile, 1).
 '$predicate_property'(iso, Pred) :-
@@ -902,6 +939,10 @@ define_or_generate(Pred) :-
     '$get_predicate_attribute'(Pred, abstract, N).
 '$predicate_property'(size(Bytes), Pred) :-
     '$get_predicate_attribute'(Pred, size, Bytes).
+'$predicate_property'(memory(Usage), Pred) :-
+    '$get_predicate_attribute'(Pred, memory, Usage).
+'$predicate_property'(columnar(Rows), Pred) :-
+    '$columnar_rows'(Pred, Rows).
 
 system_undefined(user:prolog_trace_interception/4).
 system_undefined(user:prolog_exception_hook/4).
@@ -1017,6 +1058,7 @@ clause_property(Clause, Property) :-
 %     - discontiguous(+Bool)
 %     - thread(+Mode)
 %     - volatile(+Bool)
+%     - concurrent(+Bool)
 
 dynamic(M:Predicates, Options) :-
     '$must_be'(list, Predicates),
@@ -1065,9 +1107,28 @@ opt_prop(abstract,      between(0,0),          0,     abstract).
 opt_prop(multifile,     boolean,               true,  multifile).
 opt_prop(discontiguous, boolean,               true,  discontiguous).
 opt_prop(volatile,      boolean,               true,  volatile).
+opt_prop(concurrent,    boolean,               true,  concurrent).
 opt_prop(thread,        oneof(atom, [local,shared],[local,shared]),
                                                local, thread_local).
 
+%!  transaction(:Goal) is semidet.
+%
+%   Run Goal as once/1 such that its updates to the clause database
+%   become visible to other threads at once if Goal succeeds and are
+%   discarded if Goal fails or raises an exception.
+
+transaction(Goal) :-
+    '$transaction_begin'(Mark),
+    (   catch(Goal, E, true)
+    ->  (   var(E)
+        ->  '$transaction_commit'(Mark)
+        ;   '$transaction_rollback'(Mark),
+            throw(E)
+        )
+    ;   '$transaction_rollback'(Mark),
+        fail
+    ).
+
                 /********************************
                 *            MODULES            *
                 *********************************/
@@ -1188,6 +1249,19 @@ current_trie(Trie) :-
 %     - gen_call_count(Count)
 %       Number of trie_gen/2 calls on this trie
 %
+%   Answer trie statistics:
+%
+%     - duplicate_count(Count)
+%       Number of answers that were derived again and rejected
+%       because they are already in the table
+%     - suspension_count(Count)
+%       Number of times a consumer suspended on an incomplete table
+%     - completion_count(Count)
+%       Number of times the table was completed
+%     - eval_time(Seconds)
+%       Wall time between creating the table and its completion,
+%       summed over all completions
+%
 %   Incremental tabling statistics:
 %
 %     - invalidated(Count)
@@ -1215,6 +1289,10 @@ trie_property(compiled_size(_)).
                                                 % below only when -DO_TRIE_STATS
 trie_property(lookup_count(_)).                 % is enabled in pl-trie.h
 trie_property(gen_call_count(_)).
+trie_property(duplicate_count(_)).              % Answer trie stats
+trie_property(suspension_count(_)).
+trie_property(completion_count(_)).
+trie_property(eval_time(_)).
 trie_property(invalidated(_)).                  % IDG stats
 trie_property(reevaluated(_)).
 trie_property(deadlock(_)).                     % Shared tabling stats
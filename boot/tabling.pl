@@ -45,6 +45,7 @@
             radial_restraint/0,
 
             current_table/2,            % :Variant, ?Table
+            tabled_stream/1,            % :Goal
             abolish_all_tables/0,
             abolish_private_tables/0,
             abolish_shared_tables/0,
@@ -65,6 +66,8 @@
             '$moded_wrap_tabled'/4,	% :Head, +ModeTest, +Variant, +Moded
             '$wfs_call'/2,              % :Goal, -Delays
 
+            incr_batch/1,               % :Goal
+
             '$wrap_incremental'/1,      % :Head
             '$unwrap_incremental'/1     % :Head
           ]).
@@ -79,7 +82,9 @@
     start_abstract_tabling(+, +, 0),
     start_moded_tabling(+, +, 0, +, ?),
     current_table(:, -),
+    tabled_stream(0),
     abolish_table_subgoals(:),
+    incr_batch(0),
     '$wfs_call'(0, :).
 
 /** <module> Tabled execution (SLG WAM)
@@ -396,12 +401,12 @@ start_subsumptive_tabling(Closure, Wrapper, Worker) :-
             trie_gen_compiled(Trie, Skeleton)
         ;   shift(call_info(Skeleton, Status))
         )
-    ;   more_general_table(Wrapper, ATrie),
-        '$tbl_table_status'(ATrie, complete, Wrapper, Skeleton)
-    ->  '$tbl_answer_update_dl'(ATrie, Skeleton) % see (*)
     ;   more_general_table(Wrapper, ATrie),
         '$tbl_table_status'(ATrie, Status, GenWrapper, GenSkeleton)
-    ->  (   Status == invalid
+    ->  (   Status == complete
+        ->  Wrapper = GenWrapper,
+            '$tbl_answer_update_dl'(ATrie, GenSkeleton) % see (*)
+        ;   Status == invalid
         ->  reeval(ATrie, GenWrapper, GenSkeleton),
             Wrapper = GenWrapper,
             '$tbl_answer_update_dl'(ATrie, GenSkeleton)
@@ -1099,6 +1104,38 @@ ct_generate(M:Variant) :-
     (   var(Variant)
     ->  true
     ;   var(M)
+    ).
+
+%!  tabled_stream(:Goal) is nondet.
+%
+%   As call/1 for a call to a shared tabled predicate, but if the table
+%   for Goal is being completed by another thread, return the answers
+%   that are already in the table without waiting for completion.  When
+%   the answers are exhausted, wait for the producer to add new answers
+%   or complete the table.  The predicate fails after all answers of the
+%   completed table are returned.  Each answer is returned once.
+%   Conditional (WFS) answers are only returned after completion.
+%
+%   If there is no such table, this simply calls Goal.  If the producer
+%   abandons the table, Goal is called to complete it, skipping answers
+%   that were already returned.
+
+tabled_stream(Goal) :-
+    (   '$tbl_stream_table'(Goal, Trie, Skeleton)
+    ->  trie_new(Seen),
+        tabled_stream(Trie, Seen, 0, Goal, Skeleton)
+    ;   call(Goal)
+    ).
+
+tabled_stream(Trie, Seen, Count0, Goal, Skeleton) :-
+    '$tbl_wait_answers'(Trie, Count0, Count, Status),
+    (   Status == incomplete
+    ->  (   '$tbl_answer'(Trie, Skeleton, true),
+            trie_insert(Seen, Skeleton)
+        ;   tabled_stream(Trie, Seen, Count, Goal, Skeleton)
+        )
+    ;   call(Goal),                     % complete or abandoned
+        \+ trie_lookup(Seen, Skeleton, _)
     ).
 
                  /*******************************
@@ -1504,6 +1541,13 @@ dyn_update(_Action, ClauseRef) :-
 dyn_update(Abstract, _, _) :-
     dyn_changed_pattern(Abstract).
 
+dyn_changed_pattern(Term) :-
+    nb_current('$tbl_incr_batch', batch(Changes, Preds)),
+    !,
+    (   trie_insert(Changes, Term)
+    ->  batch_add_pred(Term, Changes, Preds)
+    ;   true
+    ).
 dyn_changed_pattern(Term) :-
     forall(dyn_affected(Term, ATrie),
            '$idg_changed'(ATrie)).
@@ -1512,6 +1556,50 @@ dyn_affected(Term, ATrie) :-
     '$tbl_variant_table'(VTable),
     trie_gen(VTable, Term, ATrie).
 
+batch_add_pred(M:Head, Changes, Preds) :-
+    functor(Head, Name, Arity),
+    functor(Gen, Name, Arity),
+    (   memberchk(M:Gen, Preds)
+    ->  true
+    ;   nb_setval('$tbl_incr_batch', batch(Changes, [M:Gen|Preds]))
+    ).
+
+%!  incr_batch(:Goal)
+%
+%   Run Goal as once/1, deferring the   invalidation of incremental tables
+%   for  changes  to  incremental  dynamic  predicates  until  Goal  has
+%   completed. The changed clause heads are   collected in a trie, which
+%   removes duplicates. On completion, each   variant  table of a changed
+%   predicate is invalidated once  if  it   unifies  with  some  changed
+%   head. Invalidation also happens if Goal  fails or raises an exception
+%   as the changes are not undone. Nested calls are part of the outermost
+%   batch.
+%
+%   Tables used inside Goal do not see the changes made by Goal.
+
+incr_batch(Goal) :-
+    nb_current('$tbl_incr_batch', batch(_,_)),
+    !,
+    once(Goal).
+incr_batch(Goal) :-
+    trie_new(Changes),
+    setup_call_cleanup(
+        nb_setval('$tbl_incr_batch', batch(Changes, [])),
+        once(Goal),
+        incr_batch_commit(Changes)).
+
+incr_batch_commit(Changes) :-
+    nb_getval('$tbl_incr_batch', batch(_, Preds)),
+    nb_setval('$tbl_incr_batch', []),
+    forall(batch_affected(Changes, Preds, ATrie),
+           '$idg_changed'(ATrie)),
+    trie_destroy(Changes).
+
+batch_affected(Changes, Preds, ATrie) :-
+    '$member'(Gen, Preds),
+    dyn_affected(Gen, ATrie),
+    \+ \+ trie_gen(Changes, Gen).
+
 %!  '$unwrap_incremental'(:Head) is det.
 %
 %   Remove dynamic predicate incremenal forwarding,   reset the possible
@@ -1540,16 +1628,18 @@ dyn_affected(Term, ATrie) :-
 %   _falsecount_). The answers of this predicate are the answers to Goal
 %   after re-evaluating the answer trie.
 %
-%   This finds all dependency  paths  to   dynamic  predicates  and then
-%   evaluates the nodes in a breath-first  fashion starting at the level
-%   just above the dynamic predicates  and   moving  upwards.  Bottom up
-%   evaluation is used to profit from upward propagation of not-modified
-%   events that may cause the evaluation to stop early.
+%   This finds the invalid tables  ATrie  depends   on  and  then  only
+%   re-evaluates these, bottom-up, i.e., a  table is re-evaluated after
+%   the invalid tables it depends on. Bottom   up  evaluation is used to
+%   profit from upward propagation of not-modified events that may cause
+%   the evaluation to stop early: a table   that  is no longer invalid
+%   when we get to it is skipped and   we  stop as soon as ATrie itself
+%   is valid.
 %
-%   Note that false paths either end  in   a  dynamic node or a complete
-%   node. The latter happens if we have and  IDG   "D  -> P -> Q" and we
-%   first re-evaluate P for some reason.  Now   Q  can  still be invalid
-%   after P has been re-evaluated.
+%   Note that the invalid tables either depend  on a dynamic node or a
+%   complete node. The latter happens if  we   have  and IDG "D -> P ->
+%   Q" and we first re-evaluate P for some   reason.  Now Q can still be
+%   invalid after P has been re-evaluated.
 %
 %   @arg ATrie is the answer trie.  When shared tabling, we own this
 %   trie.
@@ -1579,88 +1669,60 @@ try_reeval(ATrie, Goal, Return) :-
     ).
 try_reeval(ATrie, Goal, Return) :-
     tdebug(reeval, 'Planning reeval for ~p', [ATrie]),
-    findall(Path, false_path(ATrie, Path), Paths0),
-    sort(0, @>, Paths0, Paths),
-    split_paths(Paths, Dynamic, Complete),
-    tdebug(forall('$member'(Path, Dynamic),
-                  tdebug(reeval, '  Re-eval dynamic path: ~p', [Path]))),
-    tdebug(forall('$member'(Path, Complete),
-                  tdebug(reeval, '  Re-eval complete path: ~p', [Path]))),
-    reeval_paths(Dynamic, ATrie),
-    reeval_paths(Complete, ATrie),
+    false_nodes(ATrie, BottomUp),
+    tdebug(reeval, '  Re-eval nodes: ~p', [BottomUp]),
+    reeval_nodes(BottomUp, ATrie),
     '$tbl_reeval_prepare'(ATrie, _Variant, Clause),
     (   nonvar(Clause)
     ->  trie_gen_compiled(Clause, Return)
     ;   call(Goal)
     ).
 
-split_paths([], [], []).
-split_paths([[Rank-_Len|Path]|T], [Path|DT], CT) :-
-    status_rank(dynamic, Rank),
-    !,
-    split_paths(T, DT, CT).
-split_paths([[_|Path]|T], DT, [Path|CT]) :-
-    split_paths(T, DT, CT).
-
-reeval_paths([], _) :-
-    !.
-reeval_paths(BottomUp, ATrie) :-
-    is_invalid(ATrie),
-    !,
-    reeval_heads(BottomUp, ATrie, BottomUp1),
-    reeval_paths(BottomUp1, ATrie).
-reeval_paths(_, _).
-
-reeval_heads(_, ATrie, _) :-
+reeval_nodes(_, ATrie) :-
     \+ is_invalid(ATrie),
     !.
-reeval_heads([], _, []).
-reeval_heads([[H]|B], ATrie, BT) :-
-    !,
-    reeval_node(H),
-    reeval_heads(B, ATrie, BT).
-reeval_heads([[]|B], ATrie, BT) :-
-    !,
-    reeval_heads(B, ATrie, BT).
-reeval_heads([[H|T]|B], ATrie, [T|BT]) :-
-    !,
-    reeval_node(H),
-    reeval_heads(B, ATrie, BT).
+reeval_nodes([], _).
+reeval_nodes([H|T], ATrie) :-
+    (   is_invalid(H)
+    ->  reeval_node(H)
+    ;   true
+    ),
+    reeval_nodes(T, ATrie).
 
-%!  false_path(+Atrie, -Path) is nondet.
+%!  false_nodes(+ATrie, -BottomUp) is det.
 %
-%   True when Path is a list of   invalid  tries (bottom up, ending with
-%   ATrie). The last element of the list is a term `Rank-Length` that is
-%   used for sorting the paths.
+%   BottomUp is a list of the invalid  tries   that  ATrie  depends on,
+%   ending with ATrie. Each  trie  appears  once   and  after  all  the
+%   invalid tries it depends on (except for cyclic dependencies).  The
+%   IDG is traversed depth-first, visiting each  node once, such that the
+%   cost is linear in the number of invalid nodes and their edges rather
+%   than in the number of paths through the IDG.
 %
 %   If we find a table along the  way   that  is being worked on by some
 %   other thread we wait for it.
 
-false_path(ATrie, BottomUp) :-
-    false_path(ATrie, Path, []),
-    '$reverse'(Path, BottomUp).
+false_nodes(ATrie, BottomUp) :-
+    trie_new(Seen),
+    call_cleanup(false_nodes(ATrie, Seen, BottomUp, []),
+                 trie_destroy(Seen)).
+
+false_nodes(ATrie, Seen, L0, L) :-
+    (   trie_insert(Seen, ATrie)
+    ->  findall(Dep, false_dependency(ATrie, Dep), Deps),
+        false_nodes_list(Deps, Seen, L0, [ATrie|L])
+    ;   L0 = L
+    ).
+
+false_nodes_list([], _, L, L).
+false_nodes_list([H|T], Seen, L0, L) :-
+    false_nodes(H, Seen, L0, L1),
+    false_nodes_list(T, Seen, L1, L).
 
-false_path(ATrie, [ATrie|T], Seen) :-
-    \+ memberchk(ATrie, Seen),
+false_dependency(ATrie, Dep) :-
     '$idg_edge'(ATrie, dependent, Dep),
     '$tbl_reeval_wait'(Dep, Status),
     tdebug(reeval, '    ~p has dependent ~p (~w)', [ATrie, Dep, Status]),
-    (   Status == invalid
-    ->  false_path(Dep, T, [ATrie|Seen])
-    ;   status_rank(Status, Rank),
-        length(Seen, Len),
-        T = [Rank-Len]
-    ).
-
-status_rank(dynamic,  2) :- !.
-status_rank(complete, 1) :- !.
-status_rank(Status,   Rank) :-
-    var(Rank),
-    !,
-    format(user_error, 'Re-eval from status ~p~n', [Status]),
-    Rank = 0.
-status_rank(Rank,   Rank) :-
-    format(user_error, 'Re-eval from rank ~p~n', [Rank]).
+    Status == invalid.
 
 is_invalid(ATrie) :-
     '$idg_falsecount'(ATrie, FalseCount),
@@ -1842,11 +1904,13 @@ eval_dl_in_residual(G) :-
     '$tbl_table_status'(SGF, _Status, _Wrapper, Return),
     eval_subgoal_in_residual(SGF, Return).
 
+%!  more_general_table(+Goal, -Trie) is semidet.
+%
+%   Trie is the answer table of a call  that subsumes Goal. If there are
+%   multiple, prefer a table that is complete.
+
 more_general_table(G, Trie) :-
-    term_variables(G, Vars),
-    '$tbl_variant_table'(VariantTrie),
-    trie_gen(VariantTrie, G, Trie),
-    is_most_general_term(Vars).
+    '$tbl_subsuming_table'(G, Trie).
 
 :- table eval_subgoal_in_residual/2.
 
@@ -575,7 +575,8 @@ run_main_init :-
 run_main_init.
 
 run_init_goal(Goal, Ctx) :-
-    (   catch_with_backtrace(user:Goal, E, true)
+    (   '$startup_trace'(initialization, user:Goal,
+                         catch_with_backtrace(user:Goal, E, true))
     ->  (   var(E)
         ->  true
         ;   print_message(error, init_goal_failed(E, Ctx)),
@@ -697,6 +698,7 @@ load_setup_file(File) :-
 %   Called from PL_toplevel()
 
 '$toplevel' :-
+    '$startup_trace_write',
     '$runtoplevel',
     print_message(informational, halt).
 
@@ -29,19 +29,25 @@ check_include_file(shlobj.h HAVE_SHLOBJ_H)
 check_include_file(signal.h HAVE_SIGNAL_H)
 check_include_file(string.h HAVE_STRING_H)
 check_include_file(sys/dir.h HAVE_SYS_DIR_H)
+check_include_file(sys/epoll.h HAVE_SYS_EPOLL_H)
 check_include_file(sys/file.h HAVE_SYS_FILE_H)
 check_include_file(sys/mman.h HAVE_SYS_MMAN_H)
 check_include_file(sys/ndir.h HAVE_SYS_NDIR_H)
 check_include_file(sys/param.h HAVE_SYS_PARAM_H)
 check_include_file(sys/resource.h HAVE_SYS_RESOURCE_H)
 check_include_file(sys/select.h HAVE_SYS_SELECT_H)
+check_include_file(sys/sendfile.h HAVE_SYS_SENDFILE_H)
 check_include_file(sys/stat.h HAVE_SYS_STAT_H)
 check_include_file(sys/syscall.h HAVE_SYS_SYSCALL_H)
 check_include_file(sys/termio.h HAVE_SYS_TERMIO_H)
+check_include_file(sys/uio.h HAVE_SYS_UIO_H)
 check_include_file(sys/termios.h HAVE_SYS_TERMIOS_H)
 check_include_file(sys/time.h HAVE_SYS_TIME_H)
 check_include_file(sys/types.h HAVE_SYS_TYPES_H)
 check_include_file(sys/wait.h HAVE_SYS_WAIT_H)
+if(USDT_PROBES)
+check_include_file(sys/sdt.h HAVE_SYS_SDT_H)
+endif()
 check_include_file(term.h HAVE_TERM_H)
 check_include_file(time.h HAVE_TIME_H)
 check_include_file(unistd.h HAVE_UNISTD_H)
@@ -129,7 +135,11 @@ if(NOT EMSCRIPTEN)
 endif()
 check_function_exists(strerror HAVE_STRERROR)
 check_function_exists(poll HAVE_POLL)
+check_function_exists(epoll_create1 HAVE_EPOLL_CREATE1)
 check_function_exists(popen HAVE_POPEN)
+check_function_exists(writev HAVE_WRITEV)
+check_function_exists(posix_fadvise HAVE_POSIX_FADVISE)
+check_function_exists(sendfile HAVE_SENDFILE)
 check_function_exists(getpwnam HAVE_GETPWNAM)
 check_function_exists(fork HAVE_FORK)
 check_function_exists(vfork HAVE_VFORK)
@@ -143,6 +153,7 @@ check_function_exists(fchmod HAVE_FCHMOD)
 check_function_exists(fcntl HAVE_FCNTL)
 check_function_exists(fstat HAVE_FSTAT)
 check_function_exists(ftruncate HAVE_FTRUNCATE)
+check_function_exists(fsync HAVE_FSYNC)
 check_function_exists(getcwd HAVE_GETCWD)
 check_function_exists(getwd HAVE_GETWD)
 check_function_exists(opendir HAVE_OPENDIR)
@@ -194,6 +205,8 @@ check_function_exists(backtrace HAVE_BACKTRACE)
 check_function_exists(alarm HAVE_ALARM)
 # Allocation
 check_function_exists(mtrace HAVE_MTRACE)
+check_function_exists(malloc_trim HAVE_MALLOC_TRIM)
+check_function_exists(malloc_usable_size HAVE_MALLOC_USABLE_SIZE)
 # terminal
 check_function_exists(tgetent HAVE_TGETENT)
 check_function_exists(tcsetattr HAVE_TCSETATTR)
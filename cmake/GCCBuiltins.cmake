@@ -9,6 +9,9 @@ check_c_source_compiles(
 check_c_source_compiles(
     "int i=0; int main() { return __builtin_expect(i, 0) ? 0 : 1; }"
     HAVE___BUILTIN_EXPECT)
+check_c_source_compiles(
+    "long long x=3, y=5, r; int main() { return __builtin_mul_overflow(x, y, &r); }"
+    HAVE__BUILTIN_MUL_OVERFLOW)
 check_c_source_compiles(
     "__thread int i=0; int main() { return 0; }"
     HAVE___THREAD)
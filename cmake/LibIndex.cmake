@@ -10,6 +10,7 @@ foreach(dir ${ARGN})
     add_swipl_target(
 	${target}
 	OUTPUT  ${SWIPL_BUILD_HOME}/${dir}/INDEX.pl
+		${SWIPL_BUILD_HOME}/${dir}/INDEX.fast
 	QUIET
 	COMMAND "make_library_index('${SWIPL_BUILD_HOME}/${dir}')"
 	COMMENT "Build home/${dir}/INDEX.pl")
@@ -40,6 +40,7 @@
             aggregate/4,                % +Templ, +Discrim, :Goal, -Result
             aggregate_all/3,            % +Templ, :Goal, -Result
             aggregate_all/4,            % +Templ, +Discrim, :Goal, -Result
+            parallel_aggregate_all/4,   % +Templ, :Partition, :Goal, -Result
             free_variables/4            % :Generator, :Template, +Vars0, -Vars
           ]).
 :- autoload(library(apply),[maplist/4,maplist/5]).
@@ -47,8 +48,10 @@
 	    [instantiation_error/1,type_error/2,domain_error/2]).
 :- autoload(library(lists),
 	    [append/3,member/2,sum_list/2,max_list/2,min_list/2]).
-:- autoload(library(ordsets),[ord_subtract/3,ord_intersection/3]).
+:- autoload(library(ordsets),
+	    [ord_subtract/3,ord_intersection/3,ord_union/2]).
 :- autoload(library(pairs),[pairs_values/2]).
+:- autoload(library(thread),[task_spawn/2,task_await/1,task_cancel/1]).
 
 
 :- meta_predicate
@@ -56,7 +59,8 @@
     aggregate(?,^,-),
     aggregate(?,?,^,-),
     aggregate_all(?,0,-),
-    aggregate_all(?,?,0,-).
+    aggregate_all(?,?,0,-),
+    parallel_aggregate_all(?,0,0,-).
 
 /** <module> Aggregation operators on backtrackable predicates
 
@@ -268,6 +272,139 @@ aggregate_all(Template, Discriminator, Goal0, Result) :-
     pairs_values(Pairs, List),
     aggregate_list(Aggregate, List, Result).
 
+%!  parallel_aggregate_all(+Template, :Partition, :Goal, -Result) is semidet.
+%
+%   Same as aggregate_all(Template, (Partition,Goal), Result), but
+%   running Goal concurrently for each  solution of Partition. Partition
+%   is enumerated in the calling thread.  For each solution, the partial
+%   aggregate of Goal is computed by   aggregate_all/3  as a task of the
+%   worker pool of library(thread) (see   task_spawn/2).  The partial
+%   results are merged in the order of  the solutions of Partition, so
+%   the result is the same as the result of aggregate_all/3. Only the
+%   partial results are copied between threads.  For example:
+%
+%   ```
+%   ?- parallel_aggregate_all(sum(X),
+%                             between(0, 7, I),
+%                             ( L is I*1000000+1, H is L+999999,
+%                               between(L, H, X)
+%                             ),
+%                             Sum).
+%   ```
+%
+%   Template is one of `count`, sum(Expr), max(Expr), min(Expr),
+%   max(Expr,Witness), min(Expr,Witness), bag(X) or set(X). If the Prolog
+%   flag `cpu_count` is 1 or this  predicate   is  called  from a pool
+%   worker, it calls aggregate_all/3.  As with concurrent_maplist/2, Goal
+%   must be fairly expensive for each solution of Partition before one
+%   reaches a speedup.
+
+parallel_aggregate_all(Template, Partition, Goal, Result) :-
+    parallel_template(Template),
+    parallel_workers,
+    !,
+    findall(Partial-Task,
+            ( call(Partition),
+              task_spawn(partial_aggregate(Template, Goal, Partial), Task)
+            ),
+            Pairs),
+    await_partials(Pairs, Partials),
+    merge_partials(Template, Partials, Result).
+parallel_aggregate_all(Template, Partition, Goal, Result) :-
+    aggregate_all(Template, (Partition,Goal), Result).
+
+parallel_template(Var) :-
+    var(Var),
+    !,
+    instantiation_error(Var).
+parallel_template(count).
+parallel_template(sum(_)).
+parallel_template(max(_)).
+parallel_template(min(_)).
+parallel_template(max(_,_)).
+parallel_template(min(_,_)).
+parallel_template(bag(_)).
+parallel_template(set(_)).
+
+parallel_workers :-
+    current_prolog_flag(cpu_count, Cores),
+    Cores > 1,
+    \+ nb_current('$concurrent_pool_worker', true).
+
+partial_aggregate(Template, Goal, Partial) :-
+    (   aggregate_all(Template, Goal, Result)
+    ->  Partial = just(Result)
+    ;   Partial = none
+    ).
+
+await_partials([], []).
+await_partials([Partial-Task|T0], [Partial|T]) :-
+    catch(task_await(Task), Error, true),
+    (   var(Error)
+    ->  await_partials(T0, T)
+    ;   forall(member(_-Other, T0), task_cancel(Other)),
+        throw(Error)
+    ).
+
+merge_partials(count, Partials, Count) :-
+    merge_partials(sum(_), Partials, Count).
+merge_partials(sum(_), Partials, Sum) :-
+    foldl_partials(Partials, plus, 0, Sum).
+merge_partials(max(_), Partials, Max) :-
+    foldl_partials(Partials, max, none, Max),
+    Max \== none.
+merge_partials(min(_), Partials, Min) :-
+    foldl_partials(Partials, min, none, Min),
+    Min \== none.
+merge_partials(max(_,_), Partials, Max) :-
+    foldl_partials(Partials, max_witness, none, Max),
+    Max \== none.
+merge_partials(min(_,_), Partials, Min) :-
+    foldl_partials(Partials, min_witness, none, Min),
+    Min \== none.
+merge_partials(bag(_), Partials, Bag) :-
+    partial_values(Partials, Bags),
+    append(Bags, Bag).
+merge_partials(set(_), Partials, Set) :-
+    partial_values(Partials, Sets),
+    ord_union(Sets, Set).
+
+foldl_partials([], _, V, V).
+foldl_partials([H|T], Op, V0, V) :-
+    (   H = just(X)
+    ->  merge_partial(Op, V0, X, V1)
+    ;   V1 = V0
+    ),
+    foldl_partials(T, Op, V1, V).
+
+merge_partial(plus, V0, X, V) :-
+    V is V0+X.
+merge_partial(_, none, X, V) :-
+    !,
+    V = X.
+merge_partial(max, V0, X, V) :-
+    V is max(V0,X).
+merge_partial(min, V0, X, V) :-
+    V is min(V0,X).
+merge_partial(max_witness, V0, X, V) :-
+    V0 = max(M0,_),
+    X = max(M,_),
+    (   M > M0
+    ->  V = X
+    ;   V = V0
+    ).
+merge_partial(min_witness, V0, X, V) :-
+    V0 = min(M0,_),
+    X = min(M,_),
+    (   M < M0
+    ->  V = X
+    ;   V = V0
+    ).
+
+partial_values([], []).
+partial_values([just(V)|T0], [V|T]) :-
+    partial_values(T0, T).
+
 template_to_pattern(All, Template, Pattern, Goal0, Goal, Aggregate) :-
     template_to_pattern(Template, Pattern, Post, Vars, Aggregate),
     existential_vars(Goal0, Goal1, AllVars, Vars),
@@ -287,9 +287,11 @@ X = 0.
    where Index is the variable's unique integer index, and Root is the
    root of the BDD that the variable belongs to.
 
-   Each CLP(B) variable also gets an attribute in module clpb_hash: an
-   association table node(LID,HID) -> Node, to keep the BDD reduced.
-   The association table of each variable must be rebuilt on occasion
+   Each CLP(B) variable also gets an attribute in module clpb_hash: a
+   unique table node(LID,HID) -> Node, to keep the BDD reduced. The
+   table is maintained in C (see pl-clpb.c) using backtrackable
+   destructive assignment. The unique table of each variable must be
+   rebuilt on occasion
    to remove nodes that are no longer reachable. We rebuild the
    association tables of involved variables after BDDs are merged to
    build a new root. This only serves to reclaim memory: Keeping a
@@ -388,10 +390,17 @@ sat_rewrite(P =< Q, R)  :- sat_rewrite(~P + Q, R).
 sat_rewrite(P >= Q, R)  :- sat_rewrite(Q =< P, R).
 sat_rewrite(P < Q, R)   :- sat_rewrite(~P * Q, R).
 sat_rewrite(P > Q, R)   :- sat_rewrite(Q < P, R).
-sat_rewrite(+(Ls), R)   :- foldl(or, Ls, 0, F), sat_rewrite(F, R).
-sat_rewrite(*(Ls), R)   :- foldl(and, Ls, 1, F), sat_rewrite(F, R).
+sat_rewrite(+(Ls), R)   :- nest_right(Ls, +, 0, F), sat_rewrite(F, R).
+sat_rewrite(*(Ls), R)   :- nest_right(Ls, *, 1, F), sat_rewrite(F, R).
 
-or(A, B, B + A).
+% Nest to the right, so that the first element of the list, which gets
+% the smallest variable indices, is combined with the BDD of the
+% remaining elements in constant time if they are independent.
+
+nest_right([], _, E, E).
+nest_right([L|Ls], Op, E, F) :-
+        F =.. [Op,L,F0],
+        nest_right(Ls, Op, E, F0).
 
 and(A, B, B * A).
 
@@ -421,9 +430,11 @@ var_index(V, I) :- var_index_root(V, I, _).
 var_index_root(V, I, Root) :- get_attr(V, clpb, index_root(I,Root)).
 
 put_empty_hash(V) :-
-        empty_assoc(H0),
+        empty_node_table(H0),
         put_attr(V, clpb_hash, H0).
 
+empty_node_table('$bdd_table'(0, b([]))).
+
 sat_roots(Sat, Roots) :-
         term_variables(Sat, Vs),
         maplist(var_index_root, Vs, _, Roots0),
@@ -749,11 +760,10 @@ nodes_with_variable([Node|Nodes], VI) -->
 
 make_node(Var, Low, High, Node) :-
         (   Low == High -> Node = Low
-        ;   low_high_key(Low, High, Key),
-            (   lookup_node(Var, Key, Node) -> true
+        ;   (   lookup_node(Var, Low, High, Node) -> true
             ;   clpb_next_id('$clpb_next_node', ID),
                 Node = node(ID,Var,Low,High,_Aux),
-                register_node(Var, Key, Node)
+                register_node(Var, Node)
             )
         ).
 
@@ -762,36 +772,25 @@ make_node(Var, Low, High, Node) -->
         { make_node(Var, Low, High, Node) }.
 
 
-% The key of a node for hashing is determined by the IDs of its
-% children.
-
-low_high_key(Low, High, node(LID,HID)) :-
-        node_id(Low, LID),
-        node_id(High, HID).
-
-
 rebuild_hashes(BDD) :-
         bdd_nodes(nodevar_put_empty_hash, BDD, Nodes),
         maplist(re_register_node, Nodes).
 
 nodevar_put_empty_hash(Node) :-
         node_var_low_high(Node, Var, _, _),
-        empty_assoc(H0),
-        put_attr(Var, clpb_hash, H0).
+        put_empty_hash(Var).
 
 re_register_node(Node) :-
-        node_var_low_high(Node, Var, Low, High),
-        low_high_key(Low, High, Key),
-        register_node(Var, Key, Node).
+        node_var_low_high(Node, Var, _, _),
+        register_node(Var, Node).
 
-register_node(Var, Key, Node) :-
-        get_attr(Var, clpb_hash, H0),
-        put_assoc(Key, H0, Node, H),
-        put_attr(Var, clpb_hash, H).
+register_node(Var, Node) :-
+        get_attr(Var, clpb_hash, H),
+        '$bdd_register'(H, Node).
 
-lookup_node(Var, Key, Node) :-
-        get_attr(Var, clpb_hash, H0),
-        get_assoc(Key, H0, Node).
+lookup_node(Var, Low, High, Node) :-
+        get_attr(Var, clpb_hash, H),
+        '$bdd_lookup'(H, Low, High, Node).
 
 
 node_id(0, false).
@@ -884,13 +883,20 @@ existential_and(Ex-BDD, Node0, Node) :-
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
    Compute F(NA, NB).
 
-   We use a DCG to thread through an implicit argument G0, an
-   association table F(IDA,IDB) -> Node, used for memoization.
+   '$bdd_apply'/6 computes it in C. It fails for nodes whose branching
+   variable is no longer a CLP(B) variable, which are handled here. We
+   use a DCG to thread through an implicit argument G0, an association
+   table F(IDA,IDB) -> Node, used for memoization.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 apply(F, NA, NB, Node) :-
-        empty_assoc(G0),
-        phrase(apply(F, NA, NB, Node), [G0], _).
+        b_getval('$clpb_next_node', ID0),
+        (   '$bdd_apply'(F, NA, NB, Node0, ID0, ID) ->
+            b_setval('$clpb_next_node', ID),
+            Node = Node0
+        ;   empty_assoc(G0),
+            phrase(apply(F, NA, NB, Node), [G0], _)
+        ).
 
 apply(F, NA, NB, Node) -->
         (   { integer(NA), integer(NB) } -> { once(bool_op(F, NA, NB, Node)) }
@@ -1229,8 +1235,7 @@ greater_varindex_than(Node, VI) :-
 
 registered_node(Node-ite(Var,High,Low)) :-
         (   var(Var) ->
-            low_high_key(Low, High, Key),
-            lookup_node(Var, Key, Node0),
+            lookup_node(Var, Low, High, Node0),
             Node == Node0
         ;   true
         ).
@@ -2231,6 +2231,14 @@ coeffs_variables_const([C|Cs], [V|Vs], Cs1, Vs1, I0, I) :-
         ),
         coeffs_variables_const(Cs, Vs, CRest, VRest, I1, I).
 
+% The C version '$fd_sum_bounds'/6 fails if the bounds do not fit in
+% 64 bits.
+
+sum_domains(Cs, Vs, Infs, Sups, Inf, Sup) :-
+        (   '$fd_sum_bounds'(Cs, Vs, Infs, Sups, Inf, Sup) -> true
+        ;   sum_finite_domains(Cs, Vs, Infs, Sups, 0, 0, Inf, Sup)
+        ).
+
 sum_finite_domains([], [], [], [], Inf, Sup, Inf, Sup).
 sum_finite_domains([C|Cs], [V|Vs], Infs, Sups, Inf0, Sup0, Inf, Sup) :-
         fd_get(V, _, Inf1, Sup1, _),
@@ -4387,7 +4395,7 @@ run_propagator(scalar_product_leq(Cs0,Vs0,P0), MState) :-
         coeffs_variables_const(Cs0, Vs0, Cs, Vs, 0, I),
         P is P0 - I,
         (   Vs = [] -> kill(MState), P >= 0
-        ;   sum_finite_domains(Cs, Vs, Infs, Sups, 0, 0, Inf, Sup),
+        ;   sum_domains(Cs, Vs, Infs, Sups, Inf, Sup),
             D1 is P - Inf,
             disable_queue,
             (   Infs == [], Sups == [] ->
@@ -4416,7 +4424,7 @@ run_propagator(scalar_product_eq(Cs0,Vs0,P0), MState) :-
         ;   P =:= 0, Cs == [1,1,-1] -> kill(MState), Vs = [A,B,C], A + B #= C
         ;   P =:= 0, Cs == [1,-1,1] -> kill(MState), Vs = [A,B,C], A + C #= B
         ;   P =:= 0, Cs == [-1,1,1] -> kill(MState), Vs = [A,B,C], B + C #= A
-        ;   sum_finite_domains(Cs, Vs, Infs, Sups, 0, 0, Inf, Sup),
+        ;   sum_domains(Cs, Vs, Infs, Sups, Inf, Sup),
             % nl, writeln(Infs-Sups-Inf-Sup),
             D1 is P - Inf,
             D2 is Sup - P,
@@ -5636,7 +5644,35 @@ with_local_attributes(Vars, Attrs, Goal, Result) :-
               local_attributes(Result,Vars),
               true).
 
+% The value graph is built and filtered in C by '$fd_distinct'/3 if
+% all finite domains are within 64 bits and the graph is not huge.
+% Otherwise, we use the Prolog version below.
+
 distinct(Vars) :-
+        (   native_distinct_domains(Vars, FreeLeft, Doms, 0) ->
+            '$fd_distinct'(FreeLeft, Doms, Removals),
+            disable_queue,
+            maplist(neq_num_pair, Removals),
+            enable_queue
+        ;   distinct_(Vars)
+        ).
+
+native_distinct_domains([], [], [], _).
+native_distinct_domains([V|Vs], FL0, Ds0, Size0) :-
+        (   fd_get(V, Dom, _),
+            domain_infimum(Dom, n(Inf)),
+            domain_supremum(Dom, n(Sup)) ->
+            Inf >= -(1<<62), Sup =< 1<<62,
+            Size is Size0 + Sup - Inf + 1,
+            Size =< 1<<26,
+            FL0 = [V|FL], Ds0 = [Dom|Ds]
+        ;   FL0 = FL, Ds0 = Ds, Size = Size0
+        ),
+        native_distinct_domains(Vs, FL, Ds, Size).
+
+neq_num_pair(V-N) :- neq_num(V, N).
+
+distinct_(Vars) :-
         with_local_attributes(Vars, [edges,parent,g0_edges,index,visited],
               (difference_arcs(Vars, FreeLeft, FreeRight0),
                length(FreeLeft, LFL),
@@ -58,7 +58,6 @@
 :- autoload(library(option),[option/2,select_option/4]).
 :- autoload(library(pure_input),
 	    [phrase_from_file/3,phrase_from_stream/2]).
-:- autoload(library(readutil),[read_line_to_codes/2]).
 :- autoload(library(dcg/basics),[string//1,eos//0]).
 
 
@@ -141,7 +140,13 @@ csv_read_file(File, Rows) :-
 csv_read_file(File, Rows, Options) :-
     default_separator(File, Options, Options1),
     make_csv_options(Options1, Record, RestOptions),
-    phrase_from_file(csv_roptions(Rows, Record), File, RestOptions).
+    (   native_read(Rows, Record)
+    ->  setup_call_cleanup(
+            open(File, read, Stream, RestOptions),
+            csv_read_rows(Stream, Rows, Record),
+            close(Stream))
+    ;   phrase_from_file(csv_roptions(Rows, Record), File, RestOptions)
+    ).
 
 
 default_separator(File, Options0, Options) :-
@@ -160,11 +165,53 @@ ext_separator(tsv, 0'\t).
 
 %!  csv_read_stream(+Stream, -Rows, +Options) is det.
 %
-%   Read CSV data from Stream.  See also csv_read_row/3.
+%   Read CSV data from Stream.  See also csv_read_row/3.  Unless the
+%   option skip_header(+CommentLead) is  given,  records  are  read
+%   directly from Stream by a  native  reader   that  implements the
+%   same syntax as csv//2.
 
 csv_read_stream(Stream, Rows, Options) :-
     make_csv_options(Options, Record, _),
-    phrase_from_stream(csv_roptions(Rows, Record), Stream).
+    (   native_read(Rows, Record)
+    ->  csv_read_rows(Stream, Rows, Record)
+    ;   phrase_from_stream(csv_roptions(Rows, Record), Stream)
+    ).
+
+%   native_read(+Rows, +Record) is semidet.
+%
+%   True if we can read Rows  using   '$csv_read_record'/7.  This is
+%   not possible if we must skip a header or Rows is ground, in which
+%   case csv//2 compares the input to the emitted rows.
+
+native_read(Rows, Record) :-
+    \+ ground(Rows),
+    csv_options_skip_header(Record, Header),
+    var(Header).
+
+csv_read_rows(Stream, Rows, Record) :-
+    csv_options_separator(Record, Sep),
+    csv_options_strip(Record, Strip),
+    csv_options_ignore_quotes(Record, IgnoreQuotes),
+    csv_options_convert(Record, Convert),
+    csv_options_case(Record, Case),
+    csv_options_functor(Record, Functor),
+    csv_read_rows(Stream, Rows, Functor, Record,
+                  Sep, Strip, IgnoreQuotes, Convert, Case).
+
+csv_read_rows(Stream, Rows, Functor, Record,
+              Sep, Strip, IgnoreQuotes, Convert, Case) :-
+    '$csv_read_record'(Stream, Fields,
+                       Sep, Strip, IgnoreQuotes, Convert, Case),
+    (   Fields == end_of_file
+    ->  Rows = []
+    ;   Row =.. [Functor|Fields],
+        functor(Row, _, Arity),
+        check_arity(Record, Arity),
+        debug(csv, 'Row: ~p', [Row]),
+        Rows = [Row|More],
+        csv_read_rows(Stream, More, Functor, Record,
+                      Sep, Strip, IgnoreQuotes, Convert, Case)
+    ).
 
 
 %!  csv(?Rows)// is det.
@@ -418,11 +465,6 @@ end_of_record --> eos.                  % unterminated last record
 %     Line is unified with the 1-based line-number from which Row is
 %     read.  Note that Line is not the physical line, but rather the
 %     _logical_ record number.
-%
-%   @tbd    Input is read line by line.  If a record separator is
-%           embedded in a quoted field, parsing the record fails and
-%           another line is added to the input.  This does not nicely
-%           deal with other reasons why parsing the row may fail.
 
 csv_read_file_row(File, Row, Options) :-
     default_separator(File, Options, Options1),
@@ -450,38 +492,23 @@ csv_read_stream_row(Stream, Row, Line, Options) :-
 %   csv_options/2. Row is unified with   `end_of_file` upon reaching the
 %   end of the input.
 
-csv_read_row(Stream, Row, _Record) :-
-    at_end_of_stream(Stream),
-    !,
-    Row = end_of_file.
 csv_read_row(Stream, Row, Record) :-
-    read_lines_to_codes(Stream, Codes, Record, even),
-    phrase(row(Row0, Record), Codes),
-    !,
-    Row = Row0.
-
-read_lines_to_codes(Stream, Codes, Options, QuoteQuantity) :-
-    read_line_to_codes(Stream, Codes0),
-    Codes0 \== end_of_file,
-    (   (   csv_options_ignore_quotes(Options, true)
-        ;   check_quotes(Codes0, QuoteQuantity, even)
-        )
-    ->  Codes = Codes0
-    ;   append(Codes0, [0'\n|Tail], Codes),
-        read_lines_to_codes(Stream, Tail, Options, odd)
+    csv_options_separator(Record, Sep),
+    csv_options_strip(Record, Strip),
+    csv_options_ignore_quotes(Record, IgnoreQuotes),
+    csv_options_convert(Record, Convert),
+    csv_options_case(Record, Case),
+    '$csv_read_record'(Stream, Fields,
+                       Sep, Strip, IgnoreQuotes, Convert, Case),
+    (   Fields == end_of_file
+    ->  Row = end_of_file
+    ;   csv_options_functor(Record, Functor),
+        Row0 =.. [Functor|Fields],
+        functor(Row0, _, Arity),
+        check_arity(Record, Arity),
+        Row = Row0
     ).
 
-check_quotes([], QuoteQuantity, QuoteQuantity) :-
-    !.
-check_quotes([0'"|T], odd, Result) :-
-    !,
-    check_quotes(T, even, Result).
-check_quotes([0'"|T], even, Result) :-
-    !,
-    check_quotes(T, odd, Result).
-check_quotes([_|T], QuoteQuantity, Result) :-
-    check_quotes(T, QuoteQuantity, Result).
-
 
 %!  csv_options(-Compiled, +Options) is det.
 %
@@ -70,6 +70,11 @@
  * amortized time (though delete-min, i.e., get_from_heap/3, takes linear time
  * in the worst case).
  *
+ * Heaps are  terms,  so  old  versions   remain  valid  and  changes  are
+ * undone on backtracking. If this is not needed,  the mutable priority
+ * queues provided by priority_queue_create/1 and friends are much faster
+ * and support changing the priority of an entry.
+ *
  * @author Lars Buitinck
  */
 
@@ -0,0 +1,305 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(inline,
+          [ inline/1,                   % :PredicateIndicators
+            update_inlined/0
+          ]).
+:- autoload(library(error),
+            [instantiation_error/1, must_be/2, type_error/2]).
+:- autoload(library(lists), [member/2]).
+:- use_module(library(make), []).
+
+:- meta_predicate
+    inline(:).
+
+/** <module> Inline small predicates at compile time
+
+This library defines goal_expansion/2 rules that replace calls to small
+predicates by their body.  This avoids the creation of an environment
+frame for helpers such as below.
+
+    ==
+    :- use_module(library(inline)).
+    :- inline(succ_or_zero/2).
+
+    succ_or_zero(X, Y) :-
+        (   X > 0
+        ->  Y is X - 1
+        ;   Y = 0
+        ).
+    ==
+
+Predicates are only inlined if they are declared using inline/1 and when
+they are called from code that is compiled after the predicate has been
+defined.  In addition, the predicate must be static, consist of a single
+clause without a cut, may not be transparent, multifile, tabled or
+thread local and may not be (mutually) recursive through other inlined
+predicates.  If any of these conditions does not hold, the call is left
+as is.  Head unification that cannot be resolved at compile time is
+translated into explicit =/2 calls and the body is executed in the
+module of the predicate.
+
+The library keeps track of the files into which a predicate is inlined.
+If the inlined predicate is redefined, e.g., by editing and reloading
+its file, update_inlined/0 reloads these files.  This is called
+automatically by make/0.
+
+Inlined calls are invisible to the debugger.
+*/
+
+:- dynamic
+    inline_predicate/1,                 % Module:Name/Arity
+    inlined/3.                          % Module:Name/Arity, ClauseRef, File
+
+%!  inline(:PredicateIndicators) is det.
+%
+%   Declare the predicates in PredicateIndicators as candidates for
+%   inlining.  PredicateIndicators is a predicate indicator, a list of
+%   predicate indicators or a comma separated sequence of them.
+
+inline(Spec) :-
+    strip_module(Spec, M, PIs),
+    inline(PIs, M).
+
+inline(Var, _) :-
+    var(Var),
+    !,
+    instantiation_error(Var).
+inline(M:Spec, _) :-
+    !,
+    inline(Spec, M).
+inline([], _) :-
+    !.
+inline([H|T], M) :-
+    !,
+    inline(H, M),
+    inline(T, M).
+inline((A,B), M) :-
+    !,
+    inline(A, M),
+    inline(B, M).
+inline(Name/Arity, M) :-
+    !,
+    must_be(atom, Name),
+    must_be(nonneg, Arity),
+    (   inline_predicate(M:Name/Arity)
+    ->  true
+    ;   assertz(inline_predicate(M:Name/Arity))
+    ).
+inline(Spec, _) :-
+    type_error(predicate_indicator, Spec).
+
+
+%!  expand_inline(+Goal, -Expanded) is semidet.
+%
+%   Expand Goal, called from the module we are loading into, if it
+%   calls a predicate that can be inlined.
+
+expand_inline(Goal, Expanded) :-
+    callable(Goal),
+    Goal \= _:_,
+    prolog_load_context(module, M),
+    inline_clause(M:Goal, C:Head, Body, Ref),
+    Goal =.. [_|GoalArgs],
+    Head =.. [_|HeadArgs],
+    head_unify(HeadArgs, GoalArgs, [], Unify),
+    qualify(C, M, Body, QBody),
+    conj(Unify, QBody, Expanded),
+    record_inlined(C:Head, Ref).
+
+inline_clause(M:Goal, C:Head, Body, Ref) :-
+    inline_candidate(M:Goal, C:Head, PI),
+    clause(C:Head, Body, Ref),
+    \+ recursive(C:Body, [PI]).
+
+inline_candidate(M:Goal, C:Head, C:Name/Arity) :-
+    functor(Goal, Name, Arity),
+    once(inline_predicate(_:Name/Arity)),
+    functor(Head, Name, Arity),
+    (   predicate_property(M:Head, imported_from(C0))
+    ->  C = C0
+    ;   C = M
+    ),
+    inline_predicate(C:Name/Arity),
+    predicate_property(C:Head, number_of_clauses(1)),
+    \+ ( member(Prop, [ dynamic, multifile, transparent, tabled,
+                        thread_local, foreign
+                      ]),
+         predicate_property(C:Head, Prop)
+       ),
+    clause(C:Head, Body),
+    \+ has_cut(Body).
+
+%!  head_unify(+HeadArgs, +GoalArgs, +Seen, -Unify) is det.
+%
+%   Bind the fresh head variables to the goal arguments and translate
+%   the remaining head unification into =/2 calls.
+
+head_unify([], [], _, true).
+head_unify([H|HT], [G|GT], Seen, Unify) :-
+    (   var(H),
+        \+ ( member(V, Seen), V == H )
+    ->  H = G,
+        head_unify(HT, GT, [H|Seen], Unify)
+    ;   conj(G=H, Unify1, Unify),
+        head_unify(HT, GT, Seen, Unify1)
+    ).
+
+conj(true, G, G) :- !.
+conj(G, true, G) :- !.
+conj(A, B, (A,B)).
+
+qualify(M, M, Body, Body) :- !.
+qualify(_, _, true, true) :- !.
+qualify(C, _, Body, C:Body).
+
+%!  has_cut(@Body) is semidet.
+%
+%   True if Body contains a cut in its control structure.
+
+has_cut(Var) :-
+    var(Var),
+    !,
+    fail.
+has_cut(!) :- !.
+has_cut((A,B)) :- !, ( has_cut(A) ; has_cut(B) ).
+has_cut((A;B)) :- !, ( has_cut(A) ; has_cut(B) ).
+has_cut((A->B)) :- !, ( has_cut(A) ; has_cut(B) ).
+has_cut((A*->B)) :- !, ( has_cut(A) ; has_cut(B) ).
+has_cut(\+ A) :- !, has_cut(A).
+has_cut(_:A) :- has_cut(A).
+
+%!  recursive(+Body, +Visited) is semidet.
+%
+%   True if Body calls one of the predicates in Visited, directly or
+%   through other inlined predicates.  Expanding such a call would
+%   not terminate.
+
+recursive(_:Var, _) :-
+    var(Var),
+    !,
+    fail.
+recursive(_:(M:G), Visited) :-
+    !,
+    atom(M),
+    recursive(M:G, Visited).
+recursive(M:(A,B), Visited) :-
+    !,
+    ( recursive(M:A, Visited) ; recursive(M:B, Visited) ).
+recursive(M:(A;B), Visited) :-
+    !,
+    ( recursive(M:A, Visited) ; recursive(M:B, Visited) ).
+recursive(M:(A->B), Visited) :-
+    !,
+    ( recursive(M:A, Visited) ; recursive(M:B, Visited) ).
+recursive(M:(A*->B), Visited) :-
+    !,
+    ( recursive(M:A, Visited) ; recursive(M:B, Visited) ).
+recursive(M:(\+ A), Visited) :-
+    !,
+    recursive(M:A, Visited).
+recursive(M:Goal, Visited) :-
+    callable(Goal),
+    (   predicate_property(M:Goal, meta_predicate(Spec)),
+        arg(I, Spec, S),
+        ( S == 0 ; S == ^ ),
+        arg(I, Goal, A),
+        recursive(M:A, Visited)
+    ->  true
+    ;   inline_candidate(M:Goal, C:Head, PI)
+    ->  (   member(PI, Visited)
+        ->  true
+        ;   clause(C:Head, Body),
+            recursive(C:Body, [PI|Visited])
+        )
+    ).
+
+%!  record_inlined(+Callee, +ClauseRef) is det.
+%
+%   Record that we inlined ClauseRef into the file we are loading.
+
+record_inlined(C:Head, Ref) :-
+    functor(Head, Name, Arity),
+    (   prolog_load_context(source, File)
+    ->  (   inlined(C:Name/Arity, Ref, File)
+        ->  true
+        ;   retractall(inlined(C:Name/Arity, _, File)),
+            assertz(inlined(C:Name/Arity, Ref, File))
+        )
+    ;   true
+    ).
+
+
+%!  update_inlined is det.
+%
+%   Reload all files into which a predicate was inlined whose definition
+%   has changed since.
+
+update_inlined :-
+    findall(File, outdated_file(File), Files0),
+    sort(Files0, Files),
+    forall(member(File, Files),
+           ( retractall(inlined(_, _, File)),
+             print_message(informational, inline(reload(File))),
+             make:reload_file(File)
+           )).
+
+outdated_file(File) :-
+    inlined(C:Name/Arity, Ref, File),
+    \+ ( functor(Head, Name, Arity),
+         predicate_property(C:Head, number_of_clauses(1)),
+         nth_clause(C:Head, 1, Ref)
+       ).
+
+
+                 /*******************************
+                 *            HOOKS             *
+                 *******************************/
+
+:- multifile
+    system:goal_expansion/2,
+    prolog:make_hook/2,
+    prolog:message//1.
+
+system:goal_expansion(GoalIn, GoalOut) :-
+    \+ current_prolog_flag(xref, true),
+    expand_inline(GoalIn, GoalOut).
+
+prolog:make_hook(after, _Files) :-
+    update_inlined,
+    fail.
+
+prolog:message(inline(reload(File))) -->
+    [ 'Reloading ~w: inlined predicates have changed'-[File] ].
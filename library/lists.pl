@@ -543,6 +543,10 @@ min_member_([H|T], Min0, Min) :-
 %
 %   Sum is the result of adding all numbers in List.
 
+sum_list(Xs, Sum) :-
+    '$sum_list'(Xs, Sum0),
+    !,
+    Sum = Sum0.
 sum_list(Xs, Sum) :-
     sum_list(Xs, 0, Sum).
 
@@ -558,6 +562,10 @@ sum_list([X|Xs], Sum0, Sum) :-
 %
 %   @see max_member/2.
 
+max_list(Xs, Max) :-
+    '$max_list'(Xs, Max0),
+    !,
+    Max = Max0.
 max_list([H|T], Max) :-
     max_list(T, H, Max).
 
@@ -574,6 +582,10 @@ max_list([H|T], Max0, Max) :-
 %
 %   @see min_member/2.
 
+min_list(Xs, Min) :-
+    '$min_list'(Xs, Min0),
+    !,
+    Min = Min0.
 min_list([H|T], Min) :-
     min_list(T, H, Min).
 
@@ -590,6 +602,10 @@ min_list([H|T], Min0, Min) :-
 %   @error type_error(integer, Low)
 %   @error type_error(integer, High)
 
+numlist(L, U, Ns) :-
+    '$numlist'(L, U, Ns0),
+    !,
+    Ns = Ns0.
 numlist(L, U, Ns) :-
     must_be(integer, L),
     must_be(integer, U),
@@ -215,6 +215,8 @@ l_int([_-H|T], S0, S) :-
 ord_intersection(Set1, Set2, Intersection) :-
     (   Intersection == []
     ->  ord_disjoint(Set1, Set2)
+    ;   '$ord_intersection'(Set1, Set2, Intersection0)
+    ->  Intersection = Intersection0
     ;   oset_int(Set1, Set2, Intersection)
     ).
 
@@ -297,27 +299,8 @@ ord_selectchk(Item, [Item|Set1], Set1) :-
 %
 %   @author Richard O'Keefe
 
-ord_memberchk(Item, [X1,X2,X3,X4|Xs]) :-
-    !,
-    compare(R4, Item, X4),
-    (   R4 = (>) -> ord_memberchk(Item, Xs)
-    ;   R4 = (<) ->
-        compare(R2, Item, X2),
-        (   R2 = (>) -> Item == X3
-        ;   R2 = (<) -> Item == X1
-        ;/* R2 = (=),   Item == X2 */ true
-        )
-    ;/* R4 = (=) */ true
-    ).
-ord_memberchk(Item, [X1,X2|Xs]) :-
-    !,
-    compare(R2, Item, X2),
-    (   R2 = (>) -> ord_memberchk(Item, Xs)
-    ;   R2 = (<) -> Item == X1
-    ;/* R2 = (=) */ true
-    ).
-ord_memberchk(Item, [X1]) :-
-    Item == X1.
+ord_memberchk(Item, Set) :-
+    '$ord_memberchk'(Item, Set).
 
 
 %!  ord_subset(+Sub, +Super) is semidet.
@@ -341,6 +324,10 @@ ord_subset_(=, _, T1, T2) :-
 %   Diff is the set holding all elements of InOSet that are not in
 %   NotInOSet.
 
+ord_subtract(InOSet, NotInOSet, Diff) :-
+    '$ord_subtract'(InOSet, NotInOSet, Diff0),
+    !,
+    Diff = Diff0.
 ord_subtract(InOSet, NotInOSet, Diff) :-
     oset_diff(InOSet, NotInOSet, Diff).
 
@@ -376,6 +363,10 @@ ord_union_all(N, Sets0, Union, Sets) :-
 %
 %   Union is the union of Set1 and Set2
 
+ord_union(Set1, Set2, Union) :-
+    '$ord_union'(Set1, Set2, Union0),
+    !,
+    Union = Union0.
 ord_union(Set1, Set2, Union) :-
     oset_union(Set1, Set2, Union).
 
@@ -53,11 +53,15 @@
 	      permission_error/3,
 	      existence_error/2
 	    ]).
+:- autoload(library(lists),[member/2]).
+:- autoload(library(modules),[in_temporary_module/3]).
 :- autoload(library(option),[option/3]).
 
 
 :- predicate_options(db_attach/2, 2,
-                     [ sync(oneof([close,flush,none]))
+                     [ sync(oneof([close,flush,none,fsync,group])),
+                       format(oneof([text,binary])),
+                       background_gc(boolean)
                      ]).
 
 /** <module> Provide persistent dynamic predicates
@@ -138,10 +142,14 @@ set_user_role(Name, Role) :-
     db_file/5,                      % Module, File, Created, Modified, EndPos
     db_stream/2,                    % Module, Stream
     db_dirty/2,                     % Module, Deleted
-    db_option/2.                    % Module, Name(Value)
+    db_option/2,                    % Module, Name(Value)
+    db_lock/3,                      % Module, WriteMutex, CommitMutex
+    db_gc_thread/2.                 % Module, Thread
 
 :- volatile
-    db_stream/2.
+    db_stream/2,
+    db_lock/3,
+    db_gc_thread/2.
 
 :- multifile
     (persistent)/3,                 % Module, Generic, Term
@@ -290,8 +298,24 @@ prolog:generated_predicate(PI) :-
 %
 %     - sync(+Sync)
 %       One of =close= (close journal after write), =flush=
-%       (default, flush journal after write) or =none=
-%       (handle as fully buffered stream).
+%       (default, flush journal after write), =none=
+%       (handle as fully buffered stream), =fsync= (flush the
+%       journal and wait until the OS has written it to disk) or
+%       =group= (as =fsync=, using _group commit_).  Using group
+%       commit, threads that update the database concurrently
+%       share a single disk synchronisation, which greatly
+%       improves the number of durable updates per second.
+%     - format(+Format)
+%       One of =text= (default) or =binary=.  A binary journal is
+%       written using fast_write/2, which makes loading the
+%       database faster.  The format of an existing journal is
+%       detected automatically.  This option only affects new
+%       journals and journals that are rewritten by db_sync/1
+%       using gc.
+%     - background_gc(+Boolean)
+%       If `true` (default `false`), db_sync/1 using gc does not
+%       block the caller, but compacts the journal in a background
+%       thread while the database remains available for updates.
 %
 %   If File is already attached  this   operation  may change the `sync`
 %   behaviour.
@@ -302,11 +326,17 @@ db_attach(Module:File, Options) :-
 
 db_set_options(Module, Options) :-
     option(sync(Sync), Options, flush),
-    must_be(oneof([close,flush,none]), Sync),
-    (   db_option(Module, sync(Sync))
+    must_be(oneof([close,flush,none,fsync,group]), Sync),
+    option(format(Format), Options, text),
+    must_be(oneof([text,binary]), Format),
+    option(background_gc(BGC), Options, false),
+    must_be(boolean, BGC),
+    DBOptions = [sync(Sync), format(Format), background_gc(BGC)],
+    (   findall(Opt, db_option(Module, Opt), DBOptions)
     ->  true
     ;   retractall(db_option(Module, _)),
-        assert(db_option(Module, sync(Sync)))
+        forall(member(Opt, DBOptions),
+               assert(db_option(Module, Opt)))
     ).
 
 db_attach_file(Module, File) :-
@@ -329,7 +359,7 @@ db_load(Module, File) :-
     retractall(db_file(Module, _, _, _, _)),
     debug(db, 'Loading database ~w', [File]),
     catch(setup_call_cleanup(
-              open(File, read, In, [encoding(utf8)]),
+              open_journal(File, In),
               load_db_end(In, Module, Created, EndPos),
               close(In)),
           error(existence_error(source_sink, File), _), fail),
@@ -340,7 +370,7 @@ db_load(Module, File) :-
 db_load_incremental(Module, File) :-
     db_file(Module, File, Created, _, EndPos0),
     setup_call_cleanup(
-        ( open(File, read, In, [encoding(utf8)]),
+        ( open_journal(File, In),
           read_action(In, created(Created0)),
           set_stream_position(In, EndPos0)
         ),
@@ -365,38 +395,39 @@ load_db_end(In, Module, Created, End) :-
     stream_property(In, position(End)).
 
 load_db(end_of_file, _, _) :- !.
-load_db(assert(Term), In, Module) :-
-    persistent(Module, Term, _Types),
-    !,
-    assert(Module:Term),
+load_db(Action, In, Module) :-
+    replay_action(Action, Module, Module, Deleted),
+    set_dirty(Module, Deleted),
     read_action(In, T1),
     load_db(T1, In, Module).
-load_db(asserta(Term), In, Module) :-
+
+%!  replay_action(+Action, +Module, +DB, -Deleted) is det.
+%
+%   Apply a journal Action for  the   persistent  declarations  of
+%   Module to the clauses in DB.  Deleted  is the number of clauses
+%   removed by Action.
+
+replay_action(assert(Term), Module, DB, 0) :-
     persistent(Module, Term, _Types),
     !,
-    asserta(Module:Term),
-    read_action(In, T1),
-    load_db(T1, In, Module).
-load_db(retractall(Term, Count), In, Module) :-
+    assert(DB:Term).
+replay_action(asserta(Term), Module, DB, 0) :-
     persistent(Module, Term, _Types),
     !,
-    retractall(Module:Term),
-    set_dirty(Module, Count),
-    read_action(In, T1),
-    load_db(T1, In, Module).
-load_db(retract(Term), In, Module) :-
+    asserta(DB:Term).
+replay_action(retractall(Term, Count), Module, DB, Count) :-
     persistent(Module, Term, _Types),
     !,
-    (   retract(Module:Term)
-    ->  set_dirty(Module, 1)
-    ;   true
-    ),
-    read_action(In, T1),
-    load_db(T1, In, Module).
-load_db(Term, In, Module) :-
-    print_message(error, illegal_term(Term)),
-    read_action(In, T1),
-    load_db(T1, In, Module).
+    retractall(DB:Term).
+replay_action(retract(Term), Module, DB, Deleted) :-
+    persistent(Module, Term, _Types),
+    !,
+    (   retract(DB:Term)
+    ->  Deleted = 1
+    ;   Deleted = 0
+    ).
+replay_action(Term, _, _, 0) :-
+    print_message(error, illegal_term(Term)).
 
 db_clean(Module) :-
     retractall(db_dirty(Module, _)),
@@ -444,30 +475,143 @@ db_asserta(Module:Term) :-
     asserta(Module:Term),
     persistent(Module, asserta(Term)).
 
+%   Writing to the journal is serialized using the write mutex of
+%   the database.  Each write is numbered using flag/3 on the name of
+%   this mutex, which allows group_commit/4 to find the writes that
+%   are covered by a disk synchronisation.
+
 persistent(Module, Action) :-
+    db_locks(Module, Write, Commit),
+    with_mutex(Write, write_journal(Module, Write, Action, Stream, Seq)),
+    (   db_option(Module, sync(group))
+    ->  group_commit(Commit, Write, Stream, Seq)
+    ;   true
+    ).
+
+write_journal(Module, Write, Action, Stream, Seq) :-
     (   db_stream(Module, Stream)
     ->  true
     ;   db_file(Module, File, _Created, _Modified, _EndPos)
     ->  db_sync(Module, update),            % Is this correct?
-        db_open_file(File, append, Stream),
+        db_open_file(Module, File, append, Stream),
         assert(db_stream(Module, Stream))
     ;   existence_error(db_file, Module)
     ),
     write_action(Stream, Action),
+    flag(Write, Seq0, Seq0+1),
+    Seq is Seq0+1,
     sync(Module, Stream).
 
-db_open_file(File, Mode, Stream) :-
+%!  db_locks(+Module, -WriteMutex, -CommitMutex) is det.
+%
+%   Mutexes that protect the journal of Module.  WriteMutex
+%   serializes writes to the journal and CommitMutex serializes disk
+%   synchronisation.  If both are needed, WriteMutex must be locked
+%   first.
+
+db_locks(Module, Write, Commit) :-
+    db_lock(Module, Write, Commit),
+    !.
+db_locks(Module, Write, Commit) :-
+    with_mutex(persistency, create_db_locks(Module, Write, Commit)).
+
+create_db_locks(Module, Write, Commit) :-
+    db_lock(Module, Write, Commit),
+    !.
+create_db_locks(Module, Write, Commit) :-
+    atom_concat('__persistency_write_', Module, Write),
+    atom_concat('__persistency_commit_', Module, Commit),
+    assert(db_lock(Module, Write, Commit)).
+
+%!  group_commit(+CommitMutex, +WriteMutex, +Stream, +Seq) is det.
+%
+%   Make sure journal write Seq is on disk.  The thread that holds
+%   CommitMutex synchronises all writes done so far.  Threads that
+%   wrote while it was waiting for the disk queue for CommitMutex
+%   and the first of these synchronises all of them, after which the
+%   others find their write covered.  The number of the last
+%   synchronised write is kept using flag/3 on CommitMutex.
+
+group_commit(Commit, Write, Stream, Seq) :-
+    with_mutex(Commit, commit_upto(Commit, Write, Stream, Seq)).
+
+commit_upto(Commit, Write, Stream, Seq) :-
+    flag(Commit, Synced, Synced),
+    (   Synced >= Seq
+    ->  true
+    ;   flag(Write, Written, Written),
+        catch('$sync_output'(Stream),
+              error(existence_error(stream, _), _),
+              true),                        % closed using db_sync/1
+        flag(Commit, _, Written)
+    ).
+
+db_open_file(Module, File, Mode, Stream) :-
+    (   Mode == append,
+        exists_file(File),
+        \+ size_file(File, 0)
+    ->  journal_format(File, Format)
+    ;   db_option(Module, format(Format))
+    ->  true
+    ;   Format = text
+    ),
+    journal_open_options(Format, Options),
     open(File, Mode, Stream,
          [ close_on_abort(false),
-           encoding(utf8),
            lock(write)
+         | Options
          ]),
     (   size_file(File, 0)
     ->  get_time(Now),
+        journal_header(Format, Stream),
         write_action(Stream, created(Now))
     ;   true
     ).
 
+%!  open_journal(+File, -In) is det.
+%
+%   Open the journal File for reading, positioned at its first
+%   action.
+
+open_journal(File, In) :-
+    journal_format(File, Format),
+    journal_open_options(Format, Options),
+    open(File, read, In, Options),
+    (   Format == binary
+    ->  journal_magic(Magic),
+        string_length(Magic, Len),
+        read_string(In, Len, _)
+    ;   true
+    ).
+
+%!  journal_format(+File, -Format) is det.
+%
+%   True when Format is the format of the journal File.  A binary
+%   journal starts with journal_magic/1.  As a text journal starts
+%   with a term, the two cannot be confused.
+
+journal_format(File, Format) :-
+    journal_magic(Magic),
+    string_length(Magic, Len),
+    setup_call_cleanup(
+        open(File, read, In, [type(binary)]),
+        peek_string(In, Len, Start),
+        close(In)),
+    (   Start == Magic
+    ->  Format = binary
+    ;   Format = text
+    ).
+
+journal_magic("%binary-journal\n").
+
+journal_open_options(text,   [encoding(utf8)]).
+journal_open_options(binary, [type(binary)]).
+
+journal_header(text, _).
+journal_header(binary, Stream) :-
+    journal_magic(Magic),
+    write(Stream, Magic).
+
 
 %!  db_detach is det.
 %
@@ -490,7 +634,9 @@ db_detach :-
 %   Using =flush= flushes the stream  but   does  not close it. This
 %   provides better performance. Using  =none=,   the  stream is not
 %   even flushed. This makes the journal   sensitive to crashes, but
-%   much faster.
+%   much faster.  Using =fsync=, the stream is flushed and we wait for
+%   the OS to write the data to disk.  Using =group=, this is done by
+%   group_commit/4 after releasing the write mutex.
 
 sync(Module, Stream) :-
     db_option(Module, sync(Sync)),
@@ -498,12 +644,22 @@ sync(Module, Stream) :-
     ->  db_sync(Module, close)
     ;   Sync == flush
     ->  flush_output(Stream)
+    ;   Sync == fsync
+    ->  '$sync_output'(Stream)
     ;   true
     ).
 
+read_action(Stream, Action) :-
+    stream_property(Stream, type(binary)),
+    !,
+    fast_read(Stream, Action).
 read_action(Stream, Action) :-
     read_term(Stream, Action, [module(db)]).
 
+write_action(Stream, Action) :-
+    stream_property(Stream, type(binary)),
+    !,
+    fast_write(Stream, Action).
 write_action(Stream, Action) :-
     \+ \+ ( numbervars(Action, 0, _, [singletons(true)]),
             format(Stream, '~W.~n',
@@ -583,6 +739,11 @@ set_dirty(Module, Count) :-
 %     percentage of the total number of terms.
 %     * gc(always)
 %     GC DB without checking the percentage.
+%
+%     If the database was attached using the option
+%     background_gc(true), GC is performed by a background thread
+%     and db_sync/1 returns immediately.  GC requests while the
+%     background thread is running are ignored.
 %     * close
 %     Database stream was closed
 %     * detach
@@ -628,27 +789,11 @@ db_sync(Module, gc(When)) :-
         )
     ),
     !,
-    db_sync(Module, close),
-    db_file(Module, File, _, Modified, _),
-    atom_concat(File, '.new', NewFile),
-    debug(db, 'Database ~w is dirty; cleaning', [File]),
-    get_time(Created),
-    catch(setup_call_cleanup(
-              db_open_file(NewFile, write, Out),
-              (   persistent(Module, Term, _Types),
-                  call(Module:Term),
-                  write_action(Out, assert(Term)),
-                  fail
-              ;   stream_property(Out, position(EndPos))
-              ),
-              close(Out)),
-          Error,
-          ( catch(delete_file(NewFile),_,fail),
-            throw(Error))),
-    retractall(db_file(Module, File, _, Modified, _)),
-    rename_file(NewFile, File),
-    time_file(File, NewModified),
-    assert(db_file(Module, File, Created, NewModified, EndPos)).
+    (   db_option(Module, background_gc(true))
+    ->  db_gc_background(Module)
+    ;   db_locks(Module, Write, Commit),
+        with_mutex(Write, with_mutex(Commit, db_gc(Module, Write, Commit)))
+    ).
 db_sync(Module, close) :-
     retract(db_stream(Module, Stream)),
     !,
@@ -673,6 +818,181 @@ db_sync(_, nop) :- !.
 db_sync(_, _).
 
 
+db_gc(Module, Write, Commit) :-
+    db_sync(Module, close),
+    db_file(Module, File, _, Modified, _),
+    atom_concat(File, '.new', NewFile),
+    debug(db, 'Database ~w is dirty; cleaning', [File]),
+    get_time(Created),
+    catch(setup_call_cleanup(
+              db_open_file(Module, NewFile, write, Out),
+              (   persistent(Module, Term, _Types),
+                  call(Module:Term),
+                  write_action(Out, assert(Term)),
+                  fail
+              ;   stream_property(Out, position(EndPos)),
+                  '$sync_output'(Out)
+              ),
+              close(Out)),
+          Error,
+          ( catch(delete_file(NewFile),_,fail),
+            throw(Error))),
+    retractall(db_file(Module, File, _, Modified, _)),
+    rename_file(NewFile, File),
+    time_file(File, NewModified),
+    assert(db_file(Module, File, Created, NewModified, EndPos)),
+    retractall(db_dirty(Module, _)),
+    journal_synced(Write, Commit).
+
+%   journal_synced(+WriteMutex, +CommitMutex) tells  group_commit/4
+%   that all writes so far are on disk.
+
+journal_synced(Write, Commit) :-
+    flag(Write, Written, Written),
+    flag(Commit, _, Written).
+
+
+                 /*******************************
+                 *        BACKGROUND GC         *
+                 *******************************/
+
+%!  db_gc_background(+Module) is det.
+%
+%   Compact the journal of Module in a background thread.  The
+%   thread rebuilds the database from the journal up to the current
+%   end, writes the result to a new journal and finally appends the
+%   actions that were added in the meanwhile to the new journal and
+%   replaces the old one.  Only the last step blocks updates.
+%   Rebuilding from the journal rather than the clauses of Module
+%   makes the result independent from updates that modified the
+%   clauses but are not yet written to the journal.
+
+db_gc_background(Module) :-
+    with_mutex(persistency, start_gc_thread(Module)).
+
+start_gc_thread(Module) :-
+    db_gc_thread(Module, _),
+    !.
+start_gc_thread(Module) :-
+    thread_create(gc_thread(Module), Id, [detached(true)]),
+    assert(db_gc_thread(Module, Id)).
+
+gc_thread(Module) :-
+    call_cleanup(
+        catch(compact_journal(Module), E,
+              print_message(error, E)),
+        with_mutex(persistency, retractall(db_gc_thread(Module, _)))).
+
+compact_journal(Module) :-
+    db_locks(Module, Write, Commit),
+    with_mutex(Write, journal_end(Module, File, End)),
+    atom_concat(File, '.new', NewFile),
+    debug(db, 'Compacting ~w upto ~D bytes', [File, End]),
+    catch(( setup_call_cleanup(
+                db_open_file(Module, NewFile, write, Out),
+                write_compacted(Module, File, End, Out),
+                close(Out)),
+            with_mutex(Write,
+                       with_mutex(Commit,
+                                  switch_journal(Module, File, End,
+                                                 NewFile, Write, Commit)))
+          ),
+          Error,
+          ( catch(delete_file(NewFile),_,fail),
+            throw(Error))).
+
+journal_end(Module, File, End) :-
+    db_file(Module, File, _, _, _),
+    (   db_stream(Module, Stream)
+    ->  flush_output(Stream)
+    ;   true
+    ),
+    size_file(File, End).
+
+%   write_compacted(+Module, +File, +End, +Out) replays the journal
+%   File up to End into a temporary module and writes the resulting
+%   clauses to Out.
+
+write_compacted(Module, File, End, Out) :-
+    in_temporary_module(
+        DB,
+        persistency:declare_replay_db(Module, DB),
+        persistency:replay_journal(Module, File, End, DB, Out)).
+
+:- public
+    declare_replay_db/2,
+    replay_journal/5.
+
+declare_replay_db(Module, DB) :-
+    forall(persistent(Module, Term, _Types),
+           ( functor(Term, Name, Arity),
+             dynamic(DB:Name/Arity)
+           )).
+
+replay_journal(Module, File, End, DB, Out) :-
+    setup_call_cleanup(
+        open_journal(File, In),
+        replay_journal(In, End, Module, DB),
+        close(In)),
+    forall(( persistent(Module, Term, _Types),
+             DB:Term
+           ),
+           write_action(Out, assert(Term))).
+
+replay_journal(In, End, Module, DB) :-
+    read_action(In, Action),
+    Action \== end_of_file,
+    stream_property(In, position(Pos)),
+    stream_position_data(byte_count, Pos, Here),
+    Here =< End,                        % action is before End
+    !,
+    (   Action = created(_)
+    ->  true
+    ;   replay_action(Action, Module, DB, _)
+    ),
+    replay_journal(In, End, Module, DB).
+replay_journal(_, _, _, _).
+
+%   switch_journal(+Module, +File, +End, +NewFile, +Write, +Commit)
+%   copies the actions from End in File  to NewFile and replaces File
+%   by NewFile.  Must be called with both mutexes locked.
+
+switch_journal(Module, File, End, NewFile, Write, Commit) :-
+    db_sync(Module, close),
+    setup_call_cleanup(
+        db_open_file(Module, NewFile, append, Out),
+        ( setup_call_cleanup(
+              open_journal(File, In),
+              copy_journal_tail(In, End, Out),
+              close(In)),
+          stream_property(Out, position(EndPos)),
+          '$sync_output'(Out)
+        ),
+        close(Out)),
+    setup_call_cleanup(
+        open_journal(NewFile, NewIn),
+        read_action(NewIn, created(Created)),
+        close(NewIn)),
+    retractall(db_file(Module, File, _, _, _)),
+    rename_file(NewFile, File),
+    time_file(File, Modified),
+    assert(db_file(Module, File, Created, Modified, EndPos)),
+    retractall(db_dirty(Module, _)),
+    journal_synced(Write, Commit),
+    debug(db, 'Compacted ~w', [File]).
+
+copy_journal_tail(In, End, Out) :-
+    seek(In, End, bof, _),
+    read_action(In, Action),
+    copy_actions(Action, In, Out).
+
+copy_actions(end_of_file, _, _) :- !.
+copy_actions(Action, In, Out) :-
+    write_action(Out, Action),
+    read_action(In, Next),
+    copy_actions(Next, In, Out).
+
+
 %!  db_sync_all(+What)
 %
 %   Sync all registered databases.
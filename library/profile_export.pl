@@ -0,0 +1,358 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(profile_export,
+          [ profile_folded/2,           % +Out, +Options
+            profile_pprof/2             % +Out, +Options
+          ]).
+:- autoload(library(apply), [maplist/3, foldl/4]).
+:- autoload(library(assoc), [list_to_assoc/2, get_assoc/3]).
+:- autoload(library(error), [must_be/2, domain_error/2]).
+:- autoload(library(lists), [member/2, reverse/2]).
+:- autoload(library(option), [option/3]).
+:- autoload(library(statistics), [sample_profile_data/1]).
+:- autoload(library(utf8), [utf8_codes//1]).
+
+/** <module> Export profiling data for external tools
+
+This library writes the data collected by the profiler in two formats
+that are understood by common performance tools:
+
+  - The _folded stacks_ format is a text format.  It has one line for
+    each call stack.  The line lists the predicates, separated by `;`,
+    followed by a space and the weight.  This is the input format of
+    flame graph generators.
+  - The _pprof_ format is the uncompressed Protocol Buffers encoding of
+    the `Profile` message, which is processed by `go tool pprof` and
+    similar tools.
+
+Both formats can be produced for the data of the call graph profiler
+(see profile/1) and for the sampling profiler (see sample_profiler/2).
+Call graph nodes that were created by foreign code using
+PL_register_profile_type() and PL_prof_call() appear in the stacks
+under the term that is produced by the `unify` function of their type.
+
+For the call graph, the weight of a stack is the time spent in the last
+node of the stack, excluding its children.  The pprof output also holds
+the number of calls of each node.  For the sampling profiler, the weight
+is the number of samples.  The pprof output also holds the time these
+samples represent.
+*/
+
+%!  profile_folded(+Out, +Options) is det.
+%
+%   Write profiling data in the folded stacks format.  Out is either a
+%   stream or a file name.  Options:
+%
+%     - source(+Source)
+%     One of `call_graph` (default) to export the data of the last
+%     run of profile/1 or `sample` to export the data of the sampling
+%     profiler.
+
+profile_folded(Out, Options) :-
+    profile_source(Options, Source),
+    profile_stacks(Source, Stacks),
+    with_profile_output(Out, text, write_folded(Stacks)).
+
+write_folded(Stacks, Out) :-
+    forall(( member(stack(Frames, [_, Weight]), Stacks),
+             Weight > 0
+           ),
+           ( maplist(frame_name, Frames, Names),
+             atomic_list_concat(Names, ;, Line),
+             format(Out, '~w ~d~n', [Line, Weight])
+           )).
+
+%!  profile_pprof(+Out, +Options) is det.
+%
+%   Write profiling data in the pprof format.  Out is either a stream,
+%   which must be binary, or a file name.  Options are the same as for
+%   profile_folded/2.
+
+profile_pprof(Out, Options) :-
+    profile_source(Options, Source),
+    profile_stacks(Source, Stacks),
+    phrase(pprof(Source, Stacks), Bytes),
+    with_profile_output(Out, binary, write_bytes(Bytes)).
+
+write_bytes(Bytes, Out) :-
+    maplist(put_byte(Out), Bytes).
+
+profile_source(Options, Source) :-
+    option(source(Source), Options, call_graph),
+    must_be(atom, Source),
+    (   profile_source(Source)
+    ->  true
+    ;   domain_error(profile_source, Source)
+    ).
+
+profile_source(call_graph).
+profile_source(sample).
+
+with_profile_output(Out, _Type, Goal) :-
+    is_stream(Out),
+    !,
+    call(Goal, Out).
+with_profile_output(File, Type, Goal) :-
+    setup_call_cleanup(
+        open(File, write, Out, [type(Type)]),
+        call(Goal, Out),
+        close(Out)).
+
+
+                 /*******************************
+                 *            STACKS            *
+                 *******************************/
+
+%!  profile_stacks(+Source, -Stacks) is det.
+%
+%   Stacks is a list of stack(Frames, [Count, Weight]), where Frames is
+%   a list of node identifiers, outermost first.
+
+profile_stacks(call_graph, Stacks) :-
+    setup_call_cleanup(
+        profiler(Old, false),
+        findall(stack(Frames, [Calls, Ticks]),
+                call_graph_stack(Frames, Calls, Ticks),
+                Stacks),
+        profiler(_, Old)).
+profile_stacks(sample, Stacks) :-
+    sample_profile_data(Samples),
+    findall(stack(Frames, [Count, Count]),
+            member(Count-Frames, Samples),
+            Stacks).
+
+call_graph_stack(Frames, Calls, Ticks) :-
+    '$prof_sibling_of'(Root, -),
+    call_graph_stack(Root, [], Frames, Calls, Ticks).
+
+call_graph_stack(Node, Parents, Frames, Calls, Ticks) :-
+    '$prof_node'(Node, Id, NodeCalls, _Redos, _Exits, _Recur,
+                 NodeTicks, _SiblingTicks),
+    Here = [Id|Parents],
+    (   reverse(Here, Frames),
+        Calls = NodeCalls,
+        Ticks = NodeTicks
+    ;   '$prof_sibling_of'(Child, Node),
+        call_graph_stack(Child, Here, Frames, Calls, Ticks)
+    ).
+
+frame_name(Frame, Name) :-
+    atom(Frame),
+    !,
+    Name = Frame.
+frame_name(Frame, Name) :-
+    format(atom(Name), '~q', [Frame]).
+
+
+                 /*******************************
+                 *             PPROF            *
+                 *******************************/
+
+%   The field numbers below refer to the `Profile` message defined in
+%   https://github.com/google/pprof/blob/master/proto/profile.proto
+
+pprof(Source, Stacks) -->
+    { sample_types(Source, Types, Period),
+      findall(F, (member(stack(Fs,_), Stacks), member(F, Fs)), Frames0),
+      sort(Frames0, Frames),
+      number_frames(Frames, 1, Numbered),
+      list_to_assoc(Numbered, FrameIds),
+      maplist(function_info, Numbered, Functions),
+      findall(S, pprof_string(Types, Period, Functions, S), Strings0),
+      sort([''|Strings0], Strings),       % '' must be first
+      number_frames(Strings, 0, NumberedStrings),
+      list_to_assoc(NumberedStrings, StringIds)
+    },
+    pprof_value_types(Types, StringIds),
+    pprof_samples(Stacks, Source, FrameIds),
+    pprof_locations(Numbered),
+    pprof_functions(Functions, StringIds),
+    pprof_strings(Strings),
+    pprof_duration(Source),
+    pprof_period(Period, StringIds).
+
+sample_types(call_graph, [calls-count, time-milliseconds], none).
+sample_types(sample, [samples-count, time-nanoseconds],
+             period(time-nanoseconds, Nanos)) :-
+    '$prof_sample_interval'(Interval, Interval),
+    Nanos is round(Interval*1.0e9).
+
+number_frames([], _, []).
+number_frames([H|T], I, [H-I|NT]) :-
+    I2 is I+1,
+    number_frames(T, I2, NT).
+
+function_info(Frame-Id, function(Id, Name, File, Line)) :-
+    frame_name(Frame, Name),
+    frame_source(Frame, File, Line).
+
+frame_source(M:Name/Arity, File, Line) :-
+    atom(M), atom(Name), integer(Arity),
+    functor(Head, Name, Arity),
+    predicate_property(M:Head, file(File)),
+    !,
+    (   predicate_property(M:Head, line_count(Line))
+    ->  true
+    ;   Line = 0
+    ).
+frame_source(_, '', 0).
+
+pprof_string(Types, _, _, S) :-
+    member(T-U, Types),
+    ( S = T ; S = U ).
+pprof_string(_, period(T-U, _), _, S) :-
+    ( S = T ; S = U ).
+pprof_string(_, _, Functions, S) :-
+    member(function(_, Name, File, _), Functions),
+    ( S = Name ; S = File ).
+
+pprof_value_types([], _) --> [].
+pprof_value_types([Type|Types], StringIds) -->
+    { value_type(Type, StringIds, Bytes) },
+    field_bytes(1, Bytes),
+    pprof_value_types(Types, StringIds).
+
+value_type(Type-Unit, StringIds, Bytes) :-
+    get_assoc(Type, StringIds, TypeId),
+    get_assoc(Unit, StringIds, UnitId),
+    phrase(( field_varint(1, TypeId),
+             field_varint(2, UnitId)
+           ), Bytes).
+
+pprof_samples([], _, _) --> [].
+pprof_samples([stack(Frames, Values0)|Stacks], Source, FrameIds) -->
+    { reverse(Frames, Leaf),
+      maplist(frame_id(FrameIds), Leaf, LocationIds),
+      sample_values(Source, Values0, Values),
+      phrase(( packed(1, LocationIds),
+               packed(2, Values)
+             ), Bytes)
+    },
+    field_bytes(2, Bytes),
+    pprof_samples(Stacks, Source, FrameIds).
+
+frame_id(FrameIds, Frame, Id) :-
+    get_assoc(Frame, FrameIds, Id).
+
+sample_values(call_graph, Values, Values).
+sample_values(sample, [Count, _], [Count, Nanos]) :-
+    '$prof_sample_interval'(Interval, Interval),
+    Nanos is round(Count*Interval*1.0e9).
+
+pprof_locations([]) --> [].
+pprof_locations([_-Id|T]) -->
+    { phrase(field_varint(1, Id), LineBytes),
+      phrase(( field_varint(1, Id),
+               field_bytes(4, LineBytes)
+             ), Bytes)
+    },
+    field_bytes(4, Bytes),
+    pprof_locations(T).
+
+pprof_functions([], _) --> [].
+pprof_functions([function(Id, Name, File, Line)|T], StringIds) -->
+    { get_assoc(Name, StringIds, NameId),
+      get_assoc(File, StringIds, FileId),
+      phrase(( field_varint(1, Id),
+               field_varint(2, NameId),
+               field_varint(3, NameId),
+               field_varint(4, FileId),
+               field_varint(5, Line)
+             ), Bytes)
+    },
+    field_bytes(5, Bytes),
+    pprof_functions(T, StringIds).
+
+pprof_strings([]) --> [].
+pprof_strings([S|T]) -->
+    { atom_codes(S, Codes),
+      phrase(utf8_codes(Codes), Bytes)
+    },
+    field_bytes(6, Bytes),
+    pprof_strings(T).
+
+pprof_duration(call_graph) -->
+    !,
+    { '$prof_statistics'(_Samples, _Ticks, _Account, Time, _Nodes),
+      Nanos is round(Time*1.0e9)
+    },
+    field_varint(10, Nanos).
+pprof_duration(_) -->
+    [].
+
+pprof_period(none, _) --> [].
+pprof_period(period(Type, Period), StringIds) -->
+    { value_type(Type, StringIds, Bytes) },
+    field_bytes(11, Bytes),
+    field_varint(12, Period).
+
+
+                 /*******************************
+                 *       PROTOCOL BUFFERS       *
+                 *******************************/
+
+field_varint(Field, Value) -->
+    { Key is Field << 3 },
+    varint(Key),
+    varint(Value).
+
+field_bytes(Field, Bytes) -->
+    { Key is Field << 3 \/ 2,
+      length(Bytes, Len)
+    },
+    varint(Key),
+    varint(Len),
+    list(Bytes).
+
+packed(Field, Values) -->
+    { foldl(varint_bytes, Values, Bytes, []) },
+    field_bytes(Field, Bytes).
+
+varint_bytes(Value, List, Tail) :-
+    varint(Value, List, Tail).
+
+varint(Value) -->
+    { Value < 0x80 },
+    !,
+    [Value].
+varint(Value) -->
+    { Byte is (Value /\ 0x7f) \/ 0x80,
+      Rest is Value >> 7
+    },
+    [Byte],
+    varint(Rest).
+
+list([]) --> [].
+list([H|T]) --> [H], list(T).
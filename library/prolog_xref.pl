@@ -37,6 +37,7 @@
 :- module(prolog_xref,
           [ xref_source/1,              % +Source
             xref_source/2,              % +Source, +Options
+            xref_sources/2,             % +Sources, +Options
             xref_called/3,              % ?Source, ?Callable, ?By
             xref_called/4,              % ?Source, ?Callable, ?By, ?Cond
             xref_called/5,              % ?Source, ?Callable, ?By, ?Cond, ?Line
@@ -75,7 +76,7 @@
 :- autoload(library(lists),[member/2,append/2,append/3,select/3]).
 :- autoload(library(modules),[in_temporary_module/3]).
 :- autoload(library(operators),[push_op/3]).
-:- autoload(library(option),[option/2,option/3]).
+:- autoload(library(option),[option/2,option/3,select_option/4]).
 :- autoload(library(ordsets),[ord_intersect/2,ord_intersection/3]).
 :- autoload(library(prolog_source),
 	    [ prolog_canonical_source/2,
@@ -85,6 +86,7 @@
 	    ]).
 :- autoload(library(shlib),[current_foreign_library/2]).
 :- autoload(library(solution_sequences),[distinct/2,limit/2]).
+:- autoload(library(thread),[concurrent/3]).
 
 :- if(exists_source(library(pldoc))).
 :- use_module(library(pldoc), []).      % Must be loaded before doc_process
@@ -98,6 +100,10 @@
                        comments(oneof([store,collect,ignore])),
                        process_include(boolean)
                      ]).
+:- predicate_options(xref_sources/2, 2,
+                     [ threads(positive_integer),
+                       pass_to(xref_source/2, 2)
+                     ]).
 
 
 :- dynamic
@@ -116,6 +122,7 @@
     uses_file/3,                    % Spec, Src, Path
     xop/2,                          % Src, Op
     source/2,                       % Src, Time
+    source_digest/2,                % Src, Digest
     used_class/2,                   % Name, Src
     defined_class/5,                % Name, Super, Summary, Src, Line
     (mode)/2,                       % Mode, Src
@@ -300,6 +307,12 @@ verbose(Src) :-
 %     * process_include(+Boolean)
 %     Process the content of included files (default is `true`).
 %
+%   If Source is a file whose modification time  has changed, but whose
+%   content and Options are the same as when it was processed, only the
+%   recorded modification time is updated. This avoids re-processing
+%   files that are merely touched, for example by a version control
+%   system.
+%
 %   @param Source   File specification or XPCE buffer
 
 xref_source(Source) :-
@@ -310,6 +323,15 @@ xref_source(Source, Options) :-
     (   last_modified(Source, Modified)
     ->  (   source(Src, Modified)
         ->  true
+        ;   content_digest(Source, Options, Digest)
+        ->  (   source_digest(Src, Digest)
+            ->  retractall(source(Src, _)),
+                assert(source(Src, Modified))
+            ;   xref_clean(Src),
+                assert(source(Src, Modified)),
+                assert(source_digest(Src, Digest)),
+                do_xref(Src, Options)
+            )
         ;   xref_clean(Src),
             assert(source(Src, Modified)),
             do_xref(Src, Options)
@@ -327,6 +349,27 @@ do_xref(Src, Options) :-
         collect(Src, Src, In, Options),
         xref_cleanup(State)).
 
+%!  xref_sources(+Sources, +Options) is det.
+%
+%   Run xref_source/2 on each  element  of   the  list  Sources, using
+%   multiple threads. Options are passed to xref_source/2, except for
+%
+%     * threads(+Count)
+%     Number of threads to use.  Default is the Prolog flag
+%     `cpu_count`.
+%
+%   Sources are processed in parallel  and   thus  should  not depend on
+%   each other through the operators they  define.   If  an error occurs,
+%   the remaining sources are not processed and the error is re-thrown.
+
+xref_sources(Sources, Options) :-
+    must_be(list, Sources),
+    current_prolog_flag(cpu_count, Default),
+    select_option(threads(Threads), Options, XrefOptions, Default),
+    must_be(positive_integer, Threads),
+    findall(xref_source(Source, XrefOptions), member(Source, Sources), Goals),
+    concurrent(Threads, Goals, []).
+
 last_modified(Source, Modified) :-
     prolog:xref_source_time(Source, Modified),
     !.
@@ -336,6 +379,22 @@ last_modified(Source, Modified) :-
     exists_file(Source),
     time_file(Source, Modified).
 
+%!  content_digest(+Source, +Options, -Digest) is semidet.
+%
+%   Digest is a hash of the content of  the file Source and the Options
+%   used to process it. Fails if Source is not a plain file.
+
+content_digest(Source, Options, Digest) :-
+    atom(Source),
+    \+ prolog:xref_source_time(Source, _),
+    \+ is_global_url(Source),
+    catch(setup_call_cleanup(
+              open(Source, read, In, [type(binary)]),
+              read_string(In, _, Content),
+              close(In)),
+          error(_,_), fail),
+    variant_sha1(Content-Options, Digest).
+
 is_global_url(File) :-
     sub_atom(File, B, _, _, '://'),
     !,
@@ -521,6 +580,7 @@ xref_clean(Source) :-
     retractall(xoption(Src, _)),
     retractall(xflag(_Name, _Value, Src, Line)),
     retractall(source(Src, _)),
+    retractall(source_digest(Src, _)),
     retractall(used_class(_, Src)),
     retractall(defined_class(_, _, _, Src, _)),
     retractall(mode(_, Src)),
@@ -1263,6 +1323,8 @@ xref_meta(setup_call_cleanup(A, B, C),[A, B, C]).
 xref_meta(setup_call_catcher_cleanup(A, B, _, C),[A, B, C]).
 xref_meta(call_residue_vars(A,_), [A]).
 xref_meta(with_mutex(_,A),      [A]).
+xref_meta(with_read_lock(_,A),  [A]).
+xref_meta(with_write_lock(_,A), [A]).
 xref_meta(assume(G),            [G]).   % library(debug)
 xref_meta(assertion(G),         [G]).   % library(debug)
 xref_meta(freeze(_, G),         [G]).
@@ -124,9 +124,23 @@ phrase_from_file(Grammar, File) :-
 phrase_from_file(Grammar, File, Options) :-
     setup_call_cleanup(
         open(File, read, In, Options),
-        phrase_from_stream(Grammar, In),
+        ( lazy_input_buffer(In),
+          phrase_from_stream(Grammar, In)
+        ),
         close(In)).
 
+%   The lazy list is extended with the content of the input buffer.
+%   As we own the stream, use a large buffer to reduce the number of
+%   extensions.
+
+lazy_input_buffer(In) :-
+    (   stream_property(In, buffer(full)),
+        stream_property(In, buffer_size(Size)),
+        Size < 65536
+    ->  set_stream(In, buffer_size(65536))
+    ;   true
+    ).
+
 %!  phrase_from_stream(:Grammar, +Stream)
 %
 %   Run Grammer against the character codes   on Stream. Stream must
@@ -93,6 +93,14 @@ save_option(foreign,     qsave_foreign_option,
             "Include foreign code in state").
 save_option(obfuscate,   boolean,
             "Obfuscate identifiers").
+save_option(jit_indexes, boolean,
+            "Save and recreate existing JIT indexes").
+save_option(lazy_load,   boolean,
+            "Load static predicates on first use").
+save_option(lazy_load_threads, nonneg,
+            "Threads for loading lazy predicates in the background").
+save_option(checkpoint,  boolean,
+            "Save the initialized state without its after_load goals").
 save_option(verbose,     boolean,
             "Be more verbose about the state creation").
 save_option(undefined,   oneof([ignore,error]),
@@ -508,7 +516,8 @@ lock_files(_) :-
 %
 %   Save the program itself as virtual machine code to Zipper.
 
-save_program(RC, SaveClass, Options) :-
+save_program(RC, SaveClass, Options0) :-
+    checkpoint_options(Options0, Options),
     zipper_open_new_file_in_zip(RC, '$prolog/state.qlf', StateFd, []),
     setup_call_cleanup(
         ( current_prolog_flag(access_level, OldLevel),
@@ -516,14 +525,16 @@ save_program(RC, SaveClass, Options) :-
           '$open_wic'(StateFd, Options)
         ),
         ( create_mapping(Options),
-          save_modules(SaveClass),
+          save_modules(SaveClass, Options),
           save_records,
           save_flags,
           save_prompt,
           save_imports,
           save_prolog_flags,
+          save_global_variables(Options),
           save_operators(Options),
-          save_format_predicates
+          save_format_predicates,
+          save_lazy_loaders(Options)
         ),
         ( '$close_wic',
           set_prolog_flag(access_level, OldLevel)
@@ -535,11 +546,11 @@ save_program(RC, SaveClass, Options) :-
                  *            MODULES           *
                  *******************************/
 
-save_modules(SaveClass) :-
+save_modules(SaveClass, Options) :-
     forall(special_module(X),
-           save_module(X, SaveClass)),
+           save_module(X, SaveClass, Options)),
     forall((current_module(X), \+ special_module(X)),
-           save_module(X, SaveClass)).
+           save_module(X, SaveClass, Options)).
 
 special_module(system).
 special_module(user).
@@ -633,31 +644,31 @@ save_autoload(_).
                  *             MODULES          *
                  *******************************/
 
-%!  save_module(+Module, +SaveClass)
+%!  save_module(+Module, +SaveClass, +Options)
 %
 %   Saves a module
 
-save_module(M, SaveClass) :-
+save_module(M, SaveClass, Options) :-
     '$qlf_start_module'(M),
     feedback('~n~nMODULE ~w~n', [M]),
     save_unknown(M),
     (   P = (M:_H),
         current_predicate(_, P),
         \+ predicate_property(P, imported_from(_)),
-        save_predicate(P, SaveClass),
+        save_predicate(P, SaveClass, Options),
         fail
     ;   '$qlf_end_part',
         feedback('~n', [])
     ).
 
-save_predicate(P, _SaveClass) :-
+save_predicate(P, _SaveClass, _Options) :-
     predicate_property(P, foreign),
     !,
     P = (M:H),
     functor(H, Name, Arity),
     feedback('~npre-defining foreign ~w/~d ', [Name, Arity]),
     '$add_directive_wic'('$predefine_foreign'(M:Name/Arity)).
-save_predicate(P, SaveClass) :-
+save_predicate(P, SaveClass, Options) :-
     P = (M:H),
     functor(H, F, A),
     feedback('~nsaving ~w/~d ', [F, A]),
@@ -678,6 +689,7 @@ save_predicate(P, SaveClass) :-
     ;   save_attributes(P),
         \+ predicate_property(P, (volatile)),
         (   nth_clause(P, _, Ref),
+            \+ skip_clause(P, Ref, Options),
             feedback('.', []),
             '$qlf_assert_clause'(Ref, SaveClass),
             fail
@@ -690,6 +702,19 @@ no_save(P) :-
     \+ predicate_property(P, dynamic),
     \+ predicate_property(P, multifile).
 
+%!  skip_clause(+Pred, +ClauseRef, +Options) is semidet.
+%
+%   True if the clause must not be saved.   If `checkpoint(true)` is
+%   given, the goals of initialization/1 have been executed and their
+%   effect is part of the saved database.  We therefore do not save
+%   them, so they are not executed again when the state is restored.
+
+skip_clause(system:'$init_goal'(_,_,_), Ref, Options) :-
+    option(checkpoint(true), Options),
+    clause(system:'$init_goal'(Source, _, _), true, Ref),
+    atom(Source),
+    Source \== (-).
+
 pred_attrib(meta_predicate(Term), Head, meta_predicate(M:Term)) :-
     !,
     strip_module(Head, M, _).
@@ -765,6 +790,37 @@ save_records :-
                  *            FLAGS             *
                  *******************************/
 
+%!  save_global_variables(+Options) is det.
+%
+%   If `checkpoint(true)` is given,  save   the  non-backtrackable global
+%   variables (see nb_setval/2). Values that cannot be represented in a
+%   state, i.e., cyclic terms, terms with attributed variables or terms
+%   holding blobs such as streams, are not saved.
+
+save_global_variables(Options) :-
+    option(checkpoint(true), Options),
+    !,
+    feedback('~nGLOBAL VARIABLES~n', []),
+    (   nb_current(Key, Value),
+        \+ sub_atom(Key, 0, _, _, '$'),
+        (   savable_value(Value)
+        ->  feedback('~n~t~8|~w ', [Key]),
+            '$add_directive_wic'(nb_setval(Key, Value))
+        ;   feedback('~n~t~8|~w (not saved)', [Key])
+        ),
+        fail
+    ;   true
+    ).
+save_global_variables(_).
+
+savable_value(Value) :-
+    acyclic_term(Value),
+    term_attvars(Value, []),
+    \+ ( sub_term(Sub, Value),
+          blob(Sub, Type),
+          Type \== text
+        ).
+
 save_flags :-
     feedback('~nFLAGS~n~n', []),
     (   current_flag(X),
@@ -903,6 +959,55 @@ save_format_predicates :-
     fail.
 save_format_predicates.
 
+%!  checkpoint_options(+Options0, -Options) is det.
+%
+%   A checkpoint saves the existing JIT indexes   unless  this is
+%   explicitly disabled.
+
+checkpoint_options(Options0, Options) :-
+    option(checkpoint(true), Options0),
+    \+ option(jit_indexes(_), Options0),
+    !,
+    Options = [jit_indexes(true)|Options0].
+checkpoint_options(Options, Options).
+
+
+                 /*******************************
+                 *         LAZY LOADING         *
+                 *******************************/
+
+%!  save_lazy_loaders(+Options) is det.
+%
+%   If `lazy_load(true)` and `lazy_load_threads(Count)` with Count > 0
+%   are given, add a directive that starts threads that decode the
+%   remaining lazy predicates in the background after the state is
+%   loaded.
+
+save_lazy_loaders(Options) :-
+    option(lazy_load(true), Options),
+    option(lazy_load_threads(Max), Options, 0),
+    Max > 0,
+    current_prolog_flag(threads, true),
+    !,
+    D = qsave:start_lazy_loaders(Max),
+    feedback('~nLAZY LOADING~n~t~8|~w ', [D]),
+    '$add_directive_wic'(D).
+save_lazy_loaders(_).
+
+%!  start_lazy_loaders(+Max) is det.
+%
+%   Start at most Max detached threads that load lazy predicates. We
+%   use no  more  threads  than  the   number  of  CPUs  minus one,
+%   leaving the main thread its own core.
+
+start_lazy_loaders(Max) :-
+    current_prolog_flag(cpu_count, CPUs),
+    N is min(Max, CPUs-1),
+    forall(between(1, N, _),
+           thread_create('$load_lazy_definitions'(_), _,
+                         [ detached(true)
+                         ])).
+
 qualify_head(T, T) :-
     functor(T, :, 2),
     !.
@@ -0,0 +1,163 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(read_parallel,
+          [ read_terms_parallel/3       % +File, -Terms, :Options
+          ]).
+:- autoload(library(apply), [maplist/4]).
+:- autoload(library(error), [must_be/2]).
+:- autoload(library(lists), [append/2]).
+:- autoload(library(option), [option/2, option/3, select_option/4]).
+:- autoload(library(thread), [concurrent/3]).
+
+:- meta_predicate
+    read_terms_parallel(+, -, :).
+
+/** <module> Read terms from a large file using multiple threads
+
+This library reads all terms from a file that holds a large number of
+clauses, typically facts, by parsing parts of the file concurrently.
+
+The file is first split into chunks that start and end at a clause
+boundary.  Finding these boundaries only requires a fast scan that
+tracks quoted text and comments rather than a full parse.  The chunks
+are then parsed by worker threads using read_term/3 and the results
+are concatenated in file order.
+
+Directives in the file are returned as terms and not executed.  In
+particular, op/3 directives do not affect the remainder of the file,
+which is parsed using the operators of the module in which
+read_terms_parallel/3 is called or given by the module(M) option.
+*/
+
+%!  read_terms_parallel(+File, -Terms, :Options) is det.
+%
+%   Terms is a list of all terms in File in the order in which they
+%   appear.  Options are passed to read_term/3, except for:
+%
+%     - threads(+Count)
+%       Number of worker threads.  Default is the Prolog flag
+%       `cpu_count`.
+%     - chunks(+Count)
+%       Number of chunks in which the file is split.  Default is
+%       four times the number of threads to balance the load.
+%     - encoding(+Encoding)
+%       Encoding of File.  Default is `utf8`.  Only encodings for
+%       which all bytes below 128 represent ASCII characters can be
+%       used, i.e., not the UTF-16 encodings.
+%
+%   Read options that describe a single term such as variable_names/1
+%   should not be used.  Files smaller than 64Kb are read sequentially.
+
+read_terms_parallel(File, Terms, M:Options) :-
+    current_prolog_flag(cpu_count, CPUs),
+    select_option(threads(Threads), Options, Options1, CPUs),
+    must_be(positive_integer, Threads),
+    DefChunks is Threads*4,
+    select_option(chunks(Chunks), Options1, Options2, DefChunks),
+    must_be(positive_integer, Chunks),
+    select_option(encoding(Enc), Options2, Options3, utf8),
+    (   option(module(_), Options3)
+    ->  ReadOptions = Options3
+    ;   ReadOptions = [module(M)|Options3]
+    ),
+    absolute_file_name(File, Path, [access(read)]),
+    size_file(Path, Size),
+    (   ( Threads == 1 ; Chunks == 1 ; Size < 65536 )
+    ->  Ranges = [0-inf]
+    ;   chunk_ranges(Path, Size, Chunks, Ranges)
+    ),
+    maplist(chunk_goal(Path, Enc, ReadOptions), Ranges, Goals, TermLists),
+    concurrent(Threads, Goals, []),
+    append(TermLists, Terms).
+
+chunk_goal(Path, Enc, ReadOptions, From-To,
+           read_chunk(Path, Enc, ReadOptions, From, To, Terms),
+           Terms).
+
+%!  chunk_ranges(+Path, +Size, +Chunks, -Ranges) is det.
+%
+%   Split the file into at most Chunks ranges From-To, where From and
+%   To are byte offsets at clause boundaries.
+
+chunk_ranges(Path, Size, Chunks, Ranges) :-
+    ChunkSize is Size//Chunks,
+    findall(Offset,
+            ( between(1, Chunks, I),
+              I < Chunks,
+              Offset is I*ChunkSize
+            ),
+            Offsets),
+    setup_call_cleanup(
+        open(Path, read, In, [type(binary)]),
+        '$clause_boundaries'(In, Offsets, Boundaries0),
+        close(In)),
+    sort(Boundaries0, Boundaries),
+    ranges(Boundaries, 0, Ranges).
+
+ranges([], From, [From-inf]).
+ranges([To|T], From, [From-To|Ranges]) :-
+    ranges(T, To, Ranges).
+
+%!  read_chunk(+Path, +Encoding, +ReadOptions, +From, +To, -Terms)
+%
+%   Read the terms between the byte offsets From and To.  As To is at
+%   a clause boundary, we can stop if the stream is at or beyond To
+%   after reading a term.  Only the first chunk may start with a BOM.
+
+read_chunk(Path, Enc, ReadOptions, 0, To, Terms) :-
+    !,
+    setup_call_cleanup(
+        open(Path, read, In, [encoding(Enc)]),
+        read_chunk_terms(In, To, ReadOptions, Terms),
+        close(In)).
+read_chunk(Path, Enc, ReadOptions, From, To, Terms) :-
+    setup_call_cleanup(
+        open(Path, read, In, [encoding(Enc), bom(false)]),
+        ( seek(In, From, bof, _),
+          read_chunk_terms(In, To, ReadOptions, Terms)
+        ),
+        close(In)).
+
+read_chunk_terms(In, To, ReadOptions, Terms) :-
+    read_term(In, Term, ReadOptions),
+    (   Term == end_of_file
+    ->  Terms = []
+    ;   Terms = [Term|Tail],
+        byte_count(In, Here),
+        (   Here >= To
+        ->  Tail = []
+        ;   read_chunk_terms(In, To, ReadOptions, Tail)
+        )
+    ).
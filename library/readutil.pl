@@ -42,6 +42,7 @@
             read_file_to_codes/3,       % +File, -Codes, +Options
 
             read_line_to_string/2,      % +Stream, -Line (without trailing \n)
+            write_lines/2,              % +Stream, +Lines
             read_file_to_string/3,      % +File, -Codes, +Options
 
             read_file_to_terms/3        % +File, -Terms, +Options
@@ -117,22 +118,7 @@ link_foreign :-
 %   character.
 
 pl_read_line_to_codes(Stream, Codes) :-
-    get_code(Stream, C0),
-    (   C0 == -1
-    ->  Codes0 = end_of_file
-    ;   read_1line_to_codes(C0, Stream, Codes0)
-    ),
-    Codes = Codes0.
-
-read_1line_to_codes(-1, _, []) :- !.
-read_1line_to_codes(10, _, []) :- !.
-read_1line_to_codes(13, Stream, L) :-
-    !,
-    get_code(Stream, C2),
-    read_1line_to_codes(C2, Stream, L).
-read_1line_to_codes(C, Stream, [C|T]) :-
-    get_code(Stream, C2),
-    read_1line_to_codes(C2, Stream, T).
+    '$read_line_to_codes'(Stream, Codes).
 
 %!  read_line_to_codes(+Stream, -Line, ?Tail) is det.
 %
@@ -157,17 +143,7 @@ read_1line_to_codes(C, Stream, [C|T]) :-
 %   ```
 
 pl_read_line_to_codes(Stream, Codes, Tail) :-
-    get_code(Stream, C0),
-    read_line_to_codes(C0, Stream, Codes0, Tail),
-    Codes = Codes0.
-
-read_line_to_codes(-1, _, Tail, Tail) :-
-    !,
-    Tail = [].
-read_line_to_codes(10, _, [10|Tail], Tail) :- !.
-read_line_to_codes(C, Stream, [C|T], Tail) :-
-    get_code(Stream, C2),
-    read_line_to_codes(C2, Stream, T, Tail).
+    '$read_line_to_codes'(Stream, Codes, Tail).
 
 
 %!  read_line_to_string(+Stream, -String) is det.
@@ -188,6 +164,16 @@ read_line_to_string(Stream, String) :-
     ;   String = String0
     ).
 
+%!  write_lines(+Stream, +Lines:list) is det.
+%
+%   Write each element of Lines to Stream, followed by a newline. The
+%   elements are text: atoms, strings, code lists or character lists.
+%   This is the output counterpart  of   read_line_to_string/2  and is
+%   considerably faster than calling format/3 for each line.
+
+write_lines(Stream, Lines) :-
+    '$write_lines'(Stream, Lines).
+
 
                  /*******************************
                  *     STREAM (ENTIRE INPUT)    *
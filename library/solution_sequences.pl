@@ -46,9 +46,7 @@
 :- autoload(library(apply),[maplist/3]).
 :- autoload(library(error),
 	    [domain_error/2,must_be/2,instantiation_error/1]).
-:- autoload(library(lists),[reverse/2,member/2]).
-:- autoload(library(nb_set),
-	    [empty_nb_set/1,add_nb_set/3,size_nb_set/2]).
+:- autoload(library(lists),[reverse/2,member/2,append/3]).
 :- autoload(library(option),[option/3]).
 :- autoload(library(ordsets),[ord_subtract/3]).
 
@@ -145,15 +143,18 @@ b(X)) and the ones using this library side-by-side.
 %         list_to_set(List, Set),
 %         member(Goal, Set).
 %     ==
+%
+%   The answers seen so far are kept in a native hash map (see
+%   hash_map_create/1).
 
 distinct(Goal) :-
     distinct(Goal, Goal).
 distinct(Witness, Goal) :-
     term_variables(Witness, Vars),
     Witness1 =.. [v|Vars],
-    empty_nb_set(Set),
+    hash_map_create(Set),
     call(Goal),
-    add_nb_set(Witness1, Set, true).
+    '$hash_map_add_variant'(Set, Witness1).
 
 %!  reduced(:Goal).
 %!  reduced(?Witness, :Goal, +Options).
@@ -176,17 +177,17 @@ reduced(Witness, Goal, Options) :-
     option(size_limit(SizeLimit), Options, 10_000),
     term_variables(Witness, Vars),
     Witness1 =.. [v|Vars],
-    empty_nb_set(Set),
+    hash_map_create(Set),
     State = state(Set),
     call(Goal),
     reduced_(State, Witness1, SizeLimit).
 
 reduced_(State, Witness1, SizeLimit) :-
     arg(1, State, Set),
-    add_nb_set(Witness1, Set, true),
-    size_nb_set(Set, Size),
+    '$hash_map_add_variant'(Set, Witness1),
+    hash_map_size(Set, Size),
     (   Size > SizeLimit
-    ->  empty_nb_set(New),
+    ->  hash_map_create(New),
         nb_setarg(1, State, New)
     ;   true
     ).
@@ -198,6 +199,10 @@ reduced_(State, Witness1, SizeLimit) :-
 %   at most Count solutions. Solutions are  returned as soon as they
 %   become  available.
 %
+%   If Goal is order_by/2, the limit  is  pushed into the ordering: only
+%   the best Count solutions are kept while  Goal is enumerated, rather
+%   than materialising and sorting all of them.
+%
 %   @arg Count is either `infinite`, making this predicate equivalent to
 %   call/1 or an  integer.  If  _|Count   <  1|_  this  predicate  fails
 %   immediately.
@@ -206,6 +211,12 @@ limit(Count, Goal) :-
     Count == infinite,
     !,
     call(Goal).
+limit(Count, Goal) :-
+    integer(Count),
+    order_by_goal(Goal, Spec, OrderGoal),
+    !,
+    Count > 0,
+    limit_order_by(Count, Spec, OrderGoal).
 limit(Count, Goal) :-
     Count > 0,
     State = count(0),
@@ -284,6 +295,12 @@ call_nth(_Goal, Bad) :-
 %   are _copied_.
 
 order_by(Spec, Goal) :-
+    order_template(Spec, Goal, RevWitnesses, Template),
+    findall(Template, Goal, Results),
+    order(RevWitnesses, 2, Results, OrderedResults),
+    member(Template, OrderedResults).
+
+order_template(Spec, Goal, RevWitnesses, Template) :-
     must_be(list, Spec),
     non_empty_list(Spec),
     maplist(order_witness, Spec, Witnesses0),
@@ -291,10 +308,64 @@ order_by(Spec, Goal) :-
     non_witness_template(Goal, Witnesses, Others),
     reverse(Witnesses, RevWitnesses),
     maplist(x_vars, RevWitnesses, WitnessVars),
-    Template =.. [v,Others|WitnessVars],
-    findall(Template, Goal, Results),
-    order(RevWitnesses, 2, Results, OrderedResults),
-    member(Template, OrderedResults).
+    Template =.. [v,Others|WitnessVars].
+
+%!  limit_order_by(+Count, +Spec, :Goal)
+%
+%   As limit(Count, order_by(Spec, Goal)). New   solutions are collected
+%   in a buffer. If the buffer is full it   is merged with the best Count
+%   solutions found so far and  sorted,  after   which  only  the best
+%   Count solutions are kept. All sorts are  stable and older solutions
+%   precede newer ones, so the result  is   the  same  as taking the
+%   first Count solutions of the complete ordered sequence.
+
+limit_order_by(Count, Spec, Goal) :-
+    order_template(Spec, Goal, RevWitnesses, Template),
+    BufSize is max(Count, 1000),
+    State = top([], [], 0),
+    (   call(Goal),
+        duplicate_term(Template, Copy),
+        arg(2, State, Buf0),
+        nb_linkarg(2, State, [Copy|Buf0]),
+        arg(3, State, N0),
+        N is N0+1,
+        (   N >= BufSize
+        ->  prune_top(State, RevWitnesses, Count)
+        ;   nb_setarg(3, State, N)
+        ),
+        fail
+    ;   prune_top(State, RevWitnesses, Count),
+        arg(1, State, Results),
+        member(Template, Results)
+    ).
+
+prune_top(State, RevWitnesses, Count) :-
+    arg(1, State, Best),
+    arg(2, State, Buf),
+    reverse(Buf, New),
+    append(Best, New, All),
+    order(RevWitnesses, 2, All, Ordered),
+    first_n(Count, Ordered, Top),
+    nb_setarg(1, State, Top),
+    nb_setarg(2, State, []),
+    nb_setarg(3, State, 0).
+
+order_by_goal(Goal0, Spec, M:Goal) :-
+    strip_module(Goal0, M, Plain),
+    nonvar(Plain),
+    Plain = order_by(Spec, Goal),
+    predicate_property(M:order_by(_,_),
+                       implementation_module(solution_sequences)).
+
+first_n(N, List, Prefix) :-
+    (   N =:= 0
+    ->  Prefix = []
+    ;   List = [H|T]
+    ->  Prefix = [H|PT],
+        N1 is N-1,
+        first_n(N1, T, PT)
+    ;   Prefix = []
+    ).
 
 order([], _, Results, Results).
 order([H|T], N, Results0, Results) :-
@@ -35,8 +35,13 @@
 
 :- module(sort,
           [ predsort/3,                 % :Compare, +List, -Sorted
-            locale_sort/2               % +ListOfAtoms, -Sorted
+            locale_sort/2,              % +ListOfAtoms, -Sorted
+            parallel_sort/4,            % +Key, +Order, +List, -Sorted
+            parallel_sort/5             % +Key, +Order, +List, -Sorted, +Opts
           ]).
+:- autoload(library(lists),[append/2,append/3]).
+:- autoload(library(option),[option/2]).
+:- autoload(library(thread),[concurrent_maplist/3]).
 
 :- set_prolog_flag(generate_debug_info, false).
 
@@ -114,3 +119,57 @@ collation_keys([H|T0], [K-H|T]) :-
 unkey([], []).
 unkey([_-H|T0], [H|T]) :-
     unkey(T0, T).
+
+
+%!  parallel_sort(+Key, +Order, +List, -Sorted) is det.
+%!  parallel_sort(+Key, +Order, +List, -Sorted, +Options) is det.
+%
+%   Same as sort/4, but sorting large lists using multiple threads.  The
+%   list is split into one chunk per worker.  The chunks are sorted using
+%   concurrent_maplist/3 and the concatenation of the sorted chunks is
+%   sorted using sort/4.  This final sort is  a merge because sort/4
+%   uses a natural merge sort that exploits the sorted runs.  The result
+%   is the same as the result of sort/4,   including  the order of
+%   elements that compare equal.  Options:
+%
+%     - workers(+Count)
+%       Number of chunks.  Default is the Prolog flag `cpu_count`.
+%     - min_chunk_size(+Size)
+%       Minimal number of elements in a chunk.  Default is 100,000.
+%
+%   If List is not a ground proper list  or   too short to create two
+%   chunks this predicate simply calls sort/4:   the  copies of variables that are
+%   sorted in another thread may be ordered differently.  Note that
+%   sorting the chunks requires copying them to   the worker threads and
+%   copying the results back.
+
+parallel_sort(Key, Order, List, Sorted) :-
+    parallel_sort(Key, Order, List, Sorted, []).
+
+parallel_sort(Key, Order, List, Sorted, Options) :-
+    '$skip_list'(Len, List, Tail),
+    (   current_prolog_flag(cpu_count, Cores)
+    ->  true
+    ;   Cores = 1
+    ),
+    option(workers(Workers), Options, Cores),
+    option(min_chunk_size(MinSize), Options, 100000),
+    Chunks is min(Workers, Len//max(1,MinSize)),
+    (   Chunks > 1,
+        Tail == [],
+        ground(List)
+    ->  ChunkSize is (Len+Chunks-1)//Chunks,
+        sort_chunks(List, ChunkSize, ChunkList),
+        concurrent_maplist(sort(Key, Order), ChunkList, SortedChunks),
+        append(SortedChunks, Runs),
+        sort(Key, Order, Runs, Sorted)
+    ;   sort(Key, Order, List, Sorted)
+    ).
+
+sort_chunks([], _, []) :- !.
+sort_chunks(List, Size, [Chunk|Chunks]) :-
+    length(Chunk, Size),
+    append(Chunk, Rest, List),
+    !,
+    sort_chunks(Rest, Size, Chunks).
+sort_chunks(List, _, [List]).
@@ -38,19 +38,40 @@
           [ statistics/0,
             statistics/1,               % -Stats
             thread_statistics/2,        % ?Thread, -Stats
+            thread_statistics_snapshot/1, % -ListOfStats
+            runtime_metrics/1,          % -Metrics
+            write_runtime_metrics/1,    % +Stream
             time/1,                     % :Goal
             profile/1,                  % :Goal
             profile/2,                  % :Goal, +Options
             show_profile/1,             % +Options
             profile_data/1,             % -Dict
-            profile_procedure_data/2    % :PI, -Data
+            profile_procedure_data/2,   % :PI, -Data
+            sample_profiler/2,          % +Thread, +Bool
+            sample_profiler/3,          % +Thread, +Bool, +Options
+            sample_profile_data/1,      % -Stacks
+            sample_profile_data/2,      % -Stacks, +Options
+            write_folded_profile/1,     % +Stream
+            reset_sample_profile/0,
+            alloc_profile/1,            % :Goal
+            alloc_profile/2,            % :Goal, +Options
+            alloc_profiler/2,           % -Old, +New
+            alloc_profile_data/2,       % +Area, -Stacks
+            show_alloc_profile/1,       % +Options
+            reset_alloc_profile/0,
+            call_counting/2,            % :Pred, +Bool
+            call_counts/2,              % :Pred, -Counts
+            predicate_memory/2,         % :Pred, -Memory
+            show_predicate_memory/1     % +Options
           ]).
 :- autoload(library(error),[must_be/2]).
-:- autoload(library(lists),[append/3,member/2]).
+:- autoload(library(lists),
+	    [append/3,member/2,nth1/3,reverse/2,sum_list/2]).
+:- autoload(library(apply),[maplist/3,foldl/4]).
 :- autoload(library(option),[option/3]).
 :- autoload(library(pairs),[map_list_to_pairs/3,pairs_values/2]).
 :- autoload(library(prolog_code),
-	    [predicate_sort_key/2,predicate_label/2]).
+	    [predicate_sort_key/2,predicate_label/2,pi_head/2]).
 
 
 :- set_prolog_flag(generate_debug_info, false).
@@ -59,7 +80,12 @@
     time(0),
     profile(0),
     profile(0, +),
-    profile_procedure_data(:, -).
+    alloc_profile(0),
+    alloc_profile(0, +),
+    profile_procedure_data(:, -),
+    call_counting(:, +),
+    call_counts(:, -),
+    predicate_memory(:, -).
 
 /** <module> Get information about resource usage
 
@@ -242,22 +268,76 @@ engine_counts --> [].
 %   Obtain statistical information about a single thread.  Fails
 %   silently of the Thread is no longer alive.
 %
-%   @arg    Stats is a dict containing status, time and stack-size
-%           information about Thread.
+%   @arg    Stats is a dict containing status, time, heap allocation
+%           and stack-size information about Thread.  The time
+%           dict contains the CPU time as well as the time spent
+%           in garbage collection, atom garbage collection and
+%           waiting for mutexes and message queues.
 
 thread_statistics(Thread, Stats) :-
     thread_property(Thread, status(Status)),
     human_thread_id(Thread, Id),
     Error = error(_,_),
-    (   catch(thread_stats(Thread, Stacks, Time), Error, fail)
+    (   catch(thread_stats(Thread, Stacks, Time, Heap), Error, fail)
     ->  Stats = thread{id:Id,
                        status:Status,
                        time:Time,
+                       heap_allocated:Heap,
                        stacks:Stacks}
     ;   Stats = thread{id:Thread,
                        status:Status}
     ).
 
+%!  thread_statistics_snapshot(-Stats:list(dict)) is det.
+%
+%   Stats is a list holding the   result of thread_statistics/2 for
+%   all threads.  This is intended  for   monitoring  tools that
+%   periodically collect the resource usage of all threads.
+
+thread_statistics_snapshot(Stats) :-
+    findall(S, thread_statistics(_, S), Stats).
+
+%!  runtime_metrics(-Metrics:list) is det.
+%
+%   Metrics is a list of metric(Name, Type, Help, Value) describing the
+%   runtime system.  Type is one of `counter` or `histogram`.  All
+%   values are totals since the process was started.  The value of a
+%   counter is an integer.  The value of a histogram is a term
+%   histogram(Count, Sum, Buckets), where Sum is the sum of the
+%   observations in seconds and Buckets is a list UpperBound-Count
+%   holding the cumulative number of observations =< UpperBound.  The
+%   last UpperBound is `inf`.  Names follow the Prometheus naming
+%   conventions.
+
+runtime_metrics(Metrics) :-
+    '$runtime_metrics'(Metrics).
+
+%!  write_runtime_metrics(+Stream) is det.
+%
+%   Write runtime_metrics/1 to Stream  using   the  Prometheus text
+%   exposition format.
+
+write_runtime_metrics(Out) :-
+    runtime_metrics(Metrics),
+    forall(member(metric(Name, Type, Help, Value), Metrics),
+           write_metric(Out, Name, Type, Help, Value)).
+
+write_metric(Out, Name, Type, Help, Value) :-
+    format(Out, '# HELP ~w ~w~n', [Name, Help]),
+    format(Out, '# TYPE ~w ~w~n', [Name, Type]),
+    write_metric_value(Type, Out, Name, Value).
+
+write_metric_value(counter, Out, Name, Value) :-
+    format(Out, '~w ~d~n', [Name, Value]).
+write_metric_value(histogram, Out, Name, histogram(Count, Sum, Buckets)) :-
+    forall(member(Le-N, Buckets),
+           (   Le == inf
+           ->  format(Out, '~w_bucket{le="+Inf"} ~d~n', [Name, N])
+           ;   format(Out, '~w_bucket{le="~w"} ~d~n', [Name, Le, N])
+           )),
+    format(Out, '~w_sum ~w~n', [Name, Sum]),
+    format(Out, '~w_count ~d~n', [Name, Count]).
+
 human_thread_id(Thread, Id) :-
     atom(Thread),
     !,
@@ -268,11 +348,21 @@ human_thread_id(Thread, Id) :-
 thread_stats(Thread, Stacks,
              time{cpu:CpuTime,
                   inferences:Inferences,
-                  epoch:Epoch
-                 }) :-
+                  epoch:Epoch,
+                  gc:GcTime,
+                  agc:AgcTime,
+                  mutex_wait:MutexWait,
+                  queue_wait:QueueWait
+                 },
+             Heap) :-
     thread_statistics(Thread, cputime, CpuTime),
     thread_statistics(Thread, inferences, Inferences),
     thread_statistics(Thread, epoch, Epoch),
+    thread_statistics(Thread, gctime, GcTime),
+    thread_statistics(Thread, thread_agc_time, AgcTime),
+    thread_statistics(Thread, mutex_wait_time, MutexWait),
+    thread_statistics(Thread, queue_wait_time, QueueWait),
+    thread_statistics(Thread, heap_allocated, Heap),
     thread_stack_statistics(Thread, Stacks).
 
 
@@ -578,6 +668,382 @@ value(Name, Data, Value) :-
     Value = Data.Name.
 
 
+                 /*******************************
+                 *      SAMPLING PROFILER       *
+                 *******************************/
+
+%!  sample_profiler(+Threads, +Bool) is det.
+%!  sample_profiler(+Threads, +Bool, +Options) is det.
+%
+%   Enable or disable the sampling profiler for Threads.  Unlike
+%   profile/1, the sampling profiler does not intercept calls.  It
+%   periodically records the Prolog call stack of all sampled threads
+%   and can thus be switched on and off for any running thread with
+%   little overhead.  Threads is a thread, a list of threads or the
+%   atom `all`.  The latter samples all threads, including threads
+%   that are created later, until sampling is disabled for `all`.
+%
+%   Each thread records its samples in a private table, so sampling
+%   many threads of a busy server does not introduce contention.  The
+%   tables are merged by sample_profile_data/1 and
+%   write_folded_profile/1.  Samples of threads that terminated are
+%   preserved.  Options:
+%
+%     * interval(+Seconds)
+%     Set the time between two samples.  The default is 0.01
+%     (100Hz).  This is a global setting.
+%
+%   Samples are collected at the same points where the thread handles
+%   signals.  A thread that is blocked in a system call is not sampled
+%   until it resumes.
+
+sample_profiler(Thread, Bool) :-
+    sample_profiler(Thread, Bool, []).
+
+sample_profiler(Thread, Bool, Options) :-
+    must_be(boolean, Bool),
+    (   option(interval(Interval), Options)
+    ->  must_be(number, Interval),
+        Float is float(Interval),
+        '$prof_sample_interval'(_, Float)
+    ;   true
+    ),
+    sample_threads(Thread, Bool).
+
+sample_threads(all, Bool) :-
+    !,
+    '$prof_sample'(all, _, Bool).
+sample_threads(Threads, Bool) :-
+    is_list(Threads),
+    !,
+    forall(member(Thread, Threads),
+           sample_threads(Thread, Bool)).
+sample_threads(Thread, Bool) :-
+    thread_property(Thread, id(Id)),
+    '$prof_sample'(Id, _, Bool).
+
+%!  sample_profile_data(-Stacks:list) is det.
+%!  sample_profile_data(-Stacks:list, +Options) is det.
+%
+%   Stacks is a list of Count-Stack, where Stack is a list of
+%   qualified predicate indicators, outermost first.  Direct
+%   recursion is represented by a single element.  Stacks that were
+%   too deep to be recorded completely start with the atom `...`.
+%   The list is ordered by descending Count.  By default, the samples
+%   of all threads are combined.  Options:
+%
+%     * thread(+Thread)
+%     Only return the samples of Thread, which must be running.
+
+sample_profile_data(Stacks) :-
+    sample_profile_data(Stacks, []).
+
+sample_profile_data(Stacks, Options) :-
+    (   option(thread(Thread), Options)
+    ->  thread_property(Thread, id(Id))
+    ;   Id = all
+    ),
+    '$prof_sample_stacks'(Id, Stacks0, _Samples),
+    sort(1, @>=, Stacks0, Stacks).
+
+%!  write_folded_profile(+Stream) is det.
+%
+%   Write the data collected by the sampling profiler to Stream in
+%   the _folded stacks_ format used by flame graph tools: a line per
+%   call stack holding the predicates separated by `;`, a space and
+%   the number of samples.
+
+write_folded_profile(Stream) :-
+    sample_profile_data(Stacks),
+    forall(member(Count-Stack, Stacks),
+           ( maplist(pi_text, Stack, Texts),
+             atomic_list_concat(Texts, ;, Line),
+             format(Stream, '~w ~d~n', [Line, Count])
+           )).
+
+pi_text(PI, Text) :-
+    format(atom(Text), '~q', [PI]).
+
+%!  reset_sample_profile is det.
+%
+%   Clear the data collected by the sampling profiler.
+
+reset_sample_profile :-
+    '$prof_sample_reset'.
+
+
+                 /*******************************
+                 *     ALLOCATION PROFILER      *
+                 *******************************/
+
+%!  alloc_profile(:Goal) is semidet.
+%!  alloc_profile(:Goal, +Options) is semidet.
+%
+%   Run Goal as once/1 while sampling its memory allocation, and print
+%   a report using show_alloc_profile/1.  Every `interval` bytes that
+%   are allocated on the global stack or the heap, the call path that
+%   is active is recorded.  Options are passed to show_alloc_profile/1
+%   and may contain:
+%
+%     * interval(+Bytes)
+%     Number of bytes between two samples.  This is a global setting.
+%     The default is 524288 (512Kb).
+
+alloc_profile(Goal) :-
+    alloc_profile(Goal, []).
+
+alloc_profile(Goal, Options) :-
+    alloc_interval(Options),
+    reset_alloc_profile,
+    setup_call_cleanup(
+        alloc_profiler(Old, true),
+        once(Goal),
+        ( alloc_profiler(_, Old),
+          show_alloc_profile(Options)
+        )).
+
+alloc_interval(Options) :-
+    (   option(interval(Bytes), Options)
+    ->  '$prof_alloc_interval'(_, Bytes)
+    ;   true
+    ).
+
+%!  alloc_profiler(-Old, +New) is det.
+%
+%   Query or change whether the calling thread samples its memory
+%   allocation.  Old and New are Booleans.  Use thread_signal/2 to
+%   control this for another thread.
+
+alloc_profiler(Old, New) :-
+    '$prof_alloc'(Old, New).
+
+%!  alloc_profile_data(+Area, -Stacks) is det.
+%
+%   Stacks is a list Bytes-Stack for the allocation on Area, which is
+%   one of `global` (the global stack) or `heap`.  The list is ordered
+%   by descending Bytes.  Stack is a list of qualified predicate
+%   indicators, outermost first, that describes the call path that
+%   was active when the memory was allocated.  See also
+%   sample_profile_data/1.
+
+alloc_profile_data(Area, Stacks) :-
+    '$prof_alloc_stacks'(Area, Stacks0, _Bytes),
+    sort(1, @>=, Stacks0, Stacks).
+
+%!  show_alloc_profile(+Options) is det.
+%
+%   Print the call paths that allocated most memory.  Options:
+%
+%     * top(+N)
+%     Show the top N call paths for each area.  Default is 10.
+
+show_alloc_profile(Options) :-
+    option(top(N), Options, 10),
+    forall(member(Area-Title, [ global-'Global stack allocation',
+                                heap-'Heap allocation'
+                              ]),
+           show_alloc_area(Area, Title, N)).
+
+show_alloc_area(Area, Title, N) :-
+    '$prof_alloc_stacks'(Area, Stacks0, Total),
+    sort(1, @>=, Stacks0, Stacks),
+    format('~`=t~69|~n'),
+    format('~w: ~D bytes sampled~n', [Title, Total]),
+    format('~`=t~69|~n'),
+    (   Total > 0
+    ->  forall(( nth1(I, Stacks, Bytes-Stack), I =< N ),
+               show_alloc_stack(Bytes, Total, Stack))
+    ;   true
+    ).
+
+show_alloc_stack(Bytes, Total, Stack) :-
+    Perc is 100*Bytes/Total,
+    reverse(Stack, [Leaf|Callers]),
+    format('~t~D~14| ~t~1f%~22|  ~q~n', [Bytes, Perc, Leaf]),
+    forall(( nth1(I, Callers, Caller), I =< 3 ),
+           format('~24|<- ~q~n', [Caller])).
+
+%!  reset_alloc_profile is det.
+%
+%   Clear the data collected by the allocation profiler.
+
+reset_alloc_profile :-
+    '$prof_alloc_reset'.
+
+
+                 /*******************************
+                 *         CALL COUNTING        *
+                 *******************************/
+
+%!  call_counting(:Pred, +Bool) is det.
+%
+%   Enable or disable counting the  ports   of  Pred, which is either a
+%   head or a predicate indicator.  Unlike   profile/1,  counting has no
+%   effect on other predicates and can be  enabled while the program is
+%   running.  Enabling counting resets the counts.  Note that last
+%   call optimization is disabled for counted predicates.
+
+call_counting(Spec, Bool) :-
+    must_be(boolean, Bool),
+    counting_head(Spec, Head),
+    '$set_predicate_attribute'(Head, call_counting, Bool).
+
+%!  call_counts(:Pred, -Counts:dict) is semidet.
+%
+%   Counts is a dict `call_counts` holding   the  port counts of Pred
+%   since call counting was enabled.  The  keys `calls`, `exits`, `redos`,
+%   `fails` and `exceptions` count the   ports.  The key `time` is the
+%   estimated total wall time in seconds  spent   in  Pred, which is
+%   extrapolated from the `timed` calls. Fails   if counting was never
+%   enabled for Pred.
+
+call_counts(Spec, Counts) :-
+    counting_head(Spec, Head),
+    predicate_property(Head, call_counts(List)),
+    dict_create(Counts, call_counts, List).
+
+%   Counting applies to the definition, so we must resolve imported
+%   (and autoloadable) predicates.
+
+counting_head(Spec, Q:Head) :-
+    strip_module(Spec, M, Plain),
+    (   Plain = _/_
+    ->  pi_head(Plain, Head)
+    ;   Head = Plain
+    ),
+    (   predicate_property(M:Head, imported_from(Q))
+    ->  true
+    ;   Q = M
+    ).
+
+
+                 /*******************************
+                 *        PREDICATE MEMORY      *
+                 *******************************/
+
+%!  predicate_memory(:Pred, -Memory:dict) is semidet.
+%
+%   Memory is a dict `memory` that describes the heap memory (in bytes)
+%   used by Pred, which is either a head or a predicate indicator.  The
+%   keys are:
+%
+%     - definition
+%       The predicate header and its supervisor code.
+%     - clauses
+%       Clauses that are not erased.
+%     - erased_clauses
+%       Erased clauses that are not yet reclaimed by clause garbage
+%       collection (see garbage_collect_clauses/0).
+%     - clause_indexes
+%       The clause indexes created by JIT indexing.
+%     - lingering
+%       Data that has been detached from the predicate but may still be
+%       in use by some thread, such as replaced clause indexes.
+%     - tables
+%       The answer tries of the tables for Pred.  For thread-local data
+%       and private tables, only the calling thread is accounted.
+%     - total
+%       The sum of the above.
+%
+%   Fails if Pred is not defined.
+
+predicate_memory(Spec, Memory) :-
+    counting_head(Spec, Head),
+    predicate_property(Head, memory(Usage)),
+    pred_table_memory(Head, Tables),
+    predicate_memory_dict(Usage, Tables, Memory).
+
+predicate_memory_dict(Usage, Tables, Memory) :-
+    append(Usage, [tables(Tables)], Pairs0),
+    foldl(memory_value, Pairs0, Values, 0, Total),
+    Memory = memory{total:Total}.put(Values).
+
+memory_value(Term, Key-Bytes, Total0, Total) :-
+    Term =.. [Key,Bytes],
+    Total is Total0+Bytes.
+
+pred_table_memory(M:Head, Bytes) :-
+    (   predicate_property(M:Head, tabled)
+    ->  functor(Head, Name, Arity),
+        findall(Size,
+                ( current_table(M:Variant, Trie),
+                  functor(Variant, Name, Arity),
+                  trie_property(Trie, size(Size))
+                ),
+                Sizes),
+        sum_list(Sizes, Bytes)
+    ;   Bytes = 0
+    ).
+
+%!  show_predicate_memory(+Options) is det.
+%
+%   Print the predicates in all modules that use most memory, sorted
+%   by the total as described with predicate_memory/2.  Options:
+%
+%     * top(+N)
+%     Show the top N predicates.  Default is 10.
+
+show_predicate_memory(Options) :-
+    option(top(N), Options, 10),
+    table_memory(TableMemory),
+    findall(Total-(PI-Memory),
+            ( defined_predicate(Pred),
+              predicate_property(Pred, memory(Usage)),
+              pi_head(PI, Pred),
+              (   memberchk(PI-Tables, TableMemory)
+              ->  true
+              ;   Tables = 0
+              ),
+              predicate_memory_dict(Usage, Tables, Memory),
+              Total = Memory.total
+            ),
+            Pairs),
+    sort(1, @>=, Pairs, Sorted),
+    format('~`=t~102|~n'),
+    format('~w~t~40|~t~w~12+~t~w~12+~t~w~12+~t~w~12+~t~w~12+~n',
+           [ 'Predicate', 'Total', 'Clauses', 'Erased',
+             'Indexes', 'Tables' ]),
+    format('~`=t~102|~n'),
+    forall(( nth1(I, Sorted, _-(PI-Memory)), I =< N ),
+           show_predicate_memory_line(PI, Memory)).
+
+show_predicate_memory_line(PI, Memory) :-
+    predicate_label(PI, Label),
+    format('~w~t~40|~t~D~12+~t~D~12+~t~D~12+~t~D~12+~t~D~12+~n',
+           [ Label, Memory.total, Memory.clauses, Memory.erased_clauses,
+             Memory.clause_indexes, Memory.tables ]).
+
+defined_predicate(M:Head) :-
+    current_module(M),
+    current_predicate(_, M:Head),
+    \+ predicate_property(M:Head, imported_from(_)).
+
+%   Collect the table memory of all predicates using a single pass
+%   over all tables, producing a list PI-Bytes.
+
+table_memory(TableMemory) :-
+    findall(PI-Size,
+            ( current_table(M:Variant, Trie),
+              trie_property(Trie, size(Size)),
+              functor(Variant, Name, Arity),
+              PI = M:Name/Arity
+            ),
+            Pairs),
+    msort(Pairs, Sorted),
+    sum_by_key(Sorted, TableMemory).
+
+sum_by_key([], []).
+sum_by_key([K-V0|T0], [K-V|T]) :-
+    sum_same_key(T0, K, V0, V, T1),
+    sum_by_key(T1, T).
+
+sum_same_key([K-V1|T0], K, V0, V, T) :-
+    !,
+    V2 is V0+V1,
+    sum_same_key(T0, K, V2, V, T).
+sum_same_key(T, _, V, V, T).
+
+
                  /*******************************
                  *            MESSAGES          *
                  *******************************/
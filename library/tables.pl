@@ -56,11 +56,21 @@
             set_pil_on/0,
             set_pil_off/0,
 
+            save_tables/1,                      % +File
+            load_tables/1,                      % +File
+
+            table_statistics/0,
+            table_statistics/1,                 % +Options
+            table_statistics/2,                 % :Variant, -Stats
+
             op(900, fy, tnot)
           ]).
 :- autoload(library(apply), [maplist/3]).
 :- autoload(library(error), [type_error/2, must_be/2, domain_error/2]).
-:- autoload(library(lists), [append/3]).
+:- autoload(library(lists), [append/3, member/2]).
+:- autoload(library(option), [option/3]).
+:- autoload(library(pairs), [pairs_values/2]).
+:- autoload(library(solution_sequences), [limit/2]).
 
 /** <module> XSB interface to tables
 
@@ -68,6 +78,11 @@ This module provides an  XSB  compatible   library  to  access tables as
 created by tabling (see table/1). The aim   of  this library is first of
 all compatibility with XSB.  This library contains some old and internal
 XSB predicates that are marked deprecated.
+
+In addition, this library provides save_tables/1 and load_tables/1 to
+preserve completed tables over a restart of Prolog and
+table_statistics/0,1,2 to find the tables that are most expensive to
+evaluate.
 */
 
 :- meta_predicate
@@ -81,7 +96,8 @@ XSB predicates that are marked deprecated.
     get_calls(:, -, -),
     get_returns_for_call(:, :),
     get_returns_and_dls(+, -, :),
-    get_residual(:, -).
+    get_residual(:, -),
+    table_statistics(:, -).
 
 %!  't not'(:Goal)
 %
@@ -371,4 +387,257 @@ abolish_table_subgoals(Head, Options) :-
     ;   memberchk(abolish_tables_singly, Options)
     ->  abolish_table_subgoals(Head)
     ;   domain_error([abolish_tables_transitively,abolish_tables_singly], Options)
+    ).
+
+
+		 /*******************************
+		 *        SAVE AND LOAD		*
+		 *******************************/
+
+%!  save_tables(+File) is det.
+%
+%   Save all completed tables to File. The tables are saved in the fast
+%   binary term serialization format (see fast_write/2). For moded
+%   (answer subsumption) tables the aggregated answers are saved. For
+%   incremental tables, the dependencies on other incremental tables and
+%   incremental dynamic predicates are saved as well, such that the
+%   loaded tables are invalidated by changes to these predicates.
+%
+%   Incomplete and invalid tables, as well as tables holding conditional
+%   answers under the Well Founded Semantics, are not saved. The saved
+%   tables may be restored using load_tables/1.
+
+save_tables(File) :-
+    setup_call_cleanup(
+        open(File, write, Out, [type(binary)]),
+        ( fast_write(Out, saved_tables(1)),
+          forall(saved_table(Variant, Answers, Deps),
+                 fast_write(Out, table(Variant, Answers, Deps)))
+        ),
+        close(Out)).
+
+saved_table(M:Variant, Answers, Deps) :-
+    '$tbl_variant_table'(VariantTrie),
+    trie_gen(VariantTrie, M:Variant, Trie),
+    '$tbl_table_status'(Trie, complete, M:Variant, Skeleton),
+    M:'$table_mode'(Head, Variant, Moded),
+    \+ has_conditional_answers(Trie, Skeleton, Moded),
+    findall(Head, table_answer(Trie, Skeleton, Moded), Answers),
+    findall(Dep, table_dependency(Trie, Dep), Deps).
+
+has_conditional_answers(Trie, Skeleton, Moded) :-
+    '$tbl_trienode'(Reserved),
+    (   Moded == Reserved
+    ->  '$tbl_answer'(Trie, Skeleton, Condition)
+    ;   '$tbl_answer'(Trie, Skeleton, Moded, Condition)
+    ),
+    Condition \== true,
+    !.
+
+table_answer(Trie, Skeleton, Moded) :-
+    '$tbl_trienode'(Reserved),
+    (   Moded == Reserved
+    ->  trie_gen(Trie, Skeleton)
+    ;   '$tbl_answer'(Trie, Skeleton, Moded, true)
+    ).
+
+table_dependency(Trie, Dep) :-
+    '$idg_edge'(Trie, dependent, DepTrie),
+    '$tbl_table_status'(DepTrie, _Status, Goal, _Skeleton),
+    (   predicate_property(Goal, dynamic),
+        \+ predicate_property(Goal, tabled)
+    ->  Dep = dynamic(Goal)
+    ;   Dep = tabled(Goal)
+    ).
+
+%!  load_tables(+File) is det.
+%
+%   Restore the tables saved  by   save_tables/1  from File. Tables for
+%   which a table already exists are left untouched, as are tables for
+%   predicates that are no longer tabled. Restoring a table does not
+%   evaluate the tabled predicate.  As the saved answers are used as-is,
+%   the program must be the same as when the tables were saved.
+%
+%   @error domain_error(saved_tables, File) if File was not created by
+%   save_tables/1.
+
+load_tables(File) :-
+    setup_call_cleanup(
+        open(File, read, In, [type(binary)]),
+        read_saved_tables(File, In, Dependencies),
+        close(In)),
+    maplist(restore_dependencies, Dependencies).
+
+read_saved_tables(File, In, Dependencies) :-
+    fast_read(In, Header),
+    (   Header == saved_tables(1)
+    ->  true
+    ;   domain_error(saved_tables, File)
+    ),
+    fast_read(In, Term),
+    read_saved_tables_(Term, In, Dependencies).
+
+read_saved_tables_(end_of_file, _, []) :-
+    !.
+read_saved_tables_(table(Variant, Answers, Deps), In, Dependencies) :-
+    restore_table(Variant, Answers),
+    (   Deps == []
+    ->  Dependencies = Dependencies1
+    ;   Dependencies = [Variant-Deps|Dependencies1]
+    ),
+    fast_read(In, Term),
+    read_saved_tables_(Term, In, Dependencies1).
+
+%   restore_table(+Variant, +Answers)
+%
+%   Create the table for Variant by running the normal tabling machinery
+%   with a worker that produces the saved answers.  This ensures the
+%   table is created with the right properties (shared, incremental,
+%   moded).
+
+restore_table(M:Variant, Answers) :-
+    catch(M:'$table_mode'(Head, Variant, Moded), error(_,_), fail),
+    '$wrapped_implementation'(M:Head, table, Wrapped),
+    !,
+    functor(Wrapped, Closure, _),
+    '$tbl_trienode'(Reserved),
+    (   Moded == Reserved
+    ->  Goal = start_tabling(Closure, M:Head, member(Head, Answers))
+    ;   Goal = start_moded_tabling(Closure, M:Head, member(Head, Answers),
+                                   M:Variant, Moded)
+    ),
+    \+ \+ ignore(Goal).                  % Goal completes the table
+restore_table(_, _).
+
+%   restore_dependencies(+Variant-Deps)
+%
+%   Restore the IDG edges of a restored table.  This is done after all
+%   tables are restored such that the edges between tables that depend
+%   on each other can be restored.
+
+restore_dependencies(Variant-Deps) :-
+    (   '$tbl_existing_variant_table'(0, Variant, Trie, _Status, _Skeleton)
+    ->  maplist(restore_dependency(Trie), Deps)
+    ;   true
+    ).
+
+restore_dependency(Trie, tabled(Goal)) :-
+    !,
+    (   '$tbl_existing_variant_table'(0, Goal, DepTrie, _Status, _Skeleton)
+    ->  ignore('$idg_add_edge'(Trie, DepTrie))
+    ;   true
+    ).
+restore_dependency(Trie, dynamic(Goal)) :-
+    setup_call_cleanup(
+        '$idg_set_current'(Old, Trie),
+        '$idg_add_dyncall'(Goal),
+        '$idg_set_current'(Old)).
+
+
+		 /*******************************
+		 *           STATISTICS		*
+		 *******************************/
+
+%!  table_statistics is det.
+%!  table_statistics(+Options) is det.
+%
+%   Print evaluation statistics for the   existing  tables, most costly
+%   tables first. This helps deciding which  predicates benefit from
+%   tabling. Options:
+%
+%     - order_by(+Key)
+%       Sort the tables on Key, which is one of `time` (default),
+%       `answers`, `duplicates`, `suspensions` or `completions`.
+%       See table_statistics/2 for their meaning.
+%     - limit(+Count)
+%       Only print the first Count tables.  Default is 20.
+
+table_statistics :-
+    table_statistics([]).
+
+table_statistics(Options) :-
+    option(order_by(Key), Options, time),
+    option(limit(Limit), Options, 20),
+    must_be(oneof([time,answers,duplicates,suspensions,completions]), Key),
+    must_be(nonneg, Limit),
+    findall(Value-(Variant-Stats),
+            ( Variant = _:_,
+              table_statistics(Variant, Stats),
+              get_dict(Key, Stats, Value)
+            ),
+            Pairs),
+    sort(1, @>=, Pairs, Sorted),
+    pairs_values(Sorted, Tables),
+    format('Table~t~40|~t~w~10+~t~w~10+~t~w~10+~t~w~8+~t~w~6+~n',
+           ['Time','Answers','Dupl','Susp','Compl']),
+    format('~`=t~84|~n'),
+    forall(limit(Limit, member(Variant-Stats, Tables)),
+           print_table_statistics(Variant, Stats)).
+
+print_table_statistics(Variant, Stats) :-
+    \+ \+ ( numbervars(Variant, 0, _, [singletons(true)]),
+            format('~W~t~40|~t~3f~10+~t~D~10+~t~D~10+~t~D~8+~t~D~6+~n',
+                   [ Variant,
+                     [ quoted(true), portray(true),
+                       numbervars(true), max_depth(5)
+                     ],
+                     Stats.time, Stats.answers, Stats.duplicates,
+                     Stats.suspensions, Stats.completions
+                   ])
+          ).
+
+%!  table_statistics(:Variant, -Stats:dict) is nondet.
+%
+%   True when Stats is a dict holding the evaluation statistics of the
+%   table for Variant. The dict contains the keys below. The counters
+%   accumulate over re-evaluation of incremental tables.
+%
+%     - status
+%       One of `complete`, `invalid` (incremental tabling),
+%       `incomplete` or `fresh`.
+%     - answers
+%       Number of answers in the table.
+%     - duplicates
+%       Number of answers derived again and rejected because they
+%       are already in the table.  A high number relative to
+%       `answers` indicates many redundant derivations.
+%     - suspensions
+%       Number of times a consumer suspended on the incomplete table.
+%     - completions
+%       Number of times the table was completed.
+%     - time
+%       Wall time in seconds between creating the table and its
+%       completion.  This includes evaluating other tables created
+%       during the evaluation and is thus comparable to the
+%       _cumulative_ time of the profiler.  With shared tabling it
+%       also includes waiting for other threads.
+%
+%   This predicate is based on the trie_property/2 properties
+%   duplicate_count, suspension_count, completion_count and eval_time.
+
+table_statistics(Variant, Stats) :-
+    current_table(Variant, Trie),
+    '$tbl_table_status'(Trie, Status0),
+    (   integer(Status0)                        % worklist
+    ->  Status = incomplete
+    ;   Status = Status0
+    ),
+    trie_property(Trie, value_count(Answers)),
+    trie_stat(Trie, duplicate_count, Duplicates),
+    trie_stat(Trie, suspension_count, Suspensions),
+    trie_stat(Trie, completion_count, Completions),
+    trie_stat(Trie, eval_time, Time),
+    Stats = table{ status:Status,
+                   answers:Answers,
+                   duplicates:Duplicates,
+                   suspensions:Suspensions,
+                   completions:Completions,
+                   time:Time
+                 }.
+
+trie_stat(Trie, Name, Value) :-
+    Prop =.. [Name,Value0],
+    (   '$trie_property'(Trie, Prop)
+    ->  Value = Value0
+    ;   Value = 0                               % no O_TRIE_STATS
     ).
@@ -40,13 +40,17 @@
             concurrent_maplist/3,       % :Goal, ?List1, ?List2
             concurrent_maplist/4,       % :Goal, ?List1, ?List2, ?List3
             first_solution/3,           % -Var, :Goals, +Options
+            task_spawn/2,               % :Goal, -Task
+            task_await/1,               % +Task
+            task_await_any/2,           % +Tasks, -Task
+            task_cancel/1,              % +Task
 
             call_in_thread/2            % +Thread, :Goal
           ]).
 :- autoload(library(apply),[maplist/2,maplist/3,maplist/4,maplist/5]).
 :- autoload(library(debug),[debug/3]).
 :- autoload(library(error),[must_be/2]).
-:- autoload(library(lists),[subtract/3,same_length/2]).
+:- autoload(library(lists),[subtract/3,same_length/2,append/3]).
 :- autoload(library(option),[option/3]).
 
 
@@ -58,6 +62,7 @@
     concurrent_maplist(2, ?, ?),
     concurrent_maplist(3, ?, ?, ?),
     first_solution(-, :, +),
+    task_spawn(0, -),
     call_in_thread(+, 0).
 
 
@@ -291,24 +296,33 @@ join_all([Id|T]) :-
 %!  concurrent_maplist(:Goal, +List1, +List2) is semidet.
 %!  concurrent_maplist(:Goal, +List1, +List2, +List3) is semidet.
 %
-%   Concurrent version of maplist/2. This   predicate uses concurrent/3,
-%   using multiple _worker_ threads.  The  number   of  threads  is  the
-%   minimum of the list length and the   number  of cores available. The
-%   number of cores is determined using  the prolog flag =cpu_count=. If
+%   Concurrent version of maplist/2.  The goals are executed by a pool
+%   of _worker_ threads that is created on the  first call and shared
+%   by all subsequent calls.  The number  of   workers  is  the number of
+%   cores available, as determined by  the   Prolog  flag =cpu_count=. If
 %   this flag is absent or 1 or List   has  less than two elements, this
 %   predicate calls the corresponding maplist/N  version using a wrapper
 %   based on once/1. Note that all goals   are executed as if wrapped in
 %   once/1 and therefore these predicates are _semidet_.
 %
-%   Note that the the overhead  of   this  predicate is considerable and
-%   therefore Goal must  be  fairly  expensive   before  one  reaches  a
-%   speedup.
+%   The list is split into  a  number  of   chunks  that  is a small
+%   multiple of the number of workers,   such that the synchronization
+%   cost is shared by multiple  elements   while  workers that finish
+%   early can pick up more work. If  a   goal  fails  or raises an
+%   exception, the chunks that have not  yet   been  started  are
+%   skipped, but chunks that are already being processed are completed.
+%   If concurrent_maplist/2 is called from a  pool worker, it falls back
+%   to concurrent/3 to avoid waiting for itself.
+%
+%   Note that the goals must be  copied   to  the workers and the results
+%   must be copied back. As a  result,   Goal  must  be  fairly expensive
+%   before one reaches a speedup.
 
 concurrent_maplist(Goal, List) :-
     workers(List, WorkerCount),
     !,
     maplist(ml_goal(Goal), List, Goals),
-    concurrent(WorkerCount, Goals, []).
+    concurrent_chunks(WorkerCount, Goals).
 concurrent_maplist(M:Goal, List) :-
     maplist(once_in_module(M, Goal), List).
 
@@ -322,7 +336,7 @@ concurrent_maplist(Goal, List1, List2) :-
     workers(List1, WorkerCount),
     !,
     maplist(ml_goal(Goal), List1, List2, Goals),
-    concurrent(WorkerCount, Goals, []).
+    concurrent_chunks(WorkerCount, Goals).
 concurrent_maplist(M:Goal, List1, List2) :-
     maplist(once_in_module(M, Goal), List1, List2).
 
@@ -336,7 +350,7 @@ concurrent_maplist(Goal, List1, List2, List3) :-
     workers(List1, WorkerCount),
     !,
     maplist(ml_goal(Goal), List1, List2, List3, Goals),
-    concurrent(WorkerCount, Goals, []).
+    concurrent_chunks(WorkerCount, Goals).
 concurrent_maplist(M:Goal, List1, List2, List3) :-
     maplist(once_in_module(M, Goal), List1, List2, List3).
 
@@ -358,6 +372,240 @@ same_length([_|T1], [_|T2], [_|T3]) :-
     same_length(T1, T2, T3).
 
 
+                 /*******************************
+                 *          WORKER POOL         *
+                 *******************************/
+
+:- dynamic
+    concurrent_pool/1,                  % Queue
+    pool_task/2,                        % Done, Worker
+    task_cancelled/1,                   % Done
+    task_listener/2.                    % Done, Queue
+
+%!  concurrent_chunks(+WorkerCount, +Goals) is semidet.
+%
+%   Run Goals using the shared worker pool.  Goals is split into chunks
+%   that are sent to the pool queue as  job(Id, Chunk, Vars, Done), where
+%   Done is a queue that  is  private   to  this  call  and that
+%   receives the results.  Destroying Done on  completion tells the
+%   workers to skip the remaining chunks.
+
+concurrent_chunks(WorkerCount, Goals) :-
+    nb_current('$concurrent_pool_worker', true),
+    !,
+    concurrent(WorkerCount, Goals, []).
+concurrent_chunks(WorkerCount, Goals) :-
+    concurrent_pool_queue(Queue),
+    length(Goals, Len),
+    ChunkSize is max(1, Len // (WorkerCount*4)),
+    chunks(Goals, ChunkSize, Chunks),
+    setup_call_cleanup(
+        message_queue_create(Done),
+        pool_run(Chunks, Queue, Done),
+        message_queue_destroy(Done)).
+
+chunks([], _, []) :- !.
+chunks(List, Size, [Chunk|Chunks]) :-
+    length(Chunk, Size),
+    append(Chunk, Rest, List),
+    !,
+    chunks(Rest, Size, Chunks).
+chunks(List, _, [List]).
+
+pool_run(Chunks, Queue, Done) :-
+    submit_chunks(Chunks, 1, Queue, Done, VarList),
+    VT =.. [vars|VarList],
+    functor(VT, _, Count),
+    pool_wait(Count, Done, VT).
+
+submit_chunks([], _, _, _, []).
+submit_chunks([H|T], I, Queue, Done, [Vars|VT]) :-
+    term_variables(H, Vars),
+    thread_send_message(Queue, job(I, H, Vars, Done)),
+    I2 is I + 1,
+    submit_chunks(T, I2, Queue, Done, VT).
+
+pool_wait(0, _, _) :- !.
+pool_wait(N, Done, VT) :-
+    thread_get_message(Done, Reply),
+    debug(concurrent, 'Pool: received ~p', [Reply]),
+    (   Reply = done(Id, Vars)
+    ->  arg(Id, VT, Vars),
+        N2 is N - 1,
+        pool_wait(N2, Done, VT)
+    ;   Reply = exception(_, Error)
+    ->  throw(Error)
+    ;   fail                            % failed(Id)
+    ).
+
+%!  concurrent_pool_queue(-Queue) is det.
+%
+%   Queue is the job queue of the   worker  pool, creating the pool if
+%   it does not yet exist.
+
+concurrent_pool_queue(Queue) :-
+    concurrent_pool(Queue),
+    !.
+concurrent_pool_queue(Queue) :-
+    with_mutex(concurrent_pool, create_concurrent_pool(Queue)).
+
+create_concurrent_pool(Queue) :-
+    concurrent_pool(Queue),
+    !.
+create_concurrent_pool(Queue) :-
+    current_prolog_flag(cpu_count, Cores),
+    message_queue_create(Queue),
+    forall(between(1, Cores, _),
+           thread_create(pool_worker(Queue), _, [detached(true)])),
+    assertz(concurrent_pool(Queue)).
+
+%!  pool_worker(+Queue)
+%
+%   Run chunks and tasks from Queue. Chunks   for a call whose Done queue
+%   no longer exists are skipped.
+
+pool_worker(Queue) :-
+    nb_setval('$concurrent_pool_worker', true),
+    nb_setval('$concurrent_pool_task', []),
+    repeat,
+      thread_get_message(Queue, Job),
+      pool_job(Job),
+      fail.
+
+pool_job(job(Id, Chunk, Vars, Done)) :-
+    (   catch(message_queue_property(Done, size(_)), _, fail)
+    ->  (   catch(maplist(once, Chunk), Error, true)
+        ->  (   var(Error)
+            ->  Reply = done(Id, Vars)
+            ;   Reply = exception(Id, Error)
+            )
+        ;   Reply = failed(Id)
+        ),
+        catch(thread_send_message(Done, Reply), _, true)
+    ;   debug(concurrent, 'Pool: skipped job ~p', [Id])
+    ).
+pool_job(task(Goal, Vars, Done)) :-
+    thread_self(Me),
+    assertz(pool_task(Done, Me), Ref),
+    (   task_cancelled(Done)
+    ->  Reply = cancelled
+    ;   catch(run_task(Goal, Vars, Done, Reply), task_cancelled,
+              Reply = cancelled)
+    ),
+    erase(Ref),
+    retractall(task_cancelled(Done)),
+    catch(thread_send_message(Done, Reply), _, true),
+    forall(retract(task_listener(Done, Listener)),
+           catch(thread_send_message(Listener, completed(Done)), _, true)).
+
+run_task(Goal, Vars, Done, Reply) :-
+    setup_call_cleanup(
+        nb_setval('$concurrent_pool_task', Done),
+        (   catch(Goal, Error, true)
+        ->  (   var(Error)
+            ->  Reply = true(Vars)
+            ;   Reply = exception(Error)
+            )
+        ;   Reply = false
+        ),
+        nb_setval('$concurrent_pool_task', [])).
+
+
+                 /*******************************
+                 *             TASKS            *
+                 *******************************/
+
+%!  task_spawn(:Goal, -Task) is det.
+%
+%   Run Goal as once/1 in the background  using the worker pool that is
+%   also used by concurrent_maplist/2. Task is   an opaque handle that
+%   can be passed to task_await/1, task_await_any/2 and task_cancel/1.
+%   As with concurrent/3, Goal is  copied   to  the  worker and the
+%   bindings are copied back by task_await/1.   Unlike  thread_create/3,
+%   no thread is created for the task.
+%
+%   Note that Goal occupies a  pool  worker   while  it  runs. Goals that
+%   block for a long time should use thread_create/3.
+
+task_spawn(Goal, task(Done, Vars)) :-
+    concurrent_pool_queue(Queue),
+    term_variables(Goal, Vars),
+    message_queue_create(Done),
+    thread_send_message(Queue, task(Goal, Vars, Done)).
+
+%!  task_await(+Task) is semidet.
+%
+%   Wait for Task to complete and unify   the variables of its goal with
+%   the bindings of the completed  goal.  Fails   if  the  goal failed and
+%   re-throws its exception if the  goal   raised  an exception. If the
+%   task was cancelled using task_cancel/1,  the   exception  is
+%   =task_cancelled=. Task may be awaited multiple times.
+
+task_await(task(Done, Vars)) :-
+    thread_get_message(Done, Reply),
+    thread_send_message(Done, Reply),
+    task_reply(Reply, Vars).
+
+task_reply(true(Vars), Vars).
+task_reply(false, _) :-
+    fail.
+task_reply(exception(Error), _) :-
+    throw(Error).
+task_reply(cancelled, _) :-
+    throw(task_cancelled).
+
+%!  task_await_any(+Tasks, -Task) is semidet.
+%
+%   Wait for the first of Tasks to  complete, unify Task with it and
+%   call task_await/1 on it.
+
+task_await_any(Tasks, Task) :-
+    must_be(list, Tasks),
+    Tasks \== [],
+    setup_call_cleanup(
+        message_queue_create(Listener),
+        await_any(Tasks, Listener, Task),
+        ( forall(member(task(Done, _), Tasks),
+                 retractall(task_listener(Done, Listener))),
+          message_queue_destroy(Listener)
+        )),
+    task_await(Task).
+
+await_any(Tasks, Listener, Task) :-
+    forall(member(task(Done, _), Tasks),
+           assertz(task_listener(Done, Listener))),
+    (   member(Task, Tasks),
+        Task = task(Done, _),
+        thread_peek_message(Done, _)
+    ->  true
+    ;   thread_get_message(Listener, completed(Done)),
+        memberchk(task(Done, Vars), Tasks),
+        Task = task(Done, Vars)
+    ).
+
+%!  task_cancel(+Task) is det.
+%
+%   Cancel Task.  If the task has not yet  been started it is not run.
+%   If it is running, the exception =task_cancelled= is injected into the
+%   goal using thread_signal/2. If Task has already completed this has
+%   no effect.
+
+task_cancel(task(Done, _)) :-
+    (   thread_peek_message(Done, _)
+    ->  true
+    ;   assertz(task_cancelled(Done)),
+        forall(pool_task(Done, Worker),
+               catch(thread_signal(Worker, cancel_running_task(Done)),
+                     _, true))
+    ).
+
+cancel_running_task(Done) :-
+    (   nb_current('$concurrent_pool_task', Done)
+    ->  throw(task_cancelled)
+    ;   true
+    ).
+
+
                  /*******************************
                  *             FIRST            *
                  *******************************/
@@ -41,15 +41,19 @@
             current_thread_pool/1,      % ?Pool
             thread_pool_property/2      % ?Pool, ?Property
           ]).
+:- autoload(library(apply),[foldl/4]).
 :- autoload(library(debug),[debug/3]).
-:- autoload(library(error),[must_be/2,type_error/2]).
-:- autoload(library(lists),[member/2,delete/3]).
+:- autoload(library(error),
+	    [must_be/2,type_error/2,domain_error/2,existence_error/2]).
+:- autoload(library(lists),[member/2,delete/3,nth0/3,numlist/3]).
 :- autoload(library(option),
-	    [meta_options/3,select_option/4,merge_options/3,option/3]).
+	    [ meta_options/3,select_option/4,merge_options/3,option/2,
+	      option/3
+	    ]).
 :- autoload(library(rbtrees),
 	    [ rb_new/1,
 	      rb_insert_new/4,
-	      rb_delete/3,
+	      rb_delete/4,
 	      rb_keys/2,
 	      rb_lookup/3,
 	      rb_update/4
@@ -77,7 +81,12 @@ thread for each request is a bit too simple minded for such servers:
 Using this library, one can define a  pool   for  each set of tasks with
 comparable characteristics and create threads in   this pool. Unlike the
 worker-pool model, threads are not started immediately. Depending on the
-design, both approaches can be attractive.
+design, both approaches can be attractive.  Pools created using the
+option workers(true) implement the worker-pool model: threads are
+created on demand, but are kept and reused for subsequent jobs rather
+than being created for each call to thread_create_in_pool/4.  This
+avoids the cost of creating and destroying a thread and its stacks for
+each job, which dominates if jobs are short.
 
 The library is implemented by means of   a manager thread with the fixed
 thread id =|__thread_pool_manager|=. All  state   is  maintained in this
@@ -115,14 +124,50 @@ otherwise during startup of the application.
 %       is =infinite=.  Otherwise it must be a non-negative integer.
 %       Using backlog(0) will never delay thread creation for this
 %       pool.
+%       * workers(+Boolean)
+%       If =true= (default =false=), keep threads alive after they
+%       completed their goal and reuse them for the next goal
+%       submitted using thread_create_in_pool/4.  See below.
+%       * placement(+Policy)
+%       Bind the threads of the pool to the CPUs of a NUMA node.
+%       Policy is one of =none= (default), =spread= (use the nodes
+%       round robin), =compact= (fill the CPUs of a node before
+%       using the next) or node(+Index) (use the Index-th node,
+%       starting at 0).  Creating a pool for each node using
+%       node(Index) provides per-node job queues.  The placement
+%       is ignored for threads created with an explicit affinity
+%       option.  As a thread allocates its stacks itself, these
+%       are allocated on the memory of its node.  Nodes are only
+%       known on Linux.  Elsewhere all CPUs form a single node.
 %
 %   The pooling mechanism does _not_   interact  with the =detached=
 %   state of a thread. Threads can   be  created both =detached= and
 %   normal and must be joined using   thread_join/2  if they are not
 %   detached.
+%
+%   A worker pool creates at most Size  detached worker threads using
+%   the remaining Options.  Between jobs, a worker discards the
+%   bindings of the completed goal, the messages left in its queue and
+%   trims its stacks.  The following differences with normal pools
+%   apply:
+%
+%     - The Id returned by thread_create_in_pool/4 is the worker that
+%       runs the goal.  Workers are detached and cannot be joined.
+%       Use the at_exit option or message passing to wait for the
+%       job.
+%     - The at_exit option of thread_create_in_pool/4 is called
+%       after the goal completed, while the worker is still alive.
+%       Other thread creation options of thread_create_in_pool/4 are
+%       ignored.
+%     - Thread local predicates, global variables and thread specific
+%       Prolog flags are _not_ reset between jobs.
+%     - If a goal fails or raises an exception, a warning is printed
+%       and the worker proceeds with the next job.
 
 thread_pool_create(Name, Size, Options) :-
     must_be(list, Options),
+    option(placement(Placement), Options, none),
+    must_be_placement(Placement),
     pool_manager(Manager),
     thread_self(Me),
     thread_send_message(Manager, create_pool(Name, Size, Options, Me)),
@@ -172,6 +217,19 @@ current_thread_pool(Name) :-
 %       Number of running threads in this pool
 %       * backlog(Size)
 %       Number of delayed thread creations on this pool
+%
+%   Pools created with workers(true) additionally define:
+%
+%       * idle(Count)
+%       Number of workers waiting for a job
+%       * created(Count)
+%       Total number of worker threads created for this pool
+%       * jobs(Count)
+%       Total number of completed jobs
+%       * failed(Count)
+%       Number of jobs that failed
+%       * exceptions(Count)
+%       Number of jobs that raised an exception
 
 thread_pool_property(Name, Property) :-
     current_thread_pool(Name),
@@ -304,17 +362,22 @@ manage_thread_pool(State0) :-
 
 update_thread_pool(create_pool(Name, Size, Options, For), State0, State) :-
     !,
-    (   rb_insert_new(State0,
-                      Name, tpool(Options, Size, Size, WP, WP, []),
-                      State)
-    ->  thread_send_message(For, thread_pool(true))
+    (   option(workers(true), Options)
+    ->  Pool = wpool(Options, Size, [], WP, WP, [], stats(0,0,0,0))
+    ;   Pool = tpool(Options, Size, Size, WP, WP, [])
+    ),
+    (   rb_insert_new(State0, Name, Pool, State)
+    ->  init_placement(Name, Options),
+        thread_send_message(For, thread_pool(true))
     ;   reply_error(For, permission_error(create, thread_pool, Name)),
         State = State0
     ).
 update_thread_pool(destroy_pool(Name, For), State0, State) :-
     !,
-    (   rb_delete(State0, Name, State)
-    ->  thread_send_message(For, thread_pool(true))
+    (   rb_delete(State0, Name, Pool, State)
+    ->  stop_workers(Pool),
+        retractall(pool_placement(Name, _, _, _)),
+        thread_send_message(For, thread_pool(true))
     ;   reply_error(For, existence_error(thread_pool, Name)),
         State = State0
     ).
@@ -356,6 +419,36 @@ pool_property(running(Count),
     Count is Size - Free.
 pool_property(members(IDList),
               tpool(_, _, _, _, _, IDList)).
+pool_property(options(Options),
+              wpool(Options, _Size, _Idle, _WP, _WPT, _Workers, _Stats)).
+pool_property(backlog(Size),
+              wpool(_, _Size, _Idle, WP, WPT, _Workers, _Stats)) :-
+    diff_list_length(WP, WPT, Size).
+pool_property(free(Free),
+              wpool(_, Size, Idle, _, _, Workers, _)) :-
+    length(Idle, IdleCount),
+    length(Workers, Count),
+    Free is Size - Count + IdleCount.
+pool_property(size(Size),
+              wpool(_, Size, _, _, _, _, _)).
+pool_property(running(Running),
+              wpool(_, _, Idle, _, _, Workers, _)) :-
+    length(Idle, IdleCount),
+    length(Workers, Count),
+    Running is Count - IdleCount.
+pool_property(members(IDList),
+              wpool(_, _, _, _, _, IDList, _)).
+pool_property(idle(Count),
+              wpool(_, _, Idle, _, _, _, _)) :-
+    length(Idle, Count).
+pool_property(created(Count),
+              wpool(_, _, _, _, _, _, stats(Count, _, _, _))).
+pool_property(jobs(Count),
+              wpool(_, _, _, _, _, _, stats(_, Count, _, _))).
+pool_property(failed(Count),
+              wpool(_, _, _, _, _, _, stats(_, _, Count, _))).
+pool_property(exceptions(Count),
+              wpool(_, _, _, _, _, _, stats(_, _, _, Count))).
 
 diff_list_length(List, Tail, Size) :-
     '$skip_list'(Length, List, Rest),
@@ -378,6 +471,9 @@ diff_list_length(List, Tail, Size) :-
 %       * exitted(PoolName, Thread)
 %       A thread completed.  If there is a request waiting,
 %       create a new one.
+%
+%   Worker pools (wpool/7) also receive job_done(PoolName, Worker,
+%   Status) if a worker completed a job and is ready for the next.
 
 update_pool(create(Name, Goal, For, _, Id, MyOptions),
             tpool(Options, Free0, Size, WP, WPT, Members0),
@@ -386,10 +482,12 @@ update_pool(create(Name, Goal, For, _, Id, MyOptions),
     !,
     merge_options(MyOptions, Options, ThreadOptions),
     select_option(at_exit(AtExit), ThreadOptions, ThreadOptions1, true),
-    catch(thread_create(Goal, Id,
-                        [ at_exit(worker_exitted(Name, Id, AtExit))
-                        | ThreadOptions1
-                        ]),
+    catch(( placement_options(Name, ThreadOptions1, ThreadOptions2),
+            thread_create(Goal, Id,
+                          [ at_exit(worker_exitted(Name, Id, AtExit))
+                          | ThreadOptions2
+                          ])
+          ),
           E, true),
     (   var(E)
     ->  Members = [Id|Members0],
@@ -424,11 +522,280 @@ update_pool(exitted(_Name, Id),
     ).
 
 
+update_pool(create(Name, Goal, For, _, _, MyOptions),
+            wpool(Options, Size, [Worker|Idle], WP, WPT, Workers, Stats),
+            wpool(Options, Size, Idle, WP, WPT, Workers, Stats)) :-
+    !,
+    start_job(Worker, Name, Goal, For, MyOptions).
+update_pool(create(Name, Goal, For, _, _, MyOptions),
+            wpool(Options, Size, [], WP, WPT, Workers0, Stats0),
+            wpool(Options, Size, [], WP, WPT, Workers, Stats)) :-
+    length(Workers0, Count),
+    Count < Size,
+    !,
+    (   create_worker(Name, Options, Worker, For)
+    ->  Workers = [Worker|Workers0],
+        Stats0 = stats(Created0, Jobs, Failed, Errors),
+        Created is Created0+1,
+        Stats = stats(Created, Jobs, Failed, Errors),
+        start_job(Worker, Name, Goal, For, MyOptions)
+    ;   Workers = Workers0,
+        Stats = Stats0
+    ).
+update_pool(Create,
+            wpool(Options, Size, [], WP, WPT0, Workers, Stats),
+            wpool(Options, Size, [], WP, WPT, Workers, Stats)) :-
+    Create = create(Name, _Goal, For, Wait, _, _Options),
+    !,
+    option(backlog(BackLog), Options, infinite),
+    (   can_delay(Wait, BackLog, WP, WPT0)
+    ->  WPT0 = [Create|WPT],
+        debug(thread_pool, 'Delaying ~p', [Create])
+    ;   WPT = WPT0,
+        reply_error(For, resource_error(threads_in_pool(Name)))
+    ).
+update_pool(job_done(_Name, Worker, Status),
+            wpool(Options, Size, Idle, WP0, WPT, Workers, Stats0),
+            wpool(Options, Size, Idle1, WP, WPT, Workers, Stats)) :-
+    job_stats(Status, Stats0, Stats),
+    (   WP0 == WPT
+    ->  WP = WP0,
+        Idle1 = [Worker|Idle]
+    ;   WP0 = [create(Name, Goal, For, _, _, MyOptions)|WP],
+        debug(thread_pool, 'Start delayed ~p', [Goal]),
+        Idle1 = Idle,
+        start_job(Worker, Name, Goal, For, MyOptions)
+    ).
+update_pool(exitted(_Name, Id),
+            wpool(Options, Size, Idle0, WP0, WPT, Workers0, Stats),
+            Pool) :-
+    delete(Workers0, Id, Workers1),
+    delete(Idle0, Id, Idle1),
+    Pool1 = wpool(Options, Size, Idle1, WP, WPT, Workers1, Stats),
+    (   WP0 == WPT
+    ->  WP = WP0,
+        Pool = Pool1
+    ;   WP0 = [Waiting|WP],
+        debug(thread_pool, 'Start delayed ~p', [Waiting]),
+        update_pool(Waiting, Pool1, Pool)
+    ).
+
 can_delay(true, infinite, _, _) :- !.
 can_delay(true, BackLog, WP, WPT) :-
     diff_list_length(WP, WPT, Size),
     BackLog > Size.
 
+job_stats(Status, stats(C, J0, F0, E0), stats(C, J, F, E)) :-
+    J is J0+1,
+    (   Status == true
+    ->  F = F0, E = E0
+    ;   Status == false
+    ->  F is F0+1, E = E0
+    ;   F = F0, E is E0+1
+    ).
+
+%!  create_worker(+PoolName, +Options, -Worker, +For) is semidet.
+%
+%   Create a new detached worker thread for a worker pool.  If this
+%   fails, the error is sent to For.
+
+create_worker(Name, Options, Worker, For) :-
+    worker_thread_options(Options, ThreadOptions0),
+    catch(( placement_options(Name, ThreadOptions0, ThreadOptions),
+            thread_create(pool_worker(Name), Worker,
+                          [ detached(true),
+                            at_exit(pool_worker_exitted(Name, Worker))
+                          | ThreadOptions
+                          ])
+          ),
+          E, true),
+    (   var(E)
+    ->  true
+    ;   reply_error(For, E),
+        fail
+    ).
+
+worker_thread_options([], []).
+worker_thread_options([H|T0], T) :-
+    pool_only_option(H),
+    !,
+    worker_thread_options(T0, T).
+worker_thread_options([H|T0], [H|T]) :-
+    worker_thread_options(T0, T).
+
+pool_only_option(workers(_)).
+pool_only_option(backlog(_)).
+pool_only_option(at_exit(_)).
+pool_only_option(detached(_)).
+pool_only_option(placement(_)).
+
+                 /*******************************
+                 *           PLACEMENT          *
+                 *******************************/
+
+%   pool_placement(?Pool, ?Policy, ?Nodes, ?Count) is nondet.
+%
+%   Placement state of Pool.  Nodes is a list of CPU lists, one for
+%   each NUMA node.  Count is the number of threads placed so far.
+%   Only the manager thread modifies this predicate.
+
+:- dynamic
+    pool_placement/4.
+
+must_be_placement(Placement) :-
+    must_be(nonvar, Placement),
+    (   placement_policy(Placement)
+    ->  true
+    ;   domain_error(thread_pool_placement, Placement)
+    ).
+
+placement_policy(none).
+placement_policy(spread).
+placement_policy(compact).
+placement_policy(node(Index)) :-
+    must_be(nonneg, Index).
+
+init_placement(Name, Options) :-
+    retractall(pool_placement(Name, _, _, _)),
+    (   option(placement(Policy), Options),
+        Policy \== none
+    ->  cpu_nodes(Nodes),
+        assertz(pool_placement(Name, Policy, Nodes, 0))
+    ;   true
+    ).
+
+cpu_nodes(Nodes) :-
+    current_predicate(system:'$cpu_nodes'/1),
+    !,
+    '$cpu_nodes'(Nodes).
+cpu_nodes([CPUs]) :-
+    current_prolog_flag(cpu_count, Count),
+    Max is Count-1,
+    numlist(0, Max, CPUs).
+
+%!  placement_options(+Pool, +ThreadOptions0, -ThreadOptions) is det.
+%
+%   Add an affinity(CPUs) option for the next thread of Pool according
+%   to the placement policy of the pool.
+
+placement_options(Name, ThreadOptions0, ThreadOptions) :-
+    \+ option(affinity(_), ThreadOptions0),
+    retract(pool_placement(Name, Policy, Nodes, Count0)),
+    !,
+    Count is Count0+1,
+    assertz(pool_placement(Name, Policy, Nodes, Count)),
+    placement_cpus(Policy, Count0, Nodes, CPUs),
+    ThreadOptions = [affinity(CPUs)|ThreadOptions0].
+placement_options(_, ThreadOptions, ThreadOptions).
+
+placement_cpus(spread, I, Nodes, CPUs) :-
+    length(Nodes, Count),
+    Index is I mod Count,
+    nth0(Index, Nodes, CPUs).
+placement_cpus(compact, I, Nodes, CPUs) :-
+    foldl(add_length, Nodes, 0, Count),
+    Index is I mod Count,
+    compact_node(Nodes, Index, CPUs).
+placement_cpus(node(Index), _, Nodes, CPUs) :-
+    (   nth0(Index, Nodes, CPUs)
+    ->  true
+    ;   existence_error(numa_node, Index)
+    ).
+
+add_length(List, N0, N) :-
+    length(List, Len),
+    N is N0+Len.
+
+compact_node([CPUs|Nodes], Index, Node) :-
+    length(CPUs, Len),
+    (   Index < Len
+    ->  Node = CPUs
+    ;   Index1 is Index - Len,
+        compact_node(Nodes, Index1, Node)
+    ).
+
+%!  start_job(+Worker, +PoolName, :Goal, +For, +Options) is det.
+%
+%   Hand Goal to an idle Worker and tell For the worker's id.
+
+start_job(Worker, _Name, Goal, For, Options) :-
+    option(at_exit(AtExit), Options, true),
+    thread_send_message(Worker, '$thread_pool'(job(Goal, AtExit))),
+    reply(For, Worker).
+
+%!  stop_workers(+Pool) is det.
+%
+%   Ask the workers of a destroyed worker pool to terminate.  Busy
+%   workers terminate after completing their current job.
+
+stop_workers(wpool(_, _, _, _, _, Workers, _)) :-
+    !,
+    forall(member(Worker, Workers),
+           catch(thread_send_message(Worker, '$thread_pool'(stop)),
+                 _, true)).
+stop_workers(_).
+
+%!  pool_worker(+PoolName)
+%
+%   Main loop of a worker thread.  The failure driven loop discards
+%   the bindings of the job.  We also remove messages left by the job
+%   and trim the stacks, such that a worker does not keep the
+%   resources claimed by a previous job.
+
+:- public
+    pool_worker/1,
+    pool_worker_exitted/2.
+
+pool_worker(Name) :-
+    thread_self(Me),
+    repeat,
+      thread_get_message('$thread_pool'(Job)),
+      (   Job = job(Goal, AtExit)
+      ->  run_job(Goal, Status),
+          catch(AtExit, E, print_message(warning, E)),
+          clear_queue(Me),
+          trim_stacks,
+          thread_send_message('__thread_pool_manager',
+                              job_done(Name, Me, Status)),
+          fail
+      ;   !
+      ).
+
+%   pool_worker_exitted(+PoolName, +Worker)  notifies  the manager if a
+%   worker died while running a job, e.g., due to thread_exit/1.  A
+%   worker that stopped  on  request  succeeds  and  must  not notify
+%   the manager as the pool may have been recreated.
+
+pool_worker_exitted(Name, Worker) :-
+    (   thread_property(Worker, status(true))
+    ->  true
+    ;   worker_exitted(Name, Worker, true)
+    ).
+
+run_job(Goal, Status) :-
+    (   catch(Goal, E, true)
+    ->  (   var(E)
+        ->  Status = true
+        ;   Status = exception(E),
+            print_message(warning, thread_pool(job(Goal, exception(E))))
+        )
+    ;   Status = false,
+        print_message(warning, thread_pool(job(Goal, fail)))
+    ).
+
+%   clear_queue(+Me) discards  messages  left  by  the  job.  A stop
+%   request that arrived while running the job is preserved.
+
+clear_queue(Me) :-
+    thread_get_message(Me, Msg, [timeout(0)]),
+    !,
+    (   Msg == '$thread_pool'(stop)
+    ->  clear_queue(Me),
+        thread_send_message(Me, Msg)
+    ;   clear_queue(Me)
+    ).
+clear_queue(_).
+
 %!  worker_exitted(+PoolName, +WorkerId, :AtExit)
 %
 %   It is possible that  '__thread_pool_manager'   no  longer exists
@@ -454,7 +821,11 @@ reply(To, Term) :-
     thread_send_message(To, thread_pool(true(Term))).
 
 reply_error(To, Error) :-
-    thread_send_message(To, thread_pool(error(Error, _))).
+    (   Error = error(_, _)
+    ->  Reply = Error
+    ;   Reply = error(Error, _)
+    ),
+    thread_send_message(To, thread_pool(Reply)).
 
 wait_reply :-
     thread_get_message(thread_pool(Result)),
@@ -506,3 +877,8 @@ prolog:message(thread_pool(Message)) -->
 
 message(manager_died(Status)) -->
     [ 'Thread-pool: manager died on status ~p; restarting'-[Status] ].
+message(job(Goal, exception(Ex))) -->
+    [ 'Thread-pool: job "~p" raised exception: '-[Goal] ],
+    '$messages':translate_message(Ex).
+message(job(Goal, fail)) -->
+    [ 'Thread-pool: job "~p" failed'-[Goal] ].
@@ -328,6 +328,10 @@ s_to_p_graph([Neib|Neibs], Vertex, [Vertex-Neib|P], Rest_P) :-
     s_to_p_graph(Neibs, Vertex, P, Rest_P).
 
 
+transitive_closure(Graph, Closure) :-
+    '$ugraph_transitive_closure'(Graph, Closure0),
+    !,
+    Closure = Closure0.
 transitive_closure(Graph, Closure) :-
     warshall(Graph, Graph, Closure).
 
@@ -432,12 +436,23 @@ compose1(=, V1, Vs1, V1, N2, G2, SoFar, Comp) :-
 %   The  predicate  top_sort/3  is  a  difference  list  version  of
 %   top_sort/2.
 
+top_sort(Graph, Sorted) :-
+    '$ugraph_top_sort'(Graph, Sorted0, [], Acyclic),
+    !,
+    Acyclic == true,
+    Sorted = Sorted0.
 top_sort(Graph, Sorted) :-
     vertices_and_zeros(Graph, Vertices, Counts0),
     count_edges(Graph, Vertices, Counts0, Counts1),
     select_zeros(Counts1, Vertices, Zeros),
     top_sort(Zeros, Sorted, Graph, Vertices, Counts1).
 
+top_sort(Graph, Sorted0, Sorted) :-
+    '$ugraph_top_sort'(Graph, Sorted1, Sorted2, Acyclic),
+    !,
+    Acyclic == true,
+    Sorted0 = Sorted1,
+    Sorted = Sorted2.
 top_sort(Graph, Sorted0, Sorted) :-
     vertices_and_zeros(Graph, Vertices, Counts0),
     count_edges(Graph, Vertices, Counts0, Counts1),
@@ -593,6 +608,10 @@ complement([V-Ns|G], Vs, [V-INs|NG]) :-
 %   True when Vertices is  an  ordered   set  of  vertices  reachable in
 %   UGraph, including Vertex.
 
+reachable(N, G, Rs) :-
+    '$ugraph_reachable'(N, G, Rs0),
+    !,
+    Rs = Rs0.
 reachable(N, G, Rs) :-
     reachable([N], G, [N], Rs).
 
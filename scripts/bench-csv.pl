@@ -0,0 +1,92 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- use_module(library(csv)).
+:- use_module(library(option)).
+:- use_module(library(pure_input)).
+
+/** <module> Compare the native CSV reader with the DCG
+
+This script writes a CSV file and  times reading it using csv_read_file/3,
+which uses the native record reader, and   using  the csv//2 DCG on the
+same file:
+
+    % swipl scripts/bench-csv.pl
+    ?- bench_csv([count(500000)]).
+*/
+
+%!  bench_csv(+Options) is det.
+%
+%   Options:
+%
+%     - count(+Count)
+%       Number of records to generate.  Default is 200,000.
+%     - file(+File)
+%       File to use.  Default is a temporary file that is deleted
+%       afterwards.
+
+bench_csv(Options) :-
+    option(count(Count), Options, 200000),
+    (   option(file(File), Options)
+    ->  Delete = false
+    ;   tmp_file(csv, File),
+        Delete = true
+    ),
+    write_csv(File, Count),
+    read_time(csv_read_file(File, Rows1, []), Native),
+    read_time(phrase_from_file(csv(Rows2), File), DCG),
+    length(Rows1, Len),
+    assertion(Rows1 == Rows2),
+    Speedup is DCG/Native,
+    format('~D records: native ~3f sec, DCG ~3f sec (~2fx)~n',
+           [Len, Native, DCG, Speedup]),
+    (   Delete == true
+    ->  delete_file(File)
+    ;   true
+    ).
+
+write_csv(File, Count) :-
+    setup_call_cleanup(
+        open(File, write, Out),
+        forall(between(1, Count, I),
+               format(Out, '~d,name~d,"quoted, ""~d""",~d.5,text~n',
+                      [I, I, I, I])),
+        close(Out)).
+
+read_time(Goal, Time) :-
+    garbage_collect,
+    statistics(cputime, T0),
+    call(Goal),
+    statistics(cputime, T1),
+    Time is T1-T0.
@@ -0,0 +1,94 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- use_module(library(option)).
+
+/** <module> Compare the full reader with canonical(true)
+
+This script writes a file of machine generated facts and times reading
+it using read_term/3 with and without the option canonical(true):
+
+    % swipl scripts/bench-read.pl
+    ?- bench_read([count(500000)]).
+*/
+
+%!  bench_read(+Options) is det.
+%
+%   Options:
+%
+%     - count(+Count)
+%       Number of facts to generate.  Default is 200,000.
+%     - file(+File)
+%       File to use.  Default is a temporary file that is deleted
+%       afterwards.
+
+bench_read(Options) :-
+    option(count(Count), Options, 200000),
+    (   option(file(File), Options)
+    ->  Delete = false
+    ;   tmp_file(facts, File),
+        Delete = true
+    ),
+    write_facts(File, Count),
+    read_time(File, [], Full),
+    read_time(File, [canonical(true)], Canonical),
+    Speedup is Full/Canonical,
+    format('~D facts: full ~3f sec, canonical ~3f sec (~2fx)~n',
+           [Count, Full, Canonical, Speedup]),
+    (   Delete == true
+    ->  delete_file(File)
+    ;   true
+    ).
+
+write_facts(File, Count) :-
+    setup_call_cleanup(
+        open(File, write, Out),
+        forall(between(1, Count, I),
+               format(Out, 'fact(a~d, ~d, "s~d", [x,~d], f(g(~d), -1.5)).~n',
+                      [I, I, I, I, I])),
+        close(Out)).
+
+read_time(File, Options, Time) :-
+    garbage_collect,
+    statistics(cputime, T0),
+    setup_call_cleanup(
+        open(File, read, In),
+        ( repeat,
+          read_term(In, Term, Options),
+          Term == end_of_file,
+          !
+        ),
+        close(In)),
+    statistics(cputime, T1),
+    Time is T1-T0.
@@ -0,0 +1,166 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- use_module(library(apply)).
+:- use_module(library(lists)).
+:- use_module(library(option)).
+:- use_module(library(pairs)).
+
+/** <module> Find VMI sequences for superinstructions
+
+This script must be loaded into a version  of SWI-Prolog that is compiled
+with `-DCOUNTING=1`, e.g.
+
+    cmake -DCMAKE_C_FLAGS=-DCOUNTING=1 ..
+
+After running a workload, vmi_sequences/2  writes  the most frequently
+executed VMI sequences to a   file that can be  used to build a system
+with superinstructions for these sequences (see src/mkvmi.c):
+
+    % build.counting/src/swipl scripts/vmi-sequences.pl
+    ?- [workload], run, vmi_sequences('vmi-seq.txt', [top(16)]).
+
+    % cmake -DVMI_FUSION_FILE=$PWD/vmi-seq.txt ..
+
+A system configured using `-DVMI_PROFILE=ON` also  times each executed
+instruction.  vmi_profile/2 writes these timings.  The   target
+`vmi_profile` runs the PGO_PROGRAM using vmi_profile_program/2:
+
+    % cmake -DVMI_PROFILE=ON ..
+    % ninja vmi_profile
+
+Note that the counters are global.  Profile single threaded workloads.
+*/
+
+%!  vmi_sequences(+File, +Options) is det.
+%
+%   Write the most frequently executed VMI sequences to File.  Options:
+%
+%     - top(+Count)
+%       Number of sequences to write.  Default is 16.
+%     - length(+Length)
+%       Either 2 (default) or 3.  Note that a triple A B C defines
+%       the superinstructions A__B and B__C.
+%     - exclude(+List)
+%       Do not write sequences that start with one of the VMI names
+%       in List.
+
+vmi_sequences(File, Options) :-
+    option(top(Top), Options, 16),
+    option(length(Len), Options, 2),
+    option(exclude(Exclude), Options, []),
+    '$vmi_sequences'(Len, Seqs0),
+    exclude(starts_with(Exclude), Seqs0, Seqs1),
+    sort(1, >=, Seqs1, Seqs),
+    length(Seqs, Count),
+    N is min(Top, Count),
+    length(Selected, N),
+    append(Selected, _, Seqs),
+    setup_call_cleanup(
+        open(File, write, Out),
+        ( format(Out, '# Most frequent VMI sequences of length ~d~n', [Len]),
+          forall(member(Times-Names, Selected),
+                 ( atomic_list_concat(Names, ' ', Line),
+                   format(Out, '~d~t~12| ~w~n', [Times, Line])
+                 ))
+        ),
+        close(Out)).
+
+starts_with(Exclude, _-[First|_]) :-
+    memberchk(First, Exclude).
+
+%!  vmi_profile(+File, +Options) is det.
+%
+%   Write the number of calls and the  time spent in each VMI to File,
+%   ordered by the total time.  This requires a system built using
+%   `-DVMI_PROFILE=ON`.  Options:
+%
+%     - top(+Count)
+%       Number of instructions to write.  Default is all.
+
+vmi_profile(File, Options) :-
+    option(top(Top), Options, inf),
+    '$vmi_profile'(Records),
+    map_list_to_pairs(arg(3), Records, Keyed),
+    keysort(Keyed, Sorted0),
+    reverse(Sorted0, Sorted),
+    pairs_values(Sorted, Ordered),
+    setup_call_cleanup(
+        open(File, write, Out),
+        ( format(Out, '# ~w~t~24|~t~w~16+~t~w~16+~t~w~12+~t~w~12+~n',
+                 [instruction, calls, ticks, 'ticks/call', fastest]),
+          forall(( nth1(I, Ordered, vmi(Name, Calls, Ticks, Fastest)),
+                   I =< Top
+                 ),
+                 ( PerCall is Ticks/Calls,
+                   format(Out, '~w~t~24|~t~D~16+~t~D~16+~t~1f~12+~t~D~12+~n',
+                          [Name, Calls, Ticks, PerCall, Fastest])
+                 ))
+        ),
+        close(Out)).
+
+%!  vmi_profile_program(+Program, +Base) is det.
+%
+%   Load Program and write the VMI profile to Base-profile.txt and the
+%   most frequent VMI pairs to Base-seq.txt when the system halts.
+%   Program may halt the system itself.  If Program is a script that
+%   uses initialization/2 with `main`, this goal is run after loading.
+
+vmi_profile_program(Program, Base) :-
+    at_halt(write_vmi_profile(Base)),
+    reset_pentium_profile,
+    load_files(user:Program, []),
+    forall(system:'$init_goal'(when(main), Goal, _Ctx),
+           ignore(user:Goal)),
+    halt.
+
+write_vmi_profile(Base) :-
+    atomic_list_concat([Base, '-profile.txt'], ProfileFile),
+    atomic_list_concat([Base, '-seq.txt'], SeqFile),
+    vmi_profile(ProfileFile, []),
+    vmi_sequences(SeqFile, []),
+    format(user_error, 'Wrote ~w and ~w~n', [ProfileFile, SeqFile]).
+
+%!  vmi_sequences is det.
+%
+%   Print the 20 most frequent pairs and triples.
+
+vmi_sequences :-
+    forall(member(Len, [2,3]),
+           ( '$vmi_sequences'(Len, Seqs0),
+             sort(1, >=, Seqs0, Seqs),
+             format('~nMost frequent sequences of ~d VMIs~n~n', [Len]),
+             forall(( nth1(I, Seqs, Times-Names), I =< 20 ),
+                    format('~D~t~14| ~w~n', [Times, Names]))
+           )).
@@ -84,9 +84,9 @@ numbers are atomic type.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 #define PL_FLI_VERSION      2		/* PL_*() functions */
-#define	PL_REC_VERSION      3		/* PL_record_external(), fastrw */
+#define	PL_REC_VERSION      4		/* PL_record_external(), fastrw */
 #define PL_QLF_LOADVERSION 67		/* load all versions later >= X */
-#define PL_QLF_VERSION     67		/* save version number */
+#define PL_QLF_VERSION     69		/* save version number */
 
 
 		 /*******************************
@@ -207,6 +207,34 @@ typedef union
   } t;
 } term_value_t;
 
+					/* PL_get_text_view() */
+typedef struct
+{ union
+  { const char *t;			/* ISO Latin-1 text */
+    const pl_wchar_t *w;		/* wide text */
+  } text;
+  size_t length;			/* length in characters */
+  int wide;				/* text is in text.w */
+  atom_t atom;				/* atom held by the view or 0 */
+} PL_text_view_t;
+
+					/* values for PL_put_term_cells() */
+typedef struct
+{ int type;				/* PL_ATOM, PL_FUNCTOR, ... */
+  union
+  { atom_t a;				/* PL_ATOM */
+    int64_t i;				/* PL_INTEGER */
+    double f;				/* PL_FLOAT */
+    functor_t functor;			/* PL_FUNCTOR */
+    size_t length;			/* PL_LIST */
+    term_t t;				/* PL_TERM */
+    struct				/* PL_STRING (ISO Latin-1) */
+    { const char *s;
+      size_t length;
+    } text;
+  } value;
+} term_cell_t;
+
 
 #ifndef TRUE
 #define TRUE	(1)
@@ -343,6 +371,21 @@ PL_EXPORT(int)		PL_register_foreign_in_module(const char *module,
 						      int flags, ...);
 PL_EXPORT(void)		PL_load_extensions(const PL_extension *e);
 
+typedef union
+{ int64_t	i;			/* 'i': 64-bit integer */
+  double	f;			/* 'f': float */
+  atom_t	a;			/* 'a': atom */
+} pl_value_t;
+
+typedef int (*pl_typed_function_t)(const pl_value_t *in, pl_value_t *out);
+
+PL_EXPORT(int)		PL_register_typed_foreign_in_module(
+					    const char *module,
+					    const char *name,
+					    const char *signature,
+					    pl_typed_function_t func,
+					    int flags);
+
 		 /*******************************
 		 *	      LICENSE		*
 		 *******************************/
@@ -438,6 +481,7 @@ PL_EXPORT(term_t)	PL_yielded(qid_t qid);
 #define PL_CREATE_INCREMENTAL	0x0020
 
 PL_EXPORT(int)		PL_assert(term_t term, module_t m, int flags);
+PL_EXPORT(int)		PL_assert_all(term_t list, module_t m, int flags);
 
 
 
@@ -457,6 +501,7 @@ PL_EXPORT(atom_t)	PL_new_atom(const char *s);
 PL_EXPORT(atom_t)	PL_new_atom_nchars(size_t len, const char *s);
 PL_EXPORT(atom_t)	PL_new_atom_wchars(size_t len, const pl_wchar_t *s);
 PL_EXPORT(atom_t)	PL_new_atom_mbchars(int rep, size_t len, const char *s);
+PL_EXPORT(atom_t)	PL_new_atom_nchars_adopt(size_t len, char *s);
 PL_EXPORT(const char *)	PL_atom_chars(atom_t a);
 PL_EXPORT(const char *)	PL_atom_nchars(atom_t a, size_t *len);
 PL_EXPORT(const wchar_t *)	PL_atom_wchars(atom_t a, size_t *len);
@@ -498,6 +543,9 @@ PL_EXPORT(int)		PL_get_list_nchars(term_t l,
 PL_EXPORT(int)		PL_get_nchars(term_t t,
 				      size_t *len, char **s,
 				      unsigned int flags) WUNUSED;
+PL_EXPORT(int)		PL_get_text_view(term_t t, PL_text_view_t *view,
+					 unsigned int flags) WUNUSED;
+PL_EXPORT(void)		PL_release_text_view(PL_text_view_t *view);
 PL_EXPORT(int)		PL_get_integer(term_t t, int *i) WUNUSED;
 PL_EXPORT(int)		PL_get_long(term_t t, long *i) WUNUSED;
 PL_EXPORT(int)		PL_get_intptr(term_t t, intptr_t *i) WUNUSED;
@@ -571,6 +619,14 @@ PL_EXPORT(int)		PL_cons_functor(term_t h, functor_t f, ...) WUNUSED;
 PL_EXPORT(int)		PL_cons_functor_v(term_t h, functor_t fd, term_t a0) WUNUSED;
 PL_EXPORT(int)		PL_cons_list(term_t l, term_t h, term_t t) WUNUSED;
 
+			/* bulk term construction and access */
+PL_EXPORT(int)		PL_put_term_cells(term_t t, const term_cell_t *cells,
+					  size_t count) WUNUSED;
+PL_EXPORT(int)		PL_unify_term_cells(term_t t, const term_cell_t *cells,
+					    size_t count) WUNUSED;
+PL_EXPORT(int)		PL_get_term_cells(term_t t, term_cell_t *cells,
+					  size_t *count) WUNUSED;
+
 			/* Unify term-references */
 PL_EXPORT(int)		PL_unify(term_t t1, term_t t2) WUNUSED;
 PL_EXPORT(int)		PL_unify_atom(term_t t, atom_t a) WUNUSED;
@@ -1102,6 +1158,9 @@ PL_EXPORT(int)  PL_sigaction(int sig, pl_sigaction_t *act, pl_sigaction_t *old);
 PL_EXPORT(void)	PL_interrupt(int sig);
 PL_EXPORT(int)	PL_raise(int sig);
 PL_EXPORT(int)	PL_handle_signals(void);
+PL_EXPORT(int)	PL_signal_pending(void);
+PL_EXPORT(void)	PL_set_signal_wakeup(void (*wakeup)(void *closure),
+				     void *closure);
 PL_EXPORT(int)	PL_get_signum_ex(term_t sig, int *n);
 
 
@@ -1179,6 +1238,7 @@ PL_EXPORT(intptr_t)	PL_query(int);	/* get information from Prolog */
 
 #define PL_THREAD_NO_DEBUG	0x01	/* Start thread in nodebug mode */
 #define PL_THREAD_NOT_DETACHED	0x02	/* Allow Prolog to join */
+#define PL_THREAD_TRIM_IDLE	0x04	/* Engine: trim stacks when detached */
 
 typedef enum
 { PL_THREAD_CANCEL_FAILED = FALSE,	/* failed to cancel; try abort */
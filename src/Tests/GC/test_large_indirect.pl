@@ -0,0 +1,94 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+:- module(test_large_indirect,
+	  [ test_large_indirect/0
+	  ]).
+:- use_module(library(plunit)).
+
+/** <module> Test large strings and integers
+
+Large strings and GMP integers are  stored   outside  the global stack.
+Verify they survive garbage collection when   referenced from the stacks
+and global variables and that allocating many of them triggers GC.
+*/
+
+test_large_indirect :-
+	run_tests([ large_indirect
+		  ]).
+
+:- begin_tests(large_indirect).
+
+test(string_gc, Len == 100000) :-
+	big_string(100000, S),
+	garbage_collect,
+	string_length(S, Len),
+	sub_string(S, 0, 1, _, "a").
+test(string_copy, T2 == T) :-
+	big_string(100000, S),
+	T = f(S, x),
+	copy_term(T, T2),
+	garbage_collect.
+test(gvar, [S2 == S, cleanup(nb_delete(test_large))]) :-
+	big_string(100000, S),
+	nb_setval(test_large, S),
+	garbage_collect,
+	nb_getval(test_large, S2).
+test(nb_setarg, X == S) :-
+	big_string(100000, S),
+	T = f(a),
+	nb_setarg(1, T, S),
+	garbage_collect,
+	arg(1, T, X).
+test(mpz, D == 1) :-
+	X is 7^200000,
+	garbage_collect,
+	Y is X+1,
+	garbage_collect,
+	D is Y-X.
+test(reclaim, GC1 > GC0) :-
+	statistics(garbage_collection, [GC0|_]),
+	forall(between(1, 1000, I),
+	       ( format(string(S), "~t~w~100000|", [I]),
+		 string_length(S, _)
+	       )),
+	statistics(garbage_collection, [GC1|_]).
+
+:- end_tests(large_indirect).
+
+big_string(Len, S) :-
+	length(L, Len),
+	maplist(=(0'a), L),
+	string_codes(S, L).
@@ -0,0 +1,73 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(test_stack_shrink,
+	  [ test_stack_shrink/0
+	  ]).
+:- use_module(library(plunit)).
+
+/** <module> Test the stack_shrink_gcs flag
+
+Verify that the global stack shrinks back  after  a  spike if the flag
+stack_shrink_gcs is set and remains at its size otherwise.
+*/
+
+test_stack_shrink :-
+	run_tests([ stack_shrink
+		  ]).
+
+:- begin_tests(stack_shrink).
+
+test(shrink, Size < 4 000 000) :-
+	spike(3, Size).
+test(keep, Size > 4 000 000) :-
+	spike(0, Size).
+
+:- end_tests(stack_shrink).
+
+spike(GCs, Size) :-
+	thread_self(Me),
+	thread_create(spike_worker(GCs, Me), Id, []),
+	thread_join(Id, Status),
+	assertion(Status == true),
+	thread_get_message(global_stack(Size)).
+
+spike_worker(GCs, Parent) :-
+	set_prolog_flag(stack_shrink_gcs, GCs),
+	\+ \+ ( numlist(1, 500 000, L),
+		length(L, _)
+	      ),
+	forall(between(1, 5, _), garbage_collect),
+	statistics(global_stack, [_Used, Free]),
+	thread_send_message(Parent, global_stack(Free)).
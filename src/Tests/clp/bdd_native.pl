@@ -0,0 +1,132 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(bdd_native, [bdd_native/0]).
+:- use_module(library(clpb)).
+:- use_module(library(apply)).
+:- use_module(library(assoc)).
+:- use_module(library(lists)).
+
+/** <test> Native clpb kernels
+
+Compare the C version of apply with its Prolog definition on random
+formulas and check sat_count/2 against enumeration.
+*/
+
+bdd_native :-
+	forall(between(1, 300, Seed), apply_same(Seed)),
+	forall(between(1, 100, Seed), count_same(Seed)),
+	big_count.
+
+apply_same(Seed) :-
+	set_random(seed(Seed)),
+	random_member(Op, [+,*,#]),
+	random_formula(5, 6, F1),
+	random_formula(5, 6, F2),
+	findall(S, apply_shape(native, Op, F1, F2, S), [S1]),
+	findall(S, apply_shape(prolog, Op, F1, F2, S), [S2]),
+	S1 == S2.
+
+apply_shape(Which, Op, F10, F20, Shape) :-
+	copy_term(F10-F20, F1-F2),
+	clpb:parse_sat(F1, Sat1),
+	clpb:parse_sat(F2, Sat2),
+	clpb:sat_bdd(Sat1, A),
+	clpb:sat_bdd(Sat2, B),
+	(   Which == native
+	->  clpb:apply(Op, A, B, Node)
+	;   empty_assoc(G0),
+	    phrase(clpb:apply(Op, A, B, Node), [G0], _)
+	),
+	bdd_shape(Node, Shape).
+
+bdd_shape(Node, Shape) :-
+	(   integer(Node)
+	->  Shape = Node
+	;   Node = node(ID, Var, Low, High, _),
+	    clpb:var_index(Var, Index),
+	    Shape = n(ID, Index, LS, HS),
+	    bdd_shape(Low, LS),
+	    bdd_shape(High, HS)
+	).
+
+count_same(Seed) :-
+	set_random(seed(Seed)),
+	random_formula(6, 8, F),
+	term_variables(F, Vs),
+	aggregate_all(count, (label(Vs), F2 = F, holds(F2)), Expected),
+	sat_count(F, Count),
+	Count == Expected.
+
+label([]).
+label([V|Vs]) :- member(V, [0,1]), label(Vs).
+
+holds(F) :- eval(F, 1).
+
+eval(V, V) :- integer(V), !.
+eval(~A, V) :- eval(A, VA), V is 1-VA.
+eval(A+B, V) :- eval(A, VA), eval(B, VB), V is VA \/ VB.
+eval(A*B, V) :- eval(A, VA), eval(B, VB), V is VA /\ VB.
+eval(A#B, V) :- eval(A, VA), eval(B, VB), V is VA xor VB.
+eval(A=<B, V) :- eval(A, VA), eval(B, VB), ( VA =< VB -> V = 1 ; V = 0 ).
+
+random_formula(NVars, Size, F) :-
+	length(Vs, NVars),
+	random_formula_(Size, Vs, F).
+
+random_formula_(0, Vs, F) :- !,
+	random_member(F, Vs).
+random_formula_(N, Vs, F) :-
+	N1 is N-1,
+	random_member(Op, [+,*,#,=<,~]),
+	(   Op == (~)
+	->  random_formula_(N1, Vs, A),
+	    F = ~A
+	;   random_between(0, N1, NA),
+	    NB is N1-NA,
+	    random_formula_(NA, Vs, A),
+	    random_formula_(NB, Vs, B),
+	    F =.. [Op,A,B]
+	).
+
+%	The unique tables and apply used to exhaust the stacks here.
+
+big_count :-
+	length(Vs, 10000),
+	chain(Vs, Fs),
+	sat_count(*(Fs), Count),
+	Count == 10001.
+
+chain([A,B|T], [A=<B|R]) :- !, chain([B|T], R).
+chain(_, []).
@@ -0,0 +1,110 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(fd_native, [fd_native/0]).
+:- use_module(library(clpfd)).
+:- use_module(library(apply)).
+:- use_module(library(lists)).
+
+/** <test> Native clpfd kernels
+
+Compare the C versions of the all_distinct/1 filtering and the bounds
+of linear sums with their Prolog definitions on random problems.
+*/
+
+fd_native :-
+	forall(between(1, 500, Seed), distinct_same(Seed)),
+	forall(between(1, 500, Seed), sum_bounds_same(Seed)),
+	big_distinct.
+
+distinct_same(Seed) :-
+	filtered(native, Seed, Doms1),
+	filtered(prolog, Seed, Doms2),
+	Doms1 == Doms2.
+
+filtered(Which, Seed, Doms) :-
+	set_random(seed(Seed)),
+	random_between(2, 10, N),
+	random_between(2, 12, M),
+	length(Vs, N),
+	maplist(random_domain(M), Vs),
+	(   (   Which == native
+	    ->  clpfd:distinct(Vs)
+	    ;   clpfd:distinct_(Vs)
+	    )
+	->  maplist(fd_dom, Vs, Doms)
+	;   Doms = fail
+	).
+
+random_domain(M, V) :-
+	random_between(1, M, K),
+	findall(X, (between(1, K, _), random_between(1, M, X)), Xs),
+	foldl(add_value, Xs, 0, Dom),
+	V in Dom.
+
+add_value(X, D0, D0 \/ X).
+
+sum_bounds_same(Seed) :-
+	set_random(seed(Seed)),
+	random_between(1, 8, N),
+	length(Vs, N),
+	maplist(random_bounds, Vs),
+	length(Cs, N),
+	maplist(random_coefficient, Cs),
+	'$fd_sum_bounds'(Cs, Vs, Infs1, Sups1, Inf1, Sup1),
+	clpfd:sum_finite_domains(Cs, Vs, Infs2, Sups2, 0, 0, Inf2, Sup2),
+	[Infs1,Sups1,Inf1,Sup1] == [Infs2,Sups2,Inf2,Sup2].
+
+random_bounds(V) :-
+	random_between(0, 3, K),
+	(   K == 0 -> true
+	;   K == 1 -> V #>= -5
+	;   K == 2 -> V #=< 7
+	;   V in -3..9
+	).
+
+random_coefficient(C) :-
+	random_between(-4, 4, C0),
+	(   C0 == 0 -> C = 1 ; C = C0 ).
+
+%	A problem that is too slow for the Prolog version.
+
+big_distinct :-
+	length(Vs, 300),
+	Vs ins 1..300,
+	all_distinct(Vs),
+	Vs = [1,2|_],
+	nth1(300, Vs, V300),
+	fd_dom(V300, Dom),
+	Dom == 3..300.
@@ -41,6 +41,9 @@ test_arith :-
 		    shift,
 		    errors,
 		    ar_builtin,
+		    ar_float,
+		    ar_int,
+		    ar_fold,
 		    eval,
 		    hyperbolic,
                     minint,
@@ -225,6 +228,139 @@ test(a_fc_minus) :-
 :- end_tests(ar_builtin).
 
 
+:- begin_tests(ar_float).
+
+% compile with optimise to get the float specialised A_*_F instructions
+
+:- dynamic old_optimise/1.
+:- current_prolog_flag(optimise, Old),
+   set_prolog_flag(optimise, true),
+   asserta(old_optimise(Old)).
+
+f1(X, Y, Z) :- Z is X*1.5 + Y/2.0 - 0.25.
+f2(X, Z) :- Z is 10.0 - X.
+f3(X, Z) :- Z is X/0.0.
+f4(X, Z) :- Z is X*1.0e308*10.
+f5(X, Y, Z) :- float(X), A is X*Y, B is A+Y, Z is B-A.
+f6(X, Z) :- ( float(X) -> true ; true ), Z is X - 1.
+
+:- retract(old_optimise(Old)),
+   set_prolog_flag(optimise, Old).
+
+test(float, Z == 4.25) :-
+	f1(2.0, 3.0, Z).
+test(mixed, Z == 4.25) :-
+	f1(2, 3, Z).
+test(order, Z == 7.5) :-
+	f2(2.5, Z).
+test(non_float, Z == 8.0) :-
+	f2(2, Z).
+test(zero_div, error(evaluation_error(zero_divisor))) :-
+	f3(1.0, _).
+test(overflow, error(evaluation_error(float_overflow))) :-
+	f4(1.0, _).
+test(type, error(type_error(evaluable, a/0))) :-
+	f2(a, _).
+test(decompile, Body == (Z is 10.0-X)) :-
+	clause(f2(X, Z), Body).
+test(guard, Z == 3.0) :-
+	f5(2.0, 3, Z).
+test(guard_if_int, Z == 1) :-
+	f6(2, Z).
+test(guard_if_float, Z == 1.0) :-
+	f6(2.0, Z).
+
+:- end_tests(ar_float).
+
+:- begin_tests(ar_int).
+
+% compile with optimise to get the integer fast paths of A_ADD and A_MUL
+
+:- dynamic old_optimise/1.
+:- current_prolog_flag(optimise, Old),
+   set_prolog_flag(optimise, true),
+   asserta(old_optimise(Old)).
+
+i_add(X, Y, Z) :- Z is X+Y.
+i_mul(X, Y, Z) :- Z is X*Y.
+
+:- retract(old_optimise(Old)),
+   set_prolog_flag(optimise, Old).
+
+test(add, Z == 5) :-
+	i_add(2, 3, Z).
+test(add, Z == -1) :-
+	i_add(2, -3, Z).
+test(add, Z == 9223372036854775807) :-
+	i_add(9223372036854775806, 1, Z).
+test(add, Z == -9223372036854775808) :-
+	i_add(-9223372036854775807, -1, Z).
+test(add, [condition(current_prolog_flag(bounded, false)),
+	   Z == 9223372036854775808]) :-
+	i_add(9223372036854775807, 1, Z).
+test(add, [condition(current_prolog_flag(bounded, false)),
+	   Z == -9223372036854775809]) :-
+	i_add(-9223372036854775808, -1, Z).
+test(mul, Z == -6) :-
+	i_mul(2, -3, Z).
+test(mul, Z == 9223372030926249001) :-
+	i_mul(3037000499, 3037000499, Z).
+test(mul, [condition(current_prolog_flag(bounded, false)),
+	   Z == 9223372037000250000]) :-
+	i_mul(3037000500, 3037000500, Z).
+test(mul, [condition(current_prolog_flag(bounded, false)),
+	   Z == 9223372036854775808]) :-
+	i_mul(-9223372036854775808, -1, Z).
+test(mul, Z == 4.5) :-
+	i_mul(3, 1.5, Z).
+
+:- end_tests(ar_int).
+
+
+:- begin_tests(ar_fold).
+
+% compile with optimise to fold constant subexpressions
+
+:- dynamic old_optimise/1.
+:- current_prolog_flag(optimise, Old),
+   set_prolog_flag(optimise, true),
+   asserta(old_optimise(Old)).
+
+fold_const(X) :- X is 2*1024 + (-7) mod 3 + (-7) // 2 + (1 << 4) + 3^3.
+fold_mul(X, Y) :- Y is X*(2*1024).
+fold_big(X) :- X is 2^62 + 2^62.
+fold_zero_div(X) :- X is 1 // 0.
+fold_neg_pow(X) :- X is 2^(-1).
+fold_unit(X, Y) :- Y is X*1 - 0.
+fold_cmp(X) :- X < 2*1024.
+
+:- retract(old_optimise(Old)),
+   set_prolog_flag(optimise, Old).
+
+test(const, X == 2090) :-
+	fold_const(X).
+test(subterm, Y == 6144) :-
+	fold_mul(3, Y).
+test(subterm, Y == 3072.0) :-
+	fold_mul(1.5, Y).
+test(overflow, [condition(current_prolog_flag(bounded, false)),
+		X == 9223372036854775808]) :-
+	fold_big(X).
+test(zero_div, error(evaluation_error(zero_divisor))) :-
+	fold_zero_div(_).
+test(neg_pow, X =:= 0.5) :-
+	fold_neg_pow(X).
+test(unit, Y == -0.0) :-
+	fold_unit(-0.0, Y).
+test(unit, error(type_error(evaluable, foo/0))) :-
+	fold_unit(foo, _).
+test(compare) :-
+	fold_cmp(2047),
+	\+ fold_cmp(2048).
+
+:- end_tests(ar_fold).
+
+
 :- begin_tests(eval).
 
 test(ref, R==6) :-			% Bug#12
@@ -87,4 +87,16 @@ gen_atom(A) :-
 	between(1, infinite, X),
 	atom_concat(aaaa, X, A).
 
+test(mixed, L == [a, 1, [], f(x), "s", 1.5, 100000000000000000000, -7]) :-
+	findall(X, member(X, [a, 1, [], f(x), "s", 1.5,
+			      100000000000000000000, -7]), L).
+test(agc_atomic, Xs == [bbbb1, bbbb2, bbbb3]) :-
+	findall(A,
+		( between(1, 3, I),
+		  atom_concat(bbbb, I, A),
+		  garbage_collect_atoms
+		),
+		Xs),
+	garbage_collect_atoms.
+
 :- end_tests(bags).
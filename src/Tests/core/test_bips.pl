@@ -38,7 +38,8 @@ test_bips :-
 		    arg,
 		    eq,
 		    length,
-		    is_most_general_term
+		    is_most_general_term,
+		    copy_term
 		  ]).
 
 has_occurs_check_flag :-
@@ -259,3 +260,44 @@ test(shared, fail) :-
 	is_most_general_term([_, Y, Y]).
 
 :- end_tests(is_most_general_term).
+
+:- begin_tests(copy_term, [sto(rational_trees)]).
+
+test(shared_vars, C =@= f(X,Y,X,g(Y),a)) :-
+	copy_term(f(X,Y,X,g(Y),a), C).
+test(ground, C == T) :-
+	T = f(a, g(b), [x,y]),
+	copy_term(T, C),
+	same_term(C, T).
+test(ground_arg, true) :-
+	T = f(_, g(b)),
+	copy_term(T, C),
+	arg(2, T, G1), arg(2, C, G2),
+	same_term(G1, G2).
+test(cyclic, C =@= T) :-
+	T = f(T, _, g(a)),
+	copy_term(T, C).
+test(attvar, A == x) :-
+	put_attr(X, test, x),
+	copy_term(f(X,X), f(Y,Z)),
+	Y == Z,
+	get_attr(Y, test, A).
+test(no_attrs, Gs1 == []) :-
+	freeze(X, true),
+	copy_term_nat(f(X,X,Y,Y), C),
+	C = f(A,B,D,E),
+	A == B, D == E, A \== X,
+	term_attvars(C, Gs1).
+test(large, true) :-
+	numlist(1, 100000, L),
+	maplist([I,f(I,V,g(a),V,R)]>>(R=r(R)), L, T),
+	forall(member(G, [copy_term(T, C), duplicate_term(T, C),
+			  copy_term_nat(T, C)]),
+	       ( thread_create(( G, garbage_collect, C =@= T ), Id, []),
+		 thread_join(Id, true)
+	       )),
+	garbage_collect,
+	copy_term(T, C2),
+	C2 =@= T.
+
+:- end_tests(copy_term).
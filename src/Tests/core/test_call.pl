@@ -229,6 +229,20 @@ nested_softcut :-			% Thanks to Frank Schwidom
 	;   false
 	).
 
+test(shared_choice, L == [t(b,b,d), t(a,b,d), t(a,c,e)]) :-
+	findall(T, ( member(X, [0,1,2]), seq_cond(X, T) ), L).
+test(shared_choice, L == [big(2)-x, big(3)-x]) :-
+	findall(R-S, seq_soft([1,2,3], R, S), L).
+
+seq_cond(X, t(A,B,C)) :-		% conditions share a choice slot
+	( X > 0 -> A = a ; A = b ),
+	( \+ X > 1 -> B = b ; B = c ),
+	( ( X == 2 ; X == 3 ) -> C = e ; C = d ).
+
+seq_soft(L, R, S) :-			% *-> slot may not be reused
+	( member(X, L), X > 1 *-> R = big(X) ; R = none ),
+	( R == none -> S = y ; S = x ).
+
 :- end_tests(snip).
 
 
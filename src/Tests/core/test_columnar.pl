@@ -0,0 +1,112 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(test_columnar, [test_columnar/0]).
+:- use_module(library(plunit)).
+:- use_module(library(lists)).
+
+/** <module> Test columnar storage of static fact tables
+
+@author	Jan Wielemaker
+*/
+
+test_columnar :-
+	run_tests([ columnar
+		  ]).
+
+edge(a, b, 1).
+edge(a, c, 2).
+edge(b, c, 3).
+edge(c, a, 4).
+edge(x, x, 5).
+edge(a, b, 6).
+
+wide(a, f(x), 1).
+wide(b, "s", 2).
+
+rule(X) :- edge(X, _, _).
+
+:- begin_tests(columnar).
+
+test(convert, Rows == 6) :-
+	columnar(edge/3),
+	predicate_property(edge(_,_,_), columnar(Rows)).
+test(all, L == [a-b-1,a-c-2,b-c-3,c-a-4,x-x-5,a-b-6]) :-
+	findall(X-Y-Z, edge(X,Y,Z), L).
+test(first, L == [b-1,c-2,b-6]) :-
+	findall(Y-Z, edge(a,Y,Z), L).
+test(second, L == [a,a]) :-
+	findall(X-Z, edge(X,b,Z), L0),
+	pairs_keys(L0, L).
+test(shared, L == [x]) :-
+	findall(X, edge(X,X,_), L).
+test(two, L == [a]) :-
+	findall(X, edge(X,b,6), L).
+test(unindexed, L == [c]) :-
+	findall(X, edge(X,_,4), L).
+test(missing, fail) :-
+	edge(q, _, _).
+test(type, fail) :-
+	edge(1.0, _, _).
+test(det, true) :-
+	edge(c, a, 4).
+test(again, error(permission_error(columnar, procedure, _))) :-
+	columnar(edge/3).
+test(value, error(domain_error(columnar_value, _))) :-
+	columnar(wide/3).
+test(rule, error(permission_error(columnar, procedure, _))) :-
+	columnar(rule/1).
+test(store, L == [a-b-1,a-c-2,b-c-3,c-a-4,x-x-5,a-b-6]) :-
+	tmp_file(store, File),
+	call_cleanup(( columnar_save(File, [edge/3]),
+		       columnar_load(File)
+		     ),
+		     delete_file(File)),
+	predicate_property(edge(_,_,_), columnar(6)),
+	findall(X-Y-Z, edge(X,Y,Z), L).
+test(store_lookup, L == [b-1,c-2,b-6]) :-
+	findall(Y-Z, edge(a,Y,Z), L).
+test(store_not_columnar,
+     error(permission_error(columnar_store, procedure, _))) :-
+	tmp_file(store, File),
+	columnar_save(File, [rule/1]).
+test(store_corrupt, error(domain_error(columnar_store, _))) :-
+	tmp_file(store, File),
+	setup_call_cleanup(
+	    open(File, write, Out),
+	    format(Out, "~`xt~100|~n", []),
+	    close(Out)),
+	call_cleanup(columnar_load(File), delete_file(File)).
+
+:- end_tests(columnar).
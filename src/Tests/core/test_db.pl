@@ -46,6 +46,7 @@ test_db :-
 		    retract,
 		    retractall,
 		    dynamic,
+		    clause,
 		    protect,
 		    res_compiler
 		  ]).
@@ -76,12 +77,27 @@ test(cut_cond, Body = (! -> fail)) :-
 	assert(f :- (! -> fail)),
 	clause(f, Body),
 	retractall(f).
+test(assertz_all, L == [1,2,3,4]) :-
+	assertz(f(1)),
+	assertz_all([f(2),f(3),term,f(4)]),
+	findall(X, f(X), L),
+	retractall(f(_)),
+	retractall(term).
+test(asserta_all, L == [2,3,4,1]) :-
+	assertz(f(1)),
+	asserta_all([f(2),f(3),term,f(4)]),
+	findall(X, f(X), L),
+	retractall(f(_)),
+	retractall(term).
+test(assert_all_atomic, L == []) :-
+	catch(assertz_all([f(1),42]), error(type_error(callable, 42), _), true),
+	findall(X, f(X), L).
 
 :- end_tests(assert).
 
 :- begin_tests(retract).
 
-:- dynamic foo/1, insect/1, icopy/1.
+:- dynamic foo/1, insect/1, icopy/1, queue/1.
 
 test(theorist) :-
 	(   assert((foo(A) :- bar(A))),
@@ -102,6 +118,25 @@ test(update_view, L == [ant,bee]) :-
 	    fail
 	;   findall(I, retract(icopy(I)), L)
 	).
+test(queue, L-Q == [1,2,3,4,5]-[4,5]) :-
+	retractall(queue(_)),
+	forall(between(1, 5, X), assertz(queue(X))),
+	findall(X, ( queue(X),
+		     (   X == 1
+		     ->  retract(queue(1)),
+			 retract(queue(2)),
+			 retract(queue(3))
+		     ;   true
+		     )
+		   ), L),
+	findall(X, queue(X), Q).
+test(queue_asserta, L == [0,3]) :-
+	retractall(queue(_)),
+	forall(between(1, 3, X), assertz(queue(X))),
+	retract(queue(1)),
+	retract(queue(2)),
+	asserta(queue(0)),
+	findall(X, retract(queue(X)), L).
 test(concurrent, [condition(current_prolog_flag(threads,true)),
 		  Sum == ConcurrentSum]) :-
 	N = 10000,
@@ -174,6 +209,39 @@ test_protected_code :-
 	current_prolog_flag(protect_static_code, false),
 	\+ set_prolog_flag(coverage_analysis, true).
 
+:- begin_tests(clause).
+
+:- dynamic
+	c/2, c0/0.
+
+c(1, a) :- true.
+c(X, f(X, Y)) :- Y = X, ground(X).
+c(b, [H|T]) :- member(H, T).
+c0 :- fail.
+
+test(partial_head, L == [ f(b,'$VAR'(0))-('$VAR'(0)=b,ground(b)),
+			  ['$VAR'(0)|'$VAR'(1)]-member('$VAR'(0),'$VAR'(1))
+			]) :-
+	findall(A-B, (clause(c(b, A), B), numbervars(A-B, 0, _)), L).
+test(head_mismatch, fail) :-
+	clause(c(_, g(_)), _).
+test(body, G == X) :-
+	clause(c(X, _), (_=_, ground(G))).
+test(fact, B == true) :-
+	clause(c(1, a), B).
+test(zero_arity, B == fail) :-
+	clause(c0(), B).
+test(attvar_head, [X,G] == [5,5]) :-
+	freeze(Z, true),
+	clause(c(Z, _), (_=X, ground(G))),
+	Z = 5.
+test(attvar_head, fail) :-
+	dif(Z, a),
+	clause(c(Z, _), (_=X, _)),
+	X = a.
+
+:- end_tests(clause).
+
 :- begin_tests(protect, [ setup(set_prolog_flag(protect_static_code, true)),
 			  condition(test_protected_code)
 			]).
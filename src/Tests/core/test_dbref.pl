@@ -42,7 +42,8 @@
 
 test_dbref :-
 	run_tests([ assert2,
-		    recorded
+		    recorded,
+		    record_sharing
 		  ]).
 
 :- begin_tests(assert2).
@@ -88,3 +89,41 @@ test(recorded_vt, [true([K1,K2] == [test_1,test_2]), nondet]) :-
 	erase(R2).
 
 :- end_tests(recorded).
+
+:- begin_tests(record_sharing,
+	       [ setup(set_prolog_flag(record_sharing, true)),
+		 cleanup(set_prolog_flag(record_sharing, false))
+	       ]).
+
+test(share, L =@= [f(a,"s",1.5), f(a,"s",1.5), g(_)]) :-
+	recordz(test_share, f(a,"s",1.5), R1),
+	recordz(test_share, f(a,"s",1.5), R2),
+	recordz(test_share, g(_), R3),
+	findall(T, recorded(test_share, T), L),
+	erase(R1), erase(R2), erase(R3).
+test(erase_one, L == [f(x)]) :-
+	recordz(test_share, f(x), R1),
+	recordz(test_share, f(x), R2),
+	erase(R1),
+	\+ erase(R1),
+	instance(R2, T),
+	T == f(x),
+	findall(X, recorded(test_share, X), L),
+	erase(R2).
+test(erase_while_enumerating, L == [h(1),h(1)]) :-
+	forall(between(1, 3, _), recordz(test_share, h(1))),
+	findall(X, ( recorded(test_share, X, Ref),
+		     erase(Ref),
+		     \+ \+ recorded(test_share, _)
+		   ), L),
+	\+ recorded(test_share, _).
+test(many, true) :-
+	forall(between(1, 1000, I),
+	       ( K is I mod 10,
+		 recordz(test_share, k(K, [a,b,c]))
+	       )),
+	aggregate_all(count, recorded(test_share, k(3, _)), 100),
+	forall(recorded(test_share, _, Ref), erase(Ref)),
+	\+ recorded(test_share, _).
+
+:- end_tests(record_sharing).
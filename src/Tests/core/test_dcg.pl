@@ -32,7 +32,8 @@ test_dcg :-
 		    rule_expansions,
 		    dcg_rule_expansions,
 		    steadfastness,
-		    context
+		    context,
+		    literals
 		  ]).
 
 :- begin_tests(expand_goal).
@@ -268,3 +269,32 @@ test(forprogrammers,
 :- end_tests(context).
 
 
+
+:- begin_tests(literals).
+
+% Literals that are not at the start of the body are compiled using
+% H_CODES.  Test matching, partial lists, decompilation and qlf.
+
+lit --> [], "ab", ( "cd" ; "ce" ).
+lit(X) --> [], "ab", [X], "xyz", "\u00e9!".
+
+test(match, Xs == [abcd,abce]) :-
+	findall(S, (phrase(lit, L), atom_codes(S, L)), Xs).
+test(match, fail) :-
+	phrase(lit, `abcf`).
+test(match, fail) :-
+	phrase(lit, `ab`).
+test(match, X == 0'c) :-
+	phrase(lit(X), `abcxyz\u00e9!`).
+test(partial, T == [X|`xyz\u00e9!`]) :-
+	phrase(lit(X), [0'a,0'b|T], []).
+test(partial, Y-R == 0'y-`z\u00e9!`) :-
+	phrase(lit(_), [_,_,_,0'x,Y|R], []).
+test(partial, L == `abce`) :-
+	freeze(T, T = [0'e|_]),
+	phrase(lit, L, []),
+	L = [_,_,_|T].
+test(clause, B =@= (L0=[0'a,0'b|L1],(L1=[0'c,0'd|L];L1=[0'c,0'e|L]))) :-
+	clause(lit(L0,L), B).
+
+:- end_tests(literals).
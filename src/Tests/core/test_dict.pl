@@ -171,6 +171,21 @@ test('put_dict/4') :-
 test('put_dict/4') :-
 	put_dict(k1, a{}, v1, D),
 	D == a{k1:v1}.
+test('put_dict/4', Pairs == Expected) :-
+	numlist(1, 200, Keys),
+	findall(K-K, (member(K, Keys), K mod 2 =:= 0), Pairs0),
+	dict_pairs(D0, a, Pairs0),
+	foldl([K,Di,Do]>>put_dict(K, Di, K, Do), Keys, D0, D),
+	dict_pairs(D, a, Pairs),
+	findall(K-K, member(K, Keys), Expected).
+test('put_dict/4') :-
+	D0 = a{k1:v1, k2:f(x), k3:v3},
+	put_dict(k2, D0, f(x), D),
+	same_term(D, D0).
+test('put_dict/4') :-
+	put_dict(k2, a{k1:v1, k3:v3}, f(X,X), D),
+	D = a{k1:v1, k2:f(A,B), k3:v3},
+	A == B.
 test('put_dict/3') :-
 	put_dict(n{k1:v2}, a{k1:v1}, D),
 	D == a{k1:v2}.
@@ -45,7 +45,8 @@ Please define a test-set for each predicate.
 
 test_exception :-
 	run_tests([ throw,
-		    ex_coroutining
+		    ex_coroutining,
+		    exception_hook
 		  ]).
 
 :- begin_tests(throw).
@@ -80,3 +81,21 @@ test(non_unify, error(foo)) :-		% verifies error handling in
 	X \= x.
 
 :- end_tests(ex_coroutining).
+
+
+:- begin_tests(exception_hook).
+
+with_hook(Goal) :-
+	setup_call_cleanup(
+	    assertz((user:prolog_exception_hook(hook_test(X),
+						hook_rewritten(X), _, _)),
+		    Ref),
+	    Goal,
+	    erase(Ref)).
+
+test(match, E == hook_rewritten(1)) :-
+	with_hook(catch(throw(hook_test(1)), E, true)).
+test(no_match, E == other(1)) :-
+	with_hook(catch(throw(other(1)), E, true)).
+
+:- end_tests(exception_hook).
@@ -69,6 +69,15 @@ term(compound, f(1, f(2))).
 term(cyclic, X) :- X = f(X).
 term(list, L) :-
 	numlist(-1000, 1000, L).
+term(repeated, f(a, g(a), [b, b, 'B'(b)])).
+term(repeated, L) :-
+	numlist(1, 100, NL),
+	maplist([I,f(A,A,x)]>>atom_number(A, I), NL, L0),
+	append(L0, L0, L).
+term(repeated, [A,A,f(A),A-B,B]) :-
+	atom_codes(A, [0x431, 0x432]),
+	atom_codes(B, [0x432]).
+term(dict, [_{a:x, b:y}, _{a:y}]).
 
 :- begin_tests(fastrw, [sto(rational_trees)]).
 
@@ -93,6 +102,12 @@ read_and_check(In, T) :-
 	fast_read(In, T2),
 	assertion(T =@= T2).
 
+test(version3, [ condition(current_prolog_flag(address_bits, 64)),
+		 T == f(a,g(a),[b,b,'B'(b)])
+	       ]) :-
+	string_codes(S, [114,34,17,13,3,11,1,102,11,1,97,13,1,11,1,103,11,1,
+			 97,8,11,1,98,8,11,1,98,8,13,1,11,1,66,11,1,98,9]),
+	fast_term_serialized(T, S).
 test(error, error(permission_error(fast_serialize, blob, S))) :-
 	setup_call_cleanup(
 	    ( open_null_stream(S),
@@ -101,4 +116,54 @@ test(error, error(permission_error(fast_serialize, blob, S))) :-
 	    fast_write(S, a(X,X,S)),
 	    close(S)).
 
+test(atom_table) :-
+	findall(T, term(_,T), L0),
+	append(L0, L0, L),
+	fast_atom_table(WT),
+	fast_atom_table(RT),
+	setup_call_cleanup(
+	    tmp_file_stream(binary, File, Out),
+	    forall(member(T, L), fast_write(Out, T, [atom_table(WT)])),
+	    close(Out)),
+	setup_call_cleanup(
+	    open(File, read, In, [type(binary)]),
+	    ( maplist(read_and_check(In, [atom_table(RT)]), L),
+	      fast_read(In, EOF, [atom_table(RT)]),
+	      assertion(EOF == end_of_file)
+	    ),
+	    close(In)),
+	delete_file(File).
+test(atom_table_error) :-
+	fast_atom_table(WT),
+	fast_atom_table(RT),
+	setup_call_cleanup(
+	    tmp_file_stream(binary, File, Out),
+	    ( catch(fast_write(Out, f(not_sent, Out), [atom_table(WT)]),
+		    error(permission_error(fast_serialize, blob, _), _),
+		    true),
+	      fast_write(Out, g(not_sent), [atom_table(WT)])
+	    ),
+	    close(Out)),
+	setup_call_cleanup(
+	    open(File, read, In, [type(binary)]),
+	    read_and_check(In, [atom_table(RT)], g(not_sent)),
+	    close(In)),
+	delete_file(File).
+test(atom_table_plain, error(syntax_error(fastrw_magic_expected))) :-
+	fast_atom_table(WT),
+	setup_call_cleanup(
+	    tmp_file_stream(binary, File, Out),
+	    fast_write(Out, f(a), [atom_table(WT)]),
+	    close(Out)),
+	setup_call_cleanup(
+	    open(File, read, In, [type(binary)]),
+	    fast_read(In, _),
+	    ( close(In),
+	      delete_file(File)
+	    )).
+
+read_and_check(In, Options, T) :-
+	fast_read(In, T2, Options),
+	assertion(T =@= T2).
+
 :- end_tests(fastrw).
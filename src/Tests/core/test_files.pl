@@ -46,7 +46,8 @@ This module is a Unit test for Prolog file-handling primitives.
 */
 
 test_files :-
-	run_tests([ files
+	run_tests([ files,
+		    wildcard
 		  ]).
 
 :- begin_tests(files).
@@ -182,3 +183,36 @@ long_segment(N, Seg) :-
 	atom_chars(Seg, L).
 
 :- end_tests(files).
+
+:- begin_tests(wildcard).
+
+test(match) :-
+	wildcard_match('[a-z]*.{pro,pl}[%~]', 'a_hello.pl%').
+test(match, fail) :-
+	wildcard_match('*.{pl,c}', 'a.h').
+test(match_cached) :-
+	forall(between(1, 3, _),
+	       wildcard_match('x*y', xaby)).
+test(last_alternative, fail) :-
+	wildcard_match('{a,b}', c).
+test(set, M == ['*.pl', 'test_*']) :-
+	wildcard_pattern_set(['*.pl', '*.{c,h}', 'test_*'], Set),
+	wildcard_set_match(Set, 'test_x.pl', M).
+test(set, M == []) :-
+	wildcard_pattern_set([], Set),
+	wildcard_set_match(Set, abc, M).
+test(set_as_loop) :-
+	Patterns = [ '*.pl', 'a?c', '[a-c]*x', '{foo,bar}*', '{a,b,c}', '*',
+		     'x*y*z', '{a*,*b}c', '{ab,abc}d', ab
+		   ],
+	wildcard_pattern_set(Patterns, Set),
+	forall(member(Name, [ 'foo.pl', abc, bx, cxx, barbaz, a, d, '',
+			      xaybzz, bc, abd, abcd
+			    ]),
+	       ( include([P]>>wildcard_match(P, Name), Patterns, Expected),
+		 wildcard_set_match(Set, Name, Expected)
+	       )).
+test(set, error(type_error(wildcard_pattern_set, foo))) :-
+	wildcard_set_match(foo, a, _).
+
+:- end_tests(wildcard).
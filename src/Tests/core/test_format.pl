@@ -60,5 +60,17 @@ test(atom, A == 'a\n') :-
 	format(atom(A), 'a\n', []).
 test(atom, A == '--++') :-
 	format(atom(A), '~`-t~`+t~4+', []).
+test(compiled, L == ['a    1|~', 'b    22|~', 'c    333|~']) :-
+	findall(A, ( member(X-N, [a-1, b-22, c-333]),
+		     format(atom(A), '~w~t~*|~d|~~', [X, 5, N])
+		   ), L).
+test(integer, L == ['0','7','-7','99','-100','12345',
+		    '9223372036854775807','-9223372036854775808',
+		    '-9223372036854775809','123.45','FF']) :-
+	maplist([F-X,A]>>format(atom(A), F, [X]),
+		[ '~d'-0, '~d'-7, '~d'-(-7), '~d'-99, '~d'-(-100), '~w'-12345,
+		  '~d'-9223372036854775807, '~w'-(-9223372036854775808),
+		  '~d'-(-9223372036854775809), '~2d'-12345, '~16R'-255
+		], L).
 
 :- end_tests(format).
@@ -0,0 +1,133 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(test_hash_map, [test_hash_map/0]).
+:- use_module(library(plunit)).
+:- use_module(library(lists)).
+
+/** <module> Test native hash maps
+
+@author	Jan Wielemaker
+*/
+
+test_hash_map :-
+	run_tests([ hash_map
+		  ]).
+
+:- begin_tests(hash_map).
+
+test(create, true) :-
+	hash_map_create(M),
+	is_hash_map(M),
+	hash_map_size(M, 0).
+test(not_a_map, fail) :-
+	is_hash_map(foo).
+test(type, error(type_error(hash_map, foo))) :-
+	hash_map_put(foo, a, 1).
+test(put_get, V == f(x, "s", 1.5)) :-
+	hash_map_create(M),
+	hash_map_put(M, key(1), f(x, "s", 1.5)),
+	hash_map_get(M, key(1), V).
+test(missing, fail) :-
+	hash_map_create(M),
+	hash_map_put(M, a, 1),
+	hash_map_get(M, b, _).
+test(replace, [V,N] == [2,1]) :-
+	hash_map_create(M),
+	hash_map_put(M, a, 1),
+	hash_map_put(M, a, 2),
+	hash_map_get(M, a, V),
+	hash_map_size(M, N).
+test(equal_keys, [V1,V2] == [int,float]) :-
+	hash_map_create(M),
+	hash_map_put(M, 1, int),
+	hash_map_put(M, 1.0, float),
+	hash_map_get(M, 1, V1),
+	hash_map_get(M, 1.0, V2).
+test(nonground_key, error(instantiation_error)) :-
+	hash_map_create(M),
+	hash_map_put(M, f(_), 1).
+test(value_vars, true) :-
+	hash_map_create(M),
+	hash_map_put(M, a, f(X,X,_)),
+	hash_map_get(M, a, V1),
+	hash_map_get(M, a, V2),
+	V1 =@= f(Y,Y,_),
+	V2 =@= V1,
+	V1 \== V2.
+test(delete, [S0,S1] == [2,1]) :-
+	hash_map_create(M, [a-1, b-2]),
+	hash_map_size(M, S0),
+	hash_map_delete(M, a),
+	\+ hash_map_delete(M, a),
+	\+ hash_map_get(M, a, _),
+	hash_map_get(M, b, 2),
+	hash_map_size(M, S1).
+test(bulk, Pairs == Expected) :-
+	numlist(1, 1000, L),
+	findall(K-v(K), member(K, L), Expected),
+	hash_map_create(M, Expected),
+	hash_map_size(M, 1000),
+	hash_map_pairs(M, Pairs0),
+	msort(Pairs0, Pairs).
+test(bulk_pair, error(type_error(pair, a))) :-
+	hash_map_create(_, [a]).
+test(enum, Pairs == [a-1, b-2, c-3]) :-
+	hash_map_create(M, [a-1, b-2, c-3]),
+	findall(K-V, hash_map_key_value(M, K, V), Pairs0),
+	msort(Pairs0, Pairs).
+test(enum_update, Pairs == [a-1, b-2]) :-
+	hash_map_create(M, [a-1, b-2]),
+	findall(K-V,
+		( hash_map_key_value(M, K, V),
+		  hash_map_delete(M, K),
+		  hash_map_put(M, new(K), V)
+		), Pairs0),
+	msort(Pairs0, Pairs),
+	hash_map_size(M, 2).
+test(enum_cut, true) :-
+	hash_map_create(M, [a-1, b-2, c-3]),
+	once(hash_map_key_value(M, _, _)).
+test(enum_ground) :-
+	hash_map_create(M, [a-1, b-2]),
+	hash_map_key_value(M, b, 2).
+test(delete_all, N == 0) :-
+	numlist(1, 500, L),
+	findall(K-K, member(K, L), Pairs),
+	hash_map_create(M, Pairs),
+	forall(member(K, L), hash_map_delete(M, K)),
+	hash_map_size(M, N),
+	hash_map_pairs(M, []).
+
+:- end_tests(hash_map).
@@ -36,6 +36,7 @@
 :- module(test_io, [test_io/0]).
 :- use_module(library(plunit)).
 :- use_module(library(debug)).
+:- use_module(library(readutil)).
 
 /** <module> Test Prolog core I/O
 
@@ -47,7 +48,8 @@ of these these are in pre-unit test format in the main test.pl
 
 test_io :-
 	run_tests([ io,
-		    stream_pair
+		    stream_pair,
+		    wait_set
 		  ]).
 
 :- begin_tests(io, [sto(rational_trees)]).
@@ -97,6 +99,142 @@ test(reuse_alias, error(permission_error(open, source_sink, alias(a)))) :-
 	    ),
 	    open(nonexisting, read, _In, [alias(a)]),
 	    close(S)).
+test(grow_buffer, [Lines == 100000, Size > 4096]) :-
+	tmp_file_stream(text, File, Out),
+	forall(between(1, 100000, I), format(Out, '~d~n', [I])),
+	stream_property(Out, buffer_size(Size)),
+	close(Out),
+	read_file_to_string(File, String, []),
+	split_string(String, "\n", "", Parts),
+	length(Parts, Len),
+	Lines is Len-1,
+	delete_file(File).
+test(mmap, Terms-Line == [a(1),a(2),a(3)]-"a(2).") :-
+	tmp_file_stream(text, File, Out),
+	forall(between(1, 3, I), format(Out, 'a(~d).~n', [I])),
+	close(Out),
+	setup_call_cleanup(
+	    open(File, read, In, [mmap(true)]),
+	    ( findall(T, ( repeat,
+			   read(In, T),
+			   ( T == end_of_file -> !, fail ; true )
+			 ), Terms),
+	      seek(In, 6, bof, _),
+	      read_line_to_string(In, Line)
+	    ),
+	    close(In)),
+	delete_file(File).
+test(read_ahead, Terms-T == [a(1),a(2),a(3)]-a(2)) :-
+	tmp_file_stream(text, File, Out),
+	forall(between(1, 3, I), format(Out, 'a(~d).~n', [I])),
+	close(Out),
+	setup_call_cleanup(
+	    open(File, read, In, [read_ahead(65536)]),
+	    ( findall(T0, ( repeat,
+			    read(In, T0),
+			    ( T0 == end_of_file -> !, fail ; true )
+			  ), Terms),
+	      seek(In, 6, bof, _),
+	      read(In, T)
+	    ),
+	    close(In)),
+	delete_file(File).
+test(copy_stream_data, Copied == Expected) :-
+	numlist(1, 10000, L),
+	atomic_list_concat(L, ',', Data),
+	sub_atom(Data, 100, 20000, _, Expected),
+	tmp_file_stream(octet, In, Out0),
+	write(Out0, Data),
+	close(Out0),
+	tmp_file_stream(octet, Copy, Out1),
+	setup_call_cleanup(
+	    open(In, read, S, [type(binary)]),
+	    ( seek(S, 100, bof, _),
+	      copy_stream_data(S, Out1, 20000)
+	    ),
+	    close(S)),
+	close(Out1),
+	read_file_to_string(Copy, CopiedS, []),
+	atom_string(Copied, CopiedS),
+	delete_file(In),
+	delete_file(Copy).
+test(zstream, [T2-Line == T-"done"]) :-
+	numlist(1, 10000, L),
+	T = f(L),
+	tmp_file_stream(octet, File, Out0),
+	open_zstream(Out0, Out, [format(gzip)]),
+	fast_write(Out, T),
+	format(Out, 'done~n', []),
+	close(Out),
+	setup_call_cleanup(
+	    ( open(File, read, In0, [type(binary)]),
+	      open_zstream(In0, In, [])
+	    ),
+	    ( fast_read(In, T2),
+	      read_line_to_string(In, Line)
+	    ),
+	    close(In)),
+	delete_file(File).
+test(owner, [ condition(current_prolog_flag(threads, true)),
+	      Text == "a\nb\nc\n"
+	    ]) :-
+	tmp_file_stream(text, File, Out0),
+	close(Out0),
+	open(File, write, Out, [owner(true)]),
+	format(Out, 'a~n', []),
+	thread_create(format(Out, 'b~n', []), Id, []),
+	thread_join(Id, true),
+	format(Out, 'c~n', []),
+	close(Out),
+	read_file_to_string(File, Text, []),
+	delete_file(File).
+test(large_write, T2 == T) :-
+	numlist(1, 100000, L),
+	T = f(L),
+	tmp_file_stream(binary, File, Out),
+	fast_write(Out, T),
+	close(Out),
+	setup_call_cleanup(
+	    open(File, read, In, [type(binary)]),
+	    fast_read(In, T2),
+	    close(In)),
+	delete_file(File).
+test(read_string, Parts-Line:Col == ["ab","cd","efgh"]-3:0) :-
+	setup_call_cleanup(
+	    open_string("ab\r\ncd\tx,efgh\n", In),
+	    ( read_string(In, "\n", "\r", _, L1),
+	      read_string(In, ",", "", _, L2),
+	      read_string(In, "\n", "", _, L3),
+	      split_string(L2, "\t", "", [L2a|_]),
+	      Parts = [L1,L2a,L3],
+	      line_count(In, Line),
+	      line_position(In, Col)
+	    ),
+	    close(In)).
+test(read_line_to_codes, Lines == ["ab", "cd", "", "x\u00e9y", end_of_file]) :-
+	setup_call_cleanup(
+	    open_string("ab\r\ncd\n\nx\u00e9y", In),
+	    findall(L, ( between(1, 5, _),
+			 read_line_to_codes(In, L0),
+			 (L0 == end_of_file -> L = L0 ; string_codes(L, L0)) ),
+		    Lines),
+	    close(In)).
+test(read_line_to_codes, Lines == [`ab\r\n`-open, `y`-[], []-[]]) :-
+	setup_call_cleanup(
+	    open_string("ab\r\ny", In),
+	    findall(L-T, ( between(1, 3, _),
+			   read_line_to_codes(In, L, T0),
+			   (var(T0) -> T0 = [], T = open ; T = T0) ),
+		    Lines),
+	    close(In)).
+test(write_lines, S == "a\nb\u00e9\ncd\nef\n\n") :-
+	with_output_to(string(S),
+		       ( current_output(Out),
+			 write_lines(Out, [a, "b\u00e9", `cd`, [e,f], ""]) )).
+test(write_lines, error(type_error(text, f(x)))) :-
+	with_output_to(string(_),
+		       ( current_output(Out),
+			 write_lines(Out, [f(x)]) )).
 
 :- end_tests(io).
 
@@ -119,3 +257,52 @@ test(close, true) :-
 	assertion(var(Out)).
 
 :- end_tests(stream_pair).
+
+:- begin_tests(wait_set, [ condition(( current_predicate(wait_set_create/1),
+				       \+ current_prolog_flag(windows, true)
+				     ))
+			 ]).
+
+echo_stream(Text, In) :-
+	format(atom(Cmd), 'echo ~w', [Text]),
+	open(pipe(Cmd), read, In, [bom(false)]).
+
+test(once, Ready-Again == [In]-[]) :-
+	wait_set_create(Set),
+	echo_stream(hello, In),
+	call_cleanup(( wait_set_add(Set, In),
+		       wait_set_wait(Set, Ready, 10),
+		       wait_set_wait(Set, Again, 0)
+		     ),
+		     close(In)).
+test(buffered, Ready == [In]) :-
+	wait_set_create(Set),
+	echo_stream(hello, In),
+	call_cleanup(( wait_set_add(Set, In),
+		       wait_set_wait(Set, [In], 10),
+		       get_char(In, h),
+		       wait_set_add(Set, In),
+		       wait_set_wait(Set, Ready, 0)
+		     ),
+		     close(In)).
+test(remove, Ready == []) :-
+	wait_set_create(Set),
+	echo_stream(hello, In),
+	call_cleanup(( wait_set_add(Set, In),
+		       wait_set_remove(Set, In),
+		       wait_set_wait(Set, Ready, 0.1)
+		     ),
+		     close(In)).
+test(closed, Ready == []) :-
+	wait_set_create(Set),
+	echo_stream(hello, In),
+	read_line_to_string(In, _),
+	wait_set_add(Set, In),
+	close(In),
+	wait_set_wait(Set, Ready, 0.1).
+test(destroy, error(existence_error(wait_set, Set))) :-
+	wait_set_create(Set),
+	wait_set_destroy(Set),
+	wait_set_wait(Set, _, 0).
+
+:- end_tests(wait_set).
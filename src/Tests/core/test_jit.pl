@@ -75,14 +75,15 @@ not_hashed(P) :-
 	\+ predicate_property(P, indexed(_)).
 
 
-test(remove, [cleanup(retractall(d(_,_)))]) :-
+test(grow, [cleanup(retractall(d(_,_)))]) :-
 	forall(between(1,50,X), assertz(d(X,X))),
 	d(_,30),
 	assertion(has_hashes(d(_,_), [2])),
 	forall(between(51,125,X), assertz(d(X,X))),
-	assertion(not_hashed(p(_,_))),
 	d(30,_),
-	assertion(has_hashes(d(_,_), [1])).
+	assertion(has_hashes(d(_,_), [1,2])),
+	forall(between(126,200,X), assertz(d(X,X))),
+	assertion(index_buckets(d(_,_), 2, 128)).
 test(remove, [cleanup(retractall(d(_,_)))]) :-
 	forall(between(1,40,X), assertz(d(X,a))),
 	forall(between(41,50,X), assertz(d(X,X))),
@@ -173,6 +174,155 @@ test_index_2(Convert) :-
 	       )),
 	assertion(has_hashes(d(_,_), [2])).
 
+test(multi3, [cleanup(retractall(d4(_,_,_,_)))]) :-
+	forall(between(0, 999, I),
+	       (   d4_key(I, A, B, C),
+		   assertz(d4(A, B, C, I))
+	       )),
+	forall(between(0, 999, I),
+	       (   d4_key(I, A, B, C),
+		   assertion((d4(A, B, C, I2), I2 == I))
+	       )),
+	assertion(has_hashes(d4(_,_,_,_), [[1,2,3]])).
+
+:- dynamic
+	d4/4.
+
+d4_key(I, A, B, C) :-
+	A is I mod 10,
+	B is (I//10) mod 10,
+	C is I//100.
+
+r(1, one).
+r(2.0, two).
+r(3, three).
+r(3, drie).
+r(b, bee).
+r(f(x), fx).
+r(5, five).
+
+rv(1, one).
+rv(_, any).
+
+rs(1, one).
+rs("a", str_a).
+rs(a, ay).
+rs(c, cee).
+rs("b", str_b).
+
+test(range, L == [1-one,2.0-two,3-drie,3-three]) :-
+	findall(K-V, call_range(r(K,V), 1, 0, 3), L0),
+	msort(L0, L).
+test(range, L == [b-bee]) :-
+	findall(K-V, call_range(r(K,V), 1, a, z), L).
+test(range, L == [2.0-two,3-drie,3-three,5-five,b-bee]) :-
+	findall(K-V, call_range(r(K,V), 1, 1.5, c), L0),
+	msort(L0, L).
+test(range, L == [1-one]) :-
+	findall(K-V, call_range(rv(K,V), 1, 0, 3), L).
+test(range_strings, Keys == [1,a]) :-
+	'$range_keys'(rs(_,_), 1, 0, b, Keys).
+test(range_strings, L == [1-one,a-ay,c-cee]) :-
+	findall(K-V, call_range(rs(K,V), 1, 0, z), L0),
+	msort(L0, L).
+test(range_dynamic, [cleanup(retractall(d(_,_))), L == [4,5,6]]) :-
+	forall(between(1, 10, I), assertz(d(I, I))),
+	findall(I, call_range(d(I,_), 1, 4, 6), L0),
+	msort(L0, L0s),
+	retract(d(5,5)),
+	assertz(d(5,x)),
+	findall(I, call_range(d(I,_), 1, 4, 6), L1),
+	msort(L1, L),
+	assertion(L0s == L).
+
+test(index_statistics, [ cleanup(( set_prolog_flag(index_statistics, Old),
+				    retractall(d(_,_)) )),
+			 Stats = [calls(10),indexed(10),_,linear(0),tried(10)|_]
+		       ]) :-
+	forall(between(1, 100, I), assertz(d(I, I))),
+	current_prolog_flag(index_statistics, Old),
+	set_prolog_flag(index_statistics, true),
+	forall(between(1, 10, I), d(I, _)),
+	set_prolog_flag(index_statistics, false),
+	predicate_property(d(_,_), index_statistics(Stats)).
+
+test(resize, [cleanup(retractall(d(_,_))), Len == 10000]) :-
+	forall(between(1, 100, X), assertz(d(X,X))),
+	d(50, _),
+	index_buckets(d(_,_), 1, B0),
+	forall(between(101, 10000, X),
+	       ( assertz(d(X,X)),
+		 Y is X//2,
+		 d(Y, Z),
+		 assertion(Z == Y)
+	       )),
+	index_buckets(d(_,_), 1, B),
+	assertion(B > B0),
+	forall(between(1, 10000, X), findall(V, d(X,V), [X])),
+	findall(X, d(X,_), All),
+	length(All, Len).
+test(resize_update, [cleanup(retractall(d(_,_))), L == [a,1,x,2,3]]) :-
+	forall(between(1, 100, X), assertz(d(X,X))),
+	d(50, _),
+	forall(between(101, 3000, X),
+	       ( assertz(d(X,X)),
+		 (   X mod 500 =:= 0
+		 ->  retract(d(X,X)),
+		     asserta(d(X,a))
+		 ;   true
+		 )
+	       )),
+	assertz(d(1,x)),
+	findall(V, (member(X,[1000,1,2,3]), d(X,V)), L).
+
+index_buckets(P, Arg, Buckets) :-
+	predicate_property(P, indexed(Indexed)),
+	memberchk(single(Arg)-hash(Buckets,_,_,_), Indexed).
+
+test(background, [ condition(current_prolog_flag(gc_thread, true)),
+		   setup(current_prolog_flag(index_background, Old)),
+		   cleanup(( set_prolog_flag(index_background, Old),
+			     retractall(d(_,_)) )),
+		   Len-L == 1000-[500]
+		 ]) :-
+	forall(between(1, 1000, I), assertz(d(a, I))),
+	set_prolog_flag(index_background, 100),
+	assertion(d(a, 500)),
+	assertion(wait_for_hash(d(_,_), [2], 1000)),
+	findall(X, d(a, X), All),
+	length(All, Len),
+	findall(X, (X = 500, d(a, X)), L).
+
+% wait_for_hash(:Head, +Hashes, +MaxTries)
+%
+% Poll until the gc thread has published the  index.  The index is only
+% visible in the  indexed  property  after  it  is  complete.
+
+wait_for_hash(P, Hashes, _) :-
+	has_hashes(P, Hashes),
+	!.
+wait_for_hash(P, Hashes, N) :-
+	N > 0,
+	sleep(0.01),
+	N2 is N - 1,
+	wait_for_hash(P, Hashes, N2).
+
+opc(add, 1).
+opc(sub, 2).
+opc(mul, 3).
+opc([],  4).
+
+test(switch, L == [3,4]) :-
+	opc(mul, A),
+	opc([], B),
+	L = [A,B].
+test(switch, fail) :-
+	opc(div, _).
+test(switch, fail) :-
+	opc(1, _).
+test(switch, L == [add-1,sub-2,mul-3,[]-4]) :-
+	findall(K-V, opc(K,V), L).
+
 p1(a(b(c(d(e(f(g(1)))))))).
 p1(a(b(c(d(e(f(g(2)))))))).
 
@@ -39,9 +39,11 @@
 :- use_module(library(plunit)).
 :- use_module(library(terms)).
 :- use_module(library(apply)).
+:- use_module(library(lists)).
 
 test_list :-
-	run_tests([ memberchk
+	run_tests([ memberchk,
+		    numeric_lists
 		  ]).
 
 :- begin_tests(memberchk, []).
@@ -50,3 +52,40 @@ test(memberchk, X == y) :-		% Verify unbinding after failing PL_unify()
 	memberchk(f(X,a), [f(x,b), f(y,a)]).
 
 :- end_tests(memberchk).
+
+:- begin_tests(numeric_lists, []).
+
+test(sum_int, S == 6) :-
+	sum_list([1,2,3], S).
+test(sum_empty, S == 0) :-
+	sum_list([], S).
+test(sum_mixed, S == 4.5) :-
+	sum_list([1,2,1.5], S).
+test(sum_overflow, [condition(current_prolog_flag(bounded, false)),
+		    S == 9223372036854775808]) :-
+	sum_list([9223372036854775807, 1], S).
+test(sum_rational, [condition(current_prolog_flag(bounded, false)),
+		    S == 5r4]) :-
+	sum_list([1, 1r4], S).
+test(sum_type, error(type_error(evaluable, a/0))) :-
+	sum_list([1,a], _).
+test(max_int, M == 3) :-
+	max_list([1,3,2], M).
+test(max_float, M == 0.0) :-
+	max_list([-0.0, 0.0], M).
+test(max_mixed, M == 2.5) :-
+	max_list([1, 2.5, 2], M).
+test(max_empty, fail) :-
+	max_list([], _).
+test(min_float, M == -0.0) :-
+	min_list([0.0, -0.0, 1.0], M).
+test(min_int, M == -1) :-
+	min_list([1, -1, 0], M).
+test(numlist, L == [1,2,3]) :-
+	numlist(1, 3, L).
+test(numlist, fail) :-
+	numlist(3, 1, _).
+test(numlist, error(type_error(integer, a))) :-
+	numlist(a, 1, _).
+
+:- end_tests(numeric_lists).
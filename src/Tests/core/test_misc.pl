@@ -43,7 +43,9 @@ Tests that are hard to classify
 */
 
 test_misc :-
-	run_tests([ misc
+	run_tests([ misc,
+		    det_guard,
+		    tidy_trail
 		  ]).
 
 :- begin_tests(misc).
@@ -67,3 +69,73 @@ test(cut_to_cleanup) :-
 	retract(cl).
 
 :- end_tests(misc).
+
+:- begin_tests(det_guard).
+
+:- set_prolog_flag(optimise, true).	% inline arithmetic
+
+max(X, Y, X) :- X >= Y.
+max(X, Y, Y) :- X < Y.
+
+sign(X, S) :- 0 > X, S = -1.
+sign(X, S) :- X >= 0, S = 1.
+
+kind(X, int) :- integer(X).
+kind(X, atom) :- atom(X).
+
+kind2(X, int) :- integer(X).
+kind2(X, num) :- number(X).
+
+bound(X, B) :- var(X), B = false.
+bound(X, B) :- nonvar(X), B = true.
+
+det(Goal) :-
+	call_cleanup(Goal, Det=true),
+	Det == true.
+
+test(max) :-
+	det(max(3, 1, M1)), M1 == 3,
+	det(max(1, 3, M2)), M2 == 3.
+test(const) :-
+	det(sign(-2, S1)), S1 == -1,
+	det(sign(2, S2)), S2 == 1.
+test(type) :-
+	det(kind(1, K1)), K1 == int,
+	det(kind(a, K2)), K2 == atom.
+test(overlap, all(K == [int, num])) :-
+	kind2(1, K).
+test(unbound, all(B == [false])) :-
+	bound(_, B).
+test(bound_by_head, M == 3) :-
+	max(M, 1, 3).
+
+:- end_tests(det_guard).
+
+:- begin_tests(tidy_trail,
+	       [ setup(set_prolog_flag(tidy_trail, true)),
+		 cleanup(set_prolog_flag(tidy_trail, false))
+	       ]).
+
+tt_loop([]) :- !.
+tt_loop([X|T]) :- tt_p(X), !, tt_loop(T).
+
+tt_p(a).
+tt_p(b).
+
+test(bindings, L == [a,a,a]) :-
+	length(L, 3),
+	tt_loop(L).
+test(undo) :-
+	length(L, 3),
+	(   tt_loop(L), fail
+	;   true
+	),
+	maplist(var, L).
+test(statistics, After > Before) :-
+	statistics(trail_tidied, Before),
+	numlist(1, 1000, L0),
+	maplist([_,_]>>true, L0, L),
+	tt_loop(L),
+	statistics(trail_tidied, After).
+
+:- end_tests(tidy_trail).
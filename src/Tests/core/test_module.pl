@@ -97,4 +97,18 @@ test(mqual, [sto(rational_trees),
 	T = a:T,
 	mqual(T).
 
+test(resolve, L == [user, local, super]) :-	% resolveProcedure() cache
+	G = test_module_3:resolve_me(X),
+	assertz(user:resolve_me(user)),
+	findall(X, call(G), L1),
+	assertz(test_module_3:resolve_me(local)),
+	findall(X, call(G), L2),
+	abolish(test_module_3:resolve_me/1),
+	assertz(test_module_4:resolve_me(super)),
+	add_import_module(test_module_3, test_module_4, start),
+	findall(X, call(G), L3),
+	append([L1,L2,L3], L),
+	delete_import_module(test_module_3, test_module_4),
+	retractall(user:resolve_me(_)).
+
 :- end_tests(module).
@@ -0,0 +1,189 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+:- module(test_numarray, [test_numarray/0]).
+:- use_module(library(plunit)).
+
+/** <module> Test packed numeric arrays
+
+@author	Jan Wielemaker
+*/
+
+test_numarray :-
+	run_tests([ numarray
+		  ]).
+
+:- begin_tests(numarray).
+
+test(new, L == [0,0,0]) :-
+	numarray_new(A, int16, 3),
+	numarray_to_list(A, L).
+test(new_float, L == [0.0,0.0]) :-
+	numarray_new(A, float64, 2),
+	numarray_to_list(A, L).
+test(props, [N,T] == [4,int8]) :-
+	numarray_from_list(A, int8, [1,2,-3,127]),
+	is_numarray(A),
+	numarray_length(A, N),
+	numarray_type(A, T).
+test(not_an_array, fail) :-
+	is_numarray(foo).
+test(type, error(domain_error(numarray_type, int9))) :-
+	numarray_new(_, int9, 1).
+test(round_trip, L == [-128,0,127]) :-
+	numarray_from_list(A, int8, [-128,0,127]),
+	numarray_to_list(A, L).
+test(int64, L == [-9223372036854775808,9223372036854775807]) :-
+	numarray_from_list(A, int64,
+			   [-9223372036854775808,9223372036854775807]),
+	numarray_to_list(A, L).
+test(float32, L == [1.5,0.25]) :-
+	numarray_from_list(A, float32, [1.5,0.25]),
+	numarray_to_list(A, L).
+test(float_from_int, L == [1.0]) :-
+	numarray_from_list(A, float64, [1]),
+	numarray_to_list(A, L).
+test(range, error(representation_error(int8))) :-
+	numarray_from_list(_, int8, [128]).
+test(element_type, error(type_error(integer, a))) :-
+	numarray_from_list(_, int32, [a]).
+test(partial_list, error(instantiation_error)) :-
+	numarray_from_list(_, int32, [1|_]).
+test(get_set, [V0,V] == [2,42]) :-
+	numarray_from_list(A, int32, [1,2,3]),
+	numarray_get(A, 1, V0),
+	numarray_set(A, 1, 42),
+	numarray_get(A, 1, V).
+test(get_out_of_range, fail) :-
+	numarray_new(A, int32, 3),
+	numarray_get(A, 3, _).
+test(set_range, error(representation_error(int16))) :-
+	numarray_new(A, int16, 1),
+	numarray_set(A, 0, 40000).
+test(slice, L == [2,3]) :-
+	numarray_from_list(A, int64, [1,2,3,4]),
+	numarray_slice(A, 1, 2, S),
+	numarray_to_list(S, L).
+test(slice_copy, L == [1,2]) :-
+	numarray_from_list(A, int64, [1,2]),
+	numarray_slice(A, 0, 2, S),
+	numarray_set(S, 0, 9),
+	numarray_to_list(A, L).
+test(slice_out_of_range, fail) :-
+	numarray_new(A, int8, 4),
+	numarray_slice(A, 3, 2, _).
+test(op_scalar, L == [11,12,13]) :-
+	numarray_from_list(A, int32, [1,2,3]),
+	numarray_op(+, A, 10, B),
+	numarray_to_list(B, L).
+test(op_array, L == [4,10,18]) :-
+	numarray_from_list(A, int32, [1,2,3]),
+	numarray_from_list(B, int8, [4,5,6]),
+	numarray_op(*, A, B, C),
+	numarray_to_list(C, L).
+test(op_minmax, [L1,L2] == [[1,2,2],[2,2,3]]) :-
+	numarray_from_list(A, int32, [1,2,3]),
+	numarray_op(min, A, 2, B), numarray_to_list(B, L1),
+	numarray_op(max, A, 2, C), numarray_to_list(C, L2).
+test(op_float, L == [0.5,1.0]) :-
+	numarray_from_list(A, float64, [1,2]),
+	numarray_op(/, A, 2, B),
+	numarray_to_list(B, L).
+test(op_intdiv, L == [-3,3]) :-
+	numarray_from_list(A, int16, [-7,7]),
+	numarray_op(//, A, 2, B),
+	numarray_to_list(B, L).
+test(op_divide_int, error(domain_error(numarray_operator, /))) :-
+	numarray_new(A, int8, 1),
+	numarray_op(/, A, 2, _).
+test(op_zero_div, error(evaluation_error(zero_divisor))) :-
+	numarray_new(A, int8, 1),
+	numarray_op(//, A, 0, _).
+test(op_float_zero_div, error(evaluation_error(zero_divisor))) :-
+	numarray_new(A, float32, 1),
+	numarray_op(/, A, 0, _).
+test(op_range, error(representation_error(int8))) :-
+	numarray_from_list(A, int8, [127]),
+	numarray_op(+, A, 1, _).
+test(op_overflow, error(evaluation_error(int_overflow))) :-
+	numarray_from_list(A, int64, [9223372036854775807]),
+	numarray_op(+, A, 1, _).
+test(op_length, error(domain_error(numarray_length, _))) :-
+	numarray_new(A, int8, 1),
+	numarray_new(B, int8, 2),
+	numarray_op(+, A, B, _).
+test(sum, S == 6) :-
+	numarray_from_list(A, int8, [1,2,3]),
+	numarray_sum(A, S).
+test(sum_big, S == 9223372036854775817) :-
+	numarray_from_list(A, int64, [9223372036854775807, 10]),
+	numarray_sum(A, S).
+test(sum_float, S == 4.0) :-
+	numarray_from_list(A, float32, [1.5,2.5]),
+	numarray_sum(A, S).
+test(fast_term, [L1,L2,S] == [[1,-2],[1.5],true]) :-
+	numarray_from_list(A, int16, [1,-2]),
+	numarray_from_list(F, float32, [1.5]),
+	fast_term_serialized(t(A,F,A), String),
+	fast_term_serialized(T, String),
+	T = t(A1,F1,A2),
+	numarray_to_list(A1, L1),
+	numarray_to_list(F1, L2),
+	( A1 == A2 -> S = true ; S = false ).
+test(fast_term_atomic, L == [3]) :-
+	numarray_from_list(A, int64, [3]),
+	fast_term_serialized(A, String),
+	fast_term_serialized(A1, String),
+	numarray_to_list(A1, L).
+test(random, [Min,Max] == [1,6]) :-
+	numarray_new(A, int8, 1000),
+	numarray_random(A, 1, 6),
+	numarray_to_list(A, L),
+	min_list(L, Min),
+	max_list(L, Max).
+test(random_full, true) :-
+	numarray_new(A, int64, 10),
+	numarray_random(A, -9223372036854775808, 9223372036854775807).
+test(random_float, true) :-
+	numarray_new(A, float64, 1000),
+	numarray_random(A, -1, 1),
+	numarray_to_list(A, L),
+	forall(member(X, L), (X >= -1.0, X < 1.0)).
+test(random_range, error(representation_error(int8))) :-
+	numarray_new(A, int8, 1),
+	numarray_random(A, 0, 1000).
+test(random_empty, error(domain_error(numarray_range, 0))) :-
+	numarray_new(A, int8, 1),
+	numarray_random(A, 1, 0).
+
+:- end_tests(numarray).
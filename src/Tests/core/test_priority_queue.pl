@@ -0,0 +1,142 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(test_priority_queue, [test_priority_queue/0]).
+:- use_module(library(plunit)).
+:- use_module(library(lists)).
+:- use_module(library(random)).
+
+/** <module> Test native priority queues
+
+@author	Jan Wielemaker
+*/
+
+test_priority_queue :-
+	run_tests([ priority_queue
+		  ]).
+
+:- begin_tests(priority_queue).
+
+test(create, true) :-
+	priority_queue_create(Q),
+	is_priority_queue(Q),
+	priority_queue_size(Q, 0).
+test(not_a_queue, fail) :-
+	is_priority_queue(foo).
+test(type, error(type_error(priority_queue, foo))) :-
+	priority_queue_add(foo, 1, a).
+test(priority, error(type_error(number, a))) :-
+	priority_queue_create(Q),
+	priority_queue_add(Q, a, a).
+test(key, error(instantiation_error)) :-
+	priority_queue_create(Q),
+	priority_queue_add(Q, 1, f(_)).
+test(empty, fail) :-
+	priority_queue_create(Q),
+	priority_queue_get(Q, _, _).
+test(order, L == [1-a, 1.5-b, 2-c, 3-d]) :-
+	priority_queue_create(Q, [3-d, 1-a, 2-c, 1.5-b]),
+	drain(Q, L).
+test(ties, L == [1.0-d, 1-a, 1-b, 1-c, 1-d]) :-
+	priority_queue_create(Q),
+	priority_queue_add(Q, 1, a),
+	priority_queue_add(Q, 1, b),
+	priority_queue_add(Q, 1.0, d),
+	priority_queue_add(Q, 1, c),
+	priority_queue_get(Q, P, K),
+	priority_queue_add(Q, 1, d),
+	drain(Q, L0),
+	L = [P-K|L0].
+test(min, P-K == 1-x) :-
+	priority_queue_create(Q, [5-y, 1-x]),
+	priority_queue_min(Q, P, K),
+	priority_queue_size(Q, 2).
+test(decrease_key, L == [0-c, 1-a, 2-b]) :-
+	priority_queue_create(Q, [1-a, 2-b, 3-c]),
+	priority_queue_add(Q, 0, c),
+	drain(Q, L).
+test(increase_key, L == [2-b, 3-c, 4-a]) :-
+	priority_queue_create(Q, [1-a, 2-b, 3-c]),
+	priority_queue_add(Q, 4, a),
+	priority_queue_priority(Q, a, P),
+	assertion(P == 4),
+	drain(Q, L).
+test(delete, L == [1-a, 3-c]) :-
+	priority_queue_create(Q, [1-a, 2-b, 3-c]),
+	priority_queue_delete(Q, b),
+	\+ priority_queue_delete(Q, b),
+	\+ priority_queue_priority(Q, b, _),
+	drain(Q, L).
+test(keys, L == [1-f("s", [x]), 2-g(1.5)]) :-
+	priority_queue_create(Q, [2-g(1.5), 1-f("s", [x])]),
+	drain(Q, L).
+test(random) :-
+	set_random(seed(42)),
+	priority_queue_create(Q),
+	findall(K-P, ( between(1, 2000, _),
+		       random_between(1, 500, K),
+		       random_between(1, 1000, P) ), Ops),
+	forall(member(K-P, Ops), priority_queue_add(Q, P, K)),
+	forall(( between(1, 100, K), K mod 3 =:= 0 ),
+	       ignore(priority_queue_delete(Q, K))),
+	drain(Q, L),
+	model(Ops, Expected),
+	pairs_keys(L, Ps),
+	msort(Ps, Sorted),
+	assertion(Ps == Sorted),
+	msort(L, SL),
+	assertion(SL == Expected).
+
+:- end_tests(priority_queue).
+
+drain(Q, [P-K|T]) :-
+	priority_queue_get(Q, P, K),
+	!,
+	drain(Q, T).
+drain(_, []).
+
+model(Ops, Pairs) :-
+	reverse(Ops, Rev),
+	findall(P-K, ( member(K-P, Rev),
+		       \+ ( K =< 100, K mod 3 =:= 0 ) ), All),
+	keep_first_key(All, [], Unique),
+	msort(Unique, Pairs).
+
+keep_first_key([], _, []).
+keep_first_key([P-K|T0], Seen, T) :-
+	(   memberchk(K, Seen)
+	->  keep_first_key(T0, Seen, T)
+	;   T = [P-K|T1],
+	    keep_first_key(T0, [K|Seen], T1)
+	).
@@ -109,6 +109,17 @@ test(update, [ cleanup(prolog_unlisten(p/1, send_event(Me))),
     retract(p(b)),
     retractall(p(_)),
     get_events(Me, Events).
+test(gc, [ cleanup(prolog_unlisten(gc, send_event(Me))),
+           Reason == user
+         ]) :-
+    queue(Me),
+    prolog_listen(gc, send_event(Me)),
+    garbage_collect,
+    thread_get_message(Me, done(Dict), [timeout(1)]),
+    is_dict(Dict, gc),
+    get_dict(reason, Dict, Reason),
+    get_dict(mark, Dict, Mark),
+    assertion(float(Mark)).
 
 queue(Me) :-
     thread_self(Me),
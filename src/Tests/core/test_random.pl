@@ -67,4 +67,21 @@ test(state, [X==Y]) :-
 
 :- endif.
 
+seeded_ints(Seed, Max, L) :-
+	set_random(seed(Seed)),
+	length(L, 100),
+	maplist([X]>>(X is random(Max)), L).
+
+test(seed, L1 == L2) :-
+	seeded_ints(42, 6, L1),
+	seeded_ints(42, 6, L2).
+test(range, true) :-
+	forall(member(Max, [1, 2, 6, 1024, 1025, 4294967296,
+			    100000000000000000000000]),
+	       ( seeded_ints(1, Max, L),
+		 forall(member(X, L), (integer(X), X >= 0, X < Max)) )).
+test(float, true) :-
+	forall(between(1, 1000, _),
+	       ( X is random_float, float(X), X > 0.0, X < 1.0 )).
+
 :- end_tests(random).
@@ -67,6 +67,26 @@ test(position,
                 [ subterm_positions(TermPos),
                   comments(Comments)
                 ]).
+test(many_variables, [Len,Small] == [500,f(X,Y,X,Y)]) :-
+	numlist(1, 500, L),
+	maplist([I,S]>>format(string(S), 'V~d', [I]), L, Vs),
+	atomics_to_string(Vs, ',', Args),
+	format(string(Text), 'a(~s,~s)', [Args, Args]),
+	term_string(T, Text, [variable_names(Bindings)]),
+	length(Bindings, Len),
+	T =.. [a|TArgs],
+	length(Front, 500),
+	append(Front, Back, TArgs),
+	Front == Back,
+	term_string(Small, "f(A,B,A,B)"),
+	Small = f(X,Y,_,_).
+test(canonical, T == f(a, -1, "s", [x|y], {b}, +(1,2), -, 'a b')) :-
+	term_string(T, "f(a, -1, \"s\", [x|y], {b}, +(1,2), -, 'a b')",
+		    [canonical(true)]).
+test(canonical, error(syntax_error(canonical_syntax))) :-
+	term_string(_, "a:-b", [canonical(true)]).
+test(canonical, error(syntax_error(canonical_syntax))) :-
+	term_string(_, "f(- 1)", [canonical(true)]).
 
 :- end_tests(read_term).
 
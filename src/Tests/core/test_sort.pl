@@ -36,7 +36,9 @@ test_sort :-
 	run_tests([ sort,
 		    msort,
 		    keysort,
-		    sort4
+		    sort4,
+		    radix_sort,
+		    parallel_sort
 		  ]).
 
 :- begin_tests(sort).
@@ -144,3 +146,98 @@ test(dict, error(type_error(dict,a(1)))) :-
 	sort(a, @<, [a(1), a(2)], _).
 
 :- end_tests(sort4).
+
+:- begin_tests(radix_sort).
+
+:- use_module(library(sort)).
+
+random_list(N, Range, List) :-
+	numlist(1, N, Is),
+	maplist(random_elem(Range), Is, List).
+
+random_elem(Range, _, X) :-
+	X is random(Range) - Range//2.
+
+ref_sort(Order, List, Sorted) :-
+	predsort(ref_compare(Order), List, Sorted0),
+	(   Order == (@>)
+	->  reverse(Sorted0, Sorted)
+	;   Sorted = Sorted0
+	).
+
+ref_compare(@<, O, A, B) :-
+	compare(O, A, B).
+ref_compare(@>, O, A, B) :-
+	compare(O, A, B).
+
+test(int) :-
+	forall(member(Range, [10, 100000, 1<<62]),
+	       ( random_list(1000, Range, L),
+		 sort(L, S1),
+		 ref_sort(@<, L, S2),
+		 assertion(S1 == S2),
+		 sort(0, @>, L, S3),
+		 ref_sort(@>, L, S4),
+		 assertion(S3 == S4),
+		 msort(L, M),
+		 length(M, 1000),
+		 assertion(sort(0, @=<, M, M))
+	       )).
+test(float) :-
+	random_list(1000, 100, L0),
+	maplist([X,F]>>(F is X/3), L0, L1),
+	L = [0.0, -0.0, 0.0|L1],
+	sort(L, S1),
+	ref_sort(@<, L, S2),
+	assertion(S1 == S2),
+	msort(L, [F1,F2|_]),
+	assertion(F1 @< F2 ; F1 == F2).
+test(nan) :-
+	random_list(1000, 100, L0),
+	maplist([X,F]>>(F is X/3), L0, L1),
+	NaN is nan,
+	sort([NaN|L1], [First|S1]),
+	First == NaN,
+	sort(L1, S1).
+test(keysort, KeySorted == Sorted) :-
+	random_list(1000, 10, Keys),
+	numlist(1, 1000, Is),
+	pairs_keys_values(Pairs, Keys, Is),
+	keysort(Pairs, KeySorted),
+	msort(Pairs, Sorted).
+test(mixed, S == [1.0, 1, 2|Ints]) :-
+	numlist(3, 400, Ints),
+	reverse([1,2,1.0|Ints], L),
+	sort(L, S).
+
+:- end_tests(radix_sort).
+
+:- begin_tests(parallel_sort).
+
+:- use_module(library(sort)).
+
+random_pairs(N, Pairs) :-
+	numlist(1, N, Is),
+	maplist(random_pair, Is, Pairs).
+
+random_pair(I, K-I) :-
+	K is random(100).
+
+test(same) :-
+	random_pairs(10000, Pairs),
+	forall(( member(Key, [0,1]),
+		 member(Order, [@<, @=<, @>, @>=])
+	       ),
+	       ( sort(Key, Order, Pairs, S1),
+		 parallel_sort(Key, Order, Pairs, S2,
+			       [workers(4), min_chunk_size(100)]),
+		 assertion(S1 == S2)
+	       )).
+test(var, S1 == S2) :-
+	L = [Y,X,f(Y),f(X),Y],
+	sort(0, @<, L, S1),
+	parallel_sort(0, @<, L, S2, [workers(2), min_chunk_size(1)]).
+test(partial, error(instantiation_error)) :-
+	parallel_sort(0, @<, [b,a|_], _, [workers(2), min_chunk_size(1)]).
+
+:- end_tests(parallel_sort).
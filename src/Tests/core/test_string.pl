@@ -78,9 +78,44 @@ test(split_string, L == ["SWI-Prolog"]) :-
 	split_string("  SWI-Prolog  ", "", "\s\t\n", L).
 test(split_string, L == [""]) :-
 	split_string(" ", "", " ", L).
+test(split_string, L == ["a", "", "b\x100\c"]) :-
+	split_string(" a ,, b\x100\c ", ",\x101\", " ", L).
+test(string_builder, [L,S,S2] == [8, "ab42 x\x100\", "ab42 x\x100\z"]) :-
+	new_string_builder(B),
+	string_builder_append(B, "a"),
+	string_builder_append(B, b),
+	string_builder_append(B, 42),
+	string_builder_append(B, [0' , 0'x]),
+	string_builder_append(B, '\x100\'),
+	string_builder_string(B, S),
+	string_builder_append(B, z),
+	string_builder_length(B, L),
+	string_builder_string(B, S2).
+test(string_builder, error(type_error(string_builder, foo))) :-
+	string_builder_append(foo, x).
 test(string_lower, L == "abc") :-
 	string_lower("aBc", L).
 test(string_upper, L == "ABC") :-
 	string_upper("aBc", L).
+test(case, [U,D] == ['HELLO, WORLD 42', 'hello, world 42']) :-
+	upcase_atom('Hello, World 42', U),
+	downcase_atom('Hello, World 42', D).
+test(case) :-
+	upcase_atom(hello, 'HELLO'),
+	\+ downcase_atom(hello, 'Hello').
+test(intern, S1 == S2) :-
+	intern_string(hello, S1),
+	intern_string("hello", S2).
+test(intern, [S == "42", true(string(S))]) :-
+	intern_string(42, S).
+test(intern) :-
+	intern_string(`abc`, S),
+	sub_string("xabcx", 1, 3, _, S0),
+	S == S0,
+	S0 = S.
+test(intern, S == "gc") :-
+	intern_string(gc, S),
+	garbage_collect,
+	garbage_collect.
 
 :- end_tests(string).
@@ -231,6 +231,17 @@ test(iso2, error(type_error(list, [a|1]))) :-
 
 test(neg, C = '\235\') :-		% test signed char handling
 	sub_atom('Azi\235\', _, 1, 0, C).
+test(search, Bs == [0,3]) :-
+	findall(B, sub_atom(abcabc, B, _, _, ab), Bs).
+test(search, Bs == [1,4]) :-
+	findall(B, sub_atom('a\x100\ba\x100\b', B, _, _, '\x100\b'), Bs).
+test(search, fail) :-
+	sub_atom(abc, _, _, _, '\x100\').
+test(search, B == 3) :-			% last match is deterministic
+	call_cleanup(( sub_atom(abcab, B, _, _, ab),
+		       B > 0
+		     ), Det = true),
+	Det == true.
 
 :- end_tests(sub_atom).
 
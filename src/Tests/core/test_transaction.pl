@@ -0,0 +1,122 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(test_transaction, [test_transaction/0]).
+:- use_module(library(plunit)).
+
+/** <module> Test database transactions
+*/
+
+test_transaction :-
+	run_tests([ transaction
+		  ]).
+
+:- begin_tests(transaction, [cleanup(retractall(tp(_)))]).
+
+:- dynamic
+	tp/1.
+
+set_tp(List) :-
+	retractall(tp(_)),
+	forall(member(X, List), assertz(tp(X))).
+
+tps(List) :-
+	findall(X, tp(X), List).
+
+test(commit, L == [2,3]) :-
+	set_tp([1,2]),
+	transaction(( assertz(tp(3)),
+		      retract(tp(1))
+		    )),
+	tps(L).
+test(own_updates, L == [2,3]) :-
+	set_tp([1,2]),
+	transaction(( assertz(tp(3)),
+		      retract(tp(1)),
+		      tps(L)
+		    )).
+test(fail, L == [1,2]) :-
+	set_tp([1,2]),
+	\+ transaction(( assertz(tp(3)),
+			 retract(tp(1)),
+			 fail
+		       )),
+	tps(L).
+test(error, L == [1,2]) :-
+	set_tp([1,2]),
+	catch(transaction(( asserta(tp(0)),
+			    retract(tp(2)),
+			    throw(oops)
+			  )), oops, true),
+	tps(L).
+test(assert_retract, L == [1]) :-
+	set_tp([1]),
+	transaction(( assertz(tp(2)),
+		      retract(tp(2)),
+		      \+ tp(2)
+		    )),
+	tps(L).
+test(retract_once, L == []) :-
+	set_tp([1]),
+	transaction(( retract(tp(1)),
+		      \+ retract(tp(1))
+		    )),
+	tps(L).
+test(nested, L == [1,2,4]) :-
+	set_tp([1]),
+	transaction(( assertz(tp(2)),
+		      \+ transaction(( assertz(tp(3)),
+				       retract(tp(1)),
+				       fail
+				     )),
+		      transaction(assertz(tp(4)))
+		    )),
+	tps(L).
+test(isolation, [ condition(current_prolog_flag(threads, true)),
+		  Other == [1,2]
+		]) :-
+	set_tp([1,2]),
+	transaction(( assertz(tp(3)),
+		      retract(tp(1)),
+		      thread_self(Me),
+		      thread_create(( tps(L),
+				      thread_send_message(Me, other(L))
+				    ), Id, []),
+		      thread_join(Id, true),
+		      thread_get_message(other(Other))
+		    )),
+	tps(L),
+	L == [2,3].
+
+:- end_tests(transaction).
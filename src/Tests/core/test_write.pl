@@ -94,6 +94,12 @@ test(varname, L == [39,1040,1080,39]) :-
 	with_output_to(atom(X),
 		       writeq(A)),
 	atom_codes(X,L).
+test(quoted_run, [S,Pos] == ["['it\\'s a\\nb',a_b,'A z']\n[x]", 3]) :-
+	with_output_to(string(S),
+		       ( writeq(['it\'s a\nb', a_b, 'A z']), nl,
+			 write([x]),
+			 line_position(current_output, Pos)
+		       )).
 
 :- end_tests(write_canonical).
 
@@ -138,6 +144,23 @@ test(nan) :-
 	atom_number(F, Float),
 	abs(Float) >= 1,
 	abs(Float) < 2.
+test(shortest, L == ['0.1', '0.3', '1.0e+22', '1.0e+23', '5.0e-324',
+		     '1.7976931348623157e+308', '2.2250738585072014e-308',
+		     '9.007199254740992e+15', '-0.0']) :-
+	maplist([F,A]>>format(atom(A), '~w', [F]),
+		[ 0.1, 0.3, 1.0e22, 1.0e23, 5.0e-324,
+		  1.7976931348623157e308, 2.2250738585072014e-308,
+		  9007199254740993.0, -0.0
+		], L).
+test(round_trip) :-
+	forall(( between(-1074, 1023, E),
+		 member(M, [1.0, 1.5, 0.7, 0.999999999999]),
+		 F is M*2.0**E
+	       ),
+	       ( format(atom(A), '~w', [F]),
+		 atom_number(A, F2),
+		 F2 =:= F
+	       )).
 
 :- end_tests(write_float).
 
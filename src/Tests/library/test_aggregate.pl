@@ -42,7 +42,8 @@
 
 test_aggregate :-
 	run_tests([ foreach,
-		    aggregate
+		    aggregate,
+		    parallel_aggregate
 		  ]).
 
 :- begin_tests(foreach).
@@ -152,3 +153,45 @@ test(e_vars, all(X == [1,2,3,4,5])) :-
 	aggregate(r(sum(0)), Y^(between(1, 5, X), Y=1), _).
 
 :- end_tests(aggregate).
+
+:- begin_tests(parallel_aggregate,
+	       [ setup(set_cpu_count(Old)),
+		 cleanup(set_prolog_flag(cpu_count, Old))
+	       ]).
+
+set_cpu_count(Old) :-
+	current_prolog_flag(cpu_count, Old),
+	set_prolog_flag(cpu_count, 4).
+
+part(I, X) :-
+	L is I*100+1,
+	H is L+99,
+	between(L, H, X).
+
+same_as_all(Template, X) :-
+	parallel_aggregate_all(Template, between(0, 5, I), part(I, X), R1),
+	aggregate_all(Template, (between(0, 5, I), part(I, X)), R2),
+	R1 == R2.
+
+test(count) :-
+	same_as_all(count, _).
+test(sum) :-
+	same_as_all(sum(X*2), X).
+test(max) :-
+	same_as_all(max(X), X),
+	same_as_all(max(X, w(X)), X).
+test(min) :-
+	same_as_all(min(X), X),
+	same_as_all(min(X, w(X)), X).
+test(bag) :-
+	same_as_all(bag(X), X),
+	same_as_all(set(X mod 10), X).
+test(empty, fail) :-
+	parallel_aggregate_all(max(_), between(1, 3, _), fail, _).
+test(empty, Count == 0) :-
+	parallel_aggregate_all(count, between(1, 3, _), fail, Count).
+test(error, throws(oops)) :-
+	parallel_aggregate_all(count, between(1, 3, I),
+			       ( I == 2 -> throw(oops) ; true ), _).
+
+:- end_tests(parallel_aggregate).
@@ -0,0 +1,90 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+:- module(test_call_counts, [test_call_counts/0]).
+:- use_module(library(plunit)).
+:- use_module(library(statistics)).
+
+/** <module> Test per-predicate call counting
+*/
+
+test_call_counts :-
+	run_tests([ call_counts
+		  ]).
+
+cc_p(1).
+cc_p(2).
+cc_p(3).
+
+cc_loop(N) :- N > 0, !, N1 is N-1, cc_loop(N1).
+cc_loop(0).
+
+cc_throw :- throw(cc_error).
+
+cc_fail :- cc_p(4).
+
+:- begin_tests(call_counts).
+
+test(ports, C == c(1,3,2,0)) :-
+	call_counting(cc_p/1, true),
+	forall(cc_p(_), true),
+	call_counts(cc_p/1, Counts),
+	C = c(Counts.calls, Counts.exits, Counts.redos, Counts.fails).
+test(recursion, C == c(101,101,0)) :-
+	call_counting(cc_loop(_), true),
+	cc_loop(100),
+	call_counts(cc_loop/1, Counts),
+	C = c(Counts.calls, Counts.exits, Counts.fails),
+	Counts.time > 0.0.
+test(last_call, C == c(1,0,1,1,0)) :-
+	call_counting(cc_throw/0, true),
+	call_counting(cc_fail/0, true),
+	catch(cc_throw, cc_error, true),
+	\+ cc_fail,
+	call_counts(cc_throw/0, T),
+	call_counts(cc_fail/0, F),
+	C = c(T.exceptions, T.exits, F.calls, F.fails, F.exits).
+test(property) :-
+	call_counting(cc_p/1, true),
+	predicate_property(cc_p(_), call_counting),
+	call_counting(cc_p/1, false),
+	\+ predicate_property(cc_p(_), call_counting),
+	cc_p(1),
+	call_counts(cc_p/1, Counts),
+	assertion(Counts.calls == 0).
+test(none, fail) :-
+	call_counts(cc_loop(_, _), _).
+
+:- end_tests(call_counts).
@@ -35,7 +35,9 @@
 :- use_module(library(plunit)).
 
 test_csv :-
-	run_tests([ csv_read_file_row ]).
+	run_tests([ csv_read_file_row,
+		    csv_read_stream
+		  ]).
 
 :- begin_tests(csv_read_file_row, []).
 :- use_module(library(csv)).
@@ -117,3 +119,36 @@ test(quoted_crlf_ignored) :-
           ].
 
 :- end_tests(csv_read_file_row).
+
+:- begin_tests(csv_read_stream, []).
+:- use_module(library(csv)).
+
+csv_string(String, Rows, Options) :-
+	setup_call_cleanup(
+	    open_string(String, In),
+	    csv_read_stream(In, Rows, Options),
+	    close(In)).
+
+test(convert, Rows == [row(1, -2.5, abc, '', ' 3')]) :-
+	csv_string("1,-2.5,abc,, 3\n", Rows, []).
+test(no_convert, Rows == [row('1', 'X')]) :-
+	csv_string("1,X", Rows, [convert(false)]).
+test(case, Rows == [row('ABC', 1, 'X Y')]) :-
+	csv_string("abc,1,x y\n", Rows, [case(up)]).
+test(case, Rows == [row(abc, 1, 'x y')]) :-
+	csv_string("ABC,1,X Y\n", Rows, [case(down)]).
+test(strip, Rows == [row(a, ' b ', '" c"')]) :-
+	csv_string(" a ,\" b \", \" c\"\n", Rows, [strip(true)]).
+test(eol, Rows == [row(a), row(b), row(c), row(d)]) :-
+	csv_string("a\r\nb\rc\nd", Rows, []).
+test(quoted, Rows == [row('a,b', 'c"d\ne')]) :-
+	csv_string("\"a,b\",\"c\"\"d\ne\"\n", Rows, []).
+test(wide, Rows == [row(X, 1)]) :-
+	atom_codes(X, [0'a, 0x100, 0'b]),
+	csv_string("a\x100\b;1\n", Rows, [separator(0';)]).
+test(unterminated, fail) :-
+	csv_string("a,\"b\n", _, []).
+test(arity, error(domain_error(row_arity(2), 1))) :-
+	csv_string("a,b\nc\n", _, []).
+
+:- end_tests(csv_read_stream).
@@ -0,0 +1,112 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(test_inline, [test_inline/0]).
+:- use_module(library(plunit)).
+:- use_module(library(inline)).
+
+/** <module> Test library(inline)
+*/
+
+test_inline :-
+	run_tests(inline).
+
+:- inline([ succ_or_zero/2, pair/3, loop/1, pos/1 ]).
+
+succ_or_zero(X, Y) :-
+	(   X > 0
+	->  Y is X - 1
+	;   Y = 0
+	).
+
+pair(X, X, f(X)).
+
+loop(X) :-
+	loop(X).
+
+pos(X) :-
+	X > 0, !.
+
+c_succ(X, Y) :-
+	succ_or_zero(X, Y).
+c_pair(X, Y, Z) :-
+	pair(X, Y, Z).
+c_loop(X) :-
+	loop(X).
+c_pos(X) :-
+	pos(X).
+
+:- begin_tests(inline).
+
+test(inlined, true) :-
+	clause(c_succ(_,_), Body),
+	Body = (_->_;_).
+test(succ, Y == 2) :-
+	c_succ(3, Y).
+test(succ, Y == 0) :-
+	c_succ(-1, Y).
+test(head, Z == f(a)) :-
+	c_pair(a, a, Z).
+test(head, fail) :-
+	c_pair(a, b, _).
+test(recursive, Body == loop(X)) :-
+	clause(c_loop(X), Body).
+test(cut, Body == pos(X)) :-
+	clause(c_pos(X), Body).
+test(update, X == 2) :-
+	tmp_file_stream(text, Helper, Out1),
+	format(Out1, ':- module(inline_helper, [h/1]).~n', []),
+	format(Out1, ':- use_module(library(inline)).~n', []),
+	format(Out1, ':- inline(h/1).~nh(X) :- X = 1.~n', []),
+	close(Out1),
+	tmp_file_stream(text, User, Out2),
+	format(Out2, ':- module(inline_user, [c/1]).~n', []),
+	format(Out2, ':- use_module(~q).~nc(X) :- h(X).~n', [Helper]),
+	close(Out2),
+	load_files(User, [silent(true)]),
+	clause(inline_user:c(Y), Y=1),
+	setup_call_cleanup(
+	    open(Helper, write, Out3),
+	    ( format(Out3, ':- module(inline_helper, [h/1]).~n', []),
+	      format(Out3, ':- use_module(library(inline)).~n', []),
+	      format(Out3, ':- inline(h/1).~nh(X) :- X = 2.~n', [])
+	    ),
+	    close(Out3)),
+	load_files(Helper, [silent(true)]),
+	update_inlined,
+	inline_user:c(X),
+	delete_file(Helper),
+	delete_file(User).
+
+:- end_tests(inline).
@@ -42,6 +42,7 @@
 
 test_ordsets :-
 	run_tests([ ord_intersection,
+		    ord_merge,
 		    is_ordset
 		  ]).
 
@@ -61,6 +62,45 @@ test(oint4, [X,Y] == [[c],[a,b]]) :-
 
 :- end_tests(ord_intersection).
 
+:- begin_tests(ord_merge).
+
+test(union, U == [1,2,3,a,b,f(x)]) :-
+	ord_union([1,3,a,f(x)], [2,3,b], U).
+test(union, U == [a,b,c]) :-
+	ord_union([], [a,b,c], U).
+test(union_tail, true) :-
+	numlist(1, 1000, L),
+	ord_union([0], L, U),
+	U = [0|T],
+	same_term(T, L).
+test(subtract, D == [1,b]) :-
+	ord_subtract([1,2,a,b,c], [2,a,c,d], D).
+test(intersection, I == [2.0,b,"s"]) :-
+	ord_intersection([1,2.0,b,"s",f(_)], [2.0,a,b,"s"], I).
+test(intersection_var, I == [X]) :-
+	sort([X,Y,a], S1),
+	ord_intersection(S1, [X], I),
+	Y \== X.
+test(memberchk) :-
+	ord_memberchk(f(a), [1,a,f(a),g]).
+test(memberchk, fail) :-
+	ord_memberchk(b, [1,a,f(a),g]).
+test(memberchk, fail) :-
+	ord_memberchk(_, [1,a,f(a),g]).
+test(large, [U,D,I] == [U0,D0,I0]) :-
+	numlist(1, 20000, L1),
+	findall(X, (between(1, 5000, N), X is N*7), L2),
+	ord_union(L1, L2, U),
+	ord_subtract(L1, L2, D),
+	ord_intersection(L1, L2, I),
+	oset:oset_union(L1, L2, U0),
+	oset:oset_diff(L1, L2, D0),
+	oset:oset_int(L1, L2, I0).
+test(partial, U-T == [a,b]-[]) :-
+	ord_union([a|T], [b], U).
+
+:- end_tests(ord_merge).
+
 :- begin_tests(is_ordset).
 
 test(is_ordset, true) :-
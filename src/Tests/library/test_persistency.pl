@@ -0,0 +1,110 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+:- module(test_persistency,
+	  [ test_persistency/0
+	  ]).
+:- use_module(library(plunit)).
+:- use_module(library(persistency)).
+:- use_module(library(lists)).
+
+test_persistency :-
+	run_tests([ persistency
+		  ]).
+
+:- persistent
+	fact(key:integer, value:any).
+
+attach(File, Options) :-
+	tmp_file(journal, File),
+	db_attach(File, Options).
+
+reattach(File, Facts) :-
+	db_detach,
+	db_attach(File, []),
+	findall(K-V, fact(K, V), Facts).
+
+detach(File) :-
+	db_detach,
+	catch(delete_file(File), _, true).
+
+fill(N) :-
+	forall(between(1, N, I), assert_fact(I, v(I, "s"))),
+	forall(between(1, N, I), (0 =:= I mod 2 -> retract_fact(I, _) ; true)).
+
+wait_gc :-
+	(   persistency:db_gc_thread(test_persistency, _)
+	->  sleep(0.01),
+	    wait_gc
+	;   true
+	).
+
+:- begin_tests(persistency).
+
+test(binary, [ setup(attach(File, [format(binary)])),
+	       cleanup(detach(File)),
+	       [Format,Len] == [binary,10] ]) :-
+	fill(20),
+	persistency:journal_format(File, Format),
+	reattach(File, Facts),
+	length(Facts, Len).
+test(group, [ setup(attach(File, [sync(group)])),
+	      cleanup(detach(File)),
+	      Len == 400 ]) :-
+	findall(Id,
+		( between(0, 3, T),
+		  thread_create(forall(between(1, 100, I),
+				       ( K is T*100+I,
+					 assert_fact(K, T)
+				       )),
+				Id, [])
+		), Ids),
+	maplist(thread_join, Ids),
+	reattach(File, Facts),
+	length(Facts, Len).
+test(background_gc, [ setup(attach(File, [background_gc(true)])),
+		      cleanup(detach(File)),
+		      Facts == Facts0 ]) :-
+	fill(100),
+	size_file(File, Size0),
+	db_sync(gc(always)),
+	forall(between(101, 110, I), assert_fact(I, new)),
+	wait_gc,
+	findall(K-V, fact(K, V), Facts0),
+	size_file(File, Size),
+	assertion(Size < Size0),
+	reattach(File, Facts).
+
+:- end_tests(persistency).
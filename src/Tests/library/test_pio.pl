@@ -116,6 +116,17 @@ test(abc_debug, [ Codes == `abc`,
 	    phrase_from_file(get_all(Codes), ABC),
 	    set_prolog_flag(debug, Old)).
 
+test(large, [ Count == 200000,
+	      setup((length(Content, 200000),
+		     maplist(=(0'a), Content),
+		     cfc(Content,Large))),
+	      cleanup(df(Large))
+	    ]) :-
+	phrase_from_file(count_codes(0, Count), Large).
+
+count_codes(N0, N) --> [_], !, { N1 is N0+1 }, count_codes(N1, N).
+count_codes(N, N) --> [].
+
 
 :- end_tests(phrase_from_file).
 
@@ -211,5 +222,11 @@ test(unicode_be) :-
 	test_pe(1000, 25, unicode_be).
 test(wchar_t) :-
 	test_pe(1000, 25, wchar_t).
+test(octet_large_buffer) :-
+	test_pe(100000, 65536, octet).
+test(utf8_large_buffer) :-
+	test_pe(100000, 65536, utf8).
+test(unicode_le_large_buffer) :-
+	test_pe(100000, 65536, unicode_le).
 
 :- end_tests(read_pending_input).
@@ -0,0 +1,94 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(test_predicate_memory, [test_predicate_memory/0]).
+:- use_module(library(plunit)).
+:- use_module(library(statistics)).
+
+/** <module> Test per-predicate memory accounting
+*/
+
+test_predicate_memory :-
+	run_tests([ predicate_memory
+		  ]).
+
+:- dynamic pm_fact/2.
+
+:- table pm_path/2.
+
+pm_edge(1, 2).
+pm_edge(2, 3).
+pm_edge(3, 1).
+
+pm_path(X, Y) :- pm_edge(X, Y).
+pm_path(X, Y) :- pm_path(X, Z), pm_edge(Z, Y).
+
+pm_fill(N) :-
+	retractall(pm_fact(_,_)),
+	forall(between(1, N, I), assertz(pm_fact(I, I))).
+
+:- begin_tests(predicate_memory).
+
+test(total) :-
+	pm_fill(100),
+	predicate_memory(pm_fact/2, M),
+	assertion(M.clauses > 0),
+	assertion(M.total =:= M.definition + M.clauses + M.erased_clauses +
+			      M.clause_indexes + M.lingering + M.tables).
+test(size) :-
+	pm_fill(100),
+	predicate_memory(pm_fact/2, M),
+	predicate_property(pm_fact(_,_), size(Size)),
+	assertion(Size =:= M.definition + M.clauses + M.erased_clauses +
+			   M.clause_indexes).
+test(erased) :-
+	pm_fill(100),
+	predicate_memory(pm_fact/2, M0),
+	forall(between(1, 50, I), retract(pm_fact(I, _))),
+	predicate_memory(pm_fact/2, M),
+	assertion(M.clauses < M0.clauses).
+test(index) :-
+	pm_fill(1000),
+	pm_fact(_, 500),
+	predicate_memory(pm_fact/2, M),
+	assertion(M.clause_indexes > 0).
+test(tables) :-
+	abolish_all_tables,
+	forall(pm_path(1, _), true),
+	predicate_memory(pm_path/2, M),
+	assertion(M.tables > 0).
+test(undefined, fail) :-
+	predicate_memory(pm_no_such_predicate/3, _).
+
+:- end_tests(predicate_memory).
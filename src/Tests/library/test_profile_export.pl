@@ -0,0 +1,90 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(test_profile_export, [test_profile_export/0]).
+:- use_module(library(plunit)).
+:- use_module(library(statistics)).
+:- use_module(library(profile_export)).
+:- use_module(library(lists)).
+
+/** <module> Test exporting profile data
+*/
+
+test_profile_export :-
+	run_tests([ profile_export
+		  ]).
+
+pe_loop(0) :- !.
+pe_loop(N) :-
+	atom_length(abc, _),
+	N1 is N-1,
+	pe_loop(N1).
+
+call_graph :-
+	with_output_to(string(_),
+		       profile(pe_loop(500000), [top(1)])).
+
+pprof_bytes(Options, Bytes) :-
+	tmp_file_stream(binary, File, Out),
+	close(Out),
+	profile_pprof(File, Options),
+	read_file_to_codes(File, Bytes, [type(binary)]),
+	delete_file(File).
+
+:- begin_tests(profile_export).
+
+test(folded, true) :-
+	call_graph,
+	with_output_to(string(S), profile_folded(current_output, [])),
+	sub_string(S, _, _, _, "test_profile_export:pe_loop/1").
+test(pprof, Bytes = [0x0a|_]) :-
+	call_graph,
+	pprof_bytes([], Bytes),
+	string_codes("test_profile_export:pe_loop/1", Name),
+	append(_, Tail, Bytes),
+	append(Name, _, Tail), !.
+test(sample, true,
+     [condition(current_prolog_flag(threads, true))]) :-
+	reset_sample_profile,
+	sample_profiler(main, true, [interval(0.001)]),
+	pe_loop(1000000),
+	sample_profiler(main, false),
+	with_output_to(string(S),
+		       profile_folded(current_output, [source(sample)])),
+	sub_string(S, _, _, _, "test_profile_export:pe_loop/1"),
+	pprof_bytes([source(sample)], [0x0a|_]).
+test(source, error(domain_error(profile_source, nosuch))) :-
+	profile_folded(current_output, [source(nosuch)]).
+
+:- end_tests(profile_export).
@@ -0,0 +1,105 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(test_prolog_xref,
+	  [ test_prolog_xref/0
+	  ]).
+
+:- use_module(library(plunit)).
+:- use_module(library(prolog_xref)).
+:- use_module(library(lists)).
+
+test_prolog_xref :-
+	run_tests([ prolog_xref
+		  ]).
+
+:- begin_tests(prolog_xref, [cleanup(clean_files)]).
+
+test(xref_source, true(Called == [q/0])) :-
+	tmp_source(a, "p :- q.\nq.\n", File),
+	xref_source(File, [silent(true)]),
+	findall(N/A, (xref_called(File, G, p), functor(G, N, A)), Called).
+test(unmodified) :-
+	tmp_source(b, "p :- q.\nq.\n", File),
+	xref_source(File, [silent(true)]),
+	xref_done(File, Done0),
+	% A changed time stamp only updates the time
+	asserta(prolog_xref:called(magic, File, magic, true, 0)),
+	age_source(File),
+	xref_source(File, [silent(true)]),
+	xref_done(File, Done1),
+	assertion(Done1 == Done0),
+	assertion(prolog_xref:called(magic, File, magic, true, 0)),
+	% Changing the content re-processes the file
+	write_source(File, "p :- r.\nr.\n"),
+	age_source(File),
+	xref_source(File, [silent(true)]),
+	assertion(\+ prolog_xref:called(magic, File, magic, true, 0)),
+	assertion(xref_called(File, r, p)).
+test(xref_sources, Called == [q1, q2, q3, q4]) :-
+	findall(File,
+		( member(I, [1,2,3,4]),
+		  format(string(S), "p :- q~w.~nq~w.~n", [I,I]),
+		  atom_concat(par, I, Name),
+		  tmp_source(Name, S, File) ),
+		Files),
+	xref_sources(Files, [silent(true), threads(2)]),
+	findall(Q, ( member(File, Files),
+		     xref_called(File, Q, p) ), Called).
+
+:- end_tests(prolog_xref).
+
+:- dynamic tmp_file/1.
+
+tmp_source(Name, Content, File) :-
+	tmp_file(Name, Base),
+	file_name_extension(Base, pl, File),
+	assertz(tmp_file(File)),
+	write_source(File, Content).
+
+write_source(File, Content) :-
+	setup_call_cleanup(
+	    open(File, write, Out),
+	    write(Out, Content),
+	    close(Out)).
+
+age_source(File) :-
+	retract(prolog_xref:source(File, Time)),
+	Old is Time - 100,
+	assertz(prolog_xref:source(File, Old)).
+
+clean_files :-
+	forall(retract(tmp_file(File)),
+	       ( xref_clean(File),
+		 catch(delete_file(File), _, true) )).
@@ -0,0 +1,82 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(test_read_parallel, [test_read_parallel/0]).
+:- use_module(library(plunit)).
+:- use_module(library(read_parallel)).
+
+/** <module> Test library(read_parallel)
+*/
+
+test_read_parallel :-
+	run_tests(read_parallel).
+
+:- begin_tests(read_parallel).
+
+test(chunks, Par =@= Seq) :-
+	tmp_file_stream(text, File, Out),
+	call_cleanup(write_clauses(Out, 2000), close(Out)),
+	read_sequential(File, Seq),
+	read_terms_parallel(File, Par, [threads(2), chunks(17)]),
+	delete_file(File).
+test(small, Terms == [a, b(1.5)]) :-
+	tmp_file_stream(text, File, Out),
+	format(Out, 'a.~nb(1.5).~n', []),
+	close(Out),
+	read_terms_parallel(File, Terms, []),
+	delete_file(File).
+
+write_clauses(Out, N) :-
+	forall(between(1, N, I),
+	       ( format(Out, 'f(~d, \'a. b\', "x.\\n", 0\'., 0\'\'\', 16\'ff).~n',
+			[I]),
+		 format(Out, 'g(X, =.., [1.5|X]). % end. ~n', []),
+		 format(Out, '/* block. ~n comment. */ h(`c. d`).~n', [])
+	       )).
+
+read_sequential(File, Terms) :-
+	setup_call_cleanup(
+	    open(File, read, In),
+	    read_all(In, Terms),
+	    close(In)).
+
+read_all(In, Terms) :-
+	read_term(In, Term, []),
+	(   Term == end_of_file
+	->  Terms = []
+	;   Terms = [Term|Tail],
+	    read_all(In, Tail)
+	).
+
+:- end_tests(read_parallel).
@@ -0,0 +1,132 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(test_sample_profile, [test_sample_profile/0]).
+:- use_module(library(plunit)).
+:- use_module(library(statistics)).
+
+/** <module> Test the sampling profiler
+*/
+
+test_sample_profile :-
+	run_tests([ sample_profile,
+		    alloc_profile
+		  ]).
+
+sp_loop(0) :- !.
+sp_loop(N) :-
+	atom_length(abc, _),
+	N1 is N-1,
+	sp_loop(N1).
+
+sp_work :-
+	sp_loop(1000000).
+
+ap_list(0, []) :- !.
+ap_list(N, [f(N)|T]) :-
+	N1 is N-1,
+	ap_list(N1, T).
+
+ap_work :-
+	ap_list(100000, L),
+	length(L, _).
+
+sp_in_stacks(Stacks) :-
+	member(_-Stack, Stacks),
+	memberchk(test_sample_profile:sp_loop/1, Stack), !.
+
+:- begin_tests(sample_profile, [condition(current_prolog_flag(threads, true))]).
+
+test(thread, true) :-
+	reset_sample_profile,
+	thread_create(sp_work, Id, []),
+	sample_profiler(Id, true, [interval(0.001)]),
+	thread_join(Id, Status),
+	assertion(Status == true),
+	sample_profile_data(Stacks),
+	sp_in_stacks(Stacks).
+test(self, Stacks == []) :-
+	reset_sample_profile,
+	sample_profiler(main, true),
+	sample_profiler(main, false),
+	reset_sample_profile,
+	sample_profile_data(Stacks).
+test(folded, true) :-
+	reset_sample_profile,
+	sample_profiler(main, true, [interval(0.001)]),
+	sp_work,
+	sample_profiler(main, false),
+	with_output_to(string(S), write_folded_profile(current_output)),
+	sub_string(S, _, _, _, "test_sample_profile:sp_loop/1").
+test(all, true) :-
+	reset_sample_profile,
+	sample_profiler(all, true, [interval(0.001)]),
+	findall(Id, (between(1, 4, _), thread_create(sp_work, Id, [])), Ids),
+	maplist(thread_join, Ids),
+	sample_profiler(all, false),
+	sample_profile_data(Stacks),
+	sp_in_stacks(Stacks).
+test(group, Stacks == []) :-
+	thread_self(Me),
+	sample_profiler([Me], true),
+	sample_profiler([Me], false),
+	reset_sample_profile,
+	sample_profile_data(Stacks, [thread(Me)]).
+test(interval, error(domain_error(sample_interval, 10.0))) :-
+	sample_profiler(main, false, [interval(10)]).
+
+:- end_tests(sample_profile).
+
+:- begin_tests(alloc_profile).
+
+test(global, true) :-
+	reset_alloc_profile,
+	'$prof_alloc_interval'(Old, 4096),
+	call_cleanup(( alloc_profiler(_, true),
+		       ap_work,
+		       alloc_profiler(_, false)
+		     ),
+		     '$prof_alloc_interval'(_, Old)),
+	alloc_profile_data(global, Stacks),
+	member(_-Stack, Stacks),
+	memberchk(test_sample_profile:ap_list/2, Stack), !.
+test(reset, Stacks == []) :-
+	reset_alloc_profile,
+	alloc_profile_data(heap, Stacks).
+test(area, error(domain_error(alloc_area, local))) :-
+	alloc_profile_data(local, _).
+test(interval, error(domain_error(alloc_interval, 10))) :-
+	'$prof_alloc_interval'(_, 10).
+
+:- end_tests(alloc_profile).
@@ -39,6 +39,8 @@
 
 :- use_module(library(plunit)).
 :- use_module(library(solution_sequences)).
+:- use_module(library(aggregate)).
+:- use_module(library(lists)).
 
 test_solution_sequences :-
 	run_tests([ test_solution_sequences
@@ -56,6 +58,17 @@ data(2, b, n0).
 test(distinct, all(A-B-C == [1-a-a1,2-a-n1])) :-
 	distinct(A, data(A,B,C)).
 
+test(distinct, all(X =@= [f(A,_,A),f(_,_,_),g,f(1,_,_)])) :-
+	distinct(X, member(X, [f(B,_,B), f(C,_,C), f(_,_,_), g, g, f(1,_,_)])).
+test(distinct) :-
+	A = f(A), B = f(f(B)),
+	findall(X, distinct(X, member(X, [A,B,A,g(A)])), Xs),
+	assertion(Xs =@= [A,g(A)]).
+test(distinct, Len == 1000) :-
+	aggregate_all(count, distinct(X, (between(1, 5000, I), X is I mod 1000)), Len).
+test(reduced, all(X == [a,b,c])) :-
+	reduced(member(X, [a,b,a,c,b])).
+
 test(limit, all(X == [1,2,3])) :-
 	limit(3, between(1, 10, X)).
 
@@ -74,6 +87,17 @@ test(ad, all(A-B-C ==
 	    [1-b-a2, 1-a-a1, 1-a-ax, 2-b-n2, 2-b-n0, 2-a-n1])) :-
 	order_by([asc(A),desc(B)], data(A,B,C)).
 
+test(limit_order, all(X-I == [a-2,a-4,a-5,b-1])) :-
+	limit(4, order_by([asc(X)], member(X-I, [b-1,a-2,b-3,a-4,a-5,c-6]))).
+test(limit_order, true(L == L0)) :-
+	findall(X-Y, (between(1, 5000, I), X is I mod 97, Y is I mod 13), Pairs),
+	findall(X-Y, limit(1500, order_by([desc(X),asc(Y)], member(X-Y, Pairs))), L),
+	findall(X-Y, order_by([desc(X),asc(Y)], member(X-Y, Pairs)), All),
+	length(L0, 1500),
+	append(L0, _, All).
+test(limit_order, fail) :-
+	limit(0, order_by([asc(X)], member(X, [1]))).
+
 test(group_by, all(A-Bag == [1-[a,a,b],2-[a,b,b]])) :-
 	group_by(A, B, data(A,B,_), Bag).
 
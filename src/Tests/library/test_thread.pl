@@ -58,6 +58,42 @@ test(concur, true) :-
 	       (   concurrent(2, [X=1,Y=2], []),
 		   ground(X-Y))).
 
+test(maplist, true(L==[1,4,9,16,25])) :-
+	with_cpus(4, concurrent_maplist(sq, [1,2,3,4,5], L)).
+test(maplist, true(N==1000)) :-
+	numlist(1, 1000, L0),
+	with_cpus(4, concurrent_maplist(succ, L0, L)),
+	length(L, N),
+	last(L, 1001).
+test(maplist, fail) :-
+	with_cpus(4, concurrent_maplist(==(1), [1,2,1])).
+test(maplist, error(type_error(evaluable, a/0))) :-
+	with_cpus(4, concurrent_maplist(sq, [1,a,3], _)).
+test(maplist, true(L==[[1,4],[9,16]])) :-
+	with_cpus(4, concurrent_maplist(concurrent_maplist(sq),
+					 [[1,2],[3,4]], L)).
+
+test(task, true(X==42)) :-
+	with_cpus(4, task_spawn(X is 6*7, T)),
+	task_await(T),
+	task_await(T).
+test(task, fail) :-
+	with_cpus(4, task_spawn(fail, T)),
+	task_await(T).
+test(task, throws(x)) :-
+	with_cpus(4, task_spawn(throw(x), T)),
+	task_await(T).
+test(task, true(T==T2)) :-
+	with_cpus(4, task_spawn(sleep(10), T1)),
+	with_cpus(4, task_spawn(true, T2)),
+	task_await_any([T1,T2], T),
+	task_cancel(T1).
+test(task, throws(task_cancelled)) :-
+	with_cpus(4, task_spawn(sleep(10), T)),
+	sleep(0.1),
+	task_cancel(T),
+	task_await(T).
+
 test(first, true(X==1)) :-
 	first_solution(X, [X=1,X=1], []).
 test(first, fail) :-
@@ -68,3 +104,13 @@ test(first, true(X==1)) :-
 	first_solution(X, [(repeat,fail), X=1], []).
 
 :- end_tests(thread).
+
+sq(X, Y) :-
+	Y is X*X.
+
+with_cpus(N, Goal) :-
+	current_prolog_flag(cpu_count, Old),
+	setup_call_cleanup(
+	    set_prolog_flag(cpu_count, N),
+	    Goal,
+	    set_prolog_flag(cpu_count, Old)).
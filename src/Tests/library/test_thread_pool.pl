@@ -86,8 +86,58 @@ test(loop, [setup(start([])),cleanup(stop), L == Vs]) :-
 	join_all(Ids),
 	setof(V, retract(v(V)), Vs).
 
+test(workers, [setup(start([workers(true)])),cleanup(stop),
+	       [L,Created,Jobs] == [Vs,3,11]]) :-
+	numlist(0, 10, L),
+	thread_self(Me),
+	forall(between(0, 10, I),
+	       thread_create_in_pool(test, run(I), _,
+				     [at_exit(thread_send_message(Me, done))])),
+	forall(between(0, 10, _), thread_get_message(done)),
+	setof(V, retract(v(V)), Vs),
+	thread_pool_property(test, created(Created)),
+	jobs_done(11, Jobs).
+
+test(placement, [ condition(current_predicate(thread_affinity/3)),
+		  setup(start([placement(spread), detached(true)])),
+		  cleanup(stop),
+		  Affinities == Expected
+		]) :-
+	'$cpu_nodes'(Nodes),
+	length(Nodes, Count),
+	thread_self(Me),
+	forall(between(1, Count, _),
+	       thread_create_in_pool(test, send_affinity(Me), _, [])),
+	findall(A, (between(1, Count, _), thread_get_message(affinity(A))), As),
+	msort(As, Affinities),
+	msort(Nodes, Expected).
+test(placement, error(domain_error(thread_pool_placement, nowhere))) :-
+	thread_pool_create(test, 3, [placement(nowhere)]).
+
+test(create_error, [ setup(start),
+		     cleanup(stop),
+		     error(type_error(integer, foo))
+		   ]) :-
+	thread_create_in_pool(test, true, _, [stack_limit(foo)]).
+
+send_affinity(To) :-
+	thread_self(Me),
+	thread_affinity(Me, CPUs, CPUs),
+	thread_send_message(To, affinity(CPUs)).
+
 run(I) :-
 	sleep(0.05),
 	assert(v(I)).
 
+%	The manager counts a job after the at_exit hook ran.
+
+jobs_done(Min, Jobs) :-
+	between(1, 100, _),
+	thread_pool_property(test, jobs(Jobs)),
+	(   Jobs >= Min
+	->  !
+	;   sleep(0.01),
+	    fail
+	).
+
 :- end_tests(thread_pool).
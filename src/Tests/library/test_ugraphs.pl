@@ -0,0 +1,114 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(test_ugraphs,
+	  [ test_ugraphs/0
+	  ]).
+
+
+:- use_module(library(plunit)).
+:- use_module(library(ugraphs)).
+:- use_module(library(lists)).
+:- use_module(library(random)).
+
+test_ugraphs :-
+	run_tests([ ugraphs
+		  ]).
+
+% The tests compare the C versions with  the Prolog versions that are
+% used for graphs that are not proper ugraphs.
+
+:- begin_tests(ugraphs).
+
+test(top_sort, L == [1,2,3]) :-
+	top_sort([1-[2], 2-[3], 3-[]], L).
+test(top_sort, L-T == [1,2,3|T]-T) :-
+	top_sort([1-[2], 2-[3], 3-[]], L, T).
+test(top_sort, fail) :-
+	top_sort([1-[2], 2-[3], 3-[1]], _).
+test(top_sort, fail) :-
+	top_sort([a-[b],b-[x]], _).		% x is not a vertex
+test(top_sort) :-
+	forall(between(1, 100, Seed),
+	       ( random_dag(Seed, G),
+		 top_sort(G, L1),
+		 prolog_top_sort(G, L2),
+		 assertion(L1 == L2) )).
+test(reachable, Rs == [1,2,3]) :-
+	reachable(1, [1-[2], 2-[3], 3-[1], 4-[1]], Rs).
+test(reachable, fail) :-
+	reachable(5, [1-[2], 2-[3], 3-[1], 4-[1]], _).
+test(reachable) :-
+	forall(between(1, 100, Seed),
+	       ( random_graph(Seed, G),
+		 G = [V-_|_],
+		 reachable(V, G, R1),
+		 prolog_reachable(V, G, R2),
+		 assertion(R1 == R2) )).
+test(transitive_closure, C == [1-[1,2,3],2-[1,2,3],3-[1,2,3],4-[1,2,3],5-[]]) :-
+	transitive_closure([1-[2], 2-[3], 3-[1], 4-[1], 5-[]], C).
+test(transitive_closure, C == [f(X)-[g(Y)],g(Y)-[]]) :-
+	transitive_closure([f(X)-[g(Y)], g(Y)-[]], C).
+test(transitive_closure) :-
+	forall(between(1, 100, Seed),
+	       ( random_graph(Seed, G),
+		 transitive_closure(G, C1),
+		 ugraphs:warshall(G, G, C2),
+		 assertion(C1 == C2) )).
+
+:- end_tests(ugraphs).
+
+random_graph(Seed, G) :-
+	set_random(seed(Seed)),
+	random_between(1, 40, N),
+	random_between(0, 80, E),
+	numlist(1, N, Vs),
+	findall(V1-V2, ( between(1, E, _),
+			 random_between(1, N, V1),
+			 random_between(1, N, V2) ), Edges),
+	vertices_edges_to_ugraph(Vs, Edges, G).
+
+random_dag(Seed, G) :-
+	random_graph(Seed, G0),
+	findall(V-Ns, ( member(V-Ns0, G0),
+			include(<(V), Ns0, Ns) ), G).
+
+prolog_top_sort(Graph, Sorted) :-
+	ugraphs:vertices_and_zeros(Graph, Vertices, Counts0),
+	ugraphs:count_edges(Graph, Vertices, Counts0, Counts1),
+	ugraphs:select_zeros(Counts1, Vertices, Zeros),
+	ugraphs:top_sort(Zeros, Sorted, Graph, Vertices, Counts1).
+
+prolog_reachable(N, G, Rs) :-
+	ugraphs:reachable([N], G, [N], Rs).
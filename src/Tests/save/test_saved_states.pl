@@ -170,6 +170,18 @@ create_state(File, Output, Args) :-
 	debug(save, 'Saved state', []),
 	assertion(no_error(ErrOutput)).
 
+save_state(File, Output) :-
+	me(Me),
+	format(atom(Goal), 'save(~q)', [Output]),
+	test_dir(TestDir),
+	process_create(Me, ['-f', none, '-g', Goal, '-t', halt, File],
+		       [ cwd(TestDir),
+			 stderr(pipe(Err))
+		       ]),
+	read_stream_to_codes(Err, ErrOutput),
+	close(Err),
+	assertion(no_error(ErrOutput)).
+
 run_state(Exe, Args, Result) :-
 	debug(save, 'Running state ~q ~q', [Exe, Args]),
 	set_windows_path,
@@ -240,6 +252,27 @@ test(true, Result == [true]) :-
 	      run_state(Exe, [], Result)
 	    ),
 	    remove_state(Exe)).
+test(jit_indexes, Result == [[single(2)]]) :-
+	state_output(4, Exe),
+	call_cleanup(
+	    ( save_state('input/index.pl', Exe),
+	      run_state(Exe, [], Result)
+	    ),
+	    remove_state(Exe)).
+test(lazy_load, Result =@= [[4, [2,3], [A-f(A,b), B-f(B,"string")]]]) :-
+	state_output(5, Exe),
+	call_cleanup(
+	    ( save_state('input/lazy.pl', Exe),
+	      run_state(Exe, [], Result)
+	    ),
+	    remove_state(Exe)).
+test(checkpoint, Result == [[[1-1,2-4,3-9], done(3, "string")]]) :-
+	state_output(6, Exe),
+	call_cleanup(
+	    ( save_state('input/checkpoint.pl', Exe),
+	      run_state(Exe, [], Result)
+	    ),
+	    remove_state(Exe)).
 
 :- end_tests(saved_state).
 
@@ -94,6 +94,58 @@ test(multiple_dependents) :-
     assert(d2(3)),
     answers(X, q2(X), [1,2,3]).
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Each level of a4/2 and b4/2 depends on both tables of the level below,
+so the number of paths through the IDG is exponential in the number
+of levels.  Planning the re-evaluation must visit each table once.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+:- table (a4/2, b4/2) as incremental.
+:- dynamic([d4/1], [incremental(true)]).
+
+d4(1).
+
+a4(0, X) :- d4(X).
+a4(N, X) :- N > 0, M is N-1, ( a4(M, X) ; b4(M, X) ).
+b4(0, X) :- d4(X).
+b4(N, X) :- N > 0, M is N-1, ( a4(M, X) ; b4(M, X) ).
+
+test(diamonds) :-
+    answers(X, a4(40, X), [1]),
+    assert(d4(2)),
+    answers(X, a4(40, X), [1,2]),
+    retract(d4(1)),
+    answers(X, b4(40, X), [2]).
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+incr_batch/1 defers invalidation until the batch completes and only
+invalidates the tables that unify with a changed clause.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+:- table p3/2 as incremental.
+:- dynamic([d3/2], [incremental(true)]).
+
+p3(X,Y) :- d3(X,Y).
+
+d3(1,a).
+d3(2,b).
+
+test(batch, Status == complete) :-
+    answers(Y, p3(1,Y), [a]),
+    answers(Y, p3(2,Y), [b]),
+    incr_batch(( assert(d3(1,b)),
+                 assert(d3(1,c)),
+                 retract(d3(1,b)),
+                 answers(Y, p3(1,Y), [a])
+               )),
+    answers(Y, p3(1,Y), [a,c]),
+    current_table(test_reeval:p3(2,_), ATrie),
+    '$tbl_table_status'(ATrie, Status).
+test(batch_exception) :-
+    answers(Y, p3(2,Y), [b]),
+    catch(incr_batch(( assert(d3(2,c)), throw(stop) )), stop, true),
+    answers(Y, p3(2,Y), [b,c]).
+
 :- end_tests(tabling_reeval).
 
 
@@ -0,0 +1,102 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(test_save_tables,
+          [ test_save_tables/0
+          ]).
+:- use_module(library(plunit)).
+:- use_module(library(tables)).
+
+/** <module> Test saving and loading tables
+*/
+
+test_save_tables :-
+    run_tests([ save_tables
+              ]).
+
+:- table
+    path/2,
+    sp(_,_,min).
+:- table
+    ipath/2 as incremental.
+:- dynamic([ie/2], [incremental(true)]).
+
+e(1,2). e(2,3). e(3,1).
+
+path(X,Y) :- count, e(X,Y).
+path(X,Y) :- path(X,Z), e(Z,Y).
+
+sp(X,Y,1) :- e(X,Y).
+sp(X,Y,D) :- sp(X,Z,D0), e(Z,Y), D is D0+1.
+
+ipath(X,Y) :- ie(X,Y).
+ipath(X,Y) :- ipath(X,Z), ie(Z,Y).
+
+count :-
+    flag(test_save_tables, N, N+1).
+
+save_and_reload(Goal) :-
+    abolish_all_tables,
+    forall(Goal, true),
+    tmp_file_stream(binary, File, Out),
+    close(Out),
+    call_cleanup(( save_tables(File),
+                   abolish_all_tables,
+                   load_tables(File)
+                 ),
+                 delete_file(File)).
+
+:- begin_tests(save_tables, [cleanup(abolish_all_tables)]).
+
+test(variant, Ys == [1,2,3]) :-
+    save_and_reload(path(1,_)),
+    flag(test_save_tables, _, 0),
+    findall(Y, path(1,Y), Ys0),
+    sort(Ys0, Ys),
+    flag(test_save_tables, 0, 0).
+test(moded, Pairs == [1-3,2-1,3-2]) :-
+    save_and_reload(sp(1,_,_)),
+    findall(Y-D, sp(1,Y,D), Pairs0),
+    sort(Pairs0, Pairs).
+test(incremental, [ Ys == [2,3,4],
+                    cleanup(retractall(ie(_,_)))
+                  ]) :-
+    retractall(ie(_,_)),
+    assert(ie(1,2)), assert(ie(2,3)),
+    save_and_reload(ipath(1,_)),
+    assert(ie(3,4)),
+    findall(Y, ipath(1,Y), Ys0),
+    sort(Ys0, Ys).
+
+:- end_tests(save_tables).
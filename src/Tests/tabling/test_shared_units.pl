@@ -40,7 +40,8 @@
 :- use_module(library(plunit)).
 
 test_shared_units :-
-    run_tests([ shared_reeval
+    run_tests([ shared_reeval,
+                shared_stream
               ]).
 
 :- begin_tests(shared_reeval, [sto(rational_trees)]).
@@ -66,3 +67,37 @@ test(propagate_falsecount) :-
     thread_join(Id).
 
 :- end_tests(shared_reeval).
+
+:- begin_tests(shared_stream).
+
+:- table s/1 as shared.
+
+s(X) :- between(1, 5, X), sleep(0.05).
+
+test(stream, [Xs, First] == [[1,2,3,4,5], false]) :-
+    thread_create(forall(s(_), true), Id),
+    wait_table(s(_), Trie),
+    findall(X-C, (tabled_stream(s(X)), is_complete(Trie, C)), Pairs),
+    thread_join(Id),
+    pairs_keys_values(Pairs, Xs0, [First|_]),
+    msort(Xs0, Xs).
+test(complete, Xs == [1,2,3,4,5]) :-
+    findall(X, tabled_stream(s(X)), Xs0),
+    msort(Xs0, Xs).
+test(not_tabled, Xs == [a,b]) :-
+    findall(X, tabled_stream(member(X, [a,b])), Xs).
+
+wait_table(Goal, Trie) :-
+    current_table(Goal, Trie),
+    !.
+wait_table(Goal, Trie) :-
+    sleep(0.01),
+    wait_table(Goal, Trie).
+
+is_complete(Trie, C) :-
+    (   '$tbl_table_status'(Trie, complete)
+    ->  C = true
+    ;   C = false
+    ).
+
+:- end_tests(shared_stream).
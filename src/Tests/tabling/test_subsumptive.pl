@@ -0,0 +1,130 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+:- module(test_subsumptive,
+          [ test_subsumptive/0
+          ]).
+:- use_module(library(plunit)).
+:- use_module(library(lists)).
+
+/** <module> Test subsumptive tabling
+*/
+
+test_subsumptive :-
+    run_tests([ subsumptive
+              ]).
+
+:- table
+    path/2 as subsumptive,
+    t/2 as subsumptive.
+
+e(1,2). e(2,3). e(3,1). e(3,4).
+
+path(X,Y) :- e(X,Y).
+path(X,Y) :- path(X,Z), e(Z,Y).
+
+t(X, Y) :- d(X, Y).
+
+d(f(a), f(a)).
+d(f(a), f(b)).
+d(g("s", 1.5), x).
+d(g("t", 1.5), y).
+
+tables(M:Head, Tables) :-
+    functor(Head, Name, Arity),
+    findall(M:Variant,
+            ( current_table(M:Variant, _),
+              functor(Variant, Name, Arity)
+            ),
+            Tables0),
+    msort(Tables0, Tables).
+
+:- begin_tests(subsumptive, [cleanup(abolish_all_tables)]).
+
+test(instance, [Tables-Ys =@= [test_subsumptive:path(_,_)]-[1,2,3,4]]) :-
+    abolish_all_tables,
+    findall(X-Y, path(X,Y), _),
+    findall(Y, path(1,Y), Ys0),
+    sort(Ys0, Ys),
+    tables(test_subsumptive:path(_,_), Tables).
+test(shared_var, [Tables-Xs =@= [test_subsumptive:path(_,_)]-[1,2,3]]) :-
+    abolish_all_tables,
+    findall(X-Y, path(X,Y), _),
+    findall(X, path(X,X), Xs0),
+    sort(Xs0, Xs),
+    tables(test_subsumptive:path(_,_), Tables).
+test(ground, [Tables =@= [test_subsumptive:path(_,_)]]) :-
+    abolish_all_tables,
+    findall(X-Y, path(X,Y), _),
+    path(2,4),
+    \+ path(4,1),
+    tables(test_subsumptive:path(_,_), Tables).
+test(not_subsuming, [Tables =@= [ test_subsumptive:path(_,_),
+                                 test_subsumptive:path(1,_)
+                               ]]) :-
+    abolish_all_tables,
+    findall(Y, path(1,Y), _),
+    findall(X-Y, path(X,Y), _),
+    tables(test_subsumptive:path(_,_), Tables).
+test(more_specific, [Tables =@= [ test_subsumptive:path(_,_),
+                                 test_subsumptive:path(1,_)
+                               ]]) :-
+    abolish_all_tables,
+    findall(Y, path(1,Y), _),
+    findall(X-Y, path(X,Y), _),
+    path(1,4),
+    tables(test_subsumptive:path(_,_), Tables).
+test(compound, [Tables-Ys =@= [test_subsumptive:t(_,_)]-[f(a),f(b)]]) :-
+    abolish_all_tables,
+    findall(X-Y, t(X,Y), _),
+    findall(Y, t(f(a),Y), Ys0),
+    msort(Ys0, Ys),
+    tables(test_subsumptive:t(_,_), Tables).
+test(repeated_var, [Tables-Xs =@= [ test_subsumptive:t(A,A),
+                                    test_subsumptive:t(f(a),f(b))
+                                  ]-[f(a)]]) :-
+    abolish_all_tables,
+    findall(X, t(X,X), _),
+    findall(X, t(X,X), Xs),
+    t(f(a),f(b)),
+    t(f(a),f(a)),
+    tables(test_subsumptive:t(_,_), Tables).
+test(indirect, [Tables-Ys =@= [test_subsumptive:t(_,_)]-[x]]) :-
+    abolish_all_tables,
+    findall(X-Y, t(X,Y), _),
+    findall(Y, t(g("s",1.5),Y), Ys),
+    tables(test_subsumptive:t(_,_), Tables).
+
+:- end_tests(subsumptive).
@@ -77,7 +77,9 @@ test_tabling :-
                 pathss,
 
                 bas,
-                push_ret
+                push_ret,
+                table_space_eviction,
+                table_statistics
 	      ]).
 
 		 /*******************************
@@ -1352,6 +1354,68 @@ test(push_ret, MaxSteps1 == MaxSteps2) :-
 :- end_tests(push_ret).
 
 
+		 /*******************************
+		 *        TABLE EVICTION	*
+		 *******************************/
+
+:- begin_tests(table_space_eviction, [cleanup(abolish_all_tables)]).
+
+:- table evict_numbers/2.
+
+evict_numbers(N, X) :-
+    between(1, N, X).
+
+evict_fill(Hot) :-
+    forall(between(1, 2 000, I),
+           ( aggregate_all(count, evict_numbers(Hot, _), Hot),
+             N is 500+I,
+             aggregate_all(count, evict_numbers(N, _), N)
+           )).
+
+test(lru, Tables < 2 000) :-
+    abolish_all_tables,
+    current_prolog_flag(table_space, Space),
+    setup_call_cleanup(
+        set_prolog_flag(table_space, 2 000 000),
+        setup_call_cleanup(
+            set_prolog_flag(table_space_eviction, true),
+            evict_fill(100),
+            set_prolog_flag(table_space_eviction, false)),
+        set_prolog_flag(table_space, Space)),
+    assertion(current_table(test_tabling:evict_numbers(100, _), _)),
+    aggregate_all(count, current_table(test_tabling:evict_numbers(_,_), _),
+                  Tables).
+
+:- end_tests(table_space_eviction).
+
+
+		 /*******************************
+		 *       TABLE STATISTICS	*
+		 *******************************/
+
+:- begin_tests(table_statistics, [cleanup(abolish_all_tables)]).
+
+:- table stat_path/2.
+
+stat_edge(1,2).
+stat_edge(2,3).
+stat_edge(3,1).
+
+stat_path(X,Y) :- stat_edge(X,Y).
+stat_path(X,Y) :- stat_path(X,Z), stat_edge(Z,Y).
+
+test(stats, Answers-Dupl-Compl-Status == 9-3-1-complete) :-
+    abolish_all_tables,
+    aggregate_all(count, stat_path(_,_), _),
+    table_statistics(test_tabling:stat_path(_,_), Stats),
+    table{ answers:Answers, duplicates:Dupl, completions:Compl,
+	   status:Status, suspensions:Susp, time:Time } :< Stats,
+    assertion(Susp >= 1),
+    assertion(number(Time)).
+
+:- end_tests(table_statistics).
+
+
 		 /*******************************
 		 *	      COMMON		*
 		 *******************************/
@@ -136,6 +136,18 @@ test(var2, set(Y == [1,2])) :-
         test_var(a, Y).
 test(var3, set(Y == [1])) :-
         test_var(c, Y).
+test(compiled_switch, L == [[2],[x,y],[3],[],6]) :-
+	trie_new(T),
+	forall(member(K, [p(a,1),p(b,2),p(c,3),p(f(x),4),p(f(y),5),p(g(3),6)]),
+	       trie_insert(T, K)),
+	'$trie_compile'(T, _),
+	findall(X, trie_gen_compiled(T, p(b,X)), L1),
+	findall(X, trie_gen_compiled(T, p(f(X),_)), L20),
+	msort(L20, L2),
+	findall(X, trie_gen_compiled(T, p(g(X),6)), L3),
+	findall(X, trie_gen_compiled(T, p(d,X)), L4),
+	aggregate_all(count, trie_gen_compiled(T, _), C),
+	L = [L1,L2,L3,L4,C].
 
 shared_list(N, t(List,N)) :-
 	length(List, N),
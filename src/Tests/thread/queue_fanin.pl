@@ -0,0 +1,101 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+:- module(queue_fanin,
+	  [ queue_fanin/0,
+	    queue_fanin/3
+	  ]).
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Test many threads sending  to  a   single  queue.  Such  messages  are
+added to the queue without locking  it.   We  verify that the messages
+of each sender arrive in  order,  also  if   the  reader  uses  a pattern
+to select the messages of one sender first or uses thread_get_messages/3
+to get the messages in batches.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+queue_fanin :-
+	queue_fanin(8, 2000, 1),
+	queue_fanin(8, 2000, 100).
+
+queue_fanin(Senders, Count, Batch) :-
+	message_queue_create(Q),
+	findall(Id,
+		( between(1, Senders, S),
+		  thread_create(send(Q, S, Count), Id, [])
+		), Ids),
+	receive(Q, m(1, _), 1, Count),
+	Left is (Senders-1)*Count,
+	receive_any(Q, Batch, Left, []),
+	maplist(thread_join, Ids, Status),
+	maplist(==(true), Status),
+	message_queue_property(Q, size(0)),
+	message_queue_destroy(Q).
+
+send(Q, S, Count) :-
+	forall(between(1, Count, I),
+	       thread_send_message(Q, m(S, I))).
+
+receive(_, _, I, Count) :-
+	I > Count, !.
+receive(Q, Pattern, I, Count) :-
+	copy_term(Pattern, Msg),
+	thread_get_message(Q, Msg),
+	arg(2, Msg, I),
+	I2 is I+1,
+	receive(Q, Pattern, I2, Count).
+
+receive_any(_, _, 0, _) :- !.
+receive_any(Q, 1, N, Seen0) :- !,
+	thread_get_message(Q, Msg),
+	check_order([Msg], Seen0, Seen),
+	N2 is N-1,
+	receive_any(Q, 1, N2, Seen).
+receive_any(Q, Batch, N, Seen0) :-
+	thread_get_messages(Q, Batch, Msgs),
+	length(Msgs, Len),
+	Len >= 1, Len =< Batch,
+	check_order(Msgs, Seen0, Seen),
+	N2 is N-Len,
+	receive_any(Q, Batch, N2, Seen).
+
+check_order([], Seen, Seen).
+check_order([m(S, I)|T], Seen0, Seen) :-
+	(   selectchk(S-Last, Seen0, Seen1)
+	->  I =:= Last+1
+	;   I == 1,
+	    Seen1 = Seen0
+	),
+	check_order(T, [S-I|Seen1], Seen).
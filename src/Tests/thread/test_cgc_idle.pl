@@ -0,0 +1,91 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(test_cgc_idle,
+	  [ test_cgc_idle/0
+	  ]).
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Clause garbage collection caches the generations used by threads that are
+blocked waiting for a message. This test keeps a number of threads
+blocked while they have an open choice point on a dynamic predicate and
+verifies that repeated clause GC neither reclaims the clauses these
+threads may still see nor blocks reclaiming clauses that are erased
+later.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+:- dynamic(item/1).
+:- dynamic(garbage/1).
+
+test_cgc_idle :-
+	retractall(item(_)),
+	forall(between(1, 3, X), assertz(item(X))),
+	length(Workers, 4),
+	maplist(create_worker, Workers, Queues),
+	maplist(wait_ready, Workers),
+	retractall(item(_)),
+	garbage_collect_clauses,
+	forall(between(1, 1000, X), assertz(garbage(X))),
+	statistics(cgc_gained, G0),
+	retractall(garbage(_)),
+	garbage_collect_clauses,		% uses the cached marks
+	garbage_collect_clauses,
+	statistics(cgc_gained, G1),
+	G1-G0 >= 900,
+	maplist(release, Queues),
+	maplist(thread_join, Workers, Status),
+	maplist(message_queue_destroy, Queues),
+	maplist(==(exited([1,2,3])), Status).
+
+create_worker(Id, Queue) :-
+	message_queue_create(Queue),
+	thread_self(Me),
+	thread_create(worker(Me, Queue), Id, []).
+
+worker(Parent, Queue) :-
+	findall(X, ( item(X),
+		     (   X == 1
+		     ->  thread_self(Me),
+			 thread_send_message(Parent, ready(Me)),
+			 thread_get_message(Queue, go)
+		     ;   true
+		     )
+		   ), Xs),
+	thread_exit(Xs).
+
+wait_ready(Id) :-
+	thread_get_message(ready(Id)).
+
+release(Queue) :-
+	thread_send_message(Queue, go).
@@ -51,6 +51,15 @@ test_dynamic :-
 
 :- dynamic p/1.
 
+:- thread_local tl/1.
+
+tl_in_thread(Goal, Clauses) :-
+    thread_create(( Goal, findall(X, tl(X), L), thread_exit(L) ), Id),
+    thread_join(Id, exited(Clauses)).
+
+deny_assert(assertz, _) :-
+    throw(denied).
+
 concurrent_retractall(N) :-
     forall(between(1, N, I), assertz(p(I))),
     thread_create(retractall(p(_)), Id1),
@@ -63,6 +72,50 @@ test(retractall) :-
     forall(between(1, 10, _),
            concurrent_retractall(100)).
 
+test(listen_recycled, [S1-S2 == true-exception(denied)]) :-
+    thread_create(assertz(tl(1)), Id1),
+    thread_join(Id1, S1),
+    setup_call_cleanup(
+        prolog_listen(tl/1, deny_assert),
+        ( thread_create(assertz(tl(2)), Id2),
+          thread_join(Id2, S2)
+        ),
+        prolog_unlisten(tl/1, deny_assert)).
+test(template, [Before-After == [1,2,3]-[]]) :-
+    setup_call_cleanup(
+        set_thread_local_template(tl/1, [tl(1), tl(2), (tl(X) :- X = 3)]),
+        tl_in_thread(true, Before),
+        set_thread_local_template(tl/1, [])),
+    tl_in_thread(true, After).
+test(template_local, [L1-L2 == [2,9]-[1,2]]) :-
+    setup_call_cleanup(
+        set_thread_local_template(tl/1, [tl(1), tl(2)]),
+        ( tl_in_thread((retract(tl(1)), assertz(tl(9))), L1),
+          tl_in_thread(true, L2)
+        ),
+        set_thread_local_template(tl/1, [])).
+test(template_existing, [L == []]) :-
+    setup_call_cleanup(
+        set_thread_local_template(tl/1, [tl(1)]),
+        findall(X, tl(X), L),
+        set_thread_local_template(tl/1, [])).
+test(template_seed_error, [Status == exception(denied)]) :-
+    setup_call_cleanup(
+        ( set_thread_local_template(tl/1, [tl(1)]),
+          prolog_listen(tl/1, deny_assert)
+        ),
+        ( thread_create(true, Id),
+          thread_join(Id, Status)
+        ),
+        ( prolog_unlisten(tl/1, deny_assert),
+          set_thread_local_template(tl/1, [])
+        )).
+test(template_other, [error(domain_error(clause, p(1)))]) :-
+    set_thread_local_template(tl/1, [p(1)]).
+test(template_shared,
+     [error(permission_error(modify, procedure, test_dynamic:p/1))]) :-
+    set_thread_local_template(p/1, []).
+
 :- end_tests(test_dynamic).
 
 
@@ -0,0 +1,156 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(test_thread_statistics,
+          [ test_thread_statistics/0
+          ]).
+:- use_module(library(plunit)).
+:- use_module(library(statistics)).
+
+/** <module> Test per-thread resource accounting
+
+Tests the per-thread statistics keys heap_allocated, mutex_wait_time
+and queue_wait_time as well as thread_statistics_snapshot/1,
+runtime_metrics/1 and the wait histograms of message queues and mutexes.
+*/
+
+test_thread_statistics :-
+    run_tests([ thread_statistics
+              ]).
+
+:- dynamic fact/1.
+
+:- begin_tests(thread_statistics).
+
+test(heap_allocated) :-
+    statistics(heap_allocated, H0),
+    forall(between(1, 100, I), assertz(fact(I))),
+    retractall(fact(_)),
+    statistics(heap_allocated, H1),
+    assertion(H1 > H0).
+test(queue_wait) :-
+    thread_self(Me),
+    thread_create(( sleep(0.1), thread_send_message(Me, hello) ), Id, []),
+    statistics(queue_wait_time, W0),
+    thread_get_message(hello),
+    statistics(queue_wait_time, W1),
+    thread_join(Id),
+    assertion(W1-W0 > 0.05).
+test(mutex_wait) :-
+    mutex_create(M),
+    thread_self(Me),
+    thread_create(( with_mutex(M, ( thread_send_message(Me, locked),
+                                    sleep(0.1) )) ), Id, []),
+    thread_get_message(locked),
+    statistics(mutex_wait_time, W0),
+    with_mutex(M, true),
+    statistics(mutex_wait_time, W1),
+    thread_join(Id),
+    mutex_destroy(M),
+    assertion(W1-W0 > 0.05).
+test(snapshot) :-
+    thread_statistics_snapshot(List),
+    assertion(is_list(List)),
+    member(S, List),
+    get_dict(id, S, main),
+    !,
+    get_dict(time, S, Time),
+    get_dict(queue_wait, Time, QueueWait),
+    assertion(number(QueueWait)),
+    get_dict(heap_allocated, S, Heap),
+    assertion(integer(Heap)).
+
+test(metrics_queue_wait) :-
+    metric_count(swipl_queue_wait_seconds, C0),
+    thread_self(Me),
+    thread_create(( sleep(0.05), thread_send_message(Me, hello) ), Id, []),
+    thread_get_message(hello),
+    thread_join(Id),
+    metric_count(swipl_queue_wait_seconds, C1),
+    assertion(C1 > C0).
+test(metrics_gc) :-
+    metric_count(swipl_gc_seconds, C0),
+    garbage_collect,
+    metric_count(swipl_gc_seconds, C1),
+    assertion(C1 =:= C0+1).
+test(metrics_threads) :-
+    runtime_metrics(M0),
+    memberchk(metric(swipl_threads_created_total, counter, _, N0), M0),
+    thread_create(true, Id, []),
+    thread_join(Id),
+    runtime_metrics(M1),
+    memberchk(metric(swipl_threads_created_total, counter, _, N1), M1),
+    assertion(N1 > N0).
+test(metrics_text) :-
+    with_output_to(string(S), write_runtime_metrics(current_output)),
+    sub_string(S, _, _, _, "swipl_gc_seconds_bucket{le=\"+Inf\"}").
+
+test(queue_read_wait, C == 1) :-
+    message_queue_create(Q),
+    message_queue_property(Q, read_wait(histogram(0, _, _))),
+    thread_create(( sleep(0.05), thread_send_message(Q, hello) ), Id, []),
+    thread_get_message(Q, hello),
+    thread_join(Id),
+    message_queue_property(Q, read_wait(histogram(C, Sum, _))),
+    message_queue_property(Q, write_wait(histogram(0, _, _))),
+    message_queue_destroy(Q),
+    assertion(Sum > 0.02).
+test(queue_write_wait, C == 1) :-
+    message_queue_create(Q, [max_size(1)]),
+    thread_send_message(Q, first),
+    thread_create(( sleep(0.05), thread_get_message(Q, first) ), Id, []),
+    thread_send_message(Q, second),
+    thread_join(Id),
+    message_queue_property(Q, write_wait(histogram(C, _, _))),
+    message_queue_destroy(Q).
+test(mutex_wait_histogram, C == 1) :-
+    mutex_create(M),
+    mutex_property(M, wait_histogram(histogram(0, _, _))),
+    thread_self(Me),
+    thread_create(( with_mutex(M, ( thread_send_message(Me, locked),
+                                    sleep(0.05) )) ), Id, []),
+    thread_get_message(locked),
+    with_mutex(M, true),
+    thread_join(Id),
+    mutex_property(M, wait_histogram(histogram(C, _, Buckets))),
+    mutex_destroy(M),
+    last(Buckets, inf-C).
+
+metric_count(Name, Count) :-
+    runtime_metrics(Metrics),
+    memberchk(metric(Name, histogram, _, histogram(Count, _, Buckets)),
+              Metrics),
+    last(Buckets, inf-Count).
+
+:- end_tests(thread_statistics).
@@ -51,6 +51,7 @@ test_threads :-
 		    thread_property,
 		    mutex,
 		    mutex_property,
+		    rwlock,
 		    message_queue
 		  ]).
 
@@ -240,8 +241,82 @@ test(locked, [By,Count] == [Me,1]) :-
 	mutex_unlock(X),
 	mutex_destroy(X).
 
+test(acquired, Count == 3) :-
+	mutex_create(X, []),
+	forall(between(1, 3, _), with_mutex(X, true)),
+	mutex_property(X, acquired(Count)),
+	mutex_destroy(X).
+
+test(contended, [Count,Waited] == [1,true]) :-
+	thread_self(Me),
+	mutex_create(X, []),
+	thread_create(with_mutex(X, ( thread_send_message(Me, locked),
+				      sleep(0.1) )), Id, []),
+	thread_get_message(locked),
+	with_mutex(X, true),
+	thread_join(Id),
+	mutex_property(X, contended(Count)),
+	mutex_property(X, wait_time(Time)),
+	(Time > 0.05 -> Waited = true ; Waited = Time),
+	mutex_destroy(X).
+
 :- end_tests(mutex_property).
 
+:- begin_tests(rwlock).
+
+test(type, Type == rwlock) :-
+	mutex_create(X, [type(rwlock)]),
+	mutex_property(X, type(Type)),
+	mutex_destroy(X).
+test(readers, Status == read_locked(2)) :-
+	thread_self(Me),
+	mutex_create(X, [type(rwlock)]),
+	thread_create(with_read_lock(X, ( thread_send_message(Me, reading),
+					  thread_get_message(done) )),
+		      Id, []),
+	thread_get_message(reading),
+	with_read_lock(X, mutex_property(X, status(Status))),
+	thread_send_message(Id, done),
+	thread_join(Id),
+	mutex_destroy(X).
+test(writer_waits, Log == [read,write]) :-
+	thread_self(Me),
+	mutex_create(X, [type(rwlock)]),
+	thread_create(with_read_lock(X, ( thread_send_message(Me, reading),
+					  sleep(0.1),
+					  thread_send_message(Me, read) )),
+		      Id, []),
+	thread_get_message(reading),
+	with_write_lock(X, thread_send_message(Me, write)),
+	thread_join(Id),
+	thread_get_message(M1),
+	thread_get_message(M2),
+	Log = [M1,M2],
+	mutex_destroy(X).
+test(nested_read, true) :-
+	mutex_create(X, [type(rwlock)]),
+	with_read_lock(X, with_read_lock(X, true)),
+	with_write_lock(X, with_read_lock(X, true)),
+	mutex_destroy(X).
+test(upgrade, error(permission_error(lock, rwlock, X))) :-
+	mutex_create(X, [type(rwlock)]),
+	call_cleanup(with_read_lock(X, with_write_lock(X, true)),
+		     mutex_destroy(X)).
+test(exception, Status == unlocked) :-
+	mutex_create(X, [type(rwlock)]),
+	catch(with_read_lock(X, throw(oops)), oops, true),
+	mutex_property(X, status(Status)),
+	mutex_destroy(X).
+test(not_rwlock, error(type_error(rwlock, X))) :-
+	mutex_create(X),
+	call_cleanup(with_read_lock(X, true), mutex_destroy(X)).
+test(auto_create, Type == rwlock) :-
+	with_read_lock(test_rwlock_auto, true),
+	mutex_property(test_rwlock_auto, type(Type)),
+	mutex_destroy(test_rwlock_auto).
+
+:- end_tests(rwlock).
+
 
 		 /*******************************
 		 *	       QUEUES		*
@@ -0,0 +1,121 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+:- module(test_trie_insert,
+	  [ test_trie_insert/0,
+	    test_trie_insert/2,			% +Threads, +Count
+	    bench_trie_insert/2			% +MaxThreads, +Count
+	  ]).
+:- use_module(library(apply)).
+:- use_module(library(lists)).
+:- use_module(library(aggregate)).
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Test concurrent insertion into a shared   trie. All threads insert the
+same keys, each starting at a different key.  For   each  key exactly one of the
+threads must succeed and the trie must   hold each key exactly once
+afterwards.
+
+bench_trie_insert/2 prints the  throughput  of   threads  that  insert
+disjoint keys into the same trie for 1,  2, 4, ... MaxThreads threads,
+e.g.
+
+    ?- bench_trie_insert(64, 100 000).
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+test_trie_insert :-
+	test_trie_insert(4, 20 000).
+
+test_trie_insert(Threads, Count) :-
+	trie_new(Trie),
+	numlist(1, Threads, Offsets),
+	run_inserters(Offsets, insert_shared(Trie, Count), Inserted),
+	sum_list(Inserted, Count),
+	trie_property(Trie, value_count(Count)),
+	aggregate_all(count, trie_gen(Trie, _, _), Count),
+	\+ ( trie_gen(Trie, key(_, I), V), V \== I ),
+	trie_destroy(Trie).
+
+insert_shared(Trie, Count, Offset, Inserted) :-
+	aggregate_all(count,
+		      ( between(1, Count, I0),
+			I is (I0+Offset*7919) mod Count,
+			A is I mod 97,
+			trie_insert(Trie, key(A, I), I)
+		      ),
+		      Inserted).
+
+bench_trie_insert(MaxThreads, Count) :-
+	bench_threads(1, MaxThreads, Count).
+
+bench_threads(Threads, MaxThreads, _) :-
+	Threads > MaxThreads,
+	!.
+bench_threads(Threads, MaxThreads, Count) :-
+	trie_new(Trie),
+	numlist(1, Threads, Offsets),
+	get_time(T0),
+	run_inserters(Offsets, insert_disjoint(Trie, Count), _),
+	get_time(T1),
+	trie_destroy(Trie),
+	Rate is round(Threads*Count/(T1-T0)),
+	format('~t~D~8| threads: ~t~D~25| inserts/sec~n', [Threads, Rate]),
+	Next is Threads*2,
+	bench_threads(Next, MaxThreads, Count).
+
+insert_disjoint(Trie, Count, Offset, Count) :-
+	forall(between(1, Count, I),
+	       ( A is I mod 97,
+		 trie_insert(Trie, key(Offset, A, I))
+	       )).
+
+%!	run_inserters(+Offsets, :Goal, -Results)
+%
+%	Run call(Goal, Offset, Result) in a thread for each Offset and
+%	collect the results.
+
+run_inserters(Offsets, Goal, Results) :-
+	thread_self(Me),
+	maplist(create_inserter(Me, Goal), Offsets, Ids),
+	maplist(inserter_result, Ids, Results).
+
+create_inserter(Me, Goal, Offset, Id) :-
+	thread_create(( call(Goal, Offset, Result),
+			thread_send_message(Me, inserted(Offset, Result))
+		      ), Id, []).
+
+inserter_result(Id, Result) :-
+	thread_join(Id, Status),
+	Status == true,
+	thread_get_message(inserted(_, Result)).
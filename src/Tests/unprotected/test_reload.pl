@@ -172,6 +172,12 @@ test(mod_dynamic) :-
 test(goal_expansion) :-
 	reload(goal_expansion, 1),
 	reload(goal_expansion, 1).
+test(big_modify, Clauses == Expected) :-	% uses the clause index
+	reload(big_modify, 1),
+	reload(big_modify, 2),
+	file_version_terms(big_modify, 2, Terms),
+	exclude(==((:- module(big_modify, []))), Terms, Expected),
+	findall(p(X), big_modify:p(X), Clauses).
 
 :- end_tests(reconsult).
 
@@ -37,6 +37,7 @@
 #cmakedefine HAVE_DLFCN_H @HAVE_DLFCN_H@
 #cmakedefine HAVE_DLOPEN @HAVE_DLOPEN@
 #cmakedefine HAVE_DOSSLEEP @HAVE_DOSSLEEP@
+#cmakedefine HAVE_EPOLL_CREATE1 @HAVE_EPOLL_CREATE1@
 #cmakedefine HAVE_EXECINFO_H @HAVE_EXECINFO_H@
 #cmakedefine HAVE_FCHMOD @HAVE_FCHMOD@
 #cmakedefine HAVE_FOPEN64 @HAVE_FOPEN64@
@@ -50,6 +51,7 @@
 #cmakedefine HAVE_FPRESETSTICKY @HAVE_FPRESETSTICKY@
 #cmakedefine HAVE_FSTAT @HAVE_FSTAT@
 #cmakedefine HAVE_FTRUNCATE @HAVE_FTRUNCATE@
+#cmakedefine HAVE_FSYNC @HAVE_FSYNC@
 #cmakedefine HAVE_GETCWD @HAVE_GETCWD@
 #cmakedefine HAVE_GETPAGESIZE @HAVE_GETPAGESIZE@
 #cmakedefine HAVE_GETPID @HAVE_GETPID@
@@ -97,6 +99,8 @@
 #cmakedefine HAVE_MACH_O_RLD_H @HAVE_MACH_O_RLD_H@
 #cmakedefine HAVE_MACH_THREAD_ACT_H @HAVE_MACH_THREAD_ACT_H@
 #cmakedefine HAVE_MALLOC_H @HAVE_MALLOC_H@
+#cmakedefine HAVE_MALLOC_TRIM @HAVE_MALLOC_TRIM@
+#cmakedefine HAVE_MALLOC_USABLE_SIZE @HAVE_MALLOC_USABLE_SIZE@
 #cmakedefine HAVE_MBSCASECOLL @HAVE_MBSCASECOLL@
 #cmakedefine HAVE_MBSCOLL @HAVE_MBSCOLL@
 #cmakedefine HAVE_MBSNRTOWCS @HAVE_MBSNRTOWCS@
@@ -113,6 +117,7 @@
 #cmakedefine HAVE_POLL @HAVE_POLL@
 #cmakedefine HAVE_POLL_H @HAVE_POLL_H@
 #cmakedefine HAVE_POPEN @HAVE_POPEN@
+#cmakedefine HAVE_POSIX_FADVISE @HAVE_POSIX_FADVISE@
 #cmakedefine HAVE_POSIX_OPENPT @HAVE_POSIX_OPENPT@
 #cmakedefine HAVE_SYS_CPUSET_H @HAVE_SYS_CPUSET_H@
 #cmakedefine HAVE_CPUSET_T @HAVE_CPUSET_T@
@@ -145,6 +150,7 @@
 #cmakedefine HAVE_SELECT @HAVE_SELECT@
 #cmakedefine HAVE_SEMA_INIT @HAVE_SEMA_INIT@
 #cmakedefine HAVE_SEM_INIT @HAVE_SEM_INIT@
+#cmakedefine HAVE_SENDFILE @HAVE_SENDFILE@
 #cmakedefine HAVE_SETENV @HAVE_SETENV@
 #cmakedefine HAVE_SETLOCALE @HAVE_SETLOCALE@
 #cmakedefine HAVE_SGTTYB @HAVE_SGTTYB@
@@ -180,12 +186,15 @@
 #cmakedefine HAVE_SYSCONF @HAVE_SYSCONF@
 #cmakedefine HAVE_SYSCTLBYNAME @HAVE_SYSCTLBYNAME@
 #cmakedefine HAVE_SYS_DIR_H @HAVE_SYS_DIR_H@
+#cmakedefine HAVE_SYS_EPOLL_H @HAVE_SYS_EPOLL_H@
 #cmakedefine HAVE_SYS_FILE_H @HAVE_SYS_FILE_H@
 #cmakedefine HAVE_SYS_MMAN_H @HAVE_SYS_MMAN_H@
 #cmakedefine HAVE_SYS_NDIR_H @HAVE_SYS_NDIR_H@
 #cmakedefine HAVE_SYS_PARAM_H @HAVE_SYS_PARAM_H@
 #cmakedefine HAVE_SYS_RESOURCE_H @HAVE_SYS_RESOURCE_H@
+#cmakedefine HAVE_SYS_SDT_H @HAVE_SYS_SDT_H@
 #cmakedefine HAVE_SYS_SELECT_H @HAVE_SYS_SELECT_H@
+#cmakedefine HAVE_SYS_SENDFILE_H @HAVE_SYS_SENDFILE_H@
 #cmakedefine HAVE_SYS_STAT_H @HAVE_SYS_STAT_H@
 #cmakedefine HAVE_SYS_STROPTS_H @HAVE_SYS_STROPTS_H@
 #cmakedefine HAVE_SYS_SYSCALL_H @HAVE_SYS_SYSCALL_H@
@@ -193,6 +202,7 @@
 #cmakedefine HAVE_SYS_TERMIO_H @HAVE_SYS_TERMIO_H@
 #cmakedefine HAVE_SYS_TIME_H @HAVE_SYS_TIME_H@
 #cmakedefine HAVE_SYS_TYPES_H @HAVE_SYS_TYPES_H@
+#cmakedefine HAVE_SYS_UIO_H @HAVE_SYS_UIO_H@
 #cmakedefine HAVE_SYS_WAIT_H @HAVE_SYS_WAIT_H@
 #cmakedefine HAVE_TCSETATTR @HAVE_TCSETATTR@
 #cmakedefine HAVE_TERM_H @HAVE_TERM_H@
@@ -213,11 +223,13 @@
 #cmakedefine HAVE_WINSOCK2_H @HAVE_WINSOCK2_H@
 #cmakedefine HAVE_WORKING_FORK @HAVE_WORKING_FORK@
 #cmakedefine HAVE_WORKING_VFORK @HAVE_WORKING_VFORK@
+#cmakedefine HAVE_WRITEV @HAVE_WRITEV@
 #cmakedefine HAVE_WSAPOLL @HAVE_WSAPOLL@
 #cmakedefine HAVE_ZLIB_H @HAVE_ZLIB_H@
 #cmakedefine HAVE_ZUTIL_H @HAVE_ZUTIL_H@
 #cmakedefine HAVE__BUILTIN_CLZ @HAVE__BUILTIN_CLZ@
 #cmakedefine HAVE__BUILTIN_POPCOUNT @HAVE__BUILTIN_POPCOUNT@
+#cmakedefine HAVE__BUILTIN_MUL_OVERFLOW @HAVE__BUILTIN_MUL_OVERFLOW@
 #cmakedefine HAVE_GCC_ATOMIC @HAVE_GCC_ATOMIC@
 #cmakedefine HAVE_GCC_ATOMIC_8 @HAVE_GCC_ATOMIC_8@
 #cmakedefine HAVE__NSGETENVIRON @HAVE__NSGETENVIRON@
@@ -57,6 +57,26 @@
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 This program creates pl-codetable.c, pl-jumptable.ic   and pl-vmi.h from
 pl-vmi.c.
+
+Using -s file, it also creates _superinstructions_ for the VMI sequences
+in  `file`.  Each  non-empty  line  of  this  file  holds  a sequence of
+instruction names, optionally  preceded  by   a  count.  Lines  starting
+with # are comments.  This is the format written by vmi_sequences/2 from
+scripts/vmi-sequences.pl, which uses the counters of a COUNTING build (see
+pl-wam.c). A sequence A B C defines the superinstructions A__B and B__C.
+
+A superinstruction A__B has the  arguments of A and  is a copy of the
+body of A in which NEXT_INSTRUCTION checks  whether the next instruction
+is B (or  a superinstruction  starting with  B).   If so, it  jumps there
+directly, avoiding  the  indirect  dispatch.  The  compiler replaces A by
+A__B if it is followed by B.  decode() maps A__B  to A, so the rest of
+the system never sees the fused instructions.  The bodies are written to
+pl-vmi-fused.ic, which is included after pl-vmi.c.
+
+Only instructions that are not part  of a BEGIN_SHAREDVARS block, have a
+fixed number of arguments, do  not define  labels and use NEXT_INSTRUCTION
+can be the first instruction of a sequence.  Supervisor, tabling, control and exit instructions are never
+fused because  the  system  compares  their  opcodes directly.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 const char *program;
@@ -65,18 +85,31 @@ const char *vmi_file    = "pl-vmi.c";
 const char *ctable_file = "pl-codetable.ic";
 const char *jump_table  = "pl-jumptable.ic";
 const char *vmi_hdr	= "pl-vmi.h";
+const char *fused_file	= "pl-vmi-fused.ic";
+const char *seq_file	= NULL;
 
 #define MAX_VMI 1000
+#define MAX_FUSED 32
+#define MAX_OPCODES 255			/* see initWamTable() */
 
 typedef struct				/* VMI( */
 { char *name;				/* Name */
   char *flags;				/* Flags (VIF_*) */
   char *argc;				/* Argument length (or VM_DYNARGC) */
   char *args;				/* Argument types (max 3) */
+  char *body;				/* Body text (NULL if not fusable) */
 } vmi;					/* ) */
 
+typedef struct
+{ int first;				/* Index of first VMI */
+  int second;				/* Index of second VMI */
+  char *name;				/* Name of the superinstruction */
+} fused_vmi;
+
 vmi vmi_list[MAX_VMI];
 int vmi_count = 0;
+fused_vmi fused_list[MAX_FUSED];
+int fused_count = 0;
 
 char *synopsis;
 size_t syn_size = 0;
@@ -173,19 +206,92 @@ my_strndup(const char *in, size_t len)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The body of a VMI runs from the line after  VMI(...) to the first line
+that starts with a }. body_of()  returns  a  copy  or  NULL if the body
+cannot be used for a superinstruction.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+is_label(const char *s)
+{ const char *e;
+
+  s = skip_ws(s);
+  if ( !s || !(*s == '_' || isalpha(*s&0xff)) )
+    return 0;
+  for(e=s; *e == '_' || isalnum(*e&0xff); e++)
+    ;
+  if ( e-s == 7 && strncmp(s, "default", 7) == 0 )
+    return 0;
+  e = skip_ws(e);
+
+  return e && e[0] == ':' && e[1] != ':';
+}
+
+
+static char *
+body_of(char **lines, int nlines, int here)
+{ char *body = NULL;
+  size_t len = 0;
+  int has_next = 0;
+  int i;
+
+  if ( here >= nlines || lines[here][0] != '{' )
+    return NULL;
+
+  for(i=here; i<nlines; i++)
+  { const char *l = lines[i];
+    size_t ll = strlen(l);
+
+    if ( strncmp(l, "VMI(", 4) == 0 || is_label(l) )
+      break;
+    if ( strstr(l, "NEXT_INSTRUCTION") )
+      has_next = 1;
+
+    body = realloc(body, len+ll+1);
+    memcpy(body+len, l, ll+1);
+    len += ll;
+
+    if ( l[0] == '}' )
+    { if ( has_next )
+	return body;
+      break;
+    }
+  }
+
+  free(body);
+  return NULL;
+}
+
+
 static int
 load_vmis(const char *file)
 { FILE *fd = fopen(file, "r");
 
   if ( fd )
   { char buf[1024];
-    int line = 0;
+    char **lines = NULL;
+    int nlines = 0;
+    int line;
+    int shared = 0;
 
     while(fgets(buf, sizeof(buf), fd))
-    { line++;
+    { lines = realloc(lines, sizeof(*lines)*(nlines+1));
+      lines[nlines] = malloc(strlen(buf)+1);
+      strcpy(lines[nlines++], buf);
+    }
+    fclose(fd);
 
-      if ( strncmp(buf, "VMI(", 4) == 0 )
-      { const char *s1 = skip_ws(buf+4);
+    for(line=0; line<nlines; line++)
+    { char *l = lines[line];
+
+      if ( strncmp(l, "BEGIN_SHAREDVARS", 16) == 0 )
+	shared++;
+      else if ( strncmp(l, "END_SHAREDVARS", 14) == 0 )
+	shared--;
+
+      if ( strncmp(l, "VMI(", 4) == 0 )
+      { const char *s1 = skip_ws(l+4);
 	const char *e1 = skip_id(s1);
 	const char *s2 = skip_ws(skip_over(e1, ','));
 	const char *e2 = skip_flags(s2);
@@ -195,7 +301,7 @@ load_vmis(const char *file)
 	const char *e4 = skip_over(s4, ')');
 
 	if ( !e4 )
-	{ fprintf(stderr, "Syntax error at %s:%d\n", file, line);
+	{ fprintf(stderr, "Syntax error at %s:%d\n", file, line+1);
 	  exit(1);
 	} else
 	  e4--;				/* backspace over ) */
@@ -204,6 +310,8 @@ load_vmis(const char *file)
 	vmi_list[vmi_count].flags = my_strndup(s2, e2-s2);
 	vmi_list[vmi_count].argc  = my_strndup(s3, e3-s3);
 	vmi_list[vmi_count].args  = my_strndup(s4, e4-s4);
+	vmi_list[vmi_count].body  = shared ? NULL
+					   : body_of(lines, nlines, line+1);
 
 	add_synopsis(s1, e1-s1);	/* flags (s2) isn't needed for VM signature */
 	add_synopsis(s3, e3-s3);
@@ -213,7 +321,10 @@ load_vmis(const char *file)
       }
     }
 
-    fclose(fd);
+    for(line=0; line<nlines; line++)
+      free(lines[line]);
+    free(lines);
+
     return 0;
   }
 
@@ -306,8 +417,30 @@ emit_code_table(const char *to)
 	    vmi_list[i].argc,
 	    vmi_list[i].args[0] ? vmi_list[i].args : "0");
   }
+  for(i=0; i<fused_count; i++)
+  { const vmi *v = &vmi_list[fused_list[i].first];
+    char name[100];
+
+    fprintf(out, "  {\"%s\", %s, %s, %s, {%s}},\n",
+	    mystrlwr(name, fused_list[i].name),
+	    fused_list[i].name,
+	    v->flags,
+	    v->argc,
+	    v->args[0] ? v->args : "0");
+  }
 
   fprintf(out, "  { NULL, 0, 0, 0, {0} }\n");
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "const vmi_fusion vmiFusionTable[] = {\n");
+  fprintf(out, "  /* {first, second, fused} */\n");
+  for(i=0; i<fused_count; i++)
+  { fprintf(out, "  {%s, %s, %s},\n",
+	    vmi_list[fused_list[i].first].name,
+	    vmi_list[fused_list[i].second].name,
+	    fused_list[i].name);
+  }
+  fprintf(out, "  { VMI_END_LIST, VMI_END_LIST, VMI_END_LIST }\n");
   fprintf(out, "};\n");
   fclose(out);
 
@@ -336,6 +469,9 @@ emit_jump_table(const char *to)
   for(i=0; i<vmi_count; i++)
   { fprintf(out, "  &&%s_LBL,\n", vmi_list[i].name);
   }
+  for(i=0; i<fused_count; i++)
+  { fprintf(out, "  &&%s_LBL,\n", fused_list[i].name);
+  }
 
   fprintf(out, "  NULL\n");
   fprintf(out, "};\n");
@@ -366,10 +502,14 @@ emit_code_defs(const char *to)
   for(i=0; i<vmi_count; i++)
   { fprintf(out, "  %s,\n", vmi_list[i].name);
   }
+  for(i=0; i<fused_count; i++)
+  { fprintf(out, "  %s,\n", fused_list[i].name);
+  }
 
   fprintf(out, "  VMI_END_LIST\n");
   fprintf(out, "} vmi;\n\n");
   fprintf(out, "#define I_HIGHEST ((int)VMI_END_LIST)\n");
+  fprintf(out, "#define I_FIRST_FUSED %d\n", vmi_count);
   fprintf(out, "#define VM_SIGNATURE 0x%x\n", MurmurHashAligned2(synopsis, syn_size, 0x12345678));
 
   fclose(out);
@@ -377,6 +517,202 @@ emit_code_defs(const char *to)
   return update_file(tmp, to);
 }
 
+		 /*******************************
+		 *      SUPERINSTRUCTIONS	*
+		 *******************************/
+
+static int
+find_vmi(const char *name)
+{ int i;
+
+  for(i=0; i<vmi_count; i++)
+  { const char *s = vmi_list[i].name;
+    const char *n = name;
+
+    for(; *s && toupper(*n&0xff) == *s; s++, n++)
+      ;
+    if ( !*s && !*n )
+      return i;
+  }
+
+  return -1;
+}
+
+
+static int
+can_fuse_first(int i)
+{ static const char *never[] =
+  { "S_", "T_", "D_", "C_", "I_EXIT", "I_FEXIT", NULL };
+  const char **p;
+
+  if ( !vmi_list[i].body || strcmp(vmi_list[i].argc, "VM_DYNARGC") == 0 )
+    return 0;
+  for(p=never; *p; p++)
+  { if ( strncmp(vmi_list[i].name, *p, strlen(*p)) == 0 )
+      return 0;
+  }
+
+  return 1;
+}
+
+
+static void
+add_fused(int first, int second)
+{ fused_vmi *f;
+  size_t len;
+  int i;
+
+  for(i=0; i<fused_count; i++)
+  { if ( fused_list[i].first == first && fused_list[i].second == second )
+      return;
+  }
+
+  if ( !can_fuse_first(first) )
+  { if ( verbose )
+      fprintf(stderr, "\t%s cannot be fused\n", vmi_list[first].name);
+    return;
+  }
+  if ( fused_count == MAX_FUSED || vmi_count+fused_count+1 >= MAX_OPCODES )
+  { fprintf(stderr, "%s: too many superinstructions; skipped %s %s\n",
+	    program, vmi_list[first].name, vmi_list[second].name);
+    return;
+  }
+
+  f = &fused_list[fused_count++];
+  f->first  = first;
+  f->second = second;
+  len = strlen(vmi_list[first].name)+strlen(vmi_list[second].name)+3;
+  f->name = malloc(len);
+  snprintf(f->name, len, "%s__%s",
+	   vmi_list[first].name, vmi_list[second].name);
+}
+
+
+static int
+load_sequences(const char *file)
+{ FILE *fd = fopen(file, "r");
+  char buf[1024];
+  int line = 0;
+
+  if ( !fd )
+  { fprintf(stderr, "%s: cannot open %s\n", program, file);
+    return -1;
+  }
+
+  while(fgets(buf, sizeof(buf), fd))
+  { char *s = buf;
+    int prev = -1;
+
+    line++;
+    s = skip_ws(s);
+    if ( *s == '#' )
+      continue;
+    while( *s == '-' || isdigit(*s&0xff) )	/* optional count */
+      s++;
+
+    for(;;)
+    { char *e;
+      int i;
+
+      while( *s && (isspace(*s&0xff) || *s == ',') )
+	s++;
+      if ( !*s )
+	break;
+      for(e=s; *e == '_' || isalnum(*e&0xff); e++)
+	;
+      if ( e == s )
+      { fprintf(stderr, "Syntax error at %s:%d\n", file, line);
+	fclose(fd);
+	return -1;
+      }
+      if ( *e )
+	*e++ = '\0';
+      if ( (i=find_vmi(s)) < 0 )
+      { fprintf(stderr, "%s:%d: unknown VMI %s\n", file, line, s);
+	prev = -1;
+      } else
+      { if ( prev >= 0 )
+	  add_fused(prev, i);
+	prev = i;
+      }
+      s = e;
+    }
+  }
+
+  fclose(fd);
+  return 0;
+}
+
+
+static void
+emit_fused_next(FILE *out, const fused_vmi *f)
+{ int i;
+
+  fprintf(out, "#define FUSED_NEXT_%s \\\n\tdo { VMI_FUSED_TRY(%s); ",
+	  f->name, vmi_list[f->second].name);
+  for(i=0; i<fused_count; i++)
+  { if ( fused_list[i].first == f->second )
+      fprintf(out, "VMI_FUSED_TRY(%s); ", fused_list[i].name);
+  }
+  fprintf(out, "NEXT_INSTRUCTION; } while(0)\n");
+}
+
+
+static void
+emit_fused_body(FILE *out, const fused_vmi *f)
+{ const char *s = vmi_list[f->first].body;
+  const char *tok = "NEXT_INSTRUCTION";
+  size_t tlen = strlen(tok);
+
+  while(*s)
+  { if ( strncmp(s, tok, tlen) == 0 &&
+	 !(s[tlen] == '_' || isalnum(s[tlen]&0xff)) )
+    { fprintf(out, "FUSED_NEXT_%s", f->name);
+      s += tlen;
+    } else if ( *s == '_' || isalnum(*s&0xff) )
+    { do
+      { putc(*s++, out);
+      } while( *s == '_' || isalnum(*s&0xff) );
+    } else
+    { putc(*s++, out);
+    }
+  }
+}
+
+
+static int
+emit_fused(const char *to)
+{ const char *tmp = "vmi.tmp";
+  FILE *out = fopen(tmp, "w");
+  int i;
+
+  fprintf(out, "/*  File: %s\n\n", to);
+  fprintf(out, "    This file provides the superinstructions.  It is included after\n");
+  fprintf(out, "    %s in the VM interpreter.\n", vmi_file);
+  fprintf(out, "\n");
+  fprintf(out, "    Note: this file is generated by %s from %s", program, vmi_file);
+  if ( seq_file )
+    fprintf(out, " and\n    %s", seq_file);
+  fprintf(out, ".  DO NOT EDIT\n");
+  fprintf(out, "*/\n\n");
+
+  for(i=0; i<fused_count; i++)
+  { const fused_vmi *f = &fused_list[i];
+    const vmi *v = &vmi_list[f->first];
+
+    fprintf(out, "/* %s followed by %s */\n", v->name, vmi_list[f->second].name);
+    emit_fused_next(out, f);
+    fprintf(out, "VMI(%s, %s, %s, (%s))\n", f->name, v->flags, v->argc, v->args);
+    emit_fused_body(out, f);
+    fprintf(out, "#undef FUSED_NEXT_%s\n\n", f->name);
+  }
+
+  fclose(out);
+
+  return update_file(tmp, to);
+}
+
+
 int
 main(int argc, char **argv)
 { program = argv[0];
@@ -390,6 +726,11 @@ main(int argc, char **argv)
     argv++;
     verbose = 1;
   }
+  if ( argc >= 2 && strcmp(argv[0], "-s") == 0 )
+  { seq_file = argv[1];
+    argc -= 2;
+    argv += 2;
+  }
 
   if ( argc == 1 )
     snprintf(buf, sizeof(buf), "%s/%s", argv[0], vmi_file);
@@ -400,10 +741,17 @@ main(int argc, char **argv)
   load_vmis(buf);
   if ( verbose )
     fprintf(stderr, "Found %d VMs\n", vmi_count);
+  if ( seq_file )
+  { if ( load_sequences(seq_file) != 0 )
+      return 1;
+    if ( verbose )
+      fprintf(stderr, "Created %d superinstructions\n", fused_count);
+  }
 
   if ( emit_code_table(ctable_file) == 0 &&
        emit_jump_table(jump_table) == 0 &&
-       emit_code_defs(vmi_hdr) == 0 )
+       emit_code_defs(vmi_hdr) == 0 &&
+       emit_fused(fused_file) == 0 )
     return 0;
   else
     return 1;
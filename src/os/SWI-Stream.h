@@ -135,6 +135,7 @@ stuff.
 #define EPLEXCEPTION	1001		/* errno: pending Prolog exception */
 
 #define SIO_BUFSIZE	(4096)		/* buffering buffer-size */
+#define SIO_MAXBUFSIZE	(1024*1024)	/* max size of a growing buffer */
 #define SIO_LINESIZE	(1024)		/* Sgets() default buffer size */
 #define SIO_OMAGIC	(7212676)	/* old magic number */
 #define SIO_MAGIC	(7212677)	/* magic number */
@@ -220,11 +221,17 @@ typedef struct io_stream
   struct io_stream *	downstream;	/* stream providing our output */
   unsigned		newline : 2;	/* Newline mode */
   unsigned		erased : 1;	/* Stream was erased */
+  unsigned		fixed_buffer : 1; /* Do not grow the buffer */
+  unsigned		mapped : 1;	/* Buffer is a mapped file */
   int			io_errno;	/* Save errno value */
   char *		message;	/* error/warning message */
   void *		exception;	/* pending exception (record_t) */
   void *		context;	/* getStreamContext() */
   struct PL_locale *	locale;		/* Locale associated to stream */
+  int			owner;		/* Owning thread (0: none) */
+  int			owner_held;	/* Owner holds the mutex */
+  int			owner_depth;	/* Lock nesting of the owner */
+  volatile int		owner_revoke;	/* Other thread wants access */
   intptr_t		reserved[4];	/* reserved for extension */
 } IOSTREAM;
 
@@ -372,6 +379,9 @@ PL_EXPORT(void)		Sreset(void);
 PL_EXPORT(int)		S__fupdatefilepos_getc(IOSTREAM *s, int c);
 PL_EXPORT(int)		S__fillbuf(IOSTREAM *s);
 PL_EXPORT(int)		Sset_timeout(IOSTREAM *s, int tmo);
+PL_EXPORT(int)		Sset_read_ahead(IOSTREAM *s, size_t window);
+PL_EXPORT(int)		Ssendfile(IOSTREAM *in, IOSTREAM *out,
+				  int64_t len, int64_t *copied);
 PL_EXPORT(int)		Sunit_size(IOSTREAM *s);
 					/* byte I/O */
 PL_EXPORT(int)		Sputc(int c, IOSTREAM *s);
@@ -408,6 +418,11 @@ PL_EXPORT(char *)	Sfgets(char *buf, int n, IOSTREAM *s);
 PL_EXPORT(char *)	Sgets(char *buf);
 PL_EXPORT(ssize_t)	Sread_pending(IOSTREAM *s,
 				      char *buf, size_t limit, int flags);
+PL_EXPORT(size_t)	Sread_ascii(IOSTREAM *s,
+				    char *buf, size_t size,
+				    const uint32_t stop[4]);
+PL_EXPORT(size_t)	Swrite_ascii(IOSTREAM *s,
+				     const char *buf, size_t len);
 PL_EXPORT(size_t)	Spending(IOSTREAM *s);
 PL_EXPORT(int)		Sfputs(const char *q, IOSTREAM *s);
 PL_EXPORT(int)		Sputs(const char *q);
@@ -424,6 +439,7 @@ PL_EXPORT(int)		Sdprintf(const char *fm, ...);
 PL_EXPORT(int)		Slock(IOSTREAM *s);
 PL_EXPORT(int)		StryLock(IOSTREAM *s);
 PL_EXPORT(int)		Sunlock(IOSTREAM *s);
+PL_EXPORT(int)		Srelease_owner(IOSTREAM *s, int force);
 PL_EXPORT(IOSTREAM *)	Snew(void *handle, int flags, IOFUNCTIONS *functions);
 PL_EXPORT(IOSTREAM *)	Sopen_file(const char *path, const char *how);
 PL_EXPORT(IOSTREAM *)	Sfdopen(int fd, const char *type);
@@ -47,6 +47,36 @@ This module defines:
 See manual for details.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Case conversion of ISO Latin-1 characters uses  two tables that are filled
+using towlower() and towupper() when the locale is initialised and when
+setlocale/3 changes LC_CTYPE. Converting text thus only calls the C library for wide
+characters.  Note that a few ISO Latin-1 characters map outside ISO Latin-1,
+e.g., towupper(0xff) is 0x178.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static pl_wchar_t lcase_map[256];
+static pl_wchar_t ucase_map[256];
+
+static void
+init_case_maps(void)
+{ int c;
+
+  for(c=0; c<256; c++)
+  { lcase_map[c] = (pl_wchar_t)towlower(c);
+    ucase_map[c] = (pl_wchar_t)towupper(c);
+  }
+}
+
+static inline wint_t
+fold_case(wint_t c, int down)
+{ if ( c < 256 )
+    return down ? lcase_map[c] : ucase_map[c];
+
+  return down ? towlower(c) : towupper(c);
+}
+
+
 #define CTX_CHAR 0			/* Class(Char) */
 #define CTX_CODE 1			/* Class(Int) */
 
@@ -124,12 +154,12 @@ flower(wint_t chr)
 
 static int
 ftoupper(wint_t chr)
-{ return towupper(chr);
+{ return fold_case(chr, FALSE);
 }
 
 static int
 ftolower(wint_t chr)
-{ return towlower(chr);
+{ return fold_case(chr, TRUE);
 }
 
 static int
@@ -524,6 +554,67 @@ get_chr_from_text(const PL_chars_t *t, size_t index)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+case_latin1() converts the case of len ISO Latin-1 characters from in to
+out. It returns the index of the first character whose conversion is not
+ISO Latin-1 or len if all characters have been converted.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static size_t
+case_latin1(const unsigned char *in, char *out, size_t len, int down)
+{ const pl_wchar_t *map = (down ? lcase_map : ucase_map);
+  size_t i;
+
+  for(i=0; i<len; i++)
+  { pl_wchar_t c = map[in[i]];
+
+    if ( c > 0xff )
+      break;
+    out[i] = (char)c;
+  }
+
+  return i;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+unify_text_case() unifies out with the  lower   (down)  or  upper case
+version of tin as an object of text_type (PL_ATOM or PL_STRING).
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+unify_text_case(term_t out, PL_chars_t *tin, int down, int text_type)
+{ PL_chars_t tout;
+  size_t i;
+  int rc;
+
+  tout.encoding  = tin->encoding;
+  tout.length    = tin->length;
+  tout.canonical = FALSE;		/* or TRUE? Can WCHAR map to ISO? */
+
+  init_tout(&tout, tin->length);
+
+  if ( tin->encoding == ENC_ISO_LATIN_1 )
+  { const unsigned char *in = (const unsigned char*)tin->text.t;
+
+    i = case_latin1(in, tout.text.t, tin->length, down);
+    if ( i < tin->length )
+    { PL_promote_text(&tout);
+      for( ; i<tin->length; i++)
+	tout.text.w[i] = fold_case(in[i], down);
+    }
+  } else
+  { for(i=0; i<tin->length; i++)
+      tout.text.w[i] = fold_case(tin->text.w[i], down);
+  }
+
+  rc = PL_unify_text(out, 0, &tout, text_type);
+  PL_free_text(&tout);
+
+  return rc;
+}
+
+
 static foreign_t
 modify_case_atom(term_t in, term_t out, int down, int text_type ARG_LD)
 { PL_chars_t tin, tout;
@@ -532,7 +623,7 @@ modify_case_atom(term_t in, term_t out, int down, int text_type ARG_LD)
     return FALSE;
 
   if ( PL_get_text(out, &tout, CVT_ATOMIC) )
-  { unsigned int i;
+  { size_t i;
 
     if ( tin.length != tout.length )
       fail;
@@ -541,71 +632,13 @@ modify_case_atom(term_t in, term_t out, int down, int text_type ARG_LD)
     { wint_t ci = get_chr_from_text(&tin, i);
       wint_t co = get_chr_from_text(&tout, i);
 
-      if ( down )
-      { if ( co != towlower(ci) )
-	  fail;
-      } else
-      { if ( co != towupper(ci) )
-	  fail;
-      }
+      if ( co != fold_case(ci, down) )
+	fail;
     }
 
     succeed;
   } else if ( PL_is_variable(out) )
-  { unsigned int i;
-
-    tout.encoding  = tin.encoding;
-    tout.length    = tin.length;
-    tout.canonical = FALSE;		/* or TRUE? Can WCHAR map to ISO? */
-
-    init_tout(&tout, tin.length);
-
-    if ( tin.encoding == ENC_ISO_LATIN_1 )
-    { const unsigned char *in = (const unsigned char*)tin.text.t;
-
-      if ( down )
-      { for(i=0; i<tin.length; i++)
-	{ wint_t c = towlower(in[i]);
-
-	  if ( c > 255 )
-	  { PL_promote_text(&tout);
-	    for( ; i<tin.length; i++)
-	    { tout.text.w[i] = towlower(in[i]);
-	    }
-	    break;
-	  } else
-	  { tout.text.t[i] = (char)c;
-	  }
-	}
-      } else				/* upcase */
-      { for(i=0; i<tin.length; i++)
-	{ wint_t c = towupper(in[i]);
-
-	  if ( c > 255 )
-	  { PL_promote_text(&tout);
-	    for( ; i<tin.length; i++)
-	    { tout.text.w[i] = towupper(in[i]);
-	    }
-	    break;
-	  } else
-	  { tout.text.t[i] = (char)c;
-	  }
-	}
-      }
-    } else
-    { if ( down )
-      { for(i=0; i<tin.length; i++)
-	{ tout.text.w[i] = towlower(tin.text.w[i]);
-	}
-      } else
-      { for(i=0; i<tin.length; i++)
-	{ tout.text.w[i] = towupper(tin.text.w[i]);
-	}
-      }
-    }
-
-    PL_unify_text(out, 0, &tout, text_type);
-    PL_free_text(&tout);
+  { unify_text_case(out, &tin, down, text_type);
 
     succeed;
   } else
@@ -731,6 +764,7 @@ init_locale(void)
   if ( !setlocale(LC_COLLATE, "") )
   { DEBUG(0, Sdprintf("Failed to set LC_COLLATE locale\n"));
   }
+  init_case_maps();
 
   return rc;
 }
@@ -786,6 +820,8 @@ PRED_IMPL("setlocale", 3, setlocale, 0)
 #ifdef O_LOCALE
       updateLocale(lcp->category, locale);
 #endif
+      if ( lcp->category == LC_CTYPE || lcp->category == LC_ALL )
+	init_case_maps();
 
       succeed;
     }
@@ -912,5 +948,6 @@ initEncoding(void)
 void
 initCharTypes(void)
 { initEncoding();
+  init_case_maps();
 }
 
@@ -93,3 +93,11 @@ extern const char _PL_char_types[];	/* array of character types */
 
 #define toLowerW(c)	((unsigned)(c) <= 'Z' ? (c) + 'a' - 'A' : towlower(c))
 #define makeLowerW(c)	((c) >= 'A' && (c) <= 'Z' ? toLower(c) : towlower(c))
+
+
+		 /*******************************
+		 *	  CASE CONVERSION	*
+		 *******************************/
+
+COMMON(int)	unify_text_case(term_t out, PL_chars_t *tin,
+				int down, int text_type);
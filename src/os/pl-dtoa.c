@@ -34,6 +34,7 @@
 
 #include "pl-incl.h"
 #include "pl-dtoa.h"
+#include <float.h>
 
 #ifdef WORDS_BIGENDIAN
 #define IEEE_MC68k 1
@@ -79,3 +80,383 @@ FREE_DTOA_LOCK(int n)
 #endif /*MULTIPLE_THREADS*/
 
 #include "dtoa.c"
+
+
+		 /*******************************
+		 *	 SHORTEST DIGITS	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+dtoa_shortest() implements Grisu3  by  Florian  Loitsch  ("Printing
+Floating-Point Numbers Quickly and Accurately with Integers", PLDI 2010)
+along the lines of the double-conversion library. It produces the same
+digits as dtoa() in mode 0, but only uses 64-bit integer arithmetic. For
+about 0.5% of the doubles Grisu3 cannot prove that the  result  is  the
+shortest and closest. In that case it returns NULL and the  caller  must
+use dtoa().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct diy_fp
+{ uint64_t f;				/* significand */
+  int	   e;				/* binary exponent */
+} diy_fp;
+
+typedef struct cached_power
+{ uint64_t f;				/* normalized significand */
+  int16_t  e;				/* binary exponent */
+  int16_t  k;				/* decimal exponent */
+} cached_power;
+
+#define MIN_TARGET_EXPONENT	(-60)
+#define MAX_TARGET_EXPONENT	(-32)
+#define CACHED_POWERS_OFFSET	348	/* -cached_powers[0].k */
+#define CACHED_POWERS_DISTANCE	8	/* decimal distance between entries */
+
+static const cached_power cached_powers[] =
+{
+  { UINT64_C(0xfa8fd5a0081c0288), -1220, -348 },
+  { UINT64_C(0xbaaee17fa23ebf76), -1193, -340 },
+  { UINT64_C(0x8b16fb203055ac76), -1166, -332 },
+  { UINT64_C(0xcf42894a5dce35ea), -1140, -324 },
+  { UINT64_C(0x9a6bb0aa55653b2d), -1113, -316 },
+  { UINT64_C(0xe61acf033d1a45df), -1087, -308 },
+  { UINT64_C(0xab70fe17c79ac6ca), -1060, -300 },
+  { UINT64_C(0xff77b1fcbebcdc4f), -1034, -292 },
+  { UINT64_C(0xbe5691ef416bd60c), -1007, -284 },
+  { UINT64_C(0x8dd01fad907ffc3c),  -980, -276 },
+  { UINT64_C(0xd3515c2831559a83),  -954, -268 },
+  { UINT64_C(0x9d71ac8fada6c9b5),  -927, -260 },
+  { UINT64_C(0xea9c227723ee8bcb),  -901, -252 },
+  { UINT64_C(0xaecc49914078536d),  -874, -244 },
+  { UINT64_C(0x823c12795db6ce57),  -847, -236 },
+  { UINT64_C(0xc21094364dfb5637),  -821, -228 },
+  { UINT64_C(0x9096ea6f3848984f),  -794, -220 },
+  { UINT64_C(0xd77485cb25823ac7),  -768, -212 },
+  { UINT64_C(0xa086cfcd97bf97f4),  -741, -204 },
+  { UINT64_C(0xef340a98172aace5),  -715, -196 },
+  { UINT64_C(0xb23867fb2a35b28e),  -688, -188 },
+  { UINT64_C(0x84c8d4dfd2c63f3b),  -661, -180 },
+  { UINT64_C(0xc5dd44271ad3cdba),  -635, -172 },
+  { UINT64_C(0x936b9fcebb25c996),  -608, -164 },
+  { UINT64_C(0xdbac6c247d62a584),  -582, -156 },
+  { UINT64_C(0xa3ab66580d5fdaf6),  -555, -148 },
+  { UINT64_C(0xf3e2f893dec3f126),  -529, -140 },
+  { UINT64_C(0xb5b5ada8aaff80b8),  -502, -132 },
+  { UINT64_C(0x87625f056c7c4a8b),  -475, -124 },
+  { UINT64_C(0xc9bcff6034c13053),  -449, -116 },
+  { UINT64_C(0x964e858c91ba2655),  -422, -108 },
+  { UINT64_C(0xdff9772470297ebd),  -396, -100 },
+  { UINT64_C(0xa6dfbd9fb8e5b88f),  -369,  -92 },
+  { UINT64_C(0xf8a95fcf88747d94),  -343,  -84 },
+  { UINT64_C(0xb94470938fa89bcf),  -316,  -76 },
+  { UINT64_C(0x8a08f0f8bf0f156b),  -289,  -68 },
+  { UINT64_C(0xcdb02555653131b6),  -263,  -60 },
+  { UINT64_C(0x993fe2c6d07b7fac),  -236,  -52 },
+  { UINT64_C(0xe45c10c42a2b3b06),  -210,  -44 },
+  { UINT64_C(0xaa242499697392d3),  -183,  -36 },
+  { UINT64_C(0xfd87b5f28300ca0e),  -157,  -28 },
+  { UINT64_C(0xbce5086492111aeb),  -130,  -20 },
+  { UINT64_C(0x8cbccc096f5088cc),  -103,  -12 },
+  { UINT64_C(0xd1b71758e219652c),   -77,   -4 },
+  { UINT64_C(0x9c40000000000000),   -50,    4 },
+  { UINT64_C(0xe8d4a51000000000),   -24,   12 },
+  { UINT64_C(0xad78ebc5ac620000),     3,   20 },
+  { UINT64_C(0x813f3978f8940984),    30,   28 },
+  { UINT64_C(0xc097ce7bc90715b3),    56,   36 },
+  { UINT64_C(0x8f7e32ce7bea5c70),    83,   44 },
+  { UINT64_C(0xd5d238a4abe98068),   109,   52 },
+  { UINT64_C(0x9f4f2726179a2245),   136,   60 },
+  { UINT64_C(0xed63a231d4c4fb27),   162,   68 },
+  { UINT64_C(0xb0de65388cc8ada8),   189,   76 },
+  { UINT64_C(0x83c7088e1aab65db),   216,   84 },
+  { UINT64_C(0xc45d1df942711d9a),   242,   92 },
+  { UINT64_C(0x924d692ca61be758),   269,  100 },
+  { UINT64_C(0xda01ee641a708dea),   295,  108 },
+  { UINT64_C(0xa26da3999aef774a),   322,  116 },
+  { UINT64_C(0xf209787bb47d6b85),   348,  124 },
+  { UINT64_C(0xb454e4a179dd1877),   375,  132 },
+  { UINT64_C(0x865b86925b9bc5c2),   402,  140 },
+  { UINT64_C(0xc83553c5c8965d3d),   428,  148 },
+  { UINT64_C(0x952ab45cfa97a0b3),   455,  156 },
+  { UINT64_C(0xde469fbd99a05fe3),   481,  164 },
+  { UINT64_C(0xa59bc234db398c25),   508,  172 },
+  { UINT64_C(0xf6c69a72a3989f5c),   534,  180 },
+  { UINT64_C(0xb7dcbf5354e9bece),   561,  188 },
+  { UINT64_C(0x88fcf317f22241e2),   588,  196 },
+  { UINT64_C(0xcc20ce9bd35c78a5),   614,  204 },
+  { UINT64_C(0x98165af37b2153df),   641,  212 },
+  { UINT64_C(0xe2a0b5dc971f303a),   667,  220 },
+  { UINT64_C(0xa8d9d1535ce3b396),   694,  228 },
+  { UINT64_C(0xfb9b7cd9a4a7443c),   720,  236 },
+  { UINT64_C(0xbb764c4ca7a44410),   747,  244 },
+  { UINT64_C(0x8bab8eefb6409c1a),   774,  252 },
+  { UINT64_C(0xd01fef10a657842c),   800,  260 },
+  { UINT64_C(0x9b10a4e5e9913129),   827,  268 },
+  { UINT64_C(0xe7109bfba19c0c9d),   853,  276 },
+  { UINT64_C(0xac2820d9623bf429),   880,  284 },
+  { UINT64_C(0x80444b5e7aa7cf85),   907,  292 },
+  { UINT64_C(0xbf21e44003acdd2d),   933,  300 },
+  { UINT64_C(0x8e679c2f5e44ff8f),   960,  308 },
+  { UINT64_C(0xd433179d9c8cb841),   986,  316 },
+  { UINT64_C(0x9e19db92b4e31ba9),  1013,  324 },
+  { UINT64_C(0xeb96bf6ebadf77d9),  1039,  332 },
+  { UINT64_C(0xaf87023b9bf0ee6b),  1066,  340 }
+};
+
+static const uint32_t small_powers_of_ten[] =
+{ 0, 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+  1000000000
+};
+
+
+static inline diy_fp
+diy_fp_mul(diy_fp x, diy_fp y)
+{ uint64_t a = x.f >> 32, b = x.f & 0xffffffff;
+  uint64_t c = y.f >> 32, d = y.f & 0xffffffff;
+  uint64_t ac = a*c, bc = b*c, ad = a*d, bd = b*d;
+  uint64_t tmp = (bd>>32) + (ad&0xffffffff) + (bc&0xffffffff);
+  diy_fp r;
+
+  tmp += (uint64_t)1<<31;		/* round */
+  r.f = ac + (ad>>32) + (bc>>32) + (tmp>>32);
+  r.e = x.e + y.e + 64;
+
+  return r;
+}
+
+
+static inline diy_fp
+diy_fp_normalize(diy_fp x)
+{ while ( !(x.f & ((uint64_t)1<<63)) )
+  { x.f <<= 1;
+    x.e--;
+  }
+
+  return x;
+}
+
+
+static int
+round_weed(char *buffer, int length, uint64_t distance_too_high_w,
+	   uint64_t unsafe_interval, uint64_t rest, uint64_t ten_kappa,
+	   uint64_t unit)
+{ uint64_t small_distance = distance_too_high_w - unit;
+  uint64_t big_distance = distance_too_high_w + unit;
+
+  while ( rest < small_distance &&
+	  unsafe_interval - rest >= ten_kappa &&
+	  ( rest + ten_kappa < small_distance ||
+	    small_distance - rest >= rest + ten_kappa - small_distance ) )
+  { buffer[length-1]--;
+    rest += ten_kappa;
+  }
+
+  if ( rest < big_distance &&
+       unsafe_interval - rest >= ten_kappa &&
+       ( rest + ten_kappa < big_distance ||
+	 big_distance - rest > rest + ten_kappa - big_distance ) )
+    return FALSE;
+
+  return 2*unit <= rest && rest <= unsafe_interval - 4*unit;
+}
+
+
+static int
+digit_gen(diy_fp low, diy_fp w, diy_fp high,
+	  char *buffer, int *length, int *kappa)
+{ uint64_t unit = 1;
+  uint64_t too_low = low.f - unit;
+  uint64_t too_high = high.f + unit;
+  uint64_t unsafe_interval = too_high - too_low;
+  int shift = -w.e;
+  uint64_t one = (uint64_t)1 << shift;
+  uint32_t integrals = (uint32_t)(too_high >> shift);
+  uint64_t fractionals = too_high & (one-1);
+  uint32_t divisor;
+  int k;
+
+  for(k=10; k > 0 && integrals < small_powers_of_ten[k]; k--)
+    ;
+  divisor = small_powers_of_ten[k];
+  *kappa = k;
+  *length = 0;
+
+  while ( *kappa > 0 )
+  { uint64_t rest;
+
+    buffer[(*length)++] = (char)('0' + integrals/divisor);
+    integrals %= divisor;
+    (*kappa)--;
+    rest = ((uint64_t)integrals << shift) + fractionals;
+    if ( rest < unsafe_interval )
+      return round_weed(buffer, *length, too_high - w.f, unsafe_interval,
+			rest, (uint64_t)divisor << shift, unit);
+    divisor /= 10;
+  }
+
+  for(;;)
+  { fractionals *= 10;
+    unit *= 10;
+    unsafe_interval *= 10;
+    buffer[(*length)++] = (char)('0' + (fractionals >> shift));
+    fractionals &= one-1;
+    (*kappa)--;
+    if ( fractionals < unsafe_interval )
+      return round_weed(buffer, *length, (too_high - w.f)*unit,
+			unsafe_interval, fractionals, one, unit);
+  }
+}
+
+
+/* dtoa_shortest() fills buf (at least 18 bytes) with the shortest digit
+   string for d and returns buf with *rve pointing at the end, or NULL.
+   The arguments are as for dtoa() with mode 0.
+*/
+
+char *
+dtoa_shortest(double d, char *buf, int *decpt, int *sign, char **rve)
+{ union { double d; uint64_t i; } u;
+  uint64_t frac;
+  int bexp, lower_closer;
+  diy_fp v, w, m_plus, m_minus, c;
+  int min_exp, k, mk, length, kappa;
+  const cached_power *cp;
+
+  u.d = d;
+  *sign = (int)(u.i >> 63);
+  frac = u.i & (((uint64_t)1<<52)-1);
+  bexp = (int)((u.i >> 52) & 0x7ff);
+
+  if ( bexp == 0x7ff )			/* Inf and NaN */
+    return NULL;
+  if ( bexp == 0 && frac == 0 )		/* zero: "0", decpt = 1 */
+  { buf[0] = '0';
+    buf[1] = EOS;
+    *decpt = 1;
+    *rve = buf+1;
+    return buf;
+  }
+
+  if ( bexp == 0 )			/* denormal */
+  { v.f = frac;
+    v.e = 1-1075;
+  } else
+  { v.f = frac | ((uint64_t)1<<52);
+    v.e = bexp-1075;
+  }
+  lower_closer = (frac == 0 && bexp > 1);
+
+  m_plus.f = (v.f<<1) + 1;
+  m_plus.e = v.e - 1;
+  m_plus = diy_fp_normalize(m_plus);
+  if ( lower_closer )
+  { m_minus.f = (v.f<<2) - 1;
+    m_minus.e = v.e - 2;
+  } else
+  { m_minus.f = (v.f<<1) - 1;
+    m_minus.e = v.e - 1;
+  }
+  m_minus.f <<= m_minus.e - m_plus.e;
+  m_minus.e = m_plus.e;
+  w = diy_fp_normalize(v);
+
+  min_exp = MIN_TARGET_EXPONENT - (w.e + 64);
+  k = (int)ceil((min_exp + 63) * 0.30102999566398114);
+  cp = &cached_powers[(CACHED_POWERS_OFFSET + k - 1)/CACHED_POWERS_DISTANCE + 1];
+  assert(min_exp <= cp->e && cp->e <= MAX_TARGET_EXPONENT - (w.e + 64));
+  c.f = cp->f;
+  c.e = cp->e;
+  mk = cp->k;
+
+  if ( !digit_gen(diy_fp_mul(m_minus, c), diy_fp_mul(w, c),
+		  diy_fp_mul(m_plus, c), buf, &length, &kappa) )
+    return NULL;
+
+  buf[length] = EOS;
+  *decpt = length + kappa - mk;
+  *rve = buf+length;
+
+  return buf;
+}
+
+
+		 /*******************************
+		 *	   FAST STRTOD		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+strtod_fast() handles the common case of a float  whose  decimal digits
+fit in 2^53 and that has a small decimal exponent. In that case the
+result  is  a  single  correctly  rounded  IEEE  multiplication  or
+division (Clinger's fast path). It returns FALSE if the number is not of
+the form  [-+]digits[.digits][(e|E)[-+]digits]  or  outside  this range,
+in which case the caller must use strtod().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static const double fast_tens[] =
+{ 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+  1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+  1e22
+};
+
+#define FAST_MAX_TEN 22
+#define FAST_MAX_DIGITS ((uint64_t)1<<53)
+#define is_dec_digit(c) ((c) >= '0' && (c) <= '9')
+
+int
+strtod_fast(const char *in, char **end, double *value)
+{ const unsigned char *s = (const unsigned char *)in;
+  uint64_t m = 0;
+  int neg = FALSE, exp = 0, digits = 0;
+  double d;
+
+  if ( *s == '-' || *s == '+' )
+    neg = (*s++ == '-');
+  if ( !is_dec_digit(*s) )
+    return FALSE;
+  for( ; is_dec_digit(*s); s++, digits++ )
+  { if ( digits >= 19 )
+      return FALSE;
+    m = m*10 + (*s-'0');
+  }
+  if ( *s == '.' && is_dec_digit(s[1]) )
+  { for(s++; is_dec_digit(*s); s++, digits++, exp--)
+    { if ( digits >= 19 )
+	return FALSE;
+      m = m*10 + (*s-'0');
+    }
+  }
+  if ( *s == 'e' || *s == 'E' )
+  { const unsigned char *e = s+1;
+    int eneg = FALSE, ev = 0;
+
+    if ( *e == '-' || *e == '+' )
+      eneg = (*e++ == '-');
+    if ( !is_dec_digit(*e) )
+      return FALSE;
+    for( ; is_dec_digit(*e); e++ )
+    { if ( ev > 1000 )
+	return FALSE;
+      ev = ev*10 + (*e-'0');
+    }
+    exp += eneg ? -ev : ev;
+    s = e;
+  }
+
+  if ( m > FAST_MAX_DIGITS || exp < -FAST_MAX_TEN || exp > FAST_MAX_TEN )
+    return FALSE;
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD != 0
+  return FALSE;				/* extended precision: double rounding */
+#endif
+
+  d = (double)m;
+  if ( exp < 0 )
+    d /= fast_tens[-exp];
+  else
+    d *= fast_tens[exp];
+
+  *value = neg ? -d : d;
+  *end = (char *)s;
+
+  return TRUE;
+}
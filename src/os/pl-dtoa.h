@@ -45,5 +45,8 @@ COMMON(char *)	dtoa(double dd, int mode, int ndigits,
 		     int *decpt, int *sign, char **rve);
 COMMON(void)	freedtoa(char *s);
 double		strtod(const char *in, char **end);
+COMMON(char *)	dtoa_shortest(double d, char *buf,
+			      int *decpt, int *sign, char **rve);
+COMMON(int)	strtod_fast(const char *in, char **end, double *value);
 
 #endif /*PL_DTOA_H_INCLUDED*/
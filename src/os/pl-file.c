@@ -1229,6 +1229,38 @@ closeStream(IOSTREAM *s)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Streams opened using open/4  with  owner(true)   are  owned  by the
+opening thread and do not use  their   mutex  while only this thread
+accesses them (see pl-stream.c). revokeStreamOwner() is called if another
+thread wants access, signalling the owner  to release its streams using
+releaseOwnedStreams(). A thread also releases its streams when it exits.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef O_PLMT
+void
+revokeStreamOwner(int tid)
+{ PL_thread_raise(tid, SIG_STREAM_OWNER);
+}
+#endif
+
+void
+releaseOwnedStreams(int force)
+{ TableEnum e;
+  IOSTREAM *s;
+
+  if ( !streamContext )
+    return;
+
+  e = newTableEnum(streamContext);
+  while( advanceTableEnum(e, (void**)&s, NULL) )
+  { if ( s->owner )
+      Srelease_owner(s, force);
+  }
+  freeTableEnum(e);
+}
+
+
 /* Close all files.  As this only happens during termination we report,
  * but otherwise ignore possible errors.
  */
@@ -2361,10 +2393,49 @@ typedef struct fdentry
 #define ACTION_WAIT ATOM_select
 #endif
 
+#ifdef HAVE_POLL
+static int
+get_poll_timeout(term_t timeout, int *to)
+{ GET_LD
+  atom_t a;
+  double time;
+
+  if ( PL_get_atom(timeout, &a) && a == ATOM_infinite )
+  { *to = -1;
+  } else if ( PL_is_integer(timeout) )
+  { int i;
+
+    if ( PL_get_integer(timeout, &i) )
+    { if ( i <= 0 )
+      { *to = 0;
+      } else if ( (int64_t)i*1000 <= INT_MAX )
+      { *to = i*1000;
+      } else
+      { return PL_representation_error("timeout");
+      }
+    } else
+    { return PL_representation_error("timeout");
+    }
+  } else if ( PL_get_float_ex(timeout, &time) )
+  { if ( time > 0.0 )
+    { if ( time * 1000.0 <= (double)INT_MAX )
+      { *to = (int)(time*1000.0);
+      } else
+      { return PL_domain_error("timeout", timeout);
+      }
+    } else
+    { *to = 0;
+    }
+  } else
+    return FALSE;
+
+  return TRUE;
+}
+#endif
+
 static
 PRED_IMPL("wait_for_input", 3, wait_for_input, 0)
 { PRED_LD
-  double time;
   fdentry map_buf[FASTMAP_SIZE];
   fdentry *map;
 #ifdef HAVE_POLL
@@ -2375,13 +2446,14 @@ PRED_IMPL("wait_for_input", 3, wait_for_input, 0)
   SOCKET max = 0;
   fd_set fds;
   struct timeval t, *to;
+  double time;
+  atom_t a;
 #endif
   term_t head      = PL_new_term_ref();
   term_t streams   = PL_copy_term_ref(A1);
   term_t available = PL_copy_term_ref(A2);
   term_t ahead     = PL_new_term_ref();
   int from_buffer  = 0;
-  atom_t a;
   size_t count;
   int i, nfds;
   int rc = FALSE;
@@ -2467,36 +2539,7 @@ PRED_IMPL("wait_for_input", 3, wait_for_input, 0)
   }
 
 #ifdef HAVE_POLL
-  if ( PL_get_atom(timeout, &a) && a == ATOM_infinite )
-  { to = -1;
-  } else if ( PL_is_integer(timeout) )
-  { int i;
-
-    if ( PL_get_integer(timeout, &i) )
-    { if ( i <= 0 )
-      { to = 0;
-      } else if ( (int64_t)i*1000 <= INT_MAX )
-      { to = i*1000;
-      } else
-      { PL_representation_error("timeout");
-	goto out;
-      }
-    } else
-    { PL_representation_error("timeout");
-      goto out;
-    }
-  } else if ( PL_get_float_ex(timeout, &time) )
-  { if ( time > 0.0 )
-    { if ( time * 1000.0 <= (double)INT_MAX )
-      { to = (int)(time*1000.0);
-      } else
-      { PL_domain_error("timeout", timeout);
-	goto out;
-      }
-    } else
-    { to = 0;
-    }
-  } else
+  if ( !get_poll_timeout(timeout, &to) )
     goto out;
 #else /*HAVE_POLL*/
   if ( PL_get_atom(timeout, &a) && a == ATOM_infinite )
@@ -2591,6 +2634,463 @@ out:
 #endif /* HAVE_SELECT */
 
 
+		/********************************
+		*	     WAIT SETS		*
+		********************************/
+
+#if defined(HAVE_POLL) && !defined(__WINDOWS__)
+#define HAVE_PRED_WAIT_SET 1
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A wait set is a persistent set of input streams. Where wait_for_input/3
+passes all streams to poll() on each call, streams are added to a wait
+set once and, if epoll() is provided, waiting  does not depend on the
+number of streams in the set.  This allows a few threads to serve many
+connections.
+
+A stream is armed by  wait_set_add/2  and   reported  at  most once: it is
+disarmed when reported until it is added   again. This is the semantics
+of EPOLLONESHOT and allows multiple threads  to   wait  on the same set,
+where each ready stream is handed to exactly one of them.
+
+Entries are indexed by file descriptor.  An entry references its stream
+(see Sreference()), so the stream is not  deallocated while it is in the
+set.  Streams that have been closed are dropped when they are reported.
+
+As wait_for_input/3, wait_set_wait/3 must consider  input that is already
+buffered.  We cannot check the buffers of  all streams on each wait, but
+buffered input can only exist when a  stream is (re-)armed after reading
+from it.  wait_set_add/2 therefore marks such streams as pending.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EPOLL_CREATE1)
+#include <sys/epoll.h>
+#define USE_EPOLL 1
+#endif
+
+#define WAIT_SET_MAX_READY 64		/* max streams reported per wait */
+
+typedef struct wait_entry
+{ IOSTREAM *stream;			/* Referenced stream */
+  int	    armed;			/* Report when ready */
+  int	    pending;			/* Input is buffered */
+} wait_entry;
+
+typedef struct wait_set
+{ simpleMutex mutex;			/* Protects the entries */
+  wait_entry *entries;			/* Entries, indexed by fd */
+  int	      size;			/* Allocated entries */
+  int	      pending;			/* # pending entries */
+  int	      closed;			/* wait_set_destroy/1 was called */
+#ifdef USE_EPOLL
+  int	      epfd;			/* epoll() handle */
+#endif
+} wait_set;
+
+typedef struct wait_set_ref
+{ wait_set *set;
+} wait_set_ref;
+
+
+static void
+unreference_stream(IOSTREAM *s)
+{ if ( Sunreference(s) == 0 && s->erased )
+    unallocStream(s);
+}
+
+
+static void
+clear_wait_entry(wait_set *ws, int fd)
+{ wait_entry *e = &ws->entries[fd];
+
+#ifdef USE_EPOLL
+  epoll_ctl(ws->epfd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+  if ( e->pending )
+    ws->pending--;
+  unreference_stream(e->stream);
+  memset(e, 0, sizeof(*e));
+}
+
+
+static void
+close_wait_set(wait_set *ws)
+{ int fd;
+
+  simpleMutexLock(&ws->mutex);
+  if ( !ws->closed )
+  { for(fd=0; fd<ws->size; fd++)
+    { if ( ws->entries[fd].stream )
+	clear_wait_entry(ws, fd);
+    }
+    free(ws->entries);
+    ws->entries = NULL;
+    ws->size = 0;
+#ifdef USE_EPOLL
+    close(ws->epfd);
+#endif
+    ws->closed = TRUE;
+  }
+  simpleMutexUnlock(&ws->mutex);
+}
+
+
+static int
+write_wait_set(IOSTREAM *s, atom_t aref, int flags)
+{ wait_set_ref *ref = PL_blob_data(aref, NULL, NULL);
+  (void)flags;
+
+  Sfprintf(s, "<wait_set>(%p)", ref->set);
+  return TRUE;
+}
+
+
+static int
+release_wait_set(atom_t aref)
+{ wait_set_ref *ref = PL_blob_data(aref, NULL, NULL);
+  wait_set *ws = ref->set;
+
+  close_wait_set(ws);
+  simpleMutexDelete(&ws->mutex);
+  free(ws);
+
+  return TRUE;
+}
+
+
+static PL_blob_t wait_set_blob =
+{ PL_BLOB_MAGIC,
+  PL_BLOB_UNIQUE,
+  "wait_set",
+  release_wait_set,
+  NULL,
+  write_wait_set
+};
+
+
+static int
+get_wait_set(term_t t, wait_set **wsp)
+{ void *data;
+  PL_blob_t *type;
+
+  if ( PL_get_blob(t, &data, NULL, &type) && type == &wait_set_blob )
+  { wait_set_ref *ref = data;
+
+    if ( !ref->set->closed )
+    { *wsp = ref->set;
+      return TRUE;
+    }
+
+    return PL_existence_error("wait_set", t);
+  }
+
+  return PL_type_error("wait_set", t);
+}
+
+
+static int
+get_waitable_stream(term_t t, IOSTREAM **sp, int *fdp)
+{ IOSTREAM *s;
+  int fd;
+
+  if ( !PL_get_stream(t, &s, SIO_INPUT) )
+    return FALSE;
+  if ( (fd = Sfileno(s)) < 0 )
+  { releaseStream(s);
+    return PL_domain_error("waitable_stream", t);
+  }
+
+  *sp = s;
+  *fdp = fd;
+  return TRUE;
+}
+
+
+/** wait_set_create(-Set) is det.
+*/
+
+static
+PRED_IMPL("wait_set_create", 1, wait_set_create, 0)
+{ wait_set *ws;
+  wait_set_ref ref;
+
+  if ( !(ws = malloc(sizeof(*ws))) )
+    return PL_no_memory();
+  memset(ws, 0, sizeof(*ws));
+#ifdef USE_EPOLL
+  if ( (ws->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0 )
+  { free(ws);
+    return PL_error(NULL, 0, MSG_ERRNO, ERR_SYSCALL, "epoll_create1");
+  }
+#endif
+  simpleMutexInit(&ws->mutex);
+  ref.set = ws;
+
+  return PL_unify_blob(A1, &ref, sizeof(ref), &wait_set_blob);
+}
+
+
+/** wait_set_destroy(+Set) is det.
+*/
+
+static
+PRED_IMPL("wait_set_destroy", 1, wait_set_destroy, 0)
+{ wait_set *ws;
+
+  if ( !get_wait_set(A1, &ws) )
+    return FALSE;
+  close_wait_set(ws);
+
+  return TRUE;
+}
+
+
+/* add_wait_entry() adds or re-arms fd.  Returns 0 or an errno value.
+*/
+
+static int
+add_wait_entry(wait_set *ws, int fd, IOSTREAM *s)
+{ wait_entry *e;
+#ifdef USE_EPOLL
+  struct epoll_event ev;
+#endif
+
+  if ( fd >= ws->size )
+  { int newsize = ws->size ? ws->size : 64;
+    wait_entry *new;
+
+    while ( newsize <= fd )
+      newsize *= 2;
+    if ( !(new = realloc(ws->entries, newsize*sizeof(*new))) )
+      return ENOMEM;
+    memset(&new[ws->size], 0, (newsize-ws->size)*sizeof(*new));
+    ws->entries = new;
+    ws->size = newsize;
+  }
+
+  e = &ws->entries[fd];
+  if ( e->stream != s )
+  { if ( e->stream )		/* fd was closed and reused */
+      clear_wait_entry(ws, fd);
+    Sreference(s);
+    e->stream = s;
+  }
+
+#ifdef USE_EPOLL
+  memset(&ev, 0, sizeof(ev));
+  ev.events  = EPOLLIN|EPOLLONESHOT;
+  ev.data.fd = fd;
+  if ( epoll_ctl(ws->epfd, EPOLL_CTL_MOD, fd, &ev) < 0 &&
+       ( errno != ENOENT || epoll_ctl(ws->epfd, EPOLL_CTL_ADD, fd, &ev) < 0 ) )
+  { int err = errno;
+
+    clear_wait_entry(ws, fd);
+    return err;
+  }
+#endif
+
+  e->armed = TRUE;
+  if ( Spending(s) > 0 && !e->pending )
+  { e->pending = TRUE;
+    ws->pending++;
+  }
+
+  return 0;
+}
+
+
+/** wait_set_add(+Set, +Stream) is det.
+*/
+
+static
+PRED_IMPL("wait_set_add", 2, wait_set_add, 0)
+{ wait_set *ws;
+  IOSTREAM *s;
+  int fd, rc;
+
+  if ( !get_wait_set(A1, &ws) ||
+       !get_waitable_stream(A2, &s, &fd) )
+    return FALSE;
+
+  simpleMutexLock(&ws->mutex);
+  rc = ws->closed ? EBADF : add_wait_entry(ws, fd, s);
+  simpleMutexUnlock(&ws->mutex);
+  releaseStream(s);
+
+  switch(rc)
+  { case 0:
+      return TRUE;
+    case ENOMEM:
+      return PL_no_memory();
+    case EPERM:				/* e.g., a regular file */
+      return PL_domain_error("waitable_stream", A2);
+    default:
+      errno = rc;
+      return PL_error(NULL, 0, MSG_ERRNO, ERR_SYSCALL, "epoll_ctl");
+  }
+}
+
+
+/** wait_set_remove(+Set, +Stream) is det.
+*/
+
+static
+PRED_IMPL("wait_set_remove", 2, wait_set_remove, 0)
+{ wait_set *ws;
+  IOSTREAM *s;
+  int fd;
+
+  if ( !get_wait_set(A1, &ws) ||
+       !get_waitable_stream(A2, &s, &fd) )
+    return FALSE;
+
+  simpleMutexLock(&ws->mutex);
+  if ( fd < ws->size && ws->entries[fd].stream == s )
+    clear_wait_entry(ws, fd);
+  simpleMutexUnlock(&ws->mutex);
+  releaseStream(s);
+
+  return TRUE;
+}
+
+
+/* take_ready() disarms fd and adds  its  stream   to  ready  if it is
+   still armed.  Must be called with the set locked.
+*/
+
+static void
+take_ready(wait_set *ws, int fd, IOSTREAM **ready, int *nready)
+{ wait_entry *e;
+
+  if ( fd >= ws->size || !(e=&ws->entries[fd])->stream || !e->armed )
+    return;
+
+  if ( e->stream->erased )		/* closed */
+  { clear_wait_entry(ws, fd);
+    return;
+  }
+
+  e->armed = FALSE;
+  if ( e->pending )
+  { e->pending = FALSE;
+    ws->pending--;
+  }
+  Sreference(e->stream);
+  ready[(*nready)++] = e->stream;
+}
+
+
+static int
+take_pending(wait_set *ws, IOSTREAM **ready, int *nready)
+{ int fd;
+
+  for(fd=0; fd<ws->size && ws->pending > 0 && *nready < WAIT_SET_MAX_READY;
+      fd++)
+  { if ( ws->entries[fd].pending )
+      take_ready(ws, fd, ready, nready);
+  }
+
+  return *nready;
+}
+
+
+/** wait_set_wait(+Set, -Ready, +TimeOut) is det.
+*/
+
+static
+PRED_IMPL("wait_set_wait", 3, wait_set_wait, 0)
+{ PRED_LD
+  wait_set *ws;
+  IOSTREAM *ready[WAIT_SET_MAX_READY];
+  int nready = 0;
+  int to, i, rc;
+  term_t tail = PL_copy_term_ref(A2);
+  term_t head = PL_new_term_ref();
+#ifdef USE_EPOLL
+  struct epoll_event events[WAIT_SET_MAX_READY];
+#else
+  struct pollfd *fds;
+  int nfds, fd;
+#endif
+
+  if ( !get_wait_set(A1, &ws) ||
+       !get_poll_timeout(A3, &to) )
+    return FALSE;
+
+  simpleMutexLock(&ws->mutex);
+  if ( ws->closed )
+  { simpleMutexUnlock(&ws->mutex);
+    return PL_existence_error("wait_set", A1);
+  }
+  if ( ws->pending > 0 && take_pending(ws, ready, &nready) )
+  { simpleMutexUnlock(&ws->mutex);
+    goto unify;
+  }
+#ifdef USE_EPOLL
+  simpleMutexUnlock(&ws->mutex);
+
+  while ( (rc=epoll_wait(ws->epfd, events, WAIT_SET_MAX_READY, to)) == -1 &&
+	  errno == EINTR )
+  { if ( PL_handle_signals() < 0 )
+      return FALSE;
+  }
+  if ( rc < 0 )
+    return PL_error(NULL, 0, MSG_ERRNO, ERR_SYSCALL, "epoll_wait");
+
+  simpleMutexLock(&ws->mutex);
+  for(i=0; i<rc; i++)
+    take_ready(ws, events[i].data.fd, ready, &nready);
+  simpleMutexUnlock(&ws->mutex);
+#else /*USE_EPOLL*/
+  if ( !(fds = malloc((ws->size ? ws->size : 1)*sizeof(*fds))) )
+  { simpleMutexUnlock(&ws->mutex);
+    return PL_no_memory();
+  }
+  for(fd=0, nfds=0; fd<ws->size; fd++)
+  { if ( ws->entries[fd].armed )
+    { fds[nfds].fd = fd;
+      fds[nfds].events = POLLIN;
+      fds[nfds].revents = 0;
+      nfds++;
+    }
+  }
+  simpleMutexUnlock(&ws->mutex);
+
+  while ( (rc=poll(fds, nfds, to)) == -1 && errno == EINTR )
+  { if ( PL_handle_signals() < 0 )
+    { free(fds);
+      return FALSE;
+    }
+  }
+  if ( rc < 0 )
+  { free(fds);
+    return PL_error(NULL, 0, MSG_ERRNO, ERR_SYSCALL, "poll");
+  }
+
+  simpleMutexLock(&ws->mutex);
+  for(i=0; i<nfds && nready < WAIT_SET_MAX_READY; i++)
+  { if ( (fds[i].revents & (POLLIN|POLLERR|POLLHUP)) )
+      take_ready(ws, fds[i].fd, ready, &nready);
+  }
+  simpleMutexUnlock(&ws->mutex);
+  free(fds);
+#endif /*USE_EPOLL*/
+
+unify:
+  rc = TRUE;
+  for(i=0; i<nready; i++)
+  { if ( rc && !(PL_unify_list(tail, head, tail) &&
+		 unify_stream_ref(head, ready[i])) )
+      rc = FALSE;
+    unreference_stream(ready[i]);
+  }
+
+  return rc && PL_unify_nil(tail);
+}
+
+#endif /*HAVE_POLL && !__WINDOWS__*/
+
+
 		/********************************
 		*      PROLOG CONNECTION        *
 		*********************************/
@@ -2678,7 +3178,10 @@ read_pending_input(term_t input, term_t list, term_t tail, int chars ARG_LD)
 	} while(0)
 
   if ( getInputStream(input, S_DONTCARE, &s) )
-  { char buf[MAX_PENDING];
+  { char fast[MAX_PENDING];
+    char *buf = fast;
+    size_t bufsize = sizeof(fast);
+    size_t pending = s->limitp - s->bufp;
     ssize_t n;
     int64_t off0 = Stell64(s);
     IOPOS pos0;
@@ -2687,7 +3190,15 @@ read_pending_input(term_t input, term_t list, term_t tail, int chars ARG_LD)
     if ( Sferror(s) )
       return streamStatus(s);
 
-    n = Sread_pending(s, buf, sizeof(buf), SIO_RP_NOPOS);
+    if ( pending > bufsize )		/* enlarged buffer */
+    { if ( !(buf = malloc(pending)) )
+      { releaseStream(s);
+	return PL_no_memory();
+      }
+      bufsize = pending;
+    }
+
+    n = Sread_pending(s, buf, bufsize, SIO_RP_NOPOS);
     if ( n < 0 )			/* should not happen */
       return streamStatus(s);
     if ( n == 0 )			/* end-of-file */
@@ -2707,7 +3218,7 @@ read_pending_input(term_t input, term_t list, term_t tail, int chars ARG_LD)
       { ssize_t i;
 
 	if ( !allocList(n, &ctx) )
-	  return FALSE;
+	  goto failure;
 
 	for(i=0; i<n; i++)
 	{ int c = buf[i]&0xff;
@@ -2749,7 +3260,7 @@ read_pending_input(term_t input, term_t list, term_t tail, int chars ARG_LD)
 			  count, n, es-us));
 
 	if ( !allocList(count, &ctx) )
-	  return FALSE;
+	  goto failure;
 
 	for(us=buf,i=0; i<count; i++)
 	{ wchar_t c;
@@ -2799,7 +3310,7 @@ read_pending_input(term_t input, term_t list, term_t tail, int chars ARG_LD)
 			  count, n, es-us));
 
 	if ( !allocList(count, &ctx) )
-	  return FALSE;
+	  goto failure;
 
 	for(us=buf,i=0; i<count; i++)
 	{ int c;
@@ -2825,7 +3336,7 @@ read_pending_input(term_t input, term_t list, term_t tail, int chars ARG_LD)
 	size_t done, i;
 
 	if ( !allocList(count, &ctx) )
-	  return FALSE;
+	  goto failure;
 
 	for(i=0; i<count; us+=2, i++)
 	{ int c;
@@ -2855,7 +3366,7 @@ read_pending_input(term_t input, term_t list, term_t tail, int chars ARG_LD)
 	size_t done, i;
 
 	if ( !allocList(count, &ctx) )
-	  return FALSE;
+	  goto failure;
 
 	for(i=0; i<count; i++)
 	{ int c = ws[i];
@@ -2883,10 +3394,14 @@ read_pending_input(term_t input, term_t list, term_t tail, int chars ARG_LD)
     if ( !unifyDiffList(list, tail, &ctx) )
       goto failure;
 
+    if ( buf != fast )
+      free(buf);
     releaseStream(s);
     return TRUE;
 
   failure:
+    if ( buf != fast )
+      free(buf);
     Sseek64(s, off0, SIO_SEEK_SET);	/* TBD: error? */
     if ( s->position )
       *s->position = pos0;
@@ -3660,6 +4175,9 @@ static const opt_spec open4_options[] =
   { ATOM_encoding,	 OPT_ATOM },
   { ATOM_bom,		 OPT_BOOL },
   { ATOM_create,	 OPT_TERM },
+  { ATOM_mmap,		 OPT_BOOL },
+  { ATOM_owner,		 OPT_BOOL },
+  { ATOM_read_ahead,	 OPT_SIZE },
 #ifdef O_LOCALE
   { ATOM_locale,	 OPT_LOCALE },
 #endif
@@ -3726,6 +4244,9 @@ openStream(term_t file, term_t mode, term_t options)
   int    close_on_abort = TRUE;
   int	 bom		= -1;
   term_t create		= 0;
+  int	 map		= FALSE;
+  int	 owner		= FALSE;
+  size_t read_ahead	= 0;
   char   how[16];
   char  *h		= how;
   char *path;
@@ -3736,7 +4257,7 @@ openStream(term_t file, term_t mode, term_t options)
   { if ( !scan_options(options, 0, ATOM_stream_option, open4_options,
 		       &type, &reposition, &alias, &eof_action,
 		       &close_on_abort, &buffer, &lock, &wait,
-		       &encoding, &bom, &create
+		       &encoding, &bom, &create, &map, &owner, &read_ahead
 #ifdef O_LOCALE
 		       , &locale
 #endif
@@ -3803,6 +4324,8 @@ openStream(term_t file, term_t mode, term_t options)
     bom = (mname == ATOM_read ? TRUE : FALSE);
   if ( type == ATOM_binary )
     *h++ = 'b';
+  if ( map && mname == ATOM_read )
+    *h++ = 'M';
 
 					/* File locking */
   if ( lock != ATOM_none )
@@ -3894,6 +4417,11 @@ openStream(term_t file, term_t mode, term_t options)
     { Sclose(s);
       return NULL;
     }
+    if ( read_ahead && Sset_read_ahead(s, read_ahead) < 0 )
+    { Sclose(s);
+      PL_no_memory();
+      return NULL;
+    }
   } else
   { if ( buffer != ATOM_full &&
 	 !set_buffering(s, buffer) )
@@ -3909,6 +4437,12 @@ openStream(term_t file, term_t mode, term_t options)
   }
   if ( !reposition )
     s->position = NULL;
+#ifdef O_PLMT
+  if ( owner && s->mutex && !LD->thread.info->is_engine )
+  { getStreamContext(s);		/* for releaseOwnedStreams() */
+    s->owner = PL_thread_self();
+  }
+#endif
 
   if ( bom )
   { if ( mname == ATOM_read )
@@ -4982,6 +5516,38 @@ PRED_IMPL("flush_output", 1, flush_output1, PL_FA_ISO)
 }
 
 
+/** '$sync_output'(+Stream)
+ *
+ * Flush Stream and ask the OS to commit the data to disk.  The stream
+ * lock is released before calling fsync(), such that other threads can
+ * append while we wait for the disk.  This allows for group commit, as
+ * used by library(persistency).
+ */
+
+static
+PRED_IMPL("$sync_output", 1, sync_output, 0)
+{ PRED_LD
+  IOSTREAM *s;
+  int fd;
+
+  if ( !getOutputStream(A1, S_DONTCARE, &s) )
+    return FALSE;
+  Sflush(s);
+  fd = Sfileno(s);
+  if ( !streamStatus(s) )
+    return FALSE;
+
+#ifdef HAVE_FSYNC
+  if ( fd >= 0 && fsync(fd) != 0 )
+    return PL_error(NULL, 0, MSG_ERRNO, ERR_SYSCALL, "fsync");
+#else
+  (void)fd;
+#endif
+
+  return TRUE;
+}
+
+
 static int
 getStreamWithPosition(term_t stream, IOSTREAM **sp)
 { IOSTREAM *s;
@@ -5599,7 +6165,8 @@ PRED_IMPL("$size_stream", 2, size_stream, 0)
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 copy_stream_data(+StreamIn, +StreamOut, [Len])
 	Copy all data from StreamIn to StreamOut.  Should be somewhere else,
-	and maybe we need something else to copy resources.
+	and maybe we need something else to copy resources.  Binary file
+	streams are copied in the kernel if possible (see Ssendfile()).
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static int
@@ -5607,6 +6174,14 @@ copy_stream_data(term_t in, term_t out, term_t len ARG_LD)
 { IOSTREAM *i, *o;
   int c;
   int count = 0;
+  int64_t n = -1, copied;
+
+  if ( len )
+  { if ( !PL_get_int64_ex(len, &n) )
+      return FALSE;
+    if ( n < 0 )
+      n = 0;
+  }
 
   if ( !getInputStream(in, S_DONTCARE, &i) )
     return FALSE;
@@ -5615,6 +6190,20 @@ copy_stream_data(term_t in, term_t out, term_t len ARG_LD)
     return FALSE;
   }
 
+  if ( n != 0 )
+  { switch( Ssendfile(i, o, n, &copied) )
+    { case 1:
+	releaseStream(o);
+	return streamStatus(i);
+      case -1:
+	releaseStream(i);
+	return streamStatus(o);
+      default:
+	if ( n > 0 )
+	  n -= copied;
+    }
+  }
+
   if ( !len )
   { while ( (c = Sgetcode(i)) != EOF )
     { if ( (++count % 4096) == 0 && PL_handle_signals() < 0 )
@@ -5628,12 +6217,7 @@ copy_stream_data(term_t in, term_t out, term_t len ARG_LD)
       }
     }
   } else
-  { int64_t n;
-
-    if ( !PL_get_int64_ex(len, &n) )
-      return FALSE;
-
-    while ( n-- > 0 && (c = Sgetcode(i)) != EOF )
+  { while ( n-- > 0 && (c = Sgetcode(i)) != EOF )
     { if ( (++count % 4096) == 0 && PL_handle_signals() < 0 )
       { releaseStream(i);
 	releaseStream(o);
@@ -5698,6 +6282,7 @@ BeginPredDefs(file)
   PRED_DEF("put_char", 1, put_code1, PL_FA_ISO)
   PRED_DEF("flush_output", 0, flush_output, PL_FA_ISO)
   PRED_DEF("flush_output", 1, flush_output1, PL_FA_ISO)
+  PRED_DEF("$sync_output", 1, sync_output, 0)
   PRED_DEF("at_end_of_stream", 1, at_end_of_stream, PL_FA_ISO)
   PRED_DEF("at_end_of_stream", 0, at_end_of_stream0, PL_FA_ISO)
   PRED_DEF("fill_buffer", 1, fill_buffer, 0)
@@ -5747,6 +6332,13 @@ BeginPredDefs(file)
   PRED_DEF("seek", 4, seek, 0)
 #ifdef HAVE_PRED_WAIT_FOR_INPUT
   PRED_DEF("wait_for_input", 3, wait_for_input, 0)
+#endif
+#ifdef HAVE_PRED_WAIT_SET
+  PRED_DEF("wait_set_create", 1, wait_set_create, 0)
+  PRED_DEF("wait_set_destroy", 1, wait_set_destroy, 0)
+  PRED_DEF("wait_set_add", 2, wait_set_add, 0)
+  PRED_DEF("wait_set_remove", 2, wait_set_remove, 0)
+  PRED_DEF("wait_set_wait", 3, wait_set_wait, 0)
 #endif
   PRED_DEF("get_single_char", 1, get_single_char, 0)
   PRED_DEF("read_pending_codes", 3, read_pending_codes, 0)
@@ -53,6 +53,8 @@ typedef enum iri_op
 COMMON(void)		initIO(void);
 COMMON(void)		dieIO(void);
 COMMON(void)		closeFiles(int all);
+COMMON(void)		revokeStreamOwner(int tid);
+COMMON(void)		releaseOwnedStreams(int force);
 COMMON(int)		openFileDescriptors(unsigned char *buf, int size);
 COMMON(void)		protocol(const char *s, size_t n);
 COMMON(int)		getTextInputStream__LD(term_t t, IOSTREAM **s ARG_LD);
@@ -67,6 +67,31 @@ typedef struct
   struct rubber rub[MAXRUBBER];
 } format_state;
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A format is first compiled into an  array   of  fmt_op  structures. Each
+fmt_op represents a run of literal text followed  by a directive and its
+parsed numeric argument and colon modifier. The last op has c==FMT_END.
+The literal text is not copied: start  and   length  refer to the format
+text.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define FMT_END		(-1)		/* fmt_op.c: end of the format */
+#define FMT_STAR	(-2)		/* fmt_op.arg: argument is `*' */
+
+typedef struct fmt_op
+{ size_t	start;			/* start of literal text */
+  size_t	length;			/* length of literal text */
+  int		arg;			/* numeric argument */
+  int		c;			/* directive character */
+  int		colon;			/* ~:c */
+} fmt_op;
+
+typedef struct compiled_format
+{ atom_t	format;			/* the format atom */
+  size_t	count;			/* # ops */
+  fmt_op	ops[1];			/* the operations */
+} compiled_format;
+
 #define BUFSIZE		1024
 #define DEFAULT		(-1)
 #define SHIFT		{ argc--; argv++; }
@@ -158,6 +183,45 @@ outstring(format_state *state, const char *s, size_t len)
 }
 
 
+static inline int
+get_chr_from_text(const PL_chars_t *t, int index)
+{ switch(t->encoding)
+  { case ENC_ISO_LATIN_1:
+      return t->text.t[index]&0xff;
+    case ENC_WCHAR:
+      return t->text.w[index];
+    default:
+      assert(0);
+      return 0;				/* not reached */
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Emit literal text from the format.  If  nothing  is buffered, runs of
+printable ASCII are copied directly into the stream buffer.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static WUNUSED int
+outliteral(format_state *state, const PL_chars_t *fmt,
+	   size_t start, size_t len)
+{ if ( fmt->encoding == ENC_ISO_LATIN_1 && !state->pending_rubber )
+  { size_t done = Swrite_ascii(state->out, fmt->text.t+start, len);
+
+    state->column += (int)done;
+    start += done;
+    len   -= done;
+  }
+
+  for(; len > 0; start++, len--)
+  { if ( !outchr(state, get_chr_from_text(fmt, (int)start)) )
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+
 static WUNUSED int
 oututf8(format_state *state, const char *s, size_t len)
 { const char *e = &s[len];
@@ -207,8 +271,10 @@ outtext(format_state *state, PL_chars_t *txt)
 #define format_predicates (GD->format.predicates)
 
 static int	update_column(int, Char);
-static bool	do_format(IOSTREAM *fd, PL_chars_t *fmt,
+static bool	do_format(IOSTREAM *fd, PL_chars_t *fmt, const fmt_op *ops,
 			  int ac, term_t av, Module m);
+static const fmt_op *format_ops(term_t format, const PL_chars_t *fmt,
+				Buffer ops ARG_LD);
 static void	distribute_rubber(struct rubber *, int, int);
 static int	emit_rubber(format_state *state);
 
@@ -322,9 +388,18 @@ format_impl(IOSTREAM *out, term_t format, term_t Args, Module m)
       break;
   }
 
-  Slock(out);
-  rval = do_format(out, &fmt, argc, argv, m);
-  Sunlock(out);
+  { tmp_buffer b;
+    const fmt_op *ops;
+
+    initBuffer(&b);
+    if ( (ops=format_ops(format, &fmt, (Buffer)&b PASS_LD)) )
+    { Slock(out);
+      rval = do_format(out, &fmt, ops, argc, argv, m);
+      Sunlock(out);
+    } else
+      rval = FALSE;
+    discardBuffer(&b);
+  }
   PL_free_text(&fmt);
 
   return rval;
@@ -359,17 +434,141 @@ pl_format(term_t fmt, term_t args)
 }
 
 
+		/********************************
+		*       COMPILED FORMATS	*
+		********************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+compile_format() translates the format into an array of fmt_op. Format
+atoms are compiled only once: the result  is kept in GD->format.compiled
+and the atom is locked such that its text remains valid. Entries are
+never removed, so another thread may use  them without locking.  As the
+number of distinct format atoms is normally small, we simply stop adding
+entries after MAX_COMPILED_FORMATS.   User  defined directives (see
+format_predicate/2) are resolved when the directive is executed and thus
+do not invalidate compiled formats.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define MAX_COMPILED_FORMATS 1024
+#define compiled_formats (GD->format.compiled)
+
 static inline int
-get_chr_from_text(const PL_chars_t *t, int index)
-{ switch(t->encoding)
-  { case ENC_ISO_LATIN_1:
-      return t->text.t[index]&0xff;
-    case ENC_WCHAR:
-      return t->text.w[index];
-    default:
-      assert(0);
-      return 0;				/* not reached */
+fmt_chr(const PL_chars_t *fmt, size_t index)
+{ return index < fmt->length ? get_chr_from_text(fmt, (int)index) : EOS;
+}
+
+
+static int
+compile_format(const PL_chars_t *fmt, Buffer ops)
+{ size_t here = 0;
+  size_t start = 0;
+  fmt_op op;
+
+  while(here < fmt->length)
+  { int c = get_chr_from_text(fmt, (int)here);
+
+    if ( c == '~' )
+    { op.start  = start;
+      op.length = here-start;
+      op.arg    = DEFAULT;
+      op.colon  = FALSE;
+					/* Get the numeric argument */
+      c = fmt_chr(fmt, ++here);
+
+      if ( isDigitW(c) )
+      { op.arg = c - '0';
+
+	here++;
+	while(here < fmt->length)
+	{ c = get_chr_from_text(fmt, (int)here);
+
+	  if ( isDigitW(c) )
+	  { int dw = c - '0';
+	    int arg2 = op.arg*10 + dw;
+
+	    if ( (arg2 - dw)/10 != op.arg )	/* see mul64() in pl-arith.c */
+	    { FMT_ERROR("argument overflow");
+	    }
+	    op.arg = arg2;
+	    here++;
+	  } else
+	    break;
+	}
+      } else if ( c == '*' )
+      { op.arg = FMT_STAR;
+	c = fmt_chr(fmt, ++here);
+      } else if ( c == '`' && here < fmt->length )
+      { op.arg = fmt_chr(fmt, ++here);
+	c = fmt_chr(fmt, ++here);
+      }
+
+      if ( c == ':' )
+      { op.colon = TRUE;
+	c = fmt_chr(fmt, ++here);
+      }
+
+      op.c = c;
+      addBuffer(ops, op, fmt_op);
+      start = ++here;
+    } else
+    { here++;
+    }
   }
+
+  if ( start > fmt->length )
+    start = fmt->length;
+  op.start  = start;
+  op.length = fmt->length-start;
+  op.arg    = DEFAULT;
+  op.colon  = FALSE;
+  op.c      = FMT_END;
+  addBuffer(ops, op, fmt_op);
+
+  return TRUE;
+}
+
+
+static const fmt_op *
+format_ops(term_t format, const PL_chars_t *fmt, Buffer ops ARG_LD)
+{ atom_t a = 0;
+  compiled_format *cf;
+  size_t count;
+
+  if ( PL_get_atom(format, &a) && compiled_formats &&
+       (cf = lookupHTable(compiled_formats, (void*)a)) )
+    return cf->ops;
+
+  if ( !compile_format(fmt, ops) )
+    return NULL;
+  if ( !a || (compiled_formats &&
+	      compiled_formats->size >= MAX_COMPILED_FORMATS) )
+    return baseBuffer(ops, fmt_op);
+
+  if ( !compiled_formats )
+  { Table t = newHTable(64);
+
+    if ( !COMPARE_AND_SWAP_PTR(&compiled_formats, NULL, t) )
+      destroyHTable(t);
+  }
+
+  count = entriesBuffer(ops, fmt_op);
+  if ( !(cf = malloc(sizeof(*cf) + (count-1)*sizeof(fmt_op))) )
+    return baseBuffer(ops, fmt_op);
+  cf->format = a;
+  cf->count  = count;
+  memcpy(cf->ops, baseBuffer(ops, fmt_op), count*sizeof(fmt_op));
+
+  PL_register_atom(a);
+  { compiled_format *old = addHTable(compiled_formats, (void*)a, cf);
+
+    if ( old != cf )			/* lost a race */
+    { PL_unregister_atom(a);
+      free(cf);
+      cf = old;
+    }
+  }
+
+  return cf->ops;
 }
 
 
@@ -378,11 +577,12 @@ get_chr_from_text(const PL_chars_t *t, int index)
 		********************************/
 
 static bool
-do_format(IOSTREAM *fd, PL_chars_t *fmt, int argc, term_t argv, Module m)
+do_format(IOSTREAM *fd, PL_chars_t *fmt, const fmt_op *ops,
+	  int argc, term_t argv, Module m)
 { GET_LD
   format_state state;			/* complete state */
   int tab_stop = 0;			/* padded tab stop */
-  unsigned int here = 0;
+  const fmt_op *op;
   int rc = TRUE;
 
   state.out = fd;
@@ -395,468 +595,415 @@ do_format(IOSTREAM *fd, PL_chars_t *fmt, int argc, term_t argv, Module m)
   else
     state.column = 0;
 
-  while(here < fmt->length)
-  { int c = get_chr_from_text(fmt, here);
+  for(op=ops; ; op++)
+  { int c = op->c;
+    int arg = op->arg;			/* Numeric argument */
+    int mod_colon = op->colon;		/* Used colon modifier */
+    predicate_t proc;
 
-    switch(c)
-    { case '~':
-	{ int arg = DEFAULT;		/* Numeric argument */
-	  int mod_colon = FALSE;	/* Used colon modifier */
-	  predicate_t proc;
-					/* Get the numeric argument */
-	  c = get_chr_from_text(fmt, ++here);
+    if ( op->length > 0 &&
+	 !(rc=outliteral(&state, fmt, op->start, op->length)) )
+      goto out;
+    if ( c == FMT_END )
+      break;
 
-	  if ( isDigitW(c) )
-	  { arg = c - '0';
+    if ( arg == FMT_STAR )
+    { NEED_ARG;
+      if ( PL_get_integer(argv, &arg) )
+      { SHIFT;
+      } else
+	FMT_ERROR("no or negative integer for `*' argument");
+    }
+					/* Check for user defined format */
+    if ( format_predicates &&
+	 (proc = lookupHTable(format_predicates, (void*)((intptr_t)c))) )
+    { size_t arity;
+      term_t av;
+      char buf[BUFSIZE];
+      char *str = buf;
+      size_t bufsize = BUFSIZE;
+      int i;
+
+      PL_predicate_info(proc, NULL, &arity, NULL);
+      av = PL_new_term_refs((int)arity);
+
+      if ( arg == DEFAULT )
+	PL_put_atom(av+0, ATOM_default);
+      else
+	PL_put_integer(av+0, arg);
 
-	    here++;
-	    while(here < fmt->length)
-	    { c = get_chr_from_text(fmt, here);
-
-	      if ( isDigitW(c) )
-	      { int dw = c - '0';
-		int arg2 = arg*10 + dw;
-
-		if ( (arg2 - dw)/10 != arg )	/* see mul64() in pl-arith.c */
-		{ FMT_ERROR("argument overflow");
-		}
-		arg = arg2;
-		here++;
-	      } else
-		break;
-	    }
-	  } else if ( c == '*' )
-	  { NEED_ARG;
-	    if ( PL_get_integer(argv, &arg) )
-	    { SHIFT;
+      for(i=1; i < arity; i++)
+      { NEED_ARG;
+	PL_put_term(av+i, argv);
+	SHIFT;
+      }
+
+      tellString(&str, &bufsize, ENC_UTF8);
+      rc = PL_call_predicate(NULL, PL_Q_PASS_EXCEPTION, proc, av);
+      toldString();
+      if ( rc )
+	rc = oututf8(&state, str, bufsize);
+      if ( str != buf )
+	free(str);
+      if ( !rc )
+	goto out;
+    } else
+    { switch(c)			/* Build in formatting */
+      { case 'a':			/* atomic */
+	  { PL_chars_t txt;
+
+	    NEED_ARG;
+	    if ( !PL_get_text(argv, &txt, CVT_ATOMIC) )
+	      FMT_ARG("a", argv);
+	    SHIFT;
+	    rc = outtext(&state, &txt);
+	    if ( !rc )
+	      goto out;
+	    break;
+	  }
+	case 'c':			/* ~c: character code */
+	  { int chr;
+
+	    NEED_ARG;
+	    if ( PL_get_integer(argv, &chr) && chr >= 0 )
+	    { int times = (arg == DEFAULT ? 1 : arg);
+
+	      SHIFT;
+	      while(times-- > 0)
+	      { rc = outchr(&state, chr);
+		if ( !rc )
+		  goto out;
+	      }
 	    } else
-	      FMT_ERROR("no or negative integer for `*' argument");
-	    c = get_chr_from_text(fmt, ++here);
-	  } else if ( c == '`' && here < fmt->length )
-	  { arg = get_chr_from_text(fmt, ++here);
-	    c = get_chr_from_text(fmt, ++here);
+	      FMT_ARG("c", argv);
+	    break;
 	  }
+	case 'e':			/* exponential float */
+	case 'E':			/* Exponential float */
+	case 'f':			/* float */
+	case 'g':			/* shortest of 'f' and 'e' */
+	case 'G':			/* shortest of 'f' and 'E' */
+	  { number n;
+	    union {
+	    tmp_buffer b;
+	      buffer b1;
+	    } u;
+	    PL_locale *l;
+
+	    NEED_ARG;
+	    if ( !valueExpression(argv, &n PASS_LD) )
+	    { char f[2];
+
+	      f[0] = c;
+	      f[1] = EOS;
+	      FMT_ARG(f, argv);
+	    }
+	    SHIFT;
+
+	    if ( c == 'f' && mod_colon )
+	      l = fd->locale;
+	    else
+	      l = &prolog_locale;
 
-	  if ( c == ':' )
-	  { mod_colon = TRUE;
-	    c = get_chr_from_text(fmt, ++here);
+	    initBuffer(&u.b);
+	    rc = formatFloat(l, c, arg, &n, &u.b1) != NULL;
+	    clearNumber(&n);
+	    if ( rc )
+	      rc = oututf80(&state, baseBuffer(&u.b, char));
+	    discardBuffer(&u.b);
+	    if ( !rc )
+	      goto out;
+	    break;
 	  }
+	case 'd':			/* integer */
+	case 'D':			/* grouped integer */
+	case 'r':			/* radix number */
+	case 'R':			/* Radix number */
+	case 'I':			/* Prolog 1_000_000 */
+	  { number i;
+	    tmp_buffer b;
+
+	    NEED_ARG;
+	    if ( !valueExpression(argv, &i PASS_LD) ||
+		 !toIntegerNumber(&i, 0) )
+	    { char f[2];
+
+	      f[0] = c;
+	      f[1] = EOS;
+	      FMT_ARG(f, argv);
+	    }
+	    SHIFT;
+	    initBuffer(&b);
+	    if ( c == 'd' || c == 'D' )
+	    { PL_locale ltmp;
+	      PL_locale *l;
+	      static char grouping[] = {3,0};
+
+	      if ( c == 'D' )
+	      { ltmp.thousands_sep = L",";
+		ltmp.decimal_point = L".";
+		ltmp.grouping = grouping;
+		l = &ltmp;
+	      } else if ( mod_colon )
+	      { l = fd->locale;
+	      } else
+	      { l = NULL;
+	      }
 
-					/* Check for user defined format */
-	  if ( format_predicates &&
-	       (proc = lookupHTable(format_predicates, (void*)((intptr_t)c))) )
-	  { size_t arity;
-	    term_t av;
+	      if ( arg == DEFAULT )
+		arg = 0;
+	      if ( !formatInteger(l, arg, 10, TRUE, &i, (Buffer)&b) )
+		FMT_EXEPTION();
+	    } else if ( c == 'I' )
+	    { PL_locale ltmp;
+	      char grouping[2];
+
+	      grouping[0] = (arg == DEFAULT ? 3 : arg);
+	      grouping[1] = '\0';
+	      ltmp.thousands_sep = L"_";
+	      ltmp.grouping = grouping;
+
+	      if ( !formatInteger(&ltmp, 0, 10, TRUE, &i, (Buffer)&b) )
+		FMT_EXEPTION();
+	    } else			/* r,R */
+	    { if ( arg == DEFAULT )
+		FMT_ERROR("r,R requires radix specifier");
+	      if ( arg < 1 || arg > 36 )
+	      { term_t r = PL_new_term_ref();
+
+		PL_put_integer(r, arg);
+		return PL_error(NULL, 0, NULL, ERR_DOMAIN,
+				ATOM_radix, r);
+	      }
+	      if ( !formatInteger(NULL, 0, arg, c == 'r', &i, (Buffer)&b) )
+		FMT_EXEPTION();
+	    }
+	    clearNumber(&i);
+	    rc = oututf80(&state, baseBuffer(&b, char));
+	    discardBuffer(&b);
+	    if ( !rc )
+	      goto out;
+	    break;
+	  }
+	case 's':			/* string */
+	  { PL_chars_t txt;
+
+	    NEED_ARG;
+	    if ( !PL_get_text(argv, &txt, CVT_LIST|CVT_STRING) &&
+		 !PL_get_text(argv, &txt, CVT_ATOM) ) /* SICStus compat */
+	      FMT_ARG("s", argv);
+	    rc = outtext(&state, &txt);
+	    SHIFT;
+	    if ( !rc )
+	      goto out;
+	    break;
+	  }
+	case 'i':			/* ignore */
+	  { NEED_ARG;
+	    SHIFT;
+	    break;
+	  }
+	  { Func f;
 	    char buf[BUFSIZE];
-	    char *str = buf;
-	    size_t bufsize = BUFSIZE;
-	    int i;
+	    char *str;
+
+	case 'k':			/* write_canonical */
+	    f = pl_write_canonical;
+	    goto pl_common;
+	case 'p':			/* print */
+	    f = pl_print;
+	    goto pl_common;
+	case 'q':			/* writeq */
+	    f = pl_writeq;
+	    goto pl_common;
+	case 'w':			/* write */
+	    f = pl_write;
+	    pl_common:
+
+	    NEED_ARG;
+	    if ( state.pending_rubber )
+	    { size_t bufsize = BUFSIZE;
+
+	      str = buf;
+	      tellString(&str, &bufsize, ENC_UTF8);
+	      rc = (*f)(argv);
+	      toldString();
+	      if ( rc )
+		rc = oututf8(&state, str, bufsize);
+	      if ( str != buf )
+		free(str);
+	      if ( !rc )
+		goto out;
+	    } else
+	    { if ( fd->position &&
+		   fd->position->linepos == state.column )
+	      { IOSTREAM *old = Scurout;
 
-	    PL_predicate_info(proc, NULL, &arity, NULL);
-	    av = PL_new_term_refs((int)arity);
+		Scurout = fd;
+		rc = (int)(*f)(argv);
+		Scurout = old;
+		if ( !rc )
+		  goto out;
 
-	    if ( arg == DEFAULT )
-	      PL_put_atom(av+0, ATOM_default);
-	    else
-	      PL_put_integer(av+0, arg);
+		state.column = fd->position->linepos;
+	      } else
+	      { size_t bufsize = BUFSIZE;
+
+		str = buf;
+		tellString(&str, &bufsize, ENC_UTF8);
+		rc = (*f)(argv);
+		toldString();
+		if ( rc )
+		  rc = oututf8(&state, str, bufsize);
+		if ( str != buf )
+		  free(str);
+		if ( !rc )
+		  goto out;
+	      }
+	    }
+	    SHIFT;
+	    break;
+	  }
+	case 'W':			/* write_term(Value, Options) */
+	 { char buf[BUFSIZE];
+	   char *str;
+
+	   if ( argc < 2 )
+	   { FMT_ERROR("not enough arguments");
+	   }
+	   if ( state.pending_rubber )
+	    { size_t bufsize = BUFSIZE;
+
+	      str = buf;
+	      tellString(&str, &bufsize, ENC_UTF8);
+	      rc = (int)pl_write_term(argv, argv+1);
+	      toldString();
+	      if ( rc )
+		rc = oututf8(&state, str, bufsize);
+	      if ( str != buf )
+		free(str);
+	      if ( !rc )
+		goto out;
+	    } else
+	    { if ( fd->position &&
+		   fd->position->linepos == state.column )
+	      { IOSTREAM *old = Scurout;
 
-	    for(i=1; i < arity; i++)
-	    { NEED_ARG;
-	      PL_put_term(av+i, argv);
-	      SHIFT;
+		Scurout = fd;
+		rc = (int)pl_write_term(argv, argv+1);
+		Scurout = old;
+		if ( !rc )
+		  goto out;
+
+		state.column = fd->position->linepos;
+	      } else
+	      { size_t bufsize = BUFSIZE;
+
+		str = buf;
+		tellString(&str, &bufsize, ENC_UTF8);
+		rc = (int)pl_write_term(argv, argv+1);
+		toldString();
+		if ( rc )
+		  rc = oututf8(&state, str, bufsize);
+		if ( str != buf )
+		  free(str);
+		if ( !rc )
+		  goto out;
+	      }
 	    }
+	    SHIFT;
+	    SHIFT;
+	    break;
+	 }
+	case '@':
+	  { char buf[BUFSIZE];
+	    char *str = buf;
+	    size_t bufsize = BUFSIZE;
+	    term_t ex = 0;
 
+	    if ( argc < 1 )
+	    { FMT_ERROR("not enough arguments");
+	    }
 	    tellString(&str, &bufsize, ENC_UTF8);
-	    rc = PL_call_predicate(NULL, PL_Q_PASS_EXCEPTION, proc, av);
+	    rc = callProlog(m, argv, PL_Q_CATCH_EXCEPTION, &ex);
 	    toldString();
 	    if ( rc )
 	      rc = oututf8(&state, str, bufsize);
 	    if ( str != buf )
 	      free(str);
+
 	    if ( !rc )
+	    { if ( ex )
+		rc = PL_raise_exception(ex);
 	      goto out;
+	    }
 
-	    here++;
-	  } else
-	  { switch(c)			/* Build in formatting */
-	    { case 'a':			/* atomic */
-		{ PL_chars_t txt;
-
-		  NEED_ARG;
-		  if ( !PL_get_text(argv, &txt, CVT_ATOMIC) )
-		    FMT_ARG("a", argv);
-		  SHIFT;
-		  rc = outtext(&state, &txt);
-                  if ( !rc )
-		    goto out;
-		  here++;
-		  break;
-		}
-	      case 'c':			/* ~c: character code */
-		{ int chr;
-
-		  NEED_ARG;
-		  if ( PL_get_integer(argv, &chr) && chr >= 0 )
-		  { int times = (arg == DEFAULT ? 1 : arg);
-
-		    SHIFT;
-		    while(times-- > 0)
-		    { rc = outchr(&state, chr);
-		      if ( !rc )
-		        goto out;
-		    }
-		  } else
-		    FMT_ARG("c", argv);
-		  here++;
-		  break;
-		}
-	      case 'e':			/* exponential float */
-	      case 'E':			/* Exponential float */
-	      case 'f':			/* float */
-	      case 'g':			/* shortest of 'f' and 'e' */
-	      case 'G':			/* shortest of 'f' and 'E' */
-		{ number n;
-		  union {
-		  tmp_buffer b;
-		    buffer b1;
-		  } u;
-		  PL_locale *l;
-
-		  NEED_ARG;
-		  if ( !valueExpression(argv, &n PASS_LD) )
-		  { char f[2];
-
-		    f[0] = c;
-		    f[1] = EOS;
-		    FMT_ARG(f, argv);
-		  }
-		  SHIFT;
-
-		  if ( c == 'f' && mod_colon )
-		    l = fd->locale;
-		  else
-		    l = &prolog_locale;
-
-		  initBuffer(&u.b);
-		  rc = formatFloat(l, c, arg, &n, &u.b1) != NULL;
-		  clearNumber(&n);
-		  if ( rc )
-		    rc = oututf80(&state, baseBuffer(&u.b, char));
-		  discardBuffer(&u.b);
-                  if ( !rc )
-		    goto out;
-		  here++;
-		  break;
-		}
-	      case 'd':			/* integer */
-	      case 'D':			/* grouped integer */
-	      case 'r':			/* radix number */
-	      case 'R':			/* Radix number */
-	      case 'I':			/* Prolog 1_000_000 */
-		{ number i;
-		  tmp_buffer b;
-
-		  NEED_ARG;
-		  if ( !valueExpression(argv, &i PASS_LD) ||
-		       !toIntegerNumber(&i, 0) )
-		  { char f[2];
-
-		    f[0] = c;
-		    f[1] = EOS;
-		    FMT_ARG(f, argv);
-		  }
-		  SHIFT;
-		  initBuffer(&b);
-		  if ( c == 'd' || c == 'D' )
-		  { PL_locale ltmp;
-		    PL_locale *l;
-		    static char grouping[] = {3,0};
-
-		    if ( c == 'D' )
-		    { ltmp.thousands_sep = L",";
-		      ltmp.decimal_point = L".";
-		      ltmp.grouping = grouping;
-		      l = &ltmp;
-		    } else if ( mod_colon )
-		    { l = fd->locale;
-		    } else
-		    { l = NULL;
-		    }
-
-		    if ( arg == DEFAULT )
-		      arg = 0;
-		    if ( !formatInteger(l, arg, 10, TRUE, &i, (Buffer)&b) )
-		      FMT_EXEPTION();
-		  } else if ( c == 'I' )
-		  { PL_locale ltmp;
-		    char grouping[2];
-
-		    grouping[0] = (arg == DEFAULT ? 3 : arg);
-		    grouping[1] = '\0';
-		    ltmp.thousands_sep = L"_";
-		    ltmp.grouping = grouping;
-
-		    if ( !formatInteger(&ltmp, 0, 10, TRUE, &i, (Buffer)&b) )
-		      FMT_EXEPTION();
-		  } else			/* r,R */
-		  { if ( arg == DEFAULT )
-		      FMT_ERROR("r,R requires radix specifier");
-		    if ( arg < 1 || arg > 36 )
-		    { term_t r = PL_new_term_ref();
-
-		      PL_put_integer(r, arg);
-		      return PL_error(NULL, 0, NULL, ERR_DOMAIN,
-				      ATOM_radix, r);
-		    }
-		    if ( !formatInteger(NULL, 0, arg, c == 'r', &i, (Buffer)&b) )
-		      FMT_EXEPTION();
-		  }
-		  clearNumber(&i);
-		  rc = oututf80(&state, baseBuffer(&b, char));
-		  discardBuffer(&b);
-		  if ( !rc )
-		    goto out;
-		  here++;
-		  break;
-		}
-	      case 's':			/* string */
-		{ PL_chars_t txt;
-
-		  NEED_ARG;
-		  if ( !PL_get_text(argv, &txt, CVT_LIST|CVT_STRING) &&
-		       !PL_get_text(argv, &txt, CVT_ATOM) ) /* SICStus compat */
-		    FMT_ARG("s", argv);
-		  rc = outtext(&state, &txt);
-		  SHIFT;
-		  if ( !rc )
-		    goto out;
-		  here++;
-		  break;
-		}
-	      case 'i':			/* ignore */
-		{ NEED_ARG;
-		  SHIFT;
-		  here++;
-		  break;
-		}
-		{ Func f;
-		  char buf[BUFSIZE];
-		  char *str;
-
-	      case 'k':			/* write_canonical */
-		  f = pl_write_canonical;
-	          goto pl_common;
-	      case 'p':			/* print */
-		  f = pl_print;
-	          goto pl_common;
-	      case 'q':			/* writeq */
-		  f = pl_writeq;
-	          goto pl_common;
-	      case 'w':			/* write */
-		  f = pl_write;
-		  pl_common:
-
-		  NEED_ARG;
-		  if ( state.pending_rubber )
-		  { size_t bufsize = BUFSIZE;
-
-		    str = buf;
-		    tellString(&str, &bufsize, ENC_UTF8);
-		    rc = (*f)(argv);
-		    toldString();
-		    if ( rc )
-		      rc = oututf8(&state, str, bufsize);
-		    if ( str != buf )
-		      free(str);
-		    if ( !rc )
-		      goto out;
-		  } else
-		  { if ( fd->position &&
-			 fd->position->linepos == state.column )
-		    { IOSTREAM *old = Scurout;
-
-		      Scurout = fd;
-		      rc = (int)(*f)(argv);
-		      Scurout = old;
-		      if ( !rc )
-			goto out;
-
-		      state.column = fd->position->linepos;
-		    } else
-		    { size_t bufsize = BUFSIZE;
-
-		      str = buf;
-		      tellString(&str, &bufsize, ENC_UTF8);
-		      rc = (*f)(argv);
-		      toldString();
-		      if ( rc )
-			rc = oututf8(&state, str, bufsize);
-		      if ( str != buf )
-			free(str);
-		      if ( !rc )
-			goto out;
-		    }
-		  }
-		  SHIFT;
-		  here++;
-		  break;
-		}
-	      case 'W':			/* write_term(Value, Options) */
-	       { char buf[BUFSIZE];
-		 char *str;
-
-		 if ( argc < 2 )
-		 { FMT_ERROR("not enough arguments");
-		 }
-		 if ( state.pending_rubber )
-		  { size_t bufsize = BUFSIZE;
-
-		    str = buf;
-		    tellString(&str, &bufsize, ENC_UTF8);
-		    rc = (int)pl_write_term(argv, argv+1);
-		    toldString();
-		    if ( rc )
-		      rc = oututf8(&state, str, bufsize);
-		    if ( str != buf )
-		      free(str);
-		    if ( !rc )
-		      goto out;
-		  } else
-		  { if ( fd->position &&
-			 fd->position->linepos == state.column )
-		    { IOSTREAM *old = Scurout;
-
-		      Scurout = fd;
-		      rc = (int)pl_write_term(argv, argv+1);
-		      Scurout = old;
-		      if ( !rc )
-			goto out;
-
-		      state.column = fd->position->linepos;
-		    } else
-		    { size_t bufsize = BUFSIZE;
-
-		      str = buf;
-		      tellString(&str, &bufsize, ENC_UTF8);
-		      rc = (int)pl_write_term(argv, argv+1);
-		      toldString();
-		      if ( rc )
-			rc = oututf8(&state, str, bufsize);
-		      if ( str != buf )
-			free(str);
-		      if ( !rc )
-			goto out;
-		    }
-		  }
-		  SHIFT;
-		  SHIFT;
-		  here++;
-		  break;
-	       }
-	      case '@':
-	        { char buf[BUFSIZE];
-		  char *str = buf;
-		  size_t bufsize = BUFSIZE;
-		  term_t ex = 0;
-
-		  if ( argc < 1 )
-		  { FMT_ERROR("not enough arguments");
-		  }
-		  tellString(&str, &bufsize, ENC_UTF8);
-		  rc = callProlog(m, argv, PL_Q_CATCH_EXCEPTION, &ex);
-		  toldString();
-		  if ( rc )
-		    rc = oututf8(&state, str, bufsize);
-		  if ( str != buf )
-		    free(str);
-
-		  if ( !rc )
-		  { if ( ex )
-		      rc = PL_raise_exception(ex);
-		    goto out;
-		  }
-
-		  SHIFT;
-		  here++;
-		  break;
-	        }
-	      case '~':			/* ~ */
-		{ rc = outchr(&state, '~');
-		  if ( !rc )
-		    goto out;
-		  here++;
-		  break;
-		}
-	      case 'n':			/* \n */
-	      case 'N':			/* \n if not on newline */
-		{ if ( arg == DEFAULT )
-		    arg = 1;
-		  if ( c == 'N' && state.column == 0 )
-		    arg--;
-		  while( arg-- > 0 )
-                  { rc = outchr(&state, '\n');
-		    if ( !rc )
-		      goto out;
-                  }
-		  here++;
-		  break;
-		}
-	      case 't':			/* insert tab */
-		{ if ( state.pending_rubber >= MAXRUBBER )
-		    FMT_ERROR("Too many tab stops");
-
-		  state.rub[state.pending_rubber].where = state.buffered;
-		  state.rub[state.pending_rubber].pad   =
-					(arg == DEFAULT ? (pl_wchar_t)' '
-							: (pl_wchar_t)arg);
-		  state.rub[state.pending_rubber].size = 0;
-		  state.pending_rubber++;
-		  here++;
-		  break;
-		}
-	      case '|':			/* set tab */
-		{ int stop;
-
-		  if ( arg == DEFAULT )
-		    arg = state.column;
-	      case '+':			/* tab relative */
-		  if ( arg == DEFAULT )
-		    arg = 8;
-		  stop = (c == '+' ? tab_stop + arg : arg);
-
-		  if ( state.pending_rubber == 0 ) /* nothing to distribute */
-		  { state.rub[0].where = state.buffered;
-		    state.rub[0].pad = ' ';
-		    state.pending_rubber++;
-		  }
-		  distribute_rubber(state.rub,
-				    state.pending_rubber,
-				    stop - state.column);
-		  emit_rubber(&state);
-
-		  state.column = tab_stop = stop;
-		  here++;
-		  break;
-		}
-	      default:
-	      { term_t ex = PL_new_term_ref();
-
-		PL_put_atom(ex, codeToAtom(c));
-		return PL_error("format", 2, NULL, ERR_EXISTENCE,
-				PL_new_atom("format_character"),
-				ex);
-	      }
+	    SHIFT;
+	    break;
+	  }
+	case '~':			/* ~ */
+	  { rc = outchr(&state, '~');
+	    if ( !rc )
+	      goto out;
+	    break;
+	  }
+	case 'n':			/* \n */
+	case 'N':			/* \n if not on newline */
+	  { if ( arg == DEFAULT )
+	      arg = 1;
+	    if ( c == 'N' && state.column == 0 )
+	      arg--;
+	    while( arg-- > 0 )
+	    { rc = outchr(&state, '\n');
+	      if ( !rc )
+		goto out;
 	    }
+	    break;
 	  }
-	  break;			/* the '~' switch */
-	}
-      default:
-	{ rc = outchr(&state, c);
-	  if ( !rc )
-	    goto out;
-	  here++;
-	  break;
+	case 't':			/* insert tab */
+	  { if ( state.pending_rubber >= MAXRUBBER )
+	      FMT_ERROR("Too many tab stops");
+
+	    state.rub[state.pending_rubber].where = state.buffered;
+	    state.rub[state.pending_rubber].pad   =
+				  (arg == DEFAULT ? (pl_wchar_t)' '
+						  : (pl_wchar_t)arg);
+	    state.rub[state.pending_rubber].size = 0;
+	    state.pending_rubber++;
+	    break;
+	  }
+	case '|':			/* set tab */
+	  { int stop;
+
+	    if ( arg == DEFAULT )
+	      arg = state.column;
+	case '+':			/* tab relative */
+	    if ( arg == DEFAULT )
+	      arg = 8;
+	    stop = (c == '+' ? tab_stop + arg : arg);
+
+	    if ( state.pending_rubber == 0 ) /* nothing to distribute */
+	    { state.rub[0].where = state.buffered;
+	      state.rub[0].pad = ' ';
+	      state.pending_rubber++;
+	    }
+	    distribute_rubber(state.rub,
+			      state.pending_rubber,
+			      stop - state.column);
+	    emit_rubber(&state);
+
+	    state.column = tab_stop = stop;
+	    break;
+	  }
+	default:
+	{ term_t ex = PL_new_term_ref();
+
+	  PL_put_atom(ex, codeToAtom(c));
+	  return PL_error("format", 2, NULL, ERR_EXISTENCE,
+			  PL_new_atom("format_character"),
+			  ex);
 	}
+      }
     }
   }
 
@@ -993,6 +1140,16 @@ formatInteger(PL_locale *locale, int div, int radix, bool smll, Number i,
   { case V_INTEGER:
     { int64_t n = i->value.i;
 
+      if ( radix == 10 && div == 0 && !grouping )
+      { char *s = allocFromBuffer(out, 24);
+
+	if ( !s )
+	  outOfCore();
+	out->top = i64toa(n, s)+1;
+
+	return baseBuffer(out, char);
+      }
+
       if ( n == 0 && div == 0 )
       { addBuffer(out, '0', char);
       } else
@@ -1046,8 +1203,12 @@ formatInteger(PL_locale *locale, int div, int radix, bool smll, Number i,
       char tmp[256];
       char *buf;
       int rc = TRUE;
+      int direct = (!grouping && div <= 0);
 
-      if ( len+2 > sizeof(tmp) )
+      if ( direct )			/* no grouping: write in place */
+      { if ( !(buf = allocFromBuffer(out, len+2)) )
+	  outOfCore();
+      } else if ( len+2 > sizeof(tmp) )
 	buf = PL_malloc(len+2);
       else
 	buf = tmp;
@@ -1069,6 +1230,11 @@ formatInteger(PL_locale *locale, int div, int radix, bool smll, Number i,
 	  *s = toupper(*s);
       }
 
+      if ( direct )
+      { out->top = buf+strlen(buf)+1;
+	return baseBuffer(out, char);
+      }
+
       if ( grouping || div > 0 )
       { int before = FALSE;			/* before decimal point */
 	int gsize = 0;
@@ -187,7 +187,10 @@ compile_pattern(compiled_pattern *Out, char *p, int curl)
 
 	  for(;;)
 	  { switch( c = *p++ )
-	    { case '\\':
+	    { case EOS:
+		warning("Unmatched '['");
+		return (char *)NULL;
+	      case '\\':
 		if ( *p == EOS )
 		{ warning("Unmatched '['");
 		  return (char *)NULL;
@@ -316,6 +319,8 @@ match_pattern(matchcode *p, char *str)
       case ALT:
 	  if ( match_pattern(p+1, (char *)s) )
 	    succeed;
+	  if ( *p == 0 )			/* last alternative */
+	    fail;
 	  p += *p;
 	  continue;
       default:						/* character */
@@ -333,26 +338,491 @@ match_pattern(matchcode *p, char *str)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Compiled pattern cache.  Code that  calls wildcard_match/2 typically uses
+the same few patterns over and over. If the pattern is an atom we cache
+its compiled form in a per-thread table keyed by the  atom.  The  entry
+is allocated to the exact size of the code. As compilation depends on the
+file_name_case_handling flag, we record the flag and  recompile  if  it
+has changed.  The table is simply flushed if it grows too large.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define MAX_CACHED_PATTERNS 4096
+
+typedef struct cached_pattern
+{ int		case_sensitive;		/* file_name_case_handling at compile */
+  int		size;			/* size of code */
+  matchcode	code[1];		/* the compiled pattern */
+} cached_pattern;
+
+static void
+free_cached_pattern_symbol(void *name, void *value)
+{ cached_pattern *cp = value;
+
+  PL_unregister_atom((atom_t)name);
+  freeHeap(cp, offsetof(cached_pattern, code[cp->size]));
+}
+
+
+static cached_pattern *
+new_cached_pattern(compiled_pattern *buf, int case_sensitive)
+{ cached_pattern *cp = allocHeapOrHalt(offsetof(cached_pattern,
+						 code[buf->size]));
+
+  cp->case_sensitive = case_sensitive;
+  cp->size = buf->size;
+  memcpy(cp->code, buf->code, buf->size);
+
+  return cp;
+}
+
+
+static cached_pattern *
+cached_compiled_pattern(atom_t a, char *p ARG_LD)
+{ Table ht;
+  cached_pattern *cp;
+  compiled_pattern buf;
+  int case_sensitive = truePrologFlag(PLFLAG_FILE_CASE) ? TRUE : FALSE;
+
+  if ( !(ht = LD->glob_cache) )
+  { ht = LD->glob_cache = newHTable(32);
+    ht->free_symbol = free_cached_pattern_symbol;
+  }
+
+  if ( (cp = lookupHTable(ht, (void*)a)) &&
+       cp->case_sensitive == case_sensitive )
+    return cp;
+
+  if ( !compilePattern(p, &buf) )
+    return NULL;
+
+  if ( cp )
+  { cached_pattern *old = cp;
+
+    cp = new_cached_pattern(&buf, case_sensitive);
+    updateHTable(ht, (void*)a, cp);
+    freeHeap(old, offsetof(cached_pattern, code[old->size]));
+  } else
+  { if ( ht->size >= MAX_CACHED_PATTERNS )
+      clearHTable(ht);
+    cp = new_cached_pattern(&buf, case_sensitive);
+    PL_register_atom(a);
+    addNewHTable(ht, (void*)a, cp);
+  }
+
+  return cp;
+}
+
+
+void
+freeGlobLocalData(PL_local_data_t *ld)
+{ if ( ld->glob_cache )
+  { Table ht = ld->glob_cache;
+
+    ld->glob_cache = NULL;
+    destroyHTable(ht);
+  }
+}
+
+
 /** wildcard_match(+Pattern, +Name) is semidet.
 */
 
 static
 PRED_IMPL("wildcard_match", 2, wildcard_match, 0)
-{ char *p, *s;
-  compiled_pattern buf;
+{ PRED_LD
+  char *p, *s;
+  atom_t a;
 
   if ( !PL_get_chars(A1, &p, CVT_ALL|CVT_EXCEPTION) ||
        !PL_get_chars(A2,  &s, CVT_ALL|CVT_EXCEPTION) )
     fail;
 
-  if ( compilePattern(p, &buf) )
-  { return matchPattern(s, &buf);
+  if ( PL_get_atom(A1, &a) )
+  { cached_pattern *cp;
+
+    if ( (cp = cached_compiled_pattern(a, p PASS_LD)) )
+      return match_pattern(cp->code, s);
+  } else
+  { compiled_pattern buf;
+
+    if ( compilePattern(p, &buf) )
+      return matchPattern(s, &buf);
   }
 
   return PL_error(NULL, 0, NULL, ERR_DOMAIN, ATOM_pattern, A1);
 }
 
 
+		 /*******************************
+		 *	   PATTERN SETS		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A pattern set matches a name against many patterns in a single pass. All
+patterns are compiled into one code  array.  Rather  than  running  the
+backtracking matcher above for each pattern, we simulate the patterns as
+one non-deterministic automaton: the state is the set of program counters
+that are alive after reading a prefix of the name.  ALT and JMP are empty
+transitions that are followed when a pc is added  to  the  state.  STAR
+consumes a character and stays alive.  After the last character, each
+EXIT in the state identifies a matching pattern.
+
+The cost is proportional to the length of the name times the number of
+live states.  That is typically much less than the total pattern size,
+as most patterns die after the first few characters.  The initial state
+is computed when the set is created.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef unsigned int pc_t;
+
+typedef struct pattern_set
+{ size_t	count;			/* # patterns */
+  atom_t       *patterns;		/* patterns as atoms (registered) */
+  pc_t	       *start;			/* start of pattern i in code */
+  size_t	size;			/* size of code */
+  matchcode    *code;			/* code for all patterns */
+  size_t	initial_count;		/* # pcs in initial state */
+  pc_t	       *initial;		/* initial state */
+  int		case_sensitive;		/* file_name_case_handling at compile */
+} pattern_set;
+
+typedef struct ps_ref
+{ pattern_set  *set;			/* the pattern set */
+} ps_ref;
+
+typedef struct ps_state
+{ size_t	count;			/* # pcs in state */
+  pc_t	       *pcs;			/* the pcs */
+} ps_state;
+
+
+static void
+free_pattern_set(pattern_set *set)
+{ size_t i;
+
+  for(i=0; i<set->count; i++)
+  { if ( set->patterns[i] )
+      PL_unregister_atom(set->patterns[i]);
+  }
+  if ( set->patterns )
+    free(set->patterns);
+  if ( set->start )
+    free(set->start);
+  if ( set->code )
+    free(set->code);
+  if ( set->initial )
+    free(set->initial);
+  free(set);
+}
+
+
+static int
+write_pattern_set_ref(IOSTREAM *s, atom_t aref, int flags)
+{ ps_ref *ref = PL_blob_data(aref, NULL, NULL);
+  (void)flags;
+
+  Sfprintf(s, "<wildcard_pattern_set>(%p)", ref->set);
+  return TRUE;
+}
+
+
+static int
+release_pattern_set_ref(atom_t aref)
+{ ps_ref *ref = PL_blob_data(aref, NULL, NULL);
+
+  if ( ref->set )
+    free_pattern_set(ref->set);
+
+  return TRUE;
+}
+
+
+static int
+save_pattern_set(atom_t aref, IOSTREAM *fd)
+{ ps_ref *ref = PL_blob_data(aref, NULL, NULL);
+  (void)fd;
+
+  return PL_warning("Cannot save reference to <wildcard_pattern_set>(%p)",
+		    ref->set);
+}
+
+
+static atom_t
+load_pattern_set(IOSTREAM *fd)
+{ (void)fd;
+
+  return PL_new_atom("<saved-wildcard_pattern_set-ref>");
+}
+
+
+static PL_blob_t pattern_set_blob =
+{ PL_BLOB_MAGIC,
+  PL_BLOB_UNIQUE,
+  "wildcard_pattern_set",
+  release_pattern_set_ref,
+  NULL,
+  write_pattern_set_ref,
+  NULL,
+  save_pattern_set,
+  load_pattern_set
+};
+
+
+static int
+get_pattern_set(term_t t, pattern_set **sp)
+{ void *data;
+  PL_blob_t *type;
+
+  if ( PL_get_blob(t, &data, NULL, &type) && type == &pattern_set_blob )
+  { ps_ref *ref = data;
+
+    *sp = ref->set;
+    return TRUE;
+  }
+
+  PL_type_error("wildcard_pattern_set", t);
+  return FALSE;
+}
+
+
+static int
+unify_pattern_set(term_t t, pattern_set *set)
+{ ps_ref ref;
+
+  ref.set = set;
+  return PL_unify_blob(t, &ref, sizeof(ref), &pattern_set_blob);
+}
+
+
+/* add_state() adds pc and everything reachable through empty transitions
+   to state.  mark[pc] == gen if pc is already in state.
+*/
+
+static void
+add_state(const pattern_set *set, pc_t pc,
+	  ps_state *state, unsigned int *mark, unsigned int gen)
+{ for(;;)
+  { const matchcode *code = set->code;
+
+    if ( mark[pc] == gen )
+      return;
+    mark[pc] = gen;
+
+    switch(code[pc])
+    { case ALT:
+      { matchcode off = code[pc+1];
+
+	if ( off )
+	  add_state(set, pc+1+off, state, mark, gen);
+	pc += 2;
+	continue;
+      }
+      case JMP:
+	pc += 1+code[pc+1];
+	continue;
+      case STAR:
+	state->pcs[state->count++] = pc;
+	pc++;
+	continue;
+      default:
+	state->pcs[state->count++] = pc;
+	return;
+    }
+  }
+}
+
+
+static int
+compare_pcs(const void *p1, const void *p2)
+{ pc_t pc1 = *(const pc_t*)p1;
+  pc_t pc2 = *(const pc_t*)p2;
+
+  return pc1 < pc2 ? -1 : pc1 > pc2 ? 1 : 0;
+}
+
+
+static size_t
+pattern_of_pc(const pattern_set *set, pc_t pc)
+{ size_t l = 0, h = set->count;		/* start[l] <= pc < start[h] */
+
+  while( h-l > 1 )
+  { size_t m = (l+h)/2;
+
+    if ( set->start[m] <= pc )
+      l = m;
+    else
+      h = m;
+  }
+
+  return l;
+}
+
+
+static int
+match_pattern_set(const pattern_set *set, const char *str, term_t matches)
+{ GET_LD
+  ps_state states[2];
+  ps_state *cur = &states[0], *next = &states[1];
+  unsigned int *mark;
+  unsigned int gen = 1;
+  const matchcode *code = set->code;
+  const matchcode *s = (const matchcode*)str;
+  term_t tail = PL_copy_term_ref(matches);
+  term_t head = PL_new_term_ref();
+  size_t i;
+  int rc = TRUE;
+
+  if ( !(mark = calloc(set->size+1, sizeof(*mark))) ||
+       !(states[0].pcs = malloc((set->size+1)*2*sizeof(pc_t))) )
+  { if ( mark ) free(mark);
+    return PL_no_memory();
+  }
+  states[1].pcs = states[0].pcs + set->size+1;
+  memcpy(cur->pcs, set->initial, set->initial_count*sizeof(pc_t));
+  cur->count = set->initial_count;
+
+  for( ; *s && cur->count > 0; s++ )
+  { matchcode c = *s;
+
+    if ( !set->case_sensitive )
+      c = makeLower(c);
+
+    next->count = 0;
+    gen++;
+    for(i=0; i<cur->count; i++)
+    { pc_t pc = cur->pcs[i];
+      matchcode op = code[pc];
+
+      switch(op)
+      { case EXIT:
+	  break;
+	case ANY:
+	  add_state(set, pc+1, next, mark, gen);
+	  break;
+	case ANYOF:
+	  if ( code[pc+1+c/8] & (1 << (c%8)) )
+	    add_state(set, pc+17, next, mark, gen);
+	  break;
+	case STAR:
+	  add_state(set, pc, next, mark, gen);
+	  break;
+	default:
+	  if ( op == c )
+	    add_state(set, pc+1, next, mark, gen);
+      }
+    }
+
+    { ps_state *tmp = cur; cur = next; next = tmp; }
+  }
+
+  if ( *s == EOS )
+  { qsort(cur->pcs, cur->count, sizeof(pc_t), compare_pcs);
+    for(i=0; i<cur->count && rc; i++)
+    { pc_t pc = cur->pcs[i];
+
+      if ( code[pc] == EXIT )
+      { size_t p = pattern_of_pc(set, pc);
+
+	rc = ( PL_unify_list(tail, head, tail) &&
+	       PL_unify_atom(head, set->patterns[p]) );
+      }
+    }
+  }
+
+  free(mark);
+  free(states[0].pcs);
+
+  return rc && PL_unify_nil(tail);
+}
+
+
+/** wildcard_pattern_set(+Patterns, -Set) is det.
+*/
+
+static
+PRED_IMPL("wildcard_pattern_set", 2, wildcard_pattern_set, 0)
+{ PRED_LD
+  term_t tail = PL_copy_term_ref(A1);
+  term_t head = PL_new_term_ref();
+  tmp_buffer code;
+  compiled_pattern buf;
+  pattern_set *set;
+  ssize_t len;
+  size_t i;
+  unsigned int *mark;
+  ps_state state;
+
+  if ( (len = lengthList(A1, TRUE)) < 0 )
+    return FALSE;
+  if ( !(set = calloc(1, sizeof(*set))) ||
+       !(set->patterns = calloc(len+1, sizeof(atom_t))) ||
+       !(set->start = malloc((len+1)*sizeof(pc_t))) )
+  { if ( set )
+      free_pattern_set(set);
+    return PL_no_memory();
+  }
+  set->case_sensitive = truePrologFlag(PLFLAG_FILE_CASE) ? TRUE : FALSE;
+
+  initBuffer(&code);
+  for(i=0; PL_get_list(tail, head, tail); i++)
+  { char *p;
+
+    if ( !PL_get_chars(head, &p, CVT_ALL|CVT_EXCEPTION) )
+      goto error;
+    if ( !compilePattern(p, &buf) )
+    { PL_error(NULL, 0, NULL, ERR_DOMAIN, ATOM_pattern, head);
+      goto error;
+    }
+    set->patterns[i] = PL_new_atom(p);
+    set->count++;
+    set->start[i] = (pc_t)entriesBuffer(&code, matchcode);
+    addMultipleBuffer(&code, buf.code, buf.size, matchcode);
+  }
+  set->size = entriesBuffer(&code, matchcode);
+  set->start[set->count] = (pc_t)set->size;
+
+  if ( !(set->code = malloc(set->size+1)) ||
+       !(set->initial = malloc((set->size+1)*sizeof(pc_t))) ||
+       !(mark = calloc(set->size+1, sizeof(*mark))) )
+  { PL_no_memory();
+    goto error;
+  }
+  memcpy(set->code, baseBuffer(&code, matchcode), set->size);
+  discardBuffer(&code);
+
+  state.count = 0;
+  state.pcs = set->initial;
+  for(i=0; i<set->count; i++)
+    add_state(set, set->start[i], &state, mark, 1);
+  set->initial_count = state.count;
+  free(mark);
+
+  return unify_pattern_set(A2, set);
+
+error:
+  discardBuffer(&code);
+  free_pattern_set(set);
+  return FALSE;
+}
+
+
+/** wildcard_set_match(+Set, +Name, -Matches) is det.
+*/
+
+static
+PRED_IMPL("wildcard_set_match", 3, wildcard_set_match, 0)
+{ pattern_set *set;
+  char *s;
+
+  if ( !get_pattern_set(A1, &set) ||
+       !PL_get_chars(A2, &s, CVT_ALL|CVT_EXCEPTION) )
+    return FALSE;
+
+  return match_pattern_set(set, s, A3);
+}
+
+
 		 /*******************************
 		 *	EXPAND_FILE_NAME/2	*
 		 *******************************/
@@ -681,4 +1151,6 @@ BeginPredDefs(glob)
   PRED_DEF("expand_file_name", 2, expand_file_name, 0)
   PRED_DEF("wildcard_match",   2, wildcard_match,   0)
   PRED_DEF("directory_files",  2, directory_files,  0)
+  PRED_DEF("wildcard_pattern_set", 2, wildcard_pattern_set, 0)
+  PRED_DEF("wildcard_set_match", 3, wildcard_set_match, 0)
 EndPredDefs
@@ -806,6 +806,16 @@ set_prolog_flag_unlocked(Module m, atom_t k, term_t value, int flags ARG_LD)
 	}
       } else if ( k == ATOM_debugger_show_context )
       { debugstatus.showContext = val;
+      } else if ( k == ATOM_stack_huge_pages )
+      { GD->options.stackHugePages = val;
+      } else if ( k == ATOM_stack_numa_bind )
+      { GD->options.stackNumaBind = val;
+      } else if ( k == ATOM_stack_reserve )
+      { GD->options.stackReserve = val;
+      } else if ( k == ATOM_tidy_trail )
+      { GD->options.tidyTrail = val;
+      } else if ( k == ATOM_record_sharing )
+      { GD->recorded_db.share = val;
 #ifdef O_PLMT
       } else if ( k == ATOM_threads )
       { if ( val )
@@ -919,6 +929,10 @@ set_prolog_flag_unlocked(Module m, atom_t k, term_t value, int flags ARG_LD)
 	    free_alloc_pool(pool);
 	} else
 	  GD->tabling.node_pool->limit = (size_t)i;
+      } else if ( k == ATOM_index_threads )
+      { GD->thread.index.workers = (i > 0 ? (unsigned int)i : 1);
+      } else if ( k == ATOM_index_background )
+      { GD->thread.index.background = (i > 0 ? (size_t)i : 0);
       }
 #endif
       else if ( k == ATOM_stack_limit )
@@ -926,6 +940,12 @@ set_prolog_flag_unlocked(Module m, atom_t k, term_t value, int flags ARG_LD)
 	  return FALSE;
       } else if ( k == ATOM_string_stack_tripwire )
       { LD->fli.string_buffers.tripwire = (unsigned int)i;
+      } else if ( k == ATOM_stack_shrink_gcs )
+      { if ( i < 0 )
+	  return PL_error(NULL, 0, NULL, ERR_DOMAIN,
+			  ATOM_not_less_than_zero, value);
+	LD->gc.shrink_gcs = (i > UINT_MAX ? UINT_MAX : (unsigned int)i);
+	LD->gc.oversized_gcs = 0;
       }
       break;
     }
@@ -934,6 +954,12 @@ set_prolog_flag_unlocked(Module m, atom_t k, term_t value, int flags ARG_LD)
 
       if ( !PL_get_float_ex(value, &d) )
 	return FALSE;
+      if ( k == ATOM_gc_pause_budget )
+      { if ( d < 0.0 )
+	  return PL_error(NULL, 0, NULL, ERR_DOMAIN,
+			  ATOM_not_less_than_zero, value);
+	LD->gc.pause_budget = d;
+      }
       f->value.f = d;
       break;
     }
@@ -1461,6 +1487,7 @@ initPrologFlags(void)
 #endif
   setPrologFlag("unload_foreign_libraries", FT_BOOL, FALSE, 0);
   setPrologFlag("gc",	  FT_BOOL,	       TRUE,  PLFLAG_GC);
+  setPrologFlag("gc_pause_budget", FT_FLOAT,      0.0);
   setPrologFlag("trace_gc",  FT_BOOL,	       FALSE, PLFLAG_TRACE_GC);
 #ifdef O_ATOMGC
   setPrologFlag("agc_margin",FT_INTEGER,	       GD->atoms.margin);
@@ -1468,8 +1495,16 @@ initPrologFlags(void)
   setPrologFlag("table_space", FT_INTEGER, GD->options.tableSpace);
 #ifdef O_PLMT
   setPrologFlag("shared_table_space", FT_INTEGER, GD->options.sharedTableSpace);
+  setPrologFlag("index_threads", FT_INTEGER, GD->thread.index.workers);
+  setPrologFlag("index_background", FT_INTEGER, GD->thread.index.background);
 #endif
   setPrologFlag("stack_limit", FT_INTEGER, LD->stacks.limit);
+  setPrologFlag("stack_huge_pages", FT_BOOL, FALSE, 0);
+  setPrologFlag("stack_numa_bind", FT_BOOL, FALSE, 0);
+  setPrologFlag("stack_reserve", FT_BOOL, GD->options.stackReserve, 0);
+  setPrologFlag("tidy_trail", FT_BOOL, FALSE, 0);
+  setPrologFlag("record_sharing", FT_BOOL, FALSE, 0);
+  setPrologFlag("stack_shrink_gcs", FT_INTEGER, 0);
 #if defined(HAVE_DLOPEN) || defined(HAVE_SHL_LOAD) || defined(EMULATE_DLOPEN)
   setPrologFlag("open_shared_object",	  FT_BOOL|FF_READONLY, TRUE, 0);
   setPrologFlag("shared_object_extension",	  FT_ATOM|FF_READONLY, SO_EXT);
@@ -1616,6 +1651,9 @@ initPrologFlags(void)
   setPrologFlag("table_incremental", FT_BOOL, FALSE, PLFLAG_TABLE_INCREMENTAL);
   setPrologFlag("table_subsumptive", FT_BOOL, FALSE, 0);
   setPrologFlag("table_shared",      FT_BOOL, FALSE, PLFLAG_TABLE_SHARED);
+  setPrologFlag("table_space_eviction", FT_BOOL, FALSE,
+		PLFLAG_TABLE_SPACE_EVICTION);
+  setPrologFlag("index_statistics",  FT_BOOL, FALSE, PLFLAG_INDEX_STATISTICS);
 
   setTmpDirPrologFlag();
   setTZPrologFlag();
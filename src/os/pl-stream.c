@@ -103,6 +103,19 @@ locking is required.
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#else
+#undef HAVE_MMAP
+#endif
+#if defined(HAVE_SYS_UIO_H) && defined(HAVE_WRITEV)
+#include <sys/uio.h>
+#define USE_WRITEV 1
+#endif
+#if defined(HAVE_SYS_SENDFILE_H) && defined(HAVE_SENDFILE)
+#include <sys/sendfile.h>
+#define USE_SENDFILE 1
+#endif
 #include <stdio.h>			/* sprintf() for numeric values */
 #include <assert.h>
 #ifdef SYSLIB_H
@@ -124,6 +137,7 @@ locking is required.
 #define TMPBUFSIZE 256			/* Serror bufsize for Svfprintf() */
 
 int Slinesize = SIO_LINESIZE;		/* Sgets() buffer size */
+io_totals S__iototals;			/* bytes moved by all streams */
 
 static ssize_t	S__flushbuf(IOSTREAM *s);
 static void	run_close_hooks(IOSTREAM *s);
@@ -135,13 +149,96 @@ static IOSTREAM *	Sopen_buffer(IOSTREAM *s, char *buf, size_t size);
 static void		Sclose_buffer(IOSTREAM *s);
 
 #ifdef O_PLMT
-#define SLOCK(s)    if ( s->mutex ) recursiveMutexLock(s->mutex)
-#define SUNLOCK(s)  if ( s->mutex ) recursiveMutexUnlock(s->mutex)
+extern int			PL_thread_self(void);
+extern void			revokeStreamOwner(int tid);
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Streams owned by a thread (s->owner is the   Prolog thread id) avoid the
+mutex operations while only the owner uses them.  On its first access,
+the owner locks the mutex and keeps it   locked (s->owner_held): further
+locking merely counts s->owner_depth. Another   thread that accesses the
+stream sets s->owner_revoke, signals the owner  and waits for the mutex.
+The owner releases the mutex and ownership  when it leaves its outermost
+lock or from the signal handler (see  Srelease_owner()), after which the
+stream uses normal locking. Only the owner changes s->owner_held and only
+a thread holding the mutex changes s->owner.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+S__release_owner(IOSTREAM *s)
+{ s->owner_held = FALSE;
+  s->owner_revoke = FALSE;
+  s->owner = 0;
+  recursiveMutexUnlock(s->mutex);
+}
+
+static int
+S__owner_lock(IOSTREAM *s, int owner, int try)
+{ if ( owner == PL_thread_self() )
+  { if ( !s->owner_held )
+    { if ( try )
+      { if ( recursiveMutexTryLock(s->mutex) == EBUSY )
+	  return FALSE;
+      } else
+	recursiveMutexLock(s->mutex);
+
+      if ( s->owner_revoke || s->owner != owner )
+      { s->owner_revoke = FALSE;	/* another thread wants it: */
+	s->owner = 0;			/* we have a normal lock */
+	return TRUE;
+      }
+      s->owner_held = TRUE;
+    }
+    s->owner_depth++;
+    return TRUE;
+  }
+
+  s->owner_revoke = TRUE;
+  revokeStreamOwner(owner);
+  if ( try )
+  { if ( recursiveMutexTryLock(s->mutex) == EBUSY )
+      return FALSE;
+  } else
+    recursiveMutexLock(s->mutex);
+  s->owner_revoke = FALSE;		/* owner did not lock it */
+  s->owner = 0;
+
+  return TRUE;
+}
+
+static inline void
+SLOCK(IOSTREAM *s)
+{ if ( s->mutex )
+  { int owner = s->owner;
+
+    if ( owner )
+      S__owner_lock(s, owner, FALSE);
+    else
+      recursiveMutexLock(s->mutex);
+  }
+}
+
+static inline void
+SUNLOCK(IOSTREAM *s)
+{ if ( s->mutex )
+  { if ( s->owner_held )
+    { if ( --s->owner_depth == 0 && s->owner_revoke )
+	S__release_owner(s);
+    } else
+      recursiveMutexUnlock(s->mutex);
+  }
+}
+
 static inline int
 STRYLOCK(IOSTREAM *s)
-{ if ( s->mutex &&
-       recursiveMutexTryLock(s->mutex) == EBUSY )
-    return FALSE;
+{ if ( s->mutex )
+  { int owner = s->owner;
+
+    if ( owner )
+      return S__owner_lock(s, owner, TRUE);
+    if ( recursiveMutexTryLock(s->mutex) == EBUSY )
+      return FALSE;
+  }
 
   return TRUE;
 }
@@ -244,6 +341,7 @@ S__setbuf(IOSTREAM *s, char *buffer, size_t size)
   }
   s->bufsize = (int)size;
   s->flags = newflags;
+  s->mapped = FALSE;
 
   return size;
 }
@@ -252,7 +350,46 @@ S__setbuf(IOSTREAM *s, char *buffer, size_t size)
 void
 Ssetbuffer(IOSTREAM *s, char *buffer, size_t size)
 { if ( S__setbuf(s, buffer, size) != (size_t)-1 )
-    s->flags &= ~SIO_USERBUF;
+  { s->flags &= ~SIO_USERBUF;
+    s->fixed_buffer = TRUE;
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+S__growbuf() doubles the output buffer of  a   fully  buffered stream to a
+regular file up to SIO_MAXBUFSIZE.  It is  called after flushing a full
+buffer, so streams that write a lot   quickly reduce the number of write
+calls.  Streams to devices, pipes, etc. keep   their  buffer size to keep
+latency low, as do streams  whose  buffer   size  was  set  explicitly
+using Ssetbuffer().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#if !defined(S_ISREG) && defined(S_IFREG)
+#define S_ISREG(m) ((m&S_IFMT) == S_IFREG)
+#endif
+
+static void
+S__growbuf(IOSTREAM *s)
+{ if ( (s->flags & (SIO_FBUF|SIO_FILE|SIO_USERBUF)) == (SIO_FBUF|SIO_FILE) &&
+       !s->fixed_buffer && s->bufp == s->buffer &&
+       s->bufsize < SIO_MAXBUFSIZE )
+  { struct stat buf;
+    size_t size = (size_t)s->bufsize*2;
+    char *newunbuf;
+
+    if ( fstat(Sfileno(s), &buf) != 0 || !S_ISREG(buf.st_mode) ||
+	 !(newunbuf = malloc(size+UNDO_SIZE)) )
+    { s->fixed_buffer = TRUE;
+      return;
+    }
+
+    free(s->unbuffer);
+    s->unbuffer = newunbuf;
+    s->bufp = s->buffer = newunbuf + UNDO_SIZE;
+    s->limitp = &s->buffer[size];
+    s->bufsize = (int)size;
+  }
 }
 
 
@@ -348,6 +485,29 @@ StryLock(IOSTREAM *s)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Srelease_owner() releases the mutex of a stream   owned and held by the
+calling thread if this thread is not using  the stream and either force
+is TRUE or another thread asked for access.  After this, the stream uses
+normal locking.  Returns TRUE if the stream was released.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+Srelease_owner(IOSTREAM *s, int force)
+{
+#ifdef O_PLMT
+  if ( s->mutex && s->owner && s->owner == PL_thread_self() &&
+       s->owner_held && s->owner_depth == 0 &&
+       (force || s->owner_revoke) )
+  { S__release_owner(s);
+    return TRUE;
+  }
+#endif
+
+  return FALSE;
+}
+
+
 int
 Sunlock(IOSTREAM *s)
 { int rval = 0;
@@ -521,6 +681,7 @@ S__flushbuf(IOSTREAM *s)
 
     if ( n > 0 )			/* wrote some */
     { from += n;
+      ATOMIC_ADD(&S__iototals.bytes_written, n);
     } else if ( n < 0 )			/* error */
     { if ( errno == EINTR )
       { if ( PL_handle_signals() < 0 )
@@ -561,9 +722,11 @@ static int
 S__flushbufc(int c, IOSTREAM *s)
 { if ( s->buffer )
   { if ( S__flushbuf(s) <= 0 )		/* == 0: no progress!? */
-      c = -1;
-    else
+    { c = -1;
+    } else
+    { S__growbuf(s);
       *s->bufp++ = (c & 0xff);
+    }
   } else
   { if ( s->flags & SIO_NBUF )
     { char chr = (char)c;
@@ -571,7 +734,8 @@ S__flushbufc(int c, IOSTREAM *s)
       if ( (*s->functions->write)(s->handle, &chr, 1) != 1 )
       { S__seterror(s);
 	c = -1;
-      }
+      } else
+	ATOMIC_INC(&S__iototals.bytes_written);
     } else
     { if ( S__setbuf(s, NULL, 0) == (size_t)-1 )
 	c = -1;
@@ -623,7 +787,8 @@ S__fillbuf(IOSTREAM *s)
 
     n = (*s->functions->read)(s->handle, &chr, 1);
     if ( n == 1 )
-    { c = char_to_int(chr);
+    { ATOMIC_INC(&S__iototals.bytes_read);
+      c = char_to_int(chr);
       return c;
     } else if ( n == 0 )
     { if ( !(s->flags & SIO_NOFEOF) )
@@ -644,7 +809,7 @@ S__fillbuf(IOSTREAM *s)
       len = s->bufsize;
     } else if ( s->bufp < s->limitp )
     { len = s->limitp - s->bufp;
-      if ( len == s->bufsize )
+      if ( len == s->bufsize || s->mapped ) /* cannot get more */
       { c = char_to_int(*s->bufp++);
 	return c;
       }
@@ -659,7 +824,8 @@ S__fillbuf(IOSTREAM *s)
 
     n = (*s->functions->read)(s->handle, s->limitp, len);
     if ( n > 0 )
-    { s->limitp += n;
+    { ATOMIC_ADD(&S__iototals.bytes_read, n);
+      s->limitp += n;
       c = char_to_int(*s->bufp++);
       return c;
     } else
@@ -1313,11 +1479,110 @@ Sfread(void *data, size_t size, size_t elms, IOSTREAM *s)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+S__writethrough() writes the buffer  followed  by   data  of  a  fully
+buffered output stream, bypassing the buffer for  data. This is used by
+Sfwrite() for blocks that  do  not  fit  in   the  buffer.  If  the OS
+supports writev(), file streams write both using a single system call.
+Returns the number of bytes written from data or -1 on error.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static ssize_t
+S__writethrough(IOSTREAM *s, const char *data, size_t len)
+{ const char *from = data;
+  const char *to = data+len;
+
+#ifdef USE_WRITEV
+  if ( s->functions == &Sfilefunctions && s->bufp > s->buffer )
+  { struct iovec iov[2];
+
+    iov[0].iov_base = s->buffer;
+    iov[0].iov_len  = s->bufp - s->buffer;
+    iov[1].iov_base = (char*)data;
+    iov[1].iov_len  = len;
+
+    while ( iov[0].iov_len > 0 )
+    { ssize_t n = writev(Sfileno(s), iov, 2);
+
+      if ( n < 0 )
+      { if ( errno == EINTR )
+	{ if ( PL_handle_signals() < 0 )
+	  { Sset_exception(s, PL_exception(0));
+	    errno = EPLEXCEPTION;
+	    return -1;
+	  }
+	  continue;
+	}
+	S__seterror(s);
+	return -1;
+      } else if ( n == 0 )
+      { return -1;
+      }
+
+      ATOMIC_ADD(&S__iototals.bytes_written, n);
+      if ( (size_t)n < iov[0].iov_len )
+      { iov[0].iov_base = (char*)iov[0].iov_base + n;
+	iov[0].iov_len -= n;
+      } else
+      { from += n - iov[0].iov_len;
+	iov[0].iov_len = 0;
+      }
+    }
+    s->bufp = s->buffer;
+  } else
+#endif
+  if ( s->buffer && (S__flushbuf(s) < 0 || s->bufp > s->buffer) )
+    return -1;				/* error or partial flush */
+
+  while ( from < to )
+  { ssize_t n = (*s->functions->write)(s->handle, (char*)from, to-from);
+
+    if ( n > 0 )
+    { from += n;
+      ATOMIC_ADD(&S__iototals.bytes_written, n);
+    } else if ( n < 0 && errno == EINTR )
+    { if ( PL_handle_signals() < 0 )
+      { Sset_exception(s, PL_exception(0));
+	errno = EPLEXCEPTION;
+	break;
+      }
+    } else
+    { if ( n < 0 )
+	S__seterror(s);
+      break;
+    }
+  }
+
+  return from == data && len > 0 ? -1 : from - data;
+}
+
+
 size_t
 Sfwrite(const void *data, size_t size, size_t elms, IOSTREAM *s)
 { size_t chars = size * elms;
   const char *buf = data;
 
+  if ( chars > (size_t)(s->limitp - s->bufp) && chars >= SIO_BUFSIZE &&
+       (s->flags & (SIO_FBUF|SIO_OUTPUT)) == (SIO_FBUF|SIO_OUTPUT) &&
+       s->timeout < 0 )
+  { ssize_t n = S__writethrough(s, buf, chars);
+
+    if ( n < 0 )
+      return 0;
+    if ( n > 0 )
+      s->lastc = buf[n-1]&0xff;
+    if ( s->position )
+    { const char *e = buf+n;
+
+      for(; buf < e; buf++)
+      { s->position->byteno++;
+	S__updatefilepos(s, *buf&0xff);
+      }
+    }
+
+    return n/size;
+  }
+
   for( ; chars > 0; chars-- )
   { if ( Sputc(*buf++, s) < 0 )
       break;
@@ -1371,6 +1636,154 @@ Sread_pending(IOSTREAM *s, char *buf, size_t limit, int flags)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Sread_ascii() is a bulk  alternative  to  Sgetcode()   for  text  that
+consists of ASCII characters. It copies at most  `size` bytes from the
+buffer of `s` to `buf`, updating the   position as Sgetcode() would. It
+stops before a non-ASCII byte, a \r  on   a  text stream and characters
+in the bitmap `stop`. Returns the number of bytes (and thus characters)
+copied. This is 0 if the buffer is  empty, the stream has a tee or the
+encoding is not an ASCII superset, in which   case the caller must use
+Sgetcode() to get the next character.
+
+Runs of printable characters are validated 8 bytes at a time. If `stop`
+only holds control characters, these runs are copied as a block.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define SWAR_ONES	((uint64_t)0x0101010101010101)
+#define SWAR_HIGH	(SWAR_ONES*0x80)
+#define SWAR_PRINTABLE(w) \
+	( ((w) & SWAR_HIGH) == 0 && \
+	  (((w) - SWAR_ONES*0x20) & ~(w) & SWAR_HIGH) == 0 )
+
+size_t
+Sread_ascii(IOSTREAM *s, char *buf, size_t size, const uint32_t stop[4])
+{ const unsigned char *start = (const unsigned char*)s->bufp;
+  const unsigned char *in = start;
+  const unsigned char *end;
+  IOPOS *p = s->position;
+  int stop_cr = (s->flags&SIO_TEXT);
+  int blocks = !(stop[1]|stop[2]|stop[3]);
+  size_t n;
+
+  switch(s->encoding)
+  { case ENC_OCTET:
+    case ENC_ISO_LATIN_1:
+    case ENC_ASCII:
+    case ENC_UTF8:
+      break;
+    default:
+      return 0;
+  }
+  if ( s->tee || s->bufp >= s->limitp )
+    return 0;
+
+  if ( size > (size_t)(s->limitp - s->bufp) )
+    size = s->limitp - s->bufp;
+  end = in+size;
+
+  while ( in < end )
+  { int c;
+
+    if ( blocks && end-in >= 8 )
+    { uint64_t w;
+
+      memcpy(&w, in, sizeof(w));
+      if ( SWAR_PRINTABLE(w) )
+      { memcpy(buf, in, sizeof(w));
+	buf += sizeof(w);
+	in  += sizeof(w);
+	if ( p )
+	  p->linepos += sizeof(w);
+	continue;
+      }
+    }
+
+    c = *in;
+    if ( c >= 0x80 || (c == '\r' && stop_cr) ||
+	 (stop[c>>5] & ((uint32_t)1<<(c&0x1f))) )
+      break;
+    *buf++ = (char)c;
+    in++;
+    if ( p )
+      update_linepos(s, c);
+  }
+
+  n = in-start;
+  s->bufp = (char*)in;
+  if ( p )
+  { p->byteno += n;
+    p->charno += n;
+  }
+
+  return n;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Swrite_ascii() is the output counterpart of Sread_ascii(). It copies the
+longest prefix of `buf` that consists  of   printable  ASCII  characters
+and  fits  in  the  buffer  of  `s`,  updating  the  position  as
+Sputcode() would. Returns the number of bytes (and thus characters)
+copied. This is 0 if the buffer is full, the  stream  has  a  tee or
+the encoding is not an ASCII superset, in which case the caller must use
+Sputcode() to emit the next character.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+size_t
+Swrite_ascii(IOSTREAM *s, const char *buf, size_t len)
+{ const unsigned char *start = (const unsigned char*)buf;
+  const unsigned char *in = start;
+  const unsigned char *end;
+  IOPOS *p = s->position;
+  size_t n;
+
+  switch(s->encoding)
+  { case ENC_OCTET:
+    case ENC_ISO_LATIN_1:
+    case ENC_ASCII:
+    case ENC_UTF8:
+      break;
+    default:
+      return 0;
+  }
+  if ( s->tee || s->bufp >= s->limitp )
+    return 0;
+
+  if ( len > (size_t)(s->limitp - s->bufp) )
+    len = s->limitp - s->bufp;
+  end = in+len;
+
+  while ( in < end )
+  { if ( end-in >= 8 )
+    { uint64_t w;
+
+      memcpy(&w, in, sizeof(w));
+      if ( SWAR_PRINTABLE(w) )
+      { in += sizeof(w);
+	continue;
+      }
+    }
+    if ( *in < 0x20 || *in >= 0x80 )
+      break;
+    in++;
+  }
+
+  if ( (n = in-start) > 0 )
+  { memcpy(s->bufp, start, n);
+    s->bufp += n;
+    s->lastc = in[-1];
+    if ( p )
+    { p->byteno  += n;
+      p->charno  += n;
+      p->linepos += (int)n;
+    }
+  }
+
+  return n;
+}
+
+
 /* Spending() returns the number of pending bytes on the given stream.
 */
 
@@ -1961,6 +2374,10 @@ Sclose(IOSTREAM *s)
     reportStreamError(s);
   run_close_hooks(s);			/* deletes Prolog registration */
   s->magic = SIO_CMAGIC;
+#ifdef O_PLMT
+  if ( s->owner_held )			/* final SUNLOCK() releases */
+    s->owner_revoke = TRUE;
+#endif
   SUNLOCK(s);
 
   if ( s->message )
@@ -3067,6 +3484,467 @@ Snew(void *handle, int flags, IOFUNCTIONS *functions)
 }
 
 
+		 /*******************************
+		 *	  MAPPED FILE STREAMS	*
+		 *******************************/
+
+#ifdef HAVE_MMAP
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A mapped file stream  uses  the  memory  mapped   file  as  its  buffer,
+avoiding the read() calls and copying  of   normal  file  streams. As a
+result, the buffer never needs to be   filled. The mapping is private and
+writable such that Sungetc() and friends can  write into the buffer. The
+mapping is a mere view on the file: other processes may still modify the
+file while it is being read.
+
+The buffer is the remainder  of  the  mapping  from  the  current read
+position. We only need to  re-point  it   if  the  stream  is positioned
+outside the current buffer, which is done by Sseek_mapped().  If the
+buffer is replaced (see S__setbuf()), the stream continues as a normal
+stream that reads from the mapping.
+
+The handle synchronises the stream  with   the  mapping.  `here` is the
+offset in the mapping that corresponds to s->limitp, i.e., the position
+from where Sread_mapped() continues.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct mapped_handle
+{ IOSTREAM *stream;			/* Stream we belong too */
+  char	   *start;			/* Start of the mapping */
+  size_t    size;			/* Size of the mapping */
+  size_t    here;			/* Read position of the handle */
+  int	    fd;				/* Underlying file */
+} mapped_handle;
+
+
+static void
+S__setmappedbuf(IOSTREAM *s, mapped_handle *h, size_t pos)
+{ size_t len = h->size - pos;
+
+  s->unbuffer = h->start;
+  s->buffer   = s->bufp = h->start + pos;
+  s->limitp   = h->start + h->size;
+  s->bufsize  = (len > INT_MAX ? INT_MAX : (int)len);
+  h->here     = h->size;
+}
+
+
+static ssize_t
+Sread_mapped(void *handle, char *buf, size_t size)
+{ mapped_handle *h = handle;
+  size_t left = h->size - h->here;
+
+  if ( size > left )
+    size = left;
+  memcpy(buf, h->start + h->here, size);
+  h->here += size;
+
+  return size;
+}
+
+
+static int64_t
+Sseek_mapped64(void *handle, int64_t pos, int whence)
+{ mapped_handle *h = handle;
+
+  switch(whence)
+  { case SIO_SEEK_SET:
+      break;
+    case SIO_SEEK_CUR:
+      if ( pos == 0 )			/* Stell64() */
+	return h->here;
+      pos += h->here;
+      break;
+    case SIO_SEEK_END:
+      pos += h->size;
+      break;
+    default:
+      errno = EINVAL;
+      return -1;
+  }
+
+  if ( pos < 0 || (uint64_t)pos > h->size )
+  { errno = EINVAL;
+    return -1;
+  }
+
+  if ( h->stream->mapped )
+    S__setmappedbuf(h->stream, h, (size_t)pos);
+  else
+    h->here = (size_t)pos;
+
+  return pos;
+}
+
+
+static long
+Sseek_mapped(void *handle, long pos, int whence)
+{ return (long)Sseek_mapped64(handle, pos, whence);
+}
+
+
+static int
+Sclose_mapped(void *handle)
+{ mapped_handle *h = handle;
+  int rc;
+
+  munmap(h->start, h->size);
+  do
+  { rc = close(h->fd);
+  } while ( rc == -1 && errno == EINTR );
+  free(h);
+
+  return rc;
+}
+
+
+static int
+Scontrol_mapped(void *handle, int action, void *arg)
+{ mapped_handle *h = handle;
+
+  switch(action)
+  { case SIO_GETSIZE:
+    { int64_t *rval = arg;
+
+      *rval = h->size;
+      return 0;
+    }
+    case SIO_SETENCODING:
+    case SIO_FLUSHOUTPUT:
+      return 0;
+    case SIO_GETFILENO:
+    { int *p = arg;
+      *p = h->fd;
+      return 0;
+    }
+    default:
+      return -1;
+  }
+}
+
+
+static IOFUNCTIONS Smappedfunctions =
+{ Sread_mapped,
+  NULL,
+  Sseek_mapped,
+  Sclose_mapped,
+  Scontrol_mapped,
+  Sseek_mapped64
+};
+
+
+/* Sopen_mapped() creates a mapped stream for reading fd.  Returns NULL
+   without an error if fd cannot be mapped, in which case the caller
+   must use a normal file stream.
+*/
+
+static IOSTREAM *
+Sopen_mapped(int fd, int flags)
+{ struct stat buf;
+  mapped_handle *h;
+  IOSTREAM *s;
+  void *start;
+
+  if ( fstat(fd, &buf) != 0 || !S_ISREG(buf.st_mode) ||
+       buf.st_size == 0 || (uint64_t)buf.st_size > SIZE_MAX )
+    return NULL;
+
+  if ( (start = mmap(NULL, (size_t)buf.st_size, PROT_READ|PROT_WRITE,
+		     MAP_PRIVATE, fd, 0)) == MAP_FAILED )
+    return NULL;
+  if ( !(h = malloc(sizeof(*h))) )
+  { munmap(start, (size_t)buf.st_size);
+    return NULL;
+  }
+  h->start = start;
+  h->size  = (size_t)buf.st_size;
+  h->fd	   = fd;
+
+  if ( !(s = Snew(h, (flags&~SIO_FILE)|SIO_USERBUF, &Smappedfunctions)) )
+  { munmap(start, h->size);
+    free(h);
+    return NULL;
+  }
+  h->stream = s;
+  s->mapped = TRUE;
+  S__setmappedbuf(s, h, 0);
+
+  return s;
+}
+
+#endif /*HAVE_MMAP*/
+
+
+		 /*******************************
+		 *	 READ-AHEAD STREAMS	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A read-ahead stream reads a file  as   a  normal  file stream, but asks
+the OS to prefetch  the  next  `window`   bytes  of  the  file  using
+posix_fadvise(POSIX_FADV_WILLNEED).  This  starts  the  disk  I/O
+asynchronously, overlapping it with processing the   data we have, e.g.,
+parsing terms.  The advice is renewed if  less than half the window is
+left.  Seeking restarts the window from the new position.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef HAVE_POSIX_FADVISE
+
+typedef struct readahead_handle
+{ int	    fd;				/* Underlying file */
+  int64_t   here;			/* Offset of the next read */
+  int64_t   ahead;			/* Prefetch was requested upto here */
+  size_t    window;			/* Bytes to prefetch */
+} readahead_handle;
+
+
+static void
+S__readahead(readahead_handle *h)
+{ if ( h->ahead - h->here < (int64_t)(h->window/2) )
+  { int64_t from = (h->ahead > h->here ? h->ahead : h->here);
+
+    h->ahead = h->here + h->window;
+    (void)posix_fadvise(h->fd, (off_t)from, (off_t)(h->ahead - from),
+			POSIX_FADV_WILLNEED);
+  }
+}
+
+
+static ssize_t
+Sread_readahead(void *handle, char *buf, size_t size)
+{ readahead_handle *h = handle;
+  ssize_t bytes = Sread_file((void *)(intptr_t)h->fd, buf, size);
+
+  if ( bytes > 0 )
+  { h->here += bytes;
+    S__readahead(h);
+  }
+
+  return bytes;
+}
+
+
+static int64_t
+Sseek_readahead64(void *handle, int64_t pos, int whence)
+{ readahead_handle *h = handle;
+  int64_t rc;
+
+  if ( whence == SIO_SEEK_CUR && pos == 0 )
+    return h->here;			/* Stell64() */
+
+  if ( (rc = lseek(h->fd, (off_t)pos, whence)) >= 0 )
+  { h->here = h->ahead = rc;
+    S__readahead(h);
+  }
+
+  return rc;
+}
+
+
+static long
+Sseek_readahead(void *handle, long pos, int whence)
+{ return (long)Sseek_readahead64(handle, pos, whence);
+}
+
+
+static int
+Sclose_readahead(void *handle)
+{ readahead_handle *h = handle;
+  int rc = Sclose_file((void *)(intptr_t)h->fd);
+
+  free(h);
+
+  return rc;
+}
+
+
+static int
+Scontrol_readahead(void *handle, int action, void *arg)
+{ readahead_handle *h = handle;
+
+  return Scontrol_file((void *)(intptr_t)h->fd, action, arg);
+}
+
+
+static IOFUNCTIONS Sreadaheadfunctions =
+{ Sread_readahead,
+  NULL,
+  Sseek_readahead,
+  Sclose_readahead,
+  Scontrol_readahead,
+  Sseek_readahead64
+};
+
+#endif /*HAVE_POSIX_FADVISE*/
+
+
+/* Sset_read_ahead() turns a file stream opened for reading into a
+   read-ahead stream that prefetches `window` bytes of the file.  It
+   must be called before the stream is used.  It is ignored if the
+   stream is not a file stream or the OS does not support it.
+*/
+
+int
+Sset_read_ahead(IOSTREAM *s, size_t window)
+{
+#ifdef HAVE_POSIX_FADVISE
+  if ( window > 0 &&
+       s->functions == &Sfilefunctions &&
+       (s->flags & (SIO_INPUT|SIO_FILE)) == (SIO_INPUT|SIO_FILE) )
+  { readahead_handle *h;
+    int fd = (int)(intptr_t)s->handle;
+    off_t here;
+
+    if ( (here = lseek(fd, 0, SEEK_CUR)) < 0 )
+      return 0;				/* not seekable */
+    if ( !(h = malloc(sizeof(*h))) )
+    { errno = ENOMEM;
+      return -1;
+    }
+    h->fd     = fd;
+    h->here   = h->ahead = here;
+    h->window = window;
+    (void)posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    S__readahead(h);
+
+    s->handle    = h;
+    s->functions = &Sreadaheadfunctions;
+    s->flags    &= ~SIO_FILE;
+  }
+#else
+  (void)s;
+  (void)window;
+#endif
+
+  return 0;
+}
+
+
+		 /*******************************
+		 *	    SENDFILE		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Ssendfile() copies up to len bytes (all if   len < 0) from in to out,
+using sendfile() to copy the data  between   the  file  descriptors in
+the kernel. This is only possible if both   are binary streams without
+a filter, tee or timeout, in is a stream  on a regular file and out is
+file descriptor based. Data that is   already  buffered in in is written
+normally. As the data does not pass  through   user  space,  only the
+byte and character counts of the stream positions are updated.
+
+Returns 1 if all data has been copied, 0 if the remainder must be copied
+normally, e.g., because sendfile() is not possible, and -1 on an error.
+*copied is the number of bytes copied.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define SENDFILE_CHUNK (16*1024*1024)	/* handle signals in between */
+
+static int
+S__can_sendfile(IOSTREAM *s)
+{ return ( s->encoding == ENC_OCTET &&
+	   !s->tee && !s->upstream && !s->downstream &&
+	   s->timeout < 0 );
+}
+
+static void
+S__countbytes(IOSTREAM *s, int64_t n)
+{ if ( s->position )
+  { s->position->byteno += n;
+    s->position->charno += n;
+  }
+}
+
+int
+Ssendfile(IOSTREAM *in, IOSTREAM *out, int64_t len, int64_t *copied)
+{
+#ifdef USE_SENDFILE
+  struct stat buf;
+  int ifd, ofd;
+  size_t n, i;
+
+  *copied = 0;
+  if ( !S__can_sendfile(in) || !S__can_sendfile(out) ||
+       !(in->flags & SIO_INPUT) || !(out->flags & SIO_OUTPUT) ||
+       !( in->functions == &Sfilefunctions
+#ifdef HAVE_POSIX_FADVISE
+	  || in->functions == &Sreadaheadfunctions
+#endif
+	) ||
+       (ifd = Sfileno(in)) < 0 || (ofd = Sfileno(out)) < 0 ||
+       fstat(ifd, &buf) != 0 || !S_ISREG(buf.st_mode) )
+    return 0;
+
+  if ( (n = in->limitp - in->bufp) > 0 )  /* buffered input */
+  { if ( len >= 0 && (int64_t)n > len )
+      n = (size_t)len;
+    if ( Sfwrite(in->bufp, 1, n, out) != n )
+      return -1;
+    for(i=0; i<n; i++)
+      S__fupdatefilepos_getc(in, in->bufp[i]&0xff);
+    in->bufp += n;
+    *copied += n;
+    if ( len >= 0 && (len -= n) == 0 )
+      return 1;
+  }
+  if ( Sflush(out) < 0 )
+    return -1;
+
+  while( len != 0 )
+  { size_t chunk = SENDFILE_CHUNK;
+    ssize_t rc;
+
+    if ( len > 0 && len < (int64_t)chunk )
+      chunk = (size_t)len;
+    if ( (rc = sendfile(ofd, ifd, NULL, chunk)) < 0 )
+    { if ( errno == EINTR )
+      { if ( PL_handle_signals() < 0 )
+	{ Sset_exception(out, PL_exception(0));
+	  return -1;
+	}
+	continue;
+      }
+      if ( errno == EINVAL || errno == ENOSYS || errno == EAGAIN )
+	return 0;			/* copy the remainder normally */
+      S__seterror(out);
+      return -1;
+    }
+    if ( rc == 0 )
+      break;				/* end of file */
+
+#ifdef HAVE_POSIX_FADVISE
+    if ( in->functions == &Sreadaheadfunctions )
+    { readahead_handle *h = in->handle;
+
+      h->here += rc;
+      S__readahead(h);
+    }
+#endif
+    S__countbytes(in, rc);
+    S__countbytes(out, rc);
+    ATOMIC_ADD(&S__iototals.bytes_read, rc);
+    ATOMIC_ADD(&S__iototals.bytes_written, rc);
+    *copied += rc;
+    if ( len > 0 )
+      len -= rc;
+    if ( PL_handle_signals() < 0 )
+    { Sset_exception(out, PL_exception(0));
+      return -1;
+    }
+  }
+
+  return 1;
+#else
+  (void)in;
+  (void)out;
+  (void)len;
+  *copied = 0;
+
+  return 0;
+#endif
+}
+
+
 #ifndef O_BINARY
 #define O_BINARY 0
 #endif
@@ -3095,6 +3973,7 @@ after the [rw] argument:
   - "L[rw]" -- use a read or write lock and raise an exception if we
 	       must wait
   - mOOO -- when creating the file, use 0OOO as mode.
+  - "M" -- if possible, map the file into memory (read only)
 
 Note that the low-level open  is  always   binary  as  O_TEXT open files
 result in lost and corrupted data in   some  encodings (UTF-16 is one of
@@ -3114,6 +3993,7 @@ Sopen_file(const char *path, const char *how)
   IOENC enc = ENC_UNKNOWN;
   int wait = TRUE;
   int mode = 0666;
+  int map = FALSE;
 
   for( ; *how; how++)
   { switch(*how)
@@ -3145,6 +4025,9 @@ Sopen_file(const char *path, const char *how)
 	{ errno = EINVAL;
 	  return NULL;
 	}
+      case 'M':				/* memory map */
+	map = TRUE;
+        break;
       default:
 	errno = EINVAL;
         return NULL;
@@ -3234,8 +4117,14 @@ Sopen_file(const char *path, const char *how)
 #endif
   }
 
-  lfd = (intptr_t)fd;
-  s = Snew((void *)lfd, flags, &Sfilefunctions);
+#ifdef HAVE_MMAP
+  if ( !(map && op == 'r' && (s = Sopen_mapped(fd, flags))) )
+#else
+  (void)map;
+#endif
+  { lfd = (intptr_t)fd;
+    s = Snew((void *)lfd, flags, &Sfilefunctions);
+  }
   if ( enc != ENC_UNKNOWN )
     s->encoding = enc;
   if ( lock )
@@ -39,6 +39,13 @@
 
 #include "SWI-Stream.h"
 
+typedef struct io_totals
+{ int64_t	bytes_read;		/* Bytes read by stream devices */
+  int64_t	bytes_written;		/* Bytes written to stream devices */
+} io_totals;
+
+extern io_totals S__iototals;
+
 #ifdef O_PLMT
 #define ATOMIC_ADD(ptr, v)	__atomic_add_fetch(ptr, v, __ATOMIC_SEQ_CST)
 #define ATOMIC_SUB(ptr, v)	__atomic_sub_fetch(ptr, v, __ATOMIC_SEQ_CST)
@@ -255,6 +255,23 @@ htable_copy_kvs(Table ht, KVS old_kvs, KVS new_kvs)
 }
 
 
+/* Make the newest completely filled map the current one.  If the map
+   we copied into is itself being resized, the copy  to its successor may
+   complete before ours, so we must not simply set ht->kvs to our new map:
+   this could move ht->kvs backwards or forward to a map in which entries
+   of an older map still need to be copied.  Enumeration and insertion
+   starting at such a map miss or duplicate entries.
+ */
+
+static void
+htable_advance_kvs(Table ht)
+{ KVS kvs;
+
+  while ( (kvs=ht->kvs)->next && !kvs->next->resizing )
+    COMPARE_AND_SWAP_PTR(&ht->kvs, kvs, kvs->next);
+}
+
+
 static KVS
 htable_resize(Table ht, KVS kvs)
 {
@@ -278,18 +295,17 @@ htable_resize(Table ht, KVS kvs)
 
   new_kvs = htable_alloc_kvs(new_len);
   new_kvs->prev = kvs;
+  new_kvs->resizing = TRUE;
 
   if ( htable_cas_new_kvs(kvs, new_kvs) )
   {
     DEBUG(MSG_HASH_TABLE_KVS,
           Sdprintf("Rehashing table %p to %d entries. kvs: %p -> new_kvs: %p\n", ht, new_len, kvs, new_kvs));
 
-    new_kvs->resizing = TRUE;
     htable_copy_kvs(ht, kvs, new_kvs);
     new_kvs->resizing = FALSE;
 
-    ht->kvs = new_kvs;
-
+    htable_advance_kvs(ht);
     htable_maybe_free_kvs(ht);
   }
   else
@@ -140,36 +140,71 @@ PL_from_stack_text(PL_chars_t *text, int flags)
 }
 
 
-#define INT64_DIGITS 20
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Convert a 64-bit integer to decimal.  We first compute the number of
+digits, such that we can fill the output from the end, and emit two
+digits per division using a table of digit pairs.  i64toa() is used by
+PL_get_text(), write/1 and format/2.  It writes at most 21 bytes
+including the terminating EOS and returns a pointer to the EOS.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static const char digit_pairs[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+static int
+digits10(uint64_t v)
+{ int n = 1;
+
+  for(;;)
+  { if ( v < 10 )    return n;
+    if ( v < 100 )   return n+1;
+    if ( v < 1000 )  return n+2;
+    if ( v < 10000 ) return n+3;
+    v /= 10000;
+    n += 4;
+  }
+}
 
 static char *
 ui64toa(uint64_t val, char *out)
-{ char tmpBuf[INT64_DIGITS + 1];
-  char *ptrOrg = tmpBuf + INT64_DIGITS;
-  char *ptr = ptrOrg;
-  size_t nbDigs;
+{ char *end = out+digits10(val);
+  char *p = end;
 
-  do
-  { int rem = val % 10;
+  while ( val >= 100 )
+  { const char *d = &digit_pairs[(val%100)*2];
 
-    *--ptr = rem + '0';
-    val /= 10;
-  } while ( val );
+    val /= 100;
+    *--p = d[1];
+    *--p = d[0];
+  }
+  if ( val >= 10 )
+  { const char *d = &digit_pairs[val*2];
 
-  nbDigs = ptrOrg - ptr;
-  memcpy(out, ptr, nbDigs);
-  out += nbDigs;
-  *out = '\0';
+    *--p = d[1];
+    *--p = d[0];
+  } else
+  { *--p = (char)('0'+val);
+  }
+  *end = EOS;
 
-  return out;				/* points to the END */
-};
+  return end;				/* points to the END */
+}
 
 
-static char *
+char *
 i64toa(int64_t val, char *out)
 { if ( val < 0 )
   { *out++ = '-';
-    val = -(uint64_t)val;
+    return ui64toa(-(uint64_t)val, out);
   }
 
   return ui64toa((uint64_t)val, out);
@@ -1302,6 +1337,61 @@ PL_text_recode(PL_chars_t *text, IOENC encoding)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+PL_search_text(PL_chars_t *text, size_t from, PL_chars_t *sub)
+
+Returns the offset of the first occurrence  of   sub  in  text at or after
+from or (size_t)-1 if there is no such  occurrence. Candidate positions
+are found by searching for the first character of sub using memchr() for
+ISO Latin-1 texts.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+size_t
+PL_search_text(PL_chars_t *text, size_t from, PL_chars_t *sub)
+{ size_t lt = text->length;
+  size_t ls = sub->length;
+
+  if ( from > lt || ls > lt-from )
+    return (size_t)-1;
+  if ( ls == 0 )
+    return from;
+
+  if ( text->encoding == ENC_ISO_LATIN_1 && sub->encoding == ENC_ISO_LATIN_1 )
+  { const char *s = text->text.t;
+    const char *q = sub->text.t;
+    const char *e = &s[lt-ls];		/* last possible start */
+    const char *p;
+
+    for(p=&s[from]; p <= e && (p=memchr(p, q[0], e-p+1)); p++)
+    { if ( memcmp(p+1, q+1, ls-1) == 0 )
+	return p-s;
+    }
+  } else if ( text->encoding == ENC_WCHAR && sub->encoding == ENC_WCHAR )
+  { const pl_wchar_t *s = text->text.w;
+    const pl_wchar_t *q = sub->text.w;
+    const pl_wchar_t *e = &s[lt-ls];
+    const pl_wchar_t *p;
+
+    for(p=&s[from]; p <= e; p++)
+    { if ( *p == q[0] &&
+	   memcmp(p+1, q+1, (ls-1)*sizeof(pl_wchar_t)) == 0 )
+	return p-s;
+    }
+  } else
+  { int c0 = text_get_char(sub, 0);
+    size_t i;
+
+    for(i=from; i <= lt-ls; i++)
+    { if ( text_get_char(text, i) == c0 &&
+	   PL_cmp_text(text, i, sub, 0, ls) == 0 )
+	return i;
+    }
+  }
+
+  return (size_t)-1;
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 PL_cmp_text(PL_chars_t *t1, size_t o1,
 	    PL_chars_t *t2, size_t o2,
@@ -1330,15 +1420,12 @@ PL_cmp_text(PL_chars_t *t1, size_t o1, PL_chars_t *t2, size_t o2,
     return ifeq;
 
   if ( t1->encoding == ENC_ISO_LATIN_1 && t2->encoding == ENC_ISO_LATIN_1 )
-  { const unsigned char *s = (const unsigned char *)t1->text.t+o1;
-    const unsigned char *q = (const unsigned char *)t2->text.t+o2;
+  { int rc = memcmp(t1->text.t+o1, t2->text.t+o2, l);
 
-    for(; l-- > 0 && *s == *q; s++, q++ )
-      ;
-    if ( l < 0 )
+    if ( rc == 0 )
       return ifeq;
     else
-      return *s > *q ? CMP_GREATER : CMP_LESS;
+      return rc > 0 ? CMP_GREATER : CMP_LESS;
   } else if ( t1->encoding == ENC_WCHAR && t2->encoding == ENC_WCHAR )
   { const pl_wchar_t *s = t1->text.w+o1;
     const pl_wchar_t *q = t2->text.w+o2;
@@ -76,6 +76,7 @@ int	PL_canonicalise_text(PL_chars_t *text);
 
 int	PL_cmp_text(PL_chars_t *t1, size_t o1, PL_chars_t *t2, size_t o2,
 		    size_t len);
+size_t	PL_search_text(PL_chars_t *text, size_t from, PL_chars_t *sub);
 int	PL_concat_text(int n, PL_chars_t **text, PL_chars_t *result);
 
 void	PL_free_text(PL_chars_t *text);
@@ -87,6 +88,7 @@ COMMON(word)		textToString(PL_chars_t *text);
 
 COMMON(IOSTREAM *)	Sopen_text(PL_chars_t *text, const char *mode);
 COMMON(int)		PL_text_recode(PL_chars_t *text, IOENC encoding);
+COMMON(char *)		i64toa(int64_t val, char *out);
 
 					/* pl-fli.c */
 COMMON(int)		get_atom_ptr_text(Atom atom, PL_chars_t *text);
@@ -0,0 +1,421 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pl-incl.h"
+#include "pl-stream.h"
+#include <errno.h>
+#include <zlib.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+This module provides open_zstream/3, which   stacks  a (de)compressing
+stream on top of another stream using  Sset_filter(). Data is compressed
+using zlib in gzip, zlib ("deflate") or raw deflate format.
+
+The filter avoids copying  data  between   the  buffers  of  the two
+streams:
+
+  - When reading, inflate() reads the compressed data directly from
+    the parent's buffer and writes the decompressed data directly into
+    the buffer of the filter stream.
+  - When writing, deflate() reads from the buffer of the filter stream
+    and writes into a block that is allocated once when the stream is
+    created.  This block is as large as the parent's buffer and Sfwrite()
+    passes such full blocks directly to the OS.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef enum
+{ Z_FORMAT_GZIP = 0,
+  Z_FORMAT_DEFLATE,
+  Z_FORMAT_RAW_DEFLATE
+} zformat;
+
+typedef struct zstream
+{ IOSTREAM     *parent;			/* Stream we (de)compress */
+  IOSTREAM     *stream;			/* Our stream */
+  z_stream	zs;			/* zlib state */
+  zformat	format;			/* Data format */
+  Bytef	       *out;			/* Output block (compressing) */
+  size_t	out_size;		/* Size of the output block */
+  unsigned	close_parent : 1;	/* Close parent on close */
+  unsigned	multi_part : 1;		/* Decompress concatenated data */
+  unsigned	end : 1;		/* Saw end of compressed data */
+  unsigned	input : 1;		/* Decompressing */
+} zstream;
+
+
+static int
+zerror(zstream *z, int rc)
+{ const char *msg = z->zs.msg;
+
+  if ( !msg )
+  { switch(rc)
+    { case Z_MEM_ERROR:
+	msg = "Not enough memory";
+	break;
+      case Z_DATA_ERROR:
+	msg = "Corrupt compressed data";
+	break;
+      default:
+	msg = "Compression error";
+    }
+  }
+  Sseterr(z->stream, SIO_FERR, msg);
+  errno = EIO;
+
+  return -1;
+}
+
+
+		 /*******************************
+		 *	     READING		*
+		 *******************************/
+
+/* zfill() makes the parent's buffer hold unread data.  Returns 1 if
+   there is data, 0 on end of file and -1 on error.
+*/
+
+static int
+zfill(zstream *z)
+{ IOSTREAM *p = z->parent;
+
+  if ( p->bufp < p->limitp )
+    return 1;
+  if ( S__fillbuf(p) == -1 )
+  { if ( Sferror(p) )
+    { Sseterr(z->stream, SIO_FERR, NULL);
+      return -1;
+    }
+    return 0;
+  }
+  p->bufp--;				/* S__fillbuf() returned a byte */
+
+  return 1;
+}
+
+
+static ssize_t
+Sread_zstream(void *handle, char *buf, size_t size)
+{ zstream *z = handle;
+  IOSTREAM *p = z->parent;
+
+  z->zs.next_out  = (Bytef*)buf;
+  z->zs.avail_out = (uInt)(size > UINT_MAX ? UINT_MAX : size);
+
+  while( z->zs.next_out == (Bytef*)buf )
+  { int rc;
+
+    if ( z->end )
+    { if ( !z->multi_part )
+	return 0;
+      if ( (rc=zfill(z)) <= 0 )
+	return rc;
+      if ( (rc=inflateReset(&z->zs)) != Z_OK )
+	return zerror(z, rc);
+      z->end = FALSE;
+    }
+
+    if ( (rc=zfill(z)) < 0 )
+      return -1;
+    if ( rc == 0 )
+    { Sseterr(z->stream, SIO_FERR, "Unexpected end of compressed data");
+      errno = EIO;
+      return -1;
+    }
+
+    z->zs.next_in  = (Bytef*)p->bufp;
+    z->zs.avail_in = (uInt)(p->limitp - p->bufp);
+    rc = inflate(&z->zs, Z_NO_FLUSH);
+    p->bufp = (char*)z->zs.next_in;
+    z->zs.avail_in = 0;
+
+    switch(rc)
+    { case Z_OK:
+	break;
+      case Z_STREAM_END:
+	z->end = TRUE;
+	break;
+      case Z_BUF_ERROR:			/* needs more input */
+	break;
+      default:
+	return zerror(z, rc);
+    }
+  }
+
+  return (char*)z->zs.next_out - buf;
+}
+
+
+		 /*******************************
+		 *	     WRITING		*
+		 *******************************/
+
+/* zdeflate() compresses the pending input, writing full blocks to the
+   parent.
+*/
+
+static int
+zdeflate(zstream *z, int flush)
+{ int rc;
+
+  do
+  { size_t n;
+
+    z->zs.next_out  = z->out;
+    z->zs.avail_out = (uInt)z->out_size;
+    rc = deflate(&z->zs, flush);
+    if ( rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR )
+      return zerror(z, rc);
+    n = z->out_size - z->zs.avail_out;
+    if ( n > 0 && Sfwrite(z->out, 1, n, z->parent) != n )
+    { Sseterr(z->stream, SIO_FERR, NULL);
+      return -1;
+    }
+  } while ( z->zs.avail_out == 0 ||
+	    (flush == Z_FINISH && rc != Z_STREAM_END) );
+
+  return 0;
+}
+
+
+static ssize_t
+Swrite_zstream(void *handle, char *buf, size_t size)
+{ zstream *z = handle;
+
+  z->zs.next_in  = (Bytef*)buf;
+  z->zs.avail_in = (uInt)size;
+  if ( zdeflate(z, Z_NO_FLUSH) < 0 )
+    return -1;
+
+  return size;
+}
+
+
+		 /*******************************
+		 *	   CLOSE/CONTROL	*
+		 *******************************/
+
+static int
+Sclose_zstream(void *handle)
+{ zstream *z = handle;
+  IOSTREAM *parent = z->parent;
+  int rc = 0;
+
+  if ( z->input )
+  { inflateEnd(&z->zs);
+  } else
+  { z->zs.next_in  = NULL;
+    z->zs.avail_in = 0;
+    rc = zdeflate(z, Z_FINISH);
+    deflateEnd(&z->zs);
+    if ( Sflush(parent) < 0 )
+      rc = -1;
+  }
+
+  Sset_filter(parent, NULL);
+  if ( z->close_parent )
+  { if ( Sclose(parent) < 0 )
+      rc = -1;
+  }
+  if ( z->out )
+    free(z->out);
+  free(z);
+
+  return rc;
+}
+
+
+static int
+Scontrol_zstream(void *handle, int action, void *arg)
+{ zstream *z = handle;
+
+  switch(action)
+  { case SIO_FLUSHOUTPUT:
+      if ( !z->input )
+      { z->zs.next_in  = NULL;
+	z->zs.avail_in = 0;
+	if ( zdeflate(z, Z_SYNC_FLUSH) < 0 )
+	  return -1;
+	return Sflush(z->parent);
+      }
+      return 0;
+    case SIO_SETENCODING:
+      return 0;
+    default:
+      return -1;
+  }
+}
+
+
+static IOFUNCTIONS Szstreamfunctions =
+{ Sread_zstream,
+  Swrite_zstream,
+  NULL,					/* seek */
+  Sclose_zstream,
+  Scontrol_zstream,
+  NULL					/* seek64 */
+};
+
+
+		 /*******************************
+		 *	      OPEN		*
+		 *******************************/
+
+static int
+window_bits(zformat format, int input)
+{ switch(format)
+  { case Z_FORMAT_GZIP:
+      return input ? 15+32 : 15+16;	/* input: detect gzip or zlib */
+    case Z_FORMAT_DEFLATE:
+      return input ? 15+32 : 15;
+    case Z_FORMAT_RAW_DEFLATE:
+    default:
+      return -15;
+  }
+}
+
+
+static const opt_spec zopen3_options[] =
+{ { ATOM_format,	 OPT_ATOM },
+  { ATOM_level,		 OPT_INT },
+  { ATOM_close_parent,	 OPT_BOOL },
+  { ATOM_multi_part,	 OPT_BOOL },
+  { NULL_ATOM,		 0 }
+};
+
+/** open_zstream(+Stream, -ZStream, +Options)
+*/
+
+static
+PRED_IMPL("open_zstream", 3, open_zstream, 0)
+{ PRED_LD
+  atom_t format    = ATOM_gzip;
+  int level        = Z_DEFAULT_COMPRESSION;
+  int close_parent = TRUE;
+  int multi_part   = TRUE;
+  IOSTREAM *parent, *s;
+  zstream *z;
+  int flags, rc;
+
+  if ( !scan_options(A3, 0, ATOM_stream_option, zopen3_options,
+		     &format, &level, &close_parent, &multi_part) )
+    return FALSE;
+  if ( level != Z_DEFAULT_COMPRESSION && (level < 0 || level > 9) )
+  { term_t t = PL_new_term_ref();
+
+    return ( PL_put_integer(t, level) &&
+	     PL_domain_error("compression_level", t) );
+  }
+  if ( format != ATOM_gzip && format != ATOM_deflate &&
+       format != ATOM_raw_deflate )
+  { term_t t = PL_new_term_ref();
+
+    PL_put_atom(t, format);
+    return PL_domain_error("compression_format", t);
+  }
+
+  if ( !PL_get_stream(A1, &parent, 0) )
+    return FALSE;
+  if ( parent->upstream )
+  { PL_release_stream(parent);
+    return PL_permission_error("open_zstream", "stream", A1);
+  }
+
+  if ( !(z = calloc(1, sizeof(*z))) )
+  { PL_release_stream(parent);
+    return PL_no_memory();
+  }
+  z->parent       = parent;
+  z->format       = ( format == ATOM_gzip    ? Z_FORMAT_GZIP :
+		      format == ATOM_deflate ? Z_FORMAT_DEFLATE :
+					       Z_FORMAT_RAW_DEFLATE );
+  z->close_parent = close_parent;
+  z->multi_part   = multi_part;
+  z->input        = (parent->flags & SIO_INPUT) != 0;
+
+  if ( z->input )
+  { rc = inflateInit2(&z->zs, window_bits(z->format, TRUE));
+    flags = SIO_INPUT;
+  } else
+  { z->out_size = (parent->bufsize > 0 ? parent->bufsize : SIO_BUFSIZE);
+    if ( !(z->out = malloc(z->out_size)) )
+    { free(z);
+      PL_release_stream(parent);
+      return PL_no_memory();
+    }
+    rc = deflateInit2(&z->zs, level, Z_DEFLATED,
+		      window_bits(z->format, FALSE), 8, Z_DEFAULT_STRATEGY);
+    flags = SIO_OUTPUT;
+  }
+  if ( rc != Z_OK )
+  { if ( z->out )
+      free(z->out);
+    free(z);
+    PL_release_stream(parent);
+    return PL_resource_error("memory");
+  }
+
+  flags |= SIO_FBUF|SIO_RECORDPOS|(parent->flags & SIO_TEXT);
+  if ( !(s = Snew(z, flags, &Szstreamfunctions)) )
+  { if ( z->input )
+      inflateEnd(&z->zs);
+    else
+      deflateEnd(&z->zs);
+    if ( z->out )
+      free(z->out);
+    free(z);
+    PL_release_stream(parent);
+    return PL_no_memory();
+  }
+  z->stream   = s;
+  s->encoding = parent->encoding;
+  s->newline  = parent->newline;
+  Sset_filter(parent, s);
+  PL_release_stream(parent);
+
+  if ( PL_unify_stream(A2, s) )
+    return TRUE;
+
+  z->close_parent = FALSE;
+  Sclose(s);
+  return FALSE;
+}
+
+
+		 /*******************************
+		 *      PUBLISH PREDICATES	*
+		 *******************************/
+
+BeginPredDefs(zstream)
+  PRED_DEF("open_zstream", 3, open_zstream, 0)
+EndPredDefs
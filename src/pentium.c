@@ -41,7 +41,12 @@ ticks prof_ticks;
 
 static ticks overhead;
 
-/* See http://www.technovelty.org/code/c/reading-rdtsc.html */
+/* See http://www.technovelty.org/code/c/reading-rdtsc.html.  On other
+   CPUs we use a nanosecond clock, which makes a tick a nano second.
+*/
+
+#if defined(__i386__) || defined(__x86_64__)
+#define HAVE_RDTSC 1
 
 ticks
 pentium_clock()
@@ -55,7 +60,26 @@ pentium_clock()
   return (ticks)iax | ((ticks)idx<<32);
 }
 
+#else
 
+ticks
+pentium_clock()
+{ struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (ticks)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+#endif
+
+
+#ifndef HAVE_RDTSC
+static double
+CPU_MHz()
+{ return 1000.0;			/* ticks are nano seconds */
+}
+#else
 static double
 CPU_MHz()
 { static double mhz = 1400.00;
@@ -81,6 +105,7 @@ CPU_MHz()
 
   return mhz;
 }
+#endif /*HAVE_RDTSC*/
 
 
 static int
@@ -103,8 +128,8 @@ prof_report_field(prof_record *pr)
     double av  = (double)(pr->ticks/pr->calls-overhead)/CPU_MHz();
     double tot = av*(double)pr->calls;
 
-    printf("%9d %10.3f %10.3f %20.3f %s\n",
-	   pr->calls, f, av, tot, pr->name);
+    printf("%9lld %10.3f %10.3f %20.3f %s\n",
+	   (long long)pr->calls, f, av, tot, pr->name);
   }
   memset(pr, 0, sizeof(*pr));
 }
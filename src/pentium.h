@@ -40,13 +40,13 @@ typedef int64_t ticks;
 typedef struct
 { ticks ticks;				/* time spent */
   ticks fastest;			/* fastest call */
-  int	calls;				/* # calls */
+  int64_t calls;			/* # calls */
   char *name;				/* id name */
 } prof_record;
 
 extern ticks		pentium_clock(void);
 extern void		prof_report(void);
-extern void		reset_profile();
+extern void		prof_reset(void);
 extern prof_record	prof_data[];
 extern prof_record     *prof_current;
 extern ticks		prof_ticks;
@@ -87,8 +87,8 @@ extern ticks		prof_ticks;
 
 #define DEPART_CONTINUE 	(I_HIGHEST+1)
 #define P_GC 			(I_HIGHEST+2)
-+#define P_SHALLOW_BACKTRACK    (I_HIGHEST+3)
-+#define P_DEEP_BACKTRACK       (I_HIGHEST+4)
+#define P_SHALLOW_BACKTRACK	(I_HIGHEST+3)
+#define P_DEEP_BACKTRACK	(I_HIGHEST+4)
 
 #else /*O_PROF_PENTIUM*/
 
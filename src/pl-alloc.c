@@ -50,6 +50,15 @@
 #endif
 #endif
 #endif
+#if defined(__linux__) && defined(HAVE_SYS_SYSCALL_H) && defined(MMAP_STACK)
+#include <sys/syscall.h>
+#if defined(SYS_mbind) && defined(SYS_sched_getaffinity)
+#define O_NUMA_STACKS 1
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+#endif
+#endif
 
 #undef LD
 #define LD LOCAL_LD
@@ -59,6 +68,20 @@
 #define ALLOC_NEW_MAGIC  0xF9
 #endif
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Maintain the per-thread statistics key  heap_allocated. This counts the
+bytes requested through allocHeap() and   PL_malloc()  by the calling
+thread.  Memory freed is not subtracted.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static inline void
+count_heap_allocation(size_t n)
+{ PL_local_data_t *ld = GLOBAL_LD;
+
+  if ( ld )
+    ld->statistics.heap_allocated += n;
+}
+
 
 		 /*******************************
 		 *	    USE BOEHM GC	*
@@ -72,6 +95,8 @@ void *
 allocHeap(size_t n)
 { void *mem = GC_MALLOC(n);
 
+  count_heap_allocation(n);
+
 #if ALLOC_DEBUG
   if ( mem )
     memset(mem, ALLOC_NEW_MAGIC, n);
@@ -158,6 +183,8 @@ void *
 allocHeap(size_t n)
 { void *mem = malloc(n);
 
+  count_heap_allocation(n);
+
 #if ALLOC_DEBUG
   if ( mem )
     memset((char *) mem, ALLOC_NEW_MAGIC, n);
@@ -202,12 +229,13 @@ freeHeap(void *mem, size_t n)
 		 *******************************/
 
 void
-linger(linger_list** list, void (*unalloc)(void *), void *object)
+linger(linger_list** list, void (*unalloc)(void *), void *object, size_t size)
 { linger_list *c = allocHeapOrHalt(sizeof(*c));
   linger_list *o;
 
   c->generation	= global_generation();
   c->object	= object;
+  c->size	= size;
   c->unalloc	= unalloc;
 
   do
@@ -235,6 +263,20 @@ free_lingering(linger_list **list, gen_t generation)
   }
 }
 
+/* sizeof_lingering() returns the memory held by a linger list.  As the
+   list may be modified concurrently, the result is an estimate.
+*/
+
+size_t
+sizeof_lingering(linger_list *list)
+{ size_t size = 0;
+
+  for(; list; list = list->next)
+    size += sizeof(*list) + list->size;
+
+  return size;
+}
+
 		/********************************
 		*             STACKS            *
 		*********************************/
@@ -883,6 +925,284 @@ put_int64(Word at, int64_t l, int flags ARG_LD)
 }
 
 
+		 /*******************************
+		 *	 LARGE OBJECT SPACE	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Indirect data (strings and GMP numbers) of  at least LARGE_INDIRECT bytes
+is not stored on the global stack, but   in  a malloc()ed block that is
+linked into LD->gc.large.objects.  The block holds the indirect exactly
+as it appears on the stack (header, data, header) and the cell that
+references it uses storage STG_LARGE.   As  base_addresses[STG_LARGE] is
+0, valPtr() and thus addressIndirect() and valIndirectP() work unchanged.
+
+The garbage collector marks the blocks it reaches (markLargeIndirect()),
+but never moves them, so large  texts  do   not  add  to the copy volume
+of the compaction phase.  Unmarked blocks are freed after the mark phase
+by sweepLargeIndirects().  As large objects   do  not show up in global
+stack usage, allocLargeIndirect() requests  a  GC   if  a  lot of large
+object data was allocated since the  last   GC.  The total size of large
+objects is limited by the stack_limit; if   the limit is reached we use
+the global stack, such that we get a normal stack overflow.
+
+Large objects are owned by a single thread and their lifetime is decided
+by the mark phase only:  there  is  no   reference  count  and  no
+copy-on-write.  Copying a term  to  another   stack,  a  record or a
+message queue copies the data, just as   for  an indirect on the global
+stack.  Only the location of the   indirect  changes; unification, term
+comparison, records and saved states see the same representation.
+
+Tagged pointers lose their 5 high bits, so we only use this on 64-bit
+systems.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#if SIZEOF_VOIDP == 8
+#define O_LARGE_INDIRECT 1
+#endif
+#define LARGE_INDIRECT	(64*1024)	/* min size in bytes */
+#define LARGE_GC_MIN	(16*1024*1024)	/* min allocated bytes to request GC */
+
+typedef struct large_indirect
+{ struct large_indirect *next;		/* next in LD->gc.large.objects */
+  struct large_indirect *next_interned;	/* next in intern bucket */
+  size_t	size;			/* allocated size in bytes */
+  word		key;			/* cached index key (or 0) */
+  int		marked;			/* reached by GC */
+  int		interned;		/* in LD->gc.large.interned */
+  word		data[1];		/* the indirect */
+} large_indirect;
+
+#define LARGE_HDR_SIZE offsetof(large_indirect, data)
+#define largeIndirect(p) ((large_indirect*)((char*)(p) - LARGE_HDR_SIZE))
+
+static large_indirect *
+alloc_large_indirect(size_t n ARG_LD)
+{ size_t bytes = LARGE_HDR_SIZE + n*sizeof(word);
+  large_indirect *o;
+
+  if ( LD->gc.large.size + bytes > LD->stacks.limit ||
+       !(o = malloc(bytes)) )
+    return NULL;
+
+  o->size	   = bytes;
+  o->key	   = 0;
+  o->marked	   = FALSE;
+  o->interned	   = FALSE;
+  o->next_interned = NULL;
+  o->next	   = LD->gc.large.objects;
+  LD->gc.large.objects    = o;
+  LD->gc.large.size      += bytes;
+  LD->gc.large.allocated += bytes;
+
+  if ( LD->gc.large.allocated > LARGE_GC_MIN &&
+       LD->gc.large.allocated > LD->gc.large.size/2 &&
+       truePrologFlag(PLFLAG_GC) && !PL_pending(SIG_GC) )
+  { LD->gc.stats.request = GC_GLOBAL_REQUEST;
+    PL_raise(SIG_GC);
+  }
+
+  return o;
+}
+
+
+/* allocLargeIndirect() allocates n words for an indirect in the large
+   object space.  Returns NULL if the object is too small or there is no
+   space, in which case the caller must use the global stack.
+*/
+
+Word
+allocLargeIndirect(size_t n ARG_LD)
+{
+#ifdef O_LARGE_INDIRECT
+  large_indirect *o;
+
+  if ( n*sizeof(word) >= LARGE_INDIRECT &&
+       (o = alloc_large_indirect(n PASS_LD)) )
+    return o->data;
+#else
+  (void)n;
+#endif
+
+  return NULL;
+}
+
+
+void
+markLargeIndirect(word w ARG_LD)
+{ largeIndirect(valPtr2(w, STG_LARGE))->marked = TRUE;
+}
+
+
+/* largeIndirectKey() returns the clause index key for a large indirect.
+   The key is computed once and cached with the object.
+*/
+
+word
+largeIndirectKey(word w ARG_LD)
+{ large_indirect *o = largeIndirect(valPtr2(w, STG_LARGE));
+
+  if ( !o->key )
+    o->key = indirectIndexKey(o->data);
+
+  return o->key;
+}
+
+
+static void unintern_large_indirect(large_indirect *o ARG_LD);
+
+void
+sweepLargeIndirects(ARG1_LD)
+{ large_indirect **pp = &LD->gc.large.objects;
+  large_indirect *o;
+
+  while( (o = *pp) )
+  { if ( o->marked )
+    { o->marked = FALSE;
+      pp = &o->next;
+    } else
+    { *pp = o->next;
+      if ( o->interned )
+	unintern_large_indirect(o PASS_LD);
+      LD->gc.large.size -= o->size;
+      free(o);
+    }
+  }
+
+  LD->gc.large.allocated = 0;
+}
+
+
+void
+freeLargeIndirects(ARG1_LD)
+{ large_indirect *o, *next;
+
+  for(o = LD->gc.large.objects; o; o = next)
+  { next = o->next;
+    free(o);
+  }
+
+  if ( LD->gc.large.interned )
+  { free(LD->gc.large.interned);
+    LD->gc.large.interned = NULL;
+  }
+  LD->gc.large.interned_buckets = 0;
+  LD->gc.large.interned_count   = 0;
+  LD->gc.large.objects   = NULL;
+  LD->gc.large.size      = 0;
+  LD->gc.large.allocated = 0;
+}
+
+
+		 /*******************************
+		 *	  INTERNED STRINGS	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+internString() returns a reference to  the   interned  version  of the
+string w.  Interned strings are large   objects  (see above) regardless
+of their size, which are in addition  registered in a per-thread hash
+table keyed by their index key.  All  interned   copies  of  a text thus
+share the same data, such that comparing   them  reduces to comparing
+the references and their clause index key  is computed only once.  The
+strings remain normal strings for all  other   purposes.  Like any large
+object they are reclaimed by the  garbage   collector  when no longer
+referenced, which also removes them from the table.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+unintern_large_indirect(large_indirect *o ARG_LD)
+{ large_indirect **pp;
+
+  pp = &LD->gc.large.interned[o->key & (LD->gc.large.interned_buckets-1)];
+  for( ; *pp; pp = &(*pp)->next_interned )
+  { if ( *pp == o )
+    { *pp = o->next_interned;
+      LD->gc.large.interned_count--;
+      return;
+    }
+  }
+
+  assert(0);
+}
+
+
+static int
+rehash_interned(ARG1_LD)
+{ size_t obuckets = LD->gc.large.interned_buckets;
+  size_t nbuckets = obuckets ? obuckets*2 : 256;
+  large_indirect **ntable = calloc(nbuckets, sizeof(*ntable));
+  size_t i;
+
+  if ( !ntable )
+    return FALSE;
+
+  for(i=0; i<obuckets; i++)
+  { large_indirect *o, *next;
+
+    for(o = LD->gc.large.interned[i]; o; o = next)
+    { large_indirect **bp = &ntable[o->key & (nbuckets-1)];
+
+      next = o->next_interned;
+      o->next_interned = *bp;
+      *bp = o;
+    }
+  }
+
+  free(LD->gc.large.interned);
+  LD->gc.large.interned	= ntable;
+  LD->gc.large.interned_buckets = nbuckets;
+
+  return TRUE;
+}
+
+
+word
+internString(word w ARG_LD)
+{
+#ifdef O_LARGE_INDIRECT
+  Word p = addressIndirect(w);
+  size_t n = wsizeofInd(*p);
+  word key;
+  large_indirect *o;
+
+  if ( storage(w) == STG_LARGE && largeIndirect(p)->interned )
+    return w;
+
+  key = indirectIndexKey(p);
+  if ( LD->gc.large.interned_buckets )
+  { for(o = LD->gc.large.interned[key & (LD->gc.large.interned_buckets-1)];
+	o;
+	o = o->next_interned)
+    { if ( o->key == key && o->data[0] == p[0] &&
+	   memcmp(&o->data[1], &p[1], n*sizeof(word)) == 0 )
+	return consPtr(o->data, TAG_STRING|STG_LARGE);
+    }
+  }
+
+  if ( LD->gc.large.interned_count >= LD->gc.large.interned_buckets &&
+       !rehash_interned(PASS_LD1) )
+    return 0;
+  if ( !(o = alloc_large_indirect(n+2 PASS_LD)) )
+    return 0;
+
+  memcpy(o->data, p, (n+2)*sizeof(word));
+  o->key	   = key;
+  o->interned	   = TRUE;
+  { large_indirect **bp =
+	&LD->gc.large.interned[key & (LD->gc.large.interned_buckets-1)];
+    o->next_interned = *bp;
+    *bp = o;
+  }
+  LD->gc.large.interned_count++;
+
+  return consPtr(o->data, TAG_STRING|STG_LARGE);
+#else
+  return w;
+#endif
+}
+
+
 		 /*******************************
 		 *    OPERATIONS ON STRINGS	*
 		 *******************************/
@@ -893,17 +1213,27 @@ To distinguish between byte and wide strings,   the system adds a 'B' or
 ignored to avoid alignment restriction problems.
 
 Note that these functions can trigger GC
+
+allocString() allocates on the global stack.   If stg is non-NULL, large
+strings are allocated in the large object  space and *stg is set to the
+storage to use for the reference.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-Word
-allocString(size_t len ARG_LD)
+static Word
+allocStringStg(size_t len, int *stg ARG_LD)
 { size_t lw = (len+sizeof(word))/sizeof(word);
   int pad = (int)(lw*sizeof(word) - len);
-  Word p = allocGlobal(2 + lw);
   word m = mkStrHdr(lw, pad);
+  Word p;
 
-  if ( !p )
-    return NULL;
+  if ( stg && (p = allocLargeIndirect(2 + lw PASS_LD)) )
+  { *stg = STG_LARGE;
+  } else
+  { if ( !(p = allocGlobal(2 + lw)) )
+      return NULL;
+    if ( stg )
+      *stg = STG_GLOBAL;
+  }
 
   p[0]    = m;
   p[lw]   = 0L;				/* zero the pad bytes */
@@ -913,10 +1243,17 @@ allocString(size_t len ARG_LD)
 }
 
 
+Word
+allocString(size_t len ARG_LD)
+{ return allocStringStg(len, NULL PASS_LD);
+}
+
+
 word
 globalString(size_t len, const char *s)
 { GET_LD
-  Word p = allocString(len+1 PASS_LD);
+  int stg;
+  Word p = allocStringStg(len+1, &stg PASS_LD);
 
   if ( p )
   { char *q = (char *)&p[1];
@@ -924,7 +1261,7 @@ globalString(size_t len, const char *s)
     *q++ = 'B';
     memcpy(q, s, len);
 
-    return consPtr(p, TAG_STRING|STG_GLOBAL);
+    return consPtr(p, TAG_STRING|stg);
   }
 
   return 0;
@@ -937,6 +1274,7 @@ globalWString(size_t len, const pl_wchar_t *s)
   const pl_wchar_t *e = &s[len];
   const pl_wchar_t *p;
   Word g;
+  int stg;
 
   for(p=s; p<e; p++)
   { if ( *p > 0xff )
@@ -946,7 +1284,7 @@ globalWString(size_t len, const pl_wchar_t *s)
   if ( p == e )				/* 8-bit string */
   { unsigned char *t;
 
-    if ( !(g = allocString(len+1 PASS_LD)) )
+    if ( !(g = allocStringStg(len+1, &stg PASS_LD)) )
       return 0;
     t = (unsigned char *)&g[1];
     *t++ = 'B';
@@ -956,7 +1294,7 @@ globalWString(size_t len, const pl_wchar_t *s)
   { char *t;
     pl_wchar_t *w;
 
-    if ( !(g = allocString((len+1)*sizeof(pl_wchar_t) PASS_LD)) )
+    if ( !(g = allocStringStg((len+1)*sizeof(pl_wchar_t), &stg PASS_LD)) )
       return 0;
     t = (char *)&g[1];
     w = (pl_wchar_t*)t;
@@ -965,7 +1303,7 @@ globalWString(size_t len, const pl_wchar_t *s)
     memcpy(&w[1], s, len*sizeof(pl_wchar_t));
   }
 
-  return consPtr(g, TAG_STRING|STG_GLOBAL);
+  return consPtr(g, TAG_STRING|stg);
 }
 
 
@@ -1086,6 +1424,8 @@ equalIndirect(word w1, word w2)
   Word p1 = addressIndirect(w1);
   Word p2 = addressIndirect(w2);
 
+  if ( p1 == p2 )			/* shared, e.g., interned strings */
+    succeed;
   if ( *p1 == *p2 )
   { size_t n = wsizeofInd(*p1);
 
@@ -1113,10 +1453,16 @@ globalIndirectFromCode(Code *PC)
   Code pc = *PC;
   word m = *pc++;
   size_t n = wsizeofInd(m);
-  Word p = allocGlobal(n+2);
+  int stg = STG_LARGE;
+  Word p;
+
+  if ( !(p = allocLargeIndirect(n+2 PASS_LD)) )
+  { p = allocGlobal(n+2);
+    stg = STG_GLOBAL;
+  }
 
   if ( p )
-  { word r = consPtr(p, tag(m)|STG_GLOBAL);
+  { word r = consPtr(p, tag(m)|stg);
 
     *p++ = m;
     while(n-- > 0)
@@ -1204,6 +1550,7 @@ void *
 PL_malloc(size_t size)
 { void *mem;
 
+  count_heap_allocation(size);
   if ( (mem = GC_MALLOC(size)) )
     return mem;
 
@@ -1217,6 +1564,7 @@ void *
 PL_malloc_atomic(size_t size)
 { void *mem;
 
+  count_heap_allocation(size);
   if ( (mem = GC_MALLOC_ATOMIC(size)) )
     return mem;
 
@@ -1230,6 +1578,7 @@ void *
 PL_malloc_uncollectable(size_t size)
 { void *mem;
 
+  count_heap_allocation(size);
   if ( (mem = GC_MALLOC_UNCOLLECTABLE(size)) )
     return mem;
 
@@ -1243,6 +1592,7 @@ void *
 PL_malloc_atomic_uncollectable(size_t size)
 { void *mem;
 
+  count_heap_allocation(size);
   if ( (mem = GC_MALLOC_ATOMIC_UNCOLLECTABLE(size)) )
     return mem;
 
@@ -1256,6 +1606,7 @@ void *
 PL_malloc_unmanaged(size_t size)
 { void *mem;
 
+  count_heap_allocation(size);
   if ( (mem = GC_MALLOC(size)) )
   {
 #if defined(HAVE_BOEHM_GC) && defined(GC_FLAG_UNCOLLECTABLE)
@@ -1425,6 +1776,117 @@ roundpgsize(size_t sz)
   return ((sz+r-1)/r)*r;
 }
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Placement of the Prolog stacks. If   the  flag stack_huge_pages is set,
+we ask the kernel to  back  large   stack  regions  with transparent huge
+pages. If stack_numa_bind is set, we bind   the  pages of a new stack
+region to the NUMA nodes of the  CPUs   on  which the calling thread is
+allowed to run (see the affinity  option   of  thread_create/3).  As the
+stacks are allocated and resized  by  the   thread  that  owns them, the
+memory ends up on the node where this thread runs.
+
+This advice is given before the region  is   touched  and is thus also
+applied when a stack is moved to a larger region.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define HUGE_PAGE_SIZE (2*1024*1024)
+
+#ifdef O_NUMA_STACKS
+#define MAX_NUMA_NODES 64
+#define MAX_NUMA_CPUS  1024
+#define ULONG_BITS     (sizeof(unsigned long)*8)
+
+static int *cpu_nodes;			/* CPU --> NUMA node */
+static int  numa_nodes;			/* # NUMA nodes */
+
+static void
+parse_cpulist(const char *s, int node, int *map)
+{ while ( *s )
+  { char *e;
+    long f = strtol(s, &e, 10), t = f;
+
+    if ( e == s )
+      break;
+    if ( *e == '-' )
+      t = strtol(e+1, &e, 10);
+    for(; f <= t; f++)
+    { if ( f >= 0 && f < MAX_NUMA_CPUS )
+	map[f] = node;
+    }
+    s = (*e == ',' ? e+1 : e);
+  }
+}
+
+static int
+init_cpu_nodes(void)
+{ if ( !cpu_nodes )
+  { int *map = malloc(sizeof(int)*MAX_NUMA_CPUS);
+    int node, nodes = 0;
+
+    if ( !map )
+      return FALSE;
+    memset(map, 0, sizeof(int)*MAX_NUMA_CPUS);
+
+    for(node=0; node<MAX_NUMA_NODES; node++)
+    { char fn[MAXPATHLEN];
+      char buf[1024];
+      FILE *fd;
+
+      Ssprintf(fn, "/sys/devices/system/node/node%d/cpulist", node);
+      if ( (fd=fopen(fn, "r")) )
+      { if ( fgets(buf, sizeof(buf), fd) )
+	  parse_cpulist(buf, node, map);
+	fclose(fd);
+	nodes = node+1;
+      }
+    }
+
+    numa_nodes = nodes;
+    if ( !COMPARE_AND_SWAP_PTR(&cpu_nodes, NULL, map) )
+      free(map);
+  }
+
+  return TRUE;
+}
+
+static void
+numa_bind_region(void *addr, size_t len)
+{ unsigned long set[MAX_NUMA_CPUS/ULONG_BITS];
+  unsigned long mask = 0;
+  long bytes;
+  int cpu;
+
+  if ( !init_cpu_nodes() || numa_nodes < 2 ||
+       (bytes=syscall(SYS_sched_getaffinity, 0, sizeof(set), set)) <= 0 )
+    return;
+
+  for(cpu=0; cpu < bytes*8; cpu++)
+  { if ( (set[cpu/ULONG_BITS] & (1UL<<(cpu%ULONG_BITS))) )
+      mask |= 1UL<<cpu_nodes[cpu];
+  }
+
+  if ( mask && mask != (1UL<<numa_nodes)-1 )
+    syscall(SYS_mbind, addr, len, MPOL_BIND, &mask,
+	    (unsigned long)numa_nodes+1, 0);
+}
+#endif /*O_NUMA_STACKS*/
+
+static void
+advise_stack_region(void *addr, size_t len)
+{
+#ifdef MADV_HUGEPAGE
+  if ( GD->options.stackHugePages && len >= HUGE_PAGE_SIZE )
+    madvise(addr, len, MADV_HUGEPAGE);
+#endif
+#ifdef O_NUMA_STACKS
+  if ( GD->options.stackNumaBind )
+    numa_bind_region(addr, len);
+#endif
+  (void)addr;
+  (void)len;
+}
+
+
 size_t
 tmp_nalloc(size_t req)
 { if ( req < MMAP_THRESHOLD-SA_OFFSET )
@@ -1458,8 +1920,8 @@ tmp_malloc_size(void *mem)
   return 0;
 }
 
-void *
-tmp_malloc(size_t req)
+static void *
+tmp_malloc_region(size_t req, int stack)
 { map_region *reg;
   int mmapped;
 
@@ -1476,6 +1938,8 @@ tmp_malloc(size_t req)
 	       -1, 0);
     if ( reg == MAP_FAILED )
       reg = NULL;
+    else if ( stack )
+      advise_stack_region(reg, req);
     mmapped = TRUE;
   }
 
@@ -1494,7 +1958,13 @@ tmp_malloc(size_t req)
 
 
 void *
-tmp_realloc(void *mem, size_t req)
+tmp_malloc(size_t req)
+{ return tmp_malloc_region(req, FALSE);
+}
+
+
+static void *
+tmp_realloc_region(void *mem, size_t req, int stack)
 { if ( mem )
   { map_region *reg = (map_region *)((char*)mem-SA_OFFSET);
 
@@ -1508,7 +1978,7 @@ tmp_realloc(void *mem, size_t req)
 	}
 	return NULL;
       } else				/* malloc --> mmap */
-      { void *nw = tmp_malloc(req-SA_OFFSET);
+      { void *nw = tmp_malloc_region(req-SA_OFFSET, stack);
 	if ( nw )
 	{ size_t copy = reg->size;
 
@@ -1532,9 +2002,25 @@ tmp_realloc(void *mem, size_t req)
 
 	  return reg->data;
 	} else
-	{ void *ra = tmp_malloc(req);
+	{ void *ra;
+
+#ifdef MREMAP_MAYMOVE			/* extend in place or move the */
+	  map_region *nreg;		/* pages rather than copying them */
+	  size_t osize = reg->size;
+
+	  if ( (nreg=mremap(reg, osize, req, MREMAP_MAYMOVE)) != MAP_FAILED )
+	  { nreg->size = req;
+	    if ( stack )
+	      advise_stack_region((char*)nreg+osize, req-osize);
+#ifdef O_DEBUG
+	    memset((char*)nreg+osize, 0xFB, req-osize);
+#endif
 
-	  if ( ra )
+	    return nreg->data;
+	  }
+#endif
+
+	  if ( (ra = tmp_malloc_region(req, stack)) )
 	  { memcpy(ra, mem, reg->size-SA_OFFSET);
 #ifdef O_DEBUG
 	    memset((char*)ra+reg->size-SA_OFFSET, 0xFB,
@@ -1550,11 +2036,17 @@ tmp_realloc(void *mem, size_t req)
       }
     }
   } else
-  { return tmp_malloc(req);
+  { return tmp_malloc_region(req, stack);
   }
 }
 
 
+void *
+tmp_realloc(void *mem, size_t req)
+{ return tmp_realloc_region(mem, req, FALSE);
+}
+
+
 void
 tmp_free(void *mem)
 { if ( mem )
@@ -1645,11 +2137,115 @@ tmp_free(void *mem)
   free(sp);
 }
 
+#define tmp_malloc_region(req, stack)       tmp_malloc(req)
+#define tmp_realloc_region(mem, req, stack) tmp_realloc(mem, req)
+
 #endif /*MMAP_STACK*/
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Cache for small mmapped stack regions.  Creating a thread or engine maps
+the initial global/local and trail  stacks   and  destroying  it unmaps
+them again.  For short-lived threads  this   mmap()/munmap()  pair and
+faulting in the fresh pages dominate   the  creation cost. We therefore
+keep a few released regions of at  most   STACK_CACHE_MAX_REGION  bytes
+and hand them out again if a stack of exactly the same size is needed.
+
+Regions are not cached if the stacks are bound to NUMA nodes as the new
+owner may run on a different node.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef MMAP_STACK
+#define STACK_CACHE_SIZE	16	/* Max # cached regions */
+#define STACK_CACHE_MAX_REGION	(256*1024)
+
+static map_region *stack_cache[STACK_CACHE_SIZE];
+static int	   stack_cache_count = 0;
+
+static void *
+stack_cache_get(size_t req)
+{ void *data = NULL;
+
+  if ( stack_cache_count == 0 )
+    return NULL;
+
+  req += SA_OFFSET;
+  if ( req < MMAP_THRESHOLD || req > STACK_CACHE_MAX_REGION )
+    return NULL;
+  req = roundpgsize(req);
+
+  PL_LOCK(L_ALLOC);
+  { int i;
+
+    for(i=0; i<stack_cache_count; i++)
+    { map_region *reg = stack_cache[i];
+
+      if ( reg->size == req )
+      { stack_cache[i] = stack_cache[--stack_cache_count];
+	data = reg->data;
+	break;
+      }
+    }
+  }
+  PL_UNLOCK(L_ALLOC);
+
+#ifdef O_DEBUG
+  if ( data )
+    memset(data, 0xFB, req-SA_OFFSET);
+#endif
+
+  return data;
+}
+
+static int
+stack_cache_put(void *mem)
+{ map_region *reg = (map_region *)((char*)mem-SA_OFFSET);
+  int rc = FALSE;
+
+  if ( !mem || !reg->mmapped || reg->size > STACK_CACHE_MAX_REGION ||
+       GD->options.stackNumaBind ||
+       stack_cache_count == STACK_CACHE_SIZE )
+    return FALSE;
+
+  PL_LOCK(L_ALLOC);
+  if ( stack_cache_count < STACK_CACHE_SIZE )
+  { stack_cache[stack_cache_count++] = reg;
+    rc = TRUE;
+  }
+  PL_UNLOCK(L_ALLOC);
+
+  return rc;
+}
+
+void
+cleanupStackCache(void)
+{ PL_LOCK(L_ALLOC);
+  while ( stack_cache_count > 0 )
+  { map_region *reg = stack_cache[--stack_cache_count];
+
+    munmap(reg, reg->size);
+  }
+  PL_UNLOCK(L_ALLOC);
+}
+
+#else /*MMAP_STACK*/
+
+#define stack_cache_get(req) NULL
+#define stack_cache_put(mem) FALSE
+
+void
+cleanupStackCache(void)
+{
+}
+
+#endif /*MMAP_STACK*/
+
+
 void *
 stack_malloc(size_t size)
-{ void *ptr = tmp_malloc(size);
+{ void *ptr;
+
+  if ( !(ptr = stack_cache_get(size)) )
+    ptr = tmp_malloc_region(size, TRUE);
 
   if ( ptr )
     ATOMIC_ADD(&GD->statistics.stack_space, tmp_malloc_size(ptr));
@@ -1660,7 +2256,7 @@ stack_malloc(size_t size)
 void *
 stack_realloc(void *mem, size_t size)
 { size_t osize = tmp_malloc_size(mem);
-  void *ptr = tmp_realloc(mem, size);
+  void *ptr = tmp_realloc_region(mem, size, TRUE);
 
   if ( ptr )
   { size = tmp_malloc_size(ptr);
@@ -1679,7 +2275,8 @@ stack_free(void *mem)
 { size_t size = tmp_malloc_size(mem);
 
   ATOMIC_SUB(&GD->statistics.stack_space, size);
-  tmp_free(mem);
+  if ( !stack_cache_put(mem) )
+    tmp_free(mem);
 }
 
 size_t
@@ -1693,6 +2290,107 @@ stack_nrealloc(void *mem, size_t req)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Reserved stacks. On 64-bit systems we can  afford to reserve the address
+space for the maximal size of  a   stack  when  the stacks are created.
+Growing and shrinking the stack then merely changes the part that is
+committed (read/write); the stack never   moves  and the stack shifter
+does not have to relocate pointers.  See allocStacks().
+
+stack_reserve_size() returns the size to reserve  for a stack given the
+stack limit or 0 if stacks are not reserved.  stack_reserve() reserves
+the address space, stack_commit() changes the committed size of a
+reserved region and stack_unreserve() releases the region.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#if defined(MMAP_STACK) && SIZEOF_VOIDP == 8
+#define O_STACK_RESERVE 1
+#define MAX_STACK_RESERVE ((size_t)1<<40)	/* 1Tb per stack */
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+size_t
+stack_reserve_size(size_t limit)
+{ if ( !GD->options.stackReserve || limit > MAX_STACK_RESERVE )
+    return 0;
+
+  return roundpgsize(limit);
+}
+
+void *
+stack_reserve(size_t size)
+{ void *mem = mmap(NULL, size, PROT_NONE,
+		   MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+
+  return mem == MAP_FAILED ? NULL : mem;
+}
+
+int
+stack_commit(void *mem, size_t osize, size_t nsize)
+{ osize = roundpgsize(osize);
+  nsize = roundpgsize(nsize);
+
+  if ( nsize > osize )
+  { char *start = (char*)mem+osize;
+
+    if ( mprotect(start, nsize-osize, PROT_READ|PROT_WRITE) != 0 )
+      return FALSE;
+    advise_stack_region(start, nsize-osize);
+#ifdef O_DEBUG
+    memset(start, 0xFB, nsize-osize);
+#endif
+    ATOMIC_ADD(&GD->statistics.stack_space, nsize-osize);
+  } else if ( nsize < osize )
+  { char *start = (char*)mem+nsize;
+					/* drops the pages */
+    if ( mmap(start, osize-nsize, PROT_NONE,
+	      MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE|MAP_FIXED,
+	      -1, 0) == MAP_FAILED )
+      return FALSE;
+    ATOMIC_SUB(&GD->statistics.stack_space, osize-nsize);
+  }
+
+  return TRUE;
+}
+
+void
+stack_unreserve(void *mem, size_t size, size_t committed)
+{ ATOMIC_SUB(&GD->statistics.stack_space, roundpgsize(committed));
+  munmap(mem, size);
+}
+
+#else /*O_STACK_RESERVE*/
+
+size_t
+stack_reserve_size(size_t limit)
+{ (void)limit;
+
+  return 0;
+}
+
+void *
+stack_reserve(size_t size)
+{ (void)size;
+
+  return NULL;
+}
+
+int
+stack_commit(void *mem, size_t osize, size_t nsize)
+{ (void)mem; (void)osize; (void)nsize;
+
+  return FALSE;
+}
+
+void
+stack_unreserve(void *mem, size_t size, size_t committed)
+{ (void)mem; (void)size; (void)committed;
+}
+
+#endif /*O_STACK_RESERVE*/
+
+
 		 /*******************************
 		 *	       TCMALLOC		*
 		 *******************************/
@@ -1702,6 +2400,7 @@ static int (*fMallocExtension_SetNumericProperty)(const char *, size_t);
 static void (*fMallocExtension_MarkThreadIdle)(void) = NULL;
 static void (*fMallocExtension_MarkThreadTemporarilyIdle)(void) = NULL;
 static void (*fMallocExtension_MarkThreadBusy)(void) = NULL;
+static void (*fMallocExtension_ReleaseFreeMemory)(void) = NULL;
 
 static const char* tcmalloc_properties[] =
 { "generic.current_allocated_bytes",
@@ -1871,11 +2570,35 @@ initTCMalloc(void)
     PL_dlsym(NULL, "MallocExtension_MarkThreadTemporarilyIdle");
   fMallocExtension_MarkThreadBusy =
     PL_dlsym(NULL, "MallocExtension_MarkThreadBusy");
+  fMallocExtension_ReleaseFreeMemory =
+    PL_dlsym(NULL, "MallocExtension_ReleaseFreeMemory");
 
   return set;
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+trimHeap() returns free memory  held  by   the  allocator  to  the OS if
+the allocator provides an interface for this.   It  is called by AGC if
+a significant amount of atom text has  been   freed  such that the RSS
+of processes that created and dropped many atoms shrinks.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+trimHeap(void)
+{ if ( fMallocExtension_ReleaseFreeMemory )
+  { fMallocExtension_ReleaseFreeMemory();
+    return TRUE;
+  }
+#ifdef HAVE_MALLOC_TRIM
+  malloc_trim(0);
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+
 /** thread_idle(:Goal, +How)
  *
  */
@@ -1926,9 +2649,17 @@ PRED_IMPL("garbage_collect_heap", 0, garbage_collect_heap, 0)
 }
 #endif
 
+static
+PRED_IMPL("trim_heap", 0, trim_heap, 0)
+{ trimHeap();
+
+  return TRUE;
+}
+
 BeginPredDefs(alloc)
 #ifdef HAVE_BOEHM_GC
   PRED_DEF("garbage_collect_heap", 0, garbage_collect_heap, 0)
 #endif
+  PRED_DEF("trim_heap", 0, trim_heap, 0)
   PRED_DEF("thread_idle", 2, thread_idle, PL_FA_TRANSPARENT)
 EndPredDefs
@@ -79,11 +79,14 @@ typedef struct linger_list
 { struct linger_list *next;		/* Next lingering object */
   gen_t		generation;		/* Linger generation */
   void		*object;		/* The lingering data */
+  size_t	size;			/* Size of object (for statistics) */
   void	       (*unalloc)(void* obj);   /* actually free the object */
 } linger_list;
 
-COMMON(void)	linger(linger_list** list, void (*unalloc)(void *), void *object);
+COMMON(void)	linger(linger_list** list, void (*unalloc)(void *),
+		       void *object, size_t size);
 COMMON(void)	free_lingering(linger_list **list, gen_t generation);
+COMMON(size_t)	sizeof_lingering(linger_list *list);
 
 
 		 /*******************************
@@ -93,6 +96,7 @@ COMMON(void)	free_lingering(linger_list **list, gen_t generation);
 COMMON(void)		initAlloc(void);
 COMMON(int)		initTCMalloc(void);
 COMMON(size_t)		heapUsed(void);
+COMMON(int)		trimHeap(void);
 #ifndef DMALLOC
 COMMON(void *)		allocHeap(size_t n);
 COMMON(void *)		allocHeapOrHalt(size_t n);
@@ -107,6 +111,12 @@ COMMON(Word)		allocGlobal__LD(size_t words ARG_LD);
 COMMON(Word)		allocGlobalNoShift__LD(size_t words ARG_LD);
 COMMON(void)		pushArgumentStack__LD(Word p ARG_LD);
 COMMON(void)		initMemAlloc(void);
+COMMON(Word)		allocLargeIndirect(size_t n ARG_LD);
+COMMON(void)		markLargeIndirect(word w ARG_LD);
+COMMON(word)		largeIndirectKey(word w ARG_LD);
+COMMON(word)		internString(word w ARG_LD);
+COMMON(void)		sweepLargeIndirects(ARG1_LD);
+COMMON(void)		freeLargeIndirects(ARG1_LD);
 COMMON(Word)		allocString(size_t len ARG_LD);
 COMMON(word)		globalString(size_t len, const char *s);
 COMMON(word)		globalWString(size_t len, const pl_wchar_t *s);
@@ -129,8 +139,13 @@ COMMON(size_t)		tmp_nrealloc(void *mem, size_t req);
 COMMON(void *)		stack_malloc(size_t req);
 COMMON(void *)		stack_realloc(void *mem, size_t req);
 COMMON(void)		stack_free(void *mem);
+COMMON(void)		cleanupStackCache(void);
 COMMON(size_t)		stack_nalloc(size_t req);
 COMMON(size_t)		stack_nrealloc(void *mem, size_t req);
+COMMON(size_t)		stack_reserve_size(size_t limit);
+COMMON(void *)		stack_reserve(size_t size);
+COMMON(int)		stack_commit(void *mem, size_t osize, size_t nsize);
+COMMON(void)		stack_unreserve(void *mem, size_t size, size_t committed);
 #ifndef xmalloc
 COMMON(void *)		xmalloc(size_t size);
 COMMON(void *)		xrealloc(void *mem, size_t size);
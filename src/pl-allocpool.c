@@ -91,3 +91,221 @@ free_to_pool(alloc_pool *pool, void *mem, size_t bytes)
       free(pool);
   }
 }
+
+
+		 /*******************************
+		 *	   THREAD ARENAS	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+arena_alloc() and arena_free() are  used   for  objects  that  are
+allocated and freed at a high  rate,   notably  clauses,  clause
+references and records.  Small  objects  are   rounded  to  a  size class
+and freed objects are kept in a per-thread  free list, so we bypass
+malloc() for  the  typical  assert/retract   and   message  passing
+patterns.
+
+Objects are often freed by another thread  than the one that created
+them: clauses are reclaimed by the `gc` thread and message records are
+freed by the receiver. The freeing thread  adds the chunk to its own
+cache. If this cache grows too large,  a batch of ARENA_BATCH chunks is
+moved to a shared depot, and a thread that runs out of chunks takes a
+batch from the depot. Chunks thus travel  in   batches  to the threads
+that allocate, for the cost of one lock per ARENA_BATCH objects.
+
+Chunks are normal malloc() blocks, so memory passed to arena_free() may
+also have been allocated using  malloc()  and   memory  from
+arena_alloc() may be freed using free(). If   we  can, we verify that a
+chunk is big enough for its class before adding it to a cache.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#if defined(HAVE_BOEHM_GC) || !defined(O_PLMT)
+#define ARENA_DISABLED 1
+#endif
+
+#ifndef ARENA_DISABLED
+
+static inline int
+arena_class(size_t bytes)
+{ if ( bytes > 0 && bytes <= ARENA_GRANULE*ARENA_CLASSES )
+    return (int)((bytes-1)/ARENA_GRANULE);
+
+  return -1;
+}
+
+static inline size_t
+arena_class_size(int c)
+{ return (size_t)(c+1)*ARENA_GRANULE;
+}
+
+static inline arena_cache *
+arena_cache_ld(void)
+{ GET_LD
+
+  if ( HAS_LD && !LD->arena.disabled )
+    return &LD->arena;
+
+  return NULL;
+}
+
+static void
+free_chunk_list(arena_chunk *c)
+{ arena_chunk *next;
+
+  for(; c; c = next)
+  { next = c->next;
+    free(c);
+  }
+}
+
+static arena_chunk *
+get_depot_batch(int c)
+{ arena_chunk *batch = NULL;
+
+  if ( GD->arena.batches[c] )
+  { PL_LOCK(L_ALLOC);
+    if ( (batch=GD->arena.batches[c]) )
+    { GD->arena.batches[c] = batch->next_batch;
+      GD->arena.count[c]--;
+    }
+    PL_UNLOCK(L_ALLOC);
+  }
+
+  return batch;
+}
+
+static void
+put_depot_batch(arena_cache *cache, int c)
+{ arena_chunk *batch = cache->free[c];
+  arena_chunk *last = batch;
+  int i;
+
+  for(i=1; i<ARENA_BATCH; i++)
+    last = last->next;
+  cache->free[c] = last->next;
+  cache->count[c] -= ARENA_BATCH;
+  last->next = NULL;
+
+  PL_LOCK(L_ALLOC);
+  if ( GD->arena.count[c] < ARENA_DEPOT_MAX )
+  { batch->next_batch = GD->arena.batches[c];
+    GD->arena.batches[c] = batch;
+    GD->arena.count[c]++;
+    batch = NULL;
+  }
+  PL_UNLOCK(L_ALLOC);
+
+  free_chunk_list(batch);
+}
+
+void *
+arena_alloc(size_t bytes)
+{ int c = arena_class(bytes);
+  arena_cache *cache;
+
+  if ( c >= 0 && (cache=arena_cache_ld()) )
+  { arena_chunk *chunk;
+
+    if ( !(chunk=cache->free[c]) &&
+	 (chunk=get_depot_batch(c)) )
+    { cache->free[c]  = chunk;
+      cache->count[c] = ARENA_BATCH;
+    }
+
+    if ( chunk )
+    { PL_local_data_t *ld = GLOBAL_LD;
+
+      cache->free[c] = chunk->next;
+      cache->count[c]--;
+      if ( ld )
+	ld->statistics.heap_allocated += arena_class_size(c);
+      return chunk;
+    }
+
+    bytes = arena_class_size(c);
+  }
+
+  return PL_malloc_unmanaged(bytes);
+}
+
+void
+arena_free(void *mem, size_t bytes)
+{ int c = arena_class(bytes);
+  arena_cache *cache;
+
+  if ( c >= 0 &&
+#ifdef HAVE_MALLOC_USABLE_SIZE
+       malloc_usable_size(mem) >= arena_class_size(c) &&
+#endif
+       (cache=arena_cache_ld()) )
+  { arena_chunk *chunk = mem;
+
+    chunk->next = cache->free[c];
+    cache->free[c] = chunk;
+    if ( ++cache->count[c] >= 2*ARENA_BATCH )
+      put_depot_batch(cache, c);
+  } else
+  { PL_free(mem);
+  }
+}
+
+/* discard_arena_cache() is called if a thread terminates.  The
+   cache is disabled, such that objects  freed by the terminating thread
+   use free() directly.
+*/
+
+void
+discard_arena_cache(arena_cache *cache)
+{ int c;
+
+  cache->disabled = TRUE;
+  for(c=0; c<ARENA_CLASSES; c++)
+  { while ( cache->count[c] >= ARENA_BATCH )
+      put_depot_batch(cache, c);
+    free_chunk_list(cache->free[c]);
+    cache->free[c]  = NULL;
+    cache->count[c] = 0;
+  }
+}
+
+void
+cleanupArenas(void)
+{ int c;
+
+  for(c=0; c<ARENA_CLASSES; c++)
+  { arena_chunk *batch, *next;
+
+    for(batch=GD->arena.batches[c]; batch; batch=next)
+    { next = batch->next_batch;
+      free_chunk_list(batch);
+    }
+    GD->arena.batches[c] = NULL;
+    GD->arena.count[c]   = 0;
+  }
+}
+
+#else /*ARENA_DISABLED*/
+
+void *
+arena_alloc(size_t bytes)
+{ return PL_malloc_unmanaged(bytes);
+}
+
+void
+arena_free(void *mem, size_t bytes)
+{ (void)bytes;
+
+  PL_free(mem);
+}
+
+void
+discard_arena_cache(arena_cache *cache)
+{ (void)cache;
+}
+
+void
+cleanupArenas(void)
+{
+}
+
+#endif /*ARENA_DISABLED*/
@@ -44,9 +44,34 @@ typedef struct alloc_pool
   int		freed;				/* Pool is freed */
 } alloc_pool;
 
+#define ARENA_GRANULE	16			/* Size class granularity */
+#define ARENA_CLASSES	32			/* #classes (max 512 bytes) */
+#define ARENA_BATCH	32			/* Chunks moved to/from depot */
+#define ARENA_DEPOT_MAX	16			/* Max batches in depot/class */
+
+typedef struct arena_chunk
+{ struct arena_chunk *next;			/* Next in free list */
+  struct arena_chunk *next_batch;		/* Next batch in depot */
+} arena_chunk;
+
+typedef struct arena_cache			/* Per-thread free chunks */
+{ arena_chunk  *free[ARENA_CLASSES];		/* Free chunks per class */
+  unsigned int	count[ARENA_CLASSES];		/* Length of free[] */
+  int		disabled;			/* Thread is terminating */
+} arena_cache;
+
+typedef struct arena_depot			/* Shared batches */
+{ arena_chunk  *batches[ARENA_CLASSES];		/* Batches per class */
+  unsigned int	count[ARENA_CLASSES];		/* Length of batches[] */
+} arena_depot;
+
 COMMON(alloc_pool*)	new_alloc_pool(const char *name, size_t limit);
 COMMON(void)		free_alloc_pool(alloc_pool *pool);
 COMMON(void *)		alloc_from_pool(alloc_pool *pool, size_t bytes);
 COMMON(void)		free_to_pool(alloc_pool *pool, void *mem, size_t bytes);
+COMMON(void *)		arena_alloc(size_t bytes);
+COMMON(void)		arena_free(void *mem, size_t bytes);
+COMMON(void)		discard_arena_cache(arena_cache *cache);
+COMMON(void)		cleanupArenas(void);
 
 #endif /*_PL_ALLOCPOOL_H*/
@@ -127,7 +127,6 @@ problem.
 #endif
 #endif
 
-static int		ar_minus(Number n1, Number n2, Number r);
 static int		mul64(int64_t x, int64_t y, int64_t *r);
 static int		notLessThanZero(const char *f, int a, Number n);
 static int		mustBePositive(const char *f, int a, Number n);
@@ -1451,7 +1450,7 @@ pl_ar_add(Number n1, Number n2, Number r)
 }
 
 
-static int
+int
 ar_minus(Number n1, Number n2, Number r)
 { if ( !same_type_numbers(n1, n2) )
     return FALSE;
@@ -2948,7 +2947,7 @@ ar_rdiv(Number n1, Number n2, Number r)
 #endif /*O_GMP*/
 
 
-static int
+int
 ar_divide(Number n1, Number n2, Number r)
 { GET_LD
 
@@ -3049,6 +3048,8 @@ mul64(int64_t x, int64_t y, int64_t *r)
     we are in the danger zone.
 
     Finally, we must avoid INT64_MIN/-1 :-(
+
+    If the compiler provides __builtin_mul_overflow() we use that.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 #define MU64_SAFE_MAX (LL(1)<<30)
@@ -3056,6 +3057,12 @@ mul64(int64_t x, int64_t y, int64_t *r)
 #define INT64_MIN (LL(1)<<63)
 #endif
 
+#ifdef HAVE__BUILTIN_MUL_OVERFLOW
+static int
+mul64(int64_t x, int64_t y, int64_t *r)
+{ return !__builtin_mul_overflow(x, y, r);
+}
+#else
 static int
 mul64(int64_t x, int64_t y, int64_t *r)
 { if ( x == LL(0) || y == LL(0) )
@@ -3101,6 +3108,7 @@ mul64(int64_t x, int64_t y, int64_t *r)
     return FALSE;
   }
 }
+#endif /*HAVE__BUILTIN_MUL_OVERFLOW*/
 
 
 int
@@ -4080,6 +4088,77 @@ PRED_IMPL("random_property", 1, random_property, 0)
 #endif
 
 
+#ifdef O_GMP
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+random_uint64() and random_double() are the fast  paths for random/1 on
+small integers and random_float. They draw   the same bits from the same
+per-thread GMP state as mpz_urandomm() and  mpf_urandomb() and thus
+produce the same sequences, but avoid the   allocation of an mpz or mpf
+number for each call.
+
+random_uint64() returns a random number in [0,n) for 0 < n <= ULONG_MAX.
+Like mpz_urandomm(), it returns 0 for n == 1 without using the state.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+uint64_t
+random_uint64(uint64_t n ARG_LD)
+{ init_random(PASS_LD1);
+
+  if ( n == 1 )
+    return 0;
+
+  return gmp_urandomm_ui(LD->arith.random.state, (unsigned long)n);
+}
+
+
+/* random_double() returns a random float in [0,1).  As mpf_get_d(), it
+   truncates the 64 random bits to the 53 bits of a double.
+*/
+
+double
+random_double(ARG1_LD)
+{ init_random(PASS_LD1);
+
+#if SIZEOF_LONG == 8 && GMP_LIMB_BITS == 64
+{ uint64_t a = gmp_urandomb_ui(LD->arith.random.state, 64);
+  int shift;
+
+  if ( a == 0 )
+    return 0.0;
+  if ( (shift = MSB64(a) - (DBL_MANT_DIG-1)) > 0 )
+    a &= ~(((uint64_t)1<<shift)-1);
+
+  return ldexp((double)a, -64);
+}
+#else
+{ mpf_t rop;
+  double d;
+
+  mpf_init2(rop, sizeof(double)*8);
+  mpf_urandomb(rop, LD->arith.random.state, sizeof(double)*8);
+  d = mpf_get_d(rop);
+  mpf_clear(rop);
+
+  return d;
+}
+#endif
+}
+
+#else /*O_GMP*/
+
+uint64_t
+random_uint64(uint64_t n ARG_LD)
+{ return _PL_Random() % n;
+}
+
+double
+random_double(ARG1_LD)
+{ return _PL_Random()/(double)(~(uint64_t)0);
+}
+
+#endif /*O_GMP*/
+
+
 static int
 ar_random(Number n1, Number r)
 { GET_LD
@@ -4095,6 +4174,12 @@ ar_random(Number n1, Number r)
   {
 #ifdef O_GMP
     case V_INTEGER:
+      if ( (uint64_t)n1->value.i <= ULONG_MAX )
+      { r->value.i = random_uint64(n1->value.i PASS_LD);
+	r->type = V_INTEGER;
+
+	succeed;
+      }
       promoteToMPZNumber(n1);
       assert(n1->type == V_MPZ);
       /*FALLTHROUGH*/
@@ -4133,11 +4218,7 @@ ar_random_float(Number r)
   do
   {
 #ifdef O_GMP
-    mpf_t rop;
-    mpf_init2(rop, sizeof(double)*8);
-    mpf_urandomb(rop, LD->arith.random.state, sizeof(double)*8);
-    r->value.f = mpX_round(mpf_get_d(rop));
-    mpf_clear(rop);
+    r->value.f = mpX_round(random_double(PASS_LD1));
 #else
     r->value.f = _PL_Random()/(float)UINT64_MAX;
 #endif
@@ -52,6 +52,8 @@ COMMON(int)		ar_compare(Number n1, Number n2, int what);
 COMMON(int)		ar_compare_eq(Number n1, Number n2);
 COMMON(int)		pl_ar_add(Number n1, Number n2, Number r);
 COMMON(int)		ar_mul(Number n1, Number n2, Number r);
+COMMON(int)		ar_minus(Number n1, Number n2, Number r);
+COMMON(int)		ar_divide(Number n1, Number n2, Number r);
 COMMON(word)		pl_current_arithmetic_function(term_t f, control_t h);
 COMMON(void)		initArith(void);
 COMMON(void)		cleanupArith(void);
@@ -77,6 +79,8 @@ COMMON(void)		set_rounding(int mode);
 COMMON(int)		atom_to_rounding(atom_t a, int *m);
 COMMON(atom_t)		float_rounding_name(int m);
 COMMON(double)		PL_nan(void);
+COMMON(uint64_t)	random_uint64(uint64_t n ARG_LD);
+COMMON(double)		random_double(ARG1_LD);
 
 
 		 /*******************************
@@ -126,7 +130,7 @@ popArgvArithStack(int n ARG_LD)
 
 static inline int
 isMPQNum__LD(word w ARG_LD)
-{ if ( tagex(w) == (TAG_INTEGER|STG_GLOBAL) )
+{ if ( tag(w) == TAG_INTEGER && storage(w) != STG_INLINE )
   { Word p = addressIndirect(w);
     size_t wsize = wsizeofInd(*p);
 
@@ -141,7 +145,7 @@ isMPQNum__LD(word w ARG_LD)
 
 static inline int
 isMPZNum__LD(word w ARG_LD)
-{ if ( tagex(w) == (TAG_INTEGER|STG_GLOBAL) )
+{ if ( tag(w) == TAG_INTEGER && storage(w) != STG_INLINE )
   { Word p = addressIndirect(w);
     size_t wsize = wsizeofInd(*p);
 
@@ -0,0 +1,1036 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pl-incl.h"
+#include "pl-arith.h"
+#include <math.h>
+
+#undef LD
+#define LD LOCAL_LD
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Packed numeric arrays. A numeric array is a blob that holds a fixed number
+of elements of the same C type in a  single malloc()'ed block, i.e., 1 to
+8 bytes per element rather than a list cell plus a (possibly indirect)
+number.  Elements are accessed using  a   0-based  index in constant time.
+numarray_set/3 modifies the array in place (the modification is *not*
+undone on backtracking) and there is no   locking: threads that share an
+array must synchronize themselves.
+
+Arrays can be saved in states (save/load   hooks) and serialized using
+fast_write/2 (see PL_TYPE_EXT_ARRAY in pl-rec.c).   In both cases the data
+is written in little endian byte order.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef enum
+{ NA_INT8 = 0,
+  NA_INT16,
+  NA_INT32,
+  NA_INT64,
+  NA_FLOAT32,
+  NA_FLOAT64
+} na_type;
+
+#define NA_TYPES (NA_FLOAT64+1)
+
+typedef struct num_array
+{ na_type	type;			/* Element type */
+  size_t	length;			/* # elements */
+  void	       *data;			/* The elements */
+} num_array;
+
+typedef struct na_ref
+{ num_array    *array;			/* represented array */
+} na_ref;
+
+static const atom_t na_type_names[NA_TYPES] =
+{ ATOM_int8, ATOM_int16, ATOM_int32, ATOM_int64, ATOM_float32, ATOM_float64
+};
+
+static const size_t na_element_size[NA_TYPES] =
+{ 1, 2, 4, 8, 4, 8
+};
+
+#define isFloatNumArray(a) ((a)->type >= NA_FLOAT32)
+
+
+static inline int64_t
+na_get_int(const num_array *a, size_t i)
+{ switch(a->type)
+  { case NA_INT8:	return ((int8_t*)a->data)[i];
+    case NA_INT16:	return ((int16_t*)a->data)[i];
+    case NA_INT32:	return ((int32_t*)a->data)[i];
+    case NA_INT64:	return ((int64_t*)a->data)[i];
+    default:		assert(0); return 0;
+  }
+}
+
+
+static inline double
+na_get_float(const num_array *a, size_t i)
+{ switch(a->type)
+  { case NA_FLOAT32:	return ((float*)a->data)[i];
+    case NA_FLOAT64:	return ((double*)a->data)[i];
+    default:		return (double)na_get_int(a, i);
+  }
+}
+
+
+static inline void
+na_set_int(num_array *a, size_t i, int64_t v)
+{ switch(a->type)
+  { case NA_INT8:	((int8_t*)a->data)[i]  = (int8_t)v;  break;
+    case NA_INT16:	((int16_t*)a->data)[i] = (int16_t)v; break;
+    case NA_INT32:	((int32_t*)a->data)[i] = (int32_t)v; break;
+    case NA_INT64:	((int64_t*)a->data)[i] = v;          break;
+    default:		assert(0);
+  }
+}
+
+
+static inline void
+na_set_float(num_array *a, size_t i, double f)
+{ switch(a->type)
+  { case NA_FLOAT32:	((float*)a->data)[i]  = (float)f; break;
+    case NA_FLOAT64:	((double*)a->data)[i] = f;        break;
+    default:		assert(0);
+  }
+}
+
+
+static int
+na_int_fits(na_type type, int64_t v)
+{ switch(type)
+  { case NA_INT8:	return v >= INT8_MIN  && v <= INT8_MAX;
+    case NA_INT16:	return v >= INT16_MIN && v <= INT16_MAX;
+    case NA_INT32:	return v >= INT32_MIN && v <= INT32_MAX;
+    default:		return TRUE;
+  }
+}
+
+
+static int
+na_representation_error(const num_array *a)
+{ return PL_representation_error(stringAtom(na_type_names[a->type]));
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+na_check_float() verifies a float result  using check_float(), so float
+overflow, NaN, etc. are handled according  to   the  float_* flags as in
+is/2.  Float32 values are checked after conversion.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+na_check_float(const num_array *a, double f)
+{ number n;
+
+  n.type = V_FLOAT;
+  n.value.f = (a->type == NA_FLOAT32 ? (double)(float)f : f);
+
+  return check_float(&n);
+}
+
+
+		 /*******************************
+		 *	      SYMBOL		*
+		 *******************************/
+
+static num_array *
+alloc_num_array(na_type type, size_t length)
+{ num_array *a;
+  size_t bytes;
+
+  if ( length > (SIZE_MAX/na_element_size[type]) )
+    return NULL;
+  bytes = length*na_element_size[type];
+
+  if ( (a = malloc(sizeof(*a))) )
+  { if ( (a->data = malloc(bytes ? bytes : 1)) )
+    { a->type   = type;
+      a->length = length;
+      return a;
+    }
+    free(a);
+  }
+
+  return NULL;
+}
+
+
+static void
+free_num_array(num_array *a)
+{ free(a->data);
+  free(a);
+}
+
+
+static int
+write_num_array_ref(IOSTREAM *s, atom_t aref, int flags)
+{ na_ref *ref = PL_blob_data(aref, NULL, NULL);
+  (void)flags;
+
+  Sfprintf(s, "<numarray>(%p)", ref->array);
+  return TRUE;
+}
+
+
+static int
+release_num_array_ref(atom_t aref)
+{ na_ref *ref = PL_blob_data(aref, NULL, NULL);
+
+  if ( ref->array )
+    free_num_array(ref->array);
+
+  return TRUE;
+}
+
+
+/* na_copy_le() converts between native and little endian order.  From
+   and to may be the same.
+*/
+
+static void
+na_copy_le(void *to, const void *from, na_type type, size_t length)
+{ size_t bytes = length*na_element_size[type];
+#ifdef WORDS_BIGENDIAN
+  size_t es = na_element_size[type];
+  const unsigned char *s = from;
+  unsigned char *d = to;
+  size_t i;
+
+  for(i=0; i<bytes; i += es)
+  { unsigned char tmp[8];
+    size_t j;
+
+    for(j=0; j<es; j++)
+      tmp[j] = s[i+es-1-j];
+    memcpy(&d[i], tmp, es);
+  }
+#else
+  if ( to != from )
+    memcpy(to, from, bytes);
+#endif
+}
+
+
+static void
+na_put_size(size_t n, IOSTREAM *fd)
+{ int i;
+
+  for(i=0; i<8; i++)
+    Sputc((int)(((uint64_t)n >> (i*8)) & 0xff), fd);
+}
+
+
+static size_t
+na_get_size(IOSTREAM *fd)
+{ uint64_t n = 0;
+  int i;
+
+  for(i=0; i<8; i++)
+    n |= (uint64_t)(Sgetc(fd) & 0xff) << (i*8);
+
+  return (size_t)n;
+}
+
+
+static int
+save_num_array(atom_t aref, IOSTREAM *fd)
+{ na_ref *ref = PL_blob_data(aref, NULL, NULL);
+  num_array *a = ref->array;
+  size_t bytes = a->length*na_element_size[a->type];
+  void *le;
+  int rc;
+
+  if ( !(le = malloc(bytes ? bytes : 1)) )
+    return PL_no_memory();
+  na_copy_le(le, a->data, a->type, a->length);
+  Sputc(a->type, fd);
+  na_put_size(a->length, fd);
+  rc = ( Sfwrite(le, 1, bytes, fd) == bytes );
+  free(le);
+
+  return rc;
+}
+
+
+static PL_blob_t num_array_blob;
+
+static atom_t
+new_num_array_atom(num_array *a)
+{ na_ref ref;
+  int new;
+
+  ref.array = a;
+  return lookupBlob((const char*)&ref, sizeof(ref), &num_array_blob, &new);
+}
+
+
+static atom_t
+load_num_array(IOSTREAM *fd)
+{ int type = Sgetc(fd);
+  size_t length = na_get_size(fd);
+  num_array *a;
+
+  if ( type < 0 || type >= NA_TYPES || !(a=alloc_num_array(type, length)) )
+    fatalError("Cannot load <numarray>");
+  if ( Sfread(a->data, 1, length*na_element_size[type], fd) !=
+       length*na_element_size[type] )
+    fatalError("Cannot load <numarray>");
+  na_copy_le(a->data, a->data, type, length);
+
+  return new_num_array_atom(a);
+}
+
+
+static PL_blob_t num_array_blob =
+{ PL_BLOB_MAGIC,
+  PL_BLOB_UNIQUE,
+  "numarray",
+  release_num_array_ref,
+  NULL,
+  write_num_array_ref,
+  NULL,
+  save_num_array,
+  load_num_array
+};
+
+
+static int
+get_num_array(term_t t, num_array **ap)
+{ void *data;
+  PL_blob_t *type;
+
+  if ( PL_get_blob(t, &data, NULL, &type) && type == &num_array_blob )
+  { na_ref *ref = data;
+
+    *ap = ref->array;
+    return TRUE;
+  }
+
+  PL_type_error("numarray", t);
+  return FALSE;
+}
+
+
+static int
+unify_num_array(term_t t, num_array *a)
+{ na_ref ref;
+
+  ref.array = a;
+  return PL_unify_blob(t, &ref, sizeof(ref), &num_array_blob);
+}
+
+
+static int
+get_na_type(term_t t, na_type *tp)
+{ GET_LD
+  atom_t name;
+  int i;
+
+  if ( !PL_get_atom_ex(t, &name) )
+    return FALSE;
+  for(i=0; i<NA_TYPES; i++)
+  { if ( na_type_names[i] == name )
+    { *tp = i;
+      return TRUE;
+    }
+  }
+
+  PL_domain_error("numarray_type", t);
+  return FALSE;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Interface for fast_write/2 and friends  (pl-rec.c). An array is written
+as its type, its length and the elements in little endian order.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+isNumArrayAtom(atom_t a)
+{ return atomValue(a)->type == &num_array_blob;
+}
+
+
+size_t
+numArrayExternalSize(int type, size_t length)
+{ return length*na_element_size[type];
+}
+
+
+void
+getNumArrayExternal(atom_t a, int *type, size_t *length)
+{ na_ref *ref = PL_blob_data(a, NULL, NULL);
+
+  *type   = ref->array->type;
+  *length = ref->array->length;
+}
+
+
+void
+copyNumArrayExternal(atom_t a, void *to)
+{ na_ref *ref = PL_blob_data(a, NULL, NULL);
+  num_array *na = ref->array;
+
+  na_copy_le(to, na->data, na->type, na->length);
+}
+
+
+/* newNumArrayExternal() returns a new atom that holds a reference */
+
+atom_t
+newNumArrayExternal(int type, size_t length, const void *from)
+{ num_array *a;
+
+  if ( type < 0 || type >= NA_TYPES || !(a=alloc_num_array(type, length)) )
+    outOfCore();
+  na_copy_le(a->data, from, type, length);
+
+  return new_num_array_atom(a);
+}
+
+
+		 /*******************************
+		 *	     ELEMENTS		*
+		 *******************************/
+
+static int
+get_element(term_t t, num_array *a, size_t i)
+{ if ( isFloatNumArray(a) )
+  { double f;
+
+    if ( !PL_get_float_ex(t, &f) )
+      return FALSE;
+    if ( a->type == NA_FLOAT32 && !na_check_float(a, f) )
+      return FALSE;
+    na_set_float(a, i, f);
+  } else
+  { int64_t v;
+
+    if ( !PL_get_int64_ex(t, &v) )
+      return FALSE;
+    if ( !na_int_fits(a->type, v) )
+      return na_representation_error(a);
+    na_set_int(a, i, v);
+  }
+
+  return TRUE;
+}
+
+
+static int
+unify_element(term_t t, const num_array *a, size_t i)
+{ GET_LD
+
+  if ( isFloatNumArray(a) )
+    return PL_unify_float(t, na_get_float(a, i));
+  else
+    return PL_unify_int64(t, na_get_int(a, i));
+}
+
+
+static int
+get_index(term_t t, const num_array *a, size_t *ip)
+{ GET_LD
+  size_t i;
+
+  if ( !PL_get_size_ex(t, &i) )
+    return FALSE;
+  if ( i >= a->length )
+    return FALSE;
+
+  *ip = i;
+  return TRUE;
+}
+
+
+		 /*******************************
+		 *	     ARITHMETIC		*
+		 *******************************/
+
+typedef enum
+{ NA_OP_PLUS = 0,
+  NA_OP_MINUS,
+  NA_OP_TIMES,
+  NA_OP_DIVIDE,
+  NA_OP_INTDIV,
+  NA_OP_MIN,
+  NA_OP_MAX
+} na_op;
+
+
+static int
+get_na_op(term_t t, const num_array *a, na_op *op)
+{ GET_LD
+  atom_t name;
+
+  if ( !PL_get_atom_ex(t, &name) )
+    return FALSE;
+
+  if ( name == ATOM_plus )
+    *op = NA_OP_PLUS;
+  else if ( name == ATOM_minus )
+    *op = NA_OP_MINUS;
+  else if ( name == ATOM_star )
+    *op = NA_OP_TIMES;
+  else if ( name == ATOM_divide && isFloatNumArray(a) )
+    *op = NA_OP_DIVIDE;
+  else if ( name == ATOM_gdiv && !isFloatNumArray(a) )
+    *op = NA_OP_INTDIV;
+  else if ( name == ATOM_min )
+    *op = NA_OP_MIN;
+  else if ( name == ATOM_max )
+    *op = NA_OP_MAX;
+  else
+  { PL_domain_error("numarray_operator", t);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+na_op_int() and na_op_float() compute  a   single  element. As in is/2,
+integer overflow (of int64) and division by zero raise an evaluation error.
+Results that do not fit the element type raise a representation error.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+na_op_int(na_op op, int64_t x, int64_t y, int64_t *r)
+{ switch(op)
+  { case NA_OP_PLUS:
+    { int64_t s = (int64_t)((uint64_t)x+(uint64_t)y);
+
+      if ( ((x^s)&(y^s)) < 0 )
+	return PL_error(NULL, 0, NULL, ERR_EVALUATION, ATOM_int_overflow);
+      *r = s;
+      return TRUE;
+    }
+    case NA_OP_MINUS:
+    { int64_t s = (int64_t)((uint64_t)x-(uint64_t)y);
+
+      if ( ((x^y)&(x^s)) < 0 )
+	return PL_error(NULL, 0, NULL, ERR_EVALUATION, ATOM_int_overflow);
+      *r = s;
+      return TRUE;
+    }
+    case NA_OP_TIMES:
+    {
+#ifdef HAVE__BUILTIN_MUL_OVERFLOW
+      if ( __builtin_mul_overflow(x, y, r) )
+	return PL_error(NULL, 0, NULL, ERR_EVALUATION, ATOM_int_overflow);
+#else
+      int64_t prod = (int64_t)((uint64_t)x*(uint64_t)y);
+
+      if ( (x != 0 && (prod/x != y || (x == -1 && y == PLMININT))) )
+	return PL_error(NULL, 0, NULL, ERR_EVALUATION, ATOM_int_overflow);
+      *r = prod;
+#endif
+      return TRUE;
+    }
+    case NA_OP_INTDIV:
+      if ( y == 0 )
+	return PL_error(NULL, 0, NULL, ERR_DIV_BY_ZERO);
+      if ( x == PLMININT && y == -1 )
+	return PL_error(NULL, 0, NULL, ERR_EVALUATION, ATOM_int_overflow);
+      *r = x/y;
+      return TRUE;
+    case NA_OP_MIN:
+      *r = x < y ? x : y;
+      return TRUE;
+    case NA_OP_MAX:
+      *r = x > y ? x : y;
+      return TRUE;
+    default:
+      assert(0);
+      return FALSE;
+  }
+}
+
+
+static int
+na_op_float(na_op op, double x, double y, double *r)
+{ GET_LD
+
+  switch(op)
+  { case NA_OP_PLUS:
+      *r = x+y;
+      return TRUE;
+    case NA_OP_MINUS:
+      *r = x-y;
+      return TRUE;
+    case NA_OP_TIMES:
+      *r = x*y;
+      return TRUE;
+    case NA_OP_DIVIDE:
+      if ( y == 0.0 && !(LD->arith.f.flags & FLT_ZERO_DIV) )
+	return PL_error(NULL, 0, NULL, ERR_DIV_BY_ZERO);
+      *r = x/y;
+      return TRUE;
+    case NA_OP_MIN:
+      *r = ( x < y || (x == 0.0 && y == 0.0 && signbit(x)) ) ? x : y;
+      return TRUE;
+    case NA_OP_MAX:
+      *r = ( x > y || (x == 0.0 && y == 0.0 && signbit(y)) ) ? x : y;
+      return TRUE;
+    default:
+      assert(0);
+      return FALSE;
+  }
+}
+
+
+static int
+na_apply(num_array *r, na_op op,
+	 const num_array *a, const num_array *b, term_t bt)
+{ GET_LD
+  size_t i;
+
+  if ( isFloatNumArray(r) )
+  { double y = 0.0;
+
+    if ( !b && !PL_get_float_ex(bt, &y) )
+      return FALSE;
+
+    for(i=0; i<r->length; i++)
+    { double v = 0.0;
+
+      if ( b )
+	y = na_get_float(b, i);
+      if ( !na_op_float(op, na_get_float(a, i), y, &v) ||
+	   !na_check_float(r, v) )
+	return FALSE;
+      na_set_float(r, i, v);
+    }
+  } else
+  { int64_t y = 0;
+
+    if ( b )
+    { if ( isFloatNumArray(b) )
+      { term_t ex;
+
+	return ( (ex = PL_new_term_ref()) &&
+		 PL_unify_atom(ex, na_type_names[b->type]) &&
+		 PL_error(NULL, 0, "integer array expected",
+			  ERR_TYPE, ATOM_integer, ex) );
+      }
+    } else if ( !PL_get_int64_ex(bt, &y) )
+    { return FALSE;
+    }
+
+    for(i=0; i<r->length; i++)
+    { int64_t v = 0;
+
+      if ( b )
+	y = na_get_int(b, i);
+      if ( !na_op_int(op, na_get_int(a, i), y, &v) )
+	return FALSE;
+      if ( !na_int_fits(r->type, v) )
+	return na_representation_error(r);
+      na_set_int(r, i, v);
+    }
+  }
+
+  return TRUE;
+}
+
+
+		 /*******************************
+		 *	      PREDICATES	*
+		 *******************************/
+
+/** numarray_new(-Array, +Type, +Length) is det.
+*/
+
+static
+PRED_IMPL("numarray_new", 3, numarray_new, 0)
+{ PRED_LD
+  na_type type;
+  size_t length;
+  num_array *a;
+
+  if ( !get_na_type(A2, &type) ||
+       !PL_get_size_ex(A3, &length) )
+    return FALSE;
+  if ( !(a = alloc_num_array(type, length)) )
+    return PL_no_memory();
+  memset(a->data, 0, length*na_element_size[type]);
+
+  return unify_num_array(A1, a);
+}
+
+
+/** numarray_from_list(-Array, +Type, +List) is det.
+*/
+
+static
+PRED_IMPL("numarray_from_list", 3, numarray_from_list, 0)
+{ PRED_LD
+  na_type type;
+  size_t length, i;
+  num_array *a;
+  term_t tail = PL_copy_term_ref(A3);
+  term_t head = PL_new_term_ref();
+
+  if ( !get_na_type(A2, &type) )
+    return FALSE;
+  switch(PL_skip_list(A3, 0, &length))
+  { case PL_LIST:
+      break;
+    case PL_PARTIAL_LIST:
+      return PL_error(NULL, 0, NULL, ERR_INSTANTIATION);
+    default:
+      return PL_type_error("list", A3);
+  }
+  if ( !(a = alloc_num_array(type, length)) )
+    return PL_no_memory();
+
+  for(i=0; PL_get_list(tail, head, tail); i++)
+  { if ( !get_element(head, a, i) )
+    { free_num_array(a);
+      return FALSE;
+    }
+  }
+
+  return unify_num_array(A1, a);
+}
+
+
+/** numarray_to_list(+Array, -List) is det.
+*/
+
+static
+PRED_IMPL("numarray_to_list", 2, numarray_to_list, 0)
+{ PRED_LD
+  num_array *a;
+  term_t tail = PL_copy_term_ref(A2);
+  term_t head = PL_new_term_ref();
+  size_t i;
+
+  if ( !get_num_array(A1, &a) )
+    return FALSE;
+
+  for(i=0; i<a->length; i++)
+  { if ( !PL_unify_list(tail, head, tail) ||
+	 !unify_element(head, a, i) )
+      return FALSE;
+  }
+
+  return PL_unify_nil(tail);
+}
+
+
+static
+PRED_IMPL("is_numarray", 1, is_numarray, 0)
+{ void *data;
+  PL_blob_t *type;
+
+  return PL_get_blob(A1, &data, NULL, &type) && type == &num_array_blob;
+}
+
+
+static
+PRED_IMPL("numarray_length", 2, numarray_length, 0)
+{ PRED_LD
+  num_array *a;
+
+  return ( get_num_array(A1, &a) &&
+	   PL_unify_int64(A2, a->length) );
+}
+
+
+static
+PRED_IMPL("numarray_type", 2, numarray_type, 0)
+{ PRED_LD
+  num_array *a;
+
+  return ( get_num_array(A1, &a) &&
+	   PL_unify_atom(A2, na_type_names[a->type]) );
+}
+
+
+/** numarray_get(+Array, +Index, -Value) is semidet.
+*/
+
+static
+PRED_IMPL("numarray_get", 3, numarray_get, 0)
+{ num_array *a;
+  size_t i;
+
+  return ( get_num_array(A1, &a) &&
+	   get_index(A2, a, &i) &&
+	   unify_element(A3, a, i) );
+}
+
+
+/** numarray_set(+Array, +Index, +Value) is semidet.
+*/
+
+static
+PRED_IMPL("numarray_set", 3, numarray_set, 0)
+{ num_array *a;
+  size_t i;
+
+  return ( get_num_array(A1, &a) &&
+	   get_index(A2, a, &i) &&
+	   get_element(A3, a, i) );
+}
+
+
+/** numarray_slice(+Array, +Start, +Length, -Slice) is semidet.
+*/
+
+static
+PRED_IMPL("numarray_slice", 4, numarray_slice, 0)
+{ PRED_LD
+  num_array *a, *s;
+  size_t start, length;
+
+  if ( !get_num_array(A1, &a) ||
+       !PL_get_size_ex(A2, &start) ||
+       !PL_get_size_ex(A3, &length) )
+    return FALSE;
+  if ( start > a->length || length > a->length-start )
+    return FALSE;
+  if ( !(s = alloc_num_array(a->type, length)) )
+    return PL_no_memory();
+  memcpy(s->data, (char*)a->data + start*na_element_size[a->type],
+	 length*na_element_size[a->type]);
+
+  return unify_num_array(A4, s);
+}
+
+
+/** numarray_op(+Op, +Array1, +ArrayOrNumber, -Array) is det.
+*/
+
+static
+PRED_IMPL("numarray_op", 4, numarray_op, 0)
+{ num_array *a, *b = NULL, *r;
+  void *data;
+  PL_blob_t *type;
+  na_op op;
+
+  if ( !get_num_array(A2, &a) ||
+       !get_na_op(A1, a, &op) )
+    return FALSE;
+  if ( PL_get_blob(A3, &data, NULL, &type) && type == &num_array_blob )
+  { b = ((na_ref*)data)->array;
+    if ( b->length != a->length )
+      return PL_domain_error("numarray_length", A3);
+  }
+
+  if ( !(r = alloc_num_array(a->type, a->length)) )
+    return PL_no_memory();
+  if ( !na_apply(r, op, a, b, A3) )
+  { free_num_array(r);
+    return FALSE;
+  }
+
+  return unify_num_array(A4, r);
+}
+
+
+/** numarray_sum(+Array, -Sum) is det.
+*/
+
+static
+PRED_IMPL("numarray_sum", 2, numarray_sum, 0)
+{ PRED_LD
+  num_array *a;
+  size_t i;
+
+  if ( !get_num_array(A1, &a) )
+    return FALSE;
+
+  if ( isFloatNumArray(a) )
+  { double sum = 0.0;
+
+    for(i=0; i<a->length; i++)
+      sum += na_get_float(a, i);
+    if ( !na_check_float(a, sum) )
+      return FALSE;
+
+    return PL_unify_float(A2, sum);
+  } else
+  { int64_t sum = 0;
+    number n;
+    int rc;
+
+    for(i=0; i<a->length; i++)
+    { int64_t v = na_get_int(a, i);
+      int64_t s = (int64_t)((uint64_t)sum+(uint64_t)v);
+
+      if ( ((sum^s)&(v^s)) < 0 )
+	break;
+      sum = s;
+    }
+    if ( i == a->length )
+      return PL_unify_int64(A2, sum);
+
+    n.type = V_INTEGER;			/* int64 overflow */
+    n.value.i = sum;
+    for(; i<a->length; i++)
+    { number v, r;
+
+      v.type = V_INTEGER;
+      v.value.i = na_get_int(a, i);
+      if ( !pl_ar_add(&n, &v, &r) )
+      { clearNumber(&n);
+	return FALSE;
+      }
+      clearNumber(&n);
+      n = r;
+    }
+    rc = PL_unify_number(A2, &n);
+    clearNumber(&n);
+
+    return rc;
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+numarray_random(+Array, +Low, +High) fills Array with random numbers from
+the per-thread generator of random/1 (see random_uint64() in pl-arith.c).
+na_random_below() returns a random number in [0,span), where 0 denotes
+2^64.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static uint64_t
+na_random_bits(ARG1_LD)
+{ uint64_t hi = random_uint64((uint64_t)1<<32 PASS_LD);
+
+  return (hi<<32) | random_uint64((uint64_t)1<<32 PASS_LD);
+}
+
+
+static uint64_t
+na_random_below(uint64_t span ARG_LD)
+{ if ( span != 0 && span <= ULONG_MAX )
+  { return random_uint64(span PASS_LD);
+  } else if ( span == 0 )
+  { return na_random_bits(PASS_LD1);
+  } else
+  { uint64_t limit = ~(uint64_t)0 - (~(uint64_t)0 % span);
+    uint64_t v;
+
+    do
+    { v = na_random_bits(PASS_LD1);
+    } while ( v >= limit );
+
+    return v % span;
+  }
+}
+
+
+/** numarray_random(+Array, +Low, +High) is det.
+*/
+
+static
+PRED_IMPL("numarray_random", 3, numarray_random, 0)
+{ PRED_LD
+  num_array *a;
+  size_t i;
+
+  if ( !get_num_array(A1, &a) )
+    return FALSE;
+
+  if ( isFloatNumArray(a) )
+  { double low, high;
+
+    if ( !PL_get_float_ex(A2, &low) ||
+	 !PL_get_float_ex(A3, &high) )
+      return FALSE;
+    if ( !(low < high) )
+      return PL_domain_error("numarray_range", A3);
+
+    for(i=0; i<a->length; i++)
+    { double f = low + (high-low)*random_double(PASS_LD1);
+
+      if ( !na_check_float(a, f) )
+	return FALSE;
+      na_set_float(a, i, f);
+    }
+  } else
+  { int64_t low, high;
+    uint64_t span;
+
+    if ( !PL_get_int64_ex(A2, &low) ||
+	 !PL_get_int64_ex(A3, &high) )
+      return FALSE;
+    if ( !na_int_fits(a->type, low) || !na_int_fits(a->type, high) )
+      return na_representation_error(a);
+    if ( low > high )
+      return PL_domain_error("numarray_range", A3);
+
+    span = (uint64_t)high - (uint64_t)low + 1;
+    for(i=0; i<a->length; i++)
+    { uint64_t v = (uint64_t)low + na_random_below(span PASS_LD);
+
+      na_set_int(a, i, (int64_t)v);
+    }
+  }
+
+  return TRUE;
+}
+
+
+void
+initNumArrays(void)
+{ PL_register_blob_type(&num_array_blob);
+}
+
+
+		 /*******************************
+		 *      PUBLISH PREDICATES	*
+		 *******************************/
+
+BeginPredDefs(array)
+  PRED_DEF("numarray_new",	 3, numarray_new,	0)
+  PRED_DEF("numarray_from_list", 3, numarray_from_list, 0)
+  PRED_DEF("numarray_to_list",	 2, numarray_to_list,	0)
+  PRED_DEF("is_numarray",	 1, is_numarray,	0)
+  PRED_DEF("numarray_length",	 2, numarray_length,	0)
+  PRED_DEF("numarray_type",	 2, numarray_type,	0)
+  PRED_DEF("numarray_get",	 3, numarray_get,	0)
+  PRED_DEF("numarray_set",	 3, numarray_set,	0)
+  PRED_DEF("numarray_slice",	 4, numarray_slice,	0)
+  PRED_DEF("numarray_op",	 4, numarray_op,	0)
+  PRED_DEF("numarray_sum",	 2, numarray_sum,	0)
+  PRED_DEF("numarray_random",	 3, numarray_random,	0)
+EndPredDefs
@@ -36,6 +36,8 @@
 /*#define O_DEBUG 1*/
 #include "pl-incl.h"
 #include "os/pl-ctype.h"
+#include "pl-metrics.h"
+#include "pl-tracepoint.h"
 #undef LD
 #define LD LOCAL_LD
 
@@ -54,11 +56,16 @@ Next, there is a hash-table. Thanks to the work by Keri Harris, the atom
 table now uses a lock-free algorithm.  This works as follows:
 
   - Atoms have a ->next pointer, organizing them as an open hash table.
-  - The head pointers for the hash-buckets are in a struct atom_table,
-    of which the most recent is in GD->atoms.table.  This structure
-    contains a pointer to older atom_tables (before resizing).  A
-    resize allocates a new struct atom_table, copies all atoms
-    (updating Atom->next) and makes the new atom-table current.
+  - The head pointers for the hash-buckets are in a struct atom_table.
+    The table is split into ATOM_TABLE_SHARDS shards, selected by the
+    high bits of the hash using atomTableShard().  Each shard is
+    resized independently and the most recent table for shard `s` is in
+    GD->atoms.tables[s].  This structure contains a pointer to older
+    atom_tables (before resizing).  A resize allocates a new struct
+    atom_table, moves all atoms of the shard (updating Atom->next) and
+    makes the new atom-table current.  Sharding avoids that threads
+    creating atoms all wait for a single resize and that a resize has
+    to relink the entire atom table.
     Lookup and creation work reliable during this process because
     - If the bucket scan accidentally finds the right atom, great.
     - If not, but the atom table has changed we retry, now using
@@ -196,7 +203,8 @@ Note that threads can mark their atoms and continue execution because:
       that they can safely be walked.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-static int	rehashAtoms(void);
+static int	rehashAtoms(unsigned int shard);
+static int	shouldRehashAtoms(AtomTable t);
 static void	considerAGC(void);
 static unsigned int register_atom(volatile Atom p);
 static unsigned int unregister_atom(volatile Atom p);
@@ -359,12 +367,15 @@ static const ccharp atoms[] = {
 };
 #undef ATOM
 
+#define atomTableShard(v0) ((v0) >> (32-ATOM_TABLE_SHARD_BITS))
+
 #ifdef O_PLMT
 
-#define acquire_atom_table(t, b) \
-  { LD->thread.info->access.atom_table = GD->atoms.table; \
-    t = LD->thread.info->access.atom_table->table; \
-    b = LD->thread.info->access.atom_table->buckets; \
+#define acquire_atom_table(s, at, t, b) \
+  { LD->thread.info->access.atom_table = GD->atoms.tables[s]; \
+    at = LD->thread.info->access.atom_table; \
+    t = at->table; \
+    b = at->buckets; \
   }
 
 #define release_atom_table() \
@@ -382,9 +393,10 @@ static const ccharp atoms[] = {
 
 #else
 
-#define acquire_atom_table(t, b) \
-  { t = GD->atoms.table->table; \
-    b = GD->atoms.table->buckets; \
+#define acquire_atom_table(s, at, t, b) \
+  { at = GD->atoms.tables[s]; \
+    t = at->table; \
+    b = at->buckets; \
   }
 
 #define release_atom_table() (void)0
@@ -508,8 +520,8 @@ PL_LOCK(L_REHASH_ATOMS) around rehashAtoms() and create   their atom. If
 they manage to register the atom in   the old table before rehashAtoms()
 activates the new table the insertion   is successful, but rehashAtoms()
 may not have moved the atom to the new   table. Now we will repeat if we
-bypassed the LOCK as either GD->atoms.rehashing is TRUE or the new table
-is activated.
+bypassed the LOCK as either the rehashing flag of the table is TRUE or
+the new table is activated.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static int
@@ -521,10 +533,63 @@ same_name(const Atom a, const char *s, size_t length, const PL_blob_t *type)
 }
 
 
-word
-lookupBlob(const char *s, size_t length, PL_blob_t *type, int *new)
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Each thread keeps a small direct-mapped cache  of atoms it resolved most
+recently, indexed by the low bits of the   hash. Programs that turn the
+same texts into atoms over and over   find  the atom without walking the
+shared hash table and announcing the  table   and  bucket  to AGC.
+
+The cache does not lock its  atoms,   so  a  cached atom may have been
+collected and its slot may be  reused  by   a  new  atom. We first check
+whether the hash matches and acquire  a   reference.  This  fails if the
+atom has been invalidated. Once we   own  a reference the atom cannot be
+collected, so we can safely compare the text.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define atomCacheEntry(v0) (&LD->atoms.cache[(v0)&(ATOM_CACHE_SIZE-1)])
+
+static Atom
+lookupAtomCache(unsigned int v0, const char *s, size_t length,
+		const PL_blob_t *type ARG_LD)
+{ Atom a = *atomCacheEntry(v0);
+
+  if ( a && a->hash_value == v0 && a->length == length && a->type == type )
+  { unsigned int ref = a->references;
+
+    if ( !ATOM_IS_VALID(ref) )
+      return NULL;
+#ifdef O_ATOMGC
+    if ( indexAtom(a->atom) >= GD->atoms.builtin )
+    { if ( !bump_atom_references(a, ref) )
+	return NULL;
+      if ( a->hash_value == v0 && a->length == length && a->type == type &&
+	   same_name(a, s, length, type) )
+	return a;
+      PL_unregister_atom(a->atom);
+      return NULL;
+    }
+#endif
+    if ( same_name(a, s, length, type) )
+      return a;
+  }
+
+  return NULL;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+lookup_blob() implements lookupBlob() and  lookupAtomAdopt(). If adopt is
+TRUE, s is a buffer of at least length+padding bytes allocated using
+PL_malloc() that becomes the name  of  a   new  atom  rather than being
+copied. If the atom already exists the buffer is freed.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static word
+lookup_blob(const char *s, size_t length, PL_blob_t *type, int *new,
+	    int adopt)
 { GET_LD
-  unsigned int v0, v, ref;
+  unsigned int v0, v, ref, shard;
+  AtomTable at;
   Atom *table;
   int buckets;
   Atom a, head;
@@ -533,9 +598,19 @@ lookupBlob(const char *s, size_t length, PL_blob_t *type, int *new)
     PL_register_blob_type(type);
   v0 = MurmurHashAligned2(s, length, MURMUR_SEED);
 
+  if ( true(type, PL_BLOB_UNIQUE) &&
+       (a = lookupAtomCache(v0, s, length, type PASS_LD)) )
+  { *new = FALSE;
+    if ( adopt )
+      PL_free((char*)s);
+    return a->atom;
+  }
+
+  shard = atomTableShard(v0);
+
 redo:
 
-  acquire_atom_table(table, buckets);
+  acquire_atom_table(shard, at, table, buckets);
 
   v  = v0 & (buckets-1);
   head = table[v];
@@ -565,29 +640,38 @@ redo:
         *new = FALSE;
 	release_atom_table();
 	release_atom_bucket();
+	*atomCacheEntry(v0) = a;
+	if ( adopt )
+	  PL_free((char*)s);
 	return a->atom;
       }
     }
   }
 
-  if ( GD->atoms.table->buckets * 2 < GD->statistics.atoms )
+  if ( shouldRehashAtoms(GD->atoms.tables[shard]) )
   { int rc;
 
     PL_LOCK(L_REHASH_ATOMS);
-    rc = rehashAtoms();
+    rc = rehashAtoms(shard);
     PL_UNLOCK(L_REHASH_ATOMS);
 
     if ( !rc )
       outOfCore();
   }
 
-  if ( !( table == GD->atoms.table->table && head == table[v] ) )
+  if ( !( at == GD->atoms.tables[shard] && head == table[v] ) )
     goto redo;
 
   a = reserveAtom();
   a->length = length;
   a->type = type;
-  if ( false(type, PL_BLOB_NOCOPY) )
+  if ( adopt )
+  { size_t pad = type->padding;
+
+    a->name = (char *)s;
+    memset(a->name+length, 0, pad);
+    ATOMIC_ADD(&GD->statistics.atom_string_space, length+pad);
+  } else if ( false(type, PL_BLOB_NOCOPY) )
   { if ( type->padding )
     { size_t pad = type->padding;
 
@@ -610,10 +694,10 @@ redo:
 
   if ( true(type, PL_BLOB_UNIQUE) )
   { a->next = table[v];
-    if ( !( !GD->atoms.rehashing &&	/* See (**) above */
+    if ( !( !at->rehashing &&		/* See (**) above */
             COMPARE_AND_SWAP_PTR(&table[v], head, a) &&
-	    table == GD->atoms.table->table ) )
-    { if ( false(type, PL_BLOB_NOCOPY) )
+	    at == GD->atoms.tables[shard] ) )
+    { if ( false(type, PL_BLOB_NOCOPY) && !adopt )
         PL_free(a->name);
       a->type = ATOM_TYPE_INVALID;
       a->name = "<race>";
@@ -638,6 +722,8 @@ redo:
 
   release_atom_table();
   release_atom_bucket();
+  if ( true(type, PL_BLOB_UNIQUE) )
+    *atomCacheEntry(v0) = a;
 
   if ( ATOMIC_INC(&GD->statistics.atoms) % 128 == 0 )
     considerAGC();
@@ -646,11 +732,25 @@ redo:
 }
 
 
+word
+lookupBlob(const char *s, size_t length, PL_blob_t *type, int *new)
+{ return lookup_blob(s, length, type, new, FALSE);
+}
+
+
 word
 lookupAtom(const char *s, size_t length)
 { int new;
 
-  return lookupBlob(s, length, &text_atom, &new);
+  return lookup_blob(s, length, &text_atom, &new, FALSE);
+}
+
+
+word
+lookupAtomAdopt(char *s, size_t length)
+{ int new;
+
+  return lookup_blob(s, length, &text_atom, &new, TRUE);
 }
 
 
@@ -799,16 +899,20 @@ unmarkAtoms(void)
 
 void
 maybe_free_atom_tables(void)
-{
-  AtomTable t = GD->atoms.table;
-  while ( t )
-  { AtomTable t2 = t->prev;
-    if ( t2 && !pl_atom_table_in_use(t2) )
-    { t->prev = t2->prev;
-      freeHeap(t2->table, t2->buckets * sizeof(Atom));
-      freeHeap(t2, sizeof(atom_table));
+{ int s;
+
+  for(s=0; s<ATOM_TABLE_SHARDS; s++)
+  { AtomTable t = GD->atoms.tables[s];
+
+    while ( t )
+    { AtomTable t2 = t->prev;
+      if ( t2 && !pl_atom_table_in_use(t2) )
+      { t->prev = t2->prev;
+	freeHeap(t2->table, t2->buckets * sizeof(Atom));
+	freeHeap(t2, sizeof(atom_table));
+      }
+      t = t->prev;
     }
-    t = t->prev;
   }
 }
 
@@ -856,7 +960,7 @@ invalidateAtom(Atom a, unsigned int ref)
     uintptr_t mask;
 
   redo:
-    table = GD->atoms.table;
+    table = GD->atoms.tables[atomTableShard(a->hash_value)];
     mask = table->buckets-1;
     ap = &table->table[a->hash_value & mask];
 
@@ -898,7 +1002,7 @@ destroyAtom(Atom a, Atom **buckets)
   size_t index;
 
   while ( buckets && *buckets )
-  { t = GD->atoms.table;
+  { t = GD->atoms.tables[atomTableShard(a->hash_value)];
     while ( t )
     { v = a->hash_value & (t->buckets-1);
       if ( *buckets == t->table+v )
@@ -1008,6 +1112,8 @@ Issues around the design of the atom  garbage collector are explained at
 the start of this file.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+#define AGC_TRIM_BYTES (4*1024*1024)	/* trim heap after freeing this much */
+
 foreign_t
 pl_garbage_collect_atoms(void)
 { GET_LD
@@ -1035,6 +1141,7 @@ pl_garbage_collect_atoms(void)
 
   PL_LOCK(L_REHASH_ATOMS);
   blockSignals(&set);
+  TRACEPOINT0(agc__start);
   t = CpuTime(CPU_USER);
   unmarkAtoms();
   markAtomsOnStacks(LD);
@@ -1048,10 +1155,19 @@ pl_garbage_collect_atoms(void)
   ATOMIC_SUB(&GD->statistics.atoms, reclaimed);
   t = CpuTime(CPU_USER) - t;
   GD->atoms.gc_time += t;
+  LD->statistics.agc_time += t;
+  metricObserve(MET_AGC_SECONDS, t);
+  TRACEPOINT1(agc__done, reclaimed);
   GD->atoms.gc++;
   unblockSignals(&set);
   PL_UNLOCK(L_REHASH_ATOMS);
 
+  if ( GD->statistics.atom_string_space_freed >
+       GD->atoms.trimmed + AGC_TRIM_BYTES )
+  { GD->atoms.trimmed = GD->statistics.atom_string_space_freed;
+    trimHeap();
+  }
+
   if ( verbose )
     rc = printMessage(ATOM_informational,
 		      PL_FUNCTOR_CHARS, "agc", 1,
@@ -1291,13 +1407,14 @@ is_volatile_atom(atom_t a)
 static int
 findAtomSelf(Atom a)
 { GET_LD
+  AtomTable at;
   Atom *table;
   int buckets;
   Atom head, ap;
-  unsigned int v;
+  unsigned int v, shard = atomTableShard(a->hash_value);
 
 redo:
-  acquire_atom_table(table, buckets);
+  acquire_atom_table(shard, at, table, buckets);
   v = a->hash_value & (buckets-1);
   head = table[v];
   acquire_atom_bucket(table+v);
@@ -1310,9 +1427,11 @@ redo:
     }
   }
 
-  if ( !( table == GD->atoms.table->table && head == table[v] ) )
+  if ( !( at == GD->atoms.tables[shard] && head == table[v] ) )
     goto redo;
 
+  release_atom_table();
+  release_atom_bucket();
   return FALSE;
 }
 
@@ -1365,51 +1484,65 @@ checkAtoms_src(const char *file, int line)
 		 *	    REHASH TABLE	*
 		 *******************************/
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+rehashAtoms() doubles the number of buckets of  a single shard. It moves
+the atoms by walking the hash chains of the current table such that the
+cost is proportional to the size of the shard rather than the total atom
+table.  We assume  the  hash  distributes   the  atoms  evenly over the
+shards, which allows for deciding on  the   size  of a shard without
+maintaining per-shard statistics.
+
+Must be called with L_REHASH_ATOMS held. This   also  implies AGC is not
+running and thus atoms are not removed from the chains.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+shouldRehashAtoms(AtomTable t)
+{ return (size_t)t->buckets * 2 * ATOM_TABLE_SHARDS < GD->statistics.atoms;
+}
+
+
 static int
-rehashAtoms(void)
-{ AtomTable newtab;
+rehashAtoms(unsigned int shard)
+{ AtomTable oldtab = GD->atoms.tables[shard];
+  AtomTable newtab;
   uintptr_t mask;
-  size_t index;
-  int i, last=FALSE;
+  int i;
 
   if ( GD->cleaning != CLN_NORMAL )
     return TRUE;			/* no point anymore and foreign ->type */
 					/* pointers may have gone */
 
-  if ( GD->atoms.table->buckets * 2 >= GD->statistics.atoms )
+  if ( !shouldRehashAtoms(oldtab) )
     return TRUE;
 
   if ( !(newtab = allocHeap(sizeof(*newtab))) )
     return FALSE;
-  newtab->buckets = GD->atoms.table->buckets * 2;
+  newtab->buckets = oldtab->buckets * 2;
+  newtab->rehashing = FALSE;
   if ( !(newtab->table = allocHeapOrHalt(newtab->buckets * sizeof(Atom))) )
   { freeHeap(newtab, sizeof(*newtab));
     return FALSE;
   }
   memset(newtab->table, 0, newtab->buckets * sizeof(Atom));
-  newtab->prev = GD->atoms.table;
+  newtab->prev = oldtab;
   mask = newtab->buckets-1;
 
   DEBUG(MSG_HASH_STAT,
-	Sdprintf("rehashing atoms (%d --> %d)\n",
-		 GD->atoms.table->buckets, newtab->buckets));
+	Sdprintf("rehashing atom shard %d (%d --> %d)\n",
+		 shard, oldtab->buckets, newtab->buckets));
 
-  GD->atoms.rehashing = TRUE;
+  oldtab->rehashing = TRUE;
+  MEMORY_BARRIER();
 
-  for(index=1, i=0; !last; i++)
-  { size_t upto = (size_t)2<<i;
-    size_t high = GD->atoms.highest;
-    Atom b = GD->atoms.array.blocks[i];
+  for(i=0; i<oldtab->buckets; i++)
+  { volatile Atom a, next;
 
-    if ( upto >= high )
-    { upto = high;
-      last = TRUE;
-    }
+    for(a=oldtab->table[i]; a; a=next)
+    { unsigned int ref;
 
-    for(; index<upto; index++)
-    { volatile Atom a = b + index;
-      unsigned int ref;
-redo:
+      next = a->next;
+    redo:
       ref = a->references;
       if ( ATOM_IS_RESERVED(ref) )
       { if ( !ATOM_IS_VALID(ref) )
@@ -1424,8 +1557,8 @@ redo:
     }
   }
 
-  GD->atoms.table = newtab;
-  GD->atoms.rehashing = FALSE;
+  MEMORY_BARRIER();
+  GD->atoms.tables[shard] = newtab;
 
   return TRUE;
 }
@@ -1436,19 +1569,29 @@ pl_atom_hashstat(term_t idx, term_t n)
 { GET_LD
   long i, m;
   int buckets;
+  unsigned int shard;
+  AtomTable at;
   Atom *table;
   Atom a;
 
-  acquire_atom_table(table, buckets);
-
-  if ( !PL_get_long(idx, &i) || i < 0 || i >= (long)buckets )
-  { release_atom_table();
+  if ( !PL_get_long(idx, &i) || i < 0 )
     fail;
+
+  for(shard=0; shard<ATOM_TABLE_SHARDS; shard++)
+  { acquire_atom_table(shard, at, table, buckets);
+    if ( i < (long)buckets )
+      break;
+    i -= buckets;
+    release_atom_table();
   }
+  if ( shard == ATOM_TABLE_SHARDS )
+    fail;
+
   for(m = 0, a = table[i]; a; a = a->next)
     m++;
 
   release_atom_table();
+  (void)at;
 
   return PL_unify_integer(n, m);
 }
@@ -1465,7 +1608,8 @@ resetListAtoms(void)
 { Atom a = atomValue(ATOM_dot);
 
   if ( strcmp(a->name, ".") != 0 )
-  { Atom *ap2 = &GD->atoms.table->table[a->hash_value & (GD->atoms.table->buckets-1)];
+  { AtomTable at = GD->atoms.tables[atomTableShard(a->hash_value)];
+    Atom *ap2 = &at->table[a->hash_value & (at->buckets-1)];
     unsigned int v;
     static char *s = ".";
 
@@ -1485,10 +1629,11 @@ resetListAtoms(void)
     a->name   = s;
     a->length = strlen(s);
     a->hash_value = MurmurHashAligned2(s, a->length, MURMUR_SEED);
-    v = a->hash_value & (GD->atoms.table->buckets-1);
+    at = GD->atoms.tables[atomTableShard(a->hash_value)];
+    v = a->hash_value & (at->buckets-1);
 
-    a->next      = GD->atoms.table->table[v];
-    GD->atoms.table->table[v] = a;
+    a->next      = at->table[v];
+    at->table[v] = a;
   }
 
   a = atomValue(ATOM_nil);
@@ -1512,6 +1657,7 @@ registerBuiltinAtoms(void)
   { const char *s = *sp;
     size_t len = strlen(s);
     unsigned int v0, v;
+    AtomTable at;
 
     idx = MSB(index);
 
@@ -1525,7 +1671,8 @@ registerBuiltinAtoms(void)
     }
 
     v0 = MurmurHashAligned2(s, len, MURMUR_SEED);
-    v  = v0 & (GD->atoms.table->buckets-1);
+    at = GD->atoms.tables[atomTableShard(v0)];
+    v  = v0 & (at->buckets-1);
 
     a = &GD->atoms.array.blocks[idx][index];
     a->atom       = (index<<LMASK_BITS)|TAG_ATOM;
@@ -1538,8 +1685,8 @@ registerBuiltinAtoms(void)
 #ifdef O_TERMHASH
     a->hash_value = v0;
 #endif
-    a->next       = GD->atoms.table->table[v];
-    GD->atoms.table->table[v]  = a;
+    a->next       = at->table[v];
+    at->table[v]  = a;
 
     GD->atoms.no_hole_before = index+1;
     GD->atoms.highest = index+1;
@@ -1565,11 +1712,19 @@ void
 do_init_atoms(void)
 { PL_LOCK(L_INIT_ATOMS);
   if ( !GD->atoms.initialised )			/* Atom hash table */
-  { GD->atoms.table = allocHeapOrHalt(sizeof(*GD->atoms.table));
-    GD->atoms.table->buckets = ATOMHASHSIZE;
-    GD->atoms.table->table = allocHeapOrHalt(ATOMHASHSIZE * sizeof(Atom));
-    memset(GD->atoms.table->table, 0, ATOMHASHSIZE * sizeof(Atom));
-    GD->atoms.table->prev = NULL;
+  { int s;
+
+    for(s=0; s<ATOM_TABLE_SHARDS; s++)
+    { AtomTable at = allocHeapOrHalt(sizeof(*at));
+      size_t buckets = ATOMHASHSIZE/ATOM_TABLE_SHARDS;
+
+      at->buckets = (int)buckets;
+      at->rehashing = FALSE;
+      at->table = allocHeapOrHalt(buckets * sizeof(Atom));
+      memset(at->table, 0, buckets * sizeof(Atom));
+      at->prev = NULL;
+      GD->atoms.tables[s] = at;
+    }
 
     GD->atoms.highest = 1;
     GD->atoms.no_hole_before = 1;
@@ -1601,7 +1756,7 @@ void
 cleanupAtoms(void)
 { AtomTable table;
   size_t index;
-  int i, last=FALSE;
+  int i, s, last=FALSE;
 
   for(index=GD->atoms.builtin, i=MSB(index); !last; i++)
   { size_t upto = (size_t)2<<i;
@@ -1645,15 +1800,15 @@ cleanupAtoms(void)
     }
   }
 
-  table = GD->atoms.table;
-  while ( table )
-  { AtomTable prev = table->prev;
-    freeHeap(table->table, table->buckets * sizeof(Atom));
-    freeHeap(table, sizeof(atom_table));
-    table = prev;
-  }
-  if ( GD->atoms.table )
-  { GD->atoms.table = NULL;
+  for(s=0; s<ATOM_TABLE_SHARDS; s++)
+  { table = GD->atoms.tables[s];
+    while ( table )
+    { AtomTable prev = table->prev;
+      freeHeap(table->table, table->buckets * sizeof(Atom));
+      freeHeap(table, sizeof(atom_table));
+      table = prev;
+    }
+    GD->atoms.tables[s] = NULL;
   }
 }
 
@@ -2179,8 +2334,12 @@ atom_space(void)
 { size_t array = ((size_t)2<<MSB(GD->atoms.highest))*sizeof(struct atom);
   size_t index;
   int i, last=FALSE;
-  size_t table = GD->atoms.table->buckets * sizeof(Atom);
+  size_t table = 0;
   size_t data = 0;
+  int s;
+
+  for(s=0; s<ATOM_TABLE_SHARDS; s++)
+    table += GD->atoms.tables[s]->buckets * sizeof(Atom);
 
   for(index=1, i=0; !last; i++)
   { size_t upto = (size_t)2<<i;
@@ -128,6 +128,17 @@ clear_mem_pool(mem_pool *mp)
 
 #define FINDALL_MAGIC	0x37ac78fe
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Answers that are atoms or tagged integers need  no record. They are stored
+as their word in the answers  segment  stack   and  copied  back  to the
+global stack without further processing. Such words  always have the low
+bit of the tag set, while records are aligned pointers.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define isDirectAnswer(r)	((uintptr_t)(r) & 0x1)
+#define directAnswer(w)		((Record)(uintptr_t)(w))
+#define directAnswerWord(r)	((word)(uintptr_t)(r))
+
 typedef struct findall_bag
 { struct findall_bag *parent;		/* parent bag */
   int		magic;			/* FINDALL_MAGIC */
@@ -221,11 +232,23 @@ add_findall_bag(term_t term, term_t count ARG_LD)
 		    ERR_PERMISSION, ATOM_append, cbag, term);
   }
 
-  if ( !(r = compileTermToHeap__LD(term, alloc_record, bag, R_NOLOCK PASS_LD)) )
-    return PL_no_memory();
-  if ( !pushRecordSegStack(&bag->answers, r) )
-    return PL_no_memory();
-  bag->gsize += r->gsize;
+  { Word p = valTermRef(term);
+    word w;
+
+    deRef(p);
+    w = *p;
+    if ( isAtom(w) || isTaggedInt(w) )
+    { if ( !pushRecordSegStack(&bag->answers, directAnswer(w)) )
+	return PL_no_memory();
+    } else
+    { if ( !(r = compileTermToHeap__LD(term, alloc_record, bag,
+				       R_NOLOCK PASS_LD)) )
+	return PL_no_memory();
+      if ( !pushRecordSegStack(&bag->answers, r) )
+	return PL_no_memory();
+      bag->gsize += r->gsize;
+    }
+  }
   bag->solutions++;
 
   if ( bag->gsize + bag->solutions*3 > globalStackLimit()/sizeof(word) )
@@ -272,9 +295,17 @@ PRED_IMPL("$collect_findall_bag", 2, collect_findall_bag, 0)
     while ( (rp=topOfSegStack(&bag->answers)) )
     { Record r = *rp;
       DEBUG(MSG_NSOLS, Sdprintf("Retrieving answer\n"));
-      copyRecordToGlobal(answer, r, ALLOW_GC PASS_LD);
-      if (GD->atoms.gc_active)
-        markAtomsRecord(r);
+      if ( isDirectAnswer(r) )
+      { word w = directAnswerWord(r);
+
+	*valTermRef(answer) = w;
+	if ( GD->atoms.gc_active && isAtom(w) )
+	  markAtom(w);
+      } else
+      { copyRecordToGlobal(answer, r, ALLOW_GC PASS_LD);
+	if (GD->atoms.gc_active)
+	  markAtomsRecord(r);
+      }
       PL_cons_list(list, answer, list);
 #ifdef O_ATOMGC
 		/* see comment with scanSegStack() for synchronization details */
@@ -375,7 +406,14 @@ static void
 markAtomsAnswers(void *data)
 { Record r = *((Record*)data);
 
-  markAtomsRecord(r);
+  if ( isDirectAnswer(r) )
+  { word w = directAnswerWord(r);
+
+    if ( isAtom(w) )
+      markAtom(w);
+  } else
+  { markAtomsRecord(r);
+  }
 }
 
 
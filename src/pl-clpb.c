@@ -0,0 +1,725 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+#include "pl-incl.h"
+
+#undef LD
+#define LD LOCAL_LD
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Support for library(clpb).  BDD nodes remain Prolog terms of the form
+
+	node(ID, Var, Low, High, Aux)
+
+so they are reclaimed by the garbage collector and restored on
+backtracking like any other term.  This module provides the unique table
+that keeps the BDDs reduced and the apply operation that combines two
+BDDs:
+
+  - Each CLP(B) variable has a clpb_hash attribute holding its unique
+    table, a term '$bdd_table'(Count, Buckets), where Buckets is a
+    compound b(L1, ..., Ln) of lists of nodes hashed on the IDs of
+    Low and High.  The table is updated using backtrackable
+    destructive assignment, as setarg/3.
+  - '$bdd_apply'/6 runs apply without recursion on the C stack and with
+    a C hash table for memoization.  It fails if it finds a node it
+    cannot handle, notably one whose variable has been bound, leaving
+    the Prolog implementation to deal with these.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static functor_t FUNCTOR_node5;
+static functor_t FUNCTOR_bdd_table2;
+static functor_t FUNCTOR_index_root2;
+static atom_t	 ATOM_clpb;
+static atom_t	 ATOM_clpb_hash;
+static atom_t	 ATOM_hash_op;
+static atom_t	 ATOM_b;
+
+static void
+init_clpb_functors(void)
+{ if ( !ATOM_b )
+  { ATOM_clpb	        = PL_new_atom("clpb");
+    ATOM_clpb_hash      = PL_new_atom("clpb_hash");
+    FUNCTOR_node5       = PL_new_functor(PL_new_atom("node"), 5);
+    FUNCTOR_bdd_table2  = PL_new_functor(PL_new_atom("$bdd_table"), 2);
+    FUNCTOR_index_root2 = PL_new_functor(PL_new_atom("index_root"), 2);
+    ATOM_hash_op	        = PL_new_atom("#");
+    ATOM_b	        = PL_new_atom("b");
+  }
+}
+
+
+		 /*******************************
+		 *	       NODES		*
+		 *******************************/
+
+/* bdd_key() maps the terminals 0 and 1 to themselves and a node to its
+   ID+2.  Fails if t is not a BDD.
+*/
+
+static int
+bdd_key(term_t t, int64_t *key ARG_LD)
+{ Word p = valTermRef(t);
+
+  deRef(p);
+  if ( isTaggedInt(*p) )
+  { intptr_t v = valInt(*p);
+
+    if ( v == 0 || v == 1 )
+    { *key = v;
+      return TRUE;
+    }
+  } else if ( hasFunctor(*p, FUNCTOR_node5) )
+  { Word a = argTermP(*p, 0);
+
+    deRef(a);
+    if ( isTaggedInt(*a) && valInt(*a) >= 0 )
+    { *key = valInt(*a)+2;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+
+/* bdd_attr() finds the value of the attribute  named `name' of the
+   variable at p.
+*/
+
+static int
+bdd_attr(Word p, atom_t name, term_t value ARG_LD)
+{ Word l;
+
+  deRef(p);
+  if ( !isAttVar(*p) )
+    return FALSE;
+
+  l = valPAttVar(*p);
+  deRef(l);
+  while ( hasFunctor(*l, FUNCTOR_att3) )
+  { Word n = argTermP(*l, 0);
+
+    deRef(n);
+    if ( *n == name )
+    { *valTermRef(value) = linkVal(argTermP(*l, 1));
+      return TRUE;
+    }
+    l = argTermP(*l, 2);
+    deRef(l);
+  }
+
+  return FALSE;
+}
+
+
+/* bdd_var_index() gets the branching variable of a node and its index
+   from the clpb attribute index_root(Index, Root).  Terminals get the
+   index INT64_MAX.
+*/
+
+static int
+bdd_var_index(term_t node, term_t var, int64_t *index ARG_LD)
+{ Word p = valTermRef(node);
+  term_t ir;
+
+  deRef(p);
+  if ( isTaggedInt(*p) )
+  { *index = INT64_MAX;
+    return TRUE;
+  }
+
+  *valTermRef(var) = linkVal(argTermP(*p, 1));
+  ir = PL_new_term_ref();
+  if ( bdd_attr(valTermRef(var), ATOM_clpb, ir PASS_LD) &&
+       PL_is_functor(ir, FUNCTOR_index_root2) )
+  { _PL_get_arg(1, ir, ir);
+    if ( PL_get_int64(ir, index) )
+    { PL_reset_term_refs(ir);
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+
+		 /*******************************
+		 *	    UNIQUE TABLE	*
+		 *******************************/
+
+static size_t
+bdd_hash(int64_t low, int64_t high, size_t buckets)
+{ uint64_t h = (uint64_t)low*0x9e3779b97f4a7c15ULL ^ (uint64_t)high;
+
+  h ^= h >> 29;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 32;
+
+  return (size_t)(h % buckets);
+}
+
+
+/* bdd_setarg() is the backtrackable assignment of setarg/3 */
+
+static int
+bdd_setarg(term_t t, size_t argn, term_t value ARG_LD)
+{ Word a;
+
+  if ( !hasGlobalSpace(0) )
+  { int rc;
+
+    if ( (rc=ensureGlobalSpace(0, ALLOW_GC)) != TRUE )
+      return raiseStackOverflow(rc);
+  }
+
+  a = valTermRef(t);
+  deRef(a);
+  a = argTermP(*a, argn-1);
+  TrailAssignment(a);
+  unify_vp(a, valTermRef(value) PASS_LD);
+
+  return TRUE;
+}
+
+
+static int
+get_bdd_table(term_t table, term_t buckets, size_t *size, int64_t *count ARG_LD)
+{ atom_t name;
+
+  return ( PL_is_functor(table, FUNCTOR_bdd_table2) &&
+	   _PL_get_arg(2, table, buckets) &&
+	   PL_get_name_arity(buckets, &name, size) &&
+	   *size > 0 &&
+	   _PL_get_arg(1, table, buckets) &&
+	   PL_get_int64(buckets, count) &&
+	   _PL_get_arg(2, table, buckets) );
+}
+
+
+static int
+node_child_keys(term_t node, int64_t *low, int64_t *high ARG_LD)
+{ term_t c = PL_new_term_ref();
+  int rc = ( _PL_get_arg(3, node, c) && bdd_key(c, low PASS_LD) &&
+	     _PL_get_arg(4, node, c) && bdd_key(c, high PASS_LD) );
+
+  PL_reset_term_refs(c);
+  return rc;
+}
+
+
+/* bdd_lookup() finds the node with children Low and High, identified by
+   their keys, in a unique table.
+*/
+
+static int
+bdd_lookup(term_t table, int64_t low, int64_t high, term_t node ARG_LD)
+{ term_t buckets = PL_new_term_ref();
+  term_t l = PL_new_term_ref();
+  size_t size;
+  int64_t count;
+
+  if ( get_bdd_table(table, buckets, &size, &count PASS_LD) &&
+       _PL_get_arg(bdd_hash(low, high, size)+1, buckets, l) )
+  { while ( PL_get_list(l, node, l) )
+    { int64_t nl, nh;
+
+      if ( node_child_keys(node, &nl, &nh PASS_LD) && nl == low && nh == high )
+      { PL_reset_term_refs(buckets);
+	return TRUE;
+      }
+    }
+  }
+
+  PL_reset_term_refs(buckets);
+  return FALSE;
+}
+
+
+/* bdd_resize() replaces the buckets of a table by size buckets */
+
+static int
+bdd_resize(term_t table, term_t buckets, size_t size ARG_LD)
+{ term_t lists = PL_new_term_refs(size);
+  term_t l     = PL_new_term_ref();
+  term_t node  = PL_new_term_ref();
+  size_t osize, i;
+  atom_t name;
+
+  if ( !PL_get_name_arity(buckets, &name, &osize) )
+    return FALSE;
+  for(i=0; i<size; i++)
+    PL_put_nil(lists+i);
+  for(i=1; i<=osize; i++)
+  { _PL_get_arg(i, buckets, l);
+    while ( PL_get_list(l, node, l) )
+    { int64_t low, high;
+      term_t b;
+
+      if ( !node_child_keys(node, &low, &high PASS_LD) )
+	return FALSE;
+      b = lists+bdd_hash(low, high, size);
+      if ( !PL_cons_list(b, node, b) )
+	return FALSE;
+    }
+  }
+
+  if ( !PL_cons_functor_v(l, PL_new_functor(ATOM_b, size), lists) ||
+       !bdd_setarg(table, 2, l PASS_LD) )
+    return FALSE;
+
+  PL_put_term(buckets, l);
+  return TRUE;
+}
+
+
+/* bdd_register() adds a node to a unique table, doubling the number of
+   buckets if the average chain length exceeds 2.
+*/
+
+static int
+bdd_register(term_t table, term_t node ARG_LD)
+{ term_t buckets = PL_new_term_ref();
+  term_t t = PL_new_term_ref();
+  size_t size, i;
+  int64_t count, low, high;
+  int rc;
+
+  if ( !get_bdd_table(table, buckets, &size, &count PASS_LD) ||
+       !node_child_keys(node, &low, &high PASS_LD) )
+    return PL_type_error("bdd_table", table);
+
+  if ( (size_t)count >= size*2 &&
+       !bdd_resize(table, buckets, size*2 PASS_LD) )
+    return FALSE;
+
+  if ( !PL_get_name_arity(buckets, NULL, &size) )
+    return FALSE;
+  i = bdd_hash(low, high, size)+1;
+  rc = ( _PL_get_arg(i, buckets, t) &&
+	 PL_cons_list(t, node, t) &&
+	 bdd_setarg(buckets, i, t PASS_LD) &&
+	 PL_put_int64(t, count+1) &&
+	 bdd_setarg(table, 1, t PASS_LD) );
+
+  PL_reset_term_refs(buckets);
+  return rc;
+}
+
+
+/** '$bdd_lookup'(+Table, +Low, +High, -Node) is semidet.
+ *
+ * Node is the node in Table with children Low and High.
+ */
+
+static
+PRED_IMPL("$bdd_lookup", 4, bdd_lookup, 0)
+{ PRED_LD
+  term_t node = PL_new_term_ref();
+  int64_t low, high;
+
+  init_clpb_functors();
+
+  return ( bdd_key(A2, &low PASS_LD) &&
+	   bdd_key(A3, &high PASS_LD) &&
+	   bdd_lookup(A1, low, high, node PASS_LD) &&
+	   PL_unify(A4, node) );
+}
+
+
+/** '$bdd_register'(+Table, +Node) is det.
+ *
+ * Add Node to Table.  The modification is undone on backtracking.
+ */
+
+static
+PRED_IMPL("$bdd_register", 2, bdd_register, 0)
+{ PRED_LD
+
+  init_clpb_functors();
+
+  return bdd_register(A1, A2 PASS_LD);
+}
+
+
+		 /*******************************
+		 *	       APPLY		*
+		 *******************************/
+
+typedef enum
+{ BDD_OR = 0,
+  BDD_AND,
+  BDD_XOR
+} bdd_op;
+
+typedef struct apply_frame
+{ term_t	a;			/* first operand, then its high child */
+  term_t	b;			/* second operand, then its high child */
+  term_t	var;			/* branching variable */
+  term_t	low;			/* result for the low children */
+  int64_t	ka;			/* key of the operands */
+  int64_t	kb;
+  int		state;			/* 0: new, 1: in low, 2: in high */
+} apply_frame;
+
+typedef struct memo_entry
+{ int64_t	ka;
+  int64_t	kb;
+  term_t	result;			/* 0: empty */
+} memo_entry;
+
+typedef struct apply_state
+{ bdd_op	op;
+  int64_t	next_id;		/* ID of the next new node */
+  apply_frame  *stack;
+  size_t	depth;			/* # used frames */
+  size_t	allocated;		/* # allocated frames */
+  memo_entry   *memo;
+  size_t	memo_size;		/* power of 2 */
+  size_t	memo_count;
+} apply_state;
+
+
+static int
+bool_op(bdd_op op, int64_t a, int64_t b)
+{ switch(op)
+  { case BDD_OR:  return (int)(a|b);
+    case BDD_AND: return (int)(a&b);
+    default:	  return (int)(a^b);
+  }
+}
+
+
+/* apply_shortcut() handles the cases where the result follows without
+   looking at the nodes.  Sets result and returns TRUE if it applies.
+*/
+
+static int
+apply_shortcut(bdd_op op, term_t a, int64_t ka, term_t b, int64_t kb,
+	       term_t result ARG_LD)
+{ if ( ka < 2 && kb < 2 )
+  { PL_put_integer(result, bool_op(op, ka, kb));
+    return TRUE;
+  }
+
+  switch(op)
+  { case BDD_OR:
+      if ( ka == 1 || kb == 1 )
+	return PL_put_integer(result, 1);
+      if ( ka == 0 )
+	return PL_put_term(result, b);
+      if ( kb == 0 || ka == kb )
+	return PL_put_term(result, a);
+      break;
+    case BDD_AND:
+      if ( ka == 0 || kb == 0 )
+	return PL_put_integer(result, 0);
+      if ( ka == 1 )
+	return PL_put_term(result, b);
+      if ( kb == 1 || ka == kb )
+	return PL_put_term(result, a);
+      break;
+    case BDD_XOR:
+      if ( ka == 0 )
+	return PL_put_term(result, b);
+      if ( kb == 0 )
+	return PL_put_term(result, a);
+      if ( ka == kb )
+	return PL_put_integer(result, 0);
+      break;
+  }
+
+  return FALSE;
+}
+
+
+static memo_entry *
+memo_find(apply_state *state, int64_t ka, int64_t kb)
+{ size_t mask = state->memo_size-1;
+  size_t i = bdd_hash(ka, kb, state->memo_size);
+
+  for(;; i = (i+1)&mask)
+  { memo_entry *e = &state->memo[i];
+
+    if ( !e->result || (e->ka == ka && e->kb == kb) )
+      return e;
+  }
+}
+
+
+static int
+memo_add(apply_state *state, int64_t ka, int64_t kb, term_t result ARG_LD)
+{ memo_entry *e;
+
+  if ( (state->memo_count+1)*4 > state->memo_size*3 )
+  { memo_entry *old = state->memo;
+    size_t osize = state->memo_size;
+    size_t i;
+
+    state->memo_size = osize ? osize*2 : 1024;
+    if ( !(state->memo = calloc(state->memo_size, sizeof(*state->memo))) )
+    { state->memo = old;
+      return PL_no_memory();
+    }
+    for(i=0; i<osize; i++)
+    { if ( old[i].result )
+	*memo_find(state, old[i].ka, old[i].kb) = old[i];
+    }
+    free(old);
+  }
+
+  e = memo_find(state, ka, kb);
+  if ( !e->result )
+  { if ( !(e->result = PL_new_term_ref()) )
+      return FALSE;
+    e->ka = ka;
+    e->kb = kb;
+    state->memo_count++;
+  }
+
+  return PL_put_term(e->result, result);
+}
+
+
+static apply_frame *
+push_frame(apply_state *state, term_t a, term_t b ARG_LD)
+{ apply_frame *f;
+
+  if ( state->depth == state->allocated )
+  { size_t n = state->allocated ? state->allocated*2 : 64;
+    apply_frame *new = realloc(state->stack, n*sizeof(*new));
+    size_t i;
+
+    if ( !new )
+    { PL_no_memory();
+      return NULL;
+    }
+    state->stack = new;
+    for(i=state->allocated; i<n; i++)
+      new[i].a = 0;
+    state->allocated = n;
+  }
+
+  f = &state->stack[state->depth];
+  if ( !f->a )
+  { term_t refs;
+
+    if ( !(refs = PL_new_term_refs(4)) )
+      return NULL;
+    f->a   = refs;
+    f->b   = refs+1;
+    f->var = refs+2;
+    f->low = refs+3;
+  }
+  if ( !PL_put_term(f->a, a) || !PL_put_term(f->b, b) )
+    return NULL;
+  f->state = 0;
+  state->depth++;
+
+  return f;
+}
+
+
+/* make_node() creates or finds node(ID, Var, Low, High, _) in the unique
+   table of Var and leaves it in result.
+*/
+
+static int
+make_node(apply_state *state, term_t var, term_t low, term_t result ARG_LD)
+{ term_t table = PL_new_term_ref();
+  term_t high = PL_copy_term_ref(result);
+  int64_t kl, kh;
+  int rc;
+
+  if ( !bdd_key(low, &kl PASS_LD) || !bdd_key(high, &kh PASS_LD) )
+    return FALSE;
+  if ( kl == kh )
+  { PL_put_term(result, low);
+  } else
+  { if ( !bdd_attr(valTermRef(var), ATOM_clpb_hash, table PASS_LD) )
+      return FALSE;
+    if ( !bdd_lookup(table, kl, kh, result PASS_LD) )
+    { term_t id  = PL_new_term_ref();
+      term_t aux = PL_new_term_ref();
+
+      rc = ( PL_put_int64(id, state->next_id++) &&
+	     PL_cons_functor(result, FUNCTOR_node5, id, var, low, high, aux) &&
+	     bdd_register(table, result PASS_LD) );
+      if ( !rc )
+	return FALSE;
+    }
+  }
+
+  PL_reset_term_refs(table);
+  return TRUE;
+}
+
+
+/* bdd_cofactor() puts the low and high child of node in low and high if
+   node branches on the variable with the given index.  Else both are
+   the node itself.
+*/
+
+static void
+bdd_cofactor(term_t node, int64_t nindex, int64_t index,
+	     term_t low, term_t high ARG_LD)
+{ if ( nindex == index )
+  { _PL_get_arg(3, node, low);
+    _PL_get_arg(4, node, high);
+  } else
+  { PL_put_term(low, node);
+    PL_put_term(high, node);
+  }
+}
+
+
+static int
+bdd_apply(apply_state *state, term_t a, term_t b, term_t result ARG_LD)
+{ term_t ta = PL_new_term_refs(4);
+  term_t tb = ta+1;
+  term_t va = ta+2;
+  term_t vb = ta+3;
+  size_t steps = 0;
+
+  if ( !push_frame(state, a, b PASS_LD) )
+    return FALSE;
+
+  while( state->depth > 0 )
+  { apply_frame *f = &state->stack[state->depth-1];
+
+    switch(f->state)
+    { case 0:
+      { int64_t ia, ib, index;
+	memo_entry *e;
+
+	if ( ++steps % 10000 == 0 && PL_handle_signals() < 0 )
+	  return FALSE;
+
+	if ( !bdd_key(f->a, &f->ka PASS_LD) ||
+	     !bdd_key(f->b, &f->kb PASS_LD) )
+	  return FALSE;
+	if ( apply_shortcut(state->op, f->a, f->ka, f->b, f->kb, result PASS_LD) )
+	  break;
+	if ( state->memo_size &&
+	     (e=memo_find(state, f->ka, f->kb))->result )
+	{ PL_put_term(result, e->result);
+	  break;
+	}
+
+	if ( !bdd_var_index(f->a, va, &ia PASS_LD) ||
+	     !bdd_var_index(f->b, vb, &ib PASS_LD) )
+	  return FALSE;
+	index = ia < ib ? ia : ib;
+	PL_put_term(f->var, ia == index ? va : vb);
+	bdd_cofactor(f->a, ia, index, ta, f->a PASS_LD);
+	bdd_cofactor(f->b, ib, index, tb, f->b PASS_LD);
+	f->state = 1;
+	if ( !push_frame(state, ta, tb PASS_LD) )
+	  return FALSE;
+	continue;
+      }
+      case 1:
+	PL_put_term(f->low, result);
+	f->state = 2;
+	if ( !push_frame(state, f->a, f->b PASS_LD) )
+	  return FALSE;
+	continue;
+      case 2:
+	if ( !make_node(state, f->var, f->low, result PASS_LD) ||
+	     !memo_add(state, f->ka, f->kb, result PASS_LD) )
+	  return FALSE;
+	break;
+    }
+
+    state->depth--;			/* result is in result */
+  }
+
+  return TRUE;
+}
+
+
+/** '$bdd_apply'(+Op, +NodeA, +NodeB, -Node, +ID0, -ID) is semidet.
+ *
+ * Node is the BDD for Op(NodeA, NodeB), where Op is one of +, * or #.
+ * New nodes are numbered starting at ID0 and ID is the first free
+ * number.  Fails if the BDDs contain a node that is not handled, in
+ * which case the caller must use the Prolog implementation.
+ */
+
+static
+PRED_IMPL("$bdd_apply", 6, bdd_apply, 0)
+{ PRED_LD
+  apply_state state = {0};
+  term_t result = PL_new_term_ref();
+  atom_t op;
+  int rc;
+
+  init_clpb_functors();
+
+  if ( !PL_get_atom_ex(A1, &op) ||
+       !PL_get_int64_ex(A5, &state.next_id) )
+    return FALSE;
+  if ( op == ATOM_plus )
+    state.op = BDD_OR;
+  else if ( op == ATOM_star )
+    state.op = BDD_AND;
+  else if ( op == ATOM_hash_op )
+    state.op = BDD_XOR;
+  else
+    return FALSE;
+
+  rc = ( bdd_apply(&state, A2, A3, result PASS_LD) &&
+	 PL_unify(A4, result) &&
+	 PL_unify_int64(A6, state.next_id) );
+
+  if ( state.stack )
+    free(state.stack);
+  if ( state.memo )
+    free(state.memo);
+
+  return rc;
+}
+
+
+		 /*******************************
+		 *      PUBLISH PREDICATES	*
+		 *******************************/
+
+BeginPredDefs(clpb)
+  PRED_DEF("$bdd_lookup", 4, bdd_lookup, 0)
+  PRED_DEF("$bdd_register", 2, bdd_register, 0)
+  PRED_DEF("$bdd_apply", 6, bdd_apply, 0)
+EndPredDefs
@@ -0,0 +1,833 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "pl-incl.h"
+
+#undef LD
+#define LD LOCAL_LD
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Support for library(clpfd).  The solver  is   written  in Prolog. This
+module provides C versions of  two  hot   spots  that  only  read the
+constraint store and leave all updates to Prolog:
+
+  - '$fd_distinct'/3 runs Regin's filtering algorithm for all_distinct/1.
+    The Prolog version represents the  value   graph  using attributed
+    variables, which makes it slow for large problems.
+  - '$fd_sum_bounds'/6 computes the bounds of a linear sum as
+    sum_finite_domains/8.  It reads the domains from the clpfd
+    attributes, so it depends on the layout of clpfd_attr/5 and the
+    domain terms from_to/2, split/3 and n/1.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static functor_t FUNCTOR_clpfd_attr5;
+static functor_t FUNCTOR_from_to2;
+static functor_t FUNCTOR_split3;
+static functor_t FUNCTOR_n1;
+static atom_t	 ATOM_clpfd;
+static atom_t	 ATOM_empty;
+
+static void
+init_clpfd_functors(void)
+{ if ( !FUNCTOR_n1 )
+  { ATOM_clpfd	        = PL_new_atom("clpfd");
+    ATOM_empty	        = PL_new_atom("empty");
+    FUNCTOR_clpfd_attr5 = PL_new_functor(PL_new_atom("clpfd_attr"), 5);
+    FUNCTOR_from_to2    = PL_new_functor(PL_new_atom("from_to"), 2);
+    FUNCTOR_split3      = PL_new_functor(PL_new_atom("split"), 3);
+    FUNCTOR_n1	        = PL_new_functor(PL_new_atom("n"), 1);
+  }
+}
+
+
+		 /*******************************
+		 *	      DOMAINS		*
+		 *******************************/
+
+/* get_bound() gets  the  integer  from   n(I).  Returns  FALSE  for the
+   infinite bounds inf and sup and for integers that do not fit int64.
+*/
+
+static int
+get_bound(term_t b, int64_t *v ARG_LD)
+{ term_t a;
+
+  if ( PL_is_functor(b, FUNCTOR_n1) &&
+       (a = PL_new_term_ref()) &&
+       _PL_get_arg(1, b, a) &&
+       PL_get_int64(a, v) )
+    return TRUE;
+
+  return FALSE;
+}
+
+/* domain_bound() finds the  infimum   (which=1)  or  supremum (which=2)
+   of a domain term.  Unifies  b  with   the  bound  term,  which is
+   n(I), inf or sup.
+*/
+
+static int
+domain_bound(term_t dom, int which, term_t b ARG_LD)
+{ term_t d = PL_copy_term_ref(dom);
+
+  for(;;)
+  { if ( PL_is_functor(d, FUNCTOR_split3) )
+    { _PL_get_arg(which+1, d, d);
+    } else if ( PL_is_functor(d, FUNCTOR_from_to2) )
+    { _PL_get_arg(which, d, b);
+      return TRUE;
+    } else
+      return FALSE;
+  }
+}
+
+
+/* fd_domain() gets the domain of  a   clpfd  variable.  Returns FALSE
+   if v has no clpfd attribute.
+*/
+
+static int
+fd_domain(term_t v, term_t dom ARG_LD)
+{ term_t al = PL_new_term_ref();
+  term_t m  = PL_new_term_ref();
+
+  if ( !PL_get_attr(v, al) )
+    return FALSE;
+
+  while( PL_is_functor(al, FUNCTOR_att3) )
+  { atom_t name;
+
+    _PL_get_arg(1, al, m);
+    if ( PL_get_atom(m, &name) && name == ATOM_clpfd )
+    { _PL_get_arg(2, al, m);
+      return ( PL_is_functor(m, FUNCTOR_clpfd_attr5) &&
+	       _PL_get_arg(4, m, dom) );
+    }
+    _PL_get_arg(3, al, al);
+  }
+
+  return FALSE;
+}
+
+
+		 /*******************************
+		 *	   ALL DISTINCT		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The value graph has  a  node  for   each  variable  and  each value in
+the union of their domains. Edges  are   stored  per  variable  in a
+compressed adjacency array.  We compute a  maximum matching using the
+Hopcroft-Karp algorithm and orient the graph: matched edges point from
+the variable to its value and free  edges   from  the  value to the
+variable.  An edge that is not matched can  be removed if it is not on
+an alternating path starting at a free value and its nodes are in
+different strongly connected components.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define NO_NODE (-1)
+#define NO_DIST INT_MAX
+
+typedef struct value_table
+{ int64_t      *keys;
+  int	       *ids;
+  size_t	size;			/* power of 2 */
+  int		count;
+} value_table;
+
+typedef struct vgraph
+{ int		nvars;
+  int		nvals;
+  size_t	nedges;
+  size_t       *var_edges;		/* nvars+1 offsets into var_adj */
+  int	       *var_adj;		/* value ids */
+  int64_t      *values;			/* id --> value */
+  size_t       *val_edges;		/* nvals+1 offsets into val_adj */
+  int	       *val_adj;		/* variable ids */
+  int	       *var_mate;		/* var --> value or NO_NODE */
+  int	       *val_mate;		/* value --> var or NO_NODE */
+} vgraph;
+
+static unsigned int
+hash_value(int64_t v)
+{ uint64_t k = (uint64_t)v;
+
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+
+  return (unsigned int)k;
+}
+
+static int
+value_id(value_table *t, int64_t v, int64_t **values, size_t *vsize)
+{ size_t i = hash_value(v) & (t->size-1);
+
+  while( t->ids[i] != NO_NODE )
+  { if ( t->keys[i] == v )
+      return t->ids[i];
+    i = (i+1) & (t->size-1);
+  }
+
+  if ( (size_t)t->count >= *vsize )
+  { size_t nsize = *vsize*2;
+    int64_t *nv = realloc(*values, nsize*sizeof(**values));
+
+    if ( !nv )
+      return NO_NODE;
+    *values = nv;
+    *vsize = nsize;
+  }
+  t->keys[i] = v;
+  t->ids[i] = t->count;
+  (*values)[t->count] = v;
+
+  return t->count++;
+}
+
+
+static void
+free_vgraph(vgraph *g)
+{ free(g->var_edges);
+  free(g->var_adj);
+  free(g->values);
+  free(g->val_edges);
+  free(g->val_adj);
+  free(g->var_mate);
+  free(g->val_mate);
+}
+
+
+/* add_domain_edges() adds an edge  from  var   to  each  value  in the
+   domain.  Returns -1 on a malformed domain and 0 if we are out of
+   memory.
+*/
+
+static int
+add_domain_edges(term_t dom, vgraph *g, value_table *t, size_t *esize,
+		 size_t *vsize ARG_LD)
+{ if ( PL_is_functor(dom, FUNCTOR_split3) )
+  { term_t a = PL_new_term_ref();
+    int rc;
+
+    _PL_get_arg(2, dom, a);
+    if ( (rc=add_domain_edges(a, g, t, esize, vsize PASS_LD)) != 1 )
+      return rc;
+    _PL_get_arg(3, dom, a);
+    rc = add_domain_edges(a, g, t, esize, vsize PASS_LD);
+    PL_reset_term_refs(a);
+    return rc;
+  } else if ( PL_is_functor(dom, FUNCTOR_from_to2) )
+  { term_t b = PL_new_term_ref();
+    int64_t from, to, v;
+
+    _PL_get_arg(1, dom, b);
+    if ( !get_bound(b, &from PASS_LD) )
+      return -1;
+    _PL_get_arg(2, dom, b);
+    if ( !get_bound(b, &to PASS_LD) )
+      return -1;
+    PL_reset_term_refs(b);
+
+    for(v=from; v<=to; v++)
+    { int id;
+
+      if ( g->nedges >= *esize )
+	return -1;			/* caller checked the size */
+      if ( (id = value_id(t, v, &g->values, vsize)) == NO_NODE )
+	return 0;
+      g->var_adj[g->nedges++] = id;
+      if ( v == to )
+	break;
+    }
+    return 1;
+  } else
+  { atom_t a;
+
+    return PL_get_atom(dom, &a) && a == ATOM_empty ? 1 : -1;
+  }
+}
+
+
+/* Hopcroft-Karp.  bfs_layers() computes  the   distance  of  each var
+   from a free var  in  the  alternating   graph  and  returns TRUE if
+   a free value is reachable.  augment() finds  an augmenting path from
+   var using an explicit stack.
+*/
+
+static int
+bfs_layers(vgraph *g, int *dist, int *queue)
+{ int head = 0, tail = 0;
+  int found = FALSE;
+
+  for(int x=0; x<g->nvars; x++)
+  { if ( g->var_mate[x] == NO_NODE )
+    { dist[x] = 0;
+      queue[tail++] = x;
+    } else
+    { dist[x] = NO_DIST;
+    }
+  }
+
+  while(head < tail)
+  { int x = queue[head++];
+
+    for(size_t e=g->var_edges[x]; e<g->var_edges[x+1]; e++)
+    { int w = g->val_mate[g->var_adj[e]];
+
+      if ( w == NO_NODE )
+	found = TRUE;
+      else if ( dist[w] == NO_DIST )
+      { dist[w] = dist[x]+1;
+	queue[tail++] = w;
+      }
+    }
+  }
+
+  return found;
+}
+
+static int
+augment(vgraph *g, int x0, int *dist, size_t *it, int *stack)
+{ int sp = 0;
+
+  stack[sp++] = x0;
+  while(sp > 0)
+  { int x = stack[sp-1];
+
+    if ( it[x] == g->var_edges[x+1] )
+    { dist[x] = NO_DIST;
+      if ( --sp > 0 )
+	it[stack[sp-1]]++;
+      continue;
+    } else
+    { int w = g->val_mate[g->var_adj[it[x]]];
+
+      if ( w == NO_NODE )
+      { for(int i=sp-1; i>=0; i--)
+	{ int y = stack[i];
+	  int v = g->var_adj[it[y]];
+
+	  g->var_mate[y] = v;
+	  g->val_mate[v] = y;
+	}
+	return TRUE;
+      } else if ( dist[w] == dist[x]+1 )
+      { stack[sp++] = w;
+      } else
+      { it[x]++;
+      }
+    }
+  }
+
+  return FALSE;
+}
+
+static int
+maximum_matching(vgraph *g)
+{ int *dist  = malloc(g->nvars*sizeof(int));
+  int *queue = malloc(g->nvars*sizeof(int));
+  int *stack = malloc(g->nvars*sizeof(int));
+  size_t *it = malloc(g->nvars*sizeof(size_t));
+  int matched = 0;
+  int rc = -1;
+
+  if ( !dist || !queue || !stack || !it )
+    goto out;
+
+  while( bfs_layers(g, dist, queue) )
+  { int progress = 0;
+
+    for(int x=0; x<g->nvars; x++)
+      it[x] = g->var_edges[x];
+    for(int x=0; x<g->nvars; x++)
+    { if ( g->var_mate[x] == NO_NODE && augment(g, x, dist, it, stack) )
+	progress++;
+    }
+    if ( !progress )
+      break;
+    matched += progress;
+  }
+  rc = (matched == g->nvars);
+
+out:
+  free(dist);
+  free(queue);
+  free(stack);
+  free(it);
+
+  return rc;
+}
+
+
+/* Tarjan's SCC algorithm on the oriented value  graph.  Nodes 0..nvars-1
+   are variables, nvars.. are values.  The successor of a variable is
+   its mate.  The successors of a value are the variables connected by
+   a free edge.
+*/
+
+typedef struct scc_state
+{ int	       *index;
+  int	       *lowlink;
+  int	       *component;
+  char	       *on_stack;
+  int	       *stack;
+  int		sp;
+  int	       *cstack;			/* call stack: nodes */
+  size_t       *cit;			/* call stack: successor iterator */
+  int		next_index;
+  int		next_component;
+} scc_state;
+
+static int
+scc_successor(vgraph *g, int node, size_t *it)
+{ if ( node < g->nvars )
+  { if ( *it == 0 )
+    { (*it)++;
+      return g->nvars + g->var_mate[node];
+    }
+    return NO_NODE;
+  } else
+  { int v = node - g->nvars;
+
+    while( g->val_edges[v] + *it < g->val_edges[v+1] )
+    { int x = g->val_adj[g->val_edges[v] + (*it)++];
+
+      if ( g->var_mate[x] != v )
+	return x;
+    }
+    return NO_NODE;
+  }
+}
+
+static void
+scc_visit(vgraph *g, scc_state *s, int root)
+{ int csp = 0;
+
+  s->cstack[csp] = root;
+  s->cit[csp++] = 0;
+  s->index[root] = s->lowlink[root] = s->next_index++;
+  s->stack[s->sp++] = root;
+  s->on_stack[root] = TRUE;
+
+  while(csp > 0)
+  { int node = s->cstack[csp-1];
+    int next = scc_successor(g, node, &s->cit[csp-1]);
+
+    if ( next != NO_NODE )
+    { if ( s->index[next] == NO_NODE )
+      { s->index[next] = s->lowlink[next] = s->next_index++;
+	s->stack[s->sp++] = next;
+	s->on_stack[next] = TRUE;
+	s->cstack[csp] = next;
+	s->cit[csp++] = 0;
+      } else if ( s->on_stack[next] && s->index[next] < s->lowlink[node] )
+      { s->lowlink[node] = s->index[next];
+      }
+    } else
+    { if ( s->lowlink[node] == s->index[node] )
+      { int w;
+
+	do
+	{ w = s->stack[--s->sp];
+	  s->on_stack[w] = FALSE;
+	  s->component[w] = s->next_component;
+	} while(w != node);
+	s->next_component++;
+      }
+      if ( --csp > 0 )
+      { int parent = s->cstack[csp-1];
+
+	if ( s->lowlink[node] < s->lowlink[parent] )
+	  s->lowlink[parent] = s->lowlink[node];
+      }
+    }
+  }
+}
+
+static int *
+strongly_connected_components(vgraph *g)
+{ int nnodes = g->nvars + g->nvals;
+  scc_state s;
+
+  s.index     = malloc(nnodes*sizeof(int));
+  s.lowlink   = malloc(nnodes*sizeof(int));
+  s.component = malloc(nnodes*sizeof(int));
+  s.on_stack  = calloc(nnodes, 1);
+  s.stack     = malloc(nnodes*sizeof(int));
+  s.cstack    = malloc(nnodes*sizeof(int));
+  s.cit       = malloc(nnodes*sizeof(size_t));
+  s.sp = s.next_index = s.next_component = 0;
+
+  if ( s.index && s.lowlink && s.component && s.on_stack &&
+       s.stack && s.cstack && s.cit )
+  { for(int i=0; i<nnodes; i++)
+      s.index[i] = NO_NODE;
+    for(int i=0; i<nnodes; i++)
+    { if ( s.index[i] == NO_NODE )
+	scc_visit(g, &s, i);
+    }
+  } else
+  { free(s.component);
+    s.component = NULL;
+  }
+
+  free(s.index);
+  free(s.lowlink);
+  free(s.on_stack);
+  free(s.stack);
+  free(s.cstack);
+  free(s.cit);
+
+  return s.component;
+}
+
+
+/* reachable_values() marks the values that   can be reached from a free
+   value.  Free edges to these values are on an alternating path that
+   starts at a free value and must be kept.
+*/
+
+static char *
+reachable_values(vgraph *g)
+{ char *reached = calloc(g->nvals, 1);
+  int *queue = malloc(g->nvals*sizeof(int));
+  int head = 0, tail = 0;
+
+  if ( !reached || !queue )
+  { free(reached);
+    free(queue);
+    return NULL;
+  }
+
+  for(int v=0; v<g->nvals; v++)
+  { if ( g->val_mate[v] == NO_NODE )
+    { reached[v] = TRUE;
+      queue[tail++] = v;
+    }
+  }
+  while(head < tail)
+  { int v = queue[head++];
+
+    for(size_t e=g->val_edges[v]; e<g->val_edges[v+1]; e++)
+    { int x = g->val_adj[e];
+      int w = g->var_mate[x];
+
+      if ( w != v && !reached[w] )
+      { reached[w] = TRUE;
+	queue[tail++] = w;
+      }
+    }
+  }
+
+  free(queue);
+  return reached;
+}
+
+
+static int
+build_value_index(vgraph *g)
+{ if ( !(g->val_edges = calloc(g->nvals+1, sizeof(size_t))) ||
+       !(g->val_adj = malloc(g->nedges*sizeof(int))) )
+    return FALSE;
+
+  for(size_t e=0; e<g->nedges; e++)
+    g->val_edges[g->var_adj[e]+1]++;
+  for(int v=0; v<g->nvals; v++)
+    g->val_edges[v+1] += g->val_edges[v];
+  for(int x=0; x<g->nvars; x++)
+  { for(size_t e=g->var_edges[x]; e<g->var_edges[x+1]; e++)
+    { int v = g->var_adj[e];
+
+      g->val_adj[g->val_edges[v]++] = x;
+    }
+  }
+  for(int v=g->nvals; v>0; v--)		/* restore offsets */
+    g->val_edges[v] = g->val_edges[v-1];
+  g->val_edges[0] = 0;
+
+  return TRUE;
+}
+
+
+/** '$fd_distinct'(+Vars, +Domains, -Removals) is semidet.
+ *
+ * Vars is a list of  variables  and   Domains  a  list  of their finite
+ * clpfd domains.  Fails if  the  variables   cannot  take  pairwise
+ * distinct values.  Otherwise Removals is a list Var-Value of values
+ * that must be removed from the domain of Var.
+ */
+
+static
+PRED_IMPL("$fd_distinct", 3, fd_distinct, 0)
+{ PRED_LD
+  term_t vars = PL_copy_term_ref(A1);
+  term_t doms = PL_copy_term_ref(A2);
+  term_t dom  = PL_new_term_ref();
+  term_t var  = PL_new_term_ref();
+  term_t tail, head;
+  vgraph g = {0};
+  value_table t = {0};
+  size_t esize = 0, vsize = 16;
+  int *component = NULL;
+  char *reached = NULL;
+  intptr_t len;
+  int rc = FALSE;
+
+  init_clpfd_functors();
+
+  if ( (len=lengthList(vars, TRUE)) < 0 )
+    return FALSE;
+  g.nvars = (int)len;
+
+  for(tail=PL_copy_term_ref(doms), head=PL_new_term_ref();
+      PL_get_list(tail, head, tail); )
+  { term_t b = PL_new_term_ref();
+    int64_t inf, sup;
+
+    if ( !domain_bound(head, 1, b PASS_LD) || !get_bound(b, &inf PASS_LD) ||
+	 !domain_bound(head, 2, b PASS_LD) || !get_bound(b, &sup PASS_LD) )
+      return PL_domain_error("finite_domain", head);
+    if ( sup >= inf )
+      esize += (size_t)(sup-inf)+1;	/* upper bound */
+    PL_reset_term_refs(b);
+  }
+
+  if ( !(g.var_edges = malloc((g.nvars+1)*sizeof(size_t))) ||
+       !(g.var_adj = malloc((esize ? esize : 1)*sizeof(int))) ||
+       !(g.values = malloc(vsize*sizeof(int64_t))) ||
+       !(g.var_mate = malloc((g.nvars ? g.nvars : 1)*sizeof(int))) )
+    goto nomem;
+
+  for(t.size=64; t.size < esize*2; t.size *= 2)
+    ;
+  if ( !(t.keys = malloc(t.size*sizeof(int64_t))) ||
+       !(t.ids = malloc(t.size*sizeof(int))) )
+    goto nomem;
+  for(size_t i=0; i<t.size; i++)
+    t.ids[i] = NO_NODE;
+
+  for(int x=0; x<g.nvars; x++)
+  { int erc;
+
+    if ( !PL_get_list(doms, dom, doms) )
+    { rc = PL_type_error("list", A2);
+      goto out;
+    }
+    g.var_edges[x] = g.nedges;
+    g.var_mate[x] = NO_NODE;
+    if ( (erc=add_domain_edges(dom, &g, &t, &esize, &vsize PASS_LD)) != 1 )
+    { if ( erc == 0 )
+	goto nomem;
+      rc = PL_domain_error("finite_domain", dom);
+      goto out;
+    }
+  }
+  g.var_edges[g.nvars] = g.nedges;
+  g.nvals = t.count;
+
+  if ( !(g.val_mate = malloc((g.nvals ? g.nvals : 1)*sizeof(int))) ||
+       !build_value_index(&g) )
+    goto nomem;
+  for(int v=0; v<g.nvals; v++)
+    g.val_mate[v] = NO_NODE;
+
+  switch( maximum_matching(&g) )
+  { case -1:
+      goto nomem;
+    case FALSE:
+      goto out;				/* no solution */
+  }
+
+  if ( !(component = strongly_connected_components(&g)) ||
+       !(reached = reachable_values(&g)) )
+    goto nomem;
+
+  { term_t list = PL_copy_term_ref(A3);
+
+    rc = TRUE;
+    for(int x=0; x<g.nvars && rc; x++)
+    { if ( !PL_get_list(vars, var, vars) )
+      { rc = FALSE;
+	break;
+      }
+      for(size_t e=g.var_edges[x]; e<g.var_edges[x+1]; e++)
+      { int v = g.var_adj[e];
+
+	if ( v != g.var_mate[x] && !reached[v] &&
+	     component[x] != component[g.nvars+v] )
+	{ if ( !PL_unify_list(list, head, list) ||
+	       !PL_unify_term(head, PL_FUNCTOR, FUNCTOR_minus2,
+				      PL_TERM, var,
+				      PL_INT64, g.values[v]) )
+	  { rc = FALSE;
+	    break;
+	  }
+	}
+      }
+    }
+    rc = rc && PL_unify_nil(list);
+  }
+  goto out;
+
+nomem:
+  rc = PL_no_memory();
+
+out:
+  free_vgraph(&g);
+  free(t.keys);
+  free(t.ids);
+  free(component);
+  free(reached);
+
+  return rc;
+}
+
+
+		 /*******************************
+		 *	    LINEAR SUMS		*
+		 *******************************/
+
+/** '$fd_sum_bounds'(+Cs, +Vs, -Infs, -Sups, -Inf, -Sup) is semidet.
+ *
+ * Implements sum_finite_domains(Cs, Vs, Infs, Sups, 0, 0, Inf, Sup)
+ * from library(clpfd).  Vs is a list of variables and Cs the list of
+ * their integer coefficients.  Inf and Sup are the sums of the finite
+ * lower and upper bounds of the  terms. Infs and Sups hold the terms
+ * C*V whose lower or upper bound is infinite.  Fails if a coefficient,
+ * bound or partial sum does not fit in 64 bits, such that the caller
+ * can use the Prolog version.
+ */
+
+static int
+add_product(int64_t *sum, int64_t c, int64_t b)
+{ int64_t p;
+
+#ifdef HAVE__BUILTIN_MUL_OVERFLOW
+  return ( !__builtin_mul_overflow(c, b, &p) &&
+	   !__builtin_add_overflow(*sum, p, sum) );
+#else
+  if ( (b > 0 && (c > INT64_MAX/b || c < INT64_MIN/b)) ||
+       (b < -1 && (c > INT64_MIN/b || c < INT64_MAX/b)) ||
+       (b == -1 && c == INT64_MIN) )
+    return FALSE;
+  p = c*b;
+  if ( (p > 0 && *sum > INT64_MAX-p) ||
+       (p < 0 && *sum < INT64_MIN-p) )
+    return FALSE;
+  *sum += p;
+  return TRUE;
+#endif
+}
+
+static int
+add_infinite(term_t tail, term_t c, term_t v ARG_LD)
+{ term_t h = PL_new_term_ref();
+  int rc = ( PL_unify_list(tail, h, tail) &&
+	     PL_unify_term(h, PL_FUNCTOR, FUNCTOR_star2,
+			        PL_TERM, c,
+			        PL_TERM, v) );
+
+  PL_reset_term_refs(h);
+  return rc;
+}
+
+static
+PRED_IMPL("$fd_sum_bounds", 6, fd_sum_bounds, 0)
+{ PRED_LD
+  term_t cs	= PL_copy_term_ref(A1);
+  term_t vs	= PL_copy_term_ref(A2);
+  term_t infs	= PL_copy_term_ref(A3);
+  term_t sups	= PL_copy_term_ref(A4);
+  term_t c	= PL_new_term_ref();
+  term_t v	= PL_new_term_ref();
+  term_t dom	= PL_new_term_ref();
+  term_t b	= PL_new_term_ref();
+  int64_t inf = 0, sup = 0;
+
+  init_clpfd_functors();
+
+  while( PL_get_list(cs, c, cs) )
+  { int64_t ci, lo, hi;
+    int has_lo, has_hi;
+
+    if ( !PL_get_list(vs, v, vs) || !PL_get_int64(c, &ci) )
+      return FALSE;
+    if ( fd_domain(v, dom PASS_LD) )
+    { if ( !domain_bound(dom, 1, b PASS_LD) )
+	return FALSE;
+      if ( !(has_lo=get_bound(b, &lo PASS_LD)) &&
+	   PL_is_functor(b, FUNCTOR_n1) )
+	return FALSE;			/* big integer */
+      if ( !domain_bound(dom, 2, b PASS_LD) )
+	return FALSE;
+      if ( !(has_hi=get_bound(b, &hi PASS_LD)) &&
+	   PL_is_functor(b, FUNCTOR_n1) )
+	return FALSE;
+    } else if ( PL_is_variable(v) )
+    { has_lo = has_hi = FALSE;		/* default domain inf..sup */
+    } else
+    { return FALSE;
+    }
+
+    if ( has_lo )
+    { if ( !add_product(ci < 0 ? &sup : &inf, ci, lo) )
+	return FALSE;
+    } else if ( !add_infinite(ci < 0 ? sups : infs, c, v PASS_LD) )
+      return FALSE;
+
+    if ( has_hi )
+    { if ( !add_product(ci < 0 ? &inf : &sup, ci, hi) )
+	return FALSE;
+    } else if ( !add_infinite(ci < 0 ? infs : sups, c, v PASS_LD) )
+      return FALSE;
+  }
+
+  return ( PL_get_nil(vs) &&
+	   PL_unify_nil(infs) &&
+	   PL_unify_nil(sups) &&
+	   PL_unify_int64(A5, inf) &&
+	   PL_unify_int64(A6, sup) );
+}
+
+
+		 /*******************************
+		 *      PUBLISH PREDICATES	*
+		 *******************************/
+
+BeginPredDefs(clpfd)
+  PRED_DEF("$fd_distinct", 3, fd_distinct, 0)
+  PRED_DEF("$fd_sum_bounds", 6, fd_sum_bounds, 0)
+EndPredDefs
@@ -0,0 +1,1567 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pl-incl.h"
+#include "pl-comp.h"
+#include "os/pl-text.h"
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#undef LD
+#define LD LOCAL_LD
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Columnar fact tables. columnar/1 converts a static predicate that consists
+of facts whose arguments are atoms or small integers into a table with a
+column per argument and replaces  the   clauses  by the single clause
+
+    Head :- '$columnar_gen'(Table, Head).
+
+Table is a blob, so the table lives as  long as the clause.  A column is
+an array of 32-bit atom indexes if all its  values are atoms, an array of
+int32_t if all its values are integers   that fit, and an array of words
+otherwise.  A fact with three  such  arguments   thus  takes  12  bytes
+instead of a clause, its VM code and a clause reference.
+
+'$columnar_gen'/2 selects the rows that match the bound arguments.  Scans
+are tight loops over the column arrays.  If  the table is not tiny, the
+first call with an argument bound creates  a hash index for its column.
+The index is a chain of rows per  bucket (rows are numbered from 1, 0 ends
+the chain), built in  row  order,  such   that  solutions  come in fact
+order, whatever column drives the search.   If several arguments are
+bound we use the index with the most non-empty buckets.
+
+The table is immutable after creation. Indexes are created lazily under
+the table's mutex and published using a memory barrier.
+
+columnar_save/2 writes tables with all  their   indexes  to a fact store
+file and columnar_load/1 maps such a file read-only and shared, defining
+the tables as columnar predicates without  copying   the  columns or the
+indexes.  Processes that load the same  file   thus  share the memory of
+the page cache.  Atoms in the file are  numbered and the columns and the
+indexes use these numbers.  A loaded  store   translates  them using an
+array from file number to atom and  a   hash  table  from atom to file
+number.  The file depends on the word size and hash function, which is
+verified when it is loaded.  It must not be modified while loaded.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define COL_INDEX_MIN	16		/* Do not index smaller tables */
+#define COL_MAX_ARITY	64		/* Max arity of a columnar table */
+#define NO_ROW		((size_t)-1)
+
+typedef enum
+{ COL_ATOM,				/* unsigned int: atom index */
+  COL_INT,				/* int32_t: small integer */
+  COL_WORD				/* word: atom or tagged integer */
+} col_type;
+
+typedef struct col_index
+{ unsigned int	buckets;		/* # buckets (power of 2) */
+  unsigned int	used;			/* # non-empty buckets */
+  unsigned int *heads;			/* Row+1 of first in bucket */
+  unsigned int *next;			/* Row+1 of next in bucket */
+} col_index;
+
+typedef struct column
+{ col_type	type;			/* Representation */
+  union
+  { unsigned int *atoms;		/* COL_ATOM */
+    int32_t     *ints;			/* COL_INT */
+    word	*words;			/* COL_WORD */
+    void	*any;
+  } v;
+  col_index * volatile index;		/* Hash index (or NULL) */
+} column;
+
+typedef struct col_store
+{ char	       *base;			/* Start of the file data */
+  size_t	size;			/* Size of the file */
+  int		mapped;			/* base is mmap()ed */
+  unsigned int	references;		/* # tables + loader */
+  unsigned int	natoms;			/* # atoms */
+  atom_t       *atoms;			/* file atom number --> atom */
+  Table		atom_ids;		/* atom --> file atom number + 1 */
+} col_store;
+
+typedef struct column_table
+{ size_t	rows;			/* # rows */
+  unsigned int	arity;			/* # columns */
+  col_store    *store;			/* Loaded from this store */
+  simpleMutex	mutex;			/* Serialize building indexes */
+  column	columns[1];		/* The columns (arity) */
+} column_table;
+
+typedef struct col_match
+{ unsigned int	column;			/* Bound argument */
+  word		key;			/* Its value in column representation */
+} col_match;
+
+typedef struct col_ref
+{ column_table *table;			/* represented table */
+} col_ref;
+
+
+static size_t
+col_cell_size(col_type type)
+{ switch(type)
+  { case COL_ATOM: return sizeof(unsigned int);
+    case COL_INT:  return sizeof(int32_t);
+    default:	   return sizeof(word);
+  }
+}
+
+
+/* col_value() returns the atom or integer at row of column c of t.  A
+   store atom number that is out of range (corrupt file) is mapped to [].
+*/
+
+static inline word
+col_value(const column_table *t, const column *c, size_t row)
+{ if ( likely(!t->store) )
+  { switch(c->type)
+    { case COL_ATOM: return MK_ATOM((word)c->v.atoms[row]);
+      case COL_INT:  return consInt(c->v.ints[row]);
+      default:	     return c->v.words[row];
+    }
+  } else
+  { const col_store *s = t->store;
+    word w;
+
+    switch(c->type)
+    { case COL_ATOM:
+	w = MK_ATOM((word)c->v.atoms[row]);
+        break;
+      case COL_INT:
+	return consInt(c->v.ints[row]);
+      default:
+	w = c->v.words[row];
+    }
+    if ( isAtom(w) )
+      return indexAtom(w) < s->natoms ? s->atoms[indexAtom(w)] : ATOM_nil;
+    return w;
+  }
+}
+
+
+static inline word
+col_cell(const column *c, size_t row)
+{ switch(c->type)
+  { case COL_ATOM: return c->v.atoms[row];
+    case COL_INT:  return (word)(intptr_t)c->v.ints[row];
+    default:	   return c->v.words[row];
+  }
+}
+
+
+/* col_key() translates the value w of a   bound  argument into the column
+   representation.  Returns FALSE if no row can match.
+*/
+
+static int
+col_key(const column_table *t, const column *c, word w, word *key ARG_LD)
+{ if ( t->store && isAtom(w) )
+  { uintptr_t id = (uintptr_t)lookupHTable(t->store->atom_ids, (void*)w);
+
+    if ( !id )
+      return FALSE;
+    w = MK_ATOM((word)id-1);
+  }
+
+  switch(c->type)
+  { case COL_ATOM:
+      if ( isAtom(w) && indexAtom(w) <= UINT_MAX )
+      { *key = indexAtom(w);
+	return TRUE;
+      }
+      return FALSE;
+    case COL_INT:
+      if ( isTaggedInt(w) && valInt(w) >= INT32_MIN && valInt(w) <= INT32_MAX )
+      { *key = (word)valInt(w);
+	return TRUE;
+      }
+      return FALSE;
+    default:
+      if ( isAtom(w) || isTaggedInt(w) )
+      { *key = w;
+	return TRUE;
+      }
+      return FALSE;
+  }
+}
+
+
+static void
+free_col_index(col_index *ci, size_t rows)
+{ freeHeap(ci->heads, ci->buckets*sizeof(unsigned int));
+  freeHeap(ci->next, rows*sizeof(unsigned int));
+  freeHeap(ci, sizeof(*ci));
+}
+
+
+static void	release_col_store(col_store *s);
+
+static void
+free_column_table(column_table *t)
+{ unsigned int i;
+
+  for(i=0; i<t->arity; i++)
+  { column *c = &t->columns[i];
+
+    if ( t->store )			/* data is in the store */
+    { if ( c->index )
+	freeHeap(c->index, sizeof(*c->index));
+      continue;
+    }
+
+    if ( c->v.any )
+    { size_t r;
+
+      if ( c->type == COL_ATOM )
+      { for(r=0; r<t->rows; r++)
+	  PL_unregister_atom(MK_ATOM((word)c->v.atoms[r]));
+      } else if ( c->type == COL_WORD )
+      { for(r=0; r<t->rows; r++)
+	{ if ( isAtom(c->v.words[r]) )
+	    PL_unregister_atom(c->v.words[r]);
+	}
+      }
+      freeHeap(c->v.any, t->rows*col_cell_size(c->type));
+    }
+    if ( c->index )
+      free_col_index(c->index, t->rows);
+  }
+  if ( t->store )
+    release_col_store(t->store);
+  simpleMutexDelete(&t->mutex);
+  freeHeap(t, sizeof(*t) + (t->arity-1)*sizeof(column));
+}
+
+
+		 /*******************************
+		 *	      SYMBOL		*
+		 *******************************/
+
+static int
+write_column_table_ref(IOSTREAM *s, atom_t aref, int flags)
+{ col_ref *ref = PL_blob_data(aref, NULL, NULL);
+  (void)flags;
+
+  Sfprintf(s, "<columnar>(%p)", ref->table);
+  return TRUE;
+}
+
+
+static int
+release_column_table_ref(atom_t aref)
+{ col_ref *ref = PL_blob_data(aref, NULL, NULL);
+
+  if ( ref->table )
+    free_column_table(ref->table);
+
+  return TRUE;
+}
+
+
+static int
+save_column_table(atom_t aref, IOSTREAM *fd)
+{ col_ref *ref = PL_blob_data(aref, NULL, NULL);
+  (void)fd;
+
+  return PL_warning("Cannot save reference to <columnar>(%p)",
+		    ref->table);
+}
+
+
+static atom_t
+load_column_table(IOSTREAM *fd)
+{ (void)fd;
+
+  return PL_new_atom("<saved-columnar-ref>");
+}
+
+
+static PL_blob_t column_table_blob =
+{ PL_BLOB_MAGIC,
+  PL_BLOB_UNIQUE,
+  "columnar",
+  release_column_table_ref,
+  NULL,
+  write_column_table_ref,
+  NULL,
+  save_column_table,
+  load_column_table
+};
+
+
+static int
+get_column_table(term_t t, column_table **tp)
+{ void *data;
+  PL_blob_t *type;
+
+  if ( PL_get_blob(t, &data, NULL, &type) && type == &column_table_blob )
+  { col_ref *ref = data;
+
+    *tp = ref->table;
+    return TRUE;
+  }
+
+  PL_type_error("columnar", t);
+  return FALSE;
+}
+
+
+static int
+unify_column_table(term_t t, column_table *table)
+{ col_ref ref;
+
+  ref.table = table;
+  return PL_unify_blob(t, &ref, sizeof(ref), &column_table_blob);
+}
+
+
+		 /*******************************
+		 *	      INDEXES		*
+		 *******************************/
+
+static inline unsigned int
+col_hash(word key, unsigned int buckets)
+{ return MurmurHashIntptr(key, MURMUR_SEED) & (buckets-1);
+}
+
+
+static col_index *
+build_col_index(const column_table *t, const column *c)
+{ col_index *ci = allocHeapOrHalt(sizeof(*ci));
+  unsigned int buckets = 16;
+  size_t r;
+
+  while( buckets < t->rows && buckets < (UINT_MAX>>1)+1 )
+    buckets *= 2;
+  ci->buckets = buckets;
+  ci->used    = 0;
+  ci->heads   = allocHeapOrHalt(buckets*sizeof(unsigned int));
+  ci->next    = allocHeapOrHalt(t->rows*sizeof(unsigned int));
+  memset(ci->heads, 0, buckets*sizeof(unsigned int));
+
+  for(r=t->rows; r-- > 0; )		/* build backwards: chains in row order */
+  { unsigned int h = col_hash(col_cell(c, r), buckets);
+
+    if ( !ci->heads[h] )
+      ci->used++;
+    ci->next[r]  = ci->heads[h];
+    ci->heads[h] = (unsigned int)(r+1);
+  }
+
+  return ci;
+}
+
+
+static col_index *
+column_index(column_table *t, unsigned int col)
+{ column *c = &t->columns[col];
+  col_index *ci;
+
+  if ( (ci=c->index) )
+    return ci;
+
+  simpleMutexLock(&t->mutex);
+  if ( !(ci=c->index) )
+  { ci = build_col_index(t, c);
+    MEMORY_BARRIER();
+    c->index = ci;
+  }
+  simpleMutexUnlock(&t->mutex);
+
+  return ci;
+}
+
+
+		 /*******************************
+		 *	      SEARCH		*
+		 *******************************/
+
+static inline int
+row_matches(const column_table *t, const col_match *m, int nm, size_t row)
+{ int i;
+
+  for(i=0; i<nm; i++)
+  { if ( col_cell(&t->columns[m[i].column], row) != m[i].key )
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+
+static size_t
+scan_column(const column *c, word key, size_t from, size_t rows)
+{ size_t r;
+
+  switch(c->type)
+  { case COL_ATOM:
+    { const unsigned int *v = c->v.atoms;
+      unsigned int k = (unsigned int)key;
+
+      for(r=from; r<rows; r++)
+      { if ( v[r] == k )
+	  return r;
+      }
+      break;
+    }
+    case COL_INT:
+    { const int32_t *v = c->v.ints;
+      int32_t k = (int32_t)(intptr_t)key;
+
+      for(r=from; r<rows; r++)
+      { if ( v[r] == k )
+	  return r;
+      }
+      break;
+    }
+    default:
+    { const word *v = c->v.words;
+
+      for(r=from; r<rows; r++)
+      { if ( v[r] == key )
+	  return r;
+      }
+    }
+  }
+
+  return NO_ROW;
+}
+
+
+/* next_row() returns the first row after `row` that matches m, or the
+   first matching row if row is NO_ROW.  If we have an index, it belongs
+   to m[0] and `row` is a matching row, so it is on the hash chain.
+*/
+
+static size_t
+next_row(const column_table *t, const col_match *m, int nm,
+	 const col_index *ci, size_t row)
+{ size_t r;
+
+  if ( nm == 0 )
+  { r = (row == NO_ROW ? 0 : row+1);
+    return r < t->rows ? r : NO_ROW;
+  }
+
+  if ( ci )
+  { r = ( row == NO_ROW
+	  ? ci->heads[col_hash(m[0].key, ci->buckets)]
+	  : ci->next[row] );
+
+    for( ; r; r = ci->next[r-1] )
+    { if ( row_matches(t, m, nm, r-1) )
+	return r-1;
+    }
+  } else
+  { const column *c = &t->columns[m[0].column];
+
+    r = (row == NO_ROW ? 0 : row+1);
+    while( (r=scan_column(c, m[0].key, r, t->rows)) != NO_ROW )
+    { if ( row_matches(t, m+1, nm-1, r) )
+	return r;
+      r++;
+    }
+  }
+
+  return NO_ROW;
+}
+
+
+/* select_driver() moves the match with the most selective index to the
+   front and returns its index, or NULL if we must scan.
+*/
+
+static col_index *
+select_driver(column_table *t, col_match *m, int nm)
+{ col_index *best = NULL;
+  int i, bi = 0;
+
+  if ( nm == 0 || t->rows < COL_INDEX_MIN )
+    return NULL;
+
+  for(i=0; i<nm; i++)
+  { col_index *ci = column_index(t, m[i].column);
+
+    if ( !best || ci->used > best->used )
+    { best = ci;
+      bi = i;
+    }
+  }
+
+  if ( bi != 0 )
+  { col_match tmp = m[0];
+
+    m[0] = m[bi];
+    m[bi] = tmp;
+  }
+
+  return best;
+}
+
+
+		 /*******************************
+		 *	   PREDICATES		*
+		 *******************************/
+
+/** '$columnar_gen'(+Table, ?Head) is nondet.
+ *
+ * Enumerate the rows of Table that unify with the arguments of Head.
+ * The redo state is the next matching row.
+ */
+
+static
+PRED_IMPL("$columnar_gen", 2, columnar_gen, PL_FA_NONDETERMINISTIC)
+{ PRED_LD
+  column_table *t;
+  col_match m[COL_MAX_ARITY];
+  int bound[COL_MAX_ARITY];
+  int nm = 0;
+  col_index *ci;
+  size_t row, next;
+  unsigned int i;
+  term_t arg;
+  fid_t fid;
+
+  switch( CTX_CNTRL )
+  { case FRG_FIRST_CALL:
+      row = NO_ROW;
+      break;
+    case FRG_REDO:
+      row = (size_t)CTX_INT;
+      break;
+    case FRG_CUTTED:
+      return TRUE;
+    default:
+      assert(0);
+      return FALSE;
+  }
+
+  if ( !get_column_table(A1, &t) )
+    return FALSE;
+  if ( !PL_is_compound(A2) )
+    return PL_type_error("compound", A2);
+
+  arg = PL_new_term_ref();
+  for(i=0; i<t->arity; i++)
+  { Word p;
+
+    _PL_get_arg(i+1, A2, arg);
+    p = valTermRef(arg);
+    deRef(p);
+    if ( canBind(*p) )
+    { bound[i] = FALSE;
+    } else
+    { if ( !col_key(t, &t->columns[i], *p, &m[nm].key PASS_LD) )
+	return FALSE;
+      m[nm].column = i;
+      bound[i] = TRUE;
+      nm++;
+    }
+  }
+
+  ci = select_driver(t, m, nm);
+  if ( row == NO_ROW && (row=next_row(t, m, nm, ci, NO_ROW)) == NO_ROW )
+    return FALSE;
+
+  if ( !(fid = PL_open_foreign_frame()) )
+    return FALSE;
+
+  for(;;)
+  { int rc = TRUE;
+
+    for(i=0; rc && i<t->arity; i++)
+    { if ( !bound[i] )
+      { _PL_get_arg(i+1, A2, arg);
+	rc = PL_unify_atom(arg, col_value(t, &t->columns[i], row)); /* any atomic */
+      }
+    }
+    next = next_row(t, m, nm, ci, row);
+
+    if ( rc )
+    { PL_close_foreign_frame(fid);
+      if ( next != NO_ROW )
+	ForeignRedoInt((intptr_t)next);
+      return TRUE;
+    }
+    if ( PL_exception(0) || next == NO_ROW )
+    { PL_close_foreign_frame(fid);
+      return FALSE;
+    }
+    PL_rewind_foreign_frame(fid);
+    row = next;
+  }
+}
+
+
+/* make_column() fills c from the `rows` values in `words`, using the most
+   compact representation.  We take a reference to the atoms.
+*/
+
+static void
+make_column(column *c, const word *words, size_t rows)
+{ int atoms = TRUE, ints = TRUE;
+  size_t r;
+
+  for(r=0; r<rows && (atoms || ints); r++)
+  { word w = words[r];
+
+    if ( !isAtom(w) || indexAtom(w) > UINT_MAX )
+      atoms = FALSE;
+    if ( !isTaggedInt(w) || valInt(w) < INT32_MIN || valInt(w) > INT32_MAX )
+      ints = FALSE;
+  }
+
+  c->type = (atoms ? COL_ATOM : ints ? COL_INT : COL_WORD);
+  c->v.any = allocHeapOrHalt(rows*col_cell_size(c->type));
+  c->index = NULL;
+
+  for(r=0; r<rows; r++)
+  { word w = words[r];
+
+    switch(c->type)
+    { case COL_ATOM:
+	c->v.atoms[r] = (unsigned int)indexAtom(w);
+	break;
+      case COL_INT:
+	c->v.ints[r] = (int32_t)valInt(w);
+	break;
+      default:
+	c->v.words[r] = w;
+    }
+    if ( isAtom(w) )
+      PL_register_atom(w);
+  }
+}
+
+
+static column_table *
+new_column_table(tmp_buffer *cols, unsigned int arity, size_t rows)
+{ column_table *t = allocHeapOrHalt(sizeof(*t) + (arity-1)*sizeof(column));
+  unsigned int i;
+
+  t->rows  = rows;
+  t->arity = arity;
+  t->store = NULL;
+  simpleMutexInit(&t->mutex);
+  for(i=0; i<arity; i++)
+    make_column(&t->columns[i], baseBuffer(&cols[i], word), rows);
+
+  return t;
+}
+
+
+/* collect_facts() adds the arguments of the clauses of def that are
+   visible in gen to cols.  Returns the first clause in *first.
+*/
+
+static int
+collect_facts(Procedure proc, gen_t gen, tmp_buffer *cols,
+	      size_t *rowsp, Clause *first ARG_LD)
+{ Definition def = proc->definition;
+  unsigned int i, arity = def->functor->arity;
+  term_t head = PL_new_term_ref();
+  term_t arg = PL_new_term_ref();
+  fid_t fid = PL_open_foreign_frame();
+  size_t rows = 0;
+  ClauseRef cref;
+  int rc = TRUE;
+
+  if ( !fid )
+    return FALSE;
+
+  *first = NULL;
+  acquire_def(def);
+  for(cref = def->impl.clauses.first_clause; cref && rc; cref = cref->next)
+  { Clause cl = cref->value.clause;
+
+    if ( !visibleClause(cl, gen) )
+      continue;
+    if ( false(cl, UNIT_CLAUSE) )
+    { rc = PL_error(NULL, 0, "not a fact table",
+		    ERR_PERMISSION_PROC, ATOM_columnar, ATOM_procedure, proc);
+      break;
+    }
+    if ( rows == UINT_MAX-1 )
+    { rc = PL_representation_error("columnar_rows");
+      break;
+    }
+    if ( !*first )
+      *first = cl;
+
+    if ( !(rc=decompile(cl, head, 0)) )
+      break;
+    for(i=0; i<arity; i++)
+    { Word p;
+
+      _PL_get_arg(i+1, head, arg);
+      p = valTermRef(arg);
+      deRef(p);
+      if ( !isAtom(*p) && !isTaggedInt(*p) )
+      { rc = PL_error(NULL, 0, NULL, ERR_DOMAIN, ATOM_columnar_value, arg);
+	break;
+      }
+      addBuffer(&cols[i], *p, word);
+    }
+    rows++;
+    if ( rc )
+      PL_rewind_foreign_frame(fid);
+  }
+  release_def(def);
+  PL_close_foreign_frame(fid);
+
+  *rowsp = rows;
+  return rc;
+}
+
+
+/* replace_clauses() adds the clause that calls '$columnar_gen'/2 for t
+   and erases the clauses of def that are visible in gen.  The facts are
+   erased in the generation in which the new clause becomes visible. As
+   after reloading a file, we run clause GC to get rid of them, because
+   they precede the new clause. If clause GC was already running it
+   may have started before we erased the facts and we ask for another.
+*/
+
+static int
+replace_clauses(Procedure proc, gen_t gen, column_table *t, Clause first
+		ARG_LD)
+{ Definition def = proc->definition;
+  term_t h = PL_new_term_ref();
+  term_t b = PL_new_term_ref();
+  term_t table = PL_new_term_ref();
+  Clause clause;
+  ClauseRef cref;
+  gen_t created;
+  Word hp, bp;
+
+  if ( !unify_column_table(table, t) )
+  { free_column_table(t);
+    return FALSE;
+  }
+  if ( !PL_unify_functor(h, def->functor->functor) ||
+       !PL_unify_term(b, PL_FUNCTOR, FUNCTOR_dcolumnar_gen2,
+			   PL_TERM, table,
+			   PL_TERM, h) )
+    return FALSE;
+
+  hp = valTermRef(h);
+  bp = valTermRef(b);
+  deRef(hp);
+  deRef(bp);
+  if ( compileClause(&clause, hp, bp, proc, def->module, 0 PASS_LD) != TRUE )
+    return FALSE;
+  if ( first )
+  { clause->line_no   = first->line_no;
+    clause->source_no = first->source_no;
+    clause->owner_no  = first->owner_no;
+  }
+  if ( !assertDefinition(def, clause, CL_END PASS_LD) )
+    return FALSE;
+  created = clause->generation.created;
+
+  acquire_def(def);
+  for(cref = def->impl.clauses.first_clause; cref; cref = cref->next)
+  { Clause cl = cref->value.clause;
+
+    if ( cl != clause && visibleClause(cl, gen) )
+      eraseClauseDefinition(def, cl, created);
+  }
+  release_def(def);
+  next_global_generation();		/* make the facts collectable */
+
+  if ( !pl_garbage_collect_clauses() )
+    return FALSE;
+  if ( def->impl.clauses.erased_clauses > 0 )	/* CGC was already running */
+    signalGCThread(SIG_CLAUSE_GC);
+
+  return TRUE;
+}
+
+
+/* check_columnar_pred() raises a permission error if proc cannot be
+   turned into a columnar table.
+*/
+
+static int
+check_columnar_pred(Procedure proc)
+{ Definition def = proc->definition;
+  size_t arity = def->functor->arity;
+
+  if ( true(def, P_FOREIGN|P_DYNAMIC|P_LOCKED) )
+    return PL_error(NULL, 0, "not a static predicate",
+		    ERR_PERMISSION_PROC, ATOM_columnar, ATOM_procedure, proc);
+  if ( arity == 0 || arity > COL_MAX_ARITY )
+    return PL_error(NULL, 0, "arity",
+		    ERR_PERMISSION_PROC, ATOM_columnar, ATOM_procedure, proc);
+
+  return TRUE;
+}
+
+
+/** columnar(:PI) is det.
+ *
+ * Convert the static fact predicate PI into a columnar table.
+ */
+
+static
+PRED_IMPL("columnar", 1, columnar, PL_FA_TRANSPARENT)
+{ PRED_LD
+  Procedure proc;
+  Definition def;
+  tmp_buffer *cols;
+  unsigned int i, arity;
+  size_t rows = 0;
+  Clause first;
+  gen_t gen;
+  int rc;
+
+  if ( !get_procedure(A1, &proc, 0, GP_NAMEARITY|GP_FINDHERE|
+				    GP_EXISTENCE_ERROR) )
+    return FALSE;
+  def = proc->definition;
+  if ( !loadedDefinition(def) ||
+       !check_columnar_pred(proc) )
+    return FALSE;
+  arity = def->functor->arity;
+
+  cols = allocHeapOrHalt(arity*sizeof(tmp_buffer));
+  for(i=0; i<arity; i++)
+    initBuffer(&cols[i]);
+
+  gen = global_generation();
+  rc = collect_facts(proc, gen, cols, &rows, &first PASS_LD);
+  if ( rc )
+    rc = replace_clauses(proc, gen, new_column_table(cols, arity, rows),
+			 first PASS_LD);
+
+  for(i=0; i<arity; i++)
+    discardBuffer(&cols[i]);
+  freeHeap(cols, arity*sizeof(tmp_buffer));
+
+  return rc;
+}
+
+
+/* columnar_table() is true if def is a columnar table.  It puts the
+   table blob in `table`, which keeps the table alive while `table` is.
+*/
+
+static int
+columnar_table(Definition def, term_t table, column_table **tp ARG_LD)
+{ ClauseRef cref;
+  Clause clause = NULL;
+  gen_t gen = global_generation();
+  int rc = FALSE;
+
+  if ( true(def, P_FOREIGN|P_DYNAMIC) ||
+       def->impl.clauses.number_of_clauses != 1 ||
+       def->impl.clauses.number_of_rules != 1 )
+    return FALSE;
+
+  acquire_def(def);
+  for(cref = def->impl.clauses.first_clause; cref; cref = cref->next)
+  { if ( visibleClause(cref->value.clause, gen) )
+    { clause = cref->value.clause;
+      break;
+    }
+  }
+  if ( clause )
+  { term_t cl = PL_new_term_ref();
+    term_t body = PL_new_term_ref();
+    Module m = NULL;
+
+    if ( decompile(clause, cl, 0) &&
+	 PL_get_arg(2, cl, body) &&
+	 PL_strip_module(body, &m, body) &&
+	 PL_is_functor(body, FUNCTOR_dcolumnar_gen2) &&
+	 PL_get_arg(1, body, table) &&
+	 get_column_table(table, tp) )
+      rc = TRUE;
+    else
+      PL_clear_exception();
+  }
+  release_def(def);
+
+  return rc;
+}
+
+
+/** '$columnar_rows'(:Head, -Rows) is semidet.
+ *
+ * True when Head is a columnar table with Rows rows.
+ */
+
+static
+PRED_IMPL("$columnar_rows", 2, columnar_rows, PL_FA_TRANSPARENT)
+{ PRED_LD
+  Procedure proc;
+  column_table *t;
+
+  if ( get_procedure(A1, &proc, 0, GP_FIND) &&
+       columnar_table(proc->definition, PL_new_term_ref(), &t PASS_LD) )
+    return PL_unify_int64(A2, (int64_t)t->rows);
+
+  return FALSE;
+}
+
+
+		 /*******************************
+		 *	     FACT STORE		*
+		 *******************************/
+
+#define COL_STORE_MAGIC		"SWICOLS"	/* 8 bytes with the 0 */
+#define COL_STORE_VERSION	1
+#define COL_HASH_CHECK		((word)0x5eed)
+#define ALIGN8(n)		(((n)+7) & ~(uint64_t)7)
+
+typedef struct col_file_header
+{ char		magic[8];		/* COL_STORE_MAGIC */
+  uint32_t	version;		/* COL_STORE_VERSION */
+  uint32_t	word_size;		/* sizeof(word) */
+  uint32_t	lmask_bits;		/* LMASK_BITS */
+  uint32_t	hash_check;		/* hash of COL_HASH_CHECK */
+  uint32_t	natoms;			/* # atoms */
+  uint32_t	ntables;		/* # tables */
+  uint64_t	atoms;			/* offset of uint64_t[natoms] */
+  uint64_t	tables;			/* offset of uint64_t[ntables] */
+} col_file_header;
+
+typedef struct col_file_column
+{ uint32_t	type;			/* col_type */
+  uint32_t	buckets;		/* # index buckets (0: no index) */
+  uint32_t	used;			/* # non-empty buckets */
+  uint32_t	padding;
+  uint64_t	data;			/* offset of the cells */
+  uint64_t	heads;			/* offset of the bucket heads */
+  uint64_t	next;			/* offset of the chains */
+} col_file_column;
+
+typedef struct col_file_table
+{ uint32_t	module;			/* file atom of the module */
+  uint32_t	name;			/* file atom of the name */
+  uint32_t	arity;			/* # columns */
+  uint32_t	padding;
+  uint64_t	rows;			/* # rows */
+  col_file_column columns[1];		/* arity columns */
+} col_file_table;
+
+/* An atom is stored as a uint32_t length followed by its UTF-8 text.
+   Atom cells of COL_ATOM columns hold the file atom number, atoms in
+   COL_WORD columns are MK_ATOM(number).  All sections are 8-byte
+   aligned.
+*/
+
+#define sizeofFileTable(arity) \
+	(sizeof(col_file_table) + ((arity)-1)*sizeof(col_file_column))
+
+static inline uint32_t
+col_hash_check(void)
+{ return (uint32_t)MurmurHashIntptr(COL_HASH_CHECK, MURMUR_SEED);
+}
+
+
+typedef struct col_saver
+{ IOSTREAM     *fd;			/* Output */
+  uint64_t	pos;			/* Current offset */
+  Table		atom_ids;		/* atom --> file atom number + 1 */
+  tmp_buffer	atoms;			/* file atom number --> atom */
+  unsigned int	natoms;			/* # numbered atoms */
+} col_saver;
+
+static unsigned int
+save_atom_id(col_saver *cs, atom_t a ARG_LD)
+{ uintptr_t id = (uintptr_t)lookupHTable(cs->atom_ids, (void*)a);
+
+  if ( !id )
+  { id = ++cs->natoms;
+    addNewHTable(cs->atom_ids, (void*)a, (void*)id);
+    addBuffer(&cs->atoms, a, atom_t);
+  }
+
+  return (unsigned int)(id-1);
+}
+
+
+/* number_table_atoms() numbers the atoms of t.  Only text atoms can be
+   saved.
+*/
+
+static int
+number_table_atoms(col_saver *cs, const column_table *t ARG_LD)
+{ unsigned int i;
+
+  for(i=0; i<t->arity; i++)
+  { const column *c = &t->columns[i];
+    size_t r;
+
+    if ( c->type == COL_INT )
+      continue;
+    for(r=0; r<t->rows; r++)
+    { word w = col_value(t, c, r);
+
+      if ( isAtom(w) )
+      { if ( !isTextAtom(w) )
+	{ term_t ex;
+
+	  return ( (ex=PL_new_term_ref()) &&
+		   PL_put_atom(ex, w) &&
+		   PL_error(NULL, 0, "not a text atom",
+			    ERR_DOMAIN, ATOM_columnar_value, ex) );
+	}
+	save_atom_id(cs, w PASS_LD);
+      }
+    }
+  }
+
+  return TRUE;
+}
+
+
+static int
+save_bytes(col_saver *cs, const void *data, size_t size)
+{ static const char zeros[8] = {0};
+  size_t pad = (size_t)(ALIGN8(size) - size);
+
+  if ( (size && Sfwrite(data, 1, size, cs->fd) != size) ||
+       (pad  && Sfwrite(zeros, 1, pad, cs->fd) != pad) )
+    return FALSE;
+  cs->pos += size+pad;
+
+  return TRUE;
+}
+
+
+/* file_column() creates fc as c, using file atom numbers for atoms.
+*/
+
+static void
+file_column(col_saver *cs, const column_table *t, const column *c, column *fc
+	    ARG_LD)
+{ size_t r;
+
+  fc->type  = c->type;
+  fc->index = NULL;
+  fc->v.any = allocHeapOrHalt(t->rows*col_cell_size(c->type));
+
+  for(r=0; r<t->rows; r++)
+  { word w = col_value(t, c, r);
+
+    switch(c->type)
+    { case COL_ATOM:
+	fc->v.atoms[r] = save_atom_id(cs, w PASS_LD);
+	break;
+      case COL_INT:
+	fc->v.ints[r] = c->v.ints[r];
+	break;
+      default:
+	fc->v.words[r] = (isAtom(w) ? MK_ATOM((word)save_atom_id(cs, w PASS_LD))
+				    : w);
+    }
+  }
+}
+
+
+/* save_table() writes t, followed by its columns and their indexes.
+*/
+
+static int
+save_table(col_saver *cs, Definition def, const column_table *t ARG_LD)
+{ size_t tsize = sizeofFileTable(t->arity);
+  col_file_table *ft = allocHeapOrHalt(tsize);
+  column *fcols = allocHeapOrHalt(t->arity*sizeof(column));
+  uint64_t pos = cs->pos + ALIGN8(tsize);
+  unsigned int i;
+  int rc = TRUE;
+
+  memset(ft, 0, tsize);
+  ft->module = save_atom_id(cs, def->module->name PASS_LD);
+  ft->name   = save_atom_id(cs, def->functor->name PASS_LD);
+  ft->arity  = t->arity;
+  ft->rows   = t->rows;
+
+  for(i=0; i<t->arity; i++)
+  { column *fc = &fcols[i];
+    col_file_column *fcc = &ft->columns[i];
+
+    file_column(cs, t, &t->columns[i], fc PASS_LD);
+    if ( t->rows >= COL_INDEX_MIN )
+      fc->index = build_col_index(t, fc);
+
+    fcc->type = fc->type;
+    fcc->data = pos;
+    pos += ALIGN8(t->rows*col_cell_size(fc->type));
+    if ( fc->index )
+    { fcc->buckets = fc->index->buckets;
+      fcc->used    = fc->index->used;
+      fcc->heads   = pos;
+      pos += ALIGN8(fcc->buckets*sizeof(unsigned int));
+      fcc->next    = pos;
+      pos += ALIGN8(t->rows*sizeof(unsigned int));
+    }
+  }
+
+  rc = save_bytes(cs, ft, tsize);
+  for(i=0; i<t->arity; i++)
+  { column *fc = &fcols[i];
+
+    if ( rc )
+    { rc = save_bytes(cs, fc->v.any, t->rows*col_cell_size(fc->type));
+      if ( rc && fc->index )
+	rc = ( save_bytes(cs, fc->index->heads,
+			  fc->index->buckets*sizeof(unsigned int)) &&
+	       save_bytes(cs, fc->index->next,
+			  t->rows*sizeof(unsigned int)) );
+    }
+    freeHeap(fc->v.any, t->rows*col_cell_size(fc->type));
+    if ( fc->index )
+      free_col_index(fc->index, t->rows);
+  }
+  assert(!rc || pos == cs->pos);
+
+  freeHeap(fcols, t->arity*sizeof(column));
+  freeHeap(ft, tsize);
+
+  return rc;
+}
+
+
+static int
+save_atom(col_saver *cs, atom_t a)
+{ PL_chars_t text;
+  tmp_buffer b;
+  uint32_t len;
+  int rc;
+
+  if ( !get_atom_text(a, &text) ||
+       !PL_mb_text(&text, REP_UTF8) )
+    return FALSE;
+  if ( text.length > UINT32_MAX )
+  { PL_free_text(&text);
+    return PL_representation_error("columnar_atom_length");
+  }
+
+  len = (uint32_t)text.length;
+  initBuffer(&b);
+  addMultipleBuffer(&b, (char*)&len, sizeof(len), char);
+  addMultipleBuffer(&b, text.text.t, text.length, char);
+  rc = save_bytes(cs, baseBuffer(&b, char), entriesBuffer(&b, char));
+  discardBuffer(&b);
+  PL_free_text(&text);
+
+  return rc;
+}
+
+
+/** columnar_save(+File, :ListOfPI) is det.
+ *
+ * Write the columnar tables ListOfPI with all their indexes to File.
+ */
+
+static
+PRED_IMPL("columnar_save", 2, columnar_save, PL_FA_TRANSPARENT)
+{ PRED_LD
+  char *name;
+  Module lm = NULL;
+  term_t list = PL_new_term_ref();
+  term_t tail = PL_new_term_ref();
+  term_t head = PL_new_term_ref();
+  term_t pi   = PL_new_term_ref();
+  term_t mname = PL_new_term_ref();
+  term_t blobs = 0;
+  Definition *defs = NULL;
+  column_table **tables = NULL;
+  uint64_t *offsets = NULL;
+  size_t i, ntables;
+  col_file_header hdr;
+  col_saver cs;
+  int rc = FALSE;
+
+  if ( !PL_get_file_name(A1, &name, 0) ||
+       !PL_strip_module(A2, &lm, list) )
+    return FALSE;
+  if ( PL_skip_list(list, 0, &ntables) != PL_LIST )
+    return PL_type_error("list", list);
+  if ( ntables > 0 && !(blobs = PL_new_term_refs((int)ntables)) )
+    return FALSE;
+
+  memset(&cs, 0, sizeof(cs));
+  cs.atom_ids = newHTable(64);
+  initBuffer(&cs.atoms);
+  defs   = allocHeapOrHalt((ntables+1)*sizeof(*defs));
+  tables = allocHeapOrHalt((ntables+1)*sizeof(*tables));
+
+  PL_put_term(tail, list);
+  for(i=0; PL_get_list(tail, head, tail); i++)
+  { Procedure proc;
+
+    if ( lm )
+    { PL_put_atom(mname, lm->name);
+      if ( !PL_cons_functor(pi, FUNCTOR_colon2, mname, head) )
+	goto out;
+    } else
+      PL_put_term(pi, head);
+
+    if ( !get_procedure(pi, &proc, 0, GP_NAMEARITY|GP_FINDHERE|
+				      GP_EXISTENCE_ERROR) )
+      goto out;
+    defs[i] = proc->definition;
+    if ( !columnar_table(defs[i], blobs+i, &tables[i] PASS_LD) )
+    { PL_error(NULL, 0, "not a columnar table",
+	       ERR_PERMISSION_PROC, ATOM_columnar_store, ATOM_procedure, proc);
+      goto out;
+    }
+    save_atom_id(&cs, defs[i]->module->name PASS_LD);
+    save_atom_id(&cs, defs[i]->functor->name PASS_LD);
+    if ( !number_table_atoms(&cs, tables[i] PASS_LD) )
+      goto out;
+  }
+
+  if ( !(cs.fd = Sopen_file(name, "wb")) )
+  { PL_error(NULL, 0, OsError(), ERR_FILE_OPERATION,
+	     ATOM_open, ATOM_source_sink, A1);
+    goto out;
+  }
+
+  memset(&hdr, 0, sizeof(hdr));
+  offsets = allocHeapOrHalt((ntables+cs.natoms+1)*sizeof(uint64_t));
+  rc = save_bytes(&cs, &hdr, sizeof(hdr));
+  for(i=0; rc && i<ntables; i++)
+  { offsets[i] = cs.pos;
+    rc = save_table(&cs, defs[i], tables[i] PASS_LD);
+  }
+  for(i=0; rc && i<cs.natoms; i++)
+  { offsets[ntables+i] = cs.pos;
+    rc = save_atom(&cs, baseBuffer(&cs.atoms, atom_t)[i]);
+  }
+  if ( rc )
+  { memcpy(hdr.magic, COL_STORE_MAGIC, sizeof(hdr.magic));
+    hdr.version    = COL_STORE_VERSION;
+    hdr.word_size  = sizeof(word);
+    hdr.lmask_bits = LMASK_BITS;
+    hdr.hash_check = col_hash_check();
+    hdr.natoms     = cs.natoms;
+    hdr.ntables    = (uint32_t)ntables;
+    hdr.tables     = cs.pos;
+    rc = save_bytes(&cs, offsets, ntables*sizeof(uint64_t));
+    hdr.atoms      = cs.pos;
+    rc = ( rc &&
+	   save_bytes(&cs, offsets+ntables, cs.natoms*sizeof(uint64_t)) &&
+	   Sseek64(cs.fd, 0, SIO_SEEK_SET) == 0 &&
+	   Sfwrite(&hdr, 1, sizeof(hdr), cs.fd) == sizeof(hdr) );
+  }
+  if ( Sclose(cs.fd) != 0 )
+    rc = FALSE;
+  if ( !rc && !PL_exception(0) )
+    PL_error(NULL, 0, OsError(), ERR_FILE_OPERATION,
+	     ATOM_write, ATOM_file, A1);
+
+out:
+  if ( offsets )
+    freeHeap(offsets, (ntables+cs.natoms+1)*sizeof(uint64_t));
+  freeHeap(defs, (ntables+1)*sizeof(*defs));
+  freeHeap(tables, (ntables+1)*sizeof(*tables));
+  discardBuffer(&cs.atoms);
+  destroyHTable(cs.atom_ids);
+
+  return rc;
+}
+
+
+static void
+release_col_store(col_store *s)
+{ if ( ATOMIC_DEC(&s->references) == 0 )
+  { unsigned int i;
+
+    if ( s->atoms )
+    { for(i=0; i<s->natoms; i++)
+      { if ( s->atoms[i] )
+	  PL_unregister_atom(s->atoms[i]);
+      }
+      freeHeap(s->atoms, s->natoms*sizeof(atom_t));
+    }
+    if ( s->atom_ids )
+      destroyHTable(s->atom_ids);
+#ifdef HAVE_MMAP
+    if ( s->mapped )
+      munmap(s->base, s->size);
+    else
+#endif
+      free(s->base);
+    freeHeap(s, sizeof(*s));
+  }
+}
+
+
+/* open_col_store() maps the file read-only and shared.  Without mmap()
+   we read it.
+*/
+
+static col_store *
+open_col_store(const char *name, size_t size)
+{ col_store *s = allocHeapOrHalt(sizeof(*s));
+
+  memset(s, 0, sizeof(*s));
+  s->references = 1;
+  s->size = size;
+
+#ifdef HAVE_MMAP
+  { int fd;
+
+    if ( (fd=open(name, O_RDONLY)) >= 0 )
+    { void *base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+
+      if ( base != MAP_FAILED )
+      { s->base   = base;
+	s->mapped = TRUE;
+      }
+      close(fd);
+    }
+  }
+#endif
+  if ( !s->base )
+  { IOSTREAM *fd;
+
+    if ( (fd=Sopen_file(name, "rb")) )
+    { if ( (s->base = malloc(size)) &&
+	   Sfread(s->base, 1, size, fd) != size )
+      { free(s->base);
+	s->base = NULL;
+      }
+      Sclose(fd);
+    }
+  }
+
+  if ( !s->base )
+  { freeHeap(s, sizeof(*s));
+    return NULL;
+  }
+
+  return s;
+}
+
+
+static inline int
+in_store(const col_store *s, uint64_t offset, uint64_t size)
+{ return offset <= s->size && size <= s->size - offset;
+}
+
+
+static inline int
+in_store_aligned(const col_store *s, uint64_t offset, uint64_t size)
+{ return offset%8 == 0 && in_store(s, offset, size);
+}
+
+
+/* init_col_store() validates the header and creates the atoms.
+*/
+
+static int
+init_col_store(col_store *s)
+{ const col_file_header *h = (const col_file_header*)s->base;
+  const uint64_t *offsets;
+  unsigned int i;
+
+  if ( memcmp(h->magic, COL_STORE_MAGIC, sizeof(h->magic)) != 0 ||
+       h->version != COL_STORE_VERSION ||
+       h->word_size != sizeof(word) ||
+       h->lmask_bits != LMASK_BITS ||
+       h->hash_check != col_hash_check() ||
+       !in_store_aligned(s, h->atoms, (uint64_t)h->natoms*sizeof(uint64_t)) ||
+       !in_store_aligned(s, h->tables, (uint64_t)h->ntables*sizeof(uint64_t)) )
+    return FALSE;
+
+  offsets = (const uint64_t*)(s->base+h->atoms);
+  s->atom_ids = newHTable(64);
+  s->atoms = allocHeapOrHalt((h->natoms+1)*sizeof(atom_t));
+  memset(s->atoms, 0, (h->natoms+1)*sizeof(atom_t));
+  s->natoms = h->natoms;
+
+  for(i=0; i<s->natoms; i++)
+  { uint32_t len;
+    atom_t a;
+
+    if ( !in_store(s, offsets[i], sizeof(len)) )
+      return FALSE;
+    memcpy(&len, s->base+offsets[i], sizeof(len));
+    if ( !in_store(s, offsets[i]+sizeof(len), len) ||
+	 !(a = PL_new_atom_mbchars(REP_UTF8, len,
+				   s->base+offsets[i]+sizeof(len))) )
+      return FALSE;
+    s->atoms[i] = a;
+    addNewHTable(s->atom_ids, (void*)a, (void*)(uintptr_t)(i+1));
+  }
+
+  return TRUE;
+}
+
+
+static int
+corrupt_store(term_t file)
+{ return PL_error(NULL, 0, "incompatible or corrupt file",
+		  ERR_DOMAIN, ATOM_columnar_store, file);
+}
+
+
+/* load_store_table() defines the table at offset as a columnar predicate
+   whose columns and indexes are in the store.
+*/
+
+static int
+load_store_table(col_store *s, uint64_t offset, term_t file ARG_LD)
+{ const col_file_table *ft = (const col_file_table*)(s->base+offset);
+  column_table *t;
+  Procedure proc;
+  functor_t f;
+  unsigned int i;
+
+  if ( !in_store_aligned(s, offset, sizeofFileTable(1)) ||
+       ft->arity == 0 || ft->arity > COL_MAX_ARITY ||
+       !in_store(s, offset, sizeofFileTable(ft->arity)) ||
+       ft->module >= s->natoms || ft->name >= s->natoms ||
+       ft->rows >= UINT_MAX )
+    return corrupt_store(file);
+
+  for(i=0; i<ft->arity; i++)
+  { const col_file_column *fc = &ft->columns[i];
+
+    if ( fc->type > COL_WORD ||
+	 !in_store_aligned(s, fc->data,
+			   ft->rows*col_cell_size((col_type)fc->type)) )
+      return corrupt_store(file);
+    if ( fc->buckets &&
+	 ( (fc->buckets & (fc->buckets-1)) != 0 ||
+	   !in_store_aligned(s, fc->heads,
+			     (uint64_t)fc->buckets*sizeof(unsigned int)) ||
+	   !in_store_aligned(s, fc->next, ft->rows*sizeof(unsigned int)) ) )
+      return corrupt_store(file);
+  }
+
+  f = PL_new_functor(s->atoms[ft->name], ft->arity);
+  if ( !(proc = lookupProcedureToDefine(f, PL_new_module(s->atoms[ft->module]))) ||
+       !check_columnar_pred(proc) )
+    return FALSE;
+
+  t = allocHeapOrHalt(sizeof(*t) + (ft->arity-1)*sizeof(column));
+  t->rows  = (size_t)ft->rows;
+  t->arity = ft->arity;
+  t->store = s;
+  ATOMIC_INC(&s->references);
+  simpleMutexInit(&t->mutex);
+  for(i=0; i<ft->arity; i++)
+  { const col_file_column *fc = &ft->columns[i];
+    column *c = &t->columns[i];
+
+    c->type  = (col_type)fc->type;
+    c->v.any = s->base+fc->data;
+    if ( fc->buckets )
+    { col_index *ci = allocHeapOrHalt(sizeof(*ci));
+
+      ci->buckets = fc->buckets;
+      ci->used    = fc->used;
+      ci->heads   = (unsigned int*)(s->base+fc->heads);
+      ci->next    = (unsigned int*)(s->base+fc->next);
+      c->index = ci;
+    } else
+    { c->index = NULL;
+    }
+  }
+
+  return replace_clauses(proc, global_generation(), t, NULL PASS_LD);
+}
+
+
+/** columnar_load(+File) is det.
+ *
+ * Map a fact store created by columnar_save/2 and define its tables.
+ */
+
+static
+PRED_IMPL("columnar_load", 1, columnar_load, 0)
+{ PRED_LD
+  char *name;
+  struct stat buf;
+  col_store *s;
+  const col_file_header *h;
+  const uint64_t *offsets;
+  unsigned int i;
+  int rc;
+
+  if ( !PL_get_file_name(A1, &name, 0) )
+    return FALSE;
+  if ( stat(name, &buf) != 0 )
+    return PL_error(NULL, 0, OsError(), ERR_FILE_OPERATION,
+		    ATOM_open, ATOM_source_sink, A1);
+  if ( buf.st_size < (off_t)sizeof(col_file_header) )
+    return corrupt_store(A1);
+  if ( !(s=open_col_store(name, (size_t)buf.st_size)) )
+    return PL_error(NULL, 0, OsError(), ERR_FILE_OPERATION,
+		    ATOM_open, ATOM_source_sink, A1);
+
+  if ( !init_col_store(s) )
+  { release_col_store(s);
+    return PL_exception(0) ? FALSE : corrupt_store(A1);
+  }
+
+  h = (const col_file_header*)s->base;
+  offsets = (const uint64_t*)(s->base+h->tables);
+  for(i=0, rc=TRUE; rc && i<h->ntables; i++)
+    rc = load_store_table(s, offsets[i], A1 PASS_LD);
+  release_col_store(s);
+
+  return rc;
+}
+
+
+		 /*******************************
+		 *      PUBLISH PREDICATES	*
+		 *******************************/
+
+BeginPredDefs(column)
+  PRED_DEF("columnar",	      1, columnar,	    PL_FA_TRANSPARENT)
+  PRED_DEF("columnar_save",   2, columnar_save,	    PL_FA_TRANSPARENT)
+  PRED_DEF("columnar_load",   1, columnar_load,	    0)
+  PRED_DEF("$columnar_rows",  2, columnar_rows,	    PL_FA_TRANSPARENT)
+  PRED_DEF("$columnar_gen",   2, columnar_gen,	    PL_FA_NONDETERMINISTIC)
+EndPredDefs
@@ -152,7 +152,7 @@ initWamTable(void)
   { int index = wam_table[n]-dewam_table_offset;
     dewam_table[index] = (unsigned char) 0;
   }
-  for(n = 0; n < I_HIGHEST; n++)
+  for(n = 0; n < I_FIRST_FUSED; n++)
   { int index = wam_table[n]-dewam_table_offset;
     if ( dewam_table[index] )		/* See SEPERATE_VMI */
       fatalError("WAM Table mismatch: wam_table[%d(%s)] == wam_table[%d(%s)]\n",
@@ -160,6 +160,17 @@ initWamTable(void)
 		 n,		     codeTable[n].name);
     dewam_table[index] = (unsigned char) n;
   }
+  for(n = I_FIRST_FUSED; n < I_HIGHEST; n++)	/* decode() A__B as A */
+  { const vmi_fusion *f = &vmiFusionTable[n-I_FIRST_FUSED];
+    int index = wam_table[n]-dewam_table_offset;
+
+    assert(f->fused == n);
+    if ( dewam_table[index] )
+      fatalError("WAM Table mismatch: wam_table[%d(%s)] == wam_table[%d(%s)]\n",
+		 dewam_table[index], codeTable[dewam_table[index]].name,
+		 n,		     codeTable[n].name);
+    dewam_table[index] = (unsigned char) f->first;
+  }
 
   checkCodeTable();
   initSupervisors();
@@ -360,9 +371,11 @@ typedef struct
   int		argvars;		/* islocal argument pseudo vars */
   int		argvar;			/* islocal current pseudo var */
   int		singletons;		/* Marked singletons in disjunctions */
+  int		pinned_vars;		/* Choice vars below cannot be reused */
   cutInfo	cut;			/* how to compile ! */
   merge_state	mstate;			/* Instruction merging state */
   VarTable	used_var;		/* boolean array of used variables */
+  VarTable	float_var;		/* variables known to be floats */
   Buffer	branch_vars;		/* We are in a branch */
   target_module colon_context;		/* Context:Goal */
 #ifdef O_CALL_AT_MODULE
@@ -1055,6 +1068,7 @@ analyse_variables(Word head, Word body, CompileInfo ci ARG_LD)
   ci->clause->prolog_vars = nv;
   ci->clause->variables   = nv;
   ci->cut.nextvar	  = nv;
+  ci->pinned_vars	  = nv;
   ci->vartablesize	  = (int)((nv + BITSPERINT-1)/BITSPERINT);
 
   return TRUE;
@@ -1083,6 +1097,7 @@ calculation at runtime.
 #define A_ARG		0x04		/* sub-argument */
 #define A_RIGHT		0x08		/* rightmost argument */
 #define A_NOARGVAR	0x10		/* do not compile using ci->argvar */
+#define A_UNIFY		0x20		/* head code of a body unification */
 
 #define NOT_CALLABLE -10		/* return value for not-callable */
 
@@ -1115,10 +1130,11 @@ forwards bool	isFirstVarSet(VarTable vt, int n);
 forwards int	balanceVars(VarTable, VarTable, compileInfo *);
 forwards void	orVars(VarTable, VarTable);
 forwards int	compileListFF(word arg, compileInfo *ci ARG_LD);
+forwards Word	compileCodeList(Word arg, int isright, compileInfo *ci ARG_LD);
 forwards bool	compileSimpleAddition(Word, compileInfo * ARG_LD);
 #if O_COMPILE_ARITH
 forwards int	compileArith(Word, compileInfo * ARG_LD);
-forwards bool	compileArithArgument(Word, compileInfo * ARG_LD);
+forwards bool	compileArithArgument(Word, compileInfo *, int * ARG_LD);
 #endif
 #if O_COMPILE_IS
 forwards int	compileBodyUnify(Word arg, compileInfo *ci ARG_LD);
@@ -1289,6 +1305,37 @@ copyVarTable(VarTable to, VarTable from)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The float_var table marks variables that are  known to be bound to a
+float at the current point in the  body because they passed float/1 or
+are the result of is/2 on  an  expression   that  evaluates  to a float.
+compileArithArgument() uses this to  select   the  float  specialised
+arithmetic instructions.  Control structures restore the table, such
+that we only use knowledge from the  enclosing conjunction.  As the A_*_F
+instructions check the type at runtime, this is merely a hint.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+setFloatVar(compileInfo *ci, int n)
+{ if ( ci->float_var )
+    isFirstVarSet(ci->float_var, n);
+}
+
+static int
+isFloatVar(compileInfo *ci, int n)
+{ return ci->float_var && !isFirstVar(ci->float_var, n);
+}
+
+#define saveFloatVars(ci) \
+	((ci)->float_var ? mkCopiedVarTable((ci)->float_var) : NULL)
+
+static void
+restoreFloatVars(compileInfo *ci, VarTable saved)
+{ if ( saved )
+    copyVarTable(ci->float_var, saved);
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Reset all variables we initialised to the variable analysis  functor  to
 become variables again.
@@ -1331,9 +1378,11 @@ isFirstVarP(Word p, compileInfo *ci, int *i ARG_LD)
 
 static int
 allocChoiceVar(CompileInfo ci)
-{
-#if 0
-  int var = VAROFFSET(ci->cut.nextvar);
+{ int var;
+
+  if ( ci->cut.nextvar < ci->pinned_vars )
+    ci->cut.nextvar = ci->pinned_vars;
+  var = VAROFFSET(ci->cut.nextvar);
 
   if ( ++ci->cut.nextvar > ci->clause->variables )
   { ci->clause->variables = ci->cut.nextvar;
@@ -1341,13 +1390,15 @@ allocChoiceVar(CompileInfo ci)
       return PL_error(NULL, 0, NULL, ERR_REPRESENTATION,
 		      ATOM_max_frame_size);
   }
-#else
-  int var = VAROFFSET(ci->clause->variables++);
 
-  if ( ci->clause->variables == 0 )
-    return PL_error(NULL, 0, NULL, ERR_REPRESENTATION,
-		    ATOM_max_frame_size);
-#endif
+  return var;
+}
+
+static int
+allocSoftChoiceVar(CompileInfo ci)
+{ int var = allocChoiceVar(ci);
+
+  ci->pinned_vars = ci->cut.nextvar;
 
   return var;
 }
@@ -1426,6 +1477,14 @@ These  functions  provide  a  small    state-machine   that  merges  new
 instructions with the previous one. The  declarations of which sequences
 to merge are defined in initVMIMerge().
 
+Besides the rules  below,  initVMIMerge()  adds  the  superinstructions
+generated  by  mkvmi.c from  vmiFusionTable[]. If A is followed by B and
+A__B exists, the opcode of A is  replaced by  A__B and B is emitted as
+normal.  This only happens if the instruction at merge_pos is still A
+and B immediately follows its arguments. The interpreter checks that B
+is still there before jumping into it, so B may be replaced or stepped by
+other rules or the debugger.
+
 TBD: After reduction, we should try reducing   with the previous one, as
 in: X, Y, Z --> X, YZ --> XYZ.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
@@ -1488,6 +1547,20 @@ mergeStep(vmi c1, vmi c2)
 }
 
 
+static void
+mergeFuse(vmi c1, vmi c2, vmi fused)
+{ vmi_merge m;
+
+  memset(&m, 0, sizeof(m));
+  m.code        = c2;
+  m.how         = VMI_FUSE;
+  m.merge_op    = fused;
+  m.merge_av[0] = c1;
+
+  addMerge(c1, &m);
+}
+
+
 static void
 initVMIMerge(void)
 { mergeStep(H_VOID_N, H_VOID);
@@ -1499,6 +1572,14 @@ initVMIMerge(void)
   mergeSeq(H_VOID_N, I_EXITFACT, I_EXITFACT, 0);
   mergeSeq(H_VOID,   H_POP,      H_POP,      0);
   mergeSeq(H_VOID_N, H_POP,      H_POP,      0);
+
+#if VMCODE_IS_ADDRESS
+  { const vmi_fusion *f;
+
+    for(f=vmiFusionTable; f->fused != VMI_END_LIST; f++)
+      mergeFuse(f->first, f->second, f->fused);
+  }
+#endif
 }
 
 
@@ -1508,6 +1589,47 @@ initMerge(CompileInfo ci)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+fuseClauseCode() introduces the superinstructions in  code that was not
+created by the compiler, notably clauses  loaded  from  QLF  files  and
+saved states. As in the compiler, A is only replaced by A__B if no other
+merge rule applies to the sequence A B.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void
+fuseClauseCode(Clause clause)
+{
+#if VMCODE_IS_ADDRESS
+  Code PC, end;
+
+  if ( I_FIRST_FUSED == I_HIGHEST )
+    return;
+
+  PC  = clause->codes;
+  end = PC + clause->code_size;
+  while( PC < end )
+  { code op = fetchop(PC);
+    Code next = stepPC(PC);
+    const vmi_merge *m;
+
+    if ( next < end && (m=merge_def[op]) && *PC == encode(op) )
+    { code nop = fetchop(next);
+
+      for(; m->code != I_HIGHEST; m++)
+      { if ( m->code == nop )
+	{ if ( m->how == VMI_FUSE )
+	    *PC = encode(m->merge_op);
+	  break;
+	}
+      }
+    }
+
+    PC = next;
+  }
+#endif
+}
+
+
 static int
 mergeInstructions(CompileInfo ci, const vmi_merge *m, vmi c)
 { for(; m->code != I_HIGHEST; m++)
@@ -1532,6 +1654,19 @@ mergeInstructions(CompileInfo ci, const vmi_merge *m, vmi c)
 	  OpCode(ci, ci->mstate.merge_pos+1)++;
 	  return TRUE;
 	}
+	case VMI_FUSE:
+	{ size_t pos = ci->mstate.merge_pos;
+	  vmi first = (vmi)m->merge_av[0];
+
+	  if ( OpCode(ci, pos) == encode(first) &&
+	       pos + 1 + codeTable[first].arguments == PC(ci) )
+	  { DEBUG(2, Sdprintf("Fusing %s at %d with %s\n",
+			      codeTable[first].name, (int)pos,
+			      codeTable[c].name));
+	    OpCode(ci, pos) = encode(m->merge_op);
+	  }
+	  return FALSE;			/* emit c as normal */
+	}
       }
       break;
     }
@@ -1564,6 +1699,183 @@ Output_0(CompileInfo ci, vmi c)
 		 *	CODE GENERATION		*
 		 *******************************/
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Determinism guards
+
+If the body of a clause starts with an inlined type test on an argument
+or an inlined arithmetic comparison between arguments and/or small
+integers, compileDetGuard() inserts C_DETGUARD directly after this test.
+The instruction carries a description of the guard:
+
+	C_DETGUARD DG_TYPE <var> <type mask>
+	C_DETGUARD <cmp> <var> <var>
+	C_DETGUARD <cmp>|DG_CONST <var> <integer>
+
+If C_DETGUARD is reached while the clause still has  a  choicepoint  and
+the only remaining candidate clause starts with a guard that cannot be
+true if ours is true, the choicepoint is discarded (see detGuardPrunes()).
+This makes e.g. the classical definition below deterministic:
+
+	max(X, Y, X) :- X >= Y.
+	max(X, Y, Y) :- X < Y.
+
+Note that arithmetic is only inlined if the `optimise` flag is set.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define DG_TYPE		0x0		/* type test */
+#define DG_LT		0x1		/* arithmetic comparison */
+#define DG_LE		0x2
+#define DG_GT		0x3
+#define DG_GE		0x4
+#define DG_EQ		0x5
+#define DG_NE		0x6
+#define DG_OP_MASK	0x7
+#define DG_CONST	0x8		/* right operand is an integer */
+
+#define DG_T_VAR	0x01		/* value classes for DG_TYPE */
+#define DG_T_INTEGER	0x02
+#define DG_T_RATIONAL	0x04		/* non-integer rational */
+#define DG_T_FLOAT	0x08
+#define DG_T_ATOM	0x10		/* text atom */
+#define DG_T_BLOB	0x20		/* other atom */
+#define DG_T_STRING	0x40
+#define DG_T_COMPOUND	0x80
+#define DG_T_NUMBER	(DG_T_INTEGER|DG_T_RATIONAL|DG_T_FLOAT)
+#define DG_T_ATOMIC	(DG_T_NUMBER|DG_T_ATOM|DG_T_BLOB|DG_T_STRING)
+
+static const struct
+{ vmi	instruction;
+  code	mask;				/* classes for which it may succeed */
+} det_guard_types[] =
+{ { I_VAR,	DG_T_VAR },
+  { I_NONVAR,	DG_T_ATOMIC|DG_T_COMPOUND },
+  { I_INTEGER,	DG_T_INTEGER },
+  { I_RATIONAL,	DG_T_INTEGER|DG_T_RATIONAL },
+  { I_FLOAT,	DG_T_FLOAT },
+  { I_NUMBER,	DG_T_NUMBER },
+  { I_ATOMIC,	DG_T_ATOMIC },
+  { I_ATOM,	DG_T_ATOM },
+  { I_STRING,	DG_T_STRING },
+  { I_COMPOUND,	DG_T_COMPOUND },
+  { I_CALLABLE,	DG_T_ATOM|DG_T_BLOB|DG_T_COMPOUND },
+  { I_HIGHEST,	0 }
+};
+
+static int
+detGuardCmp(vmi op)
+{ switch(op)
+  { case A_LT: return DG_LT;
+    case A_LE: return DG_LE;
+    case A_GT: return DG_GT;
+    case A_GE: return DG_GE;
+    case A_EQ: return DG_EQ;
+    case A_NE: return DG_NE;
+    default:   return 0;
+  }
+}
+
+static int
+mirrorDetGuardCmp(int cmp)		/* A op B <-> B op' A */
+{ switch(cmp)
+  { case DG_LT: return DG_GT;
+    case DG_LE: return DG_GE;
+    case DG_GT: return DG_LT;
+    case DG_GE: return DG_LE;
+    default:	return cmp;
+  }
+}
+
+/* detGuardOperand() decodes an arithmetic operand at *pcp.  Returns
+   1 if it is an argument variable, 2 if it is an integer and 0 otherwise.
+*/
+
+static int
+detGuardOperand(Code *pcp, code *value, int arity)
+{ Code PC = *pcp;
+  int rc = 1;
+
+  switch(decode(*PC))
+  { case A_VAR0: *value = VAROFFSET(0); break;
+    case A_VAR1: *value = VAROFFSET(1); break;
+    case A_VAR2: *value = VAROFFSET(2); break;
+    case A_VAR:	 *value = PC[1];	break;
+    case A_INTEGER:
+      *value = PC[1];
+      rc = 2;
+      break;
+    default:
+      return 0;
+  }
+
+  if ( rc == 1 && !(*value >= (code)VAROFFSET(0) &&
+		    *value < (code)VAROFFSET(arity)) )
+    return 0;
+
+  *pcp = stepPC(PC);
+  return rc;
+}
+
+static void
+compileDetGuard(compileInfo *ci, size_t bi)
+{ Code base = baseBuffer(&ci->codes, code);
+  Code PC = base+bi;
+  Code last = PC;
+  vmi op = decode(*PC);
+  code guard[3];
+
+  if ( op == A_ENTER )
+  { code v1, v2;
+    int t1, t2, cmp;
+
+    PC = stepPC(PC);
+    if ( !(t1 = detGuardOperand(&PC, &v1, ci->arity)) ||
+	 !(t2 = detGuardOperand(&PC, &v2, ci->arity)) ||
+	 !(cmp = detGuardCmp(decode(*PC))) )
+      return;
+    if ( t1 == 2 )
+    { if ( t2 == 2 )
+	return;
+      guard[0] = mirrorDetGuardCmp(cmp)|DG_CONST;
+      guard[1] = v2;
+      guard[2] = v1;
+    } else
+    { guard[0] = (t2 == 2 ? cmp|DG_CONST : cmp);
+      guard[1] = v1;
+      guard[2] = v2;
+    }
+  } else
+  { int i;
+
+    for(i=0; det_guard_types[i].instruction != op; i++)
+    { if ( det_guard_types[i].instruction == I_HIGHEST )
+	return;
+    }
+    if ( !(PC[1] >= (code)VAROFFSET(0) && PC[1] < (code)VAROFFSET(ci->arity)) )
+      return;
+    guard[0] = DG_TYPE;
+    guard[1] = PC[1];
+    guard[2] = det_guard_types[i].mask;
+  }
+
+  last = PC;
+  PC = stepPC(PC);
+
+  { size_t at = PC-base;
+    size_t size = entriesBuffer(&ci->codes, code);
+    int i;
+
+    *last = encode(decode(*last));	/* undo fusing with its successor */
+    for(i=0; i<4; i++)
+      addBuffer(&ci->codes, (code)0, code);
+    base = baseBuffer(&ci->codes, code);
+    memmove(&base[at+4], &base[at], (size-at)*sizeof(code));
+    base[at] = encode(C_DETGUARD);
+    memcpy(&base[at+1], guard, sizeof(guard));
+    set(ci->clause, CL_DET_GUARD);
+  }
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Clause	compileClause(Word head, Word body, Procedure proc, Module module)
 
@@ -1663,8 +1975,11 @@ compileClause(Clause *cp, Word head, Word body,
   if ( !ci.islocal )
   { ci.used_var = alloca(sizeofVarTable(ci.vartablesize));
     clearVarTable(&ci);
+    ci.float_var = mkCopiedVarTable(ci.used_var);
   } else
-    ci.used_var = NULL;
+  { ci.used_var = NULL;
+    ci.float_var = NULL;
+  }
 
   initBuffer(&ci.codes);
   initMerge(&ci);
@@ -1727,8 +2042,10 @@ that have an I_CONTEXT because we need to reset the context.
       goto exit_fail;
     }
     Output_0(&ci, I_EXIT);
-    if ( OpCode(&ci, bi) == encode(I_CUT) )
+    if ( decode(OpCode(&ci, bi)) == I_CUT )
     { set(&clause, COMMIT_CLAUSE);
+    } else if ( head )
+    { compileDetGuard(&ci, bi);
     }
   } else
   { set(&clause, UNIT_CLAUSE);		/* fact (for decompiler) */
@@ -1755,7 +2072,7 @@ Finish up the clause.
       goto exit_fail;
     }
 
-    cl = PL_malloc_atomic(size);
+    cl = arena_alloc(size);
     ATOMIC_ADD(&m->code_size, clsize);
     memcpy(cl, &clause, sizeofClause(0));
     memcpy(cl->codes, baseBuffer(&ci.codes, code), sizeOfBuffer(&ci.codes));
@@ -1919,6 +2236,7 @@ right_argument:
 		  fd == FUNCTOR_bar2 )		/* A ; B and (A -> B ; C) */
       { Word a0 = argTermP(*body, 0);
 	VarTable vsave, valt1, valt2;
+	VarTable fsave = saveFloatVars(ci);
 	int hard;
 
 	if ( !ci->islocal )
@@ -1940,7 +2258,7 @@ right_argument:
 	  cutInfo cutsave = ci->cut;
 	  int fast = FALSE;
 
-	  if ( !(var=allocChoiceVar(ci)) )
+	  if ( !(var=(hard ? allocChoiceVar(ci) : allocSoftChoiceVar(ci))) )
 	    return FALSE;
 
 	  Output_2(ci, hard ? C_IFTHENELSE : C_SOFTIF, var, (code)0);
@@ -1993,6 +2311,7 @@ right_argument:
 	{ orVars(valt1, valt2);
 	  copyVarTable(ci->used_var, valt1);
 	}
+	restoreFloatVars(ci, fsave);
 
 	succeed;
       } else if ( fd == FUNCTOR_ifthen2 ||		/* A -> B */
@@ -2001,8 +2320,9 @@ right_argument:
 	int rv;
 	int hard = (fd == FUNCTOR_ifthen2);
 	cutInfo cutsave = ci->cut;
+	VarTable fsave = saveFloatVars(ci);
 
-	if ( !(var=allocChoiceVar(ci)) )
+	if ( !(var=(hard ? allocChoiceVar(ci) : allocSoftChoiceVar(ci))) )
 	  return FALSE;
 
 	Output_1(ci, hard ? C_IFTHEN : C_SOFTIFTHEN, var);
@@ -2018,12 +2338,14 @@ right_argument:
 	if ( (rv=compileBody(argTermP(*body, 1), call, ci PASS_LD)) != TRUE )
 	  return rv;
 	Output_0(ci, C_END);
+	restoreFloatVars(ci, fsave);
 
 	succeed;
       } else if ( fd == FUNCTOR_not_provable1 )		/* \+/1 */
       { int var;
 	size_t tc_or;
 	VarTable vsave;
+	VarTable fsave = saveFloatVars(ci);
 	int rv;
 	cutInfo cutsave = ci->cut;
 
@@ -2060,6 +2382,7 @@ right_argument:
 	    OpCode(ci, tc_or-1) = (code)(PC(ci) - tc_or);
 	  }
 	}
+	restoreFloatVars(ci, fsave);
 
 	succeed;
 #endif /* O_COMPILE_OR */
@@ -2135,6 +2458,10 @@ try_fast_condition(CompileInfo ci, size_t tc_or)
       case A_FUNC:
       case A_ADD:
       case A_MUL:
+      case A_ADD_F:
+      case A_SUB_F:
+      case A_MUL_F:
+      case A_DIV_F:
       case A_LT:
       case A_LE:
       case A_GT:
@@ -2408,8 +2735,23 @@ isvar:
     { code c;
 
       if ( (where & A_HEAD) )		/* index in array! */
-      { if ( compileListFF(*arg, ci PASS_LD) )
+      { Word tail;
+	int rc;
+
+	if ( compileListFF(*arg, ci PASS_LD) )
 	  return TRUE;
+	if ( (where & A_UNIFY) &&
+	     (tail = compileCodeList(arg, isright, ci PASS_LD)) )
+	{ where &= ~A_NOARGVAR;
+	  where |= A_ARG|A_RIGHT;
+	  arg = tail;
+	  if ( isright )
+	    goto right_recursion;
+	  if ( (rc=compileArgument(arg, where, ci PASS_LD)) < 0 )
+	    return rc;
+	  Output_0(ci, H_POP);
+	  return TRUE;
+	}
 	c = (isright ? H_RLIST : H_LIST);
       } else
       { c = (isright ? B_RLIST : B_LIST);
@@ -2482,6 +2824,53 @@ compileListFF(word arg, compileInfo *ci ARG_LD)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+compileCodeList() compiles a prefix of at least two list cells that hold
+codes in the range 0..255 into a single H_CODES or H_RCODES instruction.
+The codes are stored as a byte  string   in  the  same format as strings
+compiled by H_STRING. Returns the remaining tail  or NULL if the list does
+not start with a code prefix. This is  only used for body unifications as
+clause indexing does not look into the string.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define MAX_CODE_PREFIX 256
+
+static Word
+compileCodeList(Word arg, int isright, compileInfo *ci ARG_LD)
+{ unsigned char buf[MAX_CODE_PREFIX+1];
+  size_t len = 0;
+  Word p = arg;
+
+  while ( len < MAX_CODE_PREFIX && isList(*p) )
+  { Word h = HeadList(p);
+
+    deRef(h);
+    if ( !isTaggedInt(*h) || valInt(*h) < 0 || valInt(*h) > 0xff )
+      break;
+    buf[++len] = (unsigned char)valInt(*h);
+    p = TailList(p);
+    deRef(p);
+  }
+
+  if ( len < 2 )
+    return NULL;
+
+  { size_t bytes = len+1;			/* 'B' + codes */
+    size_t lw = (bytes+sizeof(word))/sizeof(word);
+    int pad = (int)(lw*sizeof(word) - bytes);
+    word data[MAX_CODE_PREFIX/sizeof(word)+2];
+
+    memset(data, 0, sizeof(data));
+    buf[0] = 'B';
+    memcpy(data, buf, bytes);
+    Output_1(ci, isright ? H_RCODES : H_CODES, mkStrHdr(lw, pad));
+    Output_an(ci, data, lw);
+  }
+
+  return p;
+}
+
+
 static inline code
 mcall(code call)
 { switch(call)
@@ -2867,20 +3256,25 @@ compileArith(Word arg, compileInfo *ci ARG_LD)
   else if ( fdef == FUNCTOR_is2 )				/* is */
   { size_t tc_a1 = PC(ci);
     code isvar;
-    int rc;
+    int rc, isfloat, index;
+    Word a1 = argTermP(*arg, 0);
 
+    deRef(a1);
+    index = isIndexedVarTerm(*a1 PASS_LD);
     rc=compileArgument(argTermP(*arg, 0), A_BODY, ci PASS_LD);
     if ( rc != TRUE )
       return rc;
-    if ( PC(ci) == tc_a1 + 2 &&	OpCode(ci, tc_a1) == encode(B_FIRSTVAR) )
+    if ( PC(ci) == tc_a1 + 2 &&	decode(OpCode(ci, tc_a1)) == B_FIRSTVAR )
     { isvar = OpCode(ci, tc_a1+1);
       seekBuffer(&ci->codes, tc_a1, code);
     } else
       isvar = 0;
     Output_0(ci, A_ENTER);
-    rc = compileArithArgument(argTermP(*arg, 1), ci PASS_LD);
+    rc = compileArithArgument(argTermP(*arg, 1), ci, &isfloat PASS_LD);
     if ( rc != TRUE )
       return rc;
+    if ( isfloat && index >= 0 )
+      setFloatVar(ci, index);
     if ( isvar )
       Output_1(ci, A_FIRSTVAR_IS, isvar);
     else
@@ -2892,8 +3286,8 @@ compileArith(Word arg, compileInfo *ci ARG_LD)
   }
 
   Output_0(ci, A_ENTER);
-  if ( !compileArithArgument(argTermP(*arg, 0), ci PASS_LD) ||
-       !compileArithArgument(argTermP(*arg, 1), ci PASS_LD) )
+  if ( !compileArithArgument(argTermP(*arg, 0), ci, NULL PASS_LD) ||
+       !compileArithArgument(argTermP(*arg, 1), ci, NULL PASS_LD) )
     fail;
 
   Output_0(ci, a_func);
@@ -2933,12 +3327,240 @@ arithVarOffset(Word arg, compileInfo *ci, int *offp ARG_LD)
 }
 
 
+/* isFloatFunction() is true if fdef always evaluates to a float */
+
 static int
-compileArithArgument(Word arg, compileInfo *ci ARG_LD)
+isFloatFunction(functor_t fdef)
+{ return ( fdef == FUNCTOR_float1 ||
+	   fdef == FUNCTOR_sqrt1 ||
+	   fdef == FUNCTOR_sin1 ||
+	   fdef == FUNCTOR_cos1 ||
+	   fdef == FUNCTOR_tan1 ||
+	   fdef == FUNCTOR_asin1 ||
+	   fdef == FUNCTOR_acos1 ||
+	   fdef == FUNCTOR_atan1 ||
+	   fdef == FUNCTOR_atan2 ||
+	   fdef == FUNCTOR_atan22 ||
+	   fdef == FUNCTOR_exp1 ||
+	   fdef == FUNCTOR_log1 ||
+	   fdef == FUNCTOR_pi0 ||
+	   fdef == FUNCTOR_e0 ||
+	   fdef == FUNCTOR_inf0 ||
+	   fdef == FUNCTOR_nan0 ||
+	   fdef == FUNCTOR_epsilon0 ||
+	   fdef == FUNCTOR_random_float0 ||
+	   fdef == FUNCTOR_cputime0 );
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+foldArithConstant() is true if p is a  ground expression over integers
+using only integer functions whose result   does  not depend on flags or
+global state. If so, *val is the  value   of  the expression. We only
+fold if the result and all intermediate   results fit in an int64_t and
+the evaluation raises no error, such that these cases are left to the
+runtime with unmodified behaviour.  Float expressions are never folded
+as they depend on the float flags and rounding mode.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+foldMul64(int64_t x, int64_t y, int64_t *r)
+{
+#ifdef HAVE__BUILTIN_MUL_OVERFLOW
+  return !__builtin_mul_overflow(x, y, r);
+#else
+  int64_t prod;
+
+  if ( x == 0 || y == 0 )
+  { *r = 0;
+    return TRUE;
+  }
+  if ( (x == -1 && y == PLMININT) || (y == -1 && x == PLMININT) )
+    return FALSE;
+  prod = (int64_t)((uint64_t)x*(uint64_t)y);
+  if ( prod/y != x )
+    return FALSE;
+  *r = prod;
+  return TRUE;
+#endif
+}
+
+
+static int
+foldArithConstant(Word p, int64_t *val ARG_LD)
+{ functor_t fdef;
+  int64_t x, y;
+  size_t arity;
+
+  deRef(p);
+  if ( isTaggedInt(*p) )
+  { *val = valInt(*p);
+    return TRUE;
+  }
+  if ( isBignum(*p) )
+  { *val = valBignum(*p);
+    return TRUE;
+  }
+  if ( !isTerm(*p) )
+    return FALSE;
+
+  fdef  = functorTerm(*p);
+  arity = arityFunctor(fdef);
+
+  if ( arity == 1 )
+  { if ( !foldArithConstant(argTermP(*p, 0), &x PASS_LD) )
+      return FALSE;
+
+    if ( fdef == FUNCTOR_minus1 )
+    { if ( x == PLMININT )
+	return FALSE;
+      *val = -x;
+    } else if ( fdef == FUNCTOR_plus1 )
+    { *val = x;
+    } else if ( fdef == FUNCTOR_abs1 )
+    { if ( x == PLMININT )
+	return FALSE;
+      *val = x < 0 ? -x : x;
+    } else if ( fdef == FUNCTOR_sign1 )
+    { *val = x < 0 ? -1 : x > 0 ? 1 : 0;
+    } else if ( fdef == FUNCTOR_backslash1 )
+    { *val = ~x;
+    } else if ( fdef == FUNCTOR_msb1 )
+    { if ( x <= 0 )
+	return FALSE;
+      *val = MSB64(x);
+    } else
+      return FALSE;
+
+    return TRUE;
+  }
+
+  if ( arity != 2 ||
+       !foldArithConstant(argTermP(*p, 0), &x PASS_LD) ||
+       !foldArithConstant(argTermP(*p, 1), &y PASS_LD) )
+    return FALSE;
+
+  if ( fdef == FUNCTOR_plus2 )
+  { int64_t r = (int64_t)((uint64_t)x+(uint64_t)y);
+
+    if ( ((x^r)&(y^r)) < 0 )
+      return FALSE;
+    *val = r;
+  } else if ( fdef == FUNCTOR_minus2 )
+  { int64_t r = (int64_t)((uint64_t)x-(uint64_t)y);
+
+    if ( ((x^y)&(x^r)) < 0 )
+      return FALSE;
+    *val = r;
+  } else if ( fdef == FUNCTOR_star2 )
+  { int64_t r;
+
+    if ( !foldMul64(x, y, &r) )
+      return FALSE;
+    *val = r;
+  } else if ( fdef == FUNCTOR_gdiv2 )
+  { if ( y == 0 || (y == -1 && x == PLMININT) )
+      return FALSE;
+    *val = x/y;
+  } else if ( fdef == FUNCTOR_mod2 || fdef == FUNCTOR_div2 )
+  { int64_t m;
+
+    if ( y == 0 || y == -1 )
+      return FALSE;
+    m = x % y;
+    if ( m != 0 && (m<0) != (y<0) )
+      m += y;
+    *val = ( fdef == FUNCTOR_mod2 ? m : (x-m)/y );
+  } else if ( fdef == FUNCTOR_rem2 )
+  { if ( y == 0 || y == -1 )
+      return FALSE;
+    *val = x % y;
+  } else if ( fdef == FUNCTOR_min2 )
+  { *val = x < y ? x : y;
+  } else if ( fdef == FUNCTOR_max2 )
+  { *val = x > y ? x : y;
+  } else if ( fdef == FUNCTOR_and2 )
+  { *val = x & y;
+  } else if ( fdef == FUNCTOR_bitor2 )
+  { *val = x | y;
+  } else if ( fdef == FUNCTOR_xor2 )
+  { *val = x ^ y;
+  } else if ( fdef == FUNCTOR_rshift2 )
+  { if ( y < 0 )
+      return FALSE;
+    *val = ( y >= 64 ? (x < 0 ? -1 : 0) : x >> y );
+  } else if ( fdef == FUNCTOR_lshift2 )
+  { int64_t m = (x < 0 ? ~x : x);
+
+    if ( y < 0 || y >= 63 || (m != 0 && MSB64(m) + y >= 62) )
+      return FALSE;
+    *val = (int64_t)((uint64_t)x << y);
+  } else if ( fdef == FUNCTOR_hat2 )
+  { int64_t r = 1;
+
+    if ( y < 0 )
+      return FALSE;
+    if ( x >= -1 && x <= 1 )		/* 0^N, 1^N, -1^N */
+    { r = ( y == 0 ? 1 : x == -1 && (y&1) == 0 ? 1 : x );
+    } else
+    { while ( y-- > 0 )			/* at most 63 iterations */
+      { if ( !foldMul64(r, x, &r) )
+	  return FALSE;
+      }
+    }
+    *val = r;
+  } else
+    return FALSE;
+
+  return TRUE;
+}
+
+
+static void
+compileArithInt64(compileInfo *ci, int64_t val)
+{
+#if SIZEOF_VOIDP == 8
+  Output_1(ci, A_INTEGER, val);
+#else
+  if ( val >= LONG_MIN && val <= LONG_MAX )
+  { Output_1(ci, A_INTEGER, (word)val);
+  } else
+  { union
+    { int64_t val;
+      word w[WORDS_PER_INT64];
+    } cvt;
+
+    cvt.val = val;
+    Output_n(ci, A_INT64, cvt.w, WORDS_PER_INT64);
+  }
+#endif
+}
+
+
+static int
+isIntConstant(Word p, int64_t i ARG_LD)
+{ int64_t v;
+
+  return foldArithConstant(p, &v PASS_LD) && v == i;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+compileArithArgument() compiles an arithmetic  expression.   If  isfloat
+is  not  NULL,  it  is  set  to  TRUE if the expression is known to
+evaluate to a float.  This is used to emit the float specialised A_*_F
+instructions for +, -, * and /.  As  these   instructions  check  the
+types at runtime anyway, this only needs to be a good guess.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+compileArithArgument(Word arg, compileInfo *ci, int *isfloat ARG_LD)
 { int index;
   int rc;
 
   deRef(arg);
+  if ( isfloat )
+    *isfloat = FALSE;
 
   if ( isRational(*arg) )
   { if ( storage(*arg) == STG_INLINE )
@@ -2983,11 +3605,15 @@ compileArithArgument(Word arg, compileInfo *ci ARG_LD)
   { Word p = valIndirectP(*arg);
 
     Output_n(ci, A_DOUBLE, p, WORDS_PER_DOUBLE);
+    if ( isfloat )
+      *isfloat = TRUE;
     succeed;
   }
 
   if ( (rc=arithVarOffset(arg, ci, &index PASS_LD)) == TRUE )
-  { if ( index < 3 )
+  { if ( isfloat && isFloatVar(ci, index) )
+      *isfloat = TRUE;
+    if ( index < 3 )
       Output_0(ci, A_VAR0 + index);
     else
       Output_1(ci, A_VAR, VAROFFSET(index));
@@ -2997,6 +3623,15 @@ compileArithArgument(Word arg, compileInfo *ci ARG_LD)
   { return FALSE;
   }
 
+  if ( isTerm(*arg) )				/* constant folding */
+  { int64_t val;
+
+    if ( foldArithConstant(arg, &val PASS_LD) )
+    { compileArithInt64(ci, val);
+      return TRUE;
+    }
+  }
+
 						/* callable (function) */
   { functor_t fdef;
     size_t n, ar;
@@ -3034,6 +3669,14 @@ compileArithArgument(Word arg, compileInfo *ci ARG_LD)
       return FALSE;
     }
 
+    if ( ar == 2 )			/* X*1, 1*X and X-0 are X */
+    { if ( (fdef == FUNCTOR_star2 && isIntConstant(a+1, 1 PASS_LD)) ||
+	   (fdef == FUNCTOR_minus2 && isIntConstant(a+1, 0 PASS_LD)) )
+	return compileArithArgument(a, ci, isfloat PASS_LD);
+      if ( fdef == FUNCTOR_star2 && isIntConstant(a, 1 PASS_LD) )
+	return compileArithArgument(a+1, ci, isfloat PASS_LD);
+    }
+
     if ( fdef == FUNCTOR_roundtoward2 )
     { Word m;
       int mode;
@@ -3055,14 +3698,39 @@ compileArithArgument(Word arg, compileInfo *ci ARG_LD)
 	return FALSE;
       }
 
-      compileArithArgument(a, ci PASS_LD);
+      compileArithArgument(a, ci, NULL PASS_LD);
     } else
-    { for(a+=ar-1, n=ar; n-- > 0; a--)
-      { if ( !compileArithArgument(a, ci PASS_LD) )
+    { int fargs = 0;
+
+      for(a+=ar-1, n=ar; n-- > 0; a--)
+      { int af;
+
+	if ( !compileArithArgument(a, ci, &af PASS_LD) )
 	  return FALSE;
+	fargs += af;
+      }
+
+      if ( ar == 2 && fargs > 0 )
+      { code op;
+
+	if      ( fdef == FUNCTOR_plus2 )   op = A_ADD_F;
+	else if ( fdef == FUNCTOR_minus2 )  op = A_SUB_F;
+	else if ( fdef == FUNCTOR_star2 )   op = A_MUL_F;
+	else if ( fdef == FUNCTOR_divide2 ) op = A_DIV_F;
+	else				    op = 0;
+
+	if ( op )
+	{ Output_0(ci, op);
+	  if ( isfloat )
+	    *isfloat = TRUE;
+	  succeed;
+	}
       }
     }
 
+    if ( isfloat && isFloatFunction(fdef) )
+      *isfloat = TRUE;
+
     if ( fdef == FUNCTOR_plus2 )
     { Output_0(ci, A_ADD);
       succeed;
@@ -3202,7 +3870,7 @@ compileBodyUnify(Word arg, compileInfo *ci ARG_LD)
       if ( isAtom(*a2) )
 	PL_register_atom(*a2);
     } else
-    { int where = (first ? A_BODY : A_HEAD|A_ARG);
+    { int where = (first ? A_BODY : A_HEAD|A_ARG|A_UNIFY);
       Output_1(ci, first ? B_UNIFY_FIRSTVAR : B_UNIFY_VAR, VAROFFSET(i1));
       if ( (rc=compileArgument(a2, where, ci PASS_LD)) < 0 )
 	return rc;
@@ -3478,6 +4146,8 @@ compileTypeTest(Word arg,
     }
 
     Output_1(ci, instruction, VAROFFSET(i1));
+    if ( instruction == I_FLOAT )
+      setFloatVar(ci, i1);
     return TRUE;
   }
 
@@ -3638,6 +4308,11 @@ stepDynPC(Code PC, const code_info *ci)
       case CA1_INT64:
 	PC += WORDS_PER_INT64;
 	break;
+      case CA1_SWITCH:
+      { size_t n = (size_t)*PC++;
+	PC += n*2;
+	break;
+      }
       default:
 	PC++;
     }
@@ -3770,7 +4445,11 @@ takes care of reconsult, redefinition, etc.
     def = getProcDefinition(proc);	/* may be changed */
 
     if ( proc != of->current_procedure )
-    { if ( def->impl.any.defined )
+    { if ( !loadedDefinition(def) )
+      { freeClause(clause);
+	return NULL;
+      }
+      if ( def->impl.any.defined )
       { if ( !redefineProcedure(proc, of, 0) )
 	{ freeClause(clause);
 	  return NULL;
@@ -3782,65 +4461,322 @@ This `if` locks predicates as system  predicates   if  we  are in system
 mode, the predicate is still undefined and is not dynamic or multifile.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-      if ( !isDefinedProcedure(proc) )
-      { if ( SYSTEM_MODE )
-	{ if ( false(def, P_LOCKED) )
-	    set(def, HIDE_CHILDS|P_LOCKED);
-	} else
-	{ if ( truePrologFlag(PLFLAG_DEBUGINFO) )
-	    clear(def, HIDE_CHILDS);
-	  else
-	    set(def, HIDE_CHILDS);
-	}
-      }
+      if ( !isDefinedProcedure(proc) )
+      { if ( SYSTEM_MODE )
+	{ if ( false(def, P_LOCKED) )
+	    set(def, HIDE_CHILDS|P_LOCKED);
+	} else
+	{ if ( truePrologFlag(PLFLAG_DEBUGINFO) )
+	    clear(def, HIDE_CHILDS);
+	  else
+	    set(def, HIDE_CHILDS);
+	}
+      }
+
+      addProcedureSourceFile(of, proc);
+      of->current_procedure = proc;
+    }
+
+    if ( (cref=assertProcedureSource(of, proc, clause PASS_LD)) )
+    { clause = cref->value.clause;
+
+      if ( warnings && !PL_get_nil(warnings) )
+      { int rc;
+	fid_t fid = PL_open_foreign_frame();
+	term_t cl = PL_new_term_ref();
+
+	PL_put_clref(cl, clause);
+	rc = printMessage(ATOM_warning,
+			  PL_FUNCTOR_CHARS, "compiler_warnings", 2,
+			    PL_TERM, cl,
+			    PL_TERM, warnings);
+	PL_discard_foreign_frame(fid);
+	if ( !rc )
+	{ freeClause(clause);
+	  return NULL;
+	}
+      }
+
+      return clause;
+    }
+    return NULL;
+  }
+
+  /* assert[az]/1 */
+
+  if ( false(def, P_DYNAMIC) )
+  { if ( isDefinedProcedure(proc) )
+    { PL_error(NULL, 0, NULL, ERR_MODIFY_STATIC_PROC, proc);
+      goto error;
+    }
+    if ( !setDynamicDefinition(def, TRUE) )
+      goto error;
+  }
+
+  if ( (cref=assertProcedure(proc, clause, where PASS_LD)) )
+    return cref->value.clause;
+
+error:
+  freeClause(clause);
+  return NULL;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+assert_all() implements assertz_all/1, asserta_all/1 and PL_assert_all().
+It is intended for quickly  loading  large   amounts  of  facts. We first
+compile all clauses and make the involved predicates dynamic. Only if this
+succeeds we add the clauses, such that   a  type or permission error does
+not leave the database half-updated. Consecutive clauses for the same
+predicate are added using assertDefinitionList(),  which  makes them all
+visible in the same generation and updates the clause indexes only once.
+
+The clauses appear in the predicate  in   list  order,  both at the start
+(CL_START) and at the end (CL_END).
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static Clause
+compile_dynamic_clause(term_t term, Module module, int flags,
+		       term_t tmp, Procedure *procp ARG_LD)
+{ Clause clause;
+  Procedure proc;
+  Definition def;
+  Module mhead;
+  term_t cl   = tmp+0;
+  term_t head = tmp+1;
+  term_t body = tmp+2;
+  Word h, b;
+  functor_t fdef;
+
+  if ( !PL_strip_module_ex(term, &module, cl) )
+    return NULL;
+  mhead = module;
+  if ( !get_head_and_body_clause(cl, head, body, &mhead PASS_LD) )
+    return NULL;
+  if ( !get_head_functor(head, &fdef, 0 PASS_LD) )
+    return NULL;
+  if ( !(proc = isCurrentProcedure(fdef, mhead)) )
+  { if ( checkModifySystemProc(fdef) )
+      proc = lookupProcedure(fdef, mhead);
+    if ( !proc )
+      return NULL;
+  }
+  def = proc->definition;
+  if ( flags && !isDefinedProcedure(proc) )
+  { if ( (flags&PL_CREATE_INCREMENTAL) )
+      setAttrDefinition(def, P_INCREMENTAL, TRUE);
+    if ( (flags&PL_CREATE_THREAD_LOCAL) )
+      setAttrDefinition(def, P_THREAD_LOCAL, TRUE);
+  }
+  if ( false(def, P_DYNAMIC) )
+  { if ( isDefinedProcedure(proc) )
+    { PL_error(NULL, 0, NULL, ERR_MODIFY_STATIC_PROC, proc);
+      return NULL;
+    }
+    if ( !setDynamicDefinition(def, TRUE) )
+      return NULL;
+  }
+
+  h = valTermRef(head);
+  b = valTermRef(body);
+  deRef(h);
+  deRef(b);
+  if ( compileClause(&clause, h, b, proc, module, 0 PASS_LD) != TRUE )
+    return NULL;
+
+  *procp = proc;
+  return clause;
+}
+
+
+static int
+assert_all(term_t list, Module module, ClauseRef where, int flags ARG_LD)
+{ term_t tail = PL_copy_term_ref(list);
+  term_t head = PL_new_term_ref();
+  term_t tmp  = PL_new_term_refs(3);
+  tmp_buffer procs, clauses;
+  Procedure *pv;
+  Clause *cv;
+  size_t len, n, i;
+  int rc = TRUE;
+
+  if ( !PL_strip_module_ex(tail, &module, tail) )
+    return FALSE;
+  switch( PL_skip_list(tail, 0, &len) )
+  { case PL_LIST:
+      break;
+    case PL_PARTIAL_LIST:
+      return PL_error(NULL, 0, NULL, ERR_INSTANTIATION);
+    default:
+      return PL_type_error("list", tail);
+  }
+
+  initBuffer(&procs);
+  initBuffer(&clauses);
+  while( PL_get_list(tail, head, tail) )
+  { Procedure proc;
+    Clause clause;
+
+    if ( !(clause = compile_dynamic_clause(head, module, flags,
+					   tmp, &proc PASS_LD)) )
+    { rc = FALSE;
+      break;
+    }
+    addBuffer(&procs, proc, Procedure);
+    addBuffer(&clauses, clause, Clause);
+  }
+
+  pv = baseBuffer(&procs, Procedure);
+  cv = baseBuffer(&clauses, Clause);
+  n  = entriesBuffer(&clauses, Clause);
+
+  if ( !rc )
+  { for(i=0; i<n; i++)
+      freeClause(cv[i]);
+  } else if ( n > 0 )
+  { size_t s, e;			/* run is [s,e) */
+
+    if ( where == CL_START )
+    { for(e=n; e > 0; e=s)
+      { for(s=e-1; s > 0 && pv[s-1] == pv[e-1]; s--)
+	  ;
+	if ( !assertDefinitionList(getProcDefinition(pv[s]),
+				   &cv[s], e-s, where PASS_LD) )
+	{ for(i=0; i<s; i++)
+	    freeClause(cv[i]);
+	  rc = FALSE;
+	  break;
+	}
+      }
+    } else
+    { for(s=0; s < n; s=e)
+      { for(e=s+1; e < n && pv[e] == pv[s]; e++)
+	  ;
+	if ( !assertDefinitionList(getProcDefinition(pv[s]),
+				   &cv[s], e-s, where PASS_LD) )
+	{ for(i=e; i<n; i++)
+	    freeClause(cv[i]);
+	  rc = FALSE;
+	  break;
+	}
+      }
+    }
+  }
+
+  discardBuffer(&procs);
+  discardBuffer(&clauses);
+
+  return rc;
+}
+
+
+static
+PRED_IMPL("assertz_all", 1, assertz_all, PL_FA_TRANSPARENT)
+{ PRED_LD
+
+  return assert_all(A1, NULL, CL_END, 0 PASS_LD);
+}
+
 
-      addProcedureSourceFile(of, proc);
-      of->current_procedure = proc;
-    }
+static
+PRED_IMPL("asserta_all", 1, asserta_all, PL_FA_TRANSPARENT)
+{ PRED_LD
 
-    if ( (cref=assertProcedureSource(of, proc, clause PASS_LD)) )
-    { clause = cref->value.clause;
+  return assert_all(A1, NULL, CL_START, 0 PASS_LD);
+}
 
-      if ( warnings && !PL_get_nil(warnings) )
-      { int rc;
-	fid_t fid = PL_open_foreign_frame();
-	term_t cl = PL_new_term_ref();
 
-	PL_put_clref(cl, clause);
-	rc = printMessage(ATOM_warning,
-			  PL_FUNCTOR_CHARS, "compiler_warnings", 2,
-			    PL_TERM, cl,
-			    PL_TERM, warnings);
-	PL_discard_foreign_frame(fid);
-	if ( !rc )
-	{ freeClause(clause);
-	  return NULL;
-	}
-      }
+#ifdef O_PLMT
+/** set_thread_local_template(:PI, +Clauses)
 
-      return clause;
-    }
-    return NULL;
+Compile Clauses once and use them  to   seed  the  local definition of PI
+for threads that are created  afterwards   (see  pl-thread.c).  All clauses
+must belong to PI, which must be  a   thread-local  predicate.  An empty
+list removes the template.
+*/
+
+static
+PRED_IMPL("set_thread_local_template", 2, set_thread_local_template,
+	  PL_FA_TRANSPARENT)
+{ PRED_LD
+  Procedure proc;
+  Definition def;
+  Module module = NULL;
+  term_t tail = PL_copy_term_ref(A2);
+  term_t head = PL_new_term_ref();
+  term_t tmp  = PL_new_term_refs(3);
+  tmp_buffer clauses;
+  Clause *cv;
+  size_t len, n, i;
+  int rc = TRUE;
+
+  if ( !get_procedure(A1, &proc, 0, GP_NAMEARITY|GP_FINDHERE|
+				    GP_EXISTENCE_ERROR) )
+    return FALSE;
+  def = proc->definition;
+  if ( false(def, P_THREAD_LOCAL) )
+    return PL_error(NULL, 0, "not thread_local",
+		    ERR_PERMISSION_PROC, ATOM_modify, ATOM_procedure, proc);
+
+  if ( !PL_strip_module_ex(tail, &module, tail) )
+    return FALSE;
+  switch( PL_skip_list(tail, 0, &len) )
+  { case PL_LIST:
+      break;
+    case PL_PARTIAL_LIST:
+      return PL_error(NULL, 0, NULL, ERR_INSTANTIATION);
+    default:
+      return PL_type_error("list", tail);
   }
 
-  /* assert[az]/1 */
+  initBuffer(&clauses);
+  while( rc && PL_get_list(tail, head, tail) )
+  { Module m = module, mhead;
+    term_t cl = tmp+0, h = tmp+1, b = tmp+2;
+    functor_t fdef;
+    Clause clause;
+    Word hp, bp;
 
-  if ( false(def, P_DYNAMIC) )
-  { if ( isDefinedProcedure(proc) )
-    { PL_error(NULL, 0, NULL, ERR_MODIFY_STATIC_PROC, proc);
-      goto error;
+    if ( !PL_strip_module_ex(head, &m, cl) )
+    { rc = FALSE;
+      break;
     }
-    if ( !setDynamicDefinition(def, TRUE) )
-      goto error;
+    mhead = m;
+    if ( !get_head_and_body_clause(cl, h, b, &mhead PASS_LD) ||
+	 !get_head_functor(h, &fdef, 0 PASS_LD) )
+    { rc = FALSE;
+      break;
+    }
+    if ( fdef != def->functor->functor || mhead != def->module )
+    { rc = PL_error(NULL, 0, "clause does not belong to the template",
+		    ERR_DOMAIN, ATOM_clause, head);
+      break;
+    }
+
+    hp = valTermRef(h);
+    bp = valTermRef(b);
+    deRef(hp);
+    deRef(bp);
+    if ( compileClause(&clause, hp, bp, proc, m, 0 PASS_LD) != TRUE )
+    { rc = FALSE;
+      break;
+    }
+    addBuffer(&clauses, clause, Clause);
   }
 
-  if ( (cref=assertProcedure(proc, clause, where PASS_LD)) )
-    return cref->value.clause;
+  cv = baseBuffer(&clauses, Clause);
+  n  = entriesBuffer(&clauses, Clause);
+  if ( rc )
+  { setThreadLocalTemplate(def, cv, n);
+  } else
+  { for(i=0; i<n; i++)
+      freeClause(cv[i]);
+  }
+  discardBuffer(&clauses);
 
-error:
-  freeClause(clause);
-  return NULL;
+  return rc;
 }
+#endif /*O_PLMT*/
 
 
 static
@@ -4115,12 +5051,14 @@ skipArgs(Code PC, int skip)
     switch(c)
     { case H_FUNCTOR:
       case H_LIST:
+      case H_CODES:
       case B_FUNCTOR:
       case B_LIST:
 	nested++;
         continue;
       case H_RFUNCTOR:
       case H_RLIST:
+      case H_RCODES:
       case B_RFUNCTOR:
       case B_RLIST:
 	continue;
@@ -4235,6 +5173,8 @@ argKey(Code PC, int skip, word *key)
       case H_LIST_FF:
       case H_LIST:
       case H_RLIST:
+      case H_CODES:
+      case H_RCODES:
 	*key = FUNCTOR_dot2;
         succeed;
 #if SIZEOF_VOIDP == 4
@@ -4328,6 +5268,8 @@ arg1Key(Code PC, word *key)
       case H_LIST_FF:
       case H_LIST:
       case H_RLIST:
+      case H_CODES:
+      case H_RCODES:
 	*key = FUNCTOR_dot2;
         succeed;
       case H_INT64:
@@ -4393,6 +5335,104 @@ clauseBodyContext(const Clause cl)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+detGuardPrunes() is called by C_DETGUARD if the choicepoint ch is  the
+clause choicepoint of fr.  The guard at PC succeeded.  We may discard
+ch if the only remaining candidate clause has a guard that is exclusive
+with ours.  This is only the case if the tested values are the same as
+at the time of the call, i.e., head unification did not bind  them,  and
+they are instantiated such that the next clause cannot  change  their
+type or value.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+stableDetGuardValue(LocalFrame fr, code slot, int number, Choice ch ARG_LD)
+{ Word p = varFrameP(fr, slot);
+  TrailEntry te;
+
+  for(;;)
+  { for(te = ch->mark.trailtop; te < tTop; te++)
+    { if ( te->address == p )
+	return FALSE;
+    }
+    if ( !isRef(*p) )
+      break;
+    p = unRef(*p);
+  }
+
+  return number ? isNumber(*p) : !canBind(*p);
+}
+
+static Code
+clauseDetGuard(Clause cl)
+{ if ( true(cl, CL_DET_GUARD) )
+  { Code PC = cl->codes;
+
+    for(;; PC = stepPC(PC))
+    { code op = fetchop(PC);
+
+      if ( op == C_DETGUARD )
+	return PC+1;
+      if ( op == I_EXIT )
+	return NULL;
+    }
+  }
+
+  return NULL;
+}
+
+static int
+exclusiveDetGuards(const Code g1, const Code g2)
+{ int cmp1 = (int)(g1[0]&DG_OP_MASK);
+  int cmp2 = (int)(g2[0]&DG_OP_MASK);
+
+  if ( cmp1 == DG_TYPE || cmp2 == DG_TYPE )
+    return ( cmp1 == cmp2 && g1[1] == g2[1] && !(g1[2] & g2[2]) );
+
+  if ( (g1[0]&DG_CONST) != (g2[0]&DG_CONST) )
+    return FALSE;
+  if ( g1[1] == g2[1] && g1[2] == g2[2] )
+    ;
+  else if ( !(g1[0]&DG_CONST) && g1[1] == g2[2] && g1[2] == g2[1] )
+    cmp2 = mirrorDetGuardCmp(cmp2);
+  else
+    return FALSE;
+
+  switch(cmp1)
+  { case DG_LT: return cmp2 == DG_GE || cmp2 == DG_GT || cmp2 == DG_EQ;
+    case DG_LE: return cmp2 == DG_GT;
+    case DG_GT: return cmp2 == DG_LE || cmp2 == DG_LT || cmp2 == DG_EQ;
+    case DG_GE: return cmp2 == DG_LT;
+    case DG_EQ: return cmp2 == DG_NE || cmp2 == DG_LT || cmp2 == DG_GT;
+    case DG_NE: return cmp2 == DG_EQ;
+    default:	return FALSE;
+  }
+}
+
+int
+detGuardPrunes(Code PC, LocalFrame fr, Choice ch ARG_LD)
+{ int type = ((PC[0]&DG_OP_MASK) == DG_TYPE);
+  Definition def = fr->predicate;
+  Clause next;
+  int rc = FALSE;
+
+  if ( !stableDetGuardValue(fr, PC[1], !type, ch PASS_LD) ||
+       (!type && !(PC[0]&DG_CONST) &&
+	!stableDetGuardValue(fr, PC[2], TRUE, ch PASS_LD)) )
+    return FALSE;
+
+  acquire_def(def);
+  if ( (next = lastClauseCandidate(&ch->value.clause, fr PASS_LD)) )
+  { Code g2 = clauseDetGuard(next);
+
+    rc = ( g2 && exclusiveDetGuards(PC, g2) );
+  }
+  release_def(def);
+
+  return rc;
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 The decompiler is rather straightforwards.  First it  will  construct  a
 term  with  variables  for  the  head  and an array of variables for all
@@ -4494,8 +5534,10 @@ next_arg_ref(term_t argp ARG_LD)
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Note:  unifyVar()  is  used  to    (re-)create  sharing  variables  when
-decompiling.  Because  compiled  clauses    cannot   contain  attributed
-variables, these to not exist in this context.
+decompiling.  Compiled clauses cannot  contain   attributed  variables,
+but clause/2 decompiles the head  directly   into  the caller's head. A
+head variable may thus be bound to an  attributed variable, in which case
+we must link to it rather than copying the attvar word.
 
 The vars argument is an array of  term_t types (di->variables). TBD: Use
 PL_new_term_refs() here! The var itself is always (?) a pointer into the
@@ -4525,7 +5567,11 @@ unifyVar(Word var, term_t vars, size_t i ARG_LD)
     { Trail(v, makeRef(var));
     }
   } else if ( isVar(*var) )		/* retract called with bounded var */
-  { Trail(var, *v);
+  { if ( isAttVar(*v) )
+    { Trail(var, makeRefG(v));
+    } else
+    { Trail(var, *v);
+    }
   } else
   { assert(0);
   }
@@ -4766,14 +5812,9 @@ decompile_head(Clause clause, term_t head, decompileInfo *di ARG_LD)
 #define isVarRef(w)	((tag(w) == TAG_REFERENCE && \
 			  storage(w) == STG_INLINE) ? valInt(w) : -1)
 
-bool
-decompile(Clause clause, term_t term, term_t bindings)
-{ GET_LD
-  decompileInfo dinfo;
-  decompileInfo *di = &dinfo;
-  term_t body, vbody;
-
-  di->nvars    = VAROFFSET(1) + clause->prolog_vars;
+static int
+init_decompile_info(decompileInfo *di, Clause clause, term_t bindings ARG_LD)
+{ di->nvars    = VAROFFSET(1) + clause->prolog_vars;
   di->bindings = bindings;
   if ( clause->prolog_vars )
   { if ( !(di->variables = PL_new_term_refs(clause->prolog_vars)) )
@@ -4786,33 +5827,18 @@ decompile(Clause clause, term_t term, term_t bindings)
     fail;
 #endif
 
-  if ( true(clause, UNIT_CLAUSE) )	/* fact */
-  { if ( decompile_head(clause, term, di PASS_LD) )
-    { if ( di->variables )
-	PL_reset_term_refs(di->variables);
-      succeed;
-    }
-					/* deal with a :- A */
-    if ( PL_is_functor(term, FUNCTOR_prove2) )
-    { term_t b = PL_new_term_ref();
-      _PL_get_arg(2, term, b);
+  return TRUE;
+}
 
-      if ( PL_unify_atom(b, ATOM_true) )
-      { _PL_get_arg(1, term, b);
-	return decompile_head(clause, b, di PASS_LD);
-      }
-    }
 
-    fail;
-  } else
-  { term_t a = PL_new_term_ref();
+/* Decompile the body of a clause whose head has been decompiled and
+   unify it with `body`.  The body is built bottom-up on the global
+   stack, restarting after enlarging the stacks if needed.
+*/
 
-    TRY(PL_unify_functor(term, FUNCTOR_prove2));
-    _PL_get_arg(1, term, a);
-    TRY(decompile_head(clause, a, di PASS_LD));
-    _PL_get_arg(2, term, a);
-    body = a;
-  }
+static int
+decompile_body(decompileInfo *di, term_t body ARG_LD)
+{ term_t vbody;
 
   if ( fetchop(PC) == I_CONTEXT )
   { Module context = (Module)PC[1];
@@ -4822,10 +5848,10 @@ decompile(Clause clause, term_t term, term_t bindings)
     TRY(PL_unify_functor(body, FUNCTOR_colon2));
     _PL_get_arg(1, body, a);
     TRY(PL_unify_atom(a, context->name));
-    _PL_get_arg(2, body, body);
+    _PL_get_arg(2, body, a);
+    body = a;
   }
 
-
   for(;;)
   { fid_t fid;
     Code PCsave = di->pc;
@@ -4854,6 +5880,76 @@ decompile(Clause clause, term_t term, term_t bindings)
 }
 
 
+bool
+decompile(Clause clause, term_t term, term_t bindings)
+{ GET_LD
+  decompileInfo dinfo;
+  decompileInfo *di = &dinfo;
+  term_t body;
+
+  if ( !init_decompile_info(di, clause, bindings PASS_LD) )
+    return FALSE;
+
+  if ( true(clause, UNIT_CLAUSE) )	/* fact */
+  { if ( decompile_head(clause, term, di PASS_LD) )
+    { if ( di->variables )
+	PL_reset_term_refs(di->variables);
+      succeed;
+    }
+					/* deal with a :- A */
+    if ( PL_is_functor(term, FUNCTOR_prove2) )
+    { term_t b = PL_new_term_ref();
+      _PL_get_arg(2, term, b);
+
+      if ( PL_unify_atom(b, ATOM_true) )
+      { _PL_get_arg(1, term, b);
+	return decompile_head(clause, b, di PASS_LD);
+      }
+    }
+
+    fail;
+  } else
+  { term_t a = PL_new_term_ref();
+
+    TRY(PL_unify_functor(term, FUNCTOR_prove2));
+    _PL_get_arg(1, term, a);
+    TRY(decompile_head(clause, a, di PASS_LD));
+    _PL_get_arg(2, term, a);
+    body = a;
+  }
+
+  return decompile_body(di, body PASS_LD);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+decompile_clause() decompiles the head of   clause directly into `head`
+and the body into `body`.  Unlike   decompile(),  this  does not create
+Head:-Body and unifies the head top-down, so clause/2  stops as soon as
+the head does not match and avoids  decompiling the body for clauses it
+rejects.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+decompile_clause(Clause clause, term_t head, term_t body, term_t bindings
+		 ARG_LD)
+{ decompileInfo dinfo;
+  decompileInfo *di = &dinfo;
+
+  if ( !init_decompile_info(di, clause, bindings PASS_LD) ||
+       !decompile_head(clause, head, di PASS_LD) )
+    return FALSE;
+
+  if ( true(clause, UNIT_CLAUSE) )
+  { if ( di->variables )
+      PL_reset_term_refs(di->variables);
+    return PL_unify_atom(body, ATOM_true);
+  }
+
+  return decompile_body(di, body PASS_LD);
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Body decompilation.  A previous version of this part of the code  worked
 top-down,  refining the term given using unification.  This approach has
@@ -5147,6 +6243,28 @@ decompileBody(decompileInfo *di, code end, Code until ARG_LD)
 	fdef = FUNCTOR_dot2;
         goto common_brfunctor;
       }
+      case H_CODES:
+			    pushArgumentStack(ARGP+1);
+			    nested++;
+			    /*FALLTHROUGH*/
+      case H_RCODES:
+      { word m = *PC++;
+	size_t len = wsizeofInd(m)*sizeof(word) - padHdr(m) - 1;
+	const unsigned char *s = (const unsigned char *)PC + 1;
+
+	PC += wsizeofInd(m);
+	while( len-- > 0 )
+	{ word w;
+	  int rc;
+
+	  if ( (rc=put_functor(&w, FUNCTOR_dot2 PASS_LD)) != TRUE )
+	    return rc;
+	  *ARGP = w;
+	  ARGP = argTermP(w, 0);
+	  *ARGP++ = consInt(*s++);
+	}
+	continue;
+      }
       case H_POP:
       case B_POP:
 			    ARGP = *--aTop;
@@ -5166,6 +6284,18 @@ decompileBody(decompileInfo *di, code end, Code until ARG_LD)
       case A_MUL:
 			    BUILD_TERM(FUNCTOR_star2);
 			    continue;
+      case A_ADD_F:
+			    BUILD_TERM_REV(FUNCTOR_plus2);
+			    continue;
+      case A_SUB_F:
+			    BUILD_TERM_REV(FUNCTOR_minus2);
+			    continue;
+      case A_MUL_F:
+			    BUILD_TERM_REV(FUNCTOR_star2);
+			    continue;
+      case A_DIV_F:
+			    BUILD_TERM_REV(FUNCTOR_divide2);
+			    continue;
       case A_FUNC0:
       case A_FUNC1:
       case A_FUNC2:
@@ -5345,6 +6475,9 @@ decompileBody(decompileInfo *di, code end, Code until ARG_LD)
       case C_VAR_N:
 			    PC += 2;
 			    continue;
+      case C_DETGUARD:
+			    PC += 3;
+			    continue;
       case C_OR:				/* A ; B */
 			    DECOMPILETOJUMP;	/* A */
 			    PC--;		/* get C_JMP argument */
@@ -5732,7 +6865,8 @@ PRED_IMPL("clause", va, clause, PL_FA_TRANSPARENT|PL_FA_NONDETERMINISTIC)
       if ( !isDefinedProcedure(proc) && true(def, P_AUTOLOAD) )
 	def = trapUndefined(def PASS_LD);
 
-      if ( protected_predicate(def PASS_LD) )
+      if ( protected_predicate(def PASS_LD) ||
+	   !loadedDefinition(def) )
 	return FALSE;
 
       chp = NULL;
@@ -5776,30 +6910,27 @@ PRED_IMPL("clause", va, clause, PL_FA_TRANSPARENT|PL_FA_NONDETERMINISTIC)
     goto out;
 
   while(cref)
-  { if ( decompile(cref->value.clause, term, bindings) )
-    { if ( !get_head_and_body_clause(term, h, b, NULL PASS_LD) )
-	break;
-      if ( unify_head(head, h PASS_LD) &&
-	   PL_unify(b, body) &&
-	   (!ref || PL_unify_clref(ref, cref->value.clause)) )
-      { if ( !chp->cref )
-	{ rc = TRUE;
-	  goto out;
-	}
-	if ( chp == &chp_buf )
-	{ chp = allocForeignState(sizeof(*chp));
-	  *chp = chp_buf;
-	}
-
-	PL_close_foreign_frame(fid);
-	ForeignRedoPtr(chp);
-      } else
-      { PL_put_variable(h);		/* otherwise they point into */
-	PL_put_variable(b);		/* term, which is removed */
+  { if ( decompile_clause(cref->value.clause, argv ? head : h, body,
+			  bindings PASS_LD) &&
+	 (argv || unify_head(head, h PASS_LD)) &&
+	 (!ref || PL_unify_clref(ref, cref->value.clause)) )
+    { if ( !chp->cref )
+      { rc = TRUE;
+	goto out;
       }
+      if ( chp == &chp_buf )
+      { chp = allocForeignState(sizeof(*chp));
+	*chp = chp_buf;
+      }
+
+      PL_close_foreign_frame(fid);
+      ForeignRedoPtr(chp);
     } else if ( exception_term )
     { goto out;
     }
+    if ( !argv )
+      PL_put_variable(h);		/* otherwise it points into the */
+					/* rewound global stack */
 
     PL_rewind_foreign_frame(fid);
     if ( argv )
@@ -5892,6 +7023,8 @@ PRED_IMPL("nth_clause",  3, nth_clause, PL_FA_TRANSPARENT|PL_FA_NONDETERMINISTIC
       fail;
 
     def = getProcDefinition(proc);
+    if ( !loadedDefinition(def) )
+      return FALSE;
     generation = pushPredicateAccess(def);
     acquire_def(def);
     cref = def->impl.clauses.first_clause;
@@ -6303,6 +7436,19 @@ unify_vmi(term_t t, Code bp)
 	  rc = _PL_unify_atomic(av+an, c);
 	  break;
 	}
+	case CA1_SWITCH:
+	{ size_t n = (size_t)*bp++;
+	  term_t tail = PL_copy_term_ref(av+an);
+	  term_t head = PL_new_term_ref();
+
+	  for(rc=TRUE; rc && n-- > 0; bp += 2)
+	    rc = ( PL_unify_list(tail, head, tail) &&
+		   ( isFunctor(bp[0])
+		       ? unify_functor(head, (functor_t)bp[0], GP_NAMEARITY)
+		       : _PL_unify_atomic(head, (word)bp[0]) ) );
+	  rc = rc && PL_unify_nil(tail);
+	  break;
+	}
 	default:
 	  Sdprintf("Cannot list %d-th arg of %s (type=%d)\n",
 		   an+1, ci->name, ats[an]);
@@ -6630,7 +7776,7 @@ PRED_IMPL("$vm_assert", 3, vm_assert, PL_FA_TRANSPARENT)
 
   clause.code_size = entriesBuffer(&ci.codes, code);
   size  = sizeofClause(clause.code_size);
-  cl = PL_malloc_atomic(size);
+  cl = arena_alloc(size);
   memcpy(cl, &clause, sizeofClause(0));
   GD->statistics.codes += clause.code_size;
   memcpy(cl->codes, baseBuffer(&ci.codes, code), sizeOfBuffer(&ci.codes));
@@ -7340,6 +8486,19 @@ PL_assert(term_t term, module_t module, int flags)
 }
 
 
+int
+PL_assert_all(term_t list, module_t module, int flags)
+{ GET_LD
+  ClauseRef where = CL_END;
+
+  if ( (flags&PL_ASSERTA) )
+    where = CL_START;
+  flags &= (PL_CREATE_THREAD_LOCAL|PL_CREATE_INCREMENTAL);
+
+  return assert_all(list, module, where, flags PASS_LD);
+}
+
+
 		 /*******************************
 		 *      PUBLISH PREDICATES	*
 		 *******************************/
@@ -7358,6 +8517,11 @@ BeginPredDefs(comp)
   PRED_DEF("assert",  2, assertz2, META)
   PRED_DEF("assertz", 2, assertz2, META)
   PRED_DEF("asserta", 2, asserta2, META)
+  PRED_DEF("assertz_all", 1, assertz_all, META)
+  PRED_DEF("asserta_all", 1, asserta_all, META)
+#ifdef O_PLMT
+  PRED_DEF("set_thread_local_template", 2, set_thread_local_template, META)
+#endif
   PRED_DEF("redefine_system_predicate", 1, redefine_system_predicate, META)
   PRED_DEF("compile_predicates",  1, compile_predicates, META)
   PRED_DEF("$predefine_foreign",  1, predefine_foreign, PL_FA_TRANSPARENT)
@@ -67,6 +67,8 @@ COMMON(int)		clearBreakPointsClause(Clause clause) WUNUSED;
 COMMON(int)		unify_functor(term_t t, functor_t fd, int how);
 COMMON(void)		vm_list(Code code);
 COMMON(Module)		clauseBodyContext(const Clause cl);
+COMMON(void)		fuseClauseCode(Clause clause);
+COMMON(int)		detGuardPrunes(Code PC, LocalFrame fr, Choice ch ARG_LD);
 
 static inline code
 fetchop(Code PC)
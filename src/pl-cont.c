@@ -59,7 +59,8 @@ Where the compiler translates '$reset' into
   - Continuations probably appear in a relatively small number of
     places.  We can have a hash table for each program pointer
     that can act as a continuation.  The value can include the
-    variable activation map.
+    variable activation map.  The clause references are already
+    cached, see cont_clref().
   - As put_environment() documents, we should also find the
     active non-Prolog slots.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
@@ -121,6 +122,47 @@ env_functor(int slots)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+cont_clref() returns the clause blob for cl.  Looking up, registering
+and unregistering this blob each  time   we  capture an environment is
+costly.  As effect handlers typically capture the   same few clauses over
+and over again, we keep a small  per-thread cache of registered clause
+blobs.  The cached blob keeps an erased   clause  from being reclaimed
+until it is replaced in the cache or the thread terminates.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static atom_t
+cont_clref(Clause cl ARG_LD)
+{ unsigned int i = (unsigned int)(((uintptr_t)cl>>4) &
+				  (CONT_CLREF_CACHE_SIZE-1));
+
+  if ( LD->continuation.clrefs[i].clause != cl )
+  { atom_t old = LD->continuation.clrefs[i].cref;
+
+    LD->continuation.clrefs[i].cref   = lookup_clref(cl);
+    LD->continuation.clrefs[i].clause = cl;
+    if ( old )
+      PL_unregister_atom(old);
+  }
+
+  return LD->continuation.clrefs[i].cref;
+}
+
+
+void
+freeContinuationLocalData(PL_local_data_t *ld)
+{ int i;
+
+  for(i=0; i<CONT_CLREF_CACHE_SIZE; i++)
+  { if ( ld->continuation.clrefs[i].cref )
+    { PL_unregister_atom(ld->continuation.clrefs[i].cref);
+      ld->continuation.clrefs[i].cref   = 0;
+      ld->continuation.clrefs[i].clause = NULL;
+    }
+  }
+}
+
+
 static int
 put_environment(term_t env, LocalFrame fr, Code pc)
 { GET_LD
@@ -163,7 +205,7 @@ put_environment(term_t env, LocalFrame fr, Code pc)
   fr = (LocalFrame)valTermRef(fr_ref);
   p = gTop;
 
-  cref = lookup_clref(cl);
+  cref = cont_clref(cl PASS_LD);
   *p++ = env_functor(slots);
   *p++ = cref;
   *p++ = consInt(pc - cl->codes);
@@ -209,8 +251,6 @@ put_environment(term_t env, LocalFrame fr, Code pc)
     *valTermRef(env) = consPtr(tp, TAG_COMPOUND|STG_GLOBAL);
   }
 
-  PL_unregister_atom(cref);
-
   return rc;
 }
 
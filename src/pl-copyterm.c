@@ -372,7 +372,7 @@ exitCyclicCopy(int flags ARG_LD)
       { setVar(*p2);
 	setVar(*p);
       } else
-      { *p = *p2 | MARK_MASK;		/* cyclic terms */
+      { *p = *p2;			/* cyclic terms */
       }
     } else
     { Word old = NULL;			/* Silence compiler */
@@ -392,12 +392,29 @@ exitCyclicCopy(int flags ARG_LD)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+copy_term() removes the marks from  the   source  term while copying.
+Variables and compounds that are not   shared are reached exactly once,
+so their marks can be cleared  immediately.   Shared  variables and
+compounds are restored by exitCyclicCopy(). Ground sub-terms are shared
+with the original and not walked. Their roots   are pushed on a stack
+and unmarked after the copy.  This avoids   a  second walk over the
+entire term to remove the marks.
+
+If we run out of space, the not-yet-processed  nodes are still marked
+and cp_unmark() is used to clean them such that we can safely call GC.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 static int
 copy_term(Word from, Word to, size_t abstract, int flags ARG_LD)
 { term_agendaLRD agenda;
   int rc = TRUE;
   size_t aleft = (size_t)-1;
+  Word gbuf[256];
+  segstack ground;
+  Word p;
 
+  initSegStack(&ground, sizeof(Word), sizeof(gbuf), gbuf);
   initTermAgendaLRD(&agenda, 1, from, to);
   while( nextTermAgendaLRD(&agenda, &from, &to) )
   { if ( agenda.work.depth == 1 )
@@ -426,6 +443,7 @@ copy_term(Word from, Word to, size_t abstract, int flags ARG_LD)
 	{ *to = makeRef(from);
 	} else
 	{ setVar(*to);
+	  *from &= ~BOTH_MASK;
 	}
 
 	continue;
@@ -466,6 +484,7 @@ copy_term(Word from, Word to, size_t abstract, int flags ARG_LD)
 	    }
 	  } else
 	  { setVar(*to);
+	    *from &= ~BOTH_MASK;
 	  }
 	}
 	continue;
@@ -487,10 +506,13 @@ copy_term(Word from, Word to, size_t abstract, int flags ARG_LD)
 
 	if ( ground(ff->definition) )
 	{ *to = *from;
+	  if ( !pushSegStack(&ground, from, Word) )
+	  { rc = MEMORY_OVERFLOW;
+	    goto out;
+	  }
 	  continue;
 	}
 
-	if ( shared(ff->definition) )
 	{ int arity = arityFunctor(ff->definition);
 	  Functor ft;
 
@@ -499,29 +521,19 @@ copy_term(Word from, Word to, size_t abstract, int flags ARG_LD)
 	    goto out;
 	  }
 	  ft->definition = ff->definition & ~BOTH_MASK;
-	  ff->definition = makeRefG((Word)ft);
-	  TrailCyclic(&ff->definition PASS_LD);
 	  *to = consPtr(ft, TAG_COMPOUND|STG_GLOBAL);
-
-	  if ( pushWorkAgendaLRD(&agenda, arity, ff->arguments, ft->arguments) )
-	    continue;
-	  rc = MEMORY_OVERFLOW;
-	  goto out;
-	} else				/* unshared term */
-	{ int arity = arityFunctor(ff->definition);
-	  Functor ft;
-
-	  if ( !(ft = (Functor)allocGlobalNoShift(arity+1)) )
-	  { rc = GLOBAL_OVERFLOW;
+	  if ( !pushWorkAgendaLRD(&agenda, arity, ff->arguments, ft->arguments) )
+	  { rc = MEMORY_OVERFLOW;
 	    goto out;
 	  }
-	  ft->definition = ff->definition & ~BOTH_MASK;
-	  *to = consPtr(ft, TAG_COMPOUND|STG_GLOBAL);
 
-	  if ( pushWorkAgendaLRD(&agenda, arity, ff->arguments, ft->arguments) )
-	    continue;
-	  rc = MEMORY_OVERFLOW;
-	  goto out;
+	  if ( shared(ff->definition) )
+	  { ff->definition = makeRefG((Word)ft);
+	    TrailCyclic(&ff->definition PASS_LD);
+	  } else			/* unshared term */
+	  { ff->definition = ft->definition;
+	  }
+	  continue;
 	}
       }
       case TAG_ATOM:
@@ -534,7 +546,16 @@ copy_term(Word from, Word to, size_t abstract, int flags ARG_LD)
   }
 
 out:
+  if ( rc != TRUE )
+  { cp_unmark(from, flags PASS_LD);
+    while( nextTermAgendaLRD(&agenda, &from, &to) )
+      cp_unmark(from, flags PASS_LD);
+  }
   clearTermAgendaLRD(&agenda);
+  while( popSegStack(&ground, &p, Word) )
+    cp_unmark(p, flags PASS_LD);
+  clearSegStack(&ground);
+
   return rc;
 }
 
@@ -578,7 +599,6 @@ again:
   initCyclicCopy(PASS_LD1);
   rc = copy_term(from, to, abstract, flags PASS_LD);
   exitCyclicCopy(flags PASS_LD);
-  cp_unmark(from, flags PASS_LD);
 /*DEBUG(0, if ( rc == TRUE )		May lead to "Reference to higher address"
 	   { checkData(from);
              checkData(to);
@@ -739,7 +759,7 @@ term_to_fastheap(term_t t ARG_LD)
 	size_t go = gBase - (Word)base_addresses[STG_GLOBAL];
 
 	memcpy(indirects, ip, sz*sizeof(word));
-	*o++ = ((go+indirects-fht->data)<<PTR_SHIFT) | tagex(*p);
+	*o++ = ((go+indirects-fht->data)<<PTR_SHIFT) | tag(*p)|STG_GLOBAL;
 	indirects += sz;
       } else
       { *o++ = relocate_down(*p, offset);
@@ -0,0 +1,309 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pl-incl.h"
+#include "os/pl-ctype.h"
+
+#undef LD
+#define LD LOCAL_LD
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Support for library(csv).  '$csv_read_record'/7 reads  the next record
+directly from a stream and returns  the   list  of converted fields. It
+implements the same syntax as the DCG in library(csv):
+
+  - Records are terminated by "\n", "\r\n", "\r" or the end of the input.
+  - A field that starts with a double quote extends to the matching
+    double quote, where "" represents a double quote.  It may contain
+    record separators.  The closing quote must be followed by the
+    separator or the end of the record.
+  - Strip only removes blank space (space and tab) around unquoted
+    fields.
+  - Fields are converted as name/2 if convert is true and case is
+    preserve.  Otherwise non-numeric fields are mapped to atoms using
+    downcase_atom/2 or upcase_atom/2.
+
+Like the DCG, the predicate fails on syntax errors.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef enum
+{ CSV_CASE_PRESERVE = 0,
+  CSV_CASE_DOWN,
+  CSV_CASE_UP
+} csv_case;
+
+typedef struct csv_spec
+{ int		separator;		/* Field separator */
+  int		strip;			/* Strip blank space */
+  int		ignore_quotes;		/* Quotes are normal characters */
+  int		convert;		/* Convert numbers */
+  csv_case	case_mode;		/* Case conversion */
+} csv_spec;
+
+typedef struct csv_field
+{ tmp_buffer	buffer;			/* Collected characters */
+  int		wide;			/* Buffer holds pl_wchar_t */
+} csv_field;
+
+#define isCSVBlank(c) ((c) == ' ' || (c) == '\t')
+
+
+static void
+promote_field(csv_field *f)
+{ size_t len = entriesBuffer(&f->buffer, unsigned char);
+  size_t i;
+
+  if ( !growBuffer((Buffer)&f->buffer, len*(sizeof(pl_wchar_t)-1)) )
+    outOfCore();
+  for(i=len; i-- > 0; )			/* expand in place */
+    baseBuffer(&f->buffer, pl_wchar_t)[i] =
+		fetchBuffer(&f->buffer, i, unsigned char);
+  seekBuffer(&f->buffer, len, pl_wchar_t);
+  f->wide = TRUE;
+}
+
+
+static inline void
+add_code(csv_field *f, int c)
+{ if ( !f->wide )
+  { if ( c <= 0xff )
+    { addBuffer(&f->buffer, (unsigned char)c, unsigned char);
+      return;
+    }
+    promote_field(f);
+  }
+
+  addBuffer(&f->buffer, (pl_wchar_t)c, pl_wchar_t);
+}
+
+
+static size_t
+field_length(const csv_field *f)
+{ return ( f->wide ? entriesBuffer(&f->buffer, pl_wchar_t)
+		   : entriesBuffer(&f->buffer, unsigned char) );
+}
+
+
+static int
+field_code(const csv_field *f, size_t i)
+{ return ( f->wide ? fetchBuffer(&f->buffer, i, pl_wchar_t)
+		   : fetchBuffer(&f->buffer, i, unsigned char) );
+}
+
+
+static void
+strip_field(csv_field *f)
+{ size_t len = field_length(f);
+
+  while( len > 0 && isCSVBlank(field_code(f, len-1)) )
+    len--;
+
+  f->buffer.top = f->buffer.base + len*(f->wide ? sizeof(pl_wchar_t) : 1);
+}
+
+
+static int
+unify_field(term_t t, csv_field *f, const csv_spec *spec ARG_LD)
+{ PL_chars_t text;
+
+  text.length    = field_length(f);
+  text.storage   = PL_CHARS_HEAP;
+  text.canonical = TRUE;
+
+  if ( f->wide )
+  { text.encoding = ENC_WCHAR;
+    text.text.w   = baseBuffer(&f->buffer, pl_wchar_t);
+  } else
+  { text.encoding = ENC_ISO_LATIN_1;
+    text.text.t   = baseBuffer(&f->buffer, char);
+
+    if ( spec->convert && text.length > 0 )
+    { unsigned char *s, *q;
+      number n;
+
+      addBuffer(&f->buffer, EOS, char);
+      s = baseBuffer(&f->buffer, unsigned char);
+      text.text.t = (char*)s;
+      if ( str_number(s, &q, &n, 0) == NUM_OK )
+      { if ( q == s+text.length )
+	{ int rc = PL_unify_number(t, &n);
+	  clearNumber(&n);
+	  return rc;
+	}
+	clearNumber(&n);
+      }
+    }
+  }
+
+  if ( spec->case_mode == CSV_CASE_PRESERVE )
+    return PL_unify_text(t, 0, &text, PL_ATOM);
+  else
+    return unify_text_case(t, &text, spec->case_mode == CSV_CASE_DOWN,
+			   PL_ATOM);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+read_record() reads a record from  s  and   unifies  fields  with the
+converted fields.  If s is at  the  end   of  the  input, fields is
+unified with end_of_file.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+read_record(IOSTREAM *s, term_t fields, const csv_spec *spec ARG_LD)
+{ term_t tail = PL_copy_term_ref(fields);
+  term_t head = PL_new_term_ref();
+  csv_field f;
+  int c, rc = TRUE;
+
+  if ( (c = Sgetcode(s)) == -1 )
+    return PL_unify_atom(fields, ATOM_end_of_file);
+
+  initBuffer(&f.buffer);
+  f.wide = FALSE;
+
+  for(;;)
+  { emptyBuffer(&f.buffer, 4096);
+    f.wide = FALSE;
+
+    if ( c == '"' && !spec->ignore_quotes )
+    { for(;;)
+      { if ( (c = Sgetcode(s)) == -1 )
+	{ rc = FALSE;
+	  goto out;
+	}
+	if ( c == '"' )
+	{ if ( (c = Sgetcode(s)) != '"' )
+	    break;
+	}
+	add_code(&f, c);
+      }
+    } else
+    { if ( spec->strip )
+      { while( isCSVBlank(c) )
+	  c = Sgetcode(s);
+      }
+      while( c != -1 && c != spec->separator && c != '\n' && c != '\r' )
+      { add_code(&f, c);
+	c = Sgetcode(s);
+      }
+      if ( spec->strip )
+	strip_field(&f);
+    }
+
+    if ( !PL_unify_list(tail, head, tail) ||
+	 !unify_field(head, &f, spec PASS_LD) )
+    { rc = FALSE;
+      goto out;
+    }
+
+    if ( c == spec->separator )
+    { c = Sgetcode(s);
+      continue;
+    }
+    if ( c == '\r' )
+    { if ( Speekcode(s) == '\n' )
+	(void)Sgetcode(s);
+      break;
+    }
+    if ( c == '\n' || c == -1 )
+      break;
+
+    rc = FALSE;				/* garbage after closing quote */
+    goto out;
+  }
+
+  rc = PL_unify_nil(tail);
+
+out:
+  discardBuffer(&f.buffer);
+  return rc;
+}
+
+
+static int
+get_csv_case(term_t t, csv_case *mode)
+{ GET_LD
+  atom_t a;
+
+  if ( !PL_get_atom_ex(t, &a) )
+    return FALSE;
+  if ( a == ATOM_preserve )
+    *mode = CSV_CASE_PRESERVE;
+  else if ( a == ATOM_down )
+    *mode = CSV_CASE_DOWN;
+  else if ( a == ATOM_up )
+    *mode = CSV_CASE_UP;
+  else
+    return PL_domain_error("csv_case", t);
+
+  return TRUE;
+}
+
+
+/** '$csv_read_record'(+Stream, -Fields, +Separator, +Strip,
+ *		       +IgnoreQuotes, +Convert, +Case)
+ */
+
+static
+PRED_IMPL("$csv_read_record", 7, csv_read_record, 0)
+{ PRED_LD
+  csv_spec spec;
+  IOSTREAM *s;
+  int rc;
+
+  if ( !PL_get_char_ex(A3, &spec.separator, FALSE) ||
+       !PL_get_bool_ex(A4, &spec.strip) ||
+       !PL_get_bool_ex(A5, &spec.ignore_quotes) ||
+       !PL_get_bool_ex(A6, &spec.convert) ||
+       !get_csv_case(A7, &spec.case_mode) )
+    return FALSE;
+
+  if ( !PL_get_stream(A1, &s, SIO_INPUT) )
+    return FALSE;
+  rc = read_record(s, A2, &spec PASS_LD);
+  if ( !PL_release_stream(s) )
+    rc = FALSE;
+
+  return rc;
+}
+
+
+		 /*******************************
+		 *      PUBLISH PREDICATES	*
+		 *******************************/
+
+BeginPredDefs(csv)
+  PRED_DEF("$csv_read_record", 7, csv_read_record, 0)
+EndPredDefs
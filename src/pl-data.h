@@ -116,6 +116,10 @@ Indirect data
 	* String uses the low-order 2 bits for specifying the amount of
 	  padding bytes (0-3, 0 means 4).
 
+	* Large strings and GMP integers may live outside the stacks (see
+	  allocLargeIndirect()).  These are referenced using storage
+	  STG_LARGE, for which base_addresses[] is 0.
+
 NOTE: the tag-numbers are  mapped  to   public  constants  (PL_*) in the
 type_map array in pl-fli.c.  Make  sure   this  is  consistent  with the
 definitions below. Also the tagtypeex[] array defined in pl-setup.c must
@@ -150,6 +154,7 @@ be kept consistent.
 #define STG_GLOBAL	(0x1<<3)	/* global stack */
 #define STG_LOCAL	(0x2<<3)	/* local stack */
 #define STG_RESERVED	(0x3<<3)
+#define STG_LARGE	STG_RESERVED	/* indirect in large object space */
 
 #define STG_INLINE	STG_STATIC
 #define STG_TRAIL	STG_STATIC
@@ -183,11 +188,15 @@ be kept consistent.
 			  EXBIT(STG_GLOBAL|TAG_FLOAT) | \
 			  EXBIT(STG_LOCAL|TAG_FLOAT) | \
 			  EXBIT(STG_GLOBAL|TAG_STRING) | \
-			  EXBIT(STG_LOCAL|TAG_STRING) \
+			  EXBIT(STG_LOCAL|TAG_STRING) | \
+			  EXBIT(STG_LARGE|TAG_INTEGER) | \
+			  EXBIT(STG_LARGE|TAG_STRING) \
 			)
 
 #define tagex(w)	((w) & (TAG_MASK|STG_MASK))
 #define isIndirect(w)	(EXBIT(tagex(w)) & INDIRECT_BM)
+#define isLargeIndirect(w) (tagex(w) == (STG_LARGE|TAG_STRING) || \
+			    tagex(w) == (STG_LARGE|TAG_INTEGER))
 
 
 		 /*******************************
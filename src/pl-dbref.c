@@ -117,7 +117,7 @@ static void
 acquire_record(atom_t aref)
 { recref *ref = PL_blob_data(aref, NULL, NULL);
 
-  set(ref->record->record, R_DBREF);
+  set(ref->record, R_DBREF);
 }
 
 
@@ -126,7 +126,7 @@ release_record(atom_t aref)
 { recref *ref = PL_blob_data(aref, NULL, NULL);
 
   if ( ref->record->record )
-    clear(ref->record->record, R_DBREF);
+    clear(ref->record, R_DBREF);
   else
     unallocRecordRef(ref->record);
 
@@ -243,7 +243,7 @@ PL_get_dbref(term_t t, db_ref_type *type_ptr)
   { recref *ref = data;
 
     if ( ref->record->record &&
-	 false(ref->record->record, R_ERASED) )
+	 false(ref->record, R_ERASED) )
     { *type_ptr = DB_REF_RECORD;
       return ref->record;
     }
@@ -289,7 +289,7 @@ PL_get_recref(term_t t, RecordRef *rec)
     return PL_error(NULL, 0, NULL, ERR_TYPE, ATOM_db_reference, t);
 
   if ( ref->record->record &&
-       false(ref->record->record, R_ERASED) )
+       false(ref->record, R_ERASED) )
   { *rec = ref->record;
     return TRUE;
   }
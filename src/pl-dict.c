@@ -327,6 +327,64 @@ assign_in_dict(Word dp, Word val ARG_LD)
 }
 
 
+/* put_dict1() is put_dict() for a single  key-value pair. It uses binary
+   search to find the key, which makes replacing a value by an identical
+   one O(log n) and avoids comparing keys while copying.
+*/
+
+static int
+put_dict1(word dict, Word nv, word *new_dict ARG_LD)
+{ Functor data = valueTerm(dict);
+  int arity = arityFunctor(data->definition);
+  Word n_name, vp, new, out, in, in_end;
+  int rc, done = FALSE;
+
+  deRef2(nv+1, n_name);
+  if ( (vp=dict_lookup_ptr(dict, *n_name PASS_LD)) &&
+       compareStandard(nv, vp, TRUE PASS_LD) == 0 )
+  { *new_dict = dict;
+    return TRUE;
+  }
+
+  if ( gTop+1+arity+2 > gMax )
+    return GLOBAL_OVERFLOW;
+
+  new    = gTop;
+  out    = new+2;			/* functor, tag */
+  in     = data->arguments+1;
+  in_end = in+arity-1;
+
+  for(; in < in_end; in += 2)
+  { Word i_name;
+
+    deRef2(in+1, i_name);
+    if ( !done && (in == vp || (!vp && *n_name < *i_name)) )
+    { if ( (rc=assign_in_dict(out++, nv PASS_LD)) != TRUE )
+	return rc;
+      *out++ = *n_name;
+      done = TRUE;
+      if ( in == vp )
+	continue;
+    }
+    *out++ = linkVal(in);
+    *out++ = *i_name;
+  }
+  if ( !done )
+  { if ( (rc=assign_in_dict(out++, nv PASS_LD)) != TRUE )
+      return rc;
+    *out++ = *n_name;
+  }
+
+  gTop = out;
+  new[1] = linkVal(&data->arguments[0]);
+  new[0] = dict_functor((out-(new+1))/2);
+
+  *new_dict = consPtr(new, TAG_COMPOUND|STG_GLOBAL);
+
+  return TRUE;
+}
+
+
 int
 put_dict(word dict, int size, Word nv, word *new_dict ARG_LD)
 { Functor data = valueTerm(dict);
@@ -340,6 +398,8 @@ put_dict(word dict, int size, Word nv, word *new_dict ARG_LD)
   { *new_dict = dict;
     return TRUE;
   }
+  if ( size == 1 )
+    return put_dict1(dict, nv, new_dict PASS_LD);
 
   if ( gTop+1+arity+2*size > gMax )
     return GLOBAL_OVERFLOW;
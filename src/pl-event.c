@@ -71,6 +71,7 @@ const event_type PL_events[] =
   GEVENT(PLEV_GCNOBREAK,        ATOM_break,            3, onbreak),
   GEVENT(PLEV_FRAMEFINISHED,    ATOM_frame_finished,   1, onframefinish),
   GEVENT(PLEV_UNTABLE,		ATOM_untable,          1, onuntable),
+  GEVENT(PLEV_GC,		ATOM_gc,               1, ongc),
 #ifdef O_PLMT
   GEVENT(PLEV_THREAD_EXIT,      ATOM_thread_exit,      1, onthreadexit),
   LEVENT(PLEV_THIS_THREAD_EXIT, ATOM_this_thread_exit, 0, onthreadexit),
@@ -602,6 +603,12 @@ PL_call_event_hook_va(pl_event_type ev, va_list args)
 			    0, GP_QUALIFY|GP_NAMEARITY);
       break;
     }
+    case PLEV_GC:
+    { gc_stats *stats = va_arg(args, gc_stats*);
+
+      rc = put_gc_event(av+1, stats PASS_LD);
+      break;
+    }
     default:
       rc = warning("callEventHook(): unknown event: %d", ev);
       goto out;
@@ -47,6 +47,7 @@ typedef enum pl_event_type
   PLEV_GCNOBREAK,			/* cleared due to clause GC */
   PLEV_FRAMEFINISHED,			/* A watched frame was discarded */
   PLEV_UNTABLE,				/* Stop tabling some predicate */
+  PLEV_GC,				/* Stack GC completed */
 					/* Keep these two at the end */
   PLEV_THREAD_EXIT,			/* A thread has finished */
   PLEV_THIS_THREAD_EXIT			/* This thread has finished */
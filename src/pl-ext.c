@@ -140,6 +140,7 @@ static const PL_extension foreigns[] = {
 
 #if COUNTING
   FRG("$count",			0, pl_count,			0),
+  FRG("$vmi_sequences",		2, pl_vmi_sequences,		0),
 #endif /* COUNTING */
 
   FRG("prolog_current_frame",	1, pl_prolog_current_frame,	0),
@@ -196,6 +197,8 @@ static const PL_extension foreigns[] = {
 
   FRG("thread_self",		1, pl_thread_self,	      ISO),
   FRG("with_mutex",		2, pl_with_mutex,	 META|ISO),
+  FRG("with_read_lock",		2, pl_with_read_lock,	      META),
+  FRG("with_write_lock",	2, pl_with_write_lock,	      META),
   FRG("$get_pid",		1, pl_get_pid,			0),
 
   /* DO NOT ADD ENTRIES BELOW THIS ONE */
@@ -403,9 +406,20 @@ DECL_PLIST(trie);
 DECL_PLIST(tabling);
 DECL_PLIST(mutex);
 DECL_PLIST(zip);
+DECL_PLIST(zstream);
 DECL_PLIST(cbtrace);
 DECL_PLIST(wrap);
 DECL_PLIST(event);
+DECL_PLIST(csv);
+DECL_PLIST(clpfd);
+DECL_PLIST(clpb);
+DECL_PLIST(ugraph);
+DECL_PLIST(hashmap);
+DECL_PLIST(prioqueue);
+DECL_PLIST(column);
+DECL_PLIST(array);
+DECL_PLIST(metrics);
+DECL_PLIST(transaction);
 
 void
 initBuildIns(void)
@@ -473,9 +487,20 @@ initBuildIns(void)
   REG_PLIST(tabling);
   REG_PLIST(mutex);
   REG_PLIST(zip);
+  REG_PLIST(zstream);
   REG_PLIST(cbtrace);
   REG_PLIST(wrap);
   REG_PLIST(event);
+  REG_PLIST(csv);
+  REG_PLIST(clpfd);
+  REG_PLIST(clpb);
+  REG_PLIST(ugraph);
+  REG_PLIST(hashmap);
+  REG_PLIST(prioqueue);
+  REG_PLIST(column);
+  REG_PLIST(array);
+  REG_PLIST(metrics);
+  REG_PLIST(transaction);
 
 #define LOOKUPPROC(name) \
 	{ GD->procedures.name = lookupProcedure(FUNCTOR_ ## name, m); \
@@ -525,6 +550,8 @@ initBuildIns(void)
 
   PL_meta_predicate(PL_predicate("notrace",          1, "system"), "0");
   PL_meta_predicate(PL_predicate("with_mutex",       2, "system"), "+0");
+  PL_meta_predicate(PL_predicate("with_read_lock",   2, "system"), "+0");
+  PL_meta_predicate(PL_predicate("with_write_lock",  2, "system"), "+0");
   PL_meta_predicate(PL_predicate("with_output_to",   2, "system"), "+0");
 #ifdef O_PLMT
   PL_meta_predicate(PL_predicate("thread_create",    3, "system"), "0?+");
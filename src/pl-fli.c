@@ -436,6 +436,20 @@ PL_new_atom_nchars(size_t len, const char *s)
 }
 
 
+/* PL_new_atom_nchars_adopt() creates an ISO Latin-1 atom from a buffer
+   of at least len+1 bytes allocated using PL_malloc().  The atom takes
+   ownership of the buffer, which is freed if the atom already exists.
+*/
+
+atom_t
+PL_new_atom_nchars_adopt(size_t len, char *s)
+{ if ( !GD->initialised )
+    initAtoms();
+
+  return (atom_t) lookupAtomAdopt(s, len);
+}
+
+
 atom_t
 PL_new_atom_mbchars(int flags, size_t len, const char *s)
 { PL_chars_t text;
@@ -1222,6 +1236,343 @@ PL_cons_list_v(term_t list, size_t count, term_t elems)
   { setHandle(list, ATOM_nil);
   }
 
+  return TRUE;
+}
+
+		 /*******************************
+		 *	    TERM CELLS		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+PL_put_term_cells() creates a term from an array of term_cell_t holding
+the term in prefix order: a  PL_FUNCTOR   cell  is followed by the cells
+for its arguments and a PL_LIST cell by the cells for its elements.  The
+description is verified and its global stack  requirements are computed
+before anything is created, after which the   term  is written directly
+to the global stack without  intermediate   term  references and further
+stack checks.  This is intended for  converting   large  amounts of data
+from C.
+
+PL_get_term_cells() is the reverse. Sub  terms   that  have  no cell
+representation of their own (variables,  strings, big integers, rationals)
+are returned as PL_TERM cells  holding  a   term  reference,  so the
+output of PL_get_term_cells() can be passed to PL_put_term_cells() to
+create a copy that shares the variables.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct cell_frame
+{ Word	 p;				/* next argument */
+  size_t left;				/* arguments left */
+  size_t stride;			/* distance between arguments */
+} cell_frame;
+
+/* term_cells_size() returns -1 if cells describe exactly one term and
+   the index of the first invalid cell otherwise.
+*/
+
+static ssize_t
+term_cells_size(const term_cell_t *cells, size_t count, size_t *size)
+{ size_t pending = 1;
+  size_t words = 0;
+  size_t i;
+
+  for(i=0; i<count; i++)
+  { const term_cell_t *c = &cells[i];
+
+    if ( pending-- == 0 )
+      return i;
+
+    switch(c->type)
+    { case PL_VARIABLE:
+      case PL_ATOM:
+      case PL_NIL:
+      case PL_TERM:
+	break;
+      case PL_INTEGER:
+	if ( valInt(consInt(c->value.i)) != c->value.i )
+	  words += 2+WORDS_PER_INT64;
+	break;
+      case PL_FLOAT:
+	words += 2+WORDS_PER_DOUBLE;
+	break;
+      case PL_STRING:
+	words += 2+(c->value.text.length+1+sizeof(word))/sizeof(word);
+	break;
+      case PL_FUNCTOR:
+      { size_t arity = arityFunctor(c->value.functor);
+
+	if ( arity > 0 )
+	  words += 1+arity;
+	pending += arity;
+	break;
+      }
+      case PL_LIST:
+	words += 3*c->value.length;
+	pending += c->value.length;
+	break;
+      default:
+	return i;
+    }
+  }
+
+  if ( pending != 0 )
+    return count;
+
+  *size = words;
+  return -1;
+}
+
+
+static int
+term_cell_error(size_t index)
+{ GET_LD
+  term_t ex;
+
+  return ( (ex=PL_new_term_ref()) &&
+	   PL_put_int64(ex, index) &&
+	   PL_domain_error("term_cell", ex) );
+}
+
+
+int
+PL_put_term_cells(term_t t, const term_cell_t *cells, size_t count)
+{ GET_LD
+  size_t words = 0;
+  ssize_t bad;
+  tmp_buffer stack;
+  Word at;
+  size_t i;
+
+  if ( (bad=term_cells_size(cells, count, &words)) >= 0 )
+    return term_cell_error(bad);
+
+  if ( !hasGlobalSpace(words) )
+  { int rc;
+
+    if ( (rc=ensureGlobalSpace(words, ALLOW_GC)) != TRUE )
+      return raiseStackOverflow(rc);
+  }
+
+  initBuffer(&stack);
+  at = valTermRef(t);
+
+  for(i=0; ; i++)
+  { const term_cell_t *c = &cells[i];
+    cell_frame *fr;
+
+    switch(c->type)
+    { case PL_VARIABLE:
+	setVar(*at);
+	break;
+      case PL_ATOM:
+	*at = c->value.a;
+	break;
+      case PL_NIL:
+	*at = ATOM_nil;
+	break;
+      case PL_TERM:
+	if ( i == 0 )
+	  *at = linkVal(valHandleP(c->value.t));
+	else
+	  bindConsVal(at, valHandleP(c->value.t) PASS_LD);
+	break;
+      case PL_INTEGER:
+	put_int64(at, c->value.i, ALLOW_CHECKED PASS_LD);
+	break;
+      case PL_FLOAT:
+	put_double(at, c->value.f, ALLOW_CHECKED PASS_LD);
+	break;
+      case PL_STRING:
+	*at = globalString(c->value.text.length, c->value.text.s);
+	break;
+      case PL_FUNCTOR:
+      { size_t arity = arityFunctor(c->value.functor);
+
+	if ( arity == 0 )
+	{ *at = nameFunctor(c->value.functor);
+	} else
+	{ Word a = gTop;
+	  cell_frame f = { a+1, arity, 1 };
+
+	  gTop += 1+arity;
+	  a[0] = c->value.functor;
+	  *at = consPtr(a, TAG_COMPOUND|STG_GLOBAL);
+	  addBuffer(&stack, f, cell_frame);
+	}
+	break;
+      }
+      case PL_LIST:
+      { size_t len = c->value.length;
+
+	if ( len == 0 )
+	{ *at = ATOM_nil;
+	} else
+	{ Word a = gTop;
+	  Word p = a;
+	  cell_frame f = { a+1, len, 3 };
+
+	  gTop += 3*len;
+	  for(; len-- > 0; p += 3)
+	  { p[0] = FUNCTOR_dot2;
+	    p[2] = (len > 0 ? consPtr(&p[3], TAG_COMPOUND|STG_GLOBAL)
+			    : ATOM_nil);
+	  }
+	  *at = consPtr(a, TAG_COMPOUND|STG_GLOBAL);
+	  addBuffer(&stack, f, cell_frame);
+	}
+	break;
+      }
+    }
+
+    while( !isEmptyBuffer(&stack) &&
+	   (fr=topBuffer(&stack, cell_frame)-1)->left == 0 )
+      (void)popBufferP(&stack, cell_frame);
+    if ( isEmptyBuffer(&stack) )
+      break;
+
+    at = fr->p;
+    fr->p += fr->stride;
+    fr->left--;
+  }
+
+  discardBuffer(&stack);
+  assert(i+1 == count);
+
+  return TRUE;
+}
+
+
+int
+PL_unify_term_cells(term_t t, const term_cell_t *cells, size_t count)
+{ GET_LD
+  term_t tmp;
+  int rc;
+
+  if ( !(tmp = PL_new_term_ref()) )
+    return FALSE;
+  rc = ( PL_put_term_cells(tmp, cells, count) &&
+	 PL_unify(t, tmp) );
+  PL_reset_term_refs(tmp);
+
+  return rc;
+}
+
+
+/* get_term_cells() walks the term at p in prefix order.  If cells is
+   NULL it only counts the cells and the term references needed.
+*/
+
+static void
+get_term_cells(Word p, term_cell_t *cells, term_t h,
+	       size_t *ncells, size_t *nrefs ARG_LD)
+{ tmp_buffer stack;
+  size_t nc = 0;
+  size_t nr = 0;
+
+  initBuffer(&stack);
+
+  for(;;)
+  { term_cell_t c;
+    cell_frame *fr;
+    word w;
+
+    deRef(p);
+    w = *p;
+
+    if ( isTaggedInt(w) )
+    { c.type = PL_INTEGER;
+      c.value.i = valInt(w);
+    } else if ( isBignum(w) )
+    { c.type = PL_INTEGER;
+      c.value.i = valBignum(w);
+    } else if ( isFloat(w) )
+    { c.type = PL_FLOAT;
+      c.value.f = valFloat(w);
+    } else if ( isAtom(w) )
+    { if ( w == ATOM_nil )
+      { c.type = PL_NIL;
+      } else
+      { c.type = PL_ATOM;
+	c.value.a = w;
+      }
+    } else if ( isTerm(w) )
+    { Word tail;
+      intptr_t len;
+
+      if ( isList(w) &&
+	   (len = skip_list(p, &tail PASS_LD)) > 0 &&
+	   isNil(*tail) )
+      { cell_frame f = { p, len, 0 };
+
+	c.type = PL_LIST;
+	c.value.length = len;
+	addBuffer(&stack, f, cell_frame);
+      } else
+      { Functor f = valueTerm(w);
+	cell_frame fa = { f->arguments, arityFunctor(f->definition), 1 };
+
+	c.type = PL_FUNCTOR;
+	c.value.functor = f->definition;
+	addBuffer(&stack, fa, cell_frame);
+      }
+    } else
+    { c.type = PL_TERM;
+      if ( cells )
+      { c.value.t = h+nr;
+	setHandle(c.value.t, linkVal(p));
+      }
+      nr++;
+    }
+
+    if ( cells )
+      cells[nc] = c;
+    nc++;
+
+    while( !isEmptyBuffer(&stack) &&
+	   (fr=topBuffer(&stack, cell_frame)-1)->left == 0 )
+      (void)popBufferP(&stack, cell_frame);
+    if ( isEmptyBuffer(&stack) )
+      break;
+
+    if ( fr->stride == 0 )		/* list: p is the current cell */
+    { Word l = fr->p;
+
+      p = HeadList(l);
+      l = TailList(l);
+      deRef(l);
+      fr->p = l;
+    } else
+    { p = fr->p;
+      fr->p += fr->stride;
+    }
+    fr->left--;
+  }
+
+  discardBuffer(&stack);
+  *ncells = nc;
+  *nrefs  = nr;
+}
+
+
+int
+PL_get_term_cells(term_t t, term_cell_t *cells, size_t *count)
+{ GET_LD
+  size_t nc, nr;
+  term_t h = 0;
+
+  if ( !is_acyclic(valTermRef(t) PASS_LD) )
+    return PL_type_error("acyclic_term", t);
+
+  get_term_cells(valTermRef(t), NULL, 0, &nc, &nr PASS_LD);
+  if ( nc > *count )
+  { *count = nc;
+    return FALSE;
+  }
+  if ( nr > 0 && !(h = PL_new_term_refs((int)nr)) )
+    return FALSE;
+  get_term_cells(valTermRef(t), cells, h, &nc, &nr PASS_LD);
+  *count = nc;
+
   return TRUE;
 }
 
@@ -1464,6 +1815,55 @@ PL_get_chars(term_t t, char **s, unsigned flags)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+PL_get_text_view() provides  direct  access  to   the  text  of  an atom
+(CVT_ATOM) or string (CVT_STRING) without  converting or copying it. An
+atom is registered and remains valid until PL_release_text_view(). A string
+lives on the global stack and remains  valid until the next call that may
+allocate on the Prolog stacks.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+PL_get_text_view(term_t t, PL_text_view_t *view, unsigned int flags)
+{ GET_LD
+  word w = valHandle(t);
+  PL_chars_t text;
+
+  if ( (flags&CVT_ATOM) && isAtom(w) && get_atom_text(w, &text) )
+  { PL_register_atom(w);
+    view->atom = w;
+  } else if ( (flags&CVT_STRING) && isString(w) )
+  { get_string_text(w, &text PASS_LD);
+    view->atom = 0;
+  } else
+  { if ( (flags&CVT_EXCEPTION) )
+      return PL_error(NULL, 0, NULL, ERR_TYPE,
+		      (flags&CVT_STRING) ? ATOM_text : ATOM_atom, t);
+    return FALSE;
+  }
+
+  view->length = text.length;
+  if ( text.encoding == ENC_WCHAR )
+  { view->wide = TRUE;
+    view->text.w = text.text.w;
+  } else
+  { view->wide = FALSE;
+    view->text.t = text.text.t;
+  }
+
+  return TRUE;
+}
+
+
+void
+PL_release_text_view(PL_text_view_t *view)
+{ if ( view->atom )
+  { PL_unregister_atom(view->atom);
+    view->atom = 0;
+  }
+}
+
+
 int
 PL_get_text_as_atom(term_t t, atom_t *a, int flags)
 { GET_LD
@@ -4431,7 +4831,8 @@ notify_registered_foreign(functor_t fd, Module m)
 
 
 static predicate_t
-bindForeign(Module m, const char *name, int arity, Func f, int flags)
+bindForeign(Module m, const char *name, int arity, Func f, int flags,
+	    code signature)
 { GET_LD
   Procedure proc;
   Definition def;
@@ -4469,7 +4870,10 @@ bindForeign(Module m, const char *name, int arity, Func f, int flags)
   if ( (flags & PL_FA_NONDETERMINISTIC) ) set(def, P_NONDET);
   if ( (flags & PL_FA_VARARGS) )	  set(def, P_VARARG);
 
-  createForeignSupervisor(def, f);
+  if ( signature )
+    createTypedForeignSupervisor(def, f, signature);
+  else
+    createForeignSupervisor(def, f);
   notify_registered_foreign(fdef, m);
 
   return proc;
@@ -4496,7 +4900,7 @@ bindExtensions(const char *module, const PL_extension *ext)
 
   for(; ext->predicate_name; ext++)
   { bindForeign(m, ext->predicate_name, ext->arity,
-		ext->function, ext->flags);
+		ext->function, ext->flags, 0);
   }
 }
 
@@ -4521,7 +4925,7 @@ register_foreignv(const char *module,
 		  va_list args)
 { if ( extensions_loaded )
   { Module m = resolveModule(module);
-    predicate_t p = bindForeign(m, name, arity, f, flags);
+    predicate_t p = bindForeign(m, name, arity, f, flags, 0);
 
     if ( p && (flags&PL_FA_META) )
       PL_meta_predicate(p, va_arg(args, char*));
@@ -4567,6 +4971,70 @@ PL_register_foreign(const char *name, int arity, Func f, int flags, ...)
   return rc;
 }
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+PL_register_typed_foreign_in_module() registers  a   deterministic  pure
+function whose  arguments  are  described   by  signature.  This  is  a
+sequence of type characters for  the  input   arguments,  optionally
+followed by `>` and the types of the output arguments, e.g., "ii>i" for
+add(+Int, +Int, -Int).  Type characters are `i` (int64_t), `f` (double)
+and `a` (atom_t).  The VM  unboxes   the  input  arguments directly into
+pl_value_t cells and boxes  the  outputs,   avoiding  the  foreign frame
+and term handles.  Typed predicates can only be registered after the
+system is initialised.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+parse_typed_signature(const char *s, int *arity, code *signature)
+{ int n = 0;
+  int out = 0;
+  code sig = 0;
+
+  for(; *s; s++)
+  { int t;
+
+    switch(*s)
+    { case 'i': t = FTYPE_INT64;  break;
+      case 'f': t = FTYPE_DOUBLE; break;
+      case 'a': t = FTYPE_ATOM;   break;
+      case '>':
+	if ( out )
+	  return FALSE;
+	out = FTYPE_OUTPUT;
+	continue;
+      default:
+	return FALSE;
+    }
+    if ( n == MAX_FLI_ARGS )
+      return FALSE;
+    sig |= (code)(t|out) << (n*FTYPE_BITS);
+    n++;
+  }
+
+  *arity = n;
+  *signature = sig;
+
+  return n > 0;
+}
+
+
+int
+PL_register_typed_foreign_in_module(const char *module,
+				    const char *name, const char *signature,
+				    pl_typed_function_t f, int flags)
+{ int arity;
+  code sig;
+
+  if ( !extensions_loaded ||
+       (flags & (PL_FA_TRANSPARENT|PL_FA_NONDETERMINISTIC|
+		 PL_FA_VARARGS|PL_FA_META)) ||
+       !parse_typed_signature(signature, &arity, &sig) )
+    return FALSE;
+
+  return bindForeign(resolveModule(module), name, arity,
+		     (Func)f, flags, sig) != NULL;
+}
+
+
 		    /* deprecated */
 void
 PL_load_extensions(const PL_extension *ext)
@@ -5018,7 +5486,7 @@ PL_erase(record_t r)
 record_t
 PL_duplicate_record(record_t r)
 { if ( true(r, R_DUPLICATE) )
-  { r->references++;
+  { ATOMIC_INC(&r->references);
     return r;
   } else
     return NULL;
@@ -43,6 +43,15 @@ libraries and avoids Prolog picking wrong   symbols. It also reduces ELF
 symbol lookup and relocations.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+/* pl-array.c */
+COMMON(void)		initNumArrays(void);
+COMMON(int)		isNumArrayAtom(atom_t a);
+COMMON(size_t)		numArrayExternalSize(int type, size_t length);
+COMMON(void)		getNumArrayExternal(atom_t a, int *type, size_t *length);
+COMMON(void)		copyNumArrayExternal(atom_t a, void *to);
+COMMON(atom_t)		newNumArrayExternal(int type, size_t length,
+					    const void *from);
+
 /* pl-attvar.c */
 COMMON(void)		assignAttVar(Word av, Word value ARG_LD);
 COMMON(int)		saveWakeup(wakeup_state *state, int forceframe ARG_LD);
@@ -59,11 +68,13 @@ COMMON(int)		gvar_value__LD(atom_t name, Word p ARG_LD);
 
 /* pl-wam.c */
 COMMON(word)		pl_count(void);
+COMMON(word)		pl_vmi_sequences(term_t length, term_t list);
 COMMON(void)		TrailAssignment__LD(Word p ARG_LD);
 COMMON(void)		do_undo(mark *m);
 COMMON(Definition)	getProcDefinition__LD(Definition def ARG_LD);
 COMMON(Definition)	getProcDefinitionForThread(Definition def, unsigned int tid);
 COMMON(void)		destroyLocalDefinition(Definition def, unsigned int tid);
+COMMON(void)		recycleLocalDefinition(Definition def, unsigned int tid);
 COMMON(void)		fix_term_ref_count(void);
 COMMON(fid_t)		PL_open_foreign_frame__LD(ARG1_LD);
 COMMON(void)		PL_close_foreign_frame__LD(fid_t id ARG_LD);
@@ -85,6 +96,8 @@ COMMON(Code)		allocCodes(size_t len);
 COMMON(void)		freeCodesDefinition(Definition def, int linger);
 COMMON(void)		freeSupervisor(Definition def, Code code, int linger);
 COMMON(int)		createForeignSupervisor(Definition def, Func f);
+COMMON(int)		createTypedForeignSupervisor(Definition def, Func f,
+						     code signature);
 COMMON(int)		createUndefSupervisor(Definition def);
 COMMON(Code)		createSupervisor(Definition def);
 COMMON(int)		setSupervisor(Definition def);
@@ -95,6 +108,7 @@ COMMON(void)		initSupervisors(void);
 /* pl-atom.c */
 #define checkAtoms()	checkAtoms_src(__FILE__, __LINE__)
 COMMON(word)		lookupAtom(const char *s, size_t len);
+COMMON(word)		lookupAtomAdopt(char *s, size_t len);
 COMMON(word)		lookupBlob(const char *s, size_t len,
 				   PL_blob_t *type, int *new);
 COMMON(word)		pl_atom_hashstat(term_t i, term_t n);
@@ -116,12 +130,16 @@ COMMON(void)		markAtomsFindall(PL_local_data_t *ld);
 
 /* pl-index.c */
 COMMON(word)		getIndexOfTerm(term_t t);
+COMMON(word)		indirectIndexKey(Word p);
 COMMON(ClauseRef)	firstClause(Word argv, LocalFrame fr, Definition def,
 				    ClauseChoice next ARG_LD);
 COMMON(ClauseRef)	nextClause__LD(ClauseChoice chp, Word argv, LocalFrame fr,
 				       Definition def ARG_LD);
+COMMON(Clause)		lastClauseCandidate(ClauseChoice chp, LocalFrame fr ARG_LD);
 COMMON(int)		addClauseToIndexes(Definition def, Clause cl,
 					   ClauseRef where);
+COMMON(int)		addClausesToIndexes(Definition def, Clause *clauses,
+					    size_t count, ClauseRef where);
 COMMON(void)		delClauseFromIndex(Definition def, Clause cl);
 COMMON(void)		cleanClauseIndexes(Definition def, ClauseList cl,
 					   DirtyDefInfo ddi, gen_t start);
@@ -129,11 +147,17 @@ COMMON(void)		clearTriedIndexes(Definition def);
 COMMON(void)		unallocClauseIndexTable(ClauseIndex ci);
 COMMON(void)		deleteActiveClauseFromIndexes(Definition def, Clause cl);
 COMMON(bool)		unify_index_pattern(Procedure proc, term_t value);
+COMMON(bool)		unify_index_statistics(Procedure proc, term_t value);
+COMMON(void)		deleteIndexStatistics(Definition def);
 COMMON(void)		deleteIndexes(ClauseList cl, int isnew);
+COMMON(void)		forgetIndexRequests(Definition def);
 COMMON(int)		checkClauseIndexSizes(Definition def, int nindexable);
 COMMON(void)		checkClauseIndexes(Definition def);
 COMMON(void)		listIndexGenerations(Definition def, gen_t gen);
 COMMON(size_t)		sizeofClauseIndexes(Definition def);
+COMMON(int)		getIndexHints(Definition def, hash_hints *hints, int max);
+COMMON(int)		createIndexFromHints(Definition def, hash_hints *hints);
+COMMON(void)		deleteRangeIndexes(Definition def);
 
 /* pl-dwim.c */
 COMMON(word)		pl_dwim_match(term_t a1, term_t a2, term_t mm);
@@ -250,6 +274,8 @@ COMMON(size_t)		functor_space(void);
 /* pl-gc.c */
 COMMON(int)		considerGarbageCollect(Stack s);
 COMMON(void)		call_tune_gc_hook(void);
+COMMON(void)		call_gc_event_hook(void);
+COMMON(int)		put_gc_event(term_t t, gc_stats *stats ARG_LD);
 COMMON(int)		garbageCollect(gc_reason_t reason);
 COMMON(word)		pl_garbage_collect(term_t d);
 COMMON(gc_stat *)	last_gc_stats(gc_stats *stats);
@@ -257,6 +283,7 @@ COMMON(Word)		findGRef(int n);
 COMMON(size_t)		nextStackSizeAbove(size_t n);
 COMMON(int)		shiftTightStacks(void);
 COMMON(int)		growStacks(size_t l, size_t g, size_t t);
+COMMON(void)		trimOversizedStacks(ARG1_LD);
 COMMON(size_t)		nextStackSize(Stack s, size_t minfree);
 COMMON(int)		makeMoreStackSpace(int overflow, int flags);
 COMMON(int)		f_ensureStackSpace__LD(size_t gcells, size_t tcells,
@@ -268,6 +295,7 @@ COMMON(void)		setLTopInBody(void);
 COMMON(word)		check_foreign(void);	/* DEBUG(CHK_SECURE...) stuff */
 COMMON(void)		markAtomsOnStacks(PL_local_data_t *ld);
 COMMON(void)		markPredicatesInEnvironments(PL_local_data_t *ld);
+COMMON(void)		freeCGCCache(PL_local_data_t *ld);
 COMMON(QueryFrame)	queryOfFrame(LocalFrame fr);
 COMMON(void)		mark_active_environment(struct bit_vector *active,
 						LocalFrame fr, Code PC);
@@ -304,6 +332,7 @@ COMMON(Word)		stripModule(Word term, Module *module, int flags ARG_LD);
 COMMON(Word)		stripModuleName(Word term, atom_t *name ARG_LD);
 COMMON(bool)		isPublicModule(Module module, Procedure proc);
 COMMON(int)		exportProcedure(Module module, Procedure proc);
+COMMON(Table)		modulePublicTable(Module m);
 COMMON(int)		declareModule(atom_t name, atom_t class, atom_t super,
 				      SourceFile sf, int line,
 				      int rdef);
@@ -416,6 +445,8 @@ COMMON(atom_t)		accessLevel(void);
 
 /* pl-proc.c */
 COMMON(Procedure)	lookupProcedure(functor_t f, Module m) WUNUSED;
+COMMON(void)		lockDefinition(Definition def);
+COMMON(void)		unlockDefinition(Definition def);
 COMMON(void)		unallocProcedure(Procedure proc);
 COMMON(Procedure)	isCurrentProcedure__LD(functor_t f, Module m ARG_LD);
 COMMON(int)		importDefinitionModule(Module m,
@@ -442,10 +473,20 @@ COMMON(void)		setMetapredicateMask(Definition def, arg_info *args);
 COMMON(int)		isTransparentMetamask(Definition def, arg_info *args);
 COMMON(ClauseRef)	assertDefinition(Definition def, Clause clause,
 					 ClauseRef where ARG_LD);
+COMMON(int)		assertDefinitionList(Definition def, Clause *clauses,
+					     size_t count, ClauseRef where ARG_LD);
+COMMON(int)		assertClauseBlock(Definition def, const char *data,
+					  size_t size, size_t count ARG_LD);
 COMMON(ClauseRef)	assertProcedure(Procedure proc, Clause clause,
 					ClauseRef where ARG_LD);
+COMMON(ClauseRef)	assertProcedureBefore(Procedure proc, Clause clause,
+					      ClauseRef where,
+					      ClauseRef prev ARG_LD);
 COMMON(bool)		abolishProcedure(Procedure proc, Module module);
 COMMON(bool)		retractClauseDefinition(Definition def, Clause clause);
+COMMON(int)		eraseClauseDefinition(Definition def, Clause clause,
+				      gen_t gen);
+COMMON(void)		setLastModifiedPredicate(Definition def, gen_t gen);
 COMMON(void)		unallocClause(Clause c);
 COMMON(void)		freeClause(Clause c);
 COMMON(void)		lingerClauseRef(ClauseRef c);
@@ -458,6 +499,8 @@ COMMON(void)		reconsultFinalizePredicate(sf_reload *rl, Definition def,
 						   p_reload *r ARG_LD);
 COMMON(void)		destroyDefinition(Definition def);
 COMMON(Procedure)	resolveProcedure__LD(functor_t f, Module module ARG_LD);
+COMMON(void)		resolveProcedureCacheChanged(void);
+COMMON(void)		resolveFunctorCacheChanged(functor_t f);
 COMMON(Definition)	trapUndefined(Definition undef ARG_LD);
 COMMON(word)		pl_abolish(term_t atom, term_t arity);
 COMMON(word)		pl_abolish1(term_t pred);
@@ -535,6 +578,8 @@ COMMON(Record)		compileTermToHeap__LD(term_t term,
 COMMON(int)		copyRecordToGlobal(term_t copy, Record term,
 					   int flags ARG_LD);
 COMMON(int)		variantRecords(const Record r1, const Record r2);
+COMMON(unsigned int)	hashRecord(const Record r);
+COMMON(int)		equalRecords(const Record r1, const Record r2);
 COMMON(bool)		freeRecord(Record record);
 COMMON(void)		unallocRecordRef(RecordRef r);
 COMMON(bool)		unifyKey(term_t key, word val);
@@ -558,6 +603,7 @@ COMMON(void)		blockSignal(int sig);
 COMMON(void)		resetSignals(void);
 COMMON(void)		cleanupSignals(void);
 COMMON(int)		handleSignals(ARG1_LD);
+COMMON(void)		signalWakeup(PL_local_data_t *ld);
 
 COMMON(int)		initPrologStacks(size_t limit);
 COMMON(void)		initPrologLocalData(ARG1_LD);
@@ -620,6 +666,8 @@ COMMON(const char *)	string_summary(word name, unsigned int maxlen);
 COMMON(bool)		loadWicFromStream(const char *rcpath, IOSTREAM *fd);
 COMMON(bool)		compileFileList(IOSTREAM *out, int argc, char **argv);
 COMMON(void)		qlfCleanup(void);
+COMMON(int)		loadLazyDefinition(Definition def);
+COMMON(void)		discardLazyDefinition(Definition def);
 
 COMMON(void)		wicPutStringW(const pl_wchar_t *w, size_t len,
 				      IOSTREAM *fd);
@@ -696,6 +744,8 @@ COMMON(access_level_t)	setAccessLevel(access_level_t new_level);
 
 /* pl-thread.c */
 COMMON(foreign_t)	pl_with_mutex(term_t mutex, term_t goal);
+COMMON(foreign_t)	pl_with_read_lock(term_t mutex, term_t goal);
+COMMON(foreign_t)	pl_with_write_lock(term_t mutex, term_t goal);
 COMMON(foreign_t)	pl_thread_self(term_t self);
 #ifdef O_PLMT
 COMMON(int)		unify_thread_id(term_t id, PL_thread_info_t *info);
@@ -724,6 +774,10 @@ COMMON(void)	cpNumber(Number to, Number from);
 COMMON(Code)	push_continuation(term_t cont, LocalFrame pfr, Code pcret
 				  ARG_LD);
 COMMON(Code)	shift(term_t ball ARG_LD);
+COMMON(void)	freeContinuationLocalData(PL_local_data_t *ld);
+
+/* pl-glob.c */
+COMMON(void)	freeGlobLocalData(PL_local_data_t *ld);
 
 /* pl-variant.c */
 COMMON(int)	is_variant_ptr(Word p1, Word p2 ARG_LD);
@@ -40,19 +40,42 @@
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Functor (name/arity) handling.  A functor is a unique object (like atoms).
 See pl-atom.c for many useful comments on the representation.
+
+As the atom table, the functor table   is split into FUNCTOR_TABLE_SHARDS
+shards that are resized independently. The  hash combines the name and
+arity such that functors that share their  name, such as the functors
+for dicts of different sizes, are spread over the table. The high bits
+of the hash select the shard and the low bits the bucket.
+
+Lookup and insertion are lock-free.  A   new  functor  is linked using
+COMPARE_AND_SWAP_PTR(). If a rehash of the  shard started after the new
+functor was linked, the functor is marked   DEAD_F and the insertion is
+retried in the new table. Functors  are  never   freed  while  the system
+runs, so dead functors are simply left behind.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 #undef LD
 #define LD LOCAL_LD
 
-#define functorDefTable (GD->functors.table)
+#define functorTable(s) (GD->functors.tables[s])
+#define functorTableShard(h) ((h) >> (32-FUNCTOR_TABLE_SHARD_BITS))
+
+static inline unsigned int
+functorDefHash(atom_t name, size_t arity)
+{ uint64_t k = ((uint64_t)(name>>LMASK_BITS) << 8) ^ (uint64_t)arity;
+
+  k *= 0x9E3779B97F4A7C15ULL;		/* Fibonacci hashing */
+
+  return (unsigned int)(k >> 32);
+}
 
 #ifdef O_PLMT
 
-#define acquire_functor_table(t, b) \
-  { LD->thread.info->access.functor_table = functorDefTable; \
-    t = LD->thread.info->access.functor_table->table; \
-    b = LD->thread.info->access.functor_table->buckets; \
+#define acquire_functor_table(s, ft, t, b) \
+  { LD->thread.info->access.functor_table = functorTable(s); \
+    ft = LD->thread.info->access.functor_table; \
+    t = ft->table; \
+    b = ft->buckets; \
   }
 
 #define release_functor_table() \
@@ -61,9 +84,10 @@ See pl-atom.c for many useful comments on the representation.
 
 #else
 
-#define acquire_functor_table(t, b) \
-  { t = functorDefTable->table; \
-    b = functorDefTable->buckets; \
+#define acquire_functor_table(s, ft, t, b) \
+  { ft = functorTable(s); \
+    t = ft->table; \
+    b = ft->buckets; \
   }
 
 #define release_functor_table() (void)0
@@ -71,7 +95,8 @@ See pl-atom.c for many useful comments on the representation.
 #endif
 
 static void	  allocFunctorTable(void);
-static void	  rehashFunctors(void);
+static void	  rehashFunctors(unsigned int shard);
+static int	  shouldRehashFunctors(FunctorTable ft);
 
 static void
 allocateFunctorBlock(int idx)
@@ -124,22 +149,30 @@ registerFunctor(FunctorDef fd)
 functor_t
 lookupFunctorDef(atom_t atom, size_t arity)
 { GET_LD
-  int v;
+  unsigned int h, v, shard;
+  FunctorTable ft;
   FunctorDef *table;
   int buckets;
   FunctorDef f, head;
 
+  h = functorDefHash(atom, arity);
+  shard = functorTableShard(h);
+
 redo:
-  acquire_functor_table(table, buckets);
+  acquire_functor_table(shard, ft, table, buckets);
 
-  v = (int)pointerHashValue(atom, buckets);
+  v = h & (buckets-1);
   head = table[v];
 
   DEBUG(9, Sdprintf("Lookup functor %s/%d = ", stringAtom(atom), arity));
   for(f = table[v]; f; f = f->next)
   { if (atom == f->name && f->arity == arity)
-    { DEBUG(9, Sdprintf("%p (old)\n", f));
-      if ( !FUNCTOR_IS_VALID(f->flags) )
+    { unsigned int flags = f->flags;
+
+      DEBUG(9, Sdprintf("%p (old)\n", f));
+      if ( (flags&DEAD_F) )
+	continue;
+      if ( !FUNCTOR_IS_VALID(flags) )
       { goto redo;
       }
       release_functor_table();
@@ -147,13 +180,13 @@ redo:
     }
   }
 
-  if ( functorDefTable->buckets * 2 < GD->statistics.functors )
+  if ( shouldRehashFunctors(functorTable(shard)) )
   { PL_LOCK(L_FUNCTOR);
-    rehashFunctors();
+    rehashFunctors(shard);
     PL_UNLOCK(L_FUNCTOR);
   }
 
-  if ( !( table == functorDefTable->table && head == table[v] ) )
+  if ( !( ft == functorTable(shard) && head == table[v] ) )
     goto redo;
 
   f = (FunctorDef) allocHeapOrHalt(sizeof(struct functorDef));
@@ -161,11 +194,13 @@ redo:
   f->name    = atom;
   f->arity   = arity;
   f->flags   = 0;
-  f->next    = table[v];
-  if ( !( COMPARE_AND_SWAP_PTR(&table[v], head, f) &&
-	  !GD->functors.rehashing &&
-          table == functorDefTable->table) )
-  { PL_free(f);
+  f->next    = head;
+  if ( !COMPARE_AND_SWAP_PTR(&table[v], head, f) )
+  { freeHeap(f, sizeof(*f));
+    goto redo;
+  }
+  if ( ft->rehashing || ft != functorTable(shard) )
+  { f->flags = DEAD_F;			/* linked, but may not be moved */
     goto redo;
   }
   registerFunctor(f);
@@ -182,8 +217,8 @@ redo:
 
 
 static void
-maybe_free_functor_tables(void)
-{ FunctorTable t = functorDefTable;
+maybe_free_functor_tables(unsigned int shard)
+{ FunctorTable t = functorTable(shard);
 
   while ( t )
   { FunctorTable t2 = t->prev;
@@ -197,54 +232,68 @@ maybe_free_functor_tables(void)
 }
 
 
+static int
+shouldRehashFunctors(FunctorTable ft)
+{ return (size_t)ft->buckets * 2 * FUNCTOR_TABLE_SHARDS <
+	 GD->statistics.functors;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+rehashFunctors() doubles the buckets of a  single shard, walking the hash
+chains of the old table. Functors that  are   linked  but  not yet valid
+belong to a lookupFunctorDef() that is  completing its insertion, which
+either makes it valid or  discovers  the   rehash  and  marks  it dead.
+Must be called with L_FUNCTOR held.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 static void
-rehashFunctors(void)
-{ FunctorTable newtab;
-  size_t index;
-  int i, last = FALSE;
+rehashFunctors(unsigned int shard)
+{ FunctorTable oldtab = functorTable(shard);
+  FunctorTable newtab;
+  size_t mask;
+  int i;
 
-  if ( functorDefTable->buckets * 2 >= GD->statistics.functors )
+  if ( !shouldRehashFunctors(oldtab) )
     return;
 
   newtab = allocHeapOrHalt(sizeof(*newtab));
-  newtab->buckets = functorDefTable->buckets * 2;
+  newtab->buckets = oldtab->buckets * 2;
+  newtab->rehashing = FALSE;
   newtab->table = allocHeapOrHalt(newtab->buckets * sizeof(FunctorDef));
   memset(newtab->table, 0, newtab->buckets * sizeof(FunctorDef));
-  newtab->prev = functorDefTable;
+  newtab->prev = oldtab;
+  mask = newtab->buckets-1;
 
   DEBUG(MSG_HASH_STAT,
-	Sdprintf("Rehashing functor-table (%d --> %d)\n",
-		 functorDefTable->buckets, newtab->buckets));
+	Sdprintf("Rehashing functor shard %d (%d --> %d)\n",
+		 shard, oldtab->buckets, newtab->buckets));
 
-  GD->functors.rehashing = TRUE;
-  for(index=1, i=0; !last; i++)
-  { size_t upto = (size_t)2<<i;
-    FunctorDef *b;
+  oldtab->rehashing = TRUE;
+  MEMORY_BARRIER();
 
-    if ( (b=GD->functors.array.blocks[i]) )
-    { size_t high = GD->functors.highest;
+  for(i=0; i<oldtab->buckets; i++)
+  { FunctorDef f, next;
 
-      if ( upto >= high )
-      { upto = high;
-	last = TRUE;
-      }
+    for(f=oldtab->table[i]; f; f=next)
+    { volatile unsigned int *flagsp = &f->flags;
 
-      for(; index<upto; index++)
-      { FunctorDef f = b[index];
+      next = f->next;
+      while( !(*flagsp & (VALID_F|DEAD_F)) )
+	MEMORY_BARRIER();
 
-	if ( f && FUNCTOR_IS_VALID(f->flags) )
-	{ size_t v = pointerHashValue(f->name, newtab->buckets);
+      if ( FUNCTOR_IS_VALID(*flagsp) )
+      { size_t v = functorDefHash(f->name, f->arity) & mask;
 
-	  f->next = newtab->table[v];
-	  newtab->table[v] = f;
-	}
+	f->next = newtab->table[v];
+	newtab->table[v] = f;
       }
     }
   }
 
-  functorDefTable = newtab;
-  GD->functors.rehashing = FALSE;
-  maybe_free_functor_tables();
+  MEMORY_BARRIER();
+  functorTable(shard) = newtab;
+  maybe_free_functor_tables(shard);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -255,32 +304,35 @@ not known.
 functor_t
 isCurrentFunctor(atom_t atom, size_t arity)
 { GET_LD
-  unsigned int v;
+  unsigned int h, v, shard;
   int buckets;
+  FunctorTable ft;
   FunctorDef *table;
   FunctorDef f;
   functor_t rc = 0;
 
+  h = functorDefHash(atom, arity);
+  shard = functorTableShard(h);
+
 redo:
-  acquire_functor_table(table, buckets);
+  acquire_functor_table(shard, ft, table, buckets);
 
-  v = (unsigned int)pointerHashValue(atom, buckets);
+  v = h & (buckets-1);
   for(f = table[v]; f; f = f->next)
   { if ( FUNCTOR_IS_VALID(f->flags) && atom == f->name && f->arity == arity )
-    { release_functor_table();
-      rc = f->functor;
+    { rc = f->functor;
       break;
     }
   }
 
   release_functor_table();
 
-  if ( !rc && functorDefTable->buckets * 2 < GD->statistics.functors )
+  if ( !rc && shouldRehashFunctors(functorTable(shard)) )
   { PL_LOCK(L_FUNCTOR);
-    rehashFunctors();
+    rehashFunctors(shard);
     PL_UNLOCK(L_FUNCTOR);
   }
-  if ( table != functorDefTable->table )
+  if ( !rc && ft != functorTable(shard) )
     goto redo;
 
   return rc;
@@ -301,11 +353,19 @@ FUNCTOR(NULL_ATOM, 0)
 
 static void
 allocFunctorTable(void)
-{ functorDefTable = allocHeapOrHalt(sizeof(*functorDefTable));
-  functorDefTable->buckets = FUNCTORHASHSIZE;
-  functorDefTable->table = allocHeapOrHalt(FUNCTORHASHSIZE * sizeof(FunctorDef));
-  memset(functorDefTable->table, 0, FUNCTORHASHSIZE * sizeof(FunctorDef));
-  functorDefTable->prev = NULL;
+{ int s;
+
+  for(s=0; s<FUNCTOR_TABLE_SHARDS; s++)
+  { FunctorTable ft = allocHeapOrHalt(sizeof(*ft));
+    size_t buckets = FUNCTORHASHSIZE/FUNCTOR_TABLE_SHARDS;
+
+    ft->buckets = (int)buckets;
+    ft->rehashing = FALSE;
+    ft->table = allocHeapOrHalt(buckets * sizeof(FunctorDef));
+    memset(ft->table, 0, buckets * sizeof(FunctorDef));
+    ft->prev = NULL;
+    functorTable(s) = ft;
+  }
 }
 
 
@@ -318,13 +378,15 @@ registerBuiltinFunctors(void)
   GD->statistics.functors = size;
 
   for(d = functors; d->name; d++, f++)
-  { size_t v = pointerHashValue(d->name, functorDefTable->buckets);
+  { unsigned int h = functorDefHash(d->name, d->arity);
+    FunctorTable ft = functorTable(functorTableShard(h));
+    size_t v = h & (ft->buckets-1);
 
     f->name             = d->name;
     f->arity            = d->arity;
     f->flags		= 0;
-    f->next             = functorDefTable->table[v];
-    functorDefTable->table[v]  = f;
+    f->next             = ft->table[v];
+    ft->table[v]        = f;
     registerFunctor(f);
   }
 }
@@ -381,7 +443,7 @@ registerArithFunctors()
 void
 initFunctors(void)
 { PL_LOCK(L_FUNCTOR);
-  if ( !functorDefTable )
+  if ( !functorTable(0) )
   { initAtoms();
     allocFunctorTable();
     GD->functors.highest = 1;
@@ -395,10 +457,8 @@ initFunctors(void)
 
 void
 cleanupFunctors(void)
-{ FunctorTable table = functorDefTable;
-
-  if ( table )
-  { int i;
+{ if ( functorTable(0) )
+  { int i, s;
     int builtin_count      = sizeof(functors)/sizeof(builtin_functor) - 1;
     FunctorDef builtin     = GD->functors.array.blocks[0][1];
     FunctorDef builtin_end = builtin+builtin_count;
@@ -429,13 +489,17 @@ cleanupFunctors(void)
       PL_free(fp0);
     }
 
-    while ( table )
-    { FunctorTable prev = table->prev;
-      freeHeap(table->table, table->buckets * sizeof(FunctorDef));
-      freeHeap(table, sizeof(functor_table));
-      table = prev;
+    for(s=0; s<FUNCTOR_TABLE_SHARDS; s++)
+    { FunctorTable table = functorTable(s);
+
+      while ( table )
+      { FunctorTable prev = table->prev;
+	freeHeap(table->table, table->buckets * sizeof(FunctorDef));
+	freeHeap(table, sizeof(functor_table));
+	table = prev;
+      }
+      functorTable(s) = NULL;
     }
-    table = NULL;
   }
 }
 
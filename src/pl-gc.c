@@ -43,6 +43,9 @@
 #include "pentium.h"
 #include "pl-inline.h"
 #include "pl-prof.h"
+#include "pl-metrics.h"
+#include "pl-tracepoint.h"
+#include "pl-event.h"
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 This module is based on
@@ -537,8 +540,23 @@ gc_stat_aggregate(gc_stats *stats)
   stats->aggr_index = STAT_NEXT_INDEX(stats->aggr_index);
 }
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+gc_phase_time() returns the CPU time used since the previous call (or
+gc_stat_start()) and restarts the phase clock.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static double
+gc_phase_time(gc_stats *stats ARG_LD)
+{ double cpu = ThreadCPUTime(LD, CPU_USER);
+  double t = cpu - stats->phases.start;
+
+  stats->phases.start = cpu;
+
+  return t;
+}
+
 static void
-gc_stat_start(gc_stats *stats, unsigned int reason ARG_LD)
+gc_stat_start(gc_stats *stats, gc_reason_t reason ARG_LD)
 { gc_stat *this = &stats->last[stats->last_index];
   double cpu = ThreadCPUTime(LD, CPU_USER);
 
@@ -555,6 +573,10 @@ gc_stat_start(gc_stats *stats, unsigned int reason ARG_LD)
   this->local	      = usedStack(local);
   this->prolog_time   = cpu - stats->thread_cpu;
   stats->thread_cpu   = cpu;
+
+  memset(&stats->phases, 0, sizeof(stats->phases));
+  stats->phases.start = cpu;
+  TRACEPOINT2(gc__start, (int)reason, this->global_before);
 }
 
 static gc_stat *
@@ -568,6 +590,13 @@ gc_stat_end(gc_stats *stats ARG_LD)
   stats->thread_cpu   = cpu;
   stats->last_index   = STAT_NEXT_INDEX(stats->last_index);
 
+  if ( this->gc_time > 0.0 )
+  { double rate = (double)(this->global_before+this->trail_before)/
+		  this->gc_time;
+
+    stats->rate = (stats->rate > 0.0 ? (stats->rate+rate)/2.0 : rate);
+  }
+
   LD->stacks.global.gced_size = this->global_after;
   LD->stacks.trail.gced_size  = this->trail_after;
 
@@ -575,9 +604,13 @@ gc_stat_end(gc_stats *stats ARG_LD)
   stats->totals.trail_gained  += this->trail_before  - this->trail_after;
   stats->totals.time	      += this->gc_time;
   stats->totals.collections++;
+  metricObserve(MET_GC_SECONDS, this->gc_time);
+  TRACEPOINT2(gc__done, this->global_before, this->global_after);
 
   if ( gc_percentage(this) > 0.2 )
     PL_raise(SIG_TUNE_GC);
+  if ( GD->event.hook.ongc )
+    PL_raise(SIG_GC_EVENT);
 
   return this;
 }
@@ -698,6 +731,12 @@ isGlobalRef(word w)
 }
 
 
+/* Indirect headers use STG_LOCAL.  Note that we cannot simply test the
+   STG_LOCAL bit as STG_LARGE references have this bit set too.
+*/
+
+#define isIndHdrCell(p) (storage(*(p)) == STG_LOCAL)
+
 static inline size_t
 offset_word(word m)
 { size_t offset;
@@ -913,7 +952,11 @@ forward:				/* Go into the tree */
 	BACKWARD;
     case TAG_STRING:
     case TAG_FLOAT:			/* indirects */
-    { next = valPtr2(val, STG_GLOBAL);
+    { if ( storage(val) == STG_LARGE )
+      { markLargeIndirect(val PASS_LD);
+	BACKWARD;
+      }
+      next = valPtr2(val, STG_GLOBAL);
 
       DEBUG(CHK_SECURE, assert(storage(val) == STG_GLOBAL));
       DEBUG(CHK_SECURE, assert(onStack(global, next)));
@@ -1139,10 +1182,33 @@ term_refs_to_gvars(fid_t fid, Word *saved_bar_at)
   PL_close_foreign_frame(fid);
 }
 
+
+/* Large strings and numbers stored  directly   in  a global variable are
+   not on the global stack and must be marked explicitly.
+*/
+
+static void
+mark_large_gvars(ARG1_LD)
+{ if ( LD->gvar.nb_vars && LD->gc.large.objects )
+  { TableEnum e = newTableEnum(LD->gvar.nb_vars);
+    void *v;
+
+    while( advanceTableEnum(e, NULL, &v) )
+    { word w = (word)v;
+
+      if ( isLargeIndirect(w) )
+	markLargeIndirect(w PASS_LD);
+    }
+
+    freeTableEnum(e);
+  }
+}
+
 #else /*O_GVAR*/
 
 #define gvars_to_term_refs() 0
 #define term_refs_to_gvars(f) (void)0
+#define mark_large_gvars() (void)0
 
 #endif /*O_GVAR*/
 
@@ -1308,6 +1374,7 @@ clearUninitialisedVarsFrame(LocalFrame fr, Code PC)
 	case I_FREDO:
 	case S_TRUSTME:
 	case S_LIST:
+	case S_SWITCH:
 	  return;
 
 	case C_JMP:			/* jumps */
@@ -1684,9 +1751,12 @@ mark_local_variable(Word p ARG_LD)
   }
 
   if ( isGlobalRef(*p) )
-    mark_variable(p PASS_LD);
-  else
+  { mark_variable(p PASS_LD);
+  } else
+  { if ( isLargeIndirect(*p) )
+      markLargeIndirect(get_value(p) PASS_LD);
     ldomark(p);
+  }
 }
 
 
@@ -1876,6 +1946,7 @@ walk_and_mark(walk_state *state, Code PC, code end ARG_LD)
       case I_FEXITNDET:
       case S_TRUSTME:			/* Consider supervisor handling! */
       case S_LIST:
+      case S_SWITCH:
 	return PC-1;
       case S_NEXTCLAUSE:
 	mark_alt_clauses(state->frame, state->frame->clause->next PASS_LD);
@@ -2064,6 +2135,7 @@ walk_and_mark(walk_state *state, Code PC, code end ARG_LD)
 	  break;
 	case H_FUNCTOR:
 	case H_LIST:
+	case H_CODES:
 	  mark_argp(state PASS_LD);
 	  /*FALLTHROUGH*/
 	case B_FUNCTOR:
@@ -2267,9 +2339,9 @@ is not GC-ed. This applies  for   head-arguments  as well as B_UNIFY_VAR
 instructions. See get_vmi_state().
 
 (***) When debugging, we must  avoid   GC-ing  local variables of frames
-that  are  watched  by  the  debugger.    FR_WATCHED  is  also  used  by
+that are watched by the debugger (FR_DEBUG).  FR_CLEANUP is  used by
 setup_call_cleanup/3. We avoid full marking here. Maybe we should use an
-alternate flag for these two cases?
+alternate flag for these two cases?  FR_COUNTED frames need no marking.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static QueryFrame
@@ -2329,7 +2401,7 @@ mark_environments(mark_state *mstate, LocalFrame fr, Code PC ARG_LD)
 	mark_local_variable(argp0 PASS_LD);
       }
 
-      if ( true(fr, FR_WATCHED) &&		/* (***) */
+      if ( true(fr, FR_CLEANUP|FR_DEBUG) &&	/* (***) */
 	   fr->predicate != PROCEDURE_setup_call_catcher_cleanup4->definition )
       { int slots;
 	Word sp;
@@ -2586,6 +2658,7 @@ compact_trail(void)
     update_relocation_chain(&current->address, &dest->address PASS_LD);
 
   tTop = (TrailEntry)dest;
+  LD->trail_tidy.scanned = 0;		/* indexes have changed */
 
   if ( relocated_cells != relocation_cells )
     sysError("After trail: relocation cells = %ld; relocated_cells = %ld\n",
@@ -2782,7 +2855,7 @@ sweep_global_mark(Word *m ARG_LD)
   for(;;)
   { Word prev = gm-1;
 
-    while( !(*prev & (MARK_MASK|FIRST_MASK|STG_LOCAL)) )
+    while( !is_marked_or_first(prev) && !isIndHdrCell(prev) )
     { if ( tag(*prev) == TAG_VAR && *prev != 0 )
       { gm = gBase + valVar(*prev);
 	goto done;			/* (*) */
@@ -3115,8 +3188,12 @@ is_downward_ref(Word p ARG_LD)
   { case TAG_INTEGER:
       if ( storage(val) == STG_INLINE )
 	fail;
-    case TAG_ATTVAR:
+      /*FALLTHROUGH*/
     case TAG_STRING:
+      if ( storage(val) == STG_LARGE )
+	fail;
+      /*FALLTHROUGH*/
+    case TAG_ATTVAR:
     case TAG_FLOAT:
     case TAG_REFERENCE:
     case TAG_COMPOUND:
@@ -3140,8 +3217,12 @@ is_upward_ref(Word p ARG_LD)
   { case TAG_INTEGER:
       if ( storage(val) == STG_INLINE )
 	fail;
-    case TAG_ATTVAR:
+      /*FALLTHROUGH*/
     case TAG_STRING:
+      if ( storage(val) == STG_LARGE )
+	fail;
+      /*FALLTHROUGH*/
+    case TAG_ATTVAR:
     case TAG_FLOAT:
     case TAG_REFERENCE:
     case TAG_COMPOUND:
@@ -3209,7 +3290,7 @@ downskip_combine_garbage(Word current, Word dest ARG_LD)
 { Word top_gc = current + offset_cell(current);
 
   for(current-- ; ; current-- )
-  { if ( (*current & (MARK_MASK|FIRST_MASK|STG_LOCAL)) )
+  { if ( is_marked_or_first(current) || isIndHdrCell(current) )
     { if ( is_marked(current) )
       { DEBUG(MSG_GC_HOLE, Sdprintf("Normal-non-GC cell at %p\n", current));
 	return make_gc_hole(current+1, top_gc);
@@ -3382,8 +3463,10 @@ collect_phase(vm_state *state, Word *saved_bar_at)
   { DEBUG(2, Sdprintf("Sweeping frozen bar\n"));
     sweep_global_mark(saved_bar_at PASS_LD);
   }
+  LD->gc.stats.phases.sweep = gc_phase_time(&LD->gc.stats PASS_LD);
   DEBUG(MSG_GC_PROGRESS, Sdprintf("Compacting global stack\n"));
   compact_global();
+  LD->gc.stats.phases.compact_global = gc_phase_time(&LD->gc.stats PASS_LD);
 
   unsweep_foreign(PASS_LD1);
   unsweep_stacks(state PASS_LD);
@@ -3489,6 +3572,7 @@ setStartOfVMI(vm_state *state)
 	  break;
 	case H_FUNCTOR:
 	case H_LIST:
+	case H_CODES:
 	  if ( state->adepth == 0 )
 	    state->argp0 = state->argp++;
 	  /*FALLTHROUGH*/
@@ -3642,6 +3726,89 @@ that calls PL_handle_signals() from time to   time  to enable interrupts
 and call GC.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+shrink_stacks_due() implements the  decay  policy   for  the  stacks. The
+stacks never shrink by  themselves,  which  implies   that  a  thread that
+once needed a large stack keeps  it   for  its  lifetime.  If  the Prolog
+flag stack_shrink_gcs is non-zero, we count the subsequent collections
+after which trimming would at  least  halve   one  of  the stacks. If this
+count reaches the flag value we ask   garbageCollect()  to shrink the
+stacks to the size they would have  for   the  data  that is still in
+use. Requiring multiple collections avoids  shrinking   a  stack that is
+needed again soon.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+oversized_stack(Stack s)
+{ return nextStackSize(s, GROW_TRIM)*2 <= (size_t)sizeStackP(s);
+}
+
+/* trimOversizedStacks() shrinks the stacks of an idle engine if one of
+   them is at least twice as large as needed.
+*/
+
+void
+trimOversizedStacks(ARG1_LD)
+{ if ( oversized_stack((Stack)&LD->stacks.global) ||
+       oversized_stack((Stack)&LD->stacks.local) ||
+       oversized_stack((Stack)&LD->stacks.trail) )
+    trimStacks(TRUE PASS_LD);
+}
+
+static int
+shrink_stacks_due(ARG1_LD)
+{ unsigned int n = LD->gc.shrink_gcs;
+
+  if ( n == 0 )
+    return FALSE;
+
+  if ( oversized_stack((Stack)&LD->stacks.global) ||
+       oversized_stack((Stack)&LD->stacks.local) ||
+       oversized_stack((Stack)&LD->stacks.trail) )
+  { if ( ++LD->gc.oversized_gcs >= n )
+    { DEBUG(MSG_GC_SCHEDULE,
+	    Sdprintf("Shrinking stacks after %d GCs\n", n));
+      LD->gc.oversized_gcs = 0;
+      return TRUE;
+    }
+  } else
+  { LD->gc.oversized_gcs = 0;
+  }
+
+  return FALSE;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+over_pause_budget() implements the pause-bounded   GC  policy, which is
+enabled by setting the Prolog  flag   gc_pause_budget  to  the desired
+maximum pause in seconds. The duration  of   a  collection is roughly
+proportional to the  amount  of  stack   in  use,  so  the  budget is
+translated into a stack size  using  the   speed  at  which  previous
+collections processed the stacks. If we  exceed   this  size, we ask for
+a collection, rather than expanding the stacks  or waiting for the usual
+factor to be reached. We do require that   at least half of the data
+that survived the last collection  was   allocated  since, such that a
+thread with more live data than the budget  allows for does not spend
+all its time in GC.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+over_pause_budget(size_t used, size_t gced_size, size_t low ARG_LD)
+{ double budget = LD->gc.pause_budget;
+  double rate = LD->gc.stats.rate;
+
+  if ( budget > 0.0 && rate > 0.0 )
+  { size_t max_used = (size_t)(budget * rate);
+
+    return ( used > max_used &&
+	     used > gced_size + gced_size/2 + low );
+  }
+
+  return FALSE;
+}
+
+
 int
 considerGarbageCollect(Stack s)
 { GET_LD
@@ -3682,6 +3849,12 @@ considerGarbageCollect(Stack s)
 		Sdprintf("GC: request for %s on low space "
 			 "(used=%zd, limit=%zd, gced_size=%zd)\n",
 			 s->name, used, limit, s->gced_size));
+	} else if ( s == (Stack)&LD->stacks.global &&
+		    over_pause_budget(used, s->gced_size, low PASS_LD) )
+	{ DEBUG(MSG_GC_SCHEDULE,
+		Sdprintf("GC: request for %s on pause budget "
+			 "(used=%zd, gced_size=%zd)\n",
+			 s->name, used, s->gced_size));
 	} else
 	  return FALSE;
 
@@ -3721,6 +3894,76 @@ call_tune_gc_hook(void)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+GC event tracing. If a closure is registered  on the `gc` channel using
+prolog_listen/2, garbageCollect() raises   SIG_GC_EVENT  and the closure
+is called with a dict describing the   last  collection  as soon as the
+thread is back in a safe state.  We   cannot  call  Prolog from  inside
+garbageCollect() as that may run with (nearly) exhausted stacks.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static atom_t
+gc_reason_name(gc_reason_t reason)
+{ if ( (reason & GC_USER) )
+    return ATOM_user;
+  if ( (reason & GC_EXCEPTION) )
+    return ATOM_exception;
+  if ( (reason & GC_GLOBAL_OVERFLOW) )
+    return ATOM_global_overflow;
+  if ( (reason & GC_TRAIL_OVERFLOW) )
+    return ATOM_trail_overflow;
+  if ( (reason & GC_GLOBAL_REQUEST) )
+    return ATOM_global_request;
+  if ( (reason & GC_TRAIL_REQUEST) )
+    return ATOM_trail_request;
+
+  return ATOM_unknown;
+}
+
+#define GC_EVENT_KEYS 13
+
+int
+put_gc_event(term_t t, gc_stats *stats ARG_LD)
+{ static const atom_t keys[GC_EVENT_KEYS] =
+  { ATOM_reason, ATOM_time, ATOM_mark, ATOM_compact_trail,
+    ATOM_sweep, ATOM_compact_global, ATOM_global_before,
+    ATOM_global_after, ATOM_trail_before, ATOM_trail_after,
+    ATOM_local, ATOM_local_marked, ATOM_collections
+  };
+  gc_stat *last = last_gc_stats(stats);
+  gc_phases *ph = &stats->phases;
+  term_t av;
+
+  if ( !(av = PL_new_term_refs(GC_EVENT_KEYS)) )
+    return FALSE;
+
+  if ( PL_put_atom(av+0, gc_reason_name(last->reason)) &&
+       PL_put_float(av+1, last->gc_time) &&
+       PL_put_float(av+2, ph->mark) &&
+       PL_put_float(av+3, ph->compact_trail) &&
+       PL_put_float(av+4, ph->sweep) &&
+       PL_put_float(av+5, ph->compact_global) &&
+       PL_put_int64(av+6, last->global_before) &&
+       PL_put_int64(av+7, last->global_after) &&
+       PL_put_int64(av+8, last->trail_before) &&
+       PL_put_int64(av+9, last->trail_after) &&
+       PL_put_int64(av+10, last->local) &&
+       PL_put_int64(av+11, ph->marked_local) &&
+       PL_put_int64(av+12, stats->totals.collections) )
+    return PL_put_dict(t, ATOM_gc, GC_EVENT_KEYS, keys, av);
+
+  return FALSE;
+}
+
+
+void
+call_gc_event_hook(void)
+{ GET_LD
+
+  PL_call_event_hook(PLEV_GC, &LD->gc.stats);
+}
+
+
 #if O_DEBUG || defined(O_MAINTENANCE)
 #define INTBITS (sizeof(int)*8)
 #define REGISTER_STARTS 0x2
@@ -4123,7 +4366,12 @@ enterGC(ARG1_LD)
 {
 #ifdef O_PLMT
   if ( !LD->gc.active )
-    simpleMutexLock(&LD->thread.scan_lock);
+  { if ( !simpleMutexTryLock(&LD->thread.scan_lock) )
+    { LD->thread.scan_waiting = TRUE;	/* ask AGC to yield */
+      simpleMutexLock(&LD->thread.scan_lock);
+      LD->thread.scan_waiting = FALSE;
+    }
+  }
   LD->gc.active++;
 #endif
 }
@@ -4300,10 +4548,16 @@ garbageCollect(gc_reason_t reason)
   save_grefs(PASS_LD1);
   DEBUG(CHK_SECURE, check_foreign());
   tag_trail(PASS_LD1);
+  (void)gc_phase_time(&LD->gc.stats PASS_LD);
+  mark_large_gvars(PASS_LD1);
   mark_phase(&state);
+  sweepLargeIndirects(PASS_LD1);
+  LD->gc.stats.phases.mark = gc_phase_time(&LD->gc.stats PASS_LD);
+  LD->gc.stats.phases.marked_local = local_marked;
 
   DEBUG(MSG_GC_PROGRESS, Sdprintf("Compacting trail\n"));
   compact_trail();
+  LD->gc.stats.phases.compact_trail = gc_phase_time(&LD->gc.stats PASS_LD);
   collect_phase(&state, saved_bar_at);
   restore_grefs(PASS_LD1);
   untag_trail(PASS_LD1);
@@ -4345,6 +4599,8 @@ garbageCollect(gc_reason_t reason)
 
   preShiftLTop = consTermRef(lTop);		/* see (*) above */
   lTop = safeLTop;
+  if ( shrink_stacks_due(PASS_LD1) )
+    LD->trim_stack_requested = TRUE;
   trimStacks(LD->trim_stack_requested PASS_LD);
   lTop = (LocalFrame)valTermRef(preShiftLTop);
 
@@ -4992,6 +5248,88 @@ nextStackSize(Stack s, size_t minfree)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Resize stacks for which we reserved the  address space (see allocStacks()
+in pl-setup.c). If the new sizes fit the reservation we simply commit or
+release pages: the stacks do not move and there is nothing to relocate.
+Returns FALSE if a stack does not fit the reservation, which happens if
+the stack_limit was raised after the stacks were created.  In that case
+unreserve_stacks() moves the stacks to normally allocated memory, after
+which we use the normal realloc() based shifter.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+resize_reserved_stacks(size_t *lsize, size_t *gsize, size_t *tsize,
+		       Stack *fatal ARG_LD)
+{ stack_reservation *r = &LD->stacks.reserve;
+  Word gb = gBase;			/* gBase is decremented by caller */
+
+  if ( *lsize > r->reserved || *gsize > r->reserved || *tsize > r->reserved )
+    return FALSE;
+
+  if ( *tsize != r->trail )
+  { if ( stack_commit(tBase, r->trail, *tsize) )
+    { r->trail = *tsize;
+      LD->shift_status.trail_shifts++;
+    } else
+    { *fatal = (Stack)&LD->stacks.trail;
+      *tsize = sizeStack(trail);
+    }
+  }
+  if ( *gsize != r->global )
+  { if ( stack_commit(gb, r->global, *gsize) )
+    { r->global = *gsize;
+      LD->shift_status.global_shifts++;
+    } else
+    { *fatal = (Stack)&LD->stacks.global;
+      *gsize = sizeStack(global);
+    }
+  }
+  if ( *lsize != r->local )
+  { if ( stack_commit(lBase, r->local, *lsize) )
+    { r->local = *lsize;
+      LD->shift_status.local_shifts++;
+    } else
+    { *fatal = (Stack)&LD->stacks.local;
+      *lsize = sizeStack(local);
+    }
+  }
+
+  return TRUE;
+}
+
+
+static int
+unreserve_stacks(LocalFrame *lbp, Word *gbp, TrailEntry *tbp ARG_LD)
+{ stack_reservation *r = &LD->stacks.reserve;
+  size_t ogsize = sizeStack(global);
+  size_t olsize = sizeStack(local);
+  size_t otsize = sizeStack(trail);
+  Word gb;
+  TrailEntry tb;
+
+  if ( !(gb = stack_malloc(ogsize + olsize)) )
+    return FALSE;
+  if ( !(tb = stack_malloc(otsize)) )
+  { stack_free(gb);
+    return FALSE;
+  }
+
+  memcpy(gb, gBase, ogsize);
+  memcpy(addPointer(gb, ogsize), lBase, olsize);
+  memcpy(tb, tBase, otsize);
+  stack_unreserve(gBase, 2*r->reserved, r->global+r->local);
+  stack_unreserve(tBase, r->reserved, r->trail);
+  r->reserved = 0;
+
+  *gbp = gb;
+  *lbp = addPointer(gb, ogsize);
+  *tbp = tb;
+
+  return TRUE;
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Stack shifter entry point. The arguments l, g and t request expansion of
 the local, global and trail-stacks. Non-0 versions   ask the stack to be
@@ -5131,6 +5469,18 @@ grow_stacks(size_t l, size_t g, size_t t ARG_LD)
 	    gBase--;
 	  });
 
+    if ( LD->stacks.reserve.reserved )
+    { if ( !resize_reserved_stacks(&lsize, &gsize, &tsize, &fatal PASS_LD) &&
+	   !unreserve_stacks(&lb, &gb, &tb PASS_LD) )
+      { fatal = (Stack)&LD->stacks.global;
+	lsize = sizeStack(local);
+	gsize = sizeStack(global);
+	tsize = sizeStack(trail);
+      }
+      if ( LD->stacks.reserve.reserved || fatal )
+	t = g = l = FALSE;		/* done; nothing to realloc */
+    }
+
     if ( t )
     { void *nw;
 
@@ -5406,11 +5756,35 @@ checkStacks(), a simple routine for  checking stack-consistency that has
 to walk along all reachable data as well.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-static void
-markAtomsOnGlobalStack(PL_local_data_t *ld)
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+If AGC scans the stacks of another  thread it holds the scan_lock of that
+thread. If this thread wants to run   GC or shift its stacks, it blocks
+in enterGC() until the scan is completed, which  may take long for large
+stacks. To bound this pause, the scan checks ld->thread.scan_waiting every
+AGC_SCAN_CHUNK cells. If  set,  we   release  the  lock,  wait  for the
+thread to take it, and restart  the   scan  of this thread after its GC
+completed. Restarting is safe: atoms marked   during  the aborted scan
+merely stay marked. After AGC_MAX_YIELDS  restarts   we  complete  the
+scan without yielding to guarantee progress.
+
+Note that the caller (forThreadLocalDataUnsuspended()) holds the lock.
+If ld is the calling thread, scan_waiting is never set.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define AGC_SCAN_CHUNK 65536		/* cells between yield checks */
+#define AGC_MAX_YIELDS 4		/* max restarts per thread */
+
+#ifdef O_PLMT
+#define AGC_MUST_YIELD(ld, yield) ((yield) && (ld)->thread.scan_waiting)
+#else
+#define AGC_MUST_YIELD(ld, yield) FALSE
+#endif
+
+static int
+markAtomsOnGlobalStack(PL_local_data_t *ld, int yield)
 { Word gbase = ld->stacks.global.base;
   Word gtop  = ld->stacks.global.top;
-  Word current;
+  Word current, check = gbase+AGC_SCAN_CHUNK;
   word w;
 
 #ifdef O_DEBUG_ATOMGC
@@ -5424,26 +5798,51 @@ markAtomsOnGlobalStack(PL_local_data_t *ld)
 
     if ( isAtom(w) )
       markAtom(w);
+    if ( unlikely(current >= check) )
+    { if ( AGC_MUST_YIELD(ld, yield) )
+	return FALSE;
+      check = current+AGC_SCAN_CHUNK;
+    }
   }
+
+  return TRUE;
 }
 
-static void
-markAtomsOnLocalStack(PL_local_data_t *ld)
+static int
+markAtomsOnLocalStack(PL_local_data_t *ld, int yield)
 { Word lbase = (Word)ld->stacks.local.base;
   Word ltop  = (Word)ld->stacks.local.top;
   Word lmax  = (Word)ld->stacks.local.max;
   Word lend  = ltop+LOCAL_MARGIN < lmax ? ltop+LOCAL_MARGIN : lmax;
-  Word current;
+  Word current, check = lbase+AGC_SCAN_CHUNK;
 
   for(current = lbase; current < lend; current++ )
   { word w = *current;
 
     if ( isAtom(w) )
       markAtom(w);
+    if ( unlikely(current >= check) )
+    { if ( AGC_MUST_YIELD(ld, yield) )
+	return FALSE;
+      check = current+AGC_SCAN_CHUNK;
+    }
   }
+
+  return TRUE;
 }
 
 
+#ifdef O_PLMT
+static void
+yieldScanLock(PL_local_data_t *ld)
+{ simpleMutexUnlock(&ld->thread.scan_lock);
+  while ( ld->thread.scan_waiting )
+    Pause(0.0001);
+  simpleMutexLock(&ld->thread.scan_lock);
+}
+#endif
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 markAtomsOnStacks()  is  called   asynchronously    (Unix)   or  between
 SuspendThread()/ResumeThread() from another thread in  Windows. Its task
@@ -5456,7 +5855,7 @@ time).
 
 void
 markAtomsOnStacks(PL_local_data_t *ld)
-{ assert(!ld->gc.status.active);
+{ int yields = 0;
 
   if ( !ld->magic )
     return;				/* avoid AGC on finished threads */
@@ -5470,9 +5869,23 @@ markAtomsOnStacks(PL_local_data_t *ld)
 	if ( atomLogFd )
 	  Sfprintf(atomLogFd, "Mark atoms.unregistering\n"));
 #endif
-  markAtom(ld->atoms.unregistering);	/* see PL_unregister_atom() */
-  markAtomsOnLocalStack(ld);
-  markAtomsOnGlobalStack(ld);
+
+  for(;;)
+  { int yield = (yields < AGC_MAX_YIELDS);
+
+    assert(!ld->gc.status.active);
+    markAtom(ld->atoms.unregistering);	/* see PL_unregister_atom() */
+    if ( markAtomsOnLocalStack(ld, yield) &&
+	 markAtomsOnGlobalStack(ld, yield) )
+      break;
+#ifdef O_PLMT
+    yieldScanLock(ld);
+    GD->atoms.gc_yields++;
+#endif
+    yields++;
+    if ( !ld->magic )
+      return;
+  }
   markAtomsFindall(ld);
 #ifdef O_PLMT
   markAtomsThreadMessageQueue(ld);
@@ -5501,16 +5914,94 @@ is_pointer_like(void *ptr)
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Threads that are blocked waiting for a message cannot change their stacks.
+A thread increments ld->clauses.quiescent when it starts and when it stops
+waiting in dispatch_cond_wait(), so the value is odd while it is blocked
+and identifies the wait.  When scanning a  blocked  thread we cache the
+(predicate, generation) pairs of all its frames and accessed predicates.
+As long as the thread remains in the same  wait, subsequent CGC runs use
+these pairs instead of scanning its local stack.  With many idle threads,
+marking thus becomes proportional to the number of threads rather than to
+the size of their stacks.  The cache is not used if the thread has more
+than CGC_CACHE_MAX distinct frames.
+
+The cache is only accessed by CGC, which is not re-entrant, and freed by
+freeCGCCache() with the scan lock held.
+
 (*) Note that unlike for markAtomsOnLocalStack(), we do not need to look
 behind the official top of the stack   as frames are never written above
 lTop. If anything is added, it will  be   at  a  newer generation, so we
 don't care.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+#define CGC_CACHE_MAX 4096
+
+static void
+markPredicateAccess(Definition def, gen_t gen)
+{ GET_LD
+  DirtyDefInfo ddi;
+
+  if ( (ddi=lookupHTable(GD->procedures.dirty, def)) )
+    ddi_add_access_gen(ddi, gen);
+}
+
+static int
+cacheMark(PL_local_data_t *ld, Definition def, gen_t gen)
+{ definition_ref *m = ld->clauses.cgc_cache.marks;
+  size_t count = ld->clauses.cgc_cache.count;
+
+  if ( count > 0 &&
+       m[count-1].predicate == def && m[count-1].generation == gen )
+    return TRUE;			/* recursion */
+
+  if ( count == ld->clauses.cgc_cache.size )
+  { size_t size = count ? count*2 : 64;
+
+    if ( size > CGC_CACHE_MAX ||
+	 !(m = PL_realloc(m, size*sizeof(*m))) )
+      return FALSE;
+    ld->clauses.cgc_cache.marks = m;
+    ld->clauses.cgc_cache.size  = size;
+  }
+
+  m[count].predicate  = def;
+  m[count].generation = gen;
+  ld->clauses.cgc_cache.count = count+1;
+
+  return TRUE;
+}
+
+void
+freeCGCCache(PL_local_data_t *ld)
+{ if ( ld->clauses.cgc_cache.marks )
+  { PL_free(ld->clauses.cgc_cache.marks);
+    ld->clauses.cgc_cache.marks = NULL;
+    ld->clauses.cgc_cache.size  = 0;
+    ld->clauses.cgc_cache.count = 0;
+  }
+  ld->clauses.cgc_cache.epoch = 0;
+}
+
 void
 markPredicatesInEnvironments(PL_local_data_t *ld)
-{ GET_LD
-  Word lbase, lend, current;
+{ Word lbase, lend, current;
+  int64_t quiescent = ld->clauses.quiescent;
+  int cache = (quiescent&1);
+
+  if ( cache && ld->clauses.cgc_cache.epoch == quiescent )
+  { size_t i;
+
+    for(i=0; i<ld->clauses.cgc_cache.count; i++)
+    { definition_ref *m = &ld->clauses.cgc_cache.marks[i];
+
+      markPredicateAccess(m->predicate, m->generation);
+    }
+    ld->clauses.erased_skipped = 0;
+    return;
+  }
+
+  ld->clauses.cgc_cache.epoch = 0;
+  ld->clauses.cgc_cache.count = 0;
 
   lbase = (Word)ld->stacks.local.base;
   lend  = (Word)ld->stacks.local.top;		/* see (*) */
@@ -5518,20 +6009,36 @@ markPredicatesInEnvironments(PL_local_data_t *ld)
   { LocalFrame fr = (LocalFrame)current;
 
     if ( isFrame(fr) )
-    { DirtyDefInfo ddi;
-      Definition def = fr->predicate;
+    { Definition def = fr->predicate;
 
-      if ( is_pointer_like(def) &&
-	   (ddi=lookupHTable(GD->procedures.dirty, def)) )
+      if ( is_pointer_like(def) )
       { gen_t gen = generationFrame(fr);
 
-	ddi_add_access_gen(ddi, gen);
+	markPredicateAccess(def, gen);
+	if ( cache )
+	  cache = cacheMark(ld, def, gen);
       }
     }
   }
 
   ld->clauses.erased_skipped = 0;
   markAccessedPredicates(ld);
+
+  if ( cache )
+  { definition_refs *refs = &ld->predicate_references;
+    size_t i;
+
+    for(i=1; cache && i<=refs->top; i++)
+    { definition_ref *dref = &refs->blocks[MSB(i)][i];
+
+      if ( is_pointer_like(dref->predicate) )
+	cache = cacheMark(ld, dref->predicate, dref->generation);
+    }
+
+    MEMORY_BARRIER();
+    if ( cache && ld->clauses.quiescent == quiescent )
+      ld->clauses.cgc_cache.epoch = quiescent;
+  }
 }
 
 #endif /*O_CLAUSEGC*/
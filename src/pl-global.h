@@ -76,6 +76,7 @@ typedef struct
     code staticp[3];			/* S_STATIC */
     code wrapper[3];			/* S_WRAP */
     code trie_gen[3];			/* S_TRIE_GEN */
+    code lazy[3];			/* S_LAZY */
   } supervisors;
 } PL_code_data_t;
 
@@ -166,6 +167,18 @@ struct PL_global_data
 #ifdef O_PROFILE
   struct
   { struct PL_local_data *thread;	/* Thread being profiled */
+    struct
+    { struct sample_table *table;	/* Samples of terminated threads */
+      int	threads;		/* #threads being sampled */
+      int	all;			/* Sample all threads */
+      int	interval;		/* Sample interval (usec) */
+      int	running;		/* Sampler thread is running */
+    } sample;
+    struct
+    { struct sample_table *global;	/* Global stack allocations */
+      struct sample_table *heap;	/* Heap allocations */
+      size_t	interval;		/* Bytes between samples */
+    } alloc;
   } profile;
 #endif
 
@@ -179,14 +192,15 @@ struct PL_global_data
   } tables;
 
 #if O_PLMT
+#define TABLE_WAIT_CVARS 16		/* Must be power of 2 */
   struct				/* Shared table data */
   { struct trie *variant_table;		/* Variant --> table */
     alloc_pool *node_pool;		/* Node allocation pool for tries */
     counting_mutex  mutex;		/* Sync completion */
 #ifdef __WINDOWS__
-    CONDITION_VARIABLE cvar;
+    CONDITION_VARIABLE cvar[TABLE_WAIT_CVARS];
 #else
-    pthread_cond_t cvar;
+    pthread_cond_t cvar[TABLE_WAIT_CVARS]; /* Wait for completion */
 #endif
     struct trie_array *waiting;		/* thread --> trie we are waiting for */
   } tabling;
@@ -194,8 +208,13 @@ struct PL_global_data
 
   struct
   { Table	record_lists;		/* Available record lists */
+    Table	shared;			/* hash --> shared ground Record */
+    simpleMutex	shared_mutex;		/* Guards shared */
+    int		share;			/* Flag record_sharing */
   } recorded_db;
 
+  arena_depot	arena;			/* Shared pool for arena_alloc() */
+
   struct
   { ArithF     *functions;		/* index --> function */
     size_t	functions_allocated;	/* Size of above array */
@@ -204,21 +223,22 @@ struct PL_global_data
   struct
   { size_t	highest;		/* Highest atom index */
     atom_array	array;
-    AtomTable	table;			/* hash-table */
+    AtomTable	tables[ATOM_TABLE_SHARDS]; /* sharded hash-tables */
     int		lookups;		/* # atom lookups */
     int		cmps;			/* # string compares for lookup */
     int		initialised;		/* atoms have been initialised */
 #ifdef O_ATOMGC
     int		gc;			/* # atom garbage collections */
     int		gc_active;		/* Atom-GC is in progress */
-    int		rehashing;		/* Atom-rehash in progress */
     size_t	builtin;		/* Locked atoms (atom-gc) */
     size_t	no_hole_before;		/* You won't find a hole before here */
     size_t	margin;			/* # atoms to grow before collect */
+    size_t	trimmed;		/* text space freed at last trim */
     size_t	non_garbage;		/* # atoms for after last AGC */
     int64_t	collected;		/* # collected atoms */
     size_t	unregistered;		/* # candidate GC atoms */
     double	gc_time;		/* Time spent on atom-gc */
+    int64_t	gc_yields;		/* # stack scans restarted for GC */
     PL_agc_hook_t gc_hook;		/* Current hook */
 #endif
     atom_t     *for_code[256];		/* code --> one-char-atom */
@@ -252,6 +272,7 @@ struct PL_global_data
 
   struct				/* pl-format.c */
   { Table	predicates;
+    Table	compiled;		/* atom --> compiled format */
   } format;
 
   struct
@@ -265,8 +286,7 @@ struct PL_global_data
   struct
   { size_t	highest;		/* Next index to handout */
     functor_array array;		/* index --> functor */
-    FunctorTable table;			/* hash-table */
-    int		 rehashing;		/* Table is being rehashed */
+    FunctorTable tables[FUNCTOR_TABLE_SHARDS]; /* sharded hash-tables */
   } functors;
 
   struct
@@ -283,6 +303,7 @@ struct PL_global_data
       struct event_list *onthreadexit;	/* thread exit hook */
 #endif
       struct event_list *onuntable;	/* Untable after reload */
+      struct event_list *ongc;		/* Stack GC completed */
     } hook;
   } event;
 
@@ -340,6 +361,8 @@ struct PL_global_data
 #ifdef O_CLAUSEGC
     Table	dirty;			/* Table of dirty procedures */
 #endif
+    unsigned int resolve_epoch;		/* Invalidates LD->resolve */
+    unsigned int resolve_functor_epoch[RESOLVE_EPOCH_SLOTS];
   } procedures;
 
   struct
@@ -399,6 +422,8 @@ struct PL_global_data
     struct
     { pthread_mutex_t	mutex;
       pthread_cond_t	cond;
+      unsigned int	workers;	/* Max threads to build an index */
+      size_t		background;	/* Min #clauses to build in gc thread */
     } index;
   } thread;
 #endif /*O_PLMT*/
@@ -430,6 +455,11 @@ struct PL_local_data
 #ifdef O_GVAR
   Word		frozen_bar;		/* Frozen part of the global stack */
 #endif
+  struct
+  { size_t	scanned;		/* Trail entries known to be tidy */
+    size_t	choice;			/* lBase offset of choice used */
+    int64_t	reclaimed;		/* Bytes removed by tidyTrail() */
+  } trail_tidy;
   Code		fast_condition;		/* Fast condition support */
   pl_stacks_t   stacks;			/* Prolog runtime stacks */
   uintptr_t	bases[STG_MASK+1];	/* area base addresses */
@@ -446,6 +476,7 @@ struct PL_local_data
   int		in_print_message;	/* Inside printMessage() */
   gen_t		gen_reload;		/* reload generation */
   void *	glob_info;		/* pl-glob.c */
+  void *	glob_cache;		/* pl-glob.c: compiled patterns */
   IOENC		encoding;		/* default I/O encoding */
   struct PL_local_data *next_free;	/* see maybe_free_local_data() */
 
@@ -453,6 +484,9 @@ struct PL_local_data
   { int		pending[2];		/* PL_raise() pending signals */
     int		current;		/* currently processing signal */
     int		is_sync;		/* current signal is synchronous */
+    void      (*wakeup)(void *closure);	/* PL_set_signal_wakeup() */
+    void *	wakeup_closure;		/* argument for wakeup */
+    int		wakeup_running;		/* # threads running wakeup */
   } signal;
 
   struct
@@ -460,6 +494,14 @@ struct PL_local_data
     jmp_buf	context;		/* context of longjmp() */
   } pipe;
 
+  struct
+  { gen_t	generation;		/* Private generation (pl-transaction.c) */
+    struct tr_update *updates;		/* Buffered database updates */
+    size_t	count;			/* # buffered updates */
+    size_t	size;			/* # allocated updates */
+    int		nesting;		/* Nesting level */
+  } transaction;
+
   struct
   { char       *getstr_buffer;		/* getString() buffer */
     size_t	getstr_buffer_size;	/* size of getstr_buffer */
@@ -475,6 +517,11 @@ struct PL_local_data
 
   source_location read_source;		/* file, line, char of last term */
 
+  struct
+  { unsigned int *buckets;		/* cached reader variable hash table */
+    unsigned int  allocated;		/* #buckets in table */
+  } read_vars;
+
   struct
   { term_t	term;			/* exception term */
     term_t	bin;			/* temporary handle for exception */
@@ -522,6 +569,10 @@ struct PL_local_data
     double	last_walltime;		/* Last Wall time (m-secs since start) */
     double	user_cputime;		/* User saved CPU time */
     double	system_cputime;		/* Kernel saved CPU time */
+    int64_t	heap_allocated;		/* Bytes from allocHeap()/PL_malloc() */
+    double	mutex_wait_time;	/* Time blocked in mutex_lock/1 */
+    double	queue_wait_time;	/* Time blocked on message queues */
+    double	agc_time;		/* Time in AGC run by this thread */
   } statistics;
 
 #ifdef O_GMP
@@ -548,9 +599,21 @@ struct PL_local_data
     double	time_at_last_tick;	/* Time at last statistics tick */
     double	time_at_start;		/* Time at last start */
     double	time;			/* recorded CPU time */
+    struct
+    { int	active;			/* Allocation profiling */
+      size_t	global_mark;		/* Global stack usage at last check */
+      int64_t	heap_mark;		/* heap_allocated at last check */
+      size_t	global;			/* Unsampled global allocation */
+      int64_t	heap;			/* Unsampled heap allocation */
+    } alloc;
   } profile;
 #endif /* O_PROFILE */
 
+  struct
+  { call_timer	stack[CALL_TIMER_DEPTH]; /* Running timed calls */
+    int		top;			/* # entries in stack */
+  } call_timer;
+
   struct
   { Module	typein;			/* module for type in goals */
     Module	source;			/* module we are reading clauses in */
@@ -559,6 +622,7 @@ struct PL_local_data
   struct
   { intptr_t	generator;		/* See PL_atom_generator() */
     atom_t	unregistering;		/* See PL_unregister_atom() */
+    Atom	cache[ATOM_CACHE_SIZE];	/* See lookupBlob() */
   } atoms;
 
   struct
@@ -599,6 +663,15 @@ struct PL_local_data
     } f;
   } arith;
 
+#define CONT_CLREF_CACHE_SIZE 16		/* must be power of 2 */
+
+  struct
+  { struct
+    { Clause	clause;			/* Clause captured */
+      atom_t	cref;			/* Registered clause blob */
+    } clrefs[CONT_CLREF_CACHE_SIZE];	/* See put_environment() */
+  } continuation;
+
 #if O_CYCLIC
   struct
   { segstack lstack;			/* Stack for cycle-links */
@@ -614,6 +687,7 @@ struct PL_local_data
     int in_answer_completion;		/* Running answer completion */
     term_t delay_list;			/* Global delay list */
     term_t idg_current;			/* Current node in IDG (trie symbol) */
+    uint64_t access_tick;		/* LRU clock for table eviction */
     struct
     { atom_t max_table_subgoal_size_action;
       size_t max_table_subgoal_size;
@@ -624,6 +698,8 @@ struct PL_local_data
     } restraint;
   } tabling;
 
+  arena_cache	arena;			/* Free chunks for arena_alloc() */
+
   struct
   {
 #ifdef __BEOS__
@@ -707,6 +783,8 @@ struct PL_local_data
     struct _thread_sig   *sig_tail;	/* Tail of signal queue */
     DefinitionChain local_definitions;	/* P_THREAD_LOCAL predicates */
     simpleMutex scan_lock;		/* Hold for asynchronous scans */
+    volatile int scan_waiting;		/* GC is waiting for scan_lock */
+    struct pl_read_lock *read_locks;	/* Read locks held (with_read_lock/2) */
   } thread;
 #endif
 
@@ -719,8 +797,30 @@ struct PL_local_data
   struct
   { size_t	erased_skipped;		/* # erased clauses skipped */
     int64_t	cgc_inferences;		/* Inferences at last cgc consider */
+    int64_t	quiescent;		/* Odd while blocked (pl-gc.c) */
+    struct
+    { int64_t	epoch;			/* quiescent when cached */
+      size_t	count;			/* # cached marks */
+      size_t	size;			/* Allocated marks */
+      definition_ref *marks;		/* Cached (predicate,generation) */
+    } cgc_cache;
   } clauses;
 
+  struct
+  { struct resolve_cache_entry
+    { functor_t	functor;		/* Resolved functor */
+      Module	module;			/* Resolved in this module */
+      Procedure	procedure;		/* Found procedure */
+      unsigned int epoch;		/* GD->procedures.resolve_epoch */
+      unsigned int functor_epoch;	/* Epoch for the functor */
+    } cache[RESOLVE_CACHE_SIZE];	/* See resolveProcedure() */
+    struct module_cache_entry
+    { atom_t	name;			/* Module name */
+      Module	module;			/* The module */
+      unsigned int epoch;		/* GD->procedures.resolve_epoch */
+    } modules[MODULE_CACHE_SIZE];	/* See lookupModule() */
+  } resolve;
+
   struct
   { DefinitionChain nesting;		/* Nesting chain in the autoloader */
     Definition	loop;			/* We are looping on this def */
@@ -747,7 +847,18 @@ struct PL_local_data
     int			marked_attvars;	/* do not GC attvars */
 #endif
     int active;				/* GC is running in this thread */
+    double pause_budget;		/* Target max pause (sec, 0: none) */
+    unsigned int shrink_gcs;		/* Shrink after N oversized GCs */
+    unsigned int oversized_gcs;		/* # subsequent oversized GCs */
     gc_stats stats;			/* GC performance history */
+    struct
+    { struct large_indirect *objects;	/* Off-stack indirects (pl-alloc.c) */
+      size_t	size;			/* Bytes in objects */
+      size_t	allocated;		/* Bytes allocated since last GC */
+      struct large_indirect **interned;	/* Interned strings hash table */
+      size_t	interned_buckets;	/* # buckets (power of 2) */
+      size_t	interned_count;		/* # interned strings */
+    } large;
 
 					/* These must be at the end to be */
 					/* able to define O_DEBUG in only */
@@ -254,16 +254,20 @@ globalMPZ(Word at, mpz_t mpz, int flags ARG_LD)
       return 0;
     }
 
-    if ( !hasGlobalSpace(wsz+3) )
-    { int rc = ensureGlobalSpace(wsz+3, flags);
+    if ( (p = allocLargeIndirect(wsz+3 PASS_LD)) )
+    { *at = consPtr(p, TAG_INTEGER|STG_LARGE);
+    } else
+    { if ( !hasGlobalSpace(wsz+3) )
+      { int rc = ensureGlobalSpace(wsz+3, flags);
 
-      if ( rc != TRUE )
-	return rc;
-    }
-    p = gTop;
-    gTop += wsz+3;
+	if ( rc != TRUE )
+	  return rc;
+      }
+      p = gTop;
+      gTop += wsz+3;
 
-    *at = consPtr(p, TAG_INTEGER|STG_GLOBAL);
+      *at = consPtr(p, TAG_INTEGER|STG_GLOBAL);
+    }
 
     *p++     = m;
     p[wsz]   = 0L;			/* pad out */
@@ -16,4 +16,58 @@ COMMON(unsigned int)
 	MurmurHashAligned2(const void *key, size_t len, unsigned int seed);
 COMMON(unsigned int) MurmurHashIntptr(intptr_t v, unsigned int seed);
 
+/* MurmurHashInt32() and MurmurHashInt64() are equivalent to calling
+   MurmurHashAligned2() on the native representation of a 32 or 64
+   bit integer, but avoid the function call and alignment handling
+   for the very common case of hashing a single integer.
+*/
+
+#if WORDS_BIGENDIAN
+
+static inline unsigned int
+MurmurHashInt32(unsigned int k, unsigned int seed)
+{ return MurmurHashAligned2(&k, sizeof(k), seed);
+}
+
+static inline unsigned int
+MurmurHashInt64(uint64_t v, unsigned int seed)
+{ return MurmurHashAligned2(&v, sizeof(v), seed);
+}
+
+#else /*WORDS_BIGENDIAN*/
+
+#define MURMUR_M 0x5bd1e995
+#define MURMUR_MIX(h,k) \
+	{ k *= MURMUR_M; k ^= k >> 24; k *= MURMUR_M; h *= MURMUR_M; h ^= k; }
+
+static inline unsigned int
+MurmurHashFinish(unsigned int h)
+{ h ^= h >> 13;
+  h *= MURMUR_M;
+  h ^= h >> 15;
+
+  return h;
+}
+
+static inline unsigned int
+MurmurHashInt32(unsigned int k, unsigned int seed)
+{ unsigned int h = seed ^ 4;
+
+  MURMUR_MIX(h, k);
+  return MurmurHashFinish(h);
+}
+
+static inline unsigned int
+MurmurHashInt64(uint64_t v, unsigned int seed)
+{ unsigned int h = seed ^ 8;
+  unsigned int k1 = (unsigned int)v;
+  unsigned int k2 = (unsigned int)(v>>32);
+
+  MURMUR_MIX(h, k1);
+  MURMUR_MIX(h, k2);
+  return MurmurHashFinish(h);
+}
+
+#endif /*WORDS_BIGENDIAN*/
+
 #endif /*PL_HASH_H_INCLUDED*/
@@ -0,0 +1,757 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pl-incl.h"
+
+#undef LD
+#define LD LOCAL_LD
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Mutable hash maps. A hash map is a blob that  maps ground keys to terms.
+Both keys and values are  stored  as   records  (see  pl-rec.c) that are
+compiled using R_DUPLICATE, such that  a   reader  can keep a value alive
+while another thread replaces or deletes it.
+
+Keys are compared using equalRecords(),  which   compares  the  compiled
+data and thus implements ==/2 for   ground  terms. The underlying htable
+maps the hashRecord() value of the key to  a chain of entries that share
+this hash key.
+
+All modifications and lookups are  protected   by  the  map's mutex. The
+records are copied to the stacks   and  freed outside the mutex. Pairs
+are enumerated from a snapshot,  so  the   map  may  be modified during
+enumeration.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct hm_entry
+{ struct hm_entry *next;		/* Next with the same hash key */
+  Record	key;			/* The (ground) key */
+  Record	value;			/* The associated value */
+} hm_entry;
+
+typedef struct hash_map
+{ Table		table;			/* hash key --> hm_entry chain */
+  size_t	size;			/* # key-value pairs */
+  simpleMutex	mutex;			/* Serialize access */
+} hash_map;
+
+typedef struct hm_ref
+{ hash_map     *map;			/* represented map */
+} hm_ref;
+
+typedef struct hm_snapshot
+{ size_t	count;			/* # pairs */
+  size_t	index;			/* Enumeration index */
+  Record	records[];		/* key,value,key,value,... */
+} hm_snapshot;
+
+#define hm_key(r) ((void*)(((uintptr_t)hashRecord(r)>>1)|0x1))
+
+
+static void
+free_hm_entry(hm_entry *e)
+{ freeRecord(e->key);
+  freeRecord(e->value);
+  freeHeap(e, sizeof(*e));
+}
+
+
+static void
+free_hm_chain(void *name, void *value)
+{ hm_entry *e, *next;
+  (void)name;
+
+  for(e=value; e; e=next)
+  { next = e->next;
+    free_hm_entry(e);
+  }
+}
+
+
+		 /*******************************
+		 *	      SYMBOL		*
+		 *******************************/
+
+static int
+write_hash_map_ref(IOSTREAM *s, atom_t aref, int flags)
+{ hm_ref *ref = PL_blob_data(aref, NULL, NULL);
+  (void)flags;
+
+  Sfprintf(s, "<hash_map>(%p)", ref->map);
+  return TRUE;
+}
+
+
+static int
+release_hash_map_ref(atom_t aref)
+{ hm_ref *ref = PL_blob_data(aref, NULL, NULL);
+  hash_map *map;
+
+  if ( (map=ref->map) )
+  { destroyHTable(map->table);
+    simpleMutexDelete(&map->mutex);
+    freeHeap(map, sizeof(*map));
+  }
+
+  return TRUE;
+}
+
+
+static int
+save_hash_map(atom_t aref, IOSTREAM *fd)
+{ hm_ref *ref = PL_blob_data(aref, NULL, NULL);
+  (void)fd;
+
+  return PL_warning("Cannot save reference to <hash_map>(%p)", ref->map);
+}
+
+
+static atom_t
+load_hash_map(IOSTREAM *fd)
+{ (void)fd;
+
+  return PL_new_atom("<saved-hash_map-ref>");
+}
+
+
+static PL_blob_t hash_map_blob =
+{ PL_BLOB_MAGIC,
+  PL_BLOB_UNIQUE,
+  "hash_map",
+  release_hash_map_ref,
+  NULL,
+  write_hash_map_ref,
+  NULL,
+  save_hash_map,
+  load_hash_map
+};
+
+
+static int
+get_hash_map(term_t t, hash_map **mp)
+{ void *data;
+  PL_blob_t *type;
+
+  if ( PL_get_blob(t, &data, NULL, &type) && type == &hash_map_blob )
+  { hm_ref *ref = data;
+
+    *mp = ref->map;
+    return TRUE;
+  }
+
+  PL_type_error("hash_map", t);
+  return FALSE;
+}
+
+
+static int
+unify_hash_map(term_t t, hash_map *map)
+{ hm_ref ref;
+
+  ref.map = map;
+  return PL_unify_blob(t, &ref, sizeof(ref), &hash_map_blob);
+}
+
+
+static hash_map *
+new_hash_map(void)
+{ hash_map *map = allocHeapOrHalt(sizeof(*map));
+
+  memset(map, 0, sizeof(*map));
+  map->table = newHTable(16);
+  map->table->free_symbol = free_hm_chain;
+  simpleMutexInit(&map->mutex);
+
+  return map;
+}
+
+
+		 /*******************************
+		 *	   PRIMITIVES		*
+		 *******************************/
+
+static Record
+compile_key(term_t key ARG_LD)
+{ Record r;
+
+  if ( !PL_is_acyclic(key) )
+  { PL_type_error("acyclic_term", key);
+    return NULL;
+  }
+  if ( !PL_is_ground(key) )
+  { PL_instantiation_error(key);
+    return NULL;
+  }
+
+  if ( !(r=compileTermToHeap(key, R_DUPLICATE)) )
+    PL_no_memory();
+
+  return r;
+}
+
+
+static hm_entry *
+find_entry(hash_map *map, void *hkey, Record key ARG_LD)
+{ hm_entry *e;
+
+  for(e=lookupHTable(map->table, hkey); e; e=e->next)
+  { if ( equalRecords(e->key, key) )
+      return e;
+  }
+
+  return NULL;
+}
+
+
+/* put_hash_map() adds  or  replaces  Key   in  map.  The  records  are
+   handed over to the map.
+*/
+
+static void
+put_hash_map(hash_map *map, Record key, Record value ARG_LD)
+{ void *hkey = hm_key(key);
+  Record old;
+  hm_entry *e;
+
+  simpleMutexLock(&map->mutex);
+  if ( (e=find_entry(map, hkey, key PASS_LD)) )
+  { old = e->value;
+    e->value = value;
+  } else
+  { hm_entry *head = lookupHTable(map->table, hkey);
+
+    e = allocHeapOrHalt(sizeof(*e));
+    e->key   = key;
+    e->value = value;
+    if ( head )
+    { e->next = head->next;
+      head->next = e;
+    } else
+    { e->next = NULL;
+      addNewHTable(map->table, hkey, e);
+    }
+    map->size++;
+    old = key = NULL;
+  }
+  simpleMutexUnlock(&map->mutex);
+
+  if ( key )
+    freeRecord(key);
+  if ( old )
+    freeRecord(old);
+}
+
+
+static int
+put_hash_map_term(hash_map *map, term_t key, term_t value ARG_LD)
+{ Record k, v;
+
+  if ( !(k=compile_key(key PASS_LD)) )
+    return FALSE;
+  if ( !(v=compileTermToHeap(value, R_DUPLICATE)) )
+  { freeRecord(k);
+    return PL_no_memory();
+  }
+  put_hash_map(map, k, v PASS_LD);
+
+  return TRUE;
+}
+
+
+static int
+unify_record(term_t t, Record r ARG_LD)
+{ term_t copy = PL_new_term_ref();
+  int rc;
+
+  if ( (rc=copyRecordToGlobal(copy, r, ALLOW_GC PASS_LD)) < 0 )
+    return raiseStackOverflow(rc);
+
+  return PL_unify(t, copy);
+}
+
+
+static hm_snapshot *
+snapshot_hash_map(hash_map *map)
+{ hm_snapshot *snap;
+  size_t i = 0;
+
+  simpleMutexLock(&map->mutex);
+  snap = allocHeapOrHalt(sizeof(*snap) + map->size*2*sizeof(Record));
+  snap->count = map->size;
+  snap->index = 0;
+  for_table(map->table, n, v,
+	    { hm_entry *e;
+
+	      for(e=v; e; e=e->next)
+	      { ATOMIC_INC(&e->key->references);
+		ATOMIC_INC(&e->value->references);
+		snap->records[i++] = e->key;
+		snap->records[i++] = e->value;
+	      }
+	    });
+  simpleMutexUnlock(&map->mutex);
+  assert(i == snap->count*2);
+
+  return snap;
+}
+
+
+static void
+free_snapshot(hm_snapshot *snap)
+{ size_t i;
+
+  for(i=snap->index*2; i<snap->count*2; i++)
+    freeRecord(snap->records[i]);
+  freeHeap(snap, sizeof(*snap) + snap->count*2*sizeof(Record));
+}
+
+
+		 /*******************************
+		 *	 PROLOG BINDING		*
+		 *******************************/
+
+/** hash_map_create(-Map) is det.
+ *  hash_map_create(-Map, +Pairs) is det.
+ */
+
+static int
+create_hash_map(term_t t, term_t pairs ARG_LD)
+{ hash_map *map = new_hash_map();
+  int rc;
+
+  if ( pairs )
+  { term_t tail = PL_copy_term_ref(pairs);
+    term_t head = PL_new_term_ref();
+    term_t k    = PL_new_term_ref();
+    term_t v    = PL_new_term_ref();
+
+    while( PL_get_list(tail, head, tail) )
+    { if ( !PL_is_functor(head, FUNCTOR_minus2) )
+      { rc = PL_type_error("pair", head);
+	goto error;
+      }
+      _PL_get_arg(1, head, k);
+      _PL_get_arg(2, head, v);
+      if ( !put_hash_map_term(map, k, v PASS_LD) )
+      { rc = FALSE;
+	goto error;
+      }
+    }
+    if ( !PL_get_nil_ex(tail) )
+    { rc = FALSE;
+      goto error;
+    }
+  }
+
+  if ( (rc=unify_hash_map(t, map)) )
+    return rc;
+
+error:
+  destroyHTable(map->table);
+  simpleMutexDelete(&map->mutex);
+  freeHeap(map, sizeof(*map));
+
+  return rc;
+}
+
+
+static
+PRED_IMPL("hash_map_create", 1, hash_map_create, 0)
+{ PRED_LD
+
+  return create_hash_map(A1, 0 PASS_LD);
+}
+
+
+static
+PRED_IMPL("hash_map_create", 2, hash_map_create, 0)
+{ PRED_LD
+
+  return create_hash_map(A1, A2 PASS_LD);
+}
+
+
+/** is_hash_map(@Term) is semidet.
+ */
+
+static
+PRED_IMPL("is_hash_map", 1, is_hash_map, 0)
+{ void *data;
+  PL_blob_t *type;
+
+  return PL_get_blob(A1, &data, NULL, &type) && type == &hash_map_blob;
+}
+
+
+/** hash_map_put(+Map, +Key, +Value) is det.
+ */
+
+static
+PRED_IMPL("hash_map_put", 3, hash_map_put, 0)
+{ PRED_LD
+  hash_map *map;
+
+  return ( get_hash_map(A1, &map) &&
+	   put_hash_map_term(map, A2, A3 PASS_LD) );
+}
+
+
+/** hash_map_get(+Map, +Key, -Value) is semidet.
+ */
+
+static int
+get_hash_map_value(hash_map *map, term_t key, term_t value ARG_LD)
+{ Record k, v = NULL;
+  hm_entry *e;
+  int rc;
+
+  if ( !(k=compile_key(key PASS_LD)) )
+    return FALSE;
+
+  simpleMutexLock(&map->mutex);
+  if ( (e=find_entry(map, hm_key(k), k PASS_LD)) )
+  { v = e->value;
+    ATOMIC_INC(&v->references);
+  }
+  simpleMutexUnlock(&map->mutex);
+  freeRecord(k);
+
+  if ( !v )
+    return FALSE;
+  rc = unify_record(value, v PASS_LD);
+  freeRecord(v);
+
+  return rc;
+}
+
+
+static
+PRED_IMPL("hash_map_get", 3, hash_map_get, 0)
+{ PRED_LD
+  hash_map *map;
+
+  return ( get_hash_map(A1, &map) &&
+	   get_hash_map_value(map, A2, A3 PASS_LD) );
+}
+
+
+/** hash_map_delete(+Map, +Key) is semidet.
+ */
+
+static
+PRED_IMPL("hash_map_delete", 2, hash_map_delete, 0)
+{ PRED_LD
+  hash_map *map;
+  Record k;
+  hm_entry *e = NULL;
+
+  if ( !get_hash_map(A1, &map) ||
+       !(k=compile_key(A2 PASS_LD)) )
+    return FALSE;
+
+  simpleMutexLock(&map->mutex);
+  { void *hkey = hm_key(k);
+    hm_entry *head = lookupHTable(map->table, hkey);
+    hm_entry *prev = NULL;
+
+    for(e=head; e; prev=e, e=e->next)
+    { if ( equalRecords(e->key, k) )
+      { if ( prev )
+	  prev->next = e->next;
+	else if ( e->next )
+	  updateHTable(map->table, hkey, e->next);
+	else
+	  deleteHTable(map->table, hkey);
+	map->size--;
+	break;
+      }
+    }
+  }
+  simpleMutexUnlock(&map->mutex);
+  freeRecord(k);
+
+  if ( e )
+  { free_hm_entry(e);
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+
+/** hash_map_size(+Map, -Count) is det.
+ */
+
+static
+PRED_IMPL("hash_map_size", 2, hash_map_size, 0)
+{ PRED_LD
+  hash_map *map;
+
+  return ( get_hash_map(A1, &map) &&
+	   PL_unify_int64(A2, (int64_t)map->size) );
+}
+
+
+/** hash_map_pairs(+Map, -Pairs) is det.
+ *
+ * Pairs is a list Key-Value of all entries in no particular order.
+ */
+
+static
+PRED_IMPL("hash_map_pairs", 2, hash_map_pairs, 0)
+{ PRED_LD
+  hash_map *map;
+  hm_snapshot *snap;
+  term_t tail, head, k, v;
+  int rc = TRUE;
+
+  if ( !get_hash_map(A1, &map) )
+    return FALSE;
+
+  tail = PL_copy_term_ref(A2);
+  head = PL_new_term_ref();
+  k    = PL_new_term_ref();
+  v    = PL_new_term_ref();
+
+  snap = snapshot_hash_map(map);
+  for(; rc && snap->index < snap->count; snap->index++)
+  { Record *kv = &snap->records[snap->index*2];
+
+    PL_put_variable(k);
+    PL_put_variable(v);
+    rc = ( unify_record(k, kv[0] PASS_LD) &&
+	   unify_record(v, kv[1] PASS_LD) &&
+	   PL_unify_list(tail, head, tail) &&
+	   PL_unify_term(head, PL_FUNCTOR, FUNCTOR_minus2,
+			         PL_TERM, k, PL_TERM, v) );
+    freeRecord(kv[0]);
+    freeRecord(kv[1]);
+  }
+  free_snapshot(snap);
+
+  return rc && PL_unify_nil(tail);
+}
+
+
+/** hash_map_key_value(+Map, ?Key, ?Value) is nondet.
+ *
+ * If Key is ground this is the same as hash_map_get/3.  Otherwise
+ * enumerate all pairs from a snapshot of the map.
+ */
+
+static
+PRED_IMPL("hash_map_key_value", 3, hash_map_key_value, PL_FA_NONDETERMINISTIC)
+{ PRED_LD
+  hash_map *map;
+  hm_snapshot *snap;
+  fid_t fid;
+
+  switch( CTX_CNTRL )
+  { case FRG_FIRST_CALL:
+      if ( !get_hash_map(A1, &map) )
+	return FALSE;
+      if ( PL_is_ground(A2) )
+	return get_hash_map_value(map, A2, A3 PASS_LD);
+      snap = snapshot_hash_map(map);
+      break;
+    case FRG_REDO:
+      snap = CTX_PTR;
+      break;
+    case FRG_CUTTED:
+      snap = CTX_PTR;
+      free_snapshot(snap);
+      return TRUE;
+    default:
+      assert(0);
+      return FALSE;
+  }
+
+  if ( !(fid = PL_open_foreign_frame()) )
+  { free_snapshot(snap);
+    return FALSE;
+  }
+
+  while( snap->index < snap->count )
+  { Record *kv = &snap->records[snap->index*2];
+    int rc;
+
+    rc = ( unify_record(A2, kv[0] PASS_LD) &&
+	   unify_record(A3, kv[1] PASS_LD) );
+    freeRecord(kv[0]);
+    freeRecord(kv[1]);
+    snap->index++;
+
+    if ( rc )
+    { PL_close_foreign_frame(fid);
+      if ( snap->index < snap->count )
+	ForeignRedoPtr(snap);
+      free_snapshot(snap);
+      return TRUE;
+    }
+    if ( PL_exception(0) )
+    { PL_close_foreign_frame(fid);
+      free_snapshot(snap);
+      return FALSE;
+    }
+    PL_rewind_foreign_frame(fid);
+  }
+
+  PL_close_foreign_frame(fid);
+  free_snapshot(snap);
+  return FALSE;
+}
+
+
+/** '$hash_map_add_variant'(+Map, +Term) is semidet.
+ *
+ * Add Term as a key to Map if Map has no  key that is a variant of Term
+ * and fail otherwise. This is used to implement distinct/1,2. Variables
+ * are compiled in order of  appearance,  so   the  compiled data of two
+ * acyclic variants is equal. The key record also serves as value.
+ *
+ * Cyclic terms may be compiled differently  while they are variants. We
+ * put them in a single chain and compare them using is_variant_ptr().
+ */
+
+#define HM_CYCLIC_KEY ((void*)0x3)
+
+static int
+has_cyclic_variant(hash_map *map, term_t t ARG_LD)
+{ tmp_buffer buf;
+  Record *rp;
+  size_t i, count;
+  term_t copy;
+  int found = FALSE;
+  int rc = TRUE;
+
+  initBuffer(&buf);
+  simpleMutexLock(&map->mutex);
+  { hm_entry *e;
+
+    for(e=lookupHTable(map->table, HM_CYCLIC_KEY); e; e=e->next)
+    { ATOMIC_INC(&e->key->references);
+      addBuffer(&buf, e->key, Record);
+    }
+  }
+  simpleMutexUnlock(&map->mutex);
+
+  count = entriesBuffer(&buf, Record);
+  rp = baseBuffer(&buf, Record);
+  if ( !(copy = PL_new_term_ref()) )
+    rc = FALSE;
+  for(i=0; i<count; i++)
+  { if ( rc && !found )
+    { if ( (rc=copyRecordToGlobal(copy, rp[i], ALLOW_GC PASS_LD)) < 0 )
+	rc = raiseStackOverflow(rc);
+      else
+	found = is_variant_ptr(valTermRef(t), valTermRef(copy) PASS_LD);
+    }
+    freeRecord(rp[i]);
+  }
+  discardBuffer(&buf);
+
+  if ( !rc )
+    return -1;
+  return found;
+}
+
+
+static
+PRED_IMPL("$hash_map_add_variant", 2, hash_map_add_variant, 0)
+{ PRED_LD
+  hash_map *map;
+  Record k;
+  void *hkey;
+  hm_entry *e;
+
+  if ( !get_hash_map(A1, &map) )
+    return FALSE;
+
+  if ( PL_is_acyclic(A2) )
+  { if ( !(k=compileTermToHeap(A2, R_DUPLICATE)) )
+      return PL_no_memory();
+    hkey = hm_key(k);
+  } else
+  { int rc;
+
+    if ( (rc=has_cyclic_variant(map, A2 PASS_LD)) != FALSE )
+      return FALSE;			/* variant exists or error */
+    if ( !(k=compileTermToHeap(A2, R_DUPLICATE)) )
+      return PL_no_memory();
+    hkey = HM_CYCLIC_KEY;
+  }
+
+  simpleMutexLock(&map->mutex);
+  if ( hkey != HM_CYCLIC_KEY && (e=find_entry(map, hkey, k PASS_LD)) )
+  { simpleMutexUnlock(&map->mutex);
+    freeRecord(k);
+    return FALSE;
+  }
+  e = allocHeapOrHalt(sizeof(*e));
+  e->key   = k;
+  e->value = k;
+  ATOMIC_INC(&k->references);
+  { hm_entry *head = lookupHTable(map->table, hkey);
+
+    if ( head )
+    { e->next = head->next;
+      head->next = e;
+    } else
+    { e->next = NULL;
+      addNewHTable(map->table, hkey, e);
+    }
+  }
+  map->size++;
+  simpleMutexUnlock(&map->mutex);
+
+  return TRUE;
+}
+
+
+		 /*******************************
+		 *      PUBLISH PREDICATES	*
+		 *******************************/
+
+BeginPredDefs(hashmap)
+  PRED_DEF("hash_map_create",    1, hash_map_create,    0)
+  PRED_DEF("hash_map_create",    2, hash_map_create,    0)
+  PRED_DEF("is_hash_map",        1, is_hash_map,	      0)
+  PRED_DEF("hash_map_put",       3, hash_map_put,       0)
+  PRED_DEF("hash_map_get",       3, hash_map_get,       0)
+  PRED_DEF("hash_map_delete",    2, hash_map_delete,    0)
+  PRED_DEF("hash_map_size",      2, hash_map_size,      0)
+  PRED_DEF("hash_map_pairs",     2, hash_map_pairs,     0)
+  PRED_DEF("hash_map_key_value", 3, hash_map_key_value, PL_FA_NONDETERMINISTIC)
+  PRED_DEF("$hash_map_add_variant", 2, hash_map_add_variant, 0)
+EndPredDefs
@@ -518,9 +518,17 @@ sizes  of  the  hash  tables are defined.  Note that these should all be
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 #define ATOMHASHSIZE		1024	/* global atom table */
+#define ATOM_TABLE_SHARD_BITS	4	/* Log2 of # atom table shards */
+#define ATOM_TABLE_SHARDS	(1<<ATOM_TABLE_SHARD_BITS)
+#define ATOM_CACHE_SIZE		256	/* per-thread atom lookup cache */
 #define FUNCTORHASHSIZE		512	/* global functor table */
+#define FUNCTOR_TABLE_SHARD_BITS 4	/* Log2 of # functor table shards */
+#define FUNCTOR_TABLE_SHARDS	(1<<FUNCTOR_TABLE_SHARD_BITS)
 #define PROCEDUREHASHSIZE	256	/* predicates in module user */
 #define MODULEPROCEDUREHASHSIZE 16	/* predicates in other modules */
+#define RESOLVE_CACHE_SIZE	64	/* per-thread resolveProcedure() cache */
+#define RESOLVE_EPOCH_SLOTS	256	/* functor slots for invalidating it */
+#define MODULE_CACHE_SIZE	16	/* per-thread lookupModule() cache */
 #define MODULEHASHSIZE		16	/* global module table */
 #define PUBLICHASHSIZE		8	/* Module export table */
 #define FLAGHASHSIZE		16	/* global flag/3 table */
@@ -894,6 +902,8 @@ with one operation, it turns out to be faster as well.
 #define DBREF_ERASED_CLAUSE	(0x0040) /* Deleted while referenced */
 #define CL_BODY_CONTEXT		(0x0080) /* Module context of body is different */
 					 /* from predicate */
+#define CL_DET_GUARD		(0x0100) /* Body starts with C_DETGUARD */
+#define CL_PACKED		(0x0200) /* Clause lives in a clause block */
 
 /* Flags on a DDI (Dirty Definition Info struct */
 
@@ -929,6 +939,7 @@ with one operation, it turns out to be faster as well.
 #define CONTROL_F		(0x0002) /* functor (compiled controlstruct) */
 #define ARITH_F			(0x0004) /* functor (arithmetic operator) */
 #define VALID_F			(0x0008) /* functor (fully defined) */
+#define DEAD_F			(0x0010) /* functor (lost insertion race) */
 
 /* Flags on record lists (recorded database keys) */
 
@@ -936,11 +947,12 @@ with one operation, it turns out to be faster as well.
 
 /* Flags on recorded database records (also PL_record()) */
 
-#define R_ERASED		(0x0001) /* record: record is erased */
+#define R_ERASED		(0x0001) /* recordRef: record is erased */
 #define R_EXTERNAL		(0x0002) /* record: inline atoms */
 #define R_DUPLICATE		(0x0004) /* record: include references */
 #define R_NOLOCK		(0x0008) /* record: do not lock atoms */
-#define R_DBREF			(0x0010) /* record: has DB-reference */
+#define R_DBREF			(0x0010) /* recordRef: has DB-reference */
+#define R_SHARED		(0x0020) /* record: in shared record table */
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Macros for environment frames (local stack frames)
@@ -956,7 +968,8 @@ Macros for environment frames (local stack frames)
 #define FR_CONTEXT		(0x0080) /* fr->context is set */
 #define FR_CLEANUP		(0x0100) /* setup_call_cleanup/4 */
 #define FR_INRESET		(0x0200) /* Continuations: inside reset/3 */
-#define FR_WATCHED (FR_CLEANUP|FR_DEBUG)
+#define FR_COUNTED		(0x0400) /* Predicate has call counting */
+#define FR_WATCHED (FR_CLEANUP|FR_DEBUG|FR_COUNTED)
 
 #define FR_MAGIC_MASK		(0xfffff000)
 #define FR_MAGIC_MASK2		(0xffff0000)
@@ -1161,6 +1174,7 @@ typedef struct atom_table * AtomTable;
 typedef struct atom_table
 { AtomTable	prev;
   int		buckets;
+  volatile int	rehashing;		/* Being replaced by rehashAtoms() */
   Atom *	table;
 } atom_table;
 
@@ -1205,6 +1219,7 @@ struct functorDef
 		  /* CONTROL_F	   Compiled control-structure */
 		  /* ARITH_F	   Arithmetic function */
 		  /* VALID_F	   Fully defined functor */
+		  /* DEAD_F	   Lost race, never valid */
 };
 
 
@@ -1217,6 +1232,7 @@ typedef struct functor_table * FunctorTable;
 typedef struct functor_table
 { FunctorTable	prev;
   int		buckets;
+  volatile int	rehashing;		/* Being replaced by rehashFunctors() */
   FunctorDef *	table;
 } functor_table;
 
@@ -1352,13 +1368,24 @@ typedef struct gc_stat
   gc_reason_t	reason;			/* why GC was run */
 } gc_stat;
 
+typedef struct gc_phases
+{ double	start;			/* CPU time at start of phase */
+  double	mark;			/* mark_phase() */
+  double	compact_trail;		/* compact_trail() */
+  double	sweep;			/* sweep trail, local and foreign */
+  double	compact_global;		/* compact_global() (relocation) */
+  size_t	marked_local;		/* # cells marked from the local stack */
+} gc_phases;
+
 typedef struct gc_stats
 { gc_stat	last[GC_STAT_WINDOW_SIZE];
   gc_stat	aggr[GC_STAT_WINDOW_SIZE];
   int		last_index;
   int		aggr_index;
   double	thread_cpu;		/* Last thread CPU time */
+  double	rate;			/* Stack bytes collected per second */
   gc_reason_t	request;		/* Requesting stack */
+  gc_phases	phases;			/* Phase details of last GC */
   struct
   { int64_t	collections;
     int64_t	global_gained;		/* global stack bytes collected */
@@ -1388,12 +1415,14 @@ typedef struct gc_stats
 #define CA1_JUMP       16	/* Instructions to skip */
 #define CA1_AFUNC      17	/* Number of arithmetic function */
 #define CA1_TRIE_NODE  18	/* Tabling: answer trie node with delays */
+#define CA1_SWITCH     19	/* <n> followed by n <key,target> pairs */
 
 #define VIF_BREAK      0x01	/* Can be a breakpoint */
 
 typedef enum
 { VMI_REPLACE,
-  VMI_STEP_ARGUMENT
+  VMI_STEP_ARGUMENT,
+  VMI_FUSE
 } vmi_merge_type;
 
 typedef struct
@@ -1412,6 +1441,12 @@ typedef struct
   char		argtype[4];	/* Argument type(s) code takes */
 } code_info;
 
+typedef struct
+{ vmi		first;		/* First instruction of the sequence */
+  vmi		second;		/* Instruction following it */
+  vmi		fused;		/* Superinstruction (see mkvmi.c) */
+} vmi_fusion;
+
 struct mark
 { TrailEntry	trailtop;	/* top of the trail stack */
   Word		globaltop;	/* top of the global stack */
@@ -1429,7 +1464,7 @@ struct clause_bucket
   unsigned int	dirty;			/* # of garbage clauses */
 };
 
-#define MAX_MULTI_INDEX  4
+#define MAX_MULTI_INDEX  8		/* max args in a multi-arg index */
 #define MAXINDEXARG    254
 #define MAXINDEXDEPTH    7
 #define END_INDEX_POS  255
@@ -1449,8 +1484,17 @@ struct clause_index
   iarg_t	 position[MAXINDEXDEPTH+1]; /* Deep index position */
   float		 speedup;		/* Estimated speedup */
   ClauseBucket	 entries;		/* chains holding the clauses */
+  ClauseIndex	 resized;		/* Larger copy being filled */
+  ClauseRef	 resize_last;		/* Last clause added to resized */
 };
 
+typedef struct hash_hints
+{ iarg_t	args[MAX_MULTI_INDEX];	/* Hash these arguments */
+  float		speedup;		/* Expected speedup */
+  unsigned int	ln_buckets;		/* Lg2 of #buckets to use */
+  unsigned	list : 1;		/* Use a list per key */
+} hash_hints;
+
 #define MAX_BLOCKS 20			/* allows for 2M threads */
 
 typedef struct local_definitions
@@ -1458,6 +1502,35 @@ typedef struct local_definitions
   Definition preallocated[7];
 } local_definitions;
 
+typedef struct index_stats
+{ uint64_t	calls;			/* # firstClause() calls */
+  uint64_t	indexed;		/* # resolved using a JIT index */
+  uint64_t	first_arg;		/* # resolved using first arg scan */
+  uint64_t	linear;			/* # resolved using a linear scan */
+  uint64_t	tried;			/* # candidate clauses returned */
+  uint64_t	visited;		/* # non-matching clause refs in buckets */
+  uint64_t	created;		/* # JIT indexes created */
+} index_stats;
+
+typedef struct call_counts
+{ int		active;			/* Counting is enabled */
+  uint64_t	calls;			/* # call ports */
+  uint64_t	exits;			/* # exit ports */
+  uint64_t	redos;			/* # redo ports */
+  uint64_t	fails;			/* # fail ports */
+  uint64_t	exceptions;		/* # exception ports */
+  uint64_t	timed;			/* # timed calls */
+  uint64_t	time;			/* Wall time of timed calls (nsec) */
+} call_counts;
+
+#define CALL_TIMER_DEPTH	32	/* Max nested timed calls per thread */
+
+typedef struct call_timer
+{ size_t	frame;			/* Offset of the frame from lBase */
+  Definition	predicate;		/* Predicate running in the frame */
+  double	start;			/* WallTime() at the call port */
+} call_timer;
+
 struct definition
 { FunctorDef	functor;		/* Name/Arity of procedure */
   Module	module;			/* module of the predicate */
@@ -1475,6 +1548,16 @@ struct definition
   gen_t		last_modified;		/* Generation I was last modified */
   struct event_list  *events;		/* Forward update events */
   struct table_props *tabling;		/* Extended properties for tabling */
+  struct range_index *range_indexes;	/* Sorted argument keys (pl-index.c) */
+  struct index_stats *index_stats;	/* Clause selection statistics */
+  struct call_counts *call_counts;	/* Port counts (pl-prof.c) */
+  struct
+  { ClauseRef	last;			/* Last of leading erased clauses */
+    gen_t	generation;		/* Erased at or before this gen */
+  } erased_prefix;			/* See firstClauseRef() */
+#ifdef O_PLMT
+  counting_mutex *mutex;		/* Private lock (concurrent property) */
+#endif
 #ifdef O_PROF_PENTIUM
   int		prof_index;		/* index in profiling */
   char	       *prof_name;		/* name in profiling */
@@ -1673,6 +1756,19 @@ struct fliFrame
   mark		mark;			/* data-stack mark */
 };
 
+#define MAX_FLI_ARGS 10			/* extend switches on change */
+
+/* Argument types of typed foreign predicates.  The signature is encoded
+   in the second argument of I_FCALLTYPED using FTYPE_BITS per argument.
+*/
+
+#define FTYPE_INT64		1		/* int64_t */
+#define FTYPE_DOUBLE		2		/* double */
+#define FTYPE_ATOM		3		/* atom_t */
+#define FTYPE_OUTPUT		4		/* or-ed: output argument */
+#define FTYPE_BITS		3
+#define FTYPE_ARG(sig, i)	(((sig)>>((i)*FTYPE_BITS))&0x7)
+
 #ifdef O_MAINTENANCE
 #define REC_MAGIC 27473244
 #endif
@@ -1682,11 +1778,10 @@ struct record
   unsigned      gsize;			/* Size on global stack */
   unsigned	nvars;			/* # variables in the term */
   unsigned	flags;			/* Flags, holding */
-					/* R_ERASED */
 					/* R_EXTERNAL */
 					/* R_DUPLICATE */
 					/* R_NOLOCK */
-					/* R_DBREF */
+					/* R_SHARED */
 #ifdef REC_MAGIC
   int		magic;			/* REC_MAGIC */
 #endif
@@ -1708,6 +1803,7 @@ struct recordRef
   RecordRef	next;			/* next in list */
   RecordRef	prev;			/* previous in list */
   Record	record;			/* the record itself */
+  unsigned int	flags;			/* R_ERASED, R_DBREF */
 };
 
 
@@ -1739,6 +1835,8 @@ typedef struct p_reload
   arg_info     *args;			/* Meta info on arguments */
   unsigned	flags;			/* new flags (P_DYNAMIC, etc.) */
   unsigned	number_of_clauses;	/* Number of clauses we've seen */
+  ClauseRef	previous_clause;	/* Clause before current (or NULL) */
+  struct reload_index *index;		/* Hash index on remaining clauses */
 } p_reload;
 
 typedef struct m_reload
@@ -1993,6 +2091,13 @@ typedef struct
 #define SIG_CLAUSE_GC	  (SIG_PROLOG_OFFSET+3)
 #define SIG_PLABORT	  (SIG_PROLOG_OFFSET+4)
 #define SIG_TUNE_GC	  (SIG_PROLOG_OFFSET+5)
+#define SIG_GC_EVENT	  (SIG_PROLOG_OFFSET+6)
+#ifdef O_PLMT
+#define SIG_STREAM_OWNER  (SIG_PROLOG_OFFSET+7)
+#endif
+#if defined(O_PLMT) && defined(O_PROFILE)
+#define SIG_PROF_SAMPLE	  (SIG_PROLOG_OFFSET+8)
+#endif
 
 
 		 /*******************************
@@ -2041,8 +2146,16 @@ this to enlarge the runtime stacks.  Otherwise use the stack-shifter.
 
 struct stack STACK(caddress);		/* Anonymous stack */
 
+typedef struct
+{ size_t reserved;			/* Reserved size per stack (or 0) */
+  size_t global;			/* Committed global (incl. mark) */
+  size_t local;				/* Committed local stack */
+  size_t trail;				/* Committed trail stack */
+} stack_reservation;
+
 typedef struct
 { size_t limit;				/* Total stack limit */
+  stack_reservation reserve;		/* See allocStacks() */
   struct STACK(LocalFrame) local;	/* local (environment) stack */
   struct STACK(Word)	   global;	/* local (environment) stack */
   struct STACK(TrailEntry) trail;	/* trail stack */
@@ -2285,6 +2398,7 @@ typedef struct
 #define PROCEDURE_tune_gc3		(GD->procedures.tune_gc3)
 
 extern const code_info codeTable[]; /* Instruction info (read-only) */
+extern const vmi_fusion vmiFusionTable[]; /* Superinstructions */
 
 		 /*******************************
 		 *	  TEXT PROCESSING	*
@@ -2398,6 +2512,8 @@ typedef struct debuginfo
 #define PLFLAG_TABLE_INCREMENTAL    0x08000000 /* By default incremental tabling */
 #define PLFLAG_TABLE_SHARED	    0x10000000 /* By default shared tabling */
 #define PLFLAG_RATIONAL		    0x20000000 /* Natural rational numbers */
+#define PLFLAG_INDEX_STATISTICS	    0x40000000 /* Maintain index_stats */
+#define PLFLAG_TABLE_SPACE_EVICTION 0x80000000 /* Evict LRU private tables */
 
 typedef struct
 { unsigned int flags;		/* Fast access to some boolean Prolog flags */
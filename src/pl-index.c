@@ -36,6 +36,8 @@
 #include "pl-incl.h"
 #include "pl-comp.h"
 #include "pl-rsort.h"
+#include "pl-metrics.h"
+#include "pl-tracepoint.h"
 #include <math.h>
 
 		 /*******************************
@@ -67,21 +69,22 @@
 #define DEAD_INDEX   ((ClauseIndex)1)
 #define ISDEADCI(ci) ((ci) == DEAD_INDEX)
 
-typedef struct hash_hints
-{ iarg_t	args[MAX_MULTI_INDEX];	/* Hash these arguments */
-  float		speedup;		/* Expected speedup */
-  unsigned int	ln_buckets;		/* Lg2 of #buckets to use */
-  unsigned	list : 1;		/* Use a list per key */
-} hash_hints;
-
 typedef struct index_context
 { gen_t		generation;		/* Current generation */
   Definition	predicate;		/* Current predicate */
   ClauseChoice	chp;			/* Clause choice point */
   int		depth;			/* current depth (0..) */
+  index_stats  *stats;			/* Statistics or NULL */
   iarg_t	position[MAXINDEXDEPTH+1]; /* Keep track of argument position */
 } index_context, *IndexContext;
 
+#define INDEX_STAT(ctx, f) \
+	do { if ( unlikely((ctx)->stats != NULL) ) (ctx)->stats->f++; } while(0)
+#define INDEX_STAT0(ctx, f) \
+	do { if ( unlikely((ctx)->stats != NULL) && (ctx)->depth == 0 ) \
+	       (ctx)->stats->f++; \
+	   } while(0)
+
 static int	bestHash(Word av, size_t ac, ClauseList clist, float min_speedup,
 			 hash_hints *hints, IndexContext ctx ARG_LD);
 static ClauseIndex hashDefinition(ClauseList clist, hash_hints *h,
@@ -89,6 +92,7 @@ static ClauseIndex hashDefinition(ClauseList clist, hash_hints *h,
 static void	replaceIndex(Definition def, ClauseList cl,
 			     ClauseIndex *cip, ClauseIndex ci);
 static void	deleteIndexP(Definition def, ClauseList cl, ClauseIndex *cip);
+static size_t	sizeofClauseIndex(ClauseIndex ci);
 static void	deleteIndex(Definition def, ClauseList cl, ClauseIndex ci);
 static void	insertIndex(Definition def, ClauseList clist, ClauseIndex ci);
 static void	setClauseChoice(ClauseChoice chp, ClauseRef cref,
@@ -105,6 +109,24 @@ static Code	skipToTerm(Clause clause, const iarg_t *position);
 static void	unalloc_index_array(void *p);
 static void	wait_for_index(const ClauseIndex ci);
 static void	completed_index(ClauseIndex ci);
+static int	startIndexResize(Definition def, ClauseList cl, ClauseIndex ci,
+				 ClauseRef where);
+static void	abortIndexResize(ClauseIndex ci);
+static void	stepIndexResize(Definition def, ClauseList cl,
+				ClauseIndex *cip, Clause added);
+static void	unalloc_ci(void *p);
+#ifdef O_PLMT
+static int	queueIndexRequest(ClauseList clist, hash_hints *hints,
+				  IndexContext ctx);
+#define BACKGROUND_INDEX(clist, ctx) \
+	( GD->thread.index.background > 0 && \
+	  (ctx)->depth == 0 && \
+	  (clist) == &(ctx)->predicate->impl.clauses && \
+	  (clist)->number_of_clauses >= GD->thread.index.background )
+#else
+#define queueIndexRequest(clist, hints, ctx) FALSE
+#define BACKGROUND_INDEX(clist, ctx) FALSE
+#endif
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Compute the index in the hash-array from   a machine word and the number
@@ -146,6 +168,23 @@ canIndex(word w ARG_LD)
 }
 
 
+/* indirectIndexKey() computes the index key for the indirect data at p
+   (a string, float or big integer).
+*/
+
+word
+indirectIndexKey(Word p)
+{ size_t n = wsizeofInd(*p);
+  word k;
+
+  k = MurmurHashAligned2(p+1, n*sizeof(*p), MURMUR_SEED);
+  k &= ~((word)STG_GLOBAL);		/* avoid confusion with functor_t */
+  if ( !k ) k = 1;			/* avoid no-key */
+
+  return k;
+}
+
+
 static inline word
 indexOfWord(word w ARG_LD)
 { for(;;)
@@ -161,15 +200,9 @@ indexOfWord(word w ARG_LD)
       /*FALLTHROUGH*/
       case TAG_STRING:
       case TAG_FLOAT:
-      { Word p = addressIndirect(w);
-	size_t n = wsizeofInd(*p);
-	word k;
-
-	k = MurmurHashAligned2(p+1, n*sizeof(*p), MURMUR_SEED);
-	k &= ~((word)STG_GLOBAL);	/* avoid confusion with functor_t */
-	if ( !k ) k = 1;		/* avoid no-key */
-	return k;
-      }
+	if ( isLargeIndirect(w) )
+	  return largeIndirectKey(w PASS_LD);
+	return indirectIndexKey(addressIndirect(w));
       case TAG_COMPOUND:
 	w = *valPtr(w);			/* functor_t */
 	break;
@@ -318,11 +351,13 @@ nextClauseFromBucket(ClauseIndex ci, Word argv, IndexContext ctx ARG_LD)
 
 	  return result;
 	}
+	INDEX_STAT(ctx, visited);
       }
       ctx->chp->cref = NULL;
 
       return result;
     }
+    INDEX_STAT(ctx, visited);
   }
 
   return NULL;
@@ -337,7 +372,7 @@ nextClauseFromBucket(ClauseIndex ci, Word argv, IndexContext ctx ARG_LD)
 
 static void
 setClauseChoice(ClauseChoice chp, ClauseRef cref, gen_t generation ARG_LD)
-{ while ( cref && !GLOBALLY_VISIBLE_CLAUSE(cref->value.clause, generation) )
+{ while ( cref && !visibleClause(cref->value.clause, generation) )
   { cref = cref->next;
     LD->clauses.erased_skipped++;
   }
@@ -362,7 +397,7 @@ indexKeyFromArgv(ClauseIndex ci, Word argv ARG_LD)
   { word key[MAX_MULTI_INDEX];
     int  harg;
 
-    for(harg=0; ci->args[harg]; harg++)
+    for(harg=0; harg<MAX_MULTI_INDEX && ci->args[harg]; harg++)
     { if ( !(key[harg] = indexOfWord(argv[ci->args[harg]-1] PASS_LD)) )
 	return 0;
     }
@@ -384,7 +419,7 @@ iargsName(const iarg_t args[MAX_MULTI_INDEX], char *buf)
 
   s = buf;
   *s++ = '[';
-  for(i=0; args[i]; i++)
+  for(i=0; i<MAX_MULTI_INDEX && args[i]; i++)
   { if ( i > 0 )
       *s++ = ',';
     Ssprintf(s, "%d", args[i]);
@@ -408,6 +443,14 @@ TBD:
   - When to ignore the best and try again?
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+static inline ClauseRef
+first_clause_ref(ClauseList clist, IndexContext ctx)
+{ if ( clist == &ctx->predicate->impl.clauses )
+    return firstClauseRef(ctx->predicate, ctx->generation);
+
+  return clist->first_clause;
+}
+
 static ClauseRef
 first_clause_guarded(Word argv, size_t argc, ClauseList clist,
 		     IndexContext ctx ARG_LD)
@@ -416,7 +459,8 @@ first_clause_guarded(Word argv, size_t argc, ClauseList clist,
   hash_hints hints;
   ClauseChoice chp = ctx->chp;
 
-#define STATIC_RELOADING() (LD->gen_reload && false(ctx->predicate, P_DYNAMIC))
+#define STATIC_RELOADING() (LD->gen_reload && !LD->transaction.generation && \
+			    false(ctx->predicate, P_DYNAMIC))
 
   if ( unlikely(argc == 0) )
     goto simple;			/* TBD: alt supervisor */
@@ -433,6 +477,8 @@ retry:
 
       if ( ISDEADCI(ci) )
 	continue;
+      if ( ci->incomplete && BACKGROUND_INDEX(clist, ctx) )
+	continue;			/* being built in the background */
 
       if ( (k=indexKeyFromArgv(ci, argv PASS_LD)) )
       { best_index = ci;
@@ -453,7 +499,8 @@ retry:
 		       predicateName(ctx->predicate)));
 
 	if ( bestHash(argv, argc, clist, best_index->speedup,
-		      &hints, ctx PASS_LD) )
+		      &hints, ctx PASS_LD) &&
+	     !queueIndexRequest(clist, &hints, ctx) )
 	{ ClauseIndex ci;
 
 	  DEBUG(MSG_JIT, Sdprintf("[%d] Found better at args %s\n",
@@ -475,6 +522,7 @@ retry:
 	goto retry;
       }
 
+      INDEX_STAT0(ctx, indexed);
       hi = hashIndex(chp->key, best_index->buckets);
       chp->cref = best_index->entries[hi].head;
       return nextClauseFromBucket(best_index, argv, ctx PASS_LD);
@@ -486,19 +534,22 @@ retry:
 
   if ( (chp->key = indexOfWord(argv[0] PASS_LD)) &&
        (clist->number_of_clauses <= 10 || STATIC_RELOADING()) )
-  { chp->cref = clist->first_clause;
+  { chp->cref = first_clause_ref(clist, ctx);
 
     cref = nextClauseArg1(chp, ctx->generation PASS_LD);
     if ( !cref ||
 	 !(chp->cref && chp->cref->d.key == chp->key &&
 	   cref->d.key == chp->key) )
+    { INDEX_STAT0(ctx, first_arg);
       return cref;
+    }
     /* else duplicate; see whether we can create a deep index */
     /* TBD: Avoid trying this every goal */
   }
 
   if ( !STATIC_RELOADING() &&
-       bestHash(argv, argc, clist, 0.0, &hints, ctx PASS_LD) )
+       bestHash(argv, argc, clist, 0.0, &hints, ctx PASS_LD) &&
+       !queueIndexRequest(clist, &hints, ctx) )
   { ClauseIndex ci;
 
     if ( (ci=hashDefinition(clist, &hints, ctx)) )
@@ -509,6 +560,7 @@ retry:
       if ( ci->invalid )
 	goto retry;
 
+      INDEX_STAT0(ctx, indexed);
       chp->key = indexKeyFromArgv(ci, argv PASS_LD);
       assert(chp->key);
       hi = hashIndex(chp->key, ci->buckets);
@@ -520,12 +572,14 @@ retry:
   }
 
   if ( chp->key )
-  { chp->cref = clist->first_clause;
+  { INDEX_STAT0(ctx, first_arg);
+    chp->cref = first_clause_ref(clist, ctx);
     return nextClauseArg1(chp, ctx->generation PASS_LD);
   }
 
 simple:
-  for(cref = clist->first_clause; cref; cref = cref->next)
+  INDEX_STAT0(ctx, linear);
+  for(cref = first_clause_ref(clist, ctx); cref; cref = cref->next)
   { if ( visibleClauseCNT(cref->value.clause, ctx->generation) )
     { chp->key = 0;
       setClauseChoice(chp, cref->next, ctx->generation PASS_LD);
@@ -537,6 +591,44 @@ simple:
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Index statistics are maintained if the  Prolog flag index_statistics is
+true. The counters are allocated  lazily  and   updated  without  locks,
+i.e., under heavy concurrent use of the  same predicate they are merely
+an approximation.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static index_stats *
+getIndexStatistics(Definition def)
+{ index_stats *stats;
+
+  if ( !(stats=def->index_stats) )
+  { index_stats *new = allocHeapOrHalt(sizeof(*new));
+
+    memset(new, 0, sizeof(*new));
+    if ( COMPARE_AND_SWAP_PTR(&def->index_stats, NULL, new) )
+    { stats = new;
+    } else
+    { freeHeap(new, sizeof(*new));
+      stats = def->index_stats;
+    }
+  }
+
+  return stats;
+}
+
+
+void
+deleteIndexStatistics(Definition def)
+{ index_stats *stats;
+
+  if ( (stats=def->index_stats) )
+  { def->index_stats = NULL;
+    freeHeap(stats, sizeof(*stats));
+  }
+}
+
+
 ClauseRef
 firstClause(Word argv, LocalFrame fr, Definition def, ClauseChoice chp ARG_LD)
 { ClauseRef cref;
@@ -546,14 +638,21 @@ firstClause(Word argv, LocalFrame fr, Definition def, ClauseChoice chp ARG_LD)
   ctx.predicate   = def;
   ctx.chp         = chp;
   ctx.depth       = 0;
+  ctx.stats       = NULL;
   ctx.position[0] = END_INDEX_POS;
 
+  if ( unlikely(truePrologFlag(PLFLAG_INDEX_STATISTICS)) &&
+       (ctx.stats = getIndexStatistics(def)) )
+    ctx.stats->calls++;
+
   acquire_def(def);
   cref = first_clause_guarded(argv,
 			      def->functor->arity,
 			      &def->impl.clauses,
 			      &ctx
 			      PASS_LD);
+  if ( cref && ctx.stats )
+    ctx.stats->tried++;
   DEBUG(CHK_SECURE, assert(!cref || !chp->cref ||
 			   visibleClause(chp->cref->value.clause,
 					 generationFrame(fr))));
@@ -584,6 +683,10 @@ nextClause__LD(ClauseChoice chp, Word argv, LocalFrame fr, Definition def ARG_LD
   }
   release_def(def);
 
+  if ( cref && unlikely(def->index_stats != NULL) &&
+       truePrologFlag(PLFLAG_INDEX_STATISTICS) )
+    def->index_stats->tried++;
+
   DEBUG(CHK_SECURE,
 	assert(!cref || !chp->cref ||
 	       chp->cref->value.clause->generation.erased > generation));
@@ -592,6 +695,36 @@ nextClause__LD(ClauseChoice chp, Word argv, LocalFrame fr, Definition def ARG_LD
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+lastClauseCandidate() returns the clause the  choicepoint  chp  will  try
+if this is the only remaining candidate and NULL otherwise.  It does not
+modify chp.  Used by C_DETGUARD (see pl-comp.c).  The caller must  hold
+the definition using acquire_def().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+Clause
+lastClauseCandidate(ClauseChoice chp, LocalFrame fr ARG_LD)
+{ gen_t generation = generationFrame(fr);
+  word key = chp->key;
+  int maxsearch = MAX_LOOKAHEAD;
+  Clause found = NULL;
+  ClauseRef cref;
+
+  for(cref = chp->cref; cref; cref = cref->next)
+  { if ( (!key || !cref->d.key || key == cref->d.key) &&
+	 visibleClause(cref->value.clause, generation) )
+    { if ( found )
+	return NULL;
+      found = cref->value.clause;
+    }
+    if ( --maxsearch == 0 )
+      return NULL;
+  }
+
+  return found;
+}
+
+
 		 /*******************************
 		 *	   HASH SUPPORT		*
 		 *******************************/
@@ -686,7 +819,7 @@ vfree_clause_list_ref(void *cref)
 
 static void
 lingerClauseListRef(Definition def, ClauseRef cref)
-{ linger(&def->lingering, vfree_clause_list_ref, cref);
+{ linger(&def->lingering, vfree_clause_list_ref, cref, SIZEOF_CREF_LIST);
 }
 
 
@@ -714,7 +847,9 @@ unallocClauseIndexTableEntries(ClauseIndex ci)
 
 void
 unallocClauseIndexTable(ClauseIndex ci)
-{ unallocClauseIndexTableEntries(ci);
+{ if ( ci->resized )
+    unallocClauseIndexTable(ci->resized);
+  unallocClauseIndexTableEntries(ci);
   freeHeap(ci, sizeof(struct clause_index));
 }
 
@@ -773,11 +908,131 @@ addClauseToListIndexes(Definition def, ClauseList cl, Clause clause,
       if ( ci->invalid )
 	return;
 
-      if ( ci->size >= ci->resize_above ||
-	   !addClauseToIndex(ci, clause, where) )
-	deleteIndexP(def, cl, cip);
+      if ( ci->resized && where != CL_END )
+	abortIndexResize(ci);
+      if ( ci->size >= ci->resize_above &&
+	   !ci->resized &&
+	   !startIndexResize(def, cl, ci, where) )
+      { deleteIndexP(def, cl, cip);
+	continue;
+      }
+      if ( !addClauseToIndex(ci, clause, where) )
+      { deleteIndexP(def, cl, cip);
+	continue;
+      }
+      if ( ci->resized )
+	stepIndexResize(def, cl, cip, clause);
+    }
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Incremental index resizing.  If a hash index of a dynamic predicate gets
+too full, we used to delete it, such that the next call that needs it
+rebuilt it from scratch.  For growing tables this causes a delay at each
+doubling.  Instead, we allocate an index with twice as many buckets when
+the index reaches resize_above, but we do not publish it.  Each clause
+added at the end (assertz/1) is added to the old index as usual and moves
+RESIZE_STEP clauses of the clause list, in clause order, to the new
+index.  When all clauses are moved, the new index replaces the old one.
+As new clauses are appended to the clause list, the new index receives
+them in the right order, and because we move more than one clause per
+assert, we are done long before the new index fills up.
+
+Readers never see the new index before it is complete.  Anything that
+complicates the bookkeeping aborts the resize: adding a clause elsewhere
+than at the end, or erasing a clause.  Erased clauses are never moved.
+As a result, resize_last always refers to a clause that is not erased and
+thus cannot be removed from the clause list by clause GC.  If the old
+index reaches twice its resize limit without completing a resize, we
+fall back to deleting it.  All this is done while holding the predicate
+lock.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define RESIZE_STEP 4			/* Clauses moved per clause added */
+
+static int
+startIndexResize(Definition def, ClauseList cl, ClauseIndex ci,
+		 ClauseRef where)
+{ ClauseIndex ni;
+  size_t bytes;
+
+  if ( where != CL_END || ci->is_list || false(def, P_DYNAMIC) ||
+       cl != &def->impl.clauses ||
+       ci->size >= 2*ci->resize_above ||
+       ci->buckets >= UINT_MAX/4 )
+    return FALSE;
+
+  ni = allocHeapOrHalt(sizeof(struct clause_index));
+  memset(ni, 0, sizeof(*ni));
+  memcpy(ni->args, ci->args, sizeof(ni->args));
+  copytpos(ni->position, ci->position);
+  ni->buckets = ci->buckets*2;
+  ni->speedup = ci->speedup;
+  bytes = sizeof(struct clause_bucket) * ni->buckets;
+  ni->entries = allocHeapOrHalt(bytes);
+  memset(ni->entries, 0, bytes);
+  ATOMIC_INC(&GD->statistics.indexes.created);
+
+  ci->resized = ni;
+  ci->resize_last = NULL;
+  DEBUG(MSG_JIT, Sdprintf("[%d] Resizing index %s of %s to %d buckets\n",
+			  PL_thread_self(), iargsName(ci->args, NULL),
+			  predicateName(def), ni->buckets));
+
+  return TRUE;
+}
+
+
+static void
+abortIndexResize(ClauseIndex ci)
+{ ClauseIndex ni = ci->resized;
+
+  ci->resized = NULL;
+  ci->resize_last = NULL;
+  unallocClauseIndexTable(ni);
+}
+
+
+/* Move up to RESIZE_STEP clauses to the resized index. `added` is the
+   clause we just added.  We are done if we moved the last clause of the
+   clause list and this is `added`.  If not, we are in the middle of
+   assertDefinitionList() and the remaining clauses still have to be
+   added to the indexes.
+*/
+
+static void
+stepIndexResize(Definition def, ClauseList cl, ClauseIndex *cip, Clause added)
+{ ClauseIndex ci = *cip;
+  ClauseIndex ni = ci->resized;
+  ClauseRef last = ci->resize_last;
+  ClauseRef cref = last ? last->next : cl->first_clause;
+  int n = RESIZE_STEP;
+
+  for( ; cref && n > 0; cref = cref->next )
+  { if ( false(cref->value.clause, CL_ERASED) )
+    { if ( !addClauseToIndex(ni, cref->value.clause, CL_END) )
+      { abortIndexResize(ci);
+	return;
+      }
+      last = cref;
+      n--;
     }
   }
+  ci->resize_last = last;
+
+  if ( last && last == cl->last_clause && last->value.clause == added )
+  { ni->resize_above = ci->resize_above*2;
+    ni->resize_below = ni->size/4;
+    ci->resized = NULL;
+    ci->resize_last = NULL;
+    *cip = ni;
+    DEBUG(MSG_JIT, Sdprintf("[%d] Resized index %s of %s\n",
+			    PL_thread_self(), iargsName(ni->args, NULL),
+			    predicateName(def)));
+    linger(&def->lingering, unalloc_ci, ci, sizeofClauseIndex(ci));
+  }
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -1320,7 +1575,7 @@ indexKeyFromClause(ClauseIndex ci, Clause cl, Code *end)
 
     DEBUG(CHK_SECURE, if ( end ) *end = NULL);
 
-    for(harg=0; ci->args[harg]; harg++)
+    for(harg=0; harg<MAX_MULTI_INDEX && ci->args[harg]; harg++)
     { if ( ci->args[harg] > pcarg )
 	PC = skipArgs(PC, ci->args[harg]-pcarg);
       pcarg = ci->args[harg];
@@ -1405,6 +1660,8 @@ deleteActiveClauseFromIndexes(Definition def, Clause cl)
 	wait_for_index(ci);
       if ( ci->invalid )
 	return;
+      if ( ci->resized )
+	abortIndexResize(ci);
 
       if ( true(def, P_DYNAMIC) )
       { if ( def->impl.clauses.number_of_clauses < ci->resize_below )
@@ -1511,6 +1768,32 @@ addClauseToIndexes(Definition def, Clause clause, ClauseRef where)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+addClausesToIndexes() is the  bulk  version   of  addClauseToIndexes(),
+called by assertDefinitionList(). The clauses are  in clause order, i.e.
+for CL_START we must add them in reverse   order.  We only reconsider the
+indexes once for the whole batch.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+addClausesToIndexes(Definition def, Clause *clauses, size_t count,
+		    ClauseRef where)
+{ size_t i;
+
+  if ( where == CL_START )
+  { for(i=count; i-- > 0; )
+      addClauseToListIndexes(def, &def->impl.clauses, clauses[i], where);
+  } else
+  { for(i=0; i<count; i++)
+      addClauseToListIndexes(def, &def->impl.clauses, clauses[i], where);
+  }
+  reconsider_index(def);
+
+  DEBUG(CHK_SECURE, checkDefinition(def));
+  return TRUE;
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Called from unlinkClause(), which is called for retracting a clause from
 a dynamic predicate which is not  referenced   and  has  few clauses. In
@@ -1530,6 +1813,8 @@ delClauseFromIndex(Definition def, Clause cl)
 
     if ( ISDEADCI(ci) )
       continue;
+    if ( ci->resized )
+      abortIndexResize(ci);
 
     ch  = ci->entries;
     key = indexKeyFromClause(ci, cl, NULL);
@@ -1579,6 +1864,207 @@ completed_index(ClauseIndex ci)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Parallel index construction.  If a predicate has many clauses, the new
+index is filled by multiple threads in two phases:
+
+  1. The clauses are split in ranges and each worker computes the keys
+     of the clauses in its range.
+  2. The buckets are split in ranges and each worker walks over all keys
+     in clause order, adding the clauses that hash to one of its buckets.
+     Clauses without a key are added to all buckets of the worker.
+
+Each bucket is filled by exactly one worker in clause order and thus the
+result is the same as for the sequential loop. No other thread modifies
+the buckets as assert and retract wait for an incomplete index. The
+workers are plain POSIX threads: they only read the compiled clauses and
+use allocHeap(), which does not need a Prolog engine.
+
+The number of workers is limited by the flag `index_threads` and such
+that each worker handles at least PARALLEL_INDEX_CLAUSES clauses. List
+(deep) indexes are always filled sequentially.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef O_PLMT
+
+#define PARALLEL_INDEX_CLAUSES 100000	/* Min # clauses per index worker */
+
+typedef struct index_worker
+{ ClauseIndex	ci;			/* Index we are filling */
+  Clause       *clauses;		/* Clauses to add */
+  word	       *keys;			/* Their keys */
+  size_t	count;			/* # clauses */
+  size_t	from;			/* Phase 1: range of clauses */
+  size_t	to;
+  unsigned int	low;			/* Phase 2: range of buckets */
+  unsigned int	high;
+  unsigned int	size;			/* Phase 2: # indexable clauses */
+  void	       (*work)(struct index_worker *w);
+  int		started;		/* Running in a thread */
+  pthread_t	tid;			/* Thread running the worker */
+} index_worker;
+
+
+static void
+index_keys_worker(index_worker *w)
+{ size_t i;
+
+  for(i=w->from; i<w->to; i++)
+    w->keys[i] = indexKeyFromClause(w->ci, w->clauses[i], NULL);
+}
+
+
+static void
+index_buckets_worker(index_worker *w)
+{ ClauseIndex ci = w->ci;
+  size_t i;
+
+  for(i=0; i<w->count; i++)
+  { Clause cl = w->clauses[i];
+    word key = w->keys[i];
+
+    if ( key == 0 )			/* a non-indexable field */
+    { unsigned int n;
+
+      for(n=w->low; n<w->high; n++)
+	addClauseBucket(&ci->entries[n], cl, key, 0, CL_END, FALSE);
+    } else
+    { unsigned int hi = hashIndex(key, ci->buckets);
+
+      if ( hi >= w->low && hi < w->high )
+	w->size += addClauseBucket(&ci->entries[hi], cl, key, 0, CL_END, FALSE);
+    }
+  }
+}
+
+
+static void *
+index_worker_thread(void *closure)
+{ index_worker *w = closure;
+#ifdef HAVE_SIGPROCMASK
+  sigset_t set;
+  allSignalMask(&set);
+  pthread_sigmask(SIG_BLOCK, &set, NULL);
+#endif
+
+  (*w->work)(w);
+
+  return NULL;
+}
+
+
+/* Run the workers. The calling thread runs the first. If we cannot
+   create a thread, the calling thread does its work.
+*/
+
+static void
+run_index_workers(index_worker *workers, int n, void (*work)(index_worker *w))
+{ int i;
+
+  for(i=0; i<n; i++)
+  { workers[i].work = work;
+    workers[i].started = FALSE;
+  }
+  for(i=1; i<n; i++)
+  { if ( pthread_create(&workers[i].tid, NULL,
+			index_worker_thread, &workers[i]) == 0 )
+      workers[i].started = TRUE;
+  }
+
+  (*work)(&workers[0]);
+
+  for(i=1; i<n; i++)
+  { if ( workers[i].started )
+      pthread_join(workers[i].tid, NULL);
+    else
+      (*work)(&workers[i]);
+  }
+}
+
+
+static int
+addClausesToIndexParallel(ClauseList clist, ClauseIndex ci)
+{ size_t nworkers = GD->thread.index.workers;
+  size_t allocated, count = 0;
+  Clause *clauses;
+  word *keys;
+  index_worker *workers;
+  ClauseRef cref;
+  size_t i;
+
+  if ( ci->is_list )
+    return FALSE;
+  if ( nworkers > clist->number_of_clauses/PARALLEL_INDEX_CLAUSES )
+    nworkers = clist->number_of_clauses/PARALLEL_INDEX_CLAUSES;
+  if ( nworkers > ci->buckets )
+    nworkers = ci->buckets;
+  if ( nworkers < 2 )
+    return FALSE;
+
+  allocated = clist->number_of_clauses + 1024;
+  if ( !(clauses = malloc(allocated*sizeof(*clauses))) )
+    return FALSE;
+  for(cref = clist->first_clause; cref; cref = cref->next)
+  { if ( false(cref->value.clause, CL_ERASED) )
+    { if ( count == allocated )
+      { Clause *nc = realloc(clauses, allocated*2*sizeof(*clauses));
+
+	if ( !nc )
+	{ free(clauses);
+	  return FALSE;
+	}
+	clauses = nc;
+	allocated *= 2;
+      }
+      clauses[count++] = cref->value.clause;
+    }
+  }
+
+  if ( !(keys = malloc(count*sizeof(*keys))) ||
+       !(workers = malloc(nworkers*sizeof(*workers))) )
+  { if ( keys )
+      free(keys);
+    free(clauses);
+    return FALSE;
+  }
+
+  DEBUG(MSG_JIT, Sdprintf("[%d] Filling index using %d workers\n",
+			  PL_thread_self(), (int)nworkers));
+
+  for(i=0; i<nworkers; i++)
+  { index_worker *w = &workers[i];
+
+    w->ci      = ci;
+    w->clauses = clauses;
+    w->keys    = keys;
+    w->count   = count;
+    w->from    = (count*i)/nworkers;
+    w->to      = (count*(i+1))/nworkers;
+    w->low     = (unsigned int)((ci->buckets*i)/nworkers);
+    w->high    = (unsigned int)((ci->buckets*(i+1))/nworkers);
+    w->size    = 0;
+  }
+
+  run_index_workers(workers, (int)nworkers, index_keys_worker);
+  run_index_workers(workers, (int)nworkers, index_buckets_worker);
+
+  for(i=0; i<nworkers; i++)
+    ci->size += workers[i].size;
+
+  free(workers);
+  free(keys);
+  free(clauses);
+
+  return TRUE;
+}
+
+#else /*O_PLMT*/
+
+#define addClausesToIndexParallel(clist, ci) FALSE
+
+#endif /*O_PLMT*/
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Create a hash-index on def  for  arg.   We  compute  the  hash unlocked,
 checking at the end that nobody  messed   with  the clause list. If that
@@ -1591,6 +2077,7 @@ hashDefinition(ClauseList clist, hash_hints *hints, IndexContext ctx)
 { ClauseRef cref;
   ClauseIndex ci;
   ClauseIndex *cip;
+  double t0;
 
   DEBUG(MSG_JIT, Sdprintf("[%d] hashDefinition(%s, %s, %d) (%s)\n",
 			  PL_thread_self(),
@@ -1620,9 +2107,11 @@ hashDefinition(ClauseList clist, hash_hints *hints, IndexContext ctx)
       }
     }
   }
+  t0 = WallTime();
   ci = newClauseIndexTable(hints->args, hints, ctx);
   insertIndex(ctx->predicate, clist, ci);
   UNLOCKDEF(ctx->predicate);
+  INDEX_STAT(ctx, created);
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Adding a pause here creates  a window where other threads may mark clauses
@@ -1634,13 +2123,15 @@ See the test_cgc_1 test case in src/Tests/GC/test_cgc_1.pl
   usleep(1000);
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-  for(cref = clist->first_clause; cref; cref = cref->next)
-  { if ( false(cref->value.clause, CL_ERASED) )
-    { if ( !addClauseToIndex(ci, cref->value.clause, CL_END) )
-      { ci->invalid = TRUE;
-	completed_index(ci);
-	deleteIndex(ctx->predicate, clist, ci);
-	return NULL;
+  if ( !addClausesToIndexParallel(clist, ci) )
+  { for(cref = clist->first_clause; cref; cref = cref->next)
+    { if ( false(cref->value.clause, CL_ERASED) )
+      { if ( !addClauseToIndex(ci, cref->value.clause, CL_END) )
+	{ ci->invalid = TRUE;
+	  completed_index(ci);
+	  deleteIndex(ctx->predicate, clist, ci);
+	  return NULL;
+	}
       }
     }
   }
@@ -1649,11 +2140,182 @@ See the test_cgc_1 test case in src/Tests/GC/test_cgc_1.pl
   ci->resize_below = ci->size/4;
 
   completed_index(ci);
+  metricObserve(MET_INDEX_SECONDS, WallTime()-t0);
+  TRACEPOINT4(index__create,
+	      stringAtom(ctx->predicate->module->name),
+	      stringAtom(ctx->predicate->functor->name),
+	      (int)ctx->predicate->functor->arity,
+	      ci->buckets);
 
   return ci;
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Background index construction.  If the flag `index_background` is set to
+N > 0, a new index for the clause list of a predicate with at least N
+clauses is not built by the thread that found it useful.  Instead, the
+request is queued and the gc thread is asked to build it.  The caller
+continues using the existing indexes or linear scanning and skips
+indexes that are still incomplete rather than waiting for them.  If
+there is no gc thread, the index is built by the caller as usual.
+
+The builder marks the predicate as accessed using acquire_def() while
+filling the index, such that clause GC leaves the clauses alone.
+destroyDefinition() calls forgetIndexRequests(), which drops pending
+requests and waits for a running build on the predicate to complete.
+Requests are protected by GD->thread.index.mutex.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef O_PLMT
+
+typedef struct index_request
+{ struct index_request *next;		/* Next in queue */
+  Definition	definition;		/* Predicate to index */
+  hash_hints	hints;			/* Index to create */
+} index_request;
+
+static index_request *index_requests;	/* Pending requests */
+static index_request *index_building;	/* Request being processed */
+
+/* queueIndexRequest() returns TRUE if the index will be built by the
+   gc thread.  The request must be in the queue before we signal the gc
+   thread, or the gc thread may find an empty queue and go back to sleep.
+   If the gc thread cannot be signalled we withdraw the request, so the
+   caller builds the index itself.
+*/
+
+static int
+same_request(const index_request *r, Definition def, const hash_hints *hints)
+{ return ( r->definition == def &&
+	   memcmp(r->hints.args, hints->args, sizeof(hints->args)) == 0 );
+}
+
+static int
+queueIndexRequest(ClauseList clist, hash_hints *hints, IndexContext ctx)
+{ Definition def = ctx->predicate;
+  index_request *r, **rp;
+
+  if ( !BACKGROUND_INDEX(clist, ctx) )
+    return FALSE;
+
+  canonicalHap(hints->args);
+  pthread_mutex_lock(&GD->thread.index.mutex);
+  if ( index_building && same_request(index_building, def, hints) )
+  { pthread_mutex_unlock(&GD->thread.index.mutex);
+    return TRUE;
+  }
+  for(rp = &index_requests; (r=*rp); rp = &r->next)
+  { if ( same_request(r, def, hints) )
+    { pthread_mutex_unlock(&GD->thread.index.mutex);
+      return TRUE;
+    }
+  }
+  r = allocHeapOrHalt(sizeof(*r));
+  r->next = NULL;
+  r->definition = def;
+  r->hints = *hints;
+  *rp = r;
+  pthread_mutex_unlock(&GD->thread.index.mutex);
+
+  if ( !signalIndexBuilder() )
+  { index_request *r2;
+
+    pthread_mutex_lock(&GD->thread.index.mutex);
+    for(rp = &index_requests; (r2=*rp); rp = &r2->next)
+    { if ( r2 == r )
+      { *rp = r->next;
+	freeHeap(r, sizeof(*r));
+	break;
+      }
+    }
+    pthread_mutex_unlock(&GD->thread.index.mutex);
+
+    return FALSE;
+  }
+
+  DEBUG(MSG_JIT, Sdprintf("[%d] Queued index %s for %s\n",
+			  PL_thread_self(),
+			  iargsName(hints->args, NULL),
+			  predicateName(def)));
+
+  return TRUE;
+}
+
+
+void
+forgetIndexRequests(Definition def)
+{ index_request *r, **rp;
+
+  pthread_mutex_lock(&GD->thread.index.mutex);
+  for(rp = &index_requests; (r=*rp); )
+  { if ( r->definition == def )
+    { *rp = r->next;
+      freeHeap(r, sizeof(*r));
+    } else
+    { rp = &r->next;
+    }
+  }
+  while ( index_building && index_building->definition == def )
+    pthread_cond_wait(&GD->thread.index.cond, &GD->thread.index.mutex);
+  pthread_mutex_unlock(&GD->thread.index.mutex);
+}
+
+
+/** '$build_indexes'
+ *
+ * Build all queued indexes.  Called by the gc thread.
+ */
+
+static
+PRED_IMPL("$build_indexes", 0, build_indexes, 0)
+{ PRED_LD
+
+  for(;;)
+  { index_request *r;
+    Definition def;
+    index_context ctx;
+
+    pthread_mutex_lock(&GD->thread.index.mutex);
+    if ( (r=index_requests) )
+    { index_requests = r->next;
+      index_building = r;
+    }
+    pthread_mutex_unlock(&GD->thread.index.mutex);
+    if ( !r )
+      return TRUE;
+
+    def = r->definition;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.predicate   = def;
+    ctx.generation  = global_generation();
+    ctx.position[0] = END_INDEX_POS;
+
+    acquire_def(def);
+    hashDefinition(&def->impl.clauses, &r->hints, &ctx);
+    release_def(def);
+
+    pthread_mutex_lock(&GD->thread.index.mutex);
+    index_building = NULL;
+    pthread_cond_broadcast(&GD->thread.index.cond);
+    pthread_mutex_unlock(&GD->thread.index.mutex);
+    freeHeap(r, sizeof(*r));
+
+    if ( PL_handle_signals() < 0 )
+      return FALSE;
+  }
+}
+
+#else /*O_PLMT*/
+
+void
+forgetIndexRequests(Definition def)
+{ (void)def;
+}
+
+#endif /*O_PLMT*/
+
+
 static ClauseIndex *
 copyIndex(ClauseIndex *org, int extra)
 { ClauseIndex *ncip;
@@ -1757,8 +2419,14 @@ setIndexes(Definition def, ClauseList cl, ClauseIndex *cip)
   MEMORY_BARRIER();
   cl->clause_indexes = cip;
   if ( cipo )
-    linger(&def->lingering, unalloc_index_array, cipo);
-}
+  { ClauseIndex *p;
+
+    for(p=cipo; *p; p++)
+      ;
+    linger(&def->lingering, unalloc_index_array, cipo,
+	   (p-cipo+1)*sizeof(*cipo));
+  }
+}
 
 
 /* Caller must have the predicate locked */
@@ -1792,7 +2460,7 @@ replaceIndex(Definition def, ClauseList cl, ClauseIndex *cip, ClauseIndex ci)
       }
     }
 
-    linger(&def->lingering, unalloc_ci, old);
+    linger(&def->lingering, unalloc_ci, old, sizeofClauseIndex(old));
   }
 
   if ( !isSortedIndexes(cl->clause_indexes) )
@@ -2391,7 +3059,7 @@ assess_scan_clauses(ClauseList clist, size_t arity,
   for(i=0, a=assessments; i<assess_count; i++, a++)
   { int j;
 
-    for(j=0; a->args[j]; j++)
+    for(j=0; j<MAX_MULTI_INDEX && a->args[j]; j++)
     { if ( !true_bit(ai, a->args[j]-1) )
       { set_bit(ai, a->args[j]-1);
 	ac++;
@@ -2443,7 +3111,7 @@ assess_scan_clauses(ClauseList clist, size_t arity,
       { word key[MAX_MULTI_INDEX];
 	int  harg;
 
-	for(harg=0; a->args[harg]; harg++)
+	for(harg=0; harg<MAX_MULTI_INDEX && a->args[harg]; harg++)
 	{ if ( !(key[harg] = keys[a->args[harg]-1]) )
 	  { a->var_count++;
 	    goto next_assessment;
@@ -2477,6 +3145,84 @@ best_assessment(hash_assessment *assessments, int count, size_t clause_count)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+extend_multi_index() is called after bestHash()  found that a pair of
+arguments is the best multi-argument  key.  If   the  expected  chains are
+still long, try to add one of  the   remaining  promising  arguments to
+the key. We keep extending as long as   this improves the speedup by at
+least MIN_SPEEDUP and the key does not exceed MAX_MULTI_INDEX arguments.
+This deals with wide fact tables  where   no  small  set of arguments is
+selective enough.
+
+Each step requires a scan over the  clauses,   but  all  candidates for
+that step are assessed in the same scan.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+is_index_arg(const iarg_t *args, iarg_t an)
+{ int i;
+
+  for(i=0; i<MAX_MULTI_INDEX && args[i]; i++)
+  { if ( args[i] == an )
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+
+static void
+extend_multi_index(ClauseList clist, size_t ac,
+		   const iarg_t *instantiated, int ok,
+		   hash_hints *hints, IndexContext ctx)
+{ int nargs;
+
+  for(nargs=0; nargs<MAX_MULTI_INDEX && hints->args[nargs]; nargs++)
+    ;
+
+  while ( nargs < MAX_MULTI_INDEX &&
+	  (float)clist->number_of_clauses/hints->speedup > 3 )
+  { assessment_set aset;
+    hash_assessment *nbest;
+    iarg_t ia[MAX_MULTI_INDEX];
+    int i, extended = FALSE;
+
+    init_assessment_set(&aset);
+    for(i=0; i<ok; i++)
+    { iarg_t an = instantiated[i]+1;
+
+      if ( !is_index_arg(hints->args, an) )
+      { memcpy(ia, hints->args, sizeof(ia));
+	ia[nargs] = an;
+	alloc_assessment(&aset, ia);
+      }
+    }
+
+    if ( aset.count > 0 )
+    { assess_scan_clauses(clist, ac, aset.assessments, aset.count, ctx);
+      nbest = best_assessment(aset.assessments, aset.count,
+			      clist->number_of_clauses);
+      if ( nbest && nbest->speedup > hints->speedup*MIN_SPEEDUP )
+      { DEBUG(MSG_JIT, Sdprintf("%s: extending index to %s, speedup = %f\n",
+				predicateName(ctx->predicate),
+				iargsName(nbest->args, NULL),
+				nbest->speedup));
+	memcpy(hints->args, nbest->args, sizeof(nbest->args));
+	hints->ln_buckets = MSB(nbest->size);
+	hints->speedup    = nbest->speedup;
+	nargs++;
+	extended = TRUE;
+      }
+      free_keys_in_assessment_set(&aset);
+    }
+    free_assessment_set(&aset);
+
+    if ( !extended )
+      break;
+  }
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 bestHash() finds the best argument for creating a hash, given a concrete
 argument vector and a list of  clauses.   To  do  so, it establishes the
@@ -2626,6 +3372,10 @@ bestHash(Word av, size_t ac, ClauseList clist, float min_speedup,
 
         free_keys_in_assessment_set(&aset);
 	free_assessment_set(&aset);
+
+	if ( ok > 2 )
+	  extend_multi_index(clist, ac, instantiated, ok, hints, ctx);
+
 	return TRUE;
       }
       free_keys_in_assessment_set(&aset);
@@ -2649,6 +3399,95 @@ bestHash(Word av, size_t ac, ClauseList clist, float min_speedup,
 }
 
 
+		 /*******************************
+		 *	 SAVED INDEXES		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Saved states may record the  JIT  indexes   that  exist  on a predicate,
+such that these can be recreated right after  the predicate is loaded
+rather than by the first call.  The clause references inside an index are
+not position independent, so we save the  index specification and build
+the table on load.  This  skips  the   (expensive)  assessment  and moves
+creating the index out of the first query.
+
+getIndexHints() fills hints with the specification of the top-level hash
+indexes of def and returns the number of filled entries.
+createIndexFromHints() creates an index from  such a specification. It
+returns FALSE if the specification does not apply to def.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+getIndexHints(Definition def, hash_hints *hints, int max)
+{ GET_LD
+  ClauseIndex *cip;
+  int n = 0;
+
+  if ( true(def, P_FOREIGN|P_THREAD_LOCAL) )
+    return 0;
+
+  acquire_def(def);
+  if ( (cip=def->impl.clauses.clause_indexes) )
+  { for(; *cip && n < max; cip++)
+    { ClauseIndex ci = *cip;
+      hash_hints *h = &hints[n];
+
+      if ( ISDEADCI(ci) || ci->incomplete || ci->invalid )
+	continue;
+
+      memset(h, 0, sizeof(*h));
+      memcpy(h->args, ci->args, sizeof(h->args));
+      h->ln_buckets = MSB(ci->buckets)-1;
+      h->list       = ci->is_list;
+      h->speedup    = ci->speedup;
+      n++;
+    }
+  }
+  release_def(def);
+
+  return n;
+}
+
+
+int
+createIndexFromHints(Definition def, hash_hints *hints)
+{ GET_LD
+  ClauseList clist = &def->impl.clauses;
+  index_context ctx;
+  ClauseIndex ci;
+  int i, nargs;
+
+  if ( true(def, P_FOREIGN|P_THREAD_LOCAL) ||
+       (LD->gen_reload && !LD->transaction.generation) ||
+       clist->number_of_clauses == 0 )
+    return FALSE;
+
+  for(nargs=0; nargs<MAX_MULTI_INDEX && hints->args[nargs]; nargs++)
+  { if ( hints->args[nargs] > def->functor->arity ||
+	 hints->args[nargs] > MAXINDEXARG )
+      return FALSE;
+  }
+  if ( nargs == 0 || (hints->list && nargs > 1) ||
+       hints->ln_buckets > 30 || !(hints->speedup > 0.0) )
+    return FALSE;
+  for(i=nargs; i<MAX_MULTI_INDEX; i++)
+    hints->args[i] = 0;
+
+  ctx.generation  = global_generation();
+  ctx.predicate   = def;
+  ctx.chp         = NULL;
+  ctx.depth       = 0;
+  ctx.stats       = NULL;
+  ctx.position[0] = END_INDEX_POS;
+
+  acquire_def(def);
+  ci = hashDefinition(clist, hints, &ctx);
+  release_def(def);
+
+  return ci != NULL;
+}
+
+
 		 /*******************************
 		 *  PREDICATE PROPERTY SUPPORT	*
 		 *******************************/
@@ -2702,6 +3541,7 @@ sizeofClauseIndexes(Definition def)
       size += sizeofClauseIndex(ci);
     }
   }
+  release_def(def);
 
   return size;
 }
@@ -2837,6 +3677,529 @@ unify_index_pattern(Procedure proc, term_t value)
 out:
   release_def(def);
 
+  return rc;
+}
+
+
+bool
+unify_index_statistics(Procedure proc, term_t value)
+{ GET_LD
+  Definition def = getProcDefinition__LD(proc->definition PASS_LD);
+  index_stats *s;
+
+  if ( (s=def->index_stats) )
+  { const struct
+    { const char *name;
+      uint64_t	  value;
+    } *c, counters[] =
+    { { "calls",     s->calls },
+      { "indexed",   s->indexed },
+      { "first_arg", s->first_arg },
+      { "linear",    s->linear },
+      { "tried",     s->tried },
+      { "visited",   s->visited },
+      { "created",   s->created },
+      { NULL,	     0 }
+    };
+    term_t tail = PL_copy_term_ref(value);
+    term_t head = PL_new_term_ref();
+
+    for(c=counters; c->name; c++)
+    { if ( !PL_unify_list(tail, head, tail) ||
+	   !PL_unify_term(head,
+			  PL_FUNCTOR_CHARS, c->name, 1,
+			    PL_INT64, (int64_t)c->value) )
+	return FALSE;
+    }
+
+    return PL_unify_nil(tail);
+  }
+
+  return FALSE;
+}
+
+
+		 /*******************************
+		 *	   RANGE INDEXES	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A range index is a sorted array  of   the  distinct constant keys of an
+argument of a predicate. It is used by  call_range/4 to enumerate the keys
+between two bounds in the  standard  order   of  terms,  after which the
+predicate is called with the argument bound   to  each of these keys. In
+other words, a range query is translated into a sequence of lookups that
+use the normal JIT (hash) indexes.
+
+The array does not reference clauses and  is rebuilt lazily if the
+predicate was modified after it was created,  which makes it suitable
+for static predicates and dynamic predicates that are queried much more
+often than they are modified. An index is  invalid if some clause may
+match any key for the argument (variable)   or  the argument holds big
+integers or rationals. In that case '$range_keys'/5  fails and the caller
+falls back to calling the goal and filtering the results.
+
+The array is built outside the  lock.   Finding,  replacing and copying
+keys from the array is done while holding LOCKDEF().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define RK_INT		0		/* range_key types */
+#define RK_FLOAT	1
+#define RK_ATOM		2
+
+#define RK_KEY		0		/* rangeKeyFromCode() results */
+#define RK_STRING	1
+#define RK_COMPOUND	2
+#define RK_NOKEY	3
+
+#define RI_INVALID	0x1		/* Index cannot be used */
+
+typedef struct range_key
+{ int		type;			/* RK_INT, RK_FLOAT or RK_ATOM */
+  union
+  { int64_t	i;
+    double	f;
+    atom_t	a;
+  } value;
+} range_key;
+
+typedef struct range_index
+{ struct range_index *next;		/* Index for next argument */
+  unsigned int	arg;			/* Indexed argument (1-based) */
+  unsigned int	flags;			/* RI_* */
+  gen_t		generation;		/* def->last_modified when built */
+  size_t	count;			/* # distinct keys */
+  range_key    *keys;			/* Sorted keys */
+} range_index;
+
+
+static int
+rangeKeyFromCode(Code PC, range_key *key)
+{ for(;;)
+  { code c = decode(*PC++);
+
+#ifdef O_DEBUGGER
+  again:
+#endif
+    switch(c)
+    { case H_ATOM:
+	key->type = RK_ATOM;
+	key->value.a = (atom_t)*PC;
+	return RK_KEY;
+      case H_NIL:
+	key->type = RK_ATOM;
+	key->value.a = ATOM_nil;
+	return RK_KEY;
+      case H_SMALLINT:
+	key->type = RK_INT;
+	key->value.i = valInt((word)*PC);
+	return RK_KEY;
+      case H_INTEGER:
+	key->type = RK_INT;
+	key->value.i = (int64_t)(intptr_t)*PC;
+	return RK_KEY;
+#if SIZEOF_VOIDP == 4
+      case H_INT64:			/* only on 32-bit hardware! */
+	key->type = RK_INT;
+	memcpy(&key->value.i, PC, sizeof(int64_t));
+	return RK_KEY;
+#endif
+      case H_FLOAT:
+	key->type = RK_FLOAT;
+	memcpy(&key->value.f, PC, sizeof(double));
+	return isnan(key->value.f) ? RK_NOKEY : RK_KEY;
+      case H_STRING:
+	return RK_STRING;
+      case H_FUNCTOR:
+      case H_RFUNCTOR:
+      case H_LIST_FF:
+      case H_LIST:
+      case H_RLIST:
+	return RK_COMPOUND;
+      case I_NOP:
+	continue;
+#ifdef O_DEBUGGER
+      case D_BREAK:
+	c = decode(replacedBreak(PC-1));
+	goto again;
+#endif
+      default:				/* variables, MPZ, MPQ */
+	return RK_NOKEY;
+    }
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Compare two keys in the standard order of terms: numbers by value, where
+a float is before an integer if they compare equal, followed by atoms.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+cmpRangeKeys(const range_key *k1, const range_key *k2)
+{ if ( k1->type == RK_ATOM || k2->type == RK_ATOM )
+  { if ( k1->type != k2->type )
+      return k1->type == RK_ATOM ? CMP_GREATER : CMP_LESS;
+    if ( k1->value.a == k2->value.a )
+      return CMP_EQUAL;
+    return compareAtoms(k1->value.a, k2->value.a);
+  } else if ( k1->type == RK_FLOAT && k2->type == RK_FLOAT )
+  { double f1 = k1->value.f;
+    double f2 = k2->value.f;
+
+    if ( f1 < f2 )
+      return CMP_LESS;
+    if ( f1 > f2 )
+      return CMP_GREATER;
+    if ( signbit(f1) != signbit(f2) )
+      return signbit(f1) ? CMP_LESS : CMP_GREATER;
+    return CMP_EQUAL;
+  } else
+  { number n1, n2;
+    int rc;
+
+    if ( k1->type == RK_INT )
+    { n1.type = V_INTEGER;
+      n1.value.i = k1->value.i;
+    } else
+    { n1.type = V_FLOAT;
+      n1.value.f = k1->value.f;
+    }
+    if ( k2->type == RK_INT )
+    { n2.type = V_INTEGER;
+      n2.value.i = k2->value.i;
+    } else
+    { n2.type = V_FLOAT;
+      n2.value.f = k2->value.f;
+    }
+
+    rc = cmpNumbers(&n1, &n2);
+    if ( rc == CMP_EQUAL && k1->type != k2->type )
+      rc = (k1->type == RK_FLOAT ? CMP_LESS : CMP_GREATER);
+
+    return rc;
+  }
+}
+
+
+static int
+same_range_key(const range_key *k1, const range_key *k2)
+{ if ( k1->type != k2->type )
+    return FALSE;
+
+  switch(k1->type)
+  { case RK_INT:
+      return k1->value.i == k2->value.i;
+    case RK_FLOAT:
+      return memcmp(&k1->value.f, &k2->value.f, sizeof(double)) == 0;
+    default:
+      return k1->value.a == k2->value.a;
+  }
+}
+
+
+/* Sorting uses the atom handle as tie-breaker, such that identical keys
+   are adjacent even if compareAtoms() considers two blobs equal.
+*/
+
+static int
+cmp_range_key(const void *p1, const void *p2)
+{ const range_key *k1 = p1;
+  const range_key *k2 = p2;
+  int rc = cmpRangeKeys(k1, k2);
+
+  if ( rc == CMP_EQUAL && k1->type == RK_ATOM && k1->value.a != k2->value.a )
+    rc = k1->value.a < k2->value.a ? CMP_LESS : CMP_GREATER;
+
+  return rc;
+}
+
+
+static void
+freeRangeIndex(range_index *ri)
+{ if ( ri->keys )
+  { size_t i;
+
+    for(i=0; i<ri->count; i++)
+    { if ( ri->keys[i].type == RK_ATOM )
+	PL_unregister_atom(ri->keys[i].value.a);
+    }
+    free(ri->keys);
+  }
+  freeHeap(ri, sizeof(*ri));
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+buildRangeIndex() scans the clauses of def   for the keys of argument arg.
+The atoms are registered before we  release   the  predicate, as clause
+garbage collection may otherwise drop the last reference to them.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static range_index *
+buildRangeIndex(Definition def, unsigned int arg)
+{ GET_LD
+  range_index *ri = allocHeapOrHalt(sizeof(*ri));
+  size_t allocated = 0;
+  ClauseRef cref;
+
+  memset(ri, 0, sizeof(*ri));
+  ri->arg = arg;
+
+  acquire_def(def);
+  ri->generation = def->last_modified;
+  for(cref = def->impl.clauses.first_clause; cref; cref = cref->next)
+  { Clause cl = cref->value.clause;
+    Code PC = cl->codes;
+    range_key key;
+
+    if ( true(cl, CL_ERASED) )
+      continue;
+    if ( arg > 1 )
+      PC = skipArgs(PC, arg-1);
+
+    switch(rangeKeyFromCode(PC, &key))
+    { case RK_KEY:
+	if ( ri->count == allocated )
+	{ size_t na = (allocated ? allocated*2 : 16);
+	  range_key *nk = realloc(ri->keys, na*sizeof(*nk));
+
+	  if ( !nk )
+	  { ri->flags |= RI_INVALID;
+	    goto out;
+	  }
+	  ri->keys = nk;
+	  allocated = na;
+	}
+	ri->keys[ri->count++] = key;
+	break;
+      case RK_STRING:			/* always above the atoms */
+      case RK_COMPOUND:
+	break;
+      default:
+	ri->flags |= RI_INVALID;
+	goto out;
+    }
+  }
+
+  if ( ri->count > 0 )
+  { size_t i, o;
+
+    qsort(ri->keys, ri->count, sizeof(*ri->keys), cmp_range_key);
+    for(i=1, o=1; i<ri->count; i++)
+    { if ( !same_range_key(&ri->keys[i], &ri->keys[o-1]) )
+	ri->keys[o++] = ri->keys[i];
+    }
+    ri->count = o;
+
+    for(i=0; i<ri->count; i++)
+    { if ( ri->keys[i].type == RK_ATOM )
+	PL_register_atom(ri->keys[i].value.a);
+    }
+  }
+
+out:
+  release_def(def);
+  if ( (ri->flags&RI_INVALID) && ri->keys )
+  { free(ri->keys);
+    ri->keys = NULL;
+    ri->count = 0;
+  }
+
+  DEBUG(MSG_JIT,
+	Sdprintf("Created range index for arg %d of %s: %zd keys%s\n",
+		 arg, predicateName(def), ri->count,
+		 (ri->flags&RI_INVALID) ? " (invalid)" : ""));
+
+  return ri;
+}
+
+
+/* Must be called with LOCKDEF() held */
+
+static range_index *
+replaceRangeIndex(Definition def, range_index *ri)
+{ range_index **rip;
+
+  for(rip = &def->range_indexes; *rip; rip = &(*rip)->next)
+  { range_index *old = *rip;
+
+    if ( old->arg == ri->arg )
+    { *rip = old->next;
+      freeRangeIndex(old);
+      break;
+    }
+  }
+
+  ri->next = def->range_indexes;
+  def->range_indexes = ri;
+
+  return ri;
+}
+
+
+void
+deleteRangeIndexes(Definition def)
+{ range_index *ri, *next;
+
+  for(ri = def->range_indexes; ri; ri = next)
+  { next = ri->next;
+    freeRangeIndex(ri);
+  }
+  def->range_indexes = NULL;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Copy the keys in [low,high] to  a   malloc()ed  array.  The atoms in the
+copy are registered as the index may be  replaced as soon as we release
+the lock. Must be called with LOCKDEF() held.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static size_t
+lowerRangeBound(const range_index *ri, const range_key *key, int strict)
+{ size_t lo = 0, hi = ri->count;
+
+  while( lo < hi )
+  { size_t mid = lo + (hi-lo)/2;
+    int rc = cmpRangeKeys(&ri->keys[mid], key);
+
+    if ( rc < 0 || (strict && rc == 0) )
+      lo = mid+1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+
+static int
+copyRangeKeys(const range_index *ri, const range_key *low,
+	      const range_key *high, range_key **keys, size_t *count)
+{ size_t from = lowerRangeBound(ri, low, FALSE);
+  size_t to   = lowerRangeBound(ri, high, TRUE);
+
+  *keys = NULL;
+  *count = 0;
+
+  if ( to > from )
+  { size_t i;
+
+    if ( !(*keys = malloc((to-from)*sizeof(**keys))) )
+      return PL_no_memory();
+    memcpy(*keys, &ri->keys[from], (to-from)*sizeof(**keys));
+    *count = to-from;
+
+    for(i=0; i<*count; i++)
+    { if ( (*keys)[i].type == RK_ATOM )
+	PL_register_atom((*keys)[i].value.a);
+    }
+  }
+
+  return TRUE;
+}
+
+
+static int
+get_range_key(term_t t, range_key *key ARG_LD)
+{ if ( PL_get_atom(t, &key->value.a) )
+  { key->type = RK_ATOM;
+    return TRUE;
+  } else if ( PL_is_float(t) )
+  { key->type = RK_FLOAT;
+    return PL_get_float(t, &key->value.f) && !isnan(key->value.f);
+  } else if ( PL_is_integer(t) )
+  { key->type = RK_INT;
+    return PL_get_int64(t, &key->value.i);
+  }
+
+  return FALSE;
+}
+
+
+static int
+put_range_key(term_t t, const range_key *key ARG_LD)
+{ switch(key->type)
+  { case RK_INT:
+      return PL_put_int64(t, key->value.i);
+    case RK_FLOAT:
+      return PL_put_float(t, key->value.f);
+    default:
+      return PL_put_atom(t, key->value.a);
+  }
+}
+
+
+/** '$range_keys'(:Head, +Arg, +Low, +High, -Keys) is semidet.
+ *
+ * Keys is the sorted list of distinct  values for argument Arg of the
+ * clauses of Head that are in  the   range  [Low,High] in the standard
+ * order of terms. Fails if the range   index cannot be used, in which
+ * case the caller must enumerate all clauses.
+ */
+
+static
+PRED_IMPL("$range_keys", 5, range_keys, PL_FA_TRANSPARENT)
+{ PRED_LD
+  Procedure proc;
+  Definition def;
+  range_index *ri;
+  range_key low, high;
+  range_key *keys = NULL;
+  size_t count = 0;
+  int arg;
+  int rc = FALSE;
+
+  if ( !get_procedure(A1, &proc, 0, GP_FIND) ||
+       !isDefinedProcedure(proc) ||
+       !PL_get_integer(A2, &arg) )
+    return FALSE;
+  def = getProcDefinition(proc);
+  if ( true(def, P_FOREIGN) ||
+       arg < 1 || arg > (int)def->functor->arity ||
+       !get_range_key(A3, &low PASS_LD) ||
+       !get_range_key(A4, &high PASS_LD) )
+    return FALSE;
+
+  LOCKDEF(def);
+  for(ri = def->range_indexes; ri; ri = ri->next)
+  { if ( ri->arg == (unsigned int)arg )
+      break;
+  }
+  if ( !ri || ri->generation != def->last_modified )
+  { range_index *nri;
+
+    UNLOCKDEF(def);
+    nri = buildRangeIndex(def, arg);
+    LOCKDEF(def);
+    ri = replaceRangeIndex(def, nri);
+  }
+  if ( !(ri->flags&RI_INVALID) )
+    rc = copyRangeKeys(ri, &low, &high, &keys, &count);
+  UNLOCKDEF(def);
+
+  if ( rc )
+  { term_t tail = PL_copy_term_ref(A5);
+    term_t head = PL_new_term_ref();
+    term_t tmp  = PL_new_term_ref();
+    size_t i;
+
+    for(i=0; rc && i<count; i++)
+    { rc = ( put_range_key(tmp, &keys[i] PASS_LD) &&
+	     PL_unify_list(tail, head, tail) &&
+	     PL_unify(head, tmp) );
+    }
+    rc = rc && PL_unify_nil(tail);
+
+    for(i=0; i<count; i++)
+    { if ( keys[i].type == RK_ATOM )
+	PL_unregister_atom(keys[i].value.a);
+    }
+    if ( keys )
+      free(keys);
+  }
+
   return rc;
 }
 
@@ -2846,4 +4209,8 @@ out:
 		 *******************************/
 
 BeginPredDefs(index)
+  PRED_DEF("$range_keys", 5, range_keys, PL_FA_TRANSPARENT)
+#ifdef O_PLMT
+  PRED_DEF("$build_indexes", 0, build_indexes, 0)
+#endif
 EndPredDefs
@@ -76,6 +76,9 @@ option  parsing,  initialisation  and  handling  of errors and warnings.
 static int	usage(void);
 static int	giveVersionInfo(const char *a);
 static bool	vsysError(const char *fm, va_list args);
+static void	writeStartupTrace(void);
+
+static double	startup_time;		/* WallTime() at PL_initialise() */
 
 #define	optionString(s) { if (argc > 1) \
 			  { if ( s ) remove_string(s); \
@@ -603,6 +606,7 @@ static void
 initDefaultOptions(void)
 { GD->options.compileOut       = store_string("a.out");
   GD->options.stackLimit       = systemDefaults.stack_limit;
+  GD->options.stackReserve     = TRUE;
   GD->options.tableSpace       = systemDefaults.table_space;
 #ifdef O_PLMT
   GD->options.sharedTableSpace = systemDefaults.shared_table_space;
@@ -637,7 +641,7 @@ initDefaultOptions(void)
 int
 setTraditional(void)
 { GD->options.traditional = TRUE;
-  if ( GD->atoms.table )
+  if ( GD->atoms.tables[0] )
     resetListAtoms();
 
   return TRUE;
@@ -765,6 +769,10 @@ parseCommandLineOptions(int argc0, char **argv0, char **argvleft, int compile)
 
 	GD->options.sharedTableSpace = size;
 #endif
+      } else if ( (optval=is_longopt(s, "startup_trace")) )
+      { if ( !*optval )
+	  return -1;
+	GD->options.startupTrace = store_string(optval);
       } else if ( (optval=is_longopt(s, "dump-runtime-variables")) )
       { GD->options.config = store_string(optval);
       } else if ( !compile )
@@ -951,6 +959,7 @@ PL_initialise(int argc, char **argv)
 
   initAlloc();
   initPrologThreads();			/* initialise thread system */
+  startup_time = WallTime();		/* Requires LD */
   SinitStreams();
 
   GD->cmdline.os_argc = argc;
@@ -1074,10 +1083,18 @@ PL_initialise(int argc, char **argv)
   { IOSTREAM *statefd = SopenZIP(GD->resources.DB, "$prolog/state.qlf", RC_RDONLY);
 
     if ( statefd )
-    { GD->bootsession = TRUE;
+    { double t0 = WallTime();
+
+      GD->bootsession = TRUE;
       if ( !loadWicFromStream(rcpath, statefd) )
 	return FALSE;
       GD->bootsession = FALSE;
+      if ( GD->options.startupTrace )
+      { atom_t name = PL_new_atom(rcpath);
+
+	startupTraceAtomEvent(ATOM_state, name, t0);
+	PL_unregister_atom(name);
+      }
 
       Sclose(statefd);
     } else
@@ -1162,6 +1179,7 @@ usage(void)
 #endif
     "    --pce[=bool]             Make the xpce gui available\n",
     "    --pldoc[=port]           Start PlDoc server [at port]\n",
+    "    --startup-trace=file     Write a Chrome trace of the startup\n",
 #ifdef __WINDOWS__
     "    --win-app	          Behave as Windows application\n",
 #endif
@@ -1375,6 +1393,7 @@ cleanupProlog(int rval, int reclaim_memory)
       }
     }
 
+    writeStartupTrace();
     GD->cleaning = CLN_FOREIGN;
     if ( !run_on_halt(&GD->os.on_halt_list, rval) && rval == 0 )
     { if ( ++GD->halt_cancelled	< MAX_HALT_CANCELLED )
@@ -1451,6 +1470,8 @@ emergency:
     cleanupThreads();
 #endif
     cleanupForeign();
+    cleanupArenas();
+    cleanupStackCache();
     cleanupPaths();
     cleanupCodeToAtom();
 #ifdef O_GMP
@@ -1708,10 +1729,203 @@ vwarning(const char *fm, va_list args)
 
 
 
+		 /*******************************
+		 *	   STARTUP TRACE	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+If Prolog is started  using  --startup-trace=File,   we  record the wall
+time used for loading the saved state   and  its QLF parts, loading the
+source files, running directives and running initialization goals. The
+events are written to File in the   Chrome  Trace Event Format when the
+toplevel is started or the system halts, whichever comes first. Nested
+events appear as a call tree in e.g., chrome://tracing or Perfetto.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct startup_event
+{ atom_t	category;		/* Category of the event */
+  char	       *name;			/* UTF-8 name of the event */
+  int		thread;			/* Thread that created the event */
+  double	start;			/* Wall time of start */
+  double	end;			/* Wall time of completion */
+} startup_event;
+
+#define MAX_EVENT_NAME 256		/* Max bytes of an event name */
+
+static buffer startup_events;
+static int    startup_events_initialised = FALSE;
+
+void
+startupTraceEvent(atom_t category, term_t name, double start)
+{ startup_event ev;
+  size_t len;
+  char *s;
+
+  if ( !GD->options.startupTrace )
+    return;
+
+  ev.end = WallTime();
+  if ( !PL_get_nchars(name, &len, &s, CVT_ALL|CVT_WRITEQ|REP_UTF8|BUF_STACK) )
+  { s = "<unknown>";
+    len = strlen(s);
+  }
+  if ( len > MAX_EVENT_NAME )
+  { len = MAX_EVENT_NAME;
+    while( len > 0 && (s[len]&0xc0) == 0x80 ) /* do not split UTF-8 */
+      len--;
+  }
+  ev.name = PL_malloc(len+1);
+  memcpy(ev.name, s, len);
+  ev.name[len] = EOS;
+  ev.category = category;
+  PL_register_atom(category);
+  ev.thread = PL_thread_self();
+  ev.start = start;
+
+  PL_LOCK(L_MISC);
+  if ( !startup_events_initialised )
+  { initBuffer(&startup_events);
+    startup_events_initialised = TRUE;
+  }
+  addBuffer(&startup_events, ev, startup_event);
+  PL_UNLOCK(L_MISC);
+}
+
+
+void
+startupTraceAtomEvent(atom_t category, atom_t name, double start)
+{ GET_LD
+  term_t t;
+
+  if ( GD->options.startupTrace && (t = PL_new_term_ref()) )
+  { PL_put_atom(t, name);
+    startupTraceEvent(category, t, start);
+    PL_reset_term_refs(t);
+  }
+}
+
+
+static void
+writeJSONString(IOSTREAM *fd, const char *s)
+{ Sputc('"', fd);
+  for(; *s; s++)
+  { int c = *s&0xff;
+
+    if ( c == '"' || c == '\\' )
+    { Sputc('\\', fd);
+      Sputc(c, fd);
+    } else if ( c < ' ' )
+      Sfprintf(fd, "\\u%04x", c);
+    else
+      Sputc(c, fd);
+  }
+  Sputc('"', fd);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+writeStartupTrace() writes the recorded events  and   stops  tracing. It
+is called from '$startup_trace_write'/0 before   the toplevel is started
+and from cleanupProlog().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+writeStartupTrace(void)
+{ char *file;
+  IOSTREAM *fd;
+
+  PL_LOCK(L_MISC);
+  file = GD->options.startupTrace;
+  GD->options.startupTrace = NULL;
+  PL_UNLOCK(L_MISC);
+
+  if ( !file )
+    return;
+
+  if ( (fd = Sopen_file(file, "w")) )
+  { startup_event *ev, *top;
+    const char *sep = "";
+
+    fd->encoding = ENC_OCTET;		/* names are UTF-8 */
+    Sfprintf(fd, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    if ( startup_events_initialised )
+    { ev  = baseBuffer(&startup_events, startup_event);
+      top = topBuffer(&startup_events, startup_event);
+
+      for(; ev < top; ev++)
+      { Sfprintf(fd, "%s\n{\"name\":", sep);
+	writeJSONString(fd, ev->name);
+	Sfprintf(fd, ",\"cat\":");
+	writeJSONString(fd, stringAtom(ev->category));
+	Sfprintf(fd, ",\"ph\":\"X\",\"ts\":%.0f,\"dur\":%.0f,"
+		 "\"pid\":1,\"tid\":%d}",
+		 (ev->start-startup_time)*1000000.0,
+		 (ev->end-ev->start)*1000000.0,
+		 ev->thread);
+	sep = ",";
+	PL_free(ev->name);
+	PL_unregister_atom(ev->category);
+      }
+      discardBuffer(&startup_events);
+      startup_events_initialised = FALSE;
+    }
+    Sfprintf(fd, "\n]}\n");
+    if ( Sclose(fd) != 0 )
+      warning("Could not write startup trace to %s", file);
+  } else
+  { warning("Could not open %s for writing the startup trace: %s",
+	    file, OsError());
+  }
+
+  remove_string(file);
+}
+
+
+/** '$startup_tracing' is semidet.
+ * True if Prolog was started using --startup-trace=File and the trace
+ * is not yet written.
+ */
+
+static
+PRED_IMPL("$startup_tracing", 0, startup_tracing, 0)
+{ return GD->options.startupTrace != NULL;
+}
+
+
+/** '$startup_trace_event'(+Category, +Name, +Start) is det.
+ * Record the completion of an event that started at wall time Start.
+ */
+
+static
+PRED_IMPL("$startup_trace_event", 3, startup_trace_event, 0)
+{ PRED_LD
+  atom_t category;
+  double start;
+
+  if ( !PL_get_atom_ex(A1, &category) ||
+       !PL_get_float_ex(A3, &start) )
+    return FALSE;
+
+  startupTraceEvent(category, A2, start);
+  return TRUE;
+}
+
+
+static
+PRED_IMPL("$startup_trace_write", 0, startup_trace_write, 0)
+{ writeStartupTrace();
+
+  return TRUE;
+}
+
+
 		 /*******************************
 		 *      PUBLISH PREDICATES	*
 		 *******************************/
 
 BeginPredDefs(init)
   PRED_DEF("$usage", 0, usage, 0)
+  PRED_DEF("$startup_tracing", 0, startup_tracing, 0)
+  PRED_DEF("$startup_trace_event", 3, startup_trace_event, 0)
+  PRED_DEF("$startup_trace_write", 0, startup_trace_write, 0)
 EndPredDefs
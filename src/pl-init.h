@@ -71,11 +71,16 @@ typedef struct
   opt_list     *scriptFiles;
   opt_list     *search_paths;		/* -p path */
   char *	pldoc_server;		/* --pldoc=Server */
+  char *	startupTrace;		/* --startup-trace=File */
   char *	compileOut;		/* file to store compiler output */
   char *	saveclass;		/* Type of saved state */
   bool		silent;			/* -q: quiet operation */
   bool		traditional;		/* --traditional: no version 7 exts */
   bool		nothreads;		/* --no-threads */
+  bool		stackHugePages;		/* Flag stack_huge_pages */
+  bool		stackNumaBind;		/* Flag stack_numa_bind */
+  bool		stackReserve;		/* Flag stack_reserve */
+  bool		tidyTrail;		/* Flag tidy_trail */
   int		xpce;			/* --no-pce */
 #ifdef __WINDOWS__
   bool		win_app;		/* --win_app: be Windows application */
@@ -83,6 +88,9 @@ typedef struct
 } pl_options_t;
 
 COMMON(int)	opt_append(opt_list **l, const char *s);
+COMMON(void)	startupTraceEvent(atom_t category, term_t name, double start);
+COMMON(void)	startupTraceAtomEvent(atom_t category, atom_t name,
+				      double start);
 
 
 		/********************************
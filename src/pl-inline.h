@@ -385,6 +385,20 @@ lookupDefinition(functor_t f, Module m)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+loadedDefinition() ensures that the clauses of   a predicate that is lazy
+loaded from a saved state are loaded. See loadLazyDefinition().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static inline int
+loadedDefinition(Definition def)
+{ if ( unlikely(def->codes == SUPERVISOR(lazy)) )
+    return loadLazyDefinition(def);
+
+  return TRUE;
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Mark() sets LD->mark_bar, indicating  that   any  assignment  above this
 value need not be trailed.
@@ -476,6 +490,32 @@ visibleClauseCNT__LD(Clause cl, gen_t gen ARG_LD)
   return FALSE;
 }
 
+/* firstClauseRef() returns the clause reference from which to start
+   searching the clauses of def that are visible in generation gen.  If
+   the predicate is used as a queue, i.e., clauses are added using
+   assertz/1 and removed from the front using retract/1, the erased
+   clauses accumulate at the start of the list until clause GC removes
+   them.  retractClauseDefinition() maintains the last clause of this
+   prefix of erased clauses and the generation before which all of them
+   were erased, such that we can skip the prefix in O(1).
+
+   The generation is updated before the clause and never decreases, so
+   a concurrent reader may use a stale prefix with a newer generation.
+*/
+
+static inline ClauseRef
+firstClauseRef(Definition def, gen_t gen)
+{ ClauseRef last = def->erased_prefix.last;
+
+  if ( last )
+  { MEMORY_BARRIER();
+    if ( gen >= def->erased_prefix.generation )
+      return last->next;
+  }
+
+  return def->impl.clauses.first_clause;
+}
+
 #ifdef ATOMIC_GENERATION_HACK
 /* Work around lacking 64-bit atomic operations.  These are designed to
    be safe if we assume that read and increment complete before other
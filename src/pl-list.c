@@ -36,6 +36,7 @@
 #include "pl-incl.h"
 #include "pl-arith.h"
 #include "pl-dict.h"
+#include <math.h>
 
 #undef LD
 #define LD LOCAL_LD
@@ -343,6 +344,120 @@ nat_sort(list data, int remove_dups, sort_order order)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+radix_sort() sorts lists whose keys are  all   tagged  integers or all
+floats other than NaN using  an  LSD   radix  sort  on 8-bit digits.
+Keys are mapped to unsigned 64-bit  integers   whose  order is the
+standard order of terms, i.e., -0.0 precedes 0.0 and two floats are
+only equal if they have the same bits.  Digits that are the same for all
+keys are skipped, so sorting small integers  takes two or three passes.
+The sort is stable, which implies that   removing duplicates keeps the
+first element of a sequence  of  equal  keys   as  does  nat_sort().
+Returns NIL if the keys do not qualify or  there is not enough memory,
+in which case the caller uses nat_sort().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define RADIX_SORT_MIN	256		/* Use radix sort from this length */
+
+typedef struct radix_item
+{ uint64_t	key;
+  list		cell;
+} radix_item;
+
+static inline uint64_t
+float_radix_key(double f)
+{ uint64_t bits;
+
+  memcpy(&bits, &f, sizeof(bits));
+
+  return (bits & ((uint64_t)1<<63)) ? ~bits : bits | ((uint64_t)1<<63);
+}
+
+static list
+radix_sort(list data, size_t len, int remove_dups, sort_order order ARG_LD)
+{ radix_item *items, *tmp, *from, *to;
+  size_t counts[8][256];
+  uint64_t kor = 0, kand = ~(uint64_t)0;
+  size_t i;
+  list p;
+  int floats = isFloat(*data->item.key);
+  int d;
+
+  for(p=data; p; p=p->next)
+  { word w = *p->item.key;
+
+    if ( floats )
+    { if ( !isFloat(w) || isnan(valFloat(w)) )
+	return NIL;
+    } else if ( !isTaggedInt(w) )
+    { return NIL;
+    }
+  }
+
+  if ( !(items = malloc(len*2*sizeof(*items))) )
+    return NIL;
+  tmp = items+len;
+
+  memset(counts, 0, sizeof(counts));
+  for(p=data, i=0; p; p=p->next, i++)
+  { word w = *p->item.key;
+    uint64_t k;
+
+    if ( floats )
+      k = float_radix_key(valFloat(w));
+    else
+      k = (uint64_t)(int64_t)valInt(w) ^ ((uint64_t)1<<63);
+    if ( order == SORT_DESC )
+      k = ~k;
+
+    items[i].key  = k;
+    items[i].cell = p;
+    kor  |= k;
+    kand &= k;
+    for(d=0; d<8; d++)
+      counts[d][(k>>(d*8))&0xff]++;
+  }
+
+  from = items;
+  to   = tmp;
+  for(d=0; d<8; d++)
+  { size_t pos = 0;
+    int shift = d*8;
+    int b;
+
+    if ( !(((kor^kand)>>shift)&0xff) )
+      continue;				/* all keys have the same digit */
+
+    for(b=0; b<256; b++)
+    { size_t c = counts[d][b];
+
+      counts[d][b] = pos;
+      pos += c;
+    }
+    for(i=0; i<len; i++)
+      to[counts[d][(from[i].key>>shift)&0xff]++] = from[i];
+
+    { radix_item *t = from; from = to; to = t; }
+  }
+
+  p = from[0].cell;
+  for(i=1; i<len; i++)
+  { if ( remove_dups && from[i].key == from[i-1].key )
+    { FREE(from[i].cell);
+    } else
+    { p->next = from[i].cell;
+      p = from[i].cell;
+    }
+  }
+  p->next = NIL;
+  p = from[0].cell;
+
+  free(items);
+
+  return p;
+}
+
+
 static Word
 extract_key(Word p1, int argc, const word *argv, int pair ARG_LD)
 { if ( pair )
@@ -530,7 +645,14 @@ pl_nat_sort(term_t in, term_t out,
     case SORT_SORT:
     default:
     { term_t tmp = PL_new_term_ref();
-      l = nat_sort(l, remove_dups, order);
+      size_t len = (list)top - l;
+      list sl;
+
+      if ( len >= RADIX_SORT_MIN &&
+	   (sl = radix_sort(l, len, remove_dups, order PASS_LD)) )
+	l = sl;
+      else
+	l = nat_sort(l, remove_dups, order);
       put_sort_list(tmp, l);
       gTop = top;
 
@@ -700,6 +822,402 @@ out:
   return rc;
 }
 
+		 /*******************************
+		 *	  NUMERIC LISTS		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Fast paths for sum_list/2, max_list/2,  min_list/2 and numlist/3 from
+library(lists). They only deal with  proper   lists  of small integers
+and finite floats and  fail  if  anything   else  is  found  or  if the
+computation overflows. The library then uses  its Prolog definition,
+which takes care of the  other  numeric   types,  the  flags and error
+handling. The results must be the same as   the Prolog definition: the
+sum is computed left-to-right and  becomes  a   float  as  soon as a
+float is encountered.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define fast_float_rounding() \
+	((LD->arith.f.flags&FLT_ROUND_MASK) == FLT_ROUND_NEAREST)
+
+/** '$sum_list'(+List, -Sum) is semidet.
+*/
+
+static
+PRED_IMPL("$sum_list", 2, sum_list, 0)
+{ PRED_LD
+  Word l = valTermRef(A1);
+  int64_t isum = 0;
+  double fsum = 0.0;
+  int is_float = FALSE;
+
+  deRef(l);
+  while( isList(*l) )
+  { Word h = HeadList(l);
+
+    deRef(h);
+    if ( isTaggedInt(*h) )
+    { int64_t i = valInt(*h);
+
+      if ( is_float )
+      { fsum += (double)i;
+      } else if ( (isum^i) < 0 ||
+		  (i < 0 ? isum >= PLMININT - i : PLMAXINT - isum >= i) )
+      { isum += i;
+      } else
+	return FALSE;			/* overflow */
+    } else if ( isFloat(*h) )
+    { double f = valFloat(*h);
+
+      if ( !isfinite(f) || !fast_float_rounding() )
+	return FALSE;
+      if ( !is_float )
+      { fsum = (double)isum;
+	is_float = TRUE;
+      }
+      fsum += f;
+    } else
+      return FALSE;
+
+    l = TailList(l);
+    deRef(l);
+  }
+
+  if ( !isNil(*l) )
+    return FALSE;
+
+  if ( is_float )
+    return isfinite(fsum) && PL_unify_float(A2, fsum);
+  else
+    return PL_unify_int64(A2, isum);
+}
+
+
+/* '$max_list'/2 and '$min_list'/2 only handle lists where all elements
+   are small integers or all elements are finite floats.  For floats
+   they mimic max/2 and min/2, where -0.0 < 0.0.
+*/
+
+static int
+min_max_list(term_t list, term_t result, int max ARG_LD)
+{ Word l = valTermRef(list);
+  Word h;
+
+  deRef(l);
+  if ( !isList(*l) )
+    return FALSE;
+  h = HeadList(l);
+  deRef(h);
+
+  if ( isTaggedInt(*h) )
+  { int64_t m = valInt(*h);
+
+    for(;;)
+    { l = TailList(l);
+      deRef(l);
+      if ( !isList(*l) )
+	break;
+      h = HeadList(l);
+      deRef(h);
+      if ( !isTaggedInt(*h) )
+	return FALSE;
+      if ( max ? valInt(*h) > m : valInt(*h) < m )
+	m = valInt(*h);
+    }
+
+    return isNil(*l) && PL_unify_int64(result, m);
+  } else if ( isFloat(*h) )
+  { double m = valFloat(*h);
+
+    if ( !isfinite(m) )
+      return FALSE;
+
+    for(;;)
+    { double f;
+
+      l = TailList(l);
+      deRef(l);
+      if ( !isList(*l) )
+	break;
+      h = HeadList(l);
+      deRef(h);
+      if ( !isFloat(*h) || !isfinite((f=valFloat(*h))) )
+	return FALSE;
+      if ( max )
+      { if ( f > m || (f == m && !(f == 0.0 && signbit(f))) )
+	  m = f;
+      } else
+      { if ( f < m || (f == m && !(m == 0.0 && signbit(m))) )
+	  m = f;
+      }
+    }
+
+    return isNil(*l) && PL_unify_float(result, m);
+  }
+
+  return FALSE;
+}
+
+
+/** '$max_list'(+List, -Max) is semidet.
+ *  '$min_list'(+List, -Min) is semidet.
+*/
+
+static
+PRED_IMPL("$max_list", 2, max_list, 0)
+{ PRED_LD
+
+  return min_max_list(A1, A2, TRUE PASS_LD);
+}
+
+
+static
+PRED_IMPL("$min_list", 2, min_list, 0)
+{ PRED_LD
+
+  return min_max_list(A1, A2, FALSE PASS_LD);
+}
+
+
+/** '$numlist'(+Low, +High, -List) is semidet.
+ *
+ * Create [Low..High] for small integers Low =< High.
+ */
+
+static
+PRED_IMPL("$numlist", 3, numlist, 0)
+{ PRED_LD
+  Word pl = valTermRef(A1);
+  Word ph = valTermRef(A2);
+  int64_t low, high;
+  size_t len;
+
+  deRef(pl);
+  deRef(ph);
+  if ( !isTaggedInt(*pl) || !isTaggedInt(*ph) ||
+       (low=valInt(*pl)) > (high=valInt(*ph)) )
+    return FALSE;
+
+  len = (size_t)(high-low)+1;
+  if ( len > globalStackLimit()/(3*sizeof(word)) )
+    return FALSE;			/* let Prolog raise the error */
+  else
+  { term_t list = PL_new_term_ref();
+    Word p;
+
+    if ( !hasGlobalSpace(len*3) )
+    { int rc;
+
+      if ( (rc=ensureGlobalSpace(len*3, ALLOW_GC)) != TRUE )
+	return raiseStackOverflow(rc);
+    }
+
+    p = gTop;
+    *valTermRef(list) = consPtr(p, TAG_COMPOUND|STG_GLOBAL);
+    for(; len-- > 0; low++)
+    { p[0] = FUNCTOR_dot2;
+      p[1] = consInt(low);
+      p[2] = consPtr(&p[3], TAG_COMPOUND|STG_GLOBAL);
+      p += 3;
+    }
+    p[-1] = ATOM_nil;
+    gTop = p;
+
+    return PL_unify(A3, list);
+  }
+}
+
+
+		 /*******************************
+		 *	   ORDERED SETS		*
+		 *******************************/
+
+/* Support for library(ordsets).  The merges walk both lists once,
+   comparing adjacent elements in the standard order of terms with an
+   inline path for small integers and atoms.  The result is built on
+   the global stack and, where the remainder of an input can be used
+   as is, shares that tail rather than copying it.
+*/
+
+#define ORD_UNION	 0
+#define ORD_INTERSECTION 1
+#define ORD_SUBTRACT	 2
+
+static inline int
+ord_compare(Word p1, Word p2 ARG_LD)
+{ word w1 = *p1;
+  word w2 = *p2;
+
+  if ( isTaggedInt(w1) && isTaggedInt(w2) )
+  { intptr_t i1 = valInt(w1);
+    intptr_t i2 = valInt(w2);
+
+    return i1 < i2 ? CMP_LESS : i1 == i2 ? CMP_EQUAL : CMP_GREATER;
+  }
+  if ( isAtom(w1) && isAtom(w2) )
+    return w1 == w2 ? CMP_EQUAL : compareAtoms(w1, w2);
+
+  return compareStandard(p1, p2, FALSE PASS_LD);
+}
+
+
+static int
+ord_list_length(term_t t, intptr_t *len ARG_LD)
+{ Word tail;
+
+  *len = skip_list(valTermRef(t), &tail PASS_LD);
+  return isNil(*tail);
+}
+
+
+static int
+ord_merge(term_t set1, term_t set2, term_t result, int op ARG_LD)
+{ term_t r = PL_new_term_ref();
+  intptr_t n1, n2;
+  size_t cells;
+  Word l1, l2, p, tail;
+
+  if ( !ord_list_length(set1, &n1 PASS_LD) ||
+       !ord_list_length(set2, &n2 PASS_LD) )
+    return FALSE;			/* let Prolog handle it */
+
+  switch(op)
+  { case ORD_UNION:	   cells = n1+n2;	     break;
+    case ORD_INTERSECTION: cells = n1 < n2 ? n1 : n2; break;
+    default:		   cells = n1;		     break;
+  }
+
+  if ( !hasGlobalSpace(cells*3) )
+  { int rc;
+
+    if ( (rc=ensureGlobalSpace(cells*3, ALLOW_GC)) != TRUE )
+      return raiseStackOverflow(rc);
+  }
+
+  l1 = valTermRef(set1); deRef(l1);
+  l2 = valTermRef(set2); deRef(l2);
+  p = gTop;
+  tail = valTermRef(r);
+
+#define ORD_EMIT(h) \
+	do { *tail = consPtr(p, TAG_COMPOUND|STG_GLOBAL); \
+	     p[0] = FUNCTOR_dot2; \
+	     p[1] = (needsRef(*h) ? makeRef(h) : *h); \
+	     tail = &p[2]; \
+	     p += 3; \
+	   } while(0)
+
+  while ( isList(*l1) && isList(*l2) )
+  { Word h1 = HeadList(l1);
+    Word h2 = HeadList(l2);
+
+    deRef(h1);
+    deRef(h2);
+    switch( ord_compare(h1, h2 PASS_LD) )
+    { case CMP_LESS:
+	if ( op != ORD_INTERSECTION )
+	  ORD_EMIT(h1);
+	l1 = TailList(l1); deRef(l1);
+	break;
+      case CMP_EQUAL:
+	if ( op != ORD_SUBTRACT )
+	  ORD_EMIT(h1);
+	l1 = TailList(l1); deRef(l1);
+	l2 = TailList(l2); deRef(l2);
+	break;
+      case CMP_GREATER:
+	if ( op == ORD_UNION )
+	  ORD_EMIT(h2);
+	l2 = TailList(l2); deRef(l2);
+	break;
+      default:
+	return FALSE;			/* exception in compare */
+    }
+  }
+
+#undef ORD_EMIT
+
+  switch(op)
+  { case ORD_UNION:
+      *tail = isList(*l1) ? *l1 : *l2;
+      break;
+    case ORD_INTERSECTION:
+      *tail = ATOM_nil;
+      break;
+    default:
+      *tail = *l1;
+  }
+  gTop = p;
+
+  return PL_unify(result, r);
+}
+
+
+/** '$ord_union'(+Set1, +Set2, -Union) is semidet.
+ *  '$ord_intersection'(+Set1, +Set2, -Intersection) is semidet.
+ *  '$ord_subtract'(+Set1, +Set2, -Difference) is semidet.
+ *
+ * Merge two ordered sets.  Fail if either is not a proper list.
+ */
+
+static
+PRED_IMPL("$ord_union", 3, ord_union, 0)
+{ PRED_LD
+
+  return ord_merge(A1, A2, A3, ORD_UNION PASS_LD);
+}
+
+static
+PRED_IMPL("$ord_intersection", 3, ord_intersection, 0)
+{ PRED_LD
+
+  return ord_merge(A1, A2, A3, ORD_INTERSECTION PASS_LD);
+}
+
+static
+PRED_IMPL("$ord_subtract", 3, ord_subtract, 0)
+{ PRED_LD
+
+  return ord_merge(A1, A2, A3, ORD_SUBTRACT PASS_LD);
+}
+
+
+/** '$ord_memberchk'(+Item, +Set) is semidet.
+ *
+ * True if Item is in the ordered set Set, comparing as ==/2.
+ */
+
+static
+PRED_IMPL("$ord_memberchk", 2, ord_memberchk, 0)
+{ PRED_LD
+  Word k = valTermRef(A1);
+  Word l = valTermRef(A2);
+  size_t done = 0;
+
+  deRef(k);
+  deRef(l);
+  while ( isList(*l) )
+  { Word h = HeadList(l);
+
+    deRef(h);
+    switch( ord_compare(k, h PASS_LD) )
+    { case CMP_GREATER:
+	break;
+      case CMP_EQUAL:
+	return TRUE;
+      default:
+	return FALSE;
+    }
+    if ( ++done % 10000 == 0 && PL_handle_signals() < 0 )
+      return FALSE;
+    l = TailList(l);
+    deRef(l);
+  }
+
+  return FALSE;
+}
+
+
 		 /*******************************
 		 *      PUBLISH PREDICATES	*
 		 *******************************/
@@ -712,4 +1230,12 @@ BeginPredDefs(list)
   PRED_DEF("msort", 2, msort, 0)
   PRED_DEF("keysort", 2, keysort, PL_FA_ISO)
   PRED_DEF("sort", 4, sort, 0)
+  PRED_DEF("$sum_list", 2, sum_list, 0)
+  PRED_DEF("$max_list", 2, max_list, 0)
+  PRED_DEF("$min_list", 2, min_list, 0)
+  PRED_DEF("$numlist", 3, numlist, 0)
+  PRED_DEF("$ord_union", 3, ord_union, 0)
+  PRED_DEF("$ord_intersection", 3, ord_intersection, 0)
+  PRED_DEF("$ord_subtract", 3, ord_subtract, 0)
+  PRED_DEF("$ord_memberchk", 2, ord_memberchk, 0)
 EndPredDefs
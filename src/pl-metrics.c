@@ -0,0 +1,289 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "pl-incl.h"
+#include "pl-metrics.h"
+#include "os/pl-stream.h"
+
+#undef LD
+#define LD LOCAL_LD
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Runtime metrics.  This module maintains a fixed registry of counters and
+latency histograms that describe the behaviour of the runtime.  Unlike
+statistics/2, the values are monotonic totals  since  the  start  of the
+process and the histograms have fixed bucket  boundaries, which makes it
+straightforward to serve them to a  scraping monitoring system such as
+Prometheus.
+
+Histograms are updated using metricObserve() by  the subsystem that
+measures the duration.  Counters are  read   from  statistics that are
+maintained anyway.  All updates use atomic  additions and never lock, so
+the metrics may be updated from any thread including the gc thread.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static const double bucket_bounds[METRIC_BUCKETS] =
+{ 0.00001, 0.00005, 0.0001, 0.0005, 0.001, 0.005,
+  0.01,    0.05,    0.1,    0.5,    1.0,   10.0
+};
+
+static metric_histogram histograms[MET_HISTOGRAMS];
+
+typedef enum
+{ METRIC_COUNTER,
+  METRIC_HISTOGRAM
+} metric_type;
+
+typedef struct metric_def
+{ const char   *name;			/* Name of the metric */
+  metric_type	type;			/* Counter or histogram */
+  int		histogram;		/* Index into histograms[] */
+  int64_t     (*counter)(void);		/* Get counter value */
+  const char   *help;			/* Description */
+} metric_def;
+
+static int64_t
+threads_created(void)
+{
+#ifdef O_PLMT
+  return GD->statistics.threads_created;
+#else
+  return 1;
+#endif
+}
+
+static int64_t
+stream_bytes_read(void)
+{ return S__iototals.bytes_read;
+}
+
+static int64_t
+stream_bytes_written(void)
+{ return S__iototals.bytes_written;
+}
+
+static int64_t
+atoms_collected(void)
+{ return GD->atoms.collected;
+}
+
+static int64_t
+clauses_collected(void)
+{ return GD->clauses.cgc_reclaimed;
+}
+
+static const metric_def metric_defs[] =
+{ { "swipl_gc_seconds", METRIC_HISTOGRAM, MET_GC_SECONDS, NULL,
+    "CPU time of stack garbage collections" },
+  { "swipl_agc_seconds", METRIC_HISTOGRAM, MET_AGC_SECONDS, NULL,
+    "CPU time of atom garbage collections" },
+  { "swipl_cgc_seconds", METRIC_HISTOGRAM, MET_CGC_SECONDS, NULL,
+    "CPU time of clause garbage collections" },
+  { "swipl_index_build_seconds", METRIC_HISTOGRAM, MET_INDEX_SECONDS, NULL,
+    "Time to create a JIT clause index" },
+  { "swipl_queue_wait_seconds", METRIC_HISTOGRAM, MET_QUEUE_WAIT_SECONDS,
+    NULL,
+    "Time threads waited on a message queue" },
+  { "swipl_atoms_collected_total", METRIC_COUNTER, 0, atoms_collected,
+    "Atoms reclaimed by atom garbage collection" },
+  { "swipl_clauses_collected_total", METRIC_COUNTER, 0, clauses_collected,
+    "Clauses reclaimed by clause garbage collection" },
+  { "swipl_threads_created_total", METRIC_COUNTER, 0, threads_created,
+    "Prolog threads created" },
+  { "swipl_stream_read_bytes_total", METRIC_COUNTER, 0, stream_bytes_read,
+    "Bytes read from stream devices" },
+  { "swipl_stream_written_bytes_total", METRIC_COUNTER, 0,
+    stream_bytes_written,
+    "Bytes written to stream devices" },
+  { NULL }
+};
+
+
+static void
+observe(metric_histogram *h, double seconds)
+{ int i;
+
+  if ( seconds < 0.0 )			/* clock adjustment */
+    seconds = 0.0;
+
+  for(i=0; i<METRIC_BUCKETS; i++)
+  { if ( seconds <= bucket_bounds[i] )
+      break;
+  }
+
+  ATOMIC_INC(&h->buckets[i]);
+  ATOMIC_ADD(&h->sum_ns, (int64_t)(seconds*1000000000.0));
+}
+
+
+void
+metricObserve(metric_histogram_id id, double seconds)
+{ observe(&histograms[id], seconds);
+}
+
+
+/* Histograms of individual objects such as mutexes and message queues
+   use the same buckets.  They are allocated on the first observation,
+   so objects that never wait pay nothing.  unify_histogram() accepts
+   NULL for an object without observations.
+*/
+
+void
+histogramObserve(metric_histogram **hp, double seconds)
+{ metric_histogram *h;
+
+  if ( !(h=*hp) )
+  { metric_histogram *new = allocHeapOrHalt(sizeof(*new));
+
+    memset(new, 0, sizeof(*new));
+    if ( COMPARE_AND_SWAP_PTR(hp, NULL, new) )
+    { h = new;
+    } else
+    { freeHeap(new, sizeof(*new));
+      h = *hp;
+    }
+  }
+
+  observe(h, seconds);
+}
+
+
+void
+freeHistogram(metric_histogram **hp)
+{ metric_histogram *h;
+
+  if ( (h=*hp) )
+  { *hp = NULL;
+    freeHeap(h, sizeof(*h));
+  }
+}
+
+
+int
+unify_histogram(term_t t, const metric_histogram *h)
+{ GET_LD
+  static const metric_histogram empty = {0};
+  term_t a    = PL_new_term_ref();
+  term_t head = PL_new_term_ref();
+  int64_t cumulative[METRIC_BUCKETS+1];
+  int64_t c = 0;
+  int i;
+
+  if ( !h )
+    h = &empty;
+
+  for(i=0; i<=METRIC_BUCKETS; i++)	/* snapshot */
+  { c += h->buckets[i];
+    cumulative[i] = c;
+  }
+
+  if ( !PL_unify_functor(t, FUNCTOR_histogram3) )
+    return FALSE;
+  _PL_get_arg(1, t, a);
+  if ( !PL_unify_int64(a, c) )
+    return FALSE;
+  _PL_get_arg(2, t, a);
+  if ( !PL_unify_float(a, (double)h->sum_ns/1000000000.0) )
+    return FALSE;
+  _PL_get_arg(3, t, a);
+
+  for(i=0; i<=METRIC_BUCKETS; i++)
+  { if ( !PL_unify_list(a, head, a) )
+      return FALSE;
+    if ( i < METRIC_BUCKETS )
+    { if ( !PL_unify_term(head, PL_FUNCTOR, FUNCTOR_minus2,
+				  PL_FLOAT, bucket_bounds[i],
+				  PL_INT64, cumulative[i]) )
+	return FALSE;
+    } else
+    { if ( !PL_unify_term(head, PL_FUNCTOR, FUNCTOR_minus2,
+				  PL_ATOM, ATOM_inf,
+				  PL_INT64, cumulative[i]) )
+	return FALSE;
+    }
+  }
+
+  return PL_unify_nil(a);
+}
+
+
+/** '$runtime_metrics'(-Metrics) is det.
+ *
+ * Metrics is a list of metric(Name, Type, Help, Value), where Type is
+ * one of `counter` or `histogram`.  The value of a counter is an
+ * integer.  The value of a histogram is histogram(Count, Sum, Buckets),
+ * where Buckets is a list UpperBound-Count with cumulative counts.  The
+ * last UpperBound is `inf`.
+ */
+
+static
+PRED_IMPL("$runtime_metrics", 1, runtime_metrics, 0)
+{ PRED_LD
+  term_t tail = PL_copy_term_ref(A1);
+  term_t head = PL_new_term_ref();
+  term_t value = PL_new_term_ref();
+  const metric_def *md;
+
+  for(md=metric_defs; md->name; md++)
+  { int rc;
+
+    PL_put_variable(value);
+    if ( md->type == METRIC_COUNTER )
+      rc = PL_unify_int64(value, (*md->counter)());
+    else
+      rc = unify_histogram(value, &histograms[md->histogram]);
+
+    if ( !rc ||
+	 !PL_unify_list(tail, head, tail) ||
+	 !PL_unify_term(head, PL_FUNCTOR, FUNCTOR_metric4,
+			        PL_CHARS, md->name,
+			        PL_ATOM, md->type == METRIC_COUNTER
+					   ? ATOM_counter : ATOM_histogram,
+			        PL_UTF8_STRING, md->help,
+			        PL_TERM, value) )
+      return FALSE;
+  }
+
+  return PL_unify_nil(tail);
+}
+
+
+		 /*******************************
+		 *      PUBLISH PREDICATES	*
+		 *******************************/
+
+BeginPredDefs(metrics)
+  PRED_DEF("$runtime_metrics", 1, runtime_metrics, 0)
+EndPredDefs
@@ -0,0 +1,64 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef PL_METRICS_H_INCLUDED
+#define PL_METRICS_H_INCLUDED
+
+/* Latency histograms maintained by the runtime.  The order must match
+   the histogram entries of metric_defs[] in pl-metrics.c.
+*/
+
+typedef enum
+{ MET_GC_SECONDS = 0,		/* Stack garbage collection */
+  MET_AGC_SECONDS,		/* Atom garbage collection */
+  MET_CGC_SECONDS,		/* Clause garbage collection */
+  MET_INDEX_SECONDS,		/* Creating a JIT clause index */
+  MET_QUEUE_WAIT_SECONDS,	/* Waiting for a message */
+  MET_HISTOGRAMS		/* Number of histograms */
+} metric_histogram_id;
+
+#define METRIC_BUCKETS 12
+
+typedef struct metric_histogram
+{ int64_t	sum_ns;			/* Sum of observations in nanosec */
+  int64_t	buckets[METRIC_BUCKETS+1]; /* Last is +Inf */
+} metric_histogram;
+
+COMMON(void)	metricObserve(metric_histogram_id id, double seconds);
+COMMON(void)	histogramObserve(metric_histogram **hp, double seconds);
+COMMON(void)	freeHistogram(metric_histogram **hp);
+COMMON(int)	unify_histogram(term_t t, const metric_histogram *h);
+
+#endif /*PL_METRICS_H_INCLUDED*/
@@ -81,9 +81,6 @@ _lookupModule(atom_t name ARG_LD)
   memset(m, 0, sizeof(*m));
 
   m->name = name;
-#ifdef O_PLMT
-  m->mutex = allocSimpleMutex(PL_atom_chars(m->name));
-#endif
   set(m, M_CHARESCAPE);
   if ( !GD->options.traditional )
     set(m, DBLQ_STRING|BQ_CODES|O_RATIONAL_SYNTAX);
@@ -94,7 +91,6 @@ _lookupModule(atom_t name ARG_LD)
     m->procedures = newHTable(MODULEPROCEDUREHASHSIZE);
   m->procedures->free_symbol = unallocProcedureSymbol;
 
-  m->public = newHTable(PUBLICHASHSIZE);
   m->class  = ATOM_user;
 
   if ( name == ATOM_user )
@@ -124,12 +120,68 @@ _lookupModule(atom_t name ARG_LD)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The module mutex and export  table  are   created  on  first use. Many
+modules, notably temporary modules used to   hold  a dynamic rule set,
+never need them. Not  creating  the  mutex   also  avoids  the global
+L_MUTEX lock when creating and destroying such modules.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef O_PLMT
+counting_mutex *
+moduleMutex(Module m)
+{ counting_mutex *mutex;
+
+  if ( !(mutex = m->mutex) )
+  { counting_mutex *new = allocSimpleMutex(PL_atom_chars(m->name));
+
+    if ( COMPARE_AND_SWAP_PTR(&m->mutex, NULL, new) )
+    { mutex = new;
+    } else
+    { freeSimpleMutex(new);
+      mutex = m->mutex;
+    }
+  }
+
+  return mutex;
+}
+#endif
+
+Table
+modulePublicTable(Module m)
+{ Table t;
+
+  if ( !(t = m->public) )
+  { Table new = newHTable(PUBLICHASHSIZE);
+
+    if ( COMPARE_AND_SWAP_PTR(&m->public, NULL, new) )
+    { t = new;
+    } else
+    { destroyHTable(new);
+      t = m->public;
+    }
+  }
+
+  return t;
+}
+
+
 Module
 lookupModule__LD(atom_t name ARG_LD)
 { Module m;
+  unsigned int epoch = GD->procedures.resolve_epoch;
+  struct module_cache_entry *e =
+    &LD->resolve.modules[indexAtom(name)&(MODULE_CACHE_SIZE-1)];
+
+  if ( e->name == name && e->epoch == epoch )
+    return e->module;
 
   if ( (m = lookupHTable(GD->tables.modules, (void*)name)) )
+  { e->name   = name;
+    e->module = m;
+    e->epoch  = epoch;
     return m;
+  }
 
   PL_LOCK(L_MODULE);
   m = _lookupModule(name PASS_LD);
@@ -253,6 +305,7 @@ unallocModule(Module m)
 
   if ( m->public )     destroyHTable(m->public);
   if ( m->procedures ) destroyHTable(m->procedures);
+  resolveProcedureCacheChanged();
   if ( m->operators )  destroyHTable(m->operators);
   if ( m->supers )     unallocList(m->supers);
 #ifdef O_PLMT
@@ -287,11 +340,33 @@ markSourceFilesProcedure(Procedure proc, struct bit_vector *v)
 }
 
 
+static int
+hasSourceFilesModule(Module m)
+{ int rc = FALSE;
+
+  for_table(m->procedures, name, value,
+	    { Procedure proc = value;
+
+	      if ( proc->source_no || true(proc, PROC_MULTISOURCE) )
+	      { rc = TRUE;
+		break;
+	      }
+	    });
+
+  return rc;
+}
+
+
 static void
 unlinkSourceFilesModule(Module m)
-{ size_t i, high = highSourceFileIndex();
-  struct bit_vector *vec = new_bitvector(high+1);
+{ size_t i, high;
+  struct bit_vector *vec;
+
+  if ( !hasSourceFilesModule(m) )
+    return;				/* e.g., only asserted clauses */
 
+  high = highSourceFileIndex();
+  vec = new_bitvector(high+1);
   for_table(m->procedures, name, value,
 	    markSourceFilesProcedure(value, vec));
 
@@ -318,6 +393,7 @@ destroyModule(Module m)
   PL_LOCK(L_MODULE);
   if ( deleteHTable(GD->tables.modules, (void*)m->name) == m )
     set(m, M_DESTROYED);
+  resolveProcedureCacheChanged();
 #ifndef NDEBUG
   { GET_LD
     assert(!lookupHTable(GD->tables.modules, (void*)m->name));
@@ -334,6 +410,7 @@ static void
 emptyModule(Module m)
 { DEBUG(MSG_CLEANUP, Sdprintf("emptyModule(%s)\n", PL_atom_chars(m->name)));
   if ( m->procedures ) clearHTable(m->procedures);
+  resolveProcedureCacheChanged();
 }
 
 
@@ -459,6 +536,7 @@ addSuperModule_no_lock(Module m, Module s, int where)
   }
 
   updateLevelModule(m);
+  resolveProcedureCacheChanged();
   succeed;
 }
 
@@ -487,6 +565,7 @@ delSuperModule(Module m, Module s)
       freeHeap(c, sizeof(*c));
 
       updateLevelModule(m);
+      resolveProcedureCacheChanged();
       succeed;
     }
   }
@@ -507,6 +586,7 @@ clearSupersModule_no_lock(Module m)
   }
 
   m->level = 0;
+  resolveProcedureCacheChanged();
 }
 
 void
@@ -526,6 +606,7 @@ setSuperModule(Module m, Module s)
   { if ( (Module)m->supers->value != s )
     { m->supers->value = s;
       m->level = s->level+1;
+      resolveProcedureCacheChanged();
 
       succeed;
     }
@@ -723,7 +804,8 @@ stripModule(Word term, Module *module, int flags ARG_LD)
 bool
 isPublicModule(Module module, Procedure proc)
 { GET_LD
-  if ( lookupHTable(module->public,
+  if ( module->public &&
+       lookupHTable(module->public,
 		    (void *)proc->definition->functor->functor) )
     succeed;
 
@@ -1217,7 +1299,8 @@ declareModule(atom_t name, atom_t class, atom_t super,
 		  abolishProcedure(proc, module);
 		}
 	      })
-    clearHTable(module->public);
+    if ( module->public )
+      clearHTable(module->public);
   }
   if ( super )
     setSuperModule(module, _lookupModule(super PASS_LD));
@@ -1283,13 +1366,15 @@ unify_export_list(term_t public, Module module ARG_LD)
   term_t list = PL_copy_term_ref(public);
   int rval = TRUE;
 
-  for_table(module->public, name, value,
-	    { if ( !PL_unify_list(list, head, list) ||
-		   !unify_functor(head, (functor_t)name, GP_NAMEARITY) )
-	      { rval = FALSE;
-		break;
-	      }
-	    })
+  if ( module->public )
+  { for_table(module->public, name, value,
+	      { if ( !PL_unify_list(list, head, list) ||
+		     !unify_functor(head, (functor_t)name, GP_NAMEARITY) )
+		{ rval = FALSE;
+		  break;
+		}
+	      })
+  }
   if ( rval )
     return PL_unify_nil(list);
 
@@ -1379,7 +1464,7 @@ head from the context module.
 int
 exportProcedure(Module module, Procedure proc)
 { LOCKMODULE(module);
-  updateHTable(module->public,
+  updateHTable(modulePublicTable(module),
 	       (void *)proc->definition->functor->functor,
 	       proc);
   UNLOCKMODULE(module);
@@ -1460,6 +1545,8 @@ PRED_IMPL("$undefined_export", 2, undefined_export, 0)
   if ( !(module = isCurrentModule(mname)) )
     return PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_module, A1);
 
+  if ( !module->public )
+    return PL_unify_nil(tail);
   e = newTableEnum(module->public);
 
   while( advanceTableEnum(e, NULL, (void**)&proc) )
@@ -1648,6 +1735,8 @@ retry:
     old = addHTable(destination->procedures,
 		    (void *)proc->definition->functor->functor, nproc);
     UNLOCKMODULE(destination);
+    if ( old == nproc )
+      resolveFunctorCacheChanged(proc->definition->functor->functor);
     if ( old != nproc )
     { int shared = unshareDefinition(proc->definition);
       assert(shared > 0);
@@ -36,6 +36,7 @@
 
 #include "pl-incl.h"
 #include "pl-thread.h"
+#include "pl-metrics.h"
 
 #undef LD
 #define LD LOCAL_LD
@@ -44,6 +45,52 @@
 static void	unalloc_mutex(pl_mutex *m);
 
 
+		 /*******************************
+		 *	   SYSTEM LOCKS		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A Prolog mutex is either a  normal  mutex   or  a  read-write lock. The
+exclusive (write) side of a read-write lock  behaves as a mutex and is
+used by mutex_lock/1, with_mutex/2, with_write_lock/2,  etc.  The shared
+(read) side is only accessible through with_read_lock/2.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+sys_mutex_trylock(pl_mutex *m)
+{ return ( m->rwlock ? pthread_rwlock_trywrlock(&m->rw_lock)
+		     : pthread_mutex_trylock(&m->mutex) );
+}
+
+#ifdef HAVE_PTHREAD_MUTEX_TIMEDLOCK
+static int
+sys_mutex_timedlock(pl_mutex *m, struct timespec *deadline)
+{ return ( m->rwlock ? pthread_rwlock_timedwrlock(&m->rw_lock, deadline)
+		     : pthread_mutex_timedlock(&m->mutex, deadline) );
+}
+#else
+static int
+sys_mutex_lock(pl_mutex *m)
+{ return ( m->rwlock ? pthread_rwlock_wrlock(&m->rw_lock)
+		     : pthread_mutex_lock(&m->mutex) );
+}
+#endif
+
+static int
+sys_mutex_unlock(pl_mutex *m)
+{ return ( m->rwlock ? pthread_rwlock_unlock(&m->rw_lock)
+		     : pthread_mutex_unlock(&m->mutex) );
+}
+
+static void
+sys_mutex_destroy(pl_mutex *m)
+{ if ( m->rwlock )
+    pthread_rwlock_destroy(&m->rw_lock);
+  else
+    pthread_mutex_destroy(&m->mutex);
+}
+
+
 		 /*******************************
 		 *	    USER MUTEXES	*
 		 *******************************/
@@ -82,13 +129,13 @@ release_mutexref(atom_t aref)
 	       m, m->owner);
 
       if ( m->owner == PL_thread_self() )
-	pthread_mutex_unlock(&m->mutex);
+	sys_mutex_unlock(m);
       else
 	return TRUE;
     }
 
     if ( m->initialized )
-      pthread_mutex_destroy(&m->mutex);
+      sys_mutex_destroy(m);
     unalloc_mutex(m);
   }
 
@@ -135,7 +182,8 @@ initMutexRef(void)
 
 static void
 unalloc_mutex(pl_mutex *m)
-{ freeHeap(m, sizeof(*m));
+{ freeHistogram(&m->wait_histogram);
+  freeHeap(m, sizeof(*m));
 }
 
 
@@ -143,7 +191,7 @@ static void
 destroy_mutex(pl_mutex *m)
 { if ( m->initialized )
   { m->initialized = FALSE;
-    pthread_mutex_destroy(&m->mutex);
+    sys_mutex_destroy(m);
   }
   if ( !m->anonymous )
     unalloc_mutex(m);
@@ -181,12 +229,17 @@ critical.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static pl_mutex *
-mutexCreate(atom_t name)
+mutexCreate(atom_t name, int rwlock)
 { pl_mutex *m;
 
   if ( (m=allocHeap(sizeof(*m))) )
   { memset(m, 0, sizeof(*m));
-    pthread_mutex_init(&m->mutex, NULL);
+    if ( rwlock )
+    { pthread_rwlock_init(&m->rw_lock, NULL);
+      m->rwlock = TRUE;
+    } else
+    { pthread_mutex_init(&m->mutex, NULL);
+    }
     m->initialized = TRUE;
 
     if ( name == NULL_ATOM )
@@ -213,7 +266,7 @@ mutexCreate(atom_t name)
 
 
 static pl_mutex *
-unlocked_pl_mutex_create(term_t mutex)
+unlocked_pl_mutex_create(term_t mutex, int rwlock)
 { GET_LD
   atom_t name = NULL_ATOM;
   pl_mutex *m;
@@ -233,7 +286,7 @@ unlocked_pl_mutex_create(term_t mutex)
     return NULL;
   }
 
-  if ( (m=mutexCreate(id)) )
+  if ( (m=mutexCreate(id, rwlock)) )
   { if ( !unify_mutex(mutex, m) )
     { destroy_mutex(m);
       m = NULL;
@@ -249,7 +302,7 @@ PRED_IMPL("mutex_create", 1, mutex_create1, 0)
 { int rval;
 
   PL_LOCK(L_UMUTEX);
-  rval = (unlocked_pl_mutex_create(A1) ? TRUE : FALSE);
+  rval = (unlocked_pl_mutex_create(A1, FALSE) ? TRUE : FALSE);
   PL_UNLOCK(L_UMUTEX);
 
   return rval;
@@ -258,6 +311,7 @@ PRED_IMPL("mutex_create", 1, mutex_create1, 0)
 
 static const opt_spec mutex_options[] =
 { { ATOM_alias,		OPT_ATOM },
+  { ATOM_type,		OPT_ATOM },
   { NULL_ATOM,		0 }
 };
 
@@ -267,11 +321,19 @@ PRED_IMPL("mutex_create", 2, mutex_create2, 0)
 { PRED_LD
   int rval;
   atom_t alias = 0;
+  atom_t type = ATOM_mutex;
 
   if ( !scan_options(A2, 0,
 		     ATOM_mutex_option, mutex_options,
-		     &alias) )
+		     &alias, &type) )
     fail;
+  if ( type != ATOM_mutex && type != ATOM_rwlock )
+  { term_t t;
+
+    return ( (t=PL_new_term_ref()) &&
+	     PL_put_atom(t, type) &&
+	     PL_domain_error("mutex_type", t) );
+  }
 
   if ( alias )
   { if ( !PL_unify_atom(A1, alias) )
@@ -279,13 +341,21 @@ PRED_IMPL("mutex_create", 2, mutex_create2, 0)
   }
 
   PL_LOCK(L_UMUTEX);
-  rval = (unlocked_pl_mutex_create(A1) ? TRUE : FALSE);
+  rval = (unlocked_pl_mutex_create(A1, type == ATOM_rwlock) ? TRUE : FALSE);
   PL_UNLOCK(L_UMUTEX);
 
   return rval;
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+get_mutex() finds the mutex denoted by t.  If create is MUTEX_CREATE or
+RWLOCK_CREATE, a named mutex or rwlock is created if it does not exist.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define MUTEX_CREATE  1
+#define RWLOCK_CREATE 2
+
 static int
 get_mutex(term_t t, pl_mutex **mutex, int create)
 { GET_LD
@@ -315,7 +385,7 @@ get_mutex(term_t t, pl_mutex **mutex, int create)
        (m = lookupHTable(GD->thread.mutexTable, (void *)id)) )
   { ;
   } else if ( create )
-  { m = unlocked_pl_mutex_create(t);
+  { m = unlocked_pl_mutex_create(t, create == RWLOCK_CREATE);
   } else
   { PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_mutex, t);
   }
@@ -335,6 +405,59 @@ out:
 
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+PL_mutex_lock() first tries to get the mutex without blocking. If this
+fails and we have multiple CPUs, we  spin   for  a while, hoping the
+owner leaves its (typically short) critical  section before we need to
+fall back to  a  sleeping  wait.  The   number  of  spins  adapts to the
+number of spins needed to acquire this mutex in the recent past, as in
+the glibc adaptive mutexes.
+
+While holding the mutex we update the statistics that are reported by
+mutex_property/2.  As these are only   modified  by the owner, no extra
+synchronization is needed.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define MUTEX_MAX_SPIN 100
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define spin_pause() __builtin_ia32_pause()
+#else
+#define spin_pause() (void)0
+#endif
+
+static int
+mutex_max_spin(void)
+{ static int max_spin = -1;
+
+  if ( max_spin < 0 )
+    max_spin = (CpuCount() > 1 ? MUTEX_MAX_SPIN : 0);
+
+  return max_spin;
+}
+
+
+static int
+spin_mutex(pl_mutex *m)
+{ int max = m->spins*2 + 10;
+  int i;
+
+  if ( max > mutex_max_spin() )
+    max = mutex_max_spin();
+
+  for(i=0; i<max; i++)
+  { if ( *(volatile int*)&m->owner == 0 &&
+	 sys_mutex_trylock(m) == 0 )
+    { m->spins += (i - m->spins)/8;
+      return TRUE;
+    }
+    spin_pause();
+  }
+
+  return FALSE;
+}
+
+
 int
 PL_mutex_lock(struct pl_mutex *m)
 { int self = PL_thread_self();
@@ -343,26 +466,49 @@ PL_mutex_lock(struct pl_mutex *m)
   { m->count++;
   } else
   { int rc;
+
+    if ( (rc=sys_mutex_trylock(m)) != 0 )
+    { GET_LD
+      double t0 = WallTime();
+      double waited;
+
+      if ( spin_mutex(m) )
+      { rc = 0;
+	goto acquired;
+      }
+
 #ifdef HAVE_PTHREAD_MUTEX_TIMEDLOCK
-    for(;;)
-    { struct timespec deadline;
+      for(;;)
+      { struct timespec deadline;
 
-      get_current_timespec(&deadline);
-      deadline.tv_nsec += 250000000;
-      carry_timespec_nanos(&deadline);
+	get_current_timespec(&deadline);
+	deadline.tv_nsec += 250000000;
+	carry_timespec_nanos(&deadline);
 
-      if ( (rc=pthread_mutex_timedlock(&m->mutex, &deadline)) == ETIMEDOUT )
-      { if ( PL_handle_signals() < 0 )
-	  return FALSE;
-      } else
-	break;
-    }
+	if ( (rc=sys_mutex_timedlock(m, &deadline)) == ETIMEDOUT )
+	{ if ( PL_handle_signals() < 0 )
+	  { LD->statistics.mutex_wait_time += WallTime()-t0;
+	    return FALSE;
+	  }
+	} else
+	  break;
+      }
 #else
-    rc = pthread_mutex_lock(&m->mutex);
+      rc = sys_mutex_lock(m);
 #endif
+      m->spins += (mutex_max_spin() - m->spins)/8;
+
+    acquired:
+      waited = WallTime()-t0;
+      LD->statistics.mutex_wait_time += waited;
+      m->wait_time += waited;
+      m->contended++;
+      histogramObserve(&m->wait_histogram, waited);
+    }
     assert(rc == 0);
     m->count = 1;
     m->owner = self;
+    m->acquired++;
   }
 
   return TRUE;
@@ -373,7 +519,7 @@ static
 PRED_IMPL("mutex_lock", 1, mutex_lock, 0)
 { pl_mutex *m;
 
-  if ( !get_mutex(A1, &m, TRUE) )
+  if ( !get_mutex(A1, &m, MUTEX_CREATE) )
     return FALSE;
 
   return  PL_mutex_lock(m);
@@ -387,9 +533,10 @@ PL_mutex_trylock(struct pl_mutex *m)
 
   if ( self == m->owner )
   { m->count++;
-  } else if ( (rc = pthread_mutex_trylock(&m->mutex)) == 0 )
+  } else if ( (rc = sys_mutex_trylock(m)) == 0 )
   { m->count = 1;
     m->owner = self;
+    m->acquired++;
   } else
   { assert(rc == EBUSY);
     return FALSE;
@@ -403,7 +550,7 @@ static
 PRED_IMPL("mutex_trylock", 1, mutex_trylock, 0)
 { pl_mutex *m;
 
-  if ( !get_mutex(A1, &m, TRUE) )
+  if ( !get_mutex(A1, &m, MUTEX_CREATE) )
     return FALSE;
 
   return  PL_mutex_trylock(m);
@@ -418,7 +565,7 @@ PL_mutex_unlock(struct pl_mutex *m)
   { if ( --m->count == 0 )
     { m->owner = 0;
 
-      pthread_mutex_unlock(&m->mutex);
+      sys_mutex_unlock(m);
     }
 
     return TRUE;
@@ -470,7 +617,7 @@ PRED_IMPL("mutex_unlock_all", 0, mutex_unlock_all, 0)
   { if ( m->owner == tid )
     { m->count = 0;
       m->owner = 0;
-      pthread_mutex_unlock(&m->mutex);
+      sys_mutex_unlock(m);
     }
   }
   freeTableEnum(e);
@@ -488,7 +635,7 @@ try_really_destroy_mutex(pl_mutex *m)
 	PL_unregister_atom(m->id);
       m->count = 0;
       m->owner = 0;
-      pthread_mutex_unlock(&m->mutex);
+      sys_mutex_unlock(m);
       destroy_mutex(m);
       return TRUE;
     } else
@@ -539,6 +686,9 @@ mutex_status_property(pl_mutex *m, term_t prop ARG_LD)
 			    PL_TERM, owner_term,
 			    PL_INT, count) &&
 	    unify_mutex_owner(owner_term, owner));
+  } else if ( m->readers )
+  { return PL_unify_term(prop, PL_FUNCTOR, FUNCTOR_read_locked1,
+			   PL_INT, m->readers);
   } else
   { return PL_unify_atom(prop, ATOM_unlocked);
   }
@@ -547,9 +697,44 @@ mutex_status_property(pl_mutex *m, term_t prop ARG_LD)
 }
 
 
+static int		/* mutex_property(Mutex, type(Type)) */
+mutex_type_property(pl_mutex *m, term_t prop ARG_LD)
+{ return PL_unify_atom(prop, m->rwlock ? ATOM_rwlock : ATOM_mutex);
+}
+
+
+static int		/* mutex_property(Mutex, acquired(Count)) */
+mutex_acquired_property(pl_mutex *m, term_t prop ARG_LD)
+{ return PL_unify_uint64(prop, m->acquired);
+}
+
+
+static int		/* mutex_property(Mutex, contended(Count)) */
+mutex_contended_property(pl_mutex *m, term_t prop ARG_LD)
+{ return PL_unify_uint64(prop, m->contended);
+}
+
+
+static int		/* mutex_property(Mutex, wait_time(Seconds)) */
+mutex_wait_time_property(pl_mutex *m, term_t prop ARG_LD)
+{ return PL_unify_float(prop, m->wait_time);
+}
+
+
+static int		/* mutex_property(Mutex, wait_histogram(Hist)) */
+mutex_wait_histogram_property(pl_mutex *m, term_t prop ARG_LD)
+{ return unify_histogram(prop, m->wait_histogram);
+}
+
+
 static const tprop mprop_list [] =
 { { FUNCTOR_alias1,	    mutex_alias_property },
   { FUNCTOR_status1,	    mutex_status_property },
+  { FUNCTOR_type1,	    mutex_type_property },
+  { FUNCTOR_acquired1,	    mutex_acquired_property },
+  { FUNCTOR_contended1,	    mutex_contended_property },
+  { FUNCTOR_wait_time1,	    mutex_wait_time_property },
+  { FUNCTOR_wait_histogram1, mutex_wait_histogram_property },
   { 0,			    NULL }
 };
 
@@ -737,7 +922,7 @@ pl_with_mutex(term_t mutex, term_t goal)
 #ifdef O_PLMT
   pl_mutex *m;
 
-  if ( !get_mutex(mutex, &m, TRUE) )
+  if ( !get_mutex(mutex, &m, MUTEX_CREATE) )
     return FALSE;
   PL_mutex_lock(m);
   rval = callProlog(NULL, goal, PL_Q_PASS_EXCEPTION, NULL);
@@ -750,6 +935,168 @@ pl_with_mutex(term_t mutex, term_t goal)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+with_read_lock(+RWLock, :Goal) and  with_write_lock(+RWLock, :Goal) run
+Goal holding the shared or exclusive  side   of  a read-write lock. The
+read locks held by a thread are kept   in  a chain of pl_read_lock cells
+on the C stack. This allows us to detect  that a thread holding a read
+lock asks for the write lock on the same rwlock, which would deadlock,
+and to make nested read locks  on  the   same  rwlock  cheap  and safe
+regardless of the reader/writer preference of   the  system rwlock. As
+read locks are scoped by  with_read_lock/2,  they   are  also  always
+released if Goal raises an exception,   including  thread termination
+using thread_exit/1 or thread_signal/2.
+
+A thread that holds the write lock may call with_read_lock/2, in which
+case the read lock is granted as a nested write lock.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef O_PLMT
+typedef struct pl_read_lock
+{ pl_mutex	       *mutex;		/* The rwlock */
+  struct pl_read_lock  *next;		/* Next held read lock */
+} pl_read_lock;
+
+static int
+get_rwlock(term_t t, pl_mutex **mutex)
+{ pl_mutex *m;
+
+  if ( !get_mutex(t, &m, RWLOCK_CREATE) )
+    return FALSE;
+  if ( !m->rwlock )
+    return PL_type_error("rwlock", t);
+
+  *mutex = m;
+  return TRUE;
+}
+
+static int
+holds_read_lock(pl_mutex *m ARG_LD)
+{ pl_read_lock *rl;
+
+  for(rl = LD->thread.read_locks; rl; rl = rl->next)
+  { if ( rl->mutex == m )
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+static int
+read_lock_rwlock(pl_mutex *m ARG_LD)
+{ int rc;
+
+  if ( (rc=pthread_rwlock_tryrdlock(&m->rw_lock)) != 0 )
+  { double t0 = WallTime();
+
+#ifdef HAVE_PTHREAD_MUTEX_TIMEDLOCK
+    for(;;)
+    { struct timespec deadline;
+
+      get_current_timespec(&deadline);
+      deadline.tv_nsec += 250000000;
+      carry_timespec_nanos(&deadline);
+
+      if ( (rc=pthread_rwlock_timedrdlock(&m->rw_lock, &deadline)) == ETIMEDOUT )
+      { if ( PL_handle_signals() < 0 )
+	{ LD->statistics.mutex_wait_time += WallTime()-t0;
+	  return FALSE;
+	}
+      } else
+	break;
+    }
+#else
+    rc = pthread_rwlock_rdlock(&m->rw_lock);
+#endif
+    LD->statistics.mutex_wait_time += WallTime()-t0;
+  }
+  assert(rc == 0);
+  ATOMIC_INC(&m->readers);
+
+  return TRUE;
+}
+
+static void
+maybe_destroy_mutex(pl_mutex *m)
+{ if ( m->auto_destroy )
+  { PL_LOCK(L_UMUTEX);
+    try_really_destroy_mutex(m);
+    PL_UNLOCK(L_UMUTEX);
+  }
+}
+#endif /*O_PLMT*/
+
+foreign_t
+pl_with_read_lock(term_t mutex, term_t goal)
+{ int rval;
+
+#ifdef O_PLMT
+  GET_LD
+  pl_mutex *m = NULL;
+  pl_read_lock rl;
+
+  if ( !get_rwlock(mutex, &m) )
+    return FALSE;
+
+  if ( m->owner == PL_thread_self() || holds_read_lock(m PASS_LD) )
+  { if ( m->owner == PL_thread_self() )	/* nested in write lock */
+    { PL_mutex_lock(m);
+      rval = callProlog(NULL, goal, PL_Q_PASS_EXCEPTION, NULL);
+      PL_mutex_unlock(m);
+    } else				/* nested read lock */
+    { rval = callProlog(NULL, goal, PL_Q_PASS_EXCEPTION, NULL);
+    }
+
+    return rval;
+  }
+
+  if ( !read_lock_rwlock(m PASS_LD) )
+    return FALSE;
+  rl.mutex = m;
+  rl.next  = LD->thread.read_locks;
+  LD->thread.read_locks = &rl;
+
+  rval = callProlog(NULL, goal, PL_Q_PASS_EXCEPTION, NULL);
+
+  LD->thread.read_locks = rl.next;
+  ATOMIC_DEC(&m->readers);
+  pthread_rwlock_unlock(&m->rw_lock);
+  maybe_destroy_mutex(m);
+#else
+  rval = callProlog(NULL, goal, PL_Q_PASS_EXCEPTION, NULL);
+#endif
+
+  return rval;
+}
+
+
+foreign_t
+pl_with_write_lock(term_t mutex, term_t goal)
+{ int rval;
+
+#ifdef O_PLMT
+  GET_LD
+  pl_mutex *m = NULL;
+
+  if ( !get_rwlock(mutex, &m) )
+    return FALSE;
+  if ( holds_read_lock(m PASS_LD) )
+    return PL_error(NULL, 0, "thread holds a read lock",
+		    ERR_PERMISSION, ATOM_lock, ATOM_rwlock, mutex);
+
+  if ( !PL_mutex_lock(m) )
+    return FALSE;
+  rval = callProlog(NULL, goal, PL_Q_PASS_EXCEPTION, NULL);
+  PL_mutex_unlock(m);
+  maybe_destroy_mutex(m);
+#else
+  rval = callProlog(NULL, goal, PL_Q_PASS_EXCEPTION, NULL);
+#endif
+
+  return rval;
+}
+
+
 		 /*******************************
 		 *      PUBLISH PREDICATES	*
 		 *******************************/
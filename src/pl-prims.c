@@ -238,6 +238,40 @@ Returns one of:
 			of trail-space.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+trim_identical_args() removes the leading  and trailing arguments of two
+compounds that are identical cells.  Such cells are the same atom, small
+integer, reference or pointer to a shared  sub-term or indirect, so they
+unify and compare equal without inspection.  Unbound variables are kept
+as two variable cells at different  addresses are different variables.
+Large ground terms that share most   of  their structure or consist of
+atomic arguments are this way handled  by   a  tight  loop rather than
+one agenda step per argument.  Returns FALSE if all arguments are
+identical.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static inline int
+trim_identical_args(Word *a1, Word *a2, size_t *arity)
+{ Word p1 = *a1;
+  Word p2 = *a2;
+  size_t n = *arity;
+
+  while( n > 0 && *p1 == *p2 && !canBind(*p1) )
+  { p1++;
+    p2++;
+    n--;
+  }
+  while( n > 0 && p1[n-1] == p2[n-1] && !canBind(p1[n-1]) )
+    n--;
+
+  *a1    = p1;
+  *a2    = p2;
+  *arity = n;
+
+  return n > 0;
+}
+
+
 static int
 do_unify(Word t1, Word t2 ARG_LD)
 { term_agendaLR agenda;
@@ -330,7 +364,8 @@ do_unify(Word t1, Word t2 ARG_LD)
       case TAG_COMPOUND:
       { Functor f1 = valueTerm(w1);
 	Functor f2 = valueTerm(w2);
-	int arity;
+	size_t arity;
+	Word a1, a2;
 
 #if O_CYCLIC
 	while ( isRef(f1->definition) )
@@ -344,13 +379,17 @@ do_unify(Word t1, Word t2 ARG_LD)
 	if ( f1->definition != f2->definition )
 	  goto out_fail;
 	arity = arityFunctor(f1->definition);
+	a1 = f1->arguments;
+	a2 = f2->arguments;
+	if ( !trim_identical_args(&a1, &a2, &arity) )
+	  continue;
 
 	if ( !compound )
 	{ compound = TRUE;
 	  initCyclic(PASS_LD1);
-	  initTermAgendaLR(&agenda, arity, f1->arguments, f2->arguments);
+	  initTermAgendaLR(&agenda, arity, a1, a2);
 	} else
-	{ if ( !pushWorkAgendaLR(&agenda, arity, f1->arguments, f2->arguments) )
+	{ if ( !pushWorkAgendaLR(&agenda, arity, a1, a2) )
 	  { rc = MEMORY_OVERFLOW;
 	    goto out_fail;
 	  }
@@ -1472,8 +1511,7 @@ termHashValue(word term, long depth, unsigned int *hval ARG_LD)
       case TAG_ATTVAR:
 	fail;
       case TAG_ATOM:
-      { *hval = MurmurHashAligned2(&atomValue(term)->hash_value,
-				   sizeof(unsigned int), *hval);
+      { *hval = MurmurHashInt32(atomValue(term)->hash_value, *hval);
         succeed;
       }
       case TAG_STRING:
@@ -1489,7 +1527,7 @@ termHashValue(word term, long depth, unsigned int *hval ARG_LD)
 	if ( storage(term) == STG_INLINE )
 	{ int64_t v = valInt(term);
 
-	  *hval = MurmurHashAligned2(&v, sizeof(v), *hval);
+	  *hval = MurmurHashInt64((uint64_t)v, *hval);
 
 	  succeed;
 	}
@@ -1510,7 +1548,7 @@ termHashValue(word term, long depth, unsigned int *hval ARG_LD)
 	unsigned int atom_hashvalue;
 
 	if ( visited(t PASS_LD) )
-	{ *hval = MurmurHashAligned2(hval, sizeof(*hval), *hval);
+	{ *hval = MurmurHashInt32(*hval, *hval);
 	  succeed;
 	}
 
@@ -1518,9 +1556,7 @@ termHashValue(word term, long depth, unsigned int *hval ARG_LD)
 	arity = fd->arity;
 
 	atom_hashvalue = atomValue(fd->name)->hash_value + arity;
-	*hval = MurmurHashAligned2(&atom_hashvalue,
-				   sizeof(atom_hashvalue),
-				   *hval);
+	*hval = MurmurHashInt32(atom_hashvalue, *hval);
 
 	if ( --depth != 0 )
 	{ for(p = t->arguments; arity-- > 0; p++)
@@ -1714,6 +1750,13 @@ compare_primitives(Word p1, Word p2, int eq ARG_LD)
     { number n1, n2;
       int rc;
 
+      if ( storage(w1) == STG_INLINE && storage(w2) == STG_INLINE )
+      { intptr_t i1 = valInt(w1);
+	intptr_t i2 = valInt(w2);
+
+	return i1 < i2 ? CMP_LESS : i1 == i2 ? CMP_EQUAL : CMP_GREATER;
+      }
+
       get_rational(w1, &n1);
       get_rational(w2, &n2);
       if ( eq && (n1.type != n2.type) )
@@ -1822,13 +1865,18 @@ do_compare(term_agendaLR *agenda, Functor f1, Functor f2, int eq ARG_LD)
       if ( f1->definition != f2->definition )
       { return compare_functors(f1->definition, f2->definition, eq);
       } else
-      { int arity;
+      { size_t arity;
+	Word a1, a2;
 
       compound:
 	arity = arityFunctor(f1->definition);
+	a1 = f1->arguments;
+	a2 = f2->arguments;
+	if ( !trim_identical_args(&a1, &a2, &arity) )
+	  continue;
 
 	linkTermsCyclic(f1, f2 PASS_LD);
-	if ( !pushWorkAgendaLR(agenda, arity, f1->arguments, f2->arguments) )
+	if ( !pushWorkAgendaLR(agenda, arity, a1, a2) )
 	{ PL_error(NULL, 0, NULL, ERR_RESOURCE, ATOM_memory);
 	  return CMP_ERROR;
 	}
@@ -1841,6 +1889,53 @@ do_compare(term_agendaLR *agenda, Functor f1, Functor f2, int eq ARG_LD)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+compare_shallow() compares the arguments of two  compounds with the same
+functor recursively up to a  small  depth,   without  the  cycle marking
+and agenda of do_compare().  Most keys  are   small  terms,  for which
+this decides the comparison.  If the   terms are too deep it returns
+CMP_COMPOUND and the caller starts  over   using  do_compare().  As the
+traversal order is the same, the   outcome  is the same, also for cyclic
+terms: a cycle always exceeds the depth before a later difference.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define SHALLOW_CMP_DEPTH 2
+
+static int
+compare_shallow(Functor f1, Functor f2, int eq, int depth ARG_LD)
+{ size_t i, arity = arityFunctor(f1->definition);
+  Word args1 = f1->arguments;
+  Word args2 = f2->arguments;
+
+  if ( !trim_identical_args(&args1, &args2, &arity) )
+    return CMP_EQUAL;
+
+  for(i=0; i<arity; i++)
+  { Word a1 = &args1[i];
+    Word a2 = &args2[i];
+    int rc;
+
+    deRef(a1);
+    deRef(a2);
+    if ( (rc=compare_primitives(a1, a2, eq PASS_LD)) == CMP_COMPOUND )
+    { Functor g1, g2;
+
+      if ( depth == 0 )
+	return CMP_COMPOUND;
+      g1 = (Functor)valPtr(*a1);
+      g2 = (Functor)valPtr(*a2);
+      if ( g1->definition != g2->definition )
+	return compare_functors(g1->definition, g2->definition, eq);
+      rc = compare_shallow(g1, g2, eq, depth-1 PASS_LD);
+    }
+    if ( rc != CMP_EQUAL )
+      return rc;
+  }
+
+  return CMP_EQUAL;
+}
+
+
 int
 compareStandard(Word p1, Word p2, int eq ARG_LD)
 { int rc;
@@ -1859,6 +1954,10 @@ compareStandard(Word p1, Word p2, int eq ARG_LD)
     } else
     { term_agendaLR agenda;
 
+      if ( (rc=compare_shallow(f1, f2, eq, SHALLOW_CMP_DEPTH PASS_LD))
+							!= CMP_COMPOUND )
+	return rc;
+
       initCyclic(PASS_LD1);
       initTermAgendaLR0(&agenda);
       rc = do_compare(&agenda, f1, f2, eq PASS_LD);
@@ -4192,15 +4291,11 @@ split_atom(term_t list, PL_chars_t *st, term_t atom ARG_LD)
   if ( !PL_get_text(atom, &at, CVT_ATOMIC|CVT_EXCEPTION) )
     return FALSE;
 
-  for(last=i=0; (ssize_t)i<=(ssize_t)(at.length-sep_len); )
-  { if ( PL_cmp_text(st, 0, &at, i, sep_len) == 0 )
-    { if ( !PL_unify_list(tail, head, tail) ||
-	   !PL_unify_text_range(head, &at, last, i-last, PL_ATOM) )
-	fail;
-      i += sep_len;
-      last = i;
-    } else
-      i++;
+  for(last=0; (i=PL_search_text(&at, last, st)) != (size_t)-1; )
+  { if ( !PL_unify_list(tail, head, tail) ||
+	 !PL_unify_text_range(head, &at, last, i-last, PL_ATOM) )
+      fail;
+    last = i+sep_len;
   }
 
   if ( !PL_unify_list(tail, head, tail) ||
@@ -4355,6 +4450,169 @@ PRED_IMPL("atomics_to_string", 2, atomics_to_string, 0)
 }
 
 
+		 /*******************************
+		 *	  STRING BUILDERS	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A string builder is a blob that references a  growing text buffer. Adding
+text only copies the new text, so building a long text from many pieces
+takes linear time, whereas repeated string_concat/3 copies the text  built
+so far on each call. As with atomic_list_concat/3, the buffer is kept as
+ISO Latin-1 until a wide character is added. The buffer is guarded by a
+mutex such that a builder can be shared between threads.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct string_builder
+{ tmp_buffer	buffer;			/* the text */
+  IOENC		encoding;		/* ENC_ISO_LATIN_1 or ENC_WCHAR */
+#ifdef O_PLMT
+  simpleMutex	mutex;			/* guards concurrent access */
+#endif
+} string_builder;
+
+typedef struct sbref
+{ string_builder *builder;
+} sbref;
+
+
+static int
+write_string_builder(IOSTREAM *s, atom_t aref, int flags)
+{ sbref *ref = PL_blob_data(aref, NULL, NULL);
+  (void)flags;
+
+  Sfprintf(s, "<string_builder>(%p)", ref->builder);
+  return TRUE;
+}
+
+
+static int
+release_string_builder(atom_t aref)
+{ sbref *ref = PL_blob_data(aref, NULL, NULL);
+  string_builder *sb;
+
+  if ( (sb=ref->builder) )
+  { discardBuffer(&sb->buffer);
+#ifdef O_PLMT
+    simpleMutexDelete(&sb->mutex);
+#endif
+    PL_free(sb);
+  }
+
+  return TRUE;
+}
+
+
+static PL_blob_t string_builder_blob =
+{ PL_BLOB_MAGIC,
+  PL_BLOB_UNIQUE,
+  "string_builder",
+  release_string_builder,
+  NULL,
+  write_string_builder
+};
+
+
+static int
+get_string_builder(term_t t, string_builder **sbp)
+{ void *data;
+  PL_blob_t *type;
+
+  if ( PL_get_blob(t, &data, NULL, &type) && type == &string_builder_blob )
+  { sbref *ref = data;
+
+    *sbp = ref->builder;
+    return TRUE;
+  }
+
+  *sbp = NULL;
+  return PL_type_error("string_builder", t);
+}
+
+
+static
+PRED_IMPL("new_string_builder", 1, new_string_builder, 0)
+{ string_builder *sb;
+  sbref ref;
+
+  if ( !(sb = PL_malloc(sizeof(*sb))) )
+    return PL_no_memory();
+  initBuffer(&sb->buffer);
+  sb->encoding = ENC_ISO_LATIN_1;
+#ifdef O_PLMT
+  simpleMutexInit(&sb->mutex);
+#endif
+  ref.builder = sb;
+
+  return PL_unify_blob(A1, &ref, sizeof(ref), &string_builder_blob);
+}
+
+
+static
+PRED_IMPL("string_builder_append", 2, string_builder_append, 0)
+{ PRED_LD
+  string_builder *sb;
+  PL_chars_t txt;
+
+  if ( !get_string_builder(A1, &sb) ||
+       !PL_get_text(A2, &txt, CVT_ATOMIC|CVT_LIST|CVT_EXCEPTION) )
+    return FALSE;
+
+  simpleMutexLock(&sb->mutex);
+  append_text_to_buffer((Buffer)&sb->buffer, &txt, &sb->encoding);
+  simpleMutexUnlock(&sb->mutex);
+
+  return TRUE;
+}
+
+
+static
+PRED_IMPL("string_builder_length", 2, string_builder_length, 0)
+{ PRED_LD
+  string_builder *sb;
+  size_t len;
+
+  if ( !get_string_builder(A1, &sb) )
+    return FALSE;
+
+  simpleMutexLock(&sb->mutex);
+  if ( sb->encoding == ENC_ISO_LATIN_1 )
+    len = entriesBuffer(&sb->buffer, char);
+  else
+    len = entriesBuffer(&sb->buffer, pl_wchar_t);
+  simpleMutexUnlock(&sb->mutex);
+
+  return PL_unify_int64(A2, len);
+}
+
+
+static
+PRED_IMPL("string_builder_string", 2, string_builder_string, 0)
+{ string_builder *sb;
+  PL_chars_t txt;
+  int rc;
+
+  if ( !get_string_builder(A1, &sb) )
+    return FALSE;
+
+  simpleMutexLock(&sb->mutex);
+  txt.encoding  = sb->encoding;
+  txt.storage   = PL_CHARS_HEAP;
+  txt.canonical = TRUE;
+  if ( sb->encoding == ENC_ISO_LATIN_1 )
+  { txt.text.t = baseBuffer(&sb->buffer, char);
+    txt.length = entriesBuffer(&sb->buffer, char);
+  } else
+  { txt.text.w = baseBuffer(&sb->buffer, pl_wchar_t);
+    txt.length = entriesBuffer(&sb->buffer, pl_wchar_t);
+  }
+  rc = PL_unify_text(A2, 0, &txt, PL_STRING);
+  simpleMutexUnlock(&sb->mutex);
+
+  return rc;
+}
+
+
 /** sub_atom_icasechk(+Haystack, ?Start, +Needle) is semidet.
 */
 
@@ -4636,19 +4894,24 @@ sub_text(term_t atom,
 again:
   switch(state->type)
   { case SUB_SEARCH:
-    { PL_get_text(sub, &ts, CVT_ATOMIC|BUF_ALLOW_STACK);
+    { size_t at;
+
+      PL_get_text(sub, &ts, CVT_ATOMIC|BUF_ALLOW_STACK);
       la = state->n2;
       ls = state->n3;
 
-      for( ; state->n1+ls <= la; state->n1++ )
-      { if ( PL_cmp_text(&ta, state->n1, &ts, 0, ls) == 0 )
-	{ match = (PL_unify_integer(before, state->n1) &&
-		   PL_unify_integer(len,    ls) &&
-		   PL_unify_integer(after,  la-ls-state->n1));
+      if ( (at = PL_search_text(&ta, state->n1, &ts)) != (size_t)-1 )
+      { match = (PL_unify_integer(before, at) &&
+		 PL_unify_integer(len,    ls) &&
+		 PL_unify_integer(after,  la-ls-at));
 
-	  state->n1++;
-	  goto next;
+					/* no more: be deterministic */
+	if ( (state->n1 = PL_search_text(&ta, at+1, &ts)) == (size_t)-1 )
+	{ if ( match )
+	    goto exit_succeed;
+	  goto exit_fail;
 	}
+	goto next;
       }
       goto exit_fail;
     }
@@ -5426,6 +5689,15 @@ swi_statistics__LD(atom_t key, Number v, PL_local_data_t *ld)
 #endif
   else if (key == ATOM_heapused)			/* heap usage */
     v->value.i = programSpace();
+  else if (key == ATOM_heap_allocated)
+    v->value.i = LD->statistics.heap_allocated;
+  else if (key == ATOM_mutex_wait_time)
+  { v->type = V_FLOAT;
+    v->value.f = LD->statistics.mutex_wait_time;
+  } else if (key == ATOM_queue_wait_time)
+  { v->type = V_FLOAT;
+    v->value.f = LD->statistics.queue_wait_time;
+  }
 #ifdef O_ATOMGC
   else if (key == ATOM_agc)
     v->value.i = GD->atoms.gc;
@@ -5435,6 +5707,12 @@ swi_statistics__LD(atom_t key, Number v, PL_local_data_t *ld)
   { v->type = V_FLOAT;
     v->value.f = GD->atoms.gc_time;
   }
+  else if (key == ATOM_agc_yields)
+    v->value.i = GD->atoms.gc_yields;
+  else if (key == ATOM_thread_agc_time)
+  { v->type = V_FLOAT;
+    v->value.f = LD->statistics.agc_time;
+  }
 #endif
 #ifdef O_ATOMGC
   else if (key == ATOM_cgc)
@@ -5452,6 +5730,8 @@ swi_statistics__LD(atom_t key, Number v, PL_local_data_t *ld)
     v->value.i = LD->shift_status.local_shifts;
   else if (key == ATOM_trail_shifts)
     v->value.i = LD->shift_status.trail_shifts;
+  else if (key == ATOM_trail_tidied)
+    v->value.i = LD->trail_tidy.reclaimed;
   else if (key == ATOM_shift_time)
   { v->type = V_FLOAT;
     v->value.f = LD->shift_status.time;
@@ -5852,6 +6132,10 @@ BeginPredDefs(prims)
   PRED_DEF("string_length", 2, string_length, 0)
   PRED_DEF("atomics_to_string", 3, atomics_to_string, 0)
   PRED_DEF("atomics_to_string", 2, atomics_to_string, 0)
+  PRED_DEF("new_string_builder", 1, new_string_builder, 0)
+  PRED_DEF("string_builder_append", 2, string_builder_append, 0)
+  PRED_DEF("string_builder_length", 2, string_builder_length, 0)
+  PRED_DEF("string_builder_string", 2, string_builder_string, 0)
   PRED_DEF("sub_atom_icasechk", 3, sub_atom_icasechk, 0)
   PRED_DEF("statistics", 2, statistics, 0)
   PRED_DEF("$cmd_option_val", 2, cmd_option_val, 0)
@@ -0,0 +1,724 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pl-incl.h"
+
+#undef LD
+#define LD LOCAL_LD
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Mutable priority queues. A priority queue is a blob that holds a binary
+min-heap of entries.  Each  entry  has  a   ground  key  and  a  numeric
+priority.  Keys  are  stored  as  R_DUPLICATE  records  (see  pl-rec.c).
+Priorities are kept as C numbers, so  the   heap  can be maintained without
+touching the Prolog stacks.
+
+Entries are also in an htable that  maps   the  hashRecord()  value of the
+key to a chain of entries, as in   pl-hashmap.c. Each entry knows its index
+in the heap array, which allows changing  the priority of an existing key
+(decrease-key) and deleting arbitrary keys in O(log N).
+
+Entries with the same priority are returned in the order they were added.
+All operations are protected by the queue's mutex.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct pq_prio
+{ int		is_float;		/* value is a double */
+  union
+  { int64_t	i;
+    double	f;
+  } value;
+} pq_prio;
+
+typedef struct pq_entry
+{ struct pq_entry *next;		/* Next with the same hash key */
+  Record	key;			/* The (ground) key */
+  pq_prio	priority;		/* Its priority */
+  uint64_t	seq;			/* Insertion order for ties */
+  size_t	index;			/* Index in heap array */
+} pq_entry;
+
+typedef struct prio_queue
+{ Table		table;			/* hash key --> pq_entry chain */
+  pq_entry    **heap;			/* Binary min-heap */
+  size_t	size;			/* # entries */
+  size_t	allocated;		/* # allocated heap slots */
+  uint64_t	seq;			/* Insertion counter */
+  simpleMutex	mutex;			/* Serialize access */
+} prio_queue;
+
+typedef struct pq_ref
+{ prio_queue   *queue;			/* represented queue */
+} pq_ref;
+
+#define pq_key(r) ((void*)(((uintptr_t)hashRecord(r)>>1)|0x1))
+
+
+static void
+free_pq_entry(pq_entry *e)
+{ freeRecord(e->key);
+  freeHeap(e, sizeof(*e));
+}
+
+
+static void
+free_pq_chain(void *name, void *value)
+{ pq_entry *e, *next;
+  (void)name;
+
+  for(e=value; e; e=next)
+  { next = e->next;
+    free_pq_entry(e);
+  }
+}
+
+
+static void
+free_prio_queue(prio_queue *q)
+{ destroyHTable(q->table);
+  if ( q->heap )
+    freeHeap(q->heap, q->allocated*sizeof(pq_entry*));
+  simpleMutexDelete(&q->mutex);
+  freeHeap(q, sizeof(*q));
+}
+
+
+		 /*******************************
+		 *	      SYMBOL		*
+		 *******************************/
+
+static int
+write_prio_queue_ref(IOSTREAM *s, atom_t aref, int flags)
+{ pq_ref *ref = PL_blob_data(aref, NULL, NULL);
+  (void)flags;
+
+  Sfprintf(s, "<priority_queue>(%p)", ref->queue);
+  return TRUE;
+}
+
+
+static int
+release_prio_queue_ref(atom_t aref)
+{ pq_ref *ref = PL_blob_data(aref, NULL, NULL);
+
+  if ( ref->queue )
+    free_prio_queue(ref->queue);
+
+  return TRUE;
+}
+
+
+static int
+save_prio_queue(atom_t aref, IOSTREAM *fd)
+{ pq_ref *ref = PL_blob_data(aref, NULL, NULL);
+  (void)fd;
+
+  return PL_warning("Cannot save reference to <priority_queue>(%p)",
+		    ref->queue);
+}
+
+
+static atom_t
+load_prio_queue(IOSTREAM *fd)
+{ (void)fd;
+
+  return PL_new_atom("<saved-priority_queue-ref>");
+}
+
+
+static PL_blob_t prio_queue_blob =
+{ PL_BLOB_MAGIC,
+  PL_BLOB_UNIQUE,
+  "priority_queue",
+  release_prio_queue_ref,
+  NULL,
+  write_prio_queue_ref,
+  NULL,
+  save_prio_queue,
+  load_prio_queue
+};
+
+
+static int
+get_prio_queue(term_t t, prio_queue **qp)
+{ void *data;
+  PL_blob_t *type;
+
+  if ( PL_get_blob(t, &data, NULL, &type) && type == &prio_queue_blob )
+  { pq_ref *ref = data;
+
+    *qp = ref->queue;
+    return TRUE;
+  }
+
+  PL_type_error("priority_queue", t);
+  return FALSE;
+}
+
+
+static int
+unify_prio_queue(term_t t, prio_queue *q)
+{ pq_ref ref;
+
+  ref.queue = q;
+  return PL_unify_blob(t, &ref, sizeof(ref), &prio_queue_blob);
+}
+
+
+static prio_queue *
+new_prio_queue(void)
+{ prio_queue *q = allocHeapOrHalt(sizeof(*q));
+
+  memset(q, 0, sizeof(*q));
+  q->table = newHTable(16);
+  q->table->free_symbol = free_pq_chain;
+  simpleMutexInit(&q->mutex);
+
+  return q;
+}
+
+
+		 /*******************************
+		 *	     PRIORITIES		*
+		 *******************************/
+
+static int
+get_priority(term_t t, pq_prio *p ARG_LD)
+{ if ( PL_is_float(t) )
+  { p->is_float = TRUE;
+    return PL_get_float(t, &p->value.f);
+  }
+  if ( PL_is_integer(t) )
+  { p->is_float = FALSE;
+    if ( PL_get_int64(t, &p->value.i) )
+      return TRUE;
+    return PL_representation_error("int64_t");
+  }
+  if ( PL_is_variable(t) )
+    return PL_instantiation_error(t);
+
+  return PL_type_error("number", t);
+}
+
+
+static int
+unify_priority(term_t t, const pq_prio *p ARG_LD)
+{ if ( p->is_float )
+    return PL_unify_float(t, p->value.f);
+  else
+    return PL_unify_int64(t, p->value.i);
+}
+
+
+/* compare_priority() follows the standard order of terms: numbers are
+   compared by value and if a float and an integer compare equal, the
+   float comes first.
+*/
+
+static int
+compare_priority(const pq_prio *p1, const pq_prio *p2)
+{ if ( !p1->is_float && !p2->is_float )
+  { return p1->value.i < p2->value.i ? -1 :
+	   p1->value.i > p2->value.i ?  1 : 0;
+  } else
+  { double f1 = p1->is_float ? p1->value.f : (double)p1->value.i;
+    double f2 = p2->is_float ? p2->value.f : (double)p2->value.i;
+
+    if ( f1 < f2 )
+      return -1;
+    if ( f1 > f2 )
+      return 1;
+    return p2->is_float - p1->is_float;
+  }
+}
+
+
+static int
+entry_before(const pq_entry *e1, const pq_entry *e2)
+{ int c = compare_priority(&e1->priority, &e2->priority);
+
+  return c < 0 || (c == 0 && e1->seq < e2->seq);
+}
+
+
+		 /*******************************
+		 *	       HEAP		*
+		 *******************************/
+
+static void
+heap_place(prio_queue *q, size_t i, pq_entry *e)
+{ q->heap[i] = e;
+  e->index = i;
+}
+
+
+static void
+sift_up(prio_queue *q, size_t i)
+{ pq_entry *e = q->heap[i];
+
+  while ( i > 0 )
+  { size_t parent = (i-1)/2;
+
+    if ( !entry_before(e, q->heap[parent]) )
+      break;
+    heap_place(q, i, q->heap[parent]);
+    i = parent;
+  }
+  heap_place(q, i, e);
+}
+
+
+static void
+sift_down(prio_queue *q, size_t i)
+{ pq_entry *e = q->heap[i];
+
+  for(;;)
+  { size_t child = 2*i+1;
+
+    if ( child >= q->size )
+      break;
+    if ( child+1 < q->size && entry_before(q->heap[child+1], q->heap[child]) )
+      child++;
+    if ( !entry_before(q->heap[child], e) )
+      break;
+    heap_place(q, i, q->heap[child]);
+    i = child;
+  }
+  heap_place(q, i, e);
+}
+
+
+static void
+heap_push(prio_queue *q, pq_entry *e)
+{ if ( q->size == q->allocated )
+  { size_t newsize = q->allocated ? q->allocated*2 : 16;
+    pq_entry **new = allocHeapOrHalt(newsize*sizeof(pq_entry*));
+
+    if ( q->heap )
+    { memcpy(new, q->heap, q->size*sizeof(pq_entry*));
+      freeHeap(q->heap, q->allocated*sizeof(pq_entry*));
+    }
+    q->heap = new;
+    q->allocated = newsize;
+  }
+
+  heap_place(q, q->size++, e);
+  sift_up(q, e->index);
+}
+
+
+static void
+heap_remove(prio_queue *q, pq_entry *e)
+{ size_t i = e->index;
+  pq_entry *last = q->heap[--q->size];
+
+  if ( last != e )
+  { heap_place(q, i, last);
+    sift_down(q, i);
+    sift_up(q, last->index);
+  }
+}
+
+
+		 /*******************************
+		 *	    KEY TABLE		*
+		 *******************************/
+
+static Record
+compile_key(term_t key ARG_LD)
+{ Record r;
+
+  if ( !PL_is_acyclic(key) )
+  { PL_type_error("acyclic_term", key);
+    return NULL;
+  }
+  if ( !PL_is_ground(key) )
+  { PL_instantiation_error(key);
+    return NULL;
+  }
+
+  if ( !(r=compileTermToHeap(key, R_DUPLICATE)) )
+    PL_no_memory();
+
+  return r;
+}
+
+
+static pq_entry *
+find_entry(prio_queue *q, Record key ARG_LD)
+{ pq_entry *e;
+
+  for(e=lookupHTable(q->table, pq_key(key)); e; e=e->next)
+  { if ( equalRecords(e->key, key) )
+      return e;
+  }
+
+  return NULL;
+}
+
+
+static void
+unlink_entry(prio_queue *q, pq_entry *e ARG_LD)
+{ void *hkey = pq_key(e->key);
+  pq_entry *head = lookupHTable(q->table, hkey);
+
+  if ( head == e )
+  { if ( e->next )
+      updateHTable(q->table, hkey, e->next);
+    else
+      deleteHTable(q->table, hkey);
+  } else
+  { pq_entry *prev;
+
+    for(prev=head; prev->next != e; prev=prev->next)
+      ;
+    prev->next = e->next;
+  }
+}
+
+
+/* remove_entry() removes e from the heap and the key table. The caller
+   must free e after releasing the mutex.
+*/
+
+static void
+remove_entry(prio_queue *q, pq_entry *e ARG_LD)
+{ heap_remove(q, e);
+  unlink_entry(q, e PASS_LD);
+}
+
+
+/* add_entry() adds key with priority to q or changes the priority of
+   key if it is already in q. The record is handed over to the queue.
+*/
+
+static void
+add_entry(prio_queue *q, Record key, const pq_prio *priority ARG_LD)
+{ pq_entry *e;
+
+  simpleMutexLock(&q->mutex);
+  if ( (e=find_entry(q, key PASS_LD)) )
+  { int c = compare_priority(priority, &e->priority);
+
+    e->priority = *priority;
+    if ( c < 0 )
+      sift_up(q, e->index);
+    else if ( c > 0 )
+      sift_down(q, e->index);
+  } else
+  { void *hkey = pq_key(key);
+    pq_entry *head = lookupHTable(q->table, hkey);
+
+    e = allocHeapOrHalt(sizeof(*e));
+    e->key      = key;
+    e->priority = *priority;
+    e->seq      = q->seq++;
+    if ( head )
+    { e->next = head->next;
+      head->next = e;
+    } else
+    { e->next = NULL;
+      addNewHTable(q->table, hkey, e);
+    }
+    heap_push(q, e);
+    key = NULL;
+  }
+  simpleMutexUnlock(&q->mutex);
+
+  if ( key )
+    freeRecord(key);
+}
+
+
+static int
+add_entry_term(prio_queue *q, term_t priority, term_t key ARG_LD)
+{ pq_prio p;
+  Record k;
+
+  if ( !get_priority(priority, &p PASS_LD) ||
+       !(k=compile_key(key PASS_LD)) )
+    return FALSE;
+  add_entry(q, k, &p PASS_LD);
+
+  return TRUE;
+}
+
+
+static int
+unify_record(term_t t, Record r ARG_LD)
+{ term_t copy = PL_new_term_ref();
+  int rc;
+
+  if ( (rc=copyRecordToGlobal(copy, r, ALLOW_GC PASS_LD)) < 0 )
+    return raiseStackOverflow(rc);
+
+  return PL_unify(t, copy);
+}
+
+
+		 /*******************************
+		 *	 PROLOG BINDING		*
+		 *******************************/
+
+/** priority_queue_create(-Queue) is det.
+ *  priority_queue_create(-Queue, +Pairs) is det.
+ */
+
+static int
+create_prio_queue(term_t t, term_t pairs ARG_LD)
+{ prio_queue *q = new_prio_queue();
+  int rc;
+
+  if ( pairs )
+  { term_t tail = PL_copy_term_ref(pairs);
+    term_t head = PL_new_term_ref();
+    term_t p    = PL_new_term_ref();
+    term_t k    = PL_new_term_ref();
+
+    while( PL_get_list(tail, head, tail) )
+    { if ( !PL_is_functor(head, FUNCTOR_minus2) )
+      { rc = PL_type_error("pair", head);
+	goto error;
+      }
+      _PL_get_arg(1, head, p);
+      _PL_get_arg(2, head, k);
+      if ( !add_entry_term(q, p, k PASS_LD) )
+      { rc = FALSE;
+	goto error;
+      }
+    }
+    if ( !PL_get_nil_ex(tail) )
+    { rc = FALSE;
+      goto error;
+    }
+  }
+
+  if ( (rc=unify_prio_queue(t, q)) )
+    return rc;
+
+error:
+  free_prio_queue(q);
+
+  return rc;
+}
+
+
+static
+PRED_IMPL("priority_queue_create", 1, priority_queue_create, 0)
+{ PRED_LD
+
+  return create_prio_queue(A1, 0 PASS_LD);
+}
+
+
+static
+PRED_IMPL("priority_queue_create", 2, priority_queue_create, 0)
+{ PRED_LD
+
+  return create_prio_queue(A1, A2 PASS_LD);
+}
+
+
+/** is_priority_queue(@Term) is semidet.
+ */
+
+static
+PRED_IMPL("is_priority_queue", 1, is_priority_queue, 0)
+{ void *data;
+  PL_blob_t *type;
+
+  return PL_get_blob(A1, &data, NULL, &type) && type == &prio_queue_blob;
+}
+
+
+/** priority_queue_add(+Queue, +Priority, +Key) is det.
+ */
+
+static
+PRED_IMPL("priority_queue_add", 3, priority_queue_add, 0)
+{ PRED_LD
+  prio_queue *q;
+
+  return ( get_prio_queue(A1, &q) &&
+	   add_entry_term(q, A2, A3 PASS_LD) );
+}
+
+
+/** priority_queue_get(+Queue, -Priority, -Key) is semidet.
+ *
+ * Remove the entry with the lowest priority.  The entry is removed
+ * before Priority and Key are unified.
+ */
+
+static
+PRED_IMPL("priority_queue_get", 3, priority_queue_get, 0)
+{ PRED_LD
+  prio_queue *q;
+  pq_entry *e = NULL;
+  int rc;
+
+  if ( !get_prio_queue(A1, &q) )
+    return FALSE;
+
+  simpleMutexLock(&q->mutex);
+  if ( q->size > 0 )
+  { e = q->heap[0];
+    remove_entry(q, e PASS_LD);
+  }
+  simpleMutexUnlock(&q->mutex);
+
+  if ( !e )
+    return FALSE;
+  rc = ( unify_priority(A2, &e->priority PASS_LD) &&
+	 unify_record(A3, e->key PASS_LD) );
+  free_pq_entry(e);
+
+  return rc;
+}
+
+
+/** priority_queue_min(+Queue, -Priority, -Key) is semidet.
+ */
+
+static
+PRED_IMPL("priority_queue_min", 3, priority_queue_min, 0)
+{ PRED_LD
+  prio_queue *q;
+  pq_prio p;
+  Record k = NULL;
+  int rc;
+
+  if ( !get_prio_queue(A1, &q) )
+    return FALSE;
+
+  simpleMutexLock(&q->mutex);
+  if ( q->size > 0 )
+  { p = q->heap[0]->priority;
+    k = q->heap[0]->key;
+    ATOMIC_INC(&k->references);
+  }
+  simpleMutexUnlock(&q->mutex);
+
+  if ( !k )
+    return FALSE;
+  rc = ( unify_priority(A2, &p PASS_LD) &&
+	 unify_record(A3, k PASS_LD) );
+  freeRecord(k);
+
+  return rc;
+}
+
+
+/** priority_queue_priority(+Queue, +Key, -Priority) is semidet.
+ */
+
+static
+PRED_IMPL("priority_queue_priority", 3, priority_queue_priority, 0)
+{ PRED_LD
+  prio_queue *q;
+  pq_entry *e;
+  pq_prio p;
+  Record k;
+
+  if ( !get_prio_queue(A1, &q) ||
+       !(k=compile_key(A2 PASS_LD)) )
+    return FALSE;
+
+  simpleMutexLock(&q->mutex);
+  if ( (e=find_entry(q, k PASS_LD)) )
+    p = e->priority;
+  simpleMutexUnlock(&q->mutex);
+  freeRecord(k);
+
+  return e && unify_priority(A3, &p PASS_LD);
+}
+
+
+/** priority_queue_delete(+Queue, +Key) is semidet.
+ */
+
+static
+PRED_IMPL("priority_queue_delete", 2, priority_queue_delete, 0)
+{ PRED_LD
+  prio_queue *q;
+  pq_entry *e;
+  Record k;
+
+  if ( !get_prio_queue(A1, &q) ||
+       !(k=compile_key(A2 PASS_LD)) )
+    return FALSE;
+
+  simpleMutexLock(&q->mutex);
+  if ( (e=find_entry(q, k PASS_LD)) )
+    remove_entry(q, e PASS_LD);
+  simpleMutexUnlock(&q->mutex);
+  freeRecord(k);
+
+  if ( e )
+  { free_pq_entry(e);
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+
+/** priority_queue_size(+Queue, -Count) is det.
+ */
+
+static
+PRED_IMPL("priority_queue_size", 2, priority_queue_size, 0)
+{ PRED_LD
+  prio_queue *q;
+
+  return ( get_prio_queue(A1, &q) &&
+	   PL_unify_int64(A2, (int64_t)q->size) );
+}
+
+
+		 /*******************************
+		 *      PUBLISH PREDICATES	*
+		 *******************************/
+
+BeginPredDefs(prioqueue)
+  PRED_DEF("priority_queue_create",   1, priority_queue_create,   0)
+  PRED_DEF("priority_queue_create",   2, priority_queue_create,   0)
+  PRED_DEF("is_priority_queue",       1, is_priority_queue,       0)
+  PRED_DEF("priority_queue_add",      3, priority_queue_add,      0)
+  PRED_DEF("priority_queue_get",      3, priority_queue_get,      0)
+  PRED_DEF("priority_queue_min",      3, priority_queue_min,      0)
+  PRED_DEF("priority_queue_priority", 3, priority_queue_priority, 0)
+  PRED_DEF("priority_queue_delete",   2, priority_queue_delete,   0)
+  PRED_DEF("priority_queue_size",     2, priority_queue_size,     0)
+EndPredDefs
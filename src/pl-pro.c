@@ -664,10 +664,12 @@ last_arg:
 
     assert(!is_marked(p));
 
-    if ( !onGlobal(a) )
-      printk(context, "Indirect at %p not on global stack", a);
-    if ( storage(*p) != STG_GLOBAL )
-      printk(context, "Indirect data not on global");
+    if ( !isLargeIndirect(*p) )
+    { if ( !onGlobal(a) )
+	printk(context, "Indirect at %p not on global stack", a);
+      if ( storage(*p) != STG_GLOBAL )
+	printk(context, "Indirect data not on global");
+    }
     if ( isBignum(*p) )
       return key+(word) valBignum(*p);
     if ( isFloat(*p) )
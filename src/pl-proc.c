@@ -40,6 +40,9 @@
 #include "pl-dbref.h"
 #include "pl-event.h"
 #include "pl-tabling.h"
+#include "pl-metrics.h"
+#include "pl-prof.h"
+#include "pl-transaction.h"
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 General  handling  of  procedures:  creation;  adding/removing  clauses;
@@ -51,8 +54,11 @@ finding source files, etc.
 
 static void	resetProcedure(Procedure proc, bool isnew);
 static atom_t	autoLoader(Definition def);
-static Procedure visibleProcedure(functor_t f, Module m ARG_LD);
+static Procedure visibleProcedure(functor_t f, Module m, int *clean ARG_LD);
 static void	freeClauseRef(ClauseRef cref);
+static void	link_clause_list(Definition def, Clause *clauses, size_t count,
+				 ClauseRef first, ClauseRef last, size_t rules,
+				 ClauseRef where ARG_LD);
 static int	setDynamicDefinition_unlocked(Definition def, bool isdyn);
 static void	registerDirtyDefinition(Definition def ARG_LD);
 static void	unregisterDirtyDefinition(Definition def);
@@ -115,7 +121,8 @@ lookupProcedure(functor_t f, Module m)
   ATOMIC_ADD(&m->code_size, SIZEOF_PROC);
 
   if ( (oproc=addHTable(m->procedures, (void *)f, proc)) == proc )
-  { return proc;
+  { resolveFunctorCacheChanged(f);
+    return proc;
   } else
   { unallocProcedure(proc);
     return oproc;
@@ -152,6 +159,62 @@ lingerDefinition(Definition def)
 }
 
 
+		 /*******************************
+		 *	      LOCKING		*
+		 *******************************/
+
+#ifdef O_PLMT
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+LOCKDEF() and UNLOCKDEF().  All  predicates   share  the  L_PREDICATE
+mutex, unless they have the `concurrent` property. Such predicates have
+a private mutex, such that modifying them  does not contend with
+modifications to other predicates.
+
+The private mutex is created  while   holding  L_PREDICATE  and remains
+until the definition is deallocated. Therefore, if we find no mutex, we
+must verify this after  acquiring  L_PREDICATE,   while  a  non-NULL
+mutex is stable.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void
+lockDefinition(Definition def)
+{ counting_mutex *m;
+
+  if ( !(m=def->mutex) )
+  { PL_LOCK(L_PREDICATE);
+    if ( !(m=def->mutex) )
+      return;
+    PL_UNLOCK(L_PREDICATE);
+  }
+
+  countingMutexLock(m);
+}
+
+
+void
+unlockDefinition(Definition def)
+{ counting_mutex *m;
+
+  if ( (m=def->mutex) )
+    countingMutexUnlock(m);
+  else
+    PL_UNLOCK(L_PREDICATE);
+}
+
+
+static void
+freeDefinitionMutex(Definition def)
+{ if ( def->mutex )
+  { freeSimpleMutex(def->mutex);
+    def->mutex = NULL;
+  }
+}
+
+#else
+#define freeDefinitionMutex(def) (void)0
+#endif /*O_PLMT*/
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 destroyDefinition() is called to destroy predicates from destroyModule()
 as well as destroying thread-local  instantiations   while  a  thread is
@@ -174,7 +237,10 @@ destroyDefinition(Definition def)
   freeCodesDefinition(def, FALSE);
 
   if ( false(def, P_FOREIGN|P_THREAD_LOCAL) )	/* normal Prolog predicate */
-  { deleteIndexes(&def->impl.clauses, TRUE);
+  { forgetIndexRequests(def);
+    deleteIndexes(&def->impl.clauses, TRUE);
+    deleteRangeIndexes(def);
+    deleteIndexStatistics(def);
     removeClausesPredicate(def, 0, FALSE);
     freeHeap(def->impl.any.args, sizeof(arg_info)*def->functor->arity);
   } else					/* foreign and thread-local */
@@ -190,6 +256,7 @@ destroyDefinition(Definition def)
   { freeHeap(def->tabling, sizeof(*def->tabling));
     def->tabling = NULL;
   }
+  freeCallCounts(def);
 
   DEBUG(MSG_CGC_PRED,
 	Sdprintf("destroyDefinition(%s)\n", predicateName(def)));
@@ -199,6 +266,7 @@ destroyDefinition(Definition def)
     set(def, P_ERASED);
   } else
   { DEBUG(MSG_PROC_COUNT, Sdprintf("Unalloc %s\n", predicateName(def)));
+    freeDefinitionMutex(def);
     freeHeap(def, sizeof(*def));
   }
 }
@@ -254,6 +322,7 @@ importDefinitionModule(Module m, Definition def, int flags)
     proc->flags      = flags;
     proc->source_no  = 0;
     addNewHTable(m->procedures, (void *)functor, proc);
+    resolveFunctorCacheChanged(functor);
   }
   UNLOCKMODULE(m);
 
@@ -295,6 +364,8 @@ resetProcedure(Procedure proc, bool isnew)
 
   if ( isnew )
   { deleteIndexes(&def->impl.clauses, TRUE);
+    deleteRangeIndexes(def);
+    deleteIndexStatistics(def);
     freeCodesDefinition(def, FALSE);
   } else
     freeCodesDefinition(def, TRUE);	/* carefully sets to S_VIRGIN */
@@ -652,7 +723,7 @@ get_procedure(term_t descr, Procedure *proc, term_t h, int how)
       }
       goto notfound;
     case GP_FIND:
-      if ( (p = visibleProcedure(fdef, m PASS_LD)) )
+      if ( (p = visibleProcedure(fdef, m, NULL PASS_LD)) )
       { *proc = p;
         goto out;
       }
@@ -783,20 +854,31 @@ isDefinedOrAutoloadProcedure(Procedure proc)
 }
 
 
+/* visibleProcedure() finds the first defined procedure for f in m or its
+ * super modules.  If clean is not NULL, it is set to FALSE if one of the
+ * modules searched before the result has an undefined procedure for f.
+ * Such a procedure may become defined without modifying the procedure
+ * tables and thus the result cannot be cached.
+ */
+
 static Procedure
-visibleProcedure(functor_t f, Module m ARG_LD)
+visibleProcedure(functor_t f, Module m, int *clean ARG_LD)
 { ListCell c;
   Procedure p;
 
   for(;;)
   { next:
 
-    if ( (p = isCurrentProcedure(f, m)) && isDefinedOrAutoloadProcedure(p) )
-      return p;
+    if ( (p = isCurrentProcedure(f, m)) )
+    { if ( isDefinedOrAutoloadProcedure(p) )
+	return p;
+      if ( clean )
+	*clean = FALSE;
+    }
 
     for(c=m->supers; c; c=c->next)
     { if ( c->next )
-      { if ( (p=visibleProcedure(f, c->value PASS_LD)) )
+      { if ( (p=visibleProcedure(f, c->value, clean PASS_LD)) )
 	  return p;
       } else
       { m = c->value;
@@ -903,7 +985,7 @@ pl_current_predicate1(term_t spec, control_t ctx)
 
       if ( e->functor )
       { if ( !e->emod )			/* fully specified */
-	  return (visibleProcedure(e->functor, e->module PASS_LD) != NULL);
+	  return (visibleProcedure(e->functor, e->module, NULL PASS_LD) != NULL);
       } else
       { e->epred = newTableEnum(e->module->procedures);
       }
@@ -928,7 +1010,7 @@ pl_current_predicate1(term_t spec, control_t ctx)
 
   for(;;)
   { if ( e->functor )			/* _M:foo/2 */
-    { if ( visibleProcedure(e->functor, e->module PASS_LD) )
+    { if ( visibleProcedure(e->functor, e->module, NULL PASS_LD) )
       { Module m;
 	PL_unify_atom(mt, e->module->name);
 
@@ -1088,9 +1170,114 @@ release_clause(Clause cl)
 }
 
 
+		 /*******************************
+		 *	   CLAUSE BLOCKS	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Normally each clause and  the  clause   reference  that  links it into the
+predicate are two separate  objects,  so   scanning  a  large  fact table
+hops all over the heap. assertClauseBlock() is  used by the QLF loader for
+static predicates and copies  a  sequence   of  clauses  into  a  single
+allocation in clause order, where each clause is preceded by its clause
+reference and a pointer to the block:
+
+    <clause_block> (<clause_ref> <ClauseBlock> <clause>)*
+
+The block is reference counted.  Each  packed clause and each packed clause
+reference holds a reference, which is  released by unallocClause() and
+freeClauseRef().  Packed clauses are  flagged  CL_PACKED. Other clause
+references to them, e.g., from the indexes, are normal objects.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct clause_block
+{ unsigned int	references;		/* # live clauses and clause refs */
+  size_t	size;			/* Allocated size */
+} clause_block, *ClauseBlock;
+
+#define SIZEOF_PACKED_HDR (SIZEOF_CREF_CLAUSE+sizeof(ClauseBlock))
+#define clauseBlock(cl)	  (((ClauseBlock*)(cl))[-1])
+#define packedCRef(cl)	  ((ClauseRef)((char*)(cl) - SIZEOF_PACKED_HDR))
+
+static void
+releaseClauseBlock(ClauseBlock cb)
+{ if ( ATOMIC_DEC(&cb->references) == 0 )
+    freeHeap(cb, cb->size);
+}
+
+
+/* assertClauseBlock() adds count clauses whose images are stored back to
+   back in data (size bytes) to the end of def.  The images are copied.
+*/
+
+int
+assertClauseBlock(Definition def, const char *data, size_t size,
+		  size_t count ARG_LD)
+{ Clause *clauses;
+  size_t i;
+  int rc = TRUE;
+
+  if ( count == 0 )
+    return TRUE;
+
+  clauses = allocHeapOrHalt(count*sizeof(Clause));
+  if ( def->events || LD->transaction.generation )
+  { for(i=0; i<count; i++)
+    { Clause src = (Clause)data;
+      size_t csize = sizeofClause(src->code_size);
+
+      clauses[i] = arena_alloc(csize);
+      memcpy(clauses[i], src, csize);
+      data += csize;
+    }
+    rc = assertDefinitionList(def, clauses, count, CL_END PASS_LD);
+  } else
+  { size_t bsize = sizeof(clause_block) + count*SIZEOF_PACKED_HDR + size;
+    ClauseBlock cb = allocHeapOrHalt(bsize);
+    ClauseRef first = NULL, last = NULL;
+    size_t rules = 0;
+    char *out = (char*)(cb+1);
+
+    cb->references = (unsigned int)(count*2);
+    cb->size = bsize;
+    for(i=0; i<count; i++)
+    { Clause src = (Clause)data;
+      size_t csize = sizeofClause(src->code_size);
+      ClauseRef cref = (ClauseRef)out;
+      Clause cl = (Clause)(out+SIZEOF_PACKED_HDR);
+
+      memcpy(cl, src, csize);
+      set(cl, CL_PACKED);
+      clauseBlock(cl) = cb;
+      cref->next = NULL;
+      argKey(cl->codes, 0, &cref->d.key);
+      cref->value.clause = cl;
+      acquire_clause(cl);
+
+      if ( last )
+	last->next = cref;
+      else
+	first = cref;
+      last = cref;
+      if ( false(cl, UNIT_CLAUSE) )
+	rules++;
+      clauses[i] = cl;
+
+      data += csize;
+      out = (char*)cl + csize;
+    }
+
+    link_clause_list(def, clauses, count, first, last, rules, CL_END PASS_LD);
+  }
+  freeHeap(clauses, count*sizeof(Clause));
+
+  return rc;
+}
+
+
 ClauseRef
 newClauseRef(Clause clause, word key)
-{ ClauseRef cref = allocHeapOrHalt(SIZEOF_CREF_CLAUSE);
+{ ClauseRef cref = arena_alloc(SIZEOF_CREF_CLAUSE);
 
   DEBUG(MSG_CGC_CREF_PL,
 	Sdprintf("/**/ a(%p, %p, %d, '%s').\n",
@@ -1109,14 +1296,20 @@ newClauseRef(Clause clause, word key)
 static void
 freeClauseRef(ClauseRef cref)
 { Clause cl = cref->value.clause;
+  ClauseBlock cb = NULL;
 
   DEBUG(MSG_CGC_CREF_PL,
 	Sdprintf("/**/ d(%p, %p, %d).\n",
 		 cref, cl, (int)cl->references));
 
+  if ( true(cl, CL_PACKED) && packedCRef(cl) == cref )
+    cb = clauseBlock(cl);
   release_clause(cl);
 
-  freeHeap(cref, SIZEOF_CREF_CLAUSE);
+  if ( cb )
+    releaseClauseBlock(cb);
+  else
+    arena_free(cref, SIZEOF_CREF_CLAUSE);
 }
 
 
@@ -1194,7 +1387,7 @@ activePredicate(const Definition *defs, const Definition def)
   return FALSE;
 }
 
-static void
+void
 setLastModifiedPredicate(Definition def, gen_t gen)
 { Module m = def->module;
   gen_t lmm;
@@ -1212,6 +1405,50 @@ setLastModifiedPredicate(Definition def, gen_t gen)
 		 *	      ASSERT		*
 		 *******************************/
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The erased prefix of a predicate is the sequence of erased clauses at the
+start of its clause list.  It allows firstClauseRef() to start scanning
+after these clauses if the frame generation is not older than the latest
+erasure in the prefix.  This makes retracting from the front of a queue
+predicate O(1) instead of O(erased clauses since the last clause GC).
+
+extendErasedPrefix() is called after erasing a clause. As the prefix is
+extended incrementally the amortized cost is constant. The generation is
+published before the clause reference and is never decreased; see
+firstClauseRef().  resetErasedPrefix() must be called before clauses are
+inserted anywhere but at the end.  Clause GC updates the prefix if it
+removes its last clause.  All these are called with the predicate locked.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+extendErasedPrefix(Definition def)
+{ ClauseRef last = def->erased_prefix.last;
+  ClauseRef cref = last ? last->next : def->impl.clauses.first_clause;
+  gen_t gen = def->erased_prefix.generation;
+
+  for(; cref && true(cref->value.clause, CL_ERASED); cref = cref->next)
+  { Clause cl = cref->value.clause;
+
+    if ( cl->generation.erased > gen )
+      gen = cl->generation.erased;
+    last = cref;
+  }
+
+  if ( last != def->erased_prefix.last )
+  { def->erased_prefix.generation = gen;
+    MEMORY_BARRIER();
+    def->erased_prefix.last = last;
+  }
+}
+
+
+static void
+resetErasedPrefix(Definition def)
+{ def->erased_prefix.last = NULL;
+  MEMORY_BARRIER();
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Assert a clause to a procedure. Where askes to assert either at the head
 or at the tail of the clause list.
@@ -1230,8 +1467,9 @@ definition this will be  called  and   an  S_TRUSTME  supervisor will be
 installed, causing further clauses to have no effect.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-ClauseRef
-assertDefinition(Definition def, Clause clause, ClauseRef where ARG_LD)
+static ClauseRef
+assert_definition(Definition def, Clause clause, ClauseRef where,
+		  ClauseRef prev ARG_LD)
 { word key;
   ClauseRef cref;
 
@@ -1241,11 +1479,17 @@ assertDefinition(Definition def, Clause clause, ClauseRef where ARG_LD)
 			       clause PASS_LD) )
     return NULL;
 
+  if ( unlikely(LD->transaction.generation) &&
+       !transactionReserve(PASS_LD1) )
+    return NULL;
+
   argKey(clause->codes, 0, &key);
   cref = newClauseRef(clause, key);
 
   LOCKDEF(def);
   acquire_def(def);
+  if ( where != CL_END )
+    resetErasedPrefix(def);
   if ( !def->impl.clauses.last_clause )
   { def->impl.clauses.first_clause = def->impl.clauses.last_clause = cref;
   } else if ( where == CL_START || where == def->impl.clauses.first_clause )
@@ -1256,6 +1500,9 @@ assertDefinition(Definition def, Clause clause, ClauseRef where ARG_LD)
 
     last->next = cref;
     def->impl.clauses.last_clause = cref;
+  } else if ( prev && prev->next == where )
+  { cref->next = where;
+    prev->next = cref;
   } else				/* insert before */
   { ClauseRef cr;
 
@@ -1275,9 +1522,13 @@ assertDefinition(Definition def, Clause clause, ClauseRef where ARG_LD)
   if ( true(def, P_DIRTYREG) )
     ATOMIC_INC(&GD->clauses.dirty);
 #ifdef O_LOGICAL_UPDATE
-  clause->generation.created = next_global_generation();
-  clause->generation.erased  = GEN_MAX;	/* infinite */
-  setLastModifiedPredicate(def, clause->generation.created);
+  if ( unlikely(LD->transaction.generation) )
+  { transactionAssertClause(def, clause PASS_LD);
+  } else
+  { clause->generation.created = next_global_generation();
+    clause->generation.erased  = GEN_MAX;	/* infinite */
+    setLastModifiedPredicate(def, clause->generation.created);
+  }
 #endif
 
   if ( false(def, P_DYNAMIC|P_LOCKED_SUPERVISOR) ) /* see (*) above */
@@ -1292,6 +1543,129 @@ assertDefinition(Definition def, Clause clause, ClauseRef where ARG_LD)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+assertDefinitionList() adds count clauses  to   def  as  a single update.
+`where` is either CL_START or CL_END and   the  clauses are in the order
+they must appear in the predicate. All clauses   get the same generation,
+so they become visible atomically, and  the   indexes  are updated under
+one lock.  The clauses are owned by this  function: if we fail, clauses
+that are not added are freed.
+
+If the predicate has update events we must  call the event hook for each
+clause and we simply fall back to assertDefinition().  We do the same
+inside a transaction, which buffers each clause.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+assertDefinitionList(Definition def, Clause *clauses, size_t count,
+		     ClauseRef where ARG_LD)
+{ ClauseRef first = NULL, last = NULL;
+  size_t i, rules = 0;
+
+  if ( count == 0 )
+    return TRUE;
+
+  if ( def->events || LD->transaction.generation )
+  { if ( where == CL_START )
+    { for(i=count; i-- > 0; )
+      { if ( !assertDefinition(def, clauses[i], where PASS_LD) )
+	{ for(; i-- > 0; )
+	    freeClause(clauses[i]);
+	  return FALSE;
+	}
+      }
+    } else
+    { for(i=0; i<count; i++)
+      { if ( !assertDefinition(def, clauses[i], where PASS_LD) )
+	{ for(i++; i<count; i++)
+	    freeClause(clauses[i]);
+	  return FALSE;
+	}
+      }
+    }
+
+    return TRUE;
+  }
+
+  for(i=0; i<count; i++)
+  { word key;
+    ClauseRef cref;
+
+    argKey(clauses[i]->codes, 0, &key);
+    cref = newClauseRef(clauses[i], key);
+    if ( last )
+      last->next = cref;
+    else
+      first = cref;
+    last = cref;
+    if ( false(clauses[i], UNIT_CLAUSE) )
+      rules++;
+  }
+
+  link_clause_list(def, clauses, count, first, last, rules, where PASS_LD);
+
+  return TRUE;
+}
+
+
+/* link_clause_list() adds the clause  references first..last for the
+   count clauses to def as a single update.  See assertDefinitionList().
+*/
+
+static void
+link_clause_list(Definition def, Clause *clauses, size_t count,
+		 ClauseRef first, ClauseRef last, size_t rules,
+		 ClauseRef where ARG_LD)
+{ size_t i;
+  gen_t gen;
+
+  LOCKDEF(def);
+  acquire_def(def);
+#ifdef O_LOGICAL_UPDATE
+  gen = next_global_generation();
+  for(i=0; i<count; i++)
+  { clauses[i]->generation.created = gen;
+    clauses[i]->generation.erased  = GEN_MAX;
+  }
+  MEMORY_BARRIER();
+#endif
+
+  if ( !def->impl.clauses.last_clause )
+  { def->impl.clauses.first_clause = first;
+    def->impl.clauses.last_clause  = last;
+  } else if ( where == CL_START )
+  { resetErasedPrefix(def);
+    last->next = def->impl.clauses.first_clause;
+    def->impl.clauses.first_clause = first;
+  } else
+  { def->impl.clauses.last_clause->next = first;
+    def->impl.clauses.last_clause = last;
+  }
+
+  def->impl.clauses.number_of_clauses += count;
+  def->impl.clauses.number_of_rules += rules;
+  if ( true(def, P_DIRTYREG) )
+    ATOMIC_ADD(&GD->clauses.dirty, count);
+#ifdef O_LOGICAL_UPDATE
+  setLastModifiedPredicate(def, gen);
+#endif
+
+  if ( false(def, P_DYNAMIC|P_LOCKED_SUPERVISOR) )
+    freeCodesDefinition(def, TRUE);
+
+  addClausesToIndexes(def, clauses, count, where);
+  release_def(def);
+  DEBUG(CHK_SECURE, checkDefinition(def));
+  UNLOCKDEF(def);
+}
+
+
+ClauseRef
+assertDefinition(Definition def, Clause clause, ClauseRef where ARG_LD)
+{ return assert_definition(def, clause, where, NULL PASS_LD);
+}
+
+
 ClauseRef
 assertProcedure(Procedure proc, Clause clause, ClauseRef where ARG_LD)
 { Definition def = getProcDefinition(proc);
@@ -1300,6 +1674,22 @@ assertProcedure(Procedure proc, Clause clause, ClauseRef where ARG_LD)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+assertProcedureBefore() inserts clause  before  where,   where  prev is a
+hint for the clause reference that  precedes   where.  If the hint is
+invalid we scan the clause list. This avoids  quadratic behaviour if the
+reconsult code inserts many clauses into a large predicate.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+ClauseRef
+assertProcedureBefore(Procedure proc, Clause clause,
+		      ClauseRef where, ClauseRef prev ARG_LD)
+{ Definition def = getProcDefinition(proc);
+
+  return assert_definition(def, clause, where, prev PASS_LD);
+}
+
+
 /*  Abolish a procedure.  Referenced  clauses  are   unlinked  and left
     dangling in the dark until the procedure referencing it deletes it.
 
@@ -1316,6 +1706,9 @@ abolishProcedure(Procedure proc, Module module)
 
   DEBUG(MSG_PROC, Sdprintf("abolishProcedure(%s)\n", predicateName(def)));
 
+  if ( def->module == module && def->codes == SUPERVISOR(lazy) )
+    discardLazyDefinition(def);
+
   startCritical;
   LOCKDEF(def);
   if ( def->module != module )		/* imported predicate; remove link */
@@ -1333,6 +1726,7 @@ abolishProcedure(Procedure proc, Module module)
     resetProcedure(proc, TRUE);
   } else if ( true(def, P_FOREIGN) )	/* foreign: make normal */
   { def->impl.clauses.first_clause = def->impl.clauses.last_clause = NULL;
+    def->erased_prefix.last = NULL;
     resetProcedure(proc, TRUE);
   } else if ( true(def, P_THREAD_LOCAL) )
   { UNLOCKDEF(def);
@@ -1425,12 +1819,41 @@ represent tries.
 int
 retractClauseDefinition(Definition def, Clause clause)
 { GET_LD
-  size_t size = sizeofClause(clause->code_size) + SIZEOF_CREF_CLAUSE;
 
   if ( def->events &&
        !predicate_update_event(def, ATOM_retract, clause PASS_LD) )
     return FALSE;
 
+  if ( unlikely(LD->transaction.generation) )
+  { int rc;
+
+    if ( !transactionReserve(PASS_LD1) )
+      return FALSE;
+    LOCKDEF(def);
+    rc = ( false(clause, CL_ERASED) &&
+	   transactionRetractClause(def, clause PASS_LD) );
+    UNLOCKDEF(def);
+
+    return rc;
+  }
+
+  return eraseClauseDefinition(def, clause, GEN_INVALID);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+eraseClauseDefinition() does the  actual  work   for  retracting  clause,
+setting its erased generation to `gen` or a new global generation if gen
+is GEN_INVALID.  The latter  is  used  by   committing  a  transaction,
+which erases all clauses retracted in the transaction at the same
+generation.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+eraseClauseDefinition(Definition def, Clause clause, gen_t gen)
+{ GET_LD
+  size_t size = sizeofClause(clause->code_size) + SIZEOF_CREF_CLAUSE;
+
   LOCKDEF(def);
   if ( true(clause, CL_ERASED) )
   { UNLOCKDEF(def);
@@ -1445,9 +1868,12 @@ retractClauseDefinition(Definition def, Clause clause)
   if ( false(clause, UNIT_CLAUSE) )
     def->impl.clauses.number_of_rules--;
 #ifdef O_LOGICAL_UPDATE
-  clause->generation.erased = next_global_generation();
-  setLastModifiedPredicate(def, clause->generation.erased);
+  if ( gen == GEN_INVALID )
+    gen = next_global_generation();
+  clause->generation.erased = gen;
+  setLastModifiedPredicate(def, gen);
 #endif
+  extendErasedPrefix(def);
   DEBUG(CHK_SECURE, checkDefinition(def));
   UNLOCKDEF(def);
 
@@ -1470,16 +1896,21 @@ retractClauseDefinition(Definition def, Clause clause)
 
 void
 unallocClause(Clause c)
-{ ATOMIC_SUB(&GD->statistics.codes, c->code_size);
+{ size_t size = sizeofClause(c->code_size);
+  ClauseBlock cb = true(c, CL_PACKED) ? clauseBlock(c) : NULL;
+
+  ATOMIC_SUB(&GD->statistics.codes, c->code_size);
   ATOMIC_DEC(&GD->statistics.clauses);
 
 #ifdef ALLOC_DEBUG
 #define ALLOC_FREE_MAGIC 0xFB
-  size_t size = sizeofClause(c->code_size);
   memset(c, ALLOC_FREE_MAGIC, size);
 #endif
 
-  PL_free(c);
+  if ( cb )
+    releaseClauseBlock(cb);
+  else
+    arena_free(c, size);
 }
 
 
@@ -1597,6 +2028,8 @@ cleanDefinition(Definition def, DirtyDefInfo ddi, gen_t start, int *rcp)
 
 	LOCKDEF(def);
 	prev = find_prev(def, prev, cref);
+	if ( def->erased_prefix.last == cref )
+	  def->erased_prefix.last = prev;
 	if ( !prev )
 	{ def->impl.clauses.first_clause = cref->next;
 	  if ( !cref->next )
@@ -2368,6 +2801,7 @@ maybeUnregisterDirtyDefinition(Definition def)
     assert(def->module == NULL);
     if ( def->impl.clauses.first_clause == NULL )
     { unregisterDirtyDefinition(def);
+      freeDefinitionMutex(def);
       freeHeap(def, sizeof(*def));
     }
   }
@@ -2451,6 +2885,7 @@ pl_garbage_collect_clauses(void)
     GD->clauses.cgc_count++;
     GD->clauses.cgc_reclaimed	+= removed;
     GD->clauses.cgc_time        += (gct=ThreadCPUTime(LD, CPU_USER) - t0);
+    metricObserve(MET_CGC_SECONDS, gct);
     GD->clauses.erased_size_last = GD->clauses.erased_size;
 
     DEBUG(MSG_CGC, Sdprintf("CGC: removed %ld clauses "
@@ -2541,12 +2976,63 @@ will later call trapUndefined() to generate   an  error message (or link
 the procedure from the library via autoload).
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+resolveProcedure() is called for each meta-call  and typically has to
+search the module and its super modules   (user, system). We cache the
+result per thread. A cached result  is   valid  as long as the procedure
+tables and module inheritance are not  modified and the procedure is
+still defined.
+
+Adding a procedure for f to a module   only  affects the resolution of
+f. Such changes call resolveFunctorCacheChanged(), which only bumps the
+epoch of the slot for f. This  implies   that  creating  code  in one
+module does not flush the cache for   the  other modules. Changes to the
+module inheritance and destroying a module call
+resolveProcedureCacheChanged(), which invalidates all entries.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define resolveCacheEntry(f, m) \
+	(&LD->resolve.cache[(indexFunctor(f) ^ ((uintptr_t)(m)>>5)) & \
+			    (RESOLVE_CACHE_SIZE-1)])
+#define resolveFunctorEpoch(f) \
+	(&GD->procedures.resolve_functor_epoch[indexFunctor(f) & \
+					       (RESOLVE_EPOCH_SLOTS-1)])
+
+void
+resolveProcedureCacheChanged(void)
+{ ATOMIC_INC(&GD->procedures.resolve_epoch);
+}
+
+
+void
+resolveFunctorCacheChanged(functor_t f)
+{ ATOMIC_INC(resolveFunctorEpoch(f));
+}
+
+
 Procedure
 resolveProcedure__LD(functor_t f, Module module ARG_LD)
 { Procedure proc;
-
-  if ( (proc = visibleProcedure(f, module PASS_LD)) )
+  unsigned int epoch = GD->procedures.resolve_epoch;
+  unsigned int functor_epoch = *resolveFunctorEpoch(f);
+  int clean = TRUE;
+  struct resolve_cache_entry *e = resolveCacheEntry(f, module);
+
+  if ( e->functor == f && e->module == module &&
+       e->epoch == epoch && e->functor_epoch == functor_epoch &&
+       isDefinedOrAutoloadProcedure(e->procedure) )
+    return e->procedure;
+
+  if ( (proc = visibleProcedure(f, module, &clean PASS_LD)) )
+  { if ( clean )
+    { e->functor       = f;
+      e->module        = module;
+      e->procedure     = proc;
+      e->epoch         = epoch;
+      e->functor_epoch = functor_epoch;
+    }
     return proc;
+  }
 
   return lookupProcedure(f, module);
 }
@@ -2908,7 +3394,7 @@ PRED_IMPL("retract", 1, retract,
 	    ctx = alloc_retract_context(ctx);
 
 	  DEBUG(0,
-		assert(GLOBALLY_VISIBLE_CLAUSE(
+		assert(visibleClause(
 			   ctx->chp.cref->value.clause,
 			   generationFrame(environment_frame))));
 	  protectCRef(ctx->chp.cref);
@@ -3218,12 +3704,20 @@ num_visible_clauses(Definition def, atom_t key)
 }
 
 
-size_t
-sizeof_predicate(Definition def)
+typedef struct predicate_memory
+{ size_t	definition;		/* predicate header and supervisor */
+  size_t	clauses;		/* clauses that are not erased */
+  size_t	erased;			/* erased, not yet reclaimed clauses */
+  size_t	indexes;		/* clause indexes */
+  size_t	lingering;		/* detached data that may be in use */
+} predicate_memory;
+
+static void
+predicate_memory_usage(Definition def, predicate_memory *mem)
 { GET_LD
-  size_t size = sizeof(*def);
 
-  size += sizeof_supervisor(def->codes);
+  memset(mem, 0, sizeof(*mem));
+  mem->definition = sizeof(*def) + sizeof_supervisor(def->codes);
 
   if ( false(def, P_FOREIGN) )
   { ClauseRef c;
@@ -3231,16 +3725,60 @@ sizeof_predicate(Definition def)
     acquire_def(def);
     for(c = def->impl.clauses.first_clause; c; c = c->next)
     { Clause cl = c->value.clause;
+      size_t size = sizeofClause(cl->code_size) + SIZEOF_CREF_CLAUSE;
 
-      size += sizeofClause(cl->code_size);
-      size += SIZEOF_CREF_CLAUSE;
+      if ( true(cl, CL_ERASED) )
+	mem->erased += size;
+      else
+	mem->clauses += size;
     }
     release_def(def);
 
-    size += sizeofClauseIndexes(def);
+    mem->indexes = sizeofClauseIndexes(def);
+  }
+
+  mem->lingering = sizeof_lingering(def->lingering);
+}
+
+
+size_t
+sizeof_predicate(Definition def)
+{ predicate_memory mem;
+
+  predicate_memory_usage(def, &mem);
+
+  return mem.definition + mem.clauses + mem.erased + mem.indexes;
+}
+
+
+static int
+unify_predicate_memory(Definition def, term_t value)
+{ GET_LD
+  predicate_memory mem;
+  term_t tail = PL_copy_term_ref(value);
+  term_t head = PL_new_term_ref();
+  const struct
+  { const char *name;
+    size_t     *value;
+  } *m, members[] =
+  { { "definition",     &mem.definition },
+    { "clauses",        &mem.clauses },
+    { "erased_clauses", &mem.erased },
+    { "clause_indexes", &mem.indexes },
+    { "lingering",      &mem.lingering },
+    { NULL,		NULL }
+  };
+
+  predicate_memory_usage(def, &mem);
+  for(m=members; m->name; m++)
+  { if ( !PL_unify_list(tail, head, tail) ||
+	 !PL_unify_term(head,
+			PL_FUNCTOR_CHARS, m->name, 1,
+			  PL_INT64, (int64_t)*m->value) )
+      return FALSE;
   }
 
-  return size;
+  return PL_unify_nil(tail);
 }
 
 
@@ -3261,7 +3799,7 @@ PRED_IMPL("$get_predicate_attribute", 3, get_predicate_attribute,
 
   if ( !PL_strip_module(pred, &module, head) ||
        !PL_get_functor(head, &fd) ||
-       ( !(proc = visibleProcedure(fd, module PASS_LD)) &&
+       ( !(proc = visibleProcedure(fd, module, NULL PASS_LD)) &&
 	 !(proc = isCurrentProcedure(fd, module)) ) )
     fail;
 
@@ -3270,12 +3808,25 @@ PRED_IMPL("$get_predicate_attribute", 3, get_predicate_attribute,
   if ( !PL_get_atom(what, &key) )
     return PL_error(NULL, 0, NULL, ERR_TYPE, ATOM_atom, what);
 
+  if ( (key == ATOM_line_count || key == ATOM_file ||
+	key == ATOM_number_of_clauses || key == ATOM_number_of_rules ||
+	key == ATOM_size || key == ATOM_memory) &&
+       !loadedDefinition(def) )
+    return FALSE;
+
   if ( key == ATOM_imported )
   { if ( module == def->module )
       fail;
     return PL_unify_atom(value, def->module->name);
   } else if ( key == ATOM_indexed )
   { return unify_index_pattern(proc, value);
+  } else if ( key == ATOM_index_statistics )
+  { return unify_index_statistics(proc, value);
+  } else if ( key == ATOM_call_counts )
+  { return unify_call_counts(def, value);
+  } else if ( key == ATOM_call_counting )
+  { return PL_unify_integer(value,
+			    def->call_counts && def->call_counts->active);
   } else if ( key == ATOM_meta_predicate )
   { if ( false(def, P_META) )
       fail;
@@ -3342,6 +3893,16 @@ PRED_IMPL("$get_predicate_attribute", 3, get_predicate_attribute,
   } else if ( key == ATOM_size )
   { def = getProcDefinition(proc);
     return PL_unify_integer(value, sizeof_predicate(def));
+  } else if ( key == ATOM_memory )
+  { def = getProcDefinition(proc);
+    return unify_predicate_memory(def, value);
+  } else if ( key == ATOM_concurrent )
+  {
+#ifdef O_PLMT
+    return PL_unify_integer(value, def->mutex ? 1 : 0);
+#else
+    return PL_unify_integer(value, 0);
+#endif
   } else if ( tbl_is_predicate_attribute(key) )
   { size_t sz_value;
 
@@ -3391,6 +3952,44 @@ setDynamicDefinition(Definition def, bool isdyn)
   return rc;
 }
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Give the predicate a private  mutex  (see   lockDefinition()).  As  the
+mutex cannot be removed safely while   other threads may be modifying
+the predicate, this property cannot be reset.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+setConcurrentDefinition(Procedure proc, bool val)
+{
+#ifdef O_PLMT
+  Definition def = proc->definition;
+
+  if ( true(def, P_FOREIGN) )
+    return PL_error(NULL, 0, NULL, ERR_PERMISSION_PROC,
+		    ATOM_modify, ATOM_foreign, proc);
+
+  if ( val )
+  { if ( !isDefinedProcedure(proc) && !setDynamicDefinition(def, TRUE) )
+      return FALSE;
+
+    PL_LOCK(L_PREDICATE);
+    if ( !def->mutex )
+    { counting_mutex *m = allocSimpleMutex(predicateName(def));
+
+      MEMORY_BARRIER();
+      def->mutex = m;
+    }
+    PL_UNLOCK(L_PREDICATE);
+  } else if ( def->mutex )
+  { return PL_error(NULL, 0, "concurrent property cannot be reset",
+		    ERR_PERMISSION_PROC, ATOM_modify, ATOM_concurrent, proc);
+  }
+#endif
+
+  return TRUE;
+}
+
+
 int
 setThreadLocalDefinition(Definition def, bool val)
 {
@@ -3515,6 +4114,20 @@ PRED_IMPL("$set_predicate_attribute", 3, set_predicate_attribute,
     return FALSE;
   }
 
+  if ( key == ATOM_concurrent )
+  { if ( !get_bool_or_int_ex(value, &val PASS_LD) ||
+	 !get_procedure(pred, &proc, 0, GP_DEFINE|GP_NAMEARITY) )
+      return FALSE;
+    return setConcurrentDefinition(proc, val);
+  }
+
+  if ( key == ATOM_call_counting )
+  { if ( !get_bool_or_int_ex(value, &val PASS_LD) ||
+	 !get_procedure(pred, &proc, 0, GP_RESOLVE|GP_NAMEARITY) )
+      return FALSE;
+    return setCallCounting(proc->definition, val);
+  }
+
   if ( !get_bool_or_int_ex(value, &val PASS_LD) ||
        !(att = attribute_mask(key)) )
     return FALSE;
@@ -3639,6 +4252,8 @@ redefineProcedure(Procedure proc, SourceFile sf, unsigned int suppress)
   { ClauseRef first;
 
     def = getProcDefinition__LD(def PASS_LD);
+    if ( !loadedDefinition(def) )
+      return FALSE;
     if ( !(first = hasClausesDefinition(def)) )
       return TRUE;				/* (*) see above */
 
@@ -3736,6 +4351,8 @@ PRED_IMPL("copy_predicate_clauses", 2, copy_predicate_clauses, PL_FA_TRANSPARENT
   if ( !isDefinedProcedure(from) )
     trapUndefined(getProcDefinition(from) PASS_LD);
   def = getProcDefinition(from);
+  if ( !loadedDefinition(def) )
+    return FALSE;
   generation = global_generation();		/* take a consistent snapshot */
 
   if ( true(def, P_FOREIGN) )
@@ -3762,9 +4379,10 @@ PRED_IMPL("copy_predicate_clauses", 2, copy_predicate_clauses, PL_FA_TRANSPARENT
 
     if ( visibleClause(cl, generation) )
     { size_t size = sizeofClause(cl->code_size);
-      Clause copy = PL_malloc_atomic(size);
+      Clause copy = arena_alloc(size);
 
       memcpy(copy, cl, size);
+      clear(copy, CL_PACKED);
       copy->predicate = copy_def;
       if ( def->module != copy_def->module )
 	remoduleClause(copy, def->module, copy_def->module);
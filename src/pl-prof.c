@@ -38,6 +38,7 @@
 #include "pl-incl.h"
 #include "pl-comp.h"
 #include "pl-prof.h"
+#include "pl-tracepoint.h"
 
 #undef LD
 #define LD LOCAL_LD
@@ -1335,6 +1336,1077 @@ PL_prof_exit(void *node)
 
 #endif /* O_PROFILE */
 
+		 /*******************************
+		 *	SAMPLING PROFILER	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The sampling profiler does not hook into  the virtual machine and can be
+enabled and disabled for any thread  while   it  is running.  A detached
+sampler thread wakes up every GD->profile.sample.interval microseconds and
+raises SIG_PROF_SAMPLE in all threads   for  which info->prof_sample is
+set. Because this is a synchronous   signal,  the sampled thread handles
+it at the next safe point, where   sampleProfilerHandler() walks the local
+stack and adds the sequence of  predicates   to  a  table of call stacks,
+aggregating identical stacks.  This  is   the  "folded  stacks"
+representation used by flame-graph tools.
+
+Each sampled thread has its own table (info->prof_samples), such that
+threads of a large pool do not  compete   for  a shared lock.  The table
+mutex is only contended while '$prof_sample_stacks'/2 or reset merges or
+clears the tables.  When a thread  terminates,   its  table  is merged
+into GD->profile.sample.table.  If GD->profile.sample.all is set, all
+threads, including those created later, are sampled.
+
+Locking order is L_PROFILE, followed   by  the mutex of a thread table.
+Clearing info->prof_sample and info->prof_samples  is  done  holding
+L_PROFILE, which guarantees that neither  the   sampler  nor a merging
+thread accesses the data of a terminated thread.
+
+Frames of predicates marked P_NOPROFILE  are   skipped  and  direct
+recursion is collapsed into a single  entry.   The  walk is bounded by
+SAMPLE_MAX_FRAMES and the recorded stack by  SAMPLE_MAX_DEPTH. Stacks
+that hit a bound are marked as truncated.
+
+The signal is not combined with   alertThread(),  so threads blocked in a
+system call are not woken and only collect a sample when they resume.
+The table holds Definition pointers, as   does the call graph of the
+classical profiler.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef O_PROFILE
+
+#define SAMPLE_MAX_FRAMES	 1000	/* Max frames walked per sample */
+#define SAMPLE_MAX_DEPTH	  128	/* Max predicates recorded per sample */
+#define SAMPLE_INTERVAL		10000	/* Default interval (usec) */
+#define SAMPLE_INITIAL_BUCKETS	   64
+
+typedef struct sample_stack
+{ struct sample_stack *next;		/* Next in hash bucket */
+  unsigned int	hash;			/* Hash of defs[] */
+  unsigned int	depth;			/* #predicates in defs[] */
+  int		truncated;		/* Stack was truncated */
+  uintptr_t	count;			/* #samples with this stack */
+  Definition	defs[1];		/* Predicates, leaf first */
+} sample_stack;
+
+typedef struct sample_table
+{ simpleMutex	mutex;			/* Guards thread tables */
+  sample_stack **buckets;		/* Hash table */
+  size_t	bucket_count;		/* #buckets (power of 2) */
+  size_t	stacks;			/* #distinct stacks */
+  uintptr_t	samples;		/* #samples collected */
+} sample_table;
+
+#define sizeofSampleStack(depth) \
+	(sizeof(sample_stack) + ((depth)-1)*sizeof(Definition))
+
+
+static int
+sample_frames(LocalFrame fr, Definition *defs, int *truncated)
+{ int depth = 0;
+  int frames = 0;
+
+  *truncated = FALSE;
+  while( fr )
+  { Definition def = fr->predicate;
+
+    if ( ++frames > SAMPLE_MAX_FRAMES )
+    { *truncated = TRUE;
+      break;
+    }
+    if ( false(def, P_NOPROFILE) && (depth == 0 || defs[depth-1] != def) )
+    { if ( depth == SAMPLE_MAX_DEPTH )
+      { *truncated = TRUE;
+	break;
+      }
+      defs[depth++] = def;
+    }
+
+    if ( fr->parent )
+    { fr = fr->parent;
+    } else				/* Prolog --> C --> Prolog calls */
+    { QueryFrame qf = queryOfFrame(fr);
+
+      fr = (qf->magic == QID_MAGIC ? qf->saved_environment : NULL);
+    }
+  }
+
+  return depth;
+}
+
+
+static sample_table *
+new_sample_table(void)
+{ sample_table *t = allocHeapOrHalt(sizeof(*t));
+
+  memset(t, 0, sizeof(*t));
+  simpleMutexInit(&t->mutex);
+
+  return t;
+}
+
+
+static void
+rehash_samples(sample_table *t, size_t new_count)
+{ sample_stack **buckets = allocHeapOrHalt(new_count*sizeof(*buckets));
+  size_t i;
+
+  memset(buckets, 0, new_count*sizeof(*buckets));
+  for(i=0; i<t->bucket_count; i++)
+  { sample_stack *s, *next;
+
+    for(s=t->buckets[i]; s; s=next)
+    { size_t k = s->hash & (new_count-1);
+
+      next = s->next;
+      s->next = buckets[k];
+      buckets[k] = s;
+    }
+  }
+
+  if ( t->buckets )
+    freeHeap(t->buckets, t->bucket_count*sizeof(*buckets));
+  t->buckets = buckets;
+  t->bucket_count = new_count;
+}
+
+
+static void
+add_sample(sample_table *t, Definition *defs, unsigned int depth,
+	   unsigned int hash, int truncated, uintptr_t count)
+{ sample_stack *s;
+  size_t k;
+
+  t->samples += count;
+  if ( !t->buckets )
+    rehash_samples(t, SAMPLE_INITIAL_BUCKETS);
+
+  k = hash & (t->bucket_count-1);
+  for(s=t->buckets[k]; s; s=s->next)
+  { if ( s->hash == hash && s->depth == depth &&
+	 s->truncated == truncated &&
+	 memcmp(s->defs, defs, depth*sizeof(*defs)) == 0 )
+    { s->count += count;
+      return;
+    }
+  }
+
+  s = allocHeapOrHalt(sizeofSampleStack(depth));
+  s->hash      = hash;
+  s->depth     = depth;
+  s->truncated = truncated;
+  s->count     = count;
+  memcpy(s->defs, defs, depth*sizeof(*defs));
+  s->next      = t->buckets[k];
+  t->buckets[k] = s;
+  if ( ++t->stacks > 2*t->bucket_count )
+    rehash_samples(t, t->bucket_count*2);
+}
+
+
+static void
+merge_samples(sample_table *into, sample_table *from)
+{ size_t i;
+
+  for(i=0; i<from->bucket_count; i++)
+  { sample_stack *s;
+
+    for(s=from->buckets[i]; s; s=s->next)
+      add_sample(into, s->defs, s->depth, s->hash, s->truncated, s->count);
+  }
+}
+
+
+static void
+clear_samples(sample_table *t)
+{ size_t i;
+
+  for(i=0; i<t->bucket_count; i++)
+  { sample_stack *s, *next;
+
+    for(s=t->buckets[i]; s; s=next)
+    { next = s->next;
+      freeHeap(s, sizeofSampleStack(s->depth));
+    }
+  }
+  if ( t->buckets )
+    freeHeap(t->buckets, t->bucket_count*sizeof(*t->buckets));
+  t->buckets      = NULL;
+  t->bucket_count = 0;
+  t->stacks       = 0;
+  t->samples      = 0;
+}
+
+
+static void
+free_sample_table(sample_table *t)
+{ clear_samples(t);
+  simpleMutexDelete(&t->mutex);
+  freeHeap(t, sizeof(*t));
+}
+
+
+static int
+unify_sample_stack(term_t t, sample_stack *s ARG_LD)
+{ term_t stack = PL_new_term_ref();
+  term_t tail  = PL_copy_term_ref(stack);
+  term_t pi    = PL_new_term_ref();
+  unsigned int d;
+
+  if ( s->truncated &&
+       !( PL_unify_list(tail, pi, tail) &&
+	  PL_unify_atom_chars(pi, "...") ) )
+    return FALSE;
+  for(d=s->depth; d-- > 0; )
+  { if ( !PL_unify_list(tail, pi, tail) ||
+	 !unify_definition(MODULE_user, pi, s->defs[d], 0,
+			   GP_QUALIFY|GP_NAMEARITY) )
+      return FALSE;
+  }
+
+  return ( PL_unify_nil(tail) &&
+	   PL_unify_term(t,
+			 PL_FUNCTOR, FUNCTOR_minus2,
+			   PL_INT64, (int64_t)s->count,
+			   PL_TERM, stack) );
+}
+
+
+#endif /*O_PROFILE*/
+
+#ifdef SIG_PROF_SAMPLE
+
+void
+sampleProfilerHandler(int sig)
+{ GET_LD
+  PL_thread_info_t *info = LD->thread.info;
+  sample_table *t;
+  Definition defs[SAMPLE_MAX_DEPTH];
+  int truncated;
+  int depth;
+  (void)sig;
+
+  if ( !info->prof_sample || !(t=info->prof_samples) )
+    return;				/* disabled after raising */
+
+  if ( (depth = sample_frames(environment_frame, defs, &truncated)) > 0 )
+  { unsigned int hash = MurmurHashAligned2(defs, depth*sizeof(*defs),
+					   MURMUR_SEED);
+
+    simpleMutexLock(&t->mutex);
+    add_sample(t, defs, depth, hash, truncated, 1);
+    simpleMutexUnlock(&t->mutex);
+  }
+}
+
+
+static void *
+sampler_thread(void *closure)
+{ (void)closure;
+
+  for(;;)
+  { int usec = GD->profile.sample.interval;
+    int i;
+#ifdef HAVE_NANOSLEEP
+    struct timespec req;
+
+    req.tv_sec  = usec/1000000;
+    req.tv_nsec = (usec%1000000)*1000;
+    nanosleep(&req, NULL);
+#else
+    usleep(usec);
+#endif
+
+    PL_LOCK(L_PROFILE);
+    if ( GD->profile.sample.threads == 0 )
+    { GD->profile.sample.running = FALSE;
+      PL_UNLOCK(L_PROFILE);
+      return NULL;
+    }
+    for(i=1; i<=GD->thread.highest_id; i++)
+    { PL_thread_info_t *info = GD->thread.threads[i];
+
+      if ( info && info->prof_sample && info->thread_data )
+	raiseSignal(info->thread_data, SIG_PROF_SAMPLE);
+    }
+    PL_UNLOCK(L_PROFILE);
+  }
+}
+
+
+static int
+can_sample(PL_thread_info_t *info)
+{ return ( info &&
+	   info->thread_data &&
+	   info->status == PL_THREAD_RUNNING );
+}
+
+
+/* enable_sampling() ignores threads that are not running.  As the status
+   of a terminating thread is changed before sampleProfilerExitThread()
+   is called, this guarantees we never enable sampling a thread after its
+   data was cleaned up.
+*/
+
+static int
+enable_sampling(PL_thread_info_t *info)
+{ if ( info->prof_sample || !can_sample(info) )
+    return TRUE;
+
+  if ( !GD->profile.sample.interval )
+    GD->profile.sample.interval = SAMPLE_INTERVAL;
+  if ( !GD->profile.sample.running )
+  { pthread_attr_t attr;
+    pthread_t tid;
+    int rc;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    rc = pthread_create(&tid, &attr, sampler_thread, NULL);
+    pthread_attr_destroy(&attr);
+    if ( rc != 0 )
+      return FALSE;
+    GD->profile.sample.running = TRUE;
+  }
+
+  if ( !info->prof_samples )
+    info->prof_samples = new_sample_table();
+  info->prof_sample = TRUE;
+  GD->profile.sample.threads++;
+
+  return TRUE;
+}
+
+
+static void
+disable_sampling(PL_thread_info_t *info)
+{ if ( info->prof_sample )
+  { info->prof_sample = FALSE;
+    GD->profile.sample.threads--;
+  }
+}
+
+
+/* sampleProfilerThread() enables or disables sampling `info`.
+*/
+
+int
+sampleProfilerThread(PL_thread_info_t *info, int on)
+{ int rc = TRUE;
+
+  PL_LOCK(L_PROFILE);
+  if ( on )
+    rc = enable_sampling(info);
+  else
+    disable_sampling(info);
+  PL_UNLOCK(L_PROFILE);
+
+  return rc;
+}
+
+
+/* sampleProfilerAllThreads() enables or disables sampling all threads.
+   If enabled, threads created later are sampled as well.
+*/
+
+static int
+sampleProfilerAllThreads(int on)
+{ int i, rc = TRUE;
+
+  PL_LOCK(L_PROFILE);
+  GD->profile.sample.all = on;
+  for(i=1; i<=GD->thread.highest_id; i++)
+  { PL_thread_info_t *info = GD->thread.threads[i];
+
+    if ( on )
+    { if ( info && !enable_sampling(info) )
+      { rc = FALSE;
+	break;
+      }
+    } else if ( info )
+    { disable_sampling(info);
+    }
+  }
+  PL_UNLOCK(L_PROFILE);
+
+  return rc;
+}
+
+
+/* sampleProfilerStartThread() is called when a new thread starts
+   running.  sampleProfilerExitThread() is called when it terminates
+   and merges its samples into the global table.
+*/
+
+void
+sampleProfilerStartThread(PL_thread_info_t *info)
+{ if ( GD->profile.sample.all )
+  { PL_LOCK(L_PROFILE);
+    if ( GD->profile.sample.all )
+      enable_sampling(info);
+    PL_UNLOCK(L_PROFILE);
+  }
+}
+
+
+void
+sampleProfilerExitThread(PL_thread_info_t *info)
+{ sample_table *t;
+
+  PL_LOCK(L_PROFILE);
+  disable_sampling(info);
+  if ( (t=info->prof_samples) )
+  { info->prof_samples = NULL;
+    if ( t->stacks )
+    { if ( !GD->profile.sample.table )
+	GD->profile.sample.table = new_sample_table();
+      merge_samples(GD->profile.sample.table, t);
+    }
+    free_sample_table(t);
+  }
+  PL_UNLOCK(L_PROFILE);
+}
+
+
+static int
+get_sample_thread(term_t t, PL_thread_info_t **infop)
+{ int tid;
+  PL_thread_info_t *info;
+
+  if ( !PL_get_integer_ex(t, &tid) )
+    return FALSE;
+  if ( tid < 1 || tid > GD->thread.highest_id ||
+       !(info=GD->thread.threads[tid]) ||
+       info->status == PL_THREAD_UNUSED ||
+       info->status == PL_THREAD_RESERVED )
+    return PL_existence_error("thread", t);
+
+  *infop = info;
+  return TRUE;
+}
+
+
+/** '$prof_sample'(+ThreadId, -Old, +New)
+ *
+ * Unify Old with the sampling status of the thread with the given
+ * numeric id and set it according to New (a Boolean).  If ThreadId
+ * is `all`, this applies to all existing and future threads.
+ */
+
+static
+PRED_IMPL("$prof_sample", 3, prof_sample, 0)
+{ PRED_LD
+  PL_thread_info_t *info = NULL;
+  atom_t a;
+  int val, rc;
+
+  if ( PL_get_atom(A1, &a) && a == ATOM_all )
+  { if ( !PL_unify_bool(A2, GD->profile.sample.all) ||
+	 !PL_get_bool_ex(A3, &val) )
+      return FALSE;
+    rc = sampleProfilerAllThreads(val);
+  } else
+  { if ( !get_sample_thread(A1, &info) )
+      return FALSE;
+    if ( !PL_unify_bool(A2, info->prof_sample) ||
+	 !PL_get_bool_ex(A3, &val) )
+      return FALSE;
+    rc = sampleProfilerThread(info, val);
+  }
+
+  if ( !rc )
+    return PL_error(NULL, 0, MSG_ERRNO, ERR_SYSCALL, "pthread_create");
+
+  return TRUE;
+}
+
+
+/** '$prof_sample_interval'(-Old, +New)
+ *
+ * Get and set the sample interval in seconds.
+ */
+
+static
+PRED_IMPL("$prof_sample_interval", 2, prof_sample_interval, 0)
+{ int usec = GD->profile.sample.interval;
+  double f;
+
+  if ( !usec )
+    usec = SAMPLE_INTERVAL;
+  if ( !PL_unify_float(A1, (double)usec/1000000.0) )
+    return FALSE;
+  if ( PL_compare(A1, A2) == 0 )
+    return TRUE;
+  if ( !PL_get_float_ex(A2, &f) )
+    return FALSE;
+  if ( f < 0.0001 || f > 1.0 )
+    return PL_domain_error("sample_interval", A2);
+
+  GD->profile.sample.interval = (int)(f*1000000.0);
+  return TRUE;
+}
+
+
+/* collect_samples() merges the samples of terminated threads and the
+   tables of all running threads into `into`.  If tid > 0, only the
+   samples of this thread are collected.
+*/
+
+static void
+collect_samples(sample_table *into, int tid)
+{ int i;
+
+  PL_LOCK(L_PROFILE);
+  if ( GD->profile.sample.table && tid == 0 )
+    merge_samples(into, GD->profile.sample.table);
+  for(i=1; i<=GD->thread.highest_id; i++)
+  { PL_thread_info_t *info = GD->thread.threads[i];
+    sample_table *t;
+
+    if ( info && (tid == 0 || tid == i) && (t=info->prof_samples) )
+    { simpleMutexLock(&t->mutex);
+      merge_samples(into, t);
+      simpleMutexUnlock(&t->mutex);
+    }
+  }
+  PL_UNLOCK(L_PROFILE);
+}
+
+
+/** '$prof_sample_stacks'(+Thread, -Stacks, -Samples)
+ *
+ * Stacks is a list Count-Stack, where Stack is a list of qualified
+ * predicate indicators, root first.  Truncated stacks start with '...'.
+ * Samples is the total number of samples taken.  Thread is either a
+ * numeric thread id or `all`, which includes terminated threads.  The
+ * tables are merged into a private table, such that sampling can go on
+ * while we build the result.
+ */
+
+static
+PRED_IMPL("$prof_sample_stacks", 3, prof_sample_stacks, 0)
+{ PRED_LD
+  term_t tail = PL_copy_term_ref(A2);
+  term_t head = PL_new_term_ref();
+  sample_table *t;
+  atom_t a;
+  int tid = 0;
+  size_t i;
+  int rc = TRUE;
+
+  if ( !(PL_get_atom(A1, &a) && a == ATOM_all) )
+  { PL_thread_info_t *info = NULL;
+
+    if ( !get_sample_thread(A1, &info) )
+      return FALSE;
+    tid = info->pl_tid;
+  }
+
+  t = new_sample_table();
+  collect_samples(t, tid);
+  for(i=0; i<t->bucket_count && rc; i++)
+  { sample_stack *s;
+
+    for(s=t->buckets[i]; s && rc; s=s->next)
+    { rc = ( PL_unify_list(tail, head, tail) &&
+	     unify_sample_stack(head, s PASS_LD) );
+    }
+  }
+  rc = ( rc &&
+	 PL_unify_nil(tail) &&
+	 PL_unify_int64(A3, (int64_t)t->samples) );
+  free_sample_table(t);
+
+  return rc;
+}
+
+
+static
+PRED_IMPL("$prof_sample_reset", 0, prof_sample_reset, 0)
+{ int i;
+
+  PL_LOCK(L_PROFILE);
+  if ( GD->profile.sample.table )
+    clear_samples(GD->profile.sample.table);
+  for(i=1; i<=GD->thread.highest_id; i++)
+  { PL_thread_info_t *info = GD->thread.threads[i];
+    sample_table *t;
+
+    if ( info && (t=info->prof_samples) )
+    { simpleMutexLock(&t->mutex);
+      clear_samples(t);
+      simpleMutexUnlock(&t->mutex);
+    }
+  }
+  PL_UNLOCK(L_PROFILE);
+
+  return TRUE;
+}
+
+#else /*SIG_PROF_SAMPLE*/
+
+static
+PRED_IMPL("$prof_sample", 3, prof_sample, 0)
+{ return notImplemented("$prof_sample", 3);
+}
+
+static
+PRED_IMPL("$prof_sample_interval", 2, prof_sample_interval, 0)
+{ return notImplemented("$prof_sample_interval", 2);
+}
+
+static
+PRED_IMPL("$prof_sample_stacks", 3, prof_sample_stacks, 0)
+{ return notImplemented("$prof_sample_stacks", 3);
+}
+
+static
+PRED_IMPL("$prof_sample_reset", 0, prof_sample_reset, 0)
+{ return notImplemented("$prof_sample_reset", 0);
+}
+
+#endif /*SIG_PROF_SAMPLE*/
+
+		 /*******************************
+		 *     ALLOCATION PROFILER	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The allocation profiler  attributes  global   stack  and  heap  usage to
+call paths.  Most global stack  allocation  is   done  inline  by the VM
+instructions, so rather than hooking  every   allocation  we  measure at
+the call port.  If LD->profile.alloc.active is set, updateAlerted() sets
+ALERT_PROFILE, such that  the  call  port   calls  profAllocCheck().  This
+computes the growth of the global stack   since  the previous call port
+and the growth of LD->statistics.heap_allocated, which is maintained by
+allocHeap() and PL_malloc().  If  the  accumulated   amount  exceeds
+GD->profile.alloc.interval bytes, the stack   starting at the new frame is
+recorded, weighted by the accumulated number of bytes.  The memory was
+allocated by the caller or by the  head   of  the  new frame, so the new
+frame may be blamed for the arguments its caller built.  Including it is
+needed to attribute allocation of last   calls,  whose caller frame has
+already been discarded.
+
+The global stack is tracked as an  offset   from  its base,  so stack
+shifts do not matter.  If it shrank,   due  to backtracking or GC, we
+only reset the mark.  The  result  counts   allocated  bytes,  not
+retained bytes.  Samples of all threads  are   kept  in  two tables,
+guarded by L_PROFILE.  As a sample is   only  taken every `interval'
+bytes, this lock is rarely used.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef O_PROFILE
+
+#define ALLOC_INTERVAL	(512*1024)	/* Default sample interval (bytes) */
+
+static size_t
+alloc_interval(void)
+{ return GD->profile.alloc.interval ? GD->profile.alloc.interval
+				     : ALLOC_INTERVAL;
+}
+
+
+static void
+alloc_sample(sample_table **tp, LocalFrame fr, uintptr_t bytes)
+{ Definition defs[SAMPLE_MAX_DEPTH];
+  int truncated;
+  int depth;
+
+  if ( (depth = sample_frames(fr, defs, &truncated)) > 0 )
+  { unsigned int hash = MurmurHashAligned2(defs, depth*sizeof(*defs),
+					   MURMUR_SEED);
+
+    PL_LOCK(L_PROFILE);
+    if ( !*tp )
+      *tp = new_sample_table();
+    add_sample(*tp, defs, depth, hash, truncated, bytes);
+    PL_UNLOCK(L_PROFILE);
+  }
+}
+
+
+static void
+alloc_mark(ARG1_LD)
+{ LD->profile.alloc.global_mark = usedStack(global);
+  LD->profile.alloc.heap_mark   = LD->statistics.heap_allocated;
+}
+
+
+void
+profAllocCheck(LocalFrame fr ARG_LD)
+{ size_t gused = usedStack(global);
+  int64_t hused = LD->statistics.heap_allocated;
+  size_t interval = alloc_interval();
+
+  if ( gused > LD->profile.alloc.global_mark )
+  { LD->profile.alloc.global += gused - LD->profile.alloc.global_mark;
+    if ( LD->profile.alloc.global >= interval )
+    { alloc_sample(&GD->profile.alloc.global, fr, LD->profile.alloc.global);
+      LD->profile.alloc.global = 0;
+    }
+  }
+  LD->profile.alloc.global_mark = gused;
+
+  if ( hused > LD->profile.alloc.heap_mark )
+  { LD->profile.alloc.heap += hused - LD->profile.alloc.heap_mark;
+    if ( LD->profile.alloc.heap >= interval )
+    { alloc_sample(&GD->profile.alloc.heap, fr, LD->profile.alloc.heap);
+      LD->profile.alloc.heap = 0;
+    }
+  }
+  LD->profile.alloc.heap_mark = hused;
+}
+
+
+/** '$prof_alloc'(-Old, +New)
+ *
+ * Query and set allocation profiling for the calling thread.
+ */
+
+static
+PRED_IMPL("$prof_alloc", 2, prof_alloc, 0)
+{ PRED_LD
+  int val;
+
+  if ( !PL_unify_bool(A1, LD->profile.alloc.active) ||
+       !PL_get_bool_ex(A2, &val) )
+    return FALSE;
+
+  if ( val && !LD->profile.alloc.active )
+  { alloc_mark(PASS_LD1);
+    LD->profile.alloc.global = 0;
+    LD->profile.alloc.heap   = 0;
+  }
+  LD->profile.alloc.active = val;
+  updateAlerted(LD);
+
+  return TRUE;
+}
+
+
+/** '$prof_alloc_interval'(-Old, +New)
+ *
+ * Get and set the number of bytes between two allocation samples.
+ */
+
+static
+PRED_IMPL("$prof_alloc_interval", 2, prof_alloc_interval, 0)
+{ PRED_LD
+  int64_t n;
+
+  if ( !PL_unify_int64(A1, alloc_interval()) )
+    return FALSE;
+  if ( PL_compare(A1, A2) == 0 )
+    return TRUE;
+  if ( !PL_get_int64_ex(A2, &n) )
+    return FALSE;
+  if ( n < 1024 )
+    return PL_domain_error("alloc_interval", A2);
+
+  GD->profile.alloc.interval = (size_t)n;
+  return TRUE;
+}
+
+
+/** '$prof_alloc_stacks'(+Area, -Stacks, -Bytes)
+ *
+ * Stacks is a list Bytes-Stack for the allocations in Area, which is
+ * one of `global` or `heap`.  See '$prof_sample_stacks'/3 for Stack.
+ * Bytes is the total number of bytes attributed.
+ */
+
+static
+PRED_IMPL("$prof_alloc_stacks", 3, prof_alloc_stacks, 0)
+{ PRED_LD
+  term_t tail = PL_copy_term_ref(A2);
+  term_t head = PL_new_term_ref();
+  sample_table *t, **tp;
+  atom_t a;
+  size_t i;
+  int rc = TRUE;
+
+  if ( !PL_get_atom_ex(A1, &a) )
+    return FALSE;
+  if ( a == ATOM_global )
+    tp = &GD->profile.alloc.global;
+  else if ( a == ATOM_heap )
+    tp = &GD->profile.alloc.heap;
+  else
+    return PL_domain_error("alloc_area", A1);
+
+  t = new_sample_table();
+  PL_LOCK(L_PROFILE);
+  if ( *tp )
+    merge_samples(t, *tp);
+  PL_UNLOCK(L_PROFILE);
+
+  for(i=0; i<t->bucket_count && rc; i++)
+  { sample_stack *s;
+
+    for(s=t->buckets[i]; s && rc; s=s->next)
+    { rc = ( PL_unify_list(tail, head, tail) &&
+	     unify_sample_stack(head, s PASS_LD) );
+    }
+  }
+  rc = ( rc &&
+	 PL_unify_nil(tail) &&
+	 PL_unify_int64(A3, (int64_t)t->samples) );
+  free_sample_table(t);
+
+  return rc;
+}
+
+
+static
+PRED_IMPL("$prof_alloc_reset", 0, prof_alloc_reset, 0)
+{ PL_LOCK(L_PROFILE);
+  if ( GD->profile.alloc.global )
+    clear_samples(GD->profile.alloc.global);
+  if ( GD->profile.alloc.heap )
+    clear_samples(GD->profile.alloc.heap);
+  PL_UNLOCK(L_PROFILE);
+
+  return TRUE;
+}
+
+#else /*O_PROFILE*/
+
+static
+PRED_IMPL("$prof_alloc", 2, prof_alloc, 0)
+{ return notImplemented("$prof_alloc", 2);
+}
+
+static
+PRED_IMPL("$prof_alloc_interval", 2, prof_alloc_interval, 0)
+{ return notImplemented("$prof_alloc_interval", 2);
+}
+
+static
+PRED_IMPL("$prof_alloc_stacks", 3, prof_alloc_stacks, 0)
+{ return notImplemented("$prof_alloc_stacks", 3);
+}
+
+static
+PRED_IMPL("$prof_alloc_reset", 0, prof_alloc_reset, 0)
+{ return notImplemented("$prof_alloc_reset", 0);
+}
+
+#endif /*O_PROFILE*/
+
+
+		 /*******************************
+		 *	   CALL COUNTING	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Call counting maintains  the  ports   of  individual  predicates  without
+running the profiler or wrapping the   predicate.  It is enabled using
+'$set_predicate_attribute'(Pred, call_counting,  true),  which allocates
+def->call_counts.  The call port  (retry_continue   in  pl-vmi.c)  only
+tests this pointer.  If  counting  is  active,   the  call  is counted and
+the frame is marked FR_COUNTED. As  FR_COUNTED   is  part of FR_WATCHED,
+the VM calls frameFinished() when the   frame exits, fails or is left by
+an exception, which calls countFinished().   A nondeterministic exit does
+not finish the frame and is counted by I_EXIT. Redo is counted when
+backtracking into a counted frame.  I_DEPART does not apply last call
+optimization to counted frames, so the last call  is included and the
+final port is that of the frame itself.
+
+Time is sampled: every CALL_TIMER_SAMPLE-th call  pushes the frame onto
+LD->call_timer.stack, and  the  wall  time  upto  its  first  exit,
+failure or exception is  added  to   the  counts.  The reported time is
+time*calls/timed and thus an estimate  of   the  total inclusive time.
+Recursive calls are included in the   time  of their caller. Frames are
+identified by their offset from  lBase,  such   that  stack  shifts do not
+matter.  Entries of frames that  have  disappeared   are  removed  when  a
+frame at the same or a lower address is timed or finished.
+
+The counts are updated atomically. Counting  is   disabled  by clearing
+cc->active; the structure itself is only   freed with the definition, so
+a running frame can always access it.   Thread-local predicates run a
+local copy of the definition and are not counted.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define CALL_TIMER_SAMPLE 16		/* Time one out of this many calls */
+
+void
+countCall(LocalFrame fr ARG_LD)
+{ call_counts *cc = fr->predicate->call_counts;
+
+  if ( cc->active )
+  { uint64_t n = ATOMIC_INC(&cc->calls);
+
+    set(fr, FR_COUNTED);
+    TRACEPOINT_PRED(pred__call, fr->predicate);
+    if ( n % CALL_TIMER_SAMPLE == 1 )
+    { size_t offset = (char*)fr - (char*)lBase;
+      int top = LD->call_timer.top;
+
+      while ( top > 0 && LD->call_timer.stack[top-1].frame > offset )
+	top--;
+      if ( top < CALL_TIMER_DEPTH )
+      { call_timer *t = &LD->call_timer.stack[top++];
+
+	t->frame     = offset;
+	t->predicate = fr->predicate;
+	t->start     = WallTime();
+      }
+      LD->call_timer.top = top;
+    }
+  }
+}
+
+
+void
+countRedo(LocalFrame fr)
+{ call_counts *cc = fr->predicate->call_counts;
+
+  if ( cc && cc->active )
+  { ATOMIC_INC(&cc->redos);
+    TRACEPOINT_PRED(pred__redo, fr->predicate);
+  }
+}
+
+
+void
+countFinished(LocalFrame fr, count_port port ARG_LD)
+{ call_counts *cc = fr->predicate->call_counts;
+  int top = LD->call_timer.top;
+
+  if ( cc && cc->active )
+  { switch(port)
+    { case COUNT_EXIT:
+	ATOMIC_INC(&cc->exits);
+	TRACEPOINT_PRED(pred__exit, fr->predicate);
+	break;
+      case COUNT_FAIL:
+	ATOMIC_INC(&cc->fails);
+	TRACEPOINT_PRED(pred__fail, fr->predicate);
+	break;
+      case COUNT_EXCEPTION:
+	ATOMIC_INC(&cc->exceptions);
+	TRACEPOINT_PRED(pred__exception, fr->predicate);
+	break;
+      case COUNT_DISCARD:
+	break;
+    }
+  }
+
+  if ( top > 0 )
+  { size_t offset = (char*)fr - (char*)lBase;
+    call_timer *t;
+
+    while ( top > 0 && LD->call_timer.stack[top-1].frame > offset )
+      top--;
+    if ( top > 0 && LD->call_timer.stack[top-1].frame == offset )
+    { double now = WallTime();
+
+      for( ; top > 0 && (t=&LD->call_timer.stack[top-1])->frame == offset;
+	   top-- )
+      { call_counts *tc = t->predicate->call_counts;
+
+	if ( tc )
+	{ ATOMIC_INC(&tc->timed);
+	  ATOMIC_ADD(&tc->time, (uint64_t)((now-t->start)*1000000000.0));
+	}
+      }
+    }
+    LD->call_timer.top = top;
+  }
+}
+
+
+int
+setCallCounting(Definition def, int val)
+{ call_counts *cc;
+
+  if ( val )
+  { if ( !(cc=def->call_counts) )
+    { call_counts *new = allocHeapOrHalt(sizeof(*new));
+
+      memset(new, 0, sizeof(*new));
+      new->active = TRUE;
+      if ( !COMPARE_AND_SWAP_PTR(&def->call_counts, NULL, new) )
+      { freeHeap(new, sizeof(*new));
+	cc = def->call_counts;
+      }
+    }
+    if ( cc )				/* (re-)enable: reset the counts */
+    { cc->active     = FALSE;
+      cc->calls      = 0;
+      cc->exits      = 0;
+      cc->redos      = 0;
+      cc->fails      = 0;
+      cc->exceptions = 0;
+      cc->timed      = 0;
+      cc->time       = 0;
+      cc->active     = TRUE;
+    }
+  } else if ( (cc=def->call_counts) )
+  { cc->active = FALSE;
+  }
+
+  return TRUE;
+}
+
+
+int
+unify_call_counts(Definition def, term_t value)
+{ GET_LD
+  call_counts *cc;
+
+  if ( (cc=def->call_counts) )
+  { const struct
+    { const char *name;
+      uint64_t	  value;
+    } *c, counters[] =
+    { { "calls",      cc->calls },
+      { "exits",      cc->exits },
+      { "redos",      cc->redos },
+      { "fails",      cc->fails },
+      { "exceptions", cc->exceptions },
+      { "timed",      cc->timed },
+      { NULL,	      0 }
+    };
+    uint64_t calls = counters[0].value;
+    uint64_t timed = counters[5].value;
+    double time = ( timed ? ((double)cc->time/1000000000.0) *
+			    ((double)calls/(double)timed)
+			  : 0.0 );
+    term_t tail = PL_copy_term_ref(value);
+    term_t head = PL_new_term_ref();
+
+    for(c=counters; c->name; c++)
+    { if ( !PL_unify_list(tail, head, tail) ||
+	   !PL_unify_term(head,
+			  PL_FUNCTOR_CHARS, c->name, 1,
+			    PL_INT64, (int64_t)c->value) )
+	return FALSE;
+    }
+
+    return ( PL_unify_list(tail, head, tail) &&
+	     PL_unify_term(head,
+			   PL_FUNCTOR_CHARS, "time", 1,
+			     PL_FLOAT, time) &&
+	     PL_unify_nil(tail) );
+  }
+
+  return FALSE;
+}
+
+
+void
+freeCallCounts(Definition def)
+{ call_counts *cc;
+
+  if ( (cc=def->call_counts) )
+  { def->call_counts = NULL;
+    freeHeap(cc, sizeof(*cc));
+  }
+}
+
+
 #ifdef O_PROF_PENTIUM
 #include "pentium.c"
 
@@ -1349,6 +2421,41 @@ PRED_IMPL("reset_pentium_profile", 0, reset_pentium_profile, 0)
 
   succeed;
 }
+
+/** '$vmi_profile'(-Records) is det.
+ *
+ * Records is a list vmi(Name, Calls, Ticks, Fastest) for each virtual
+ * machine instruction and other profiling point (see pentium.h) that
+ * was executed since the last reset_pentium_profile/0.  Ticks is the
+ * total and Fastest is the fastest execution in CPU clock ticks.
+ */
+
+PRED_IMPL("$vmi_profile", 1, vmi_profile, 0)
+{ PRED_LD
+  term_t tail = PL_copy_term_ref(A1);
+  term_t head = PL_new_term_ref();
+  int i;
+
+  END_PROF();
+  for(i=0; i<MAXPROF; i++)
+  { const prof_record *pr = &prof_data[i];
+
+    if ( pr->name && pr->calls > 0 )
+    { const char *name = (i < I_HIGHEST ? codeTable[i].name : pr->name);
+
+      if ( !PL_unify_list(tail, head, tail) ||
+	   !PL_unify_term(head,
+			  PL_FUNCTOR_CHARS, "vmi", 4,
+			    PL_CHARS, name,
+			    PL_INT64, pr->calls,
+			    PL_INT64, pr->ticks,
+			    PL_INT64, pr->fastest) )
+	return FALSE;
+    }
+  }
+
+  return PL_unify_nil(tail);
+}
 #endif
 
 		 /*******************************
@@ -1363,8 +2470,17 @@ BeginPredDefs(profile)
   PRED_DEF("$prof_sibling_of", 2, prof_sibling_of, PL_FA_NONDETERMINISTIC)
   PRED_DEF("$prof_procedure_data", 8, prof_procedure_data, PL_FA_TRANSPARENT)
   PRED_DEF("$prof_statistics", 5, prof_statistics, 0)
+  PRED_DEF("$prof_sample", 3, prof_sample, 0)
+  PRED_DEF("$prof_sample_interval", 2, prof_sample_interval, 0)
+  PRED_DEF("$prof_sample_stacks", 3, prof_sample_stacks, 0)
+  PRED_DEF("$prof_sample_reset", 0, prof_sample_reset, 0)
+  PRED_DEF("$prof_alloc", 2, prof_alloc, 0)
+  PRED_DEF("$prof_alloc_interval", 2, prof_alloc_interval, 0)
+  PRED_DEF("$prof_alloc_stacks", 3, prof_alloc_stacks, 0)
+  PRED_DEF("$prof_alloc_reset", 0, prof_alloc_reset, 0)
 #ifdef O_PROF_PENTIUM
   PRED_DEF("show_pentium_profile", 0, show_pentium_profile, 0)
   PRED_DEF("reset_pentium_profile", 0, reset_pentium_profile, 0)
+  PRED_DEF("$vmi_profile", 1, vmi_profile, 0)
 #endif
 EndPredDefs
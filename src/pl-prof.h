@@ -49,5 +49,26 @@ COMMON(void)		profResumeParent(struct call_node *node ARG_LD);
 COMMON(void)		profExit(struct call_node *node ARG_LD);
 COMMON(void)		profRedo(struct call_node *node ARG_LD);
 COMMON(void)		profSetHandle(struct call_node *node, void *handle);
+COMMON(void)		profAllocCheck(LocalFrame fr ARG_LD);
+
+typedef enum
+{ COUNT_EXIT = 0,		/* Frame exits */
+  COUNT_FAIL,			/* Frame fails */
+  COUNT_EXCEPTION,		/* Frame is left by an exception */
+  COUNT_DISCARD			/* Frame is discarded after an exit */
+} count_port;
+
+COMMON(void)		countCall(LocalFrame fr ARG_LD);
+COMMON(void)		countRedo(LocalFrame fr);
+COMMON(void)		countFinished(LocalFrame fr, count_port port ARG_LD);
+COMMON(int)		setCallCounting(Definition def, int val);
+COMMON(int)		unify_call_counts(Definition def, term_t value);
+COMMON(void)		freeCallCounts(Definition def);
+#ifdef SIG_PROF_SAMPLE
+COMMON(void)		sampleProfilerHandler(int sig);
+COMMON(int)		sampleProfilerThread(PL_thread_info_t *info, int on);
+COMMON(void)		sampleProfilerStartThread(PL_thread_info_t *info);
+COMMON(void)		sampleProfilerExitThread(PL_thread_info_t *info);
+#endif
 
 #endif /*PL_PROF_H_INCLUDED*/
@@ -309,6 +309,8 @@ struct var_table
 { tmp_buffer _var_name_buffer;	/* stores the names */
   tmp_buffer _var_buffer;	/* array of struct variables */
   unsigned int _var_hash_size;	/* #buckets */
+  unsigned int _var_buckets_allocated; /* #allocated buckets */
+  unsigned int _var_count;	/* #variable tokens seen by raw_read() */
   unsigned int *_var_buckets;	/* hash table */
 };
 
@@ -410,6 +412,7 @@ typedef struct
 #endif
   bool		cycles;			/* Re-establish cycles */
   bool		dotlists;		/* read .(a,b) as a list */
+  bool		canonical;		/* only canonical syntax */
   int		strictness;		/* Strictness level */
 
   atom_t	locked;			/* atom that must be unlocked */
@@ -432,6 +435,10 @@ typedef struct
 #define var_buffer	  (_PL_rd->vt._var_buffer)
 #define var_hash_size	  (_PL_rd->vt._var_hash_size)
 #define var_buckets	  (_PL_rd->vt._var_buckets)
+#define var_buckets_allocated (_PL_rd->vt._var_buckets_allocated)
+#define var_count	  (_PL_rd->vt._var_count)
+
+#define MAX_CACHED_VAR_BUCKETS 65536	/* max buckets kept by the thread */
 
 #ifndef offsetof
 #define offsetof(structure, field) ((int) &(((structure *)NULL)->field))
@@ -450,6 +457,11 @@ init_read_data(ReadData _PL_rd, IOSTREAM *in ARG_LD)
   initBuffer(&_PL_rd->op.out_queue);
   initBuffer(&_PL_rd->op.side_queue);
   var_hash_size = 0;
+  var_count = 0;
+  var_buckets = LD->read_vars.buckets;	/* reuse table of previous read */
+  var_buckets_allocated = LD->read_vars.allocated;
+  LD->read_vars.buckets = NULL;
+  LD->read_vars.allocated = 0;
   init_term_stack(_PL_rd);
   _PL_rd->exception = PL_new_term_ref();
   rb.stream = in;
@@ -467,7 +479,9 @@ init_read_data(ReadData _PL_rd, IOSTREAM *in ARG_LD)
 
 static void
 free_read_data(ReadData _PL_rd)
-{ if ( rdbase && rdbase != rb.fast )
+{ GET_LD
+
+  if ( rdbase && rdbase != rb.fast )
     PL_free(rdbase);
 
   if ( _PL_rd->locked )
@@ -477,8 +491,15 @@ free_read_data(ReadData _PL_rd)
   discardBuffer(&var_buffer);
   discardBuffer(&_PL_rd->op.out_queue);
   discardBuffer(&_PL_rd->op.side_queue);
-  if ( var_hash_size )
-    PL_free(var_buckets);
+  if ( var_buckets )
+  { if ( !LD->read_vars.buckets &&
+	 var_buckets_allocated <= MAX_CACHED_VAR_BUCKETS )
+    { LD->read_vars.buckets = var_buckets;
+      LD->read_vars.allocated = var_buckets_allocated;
+    } else
+    { PL_free(var_buckets);
+    }
+  }
   clear_term_stack(_PL_rd);
 }
 
@@ -1411,8 +1432,10 @@ raw_read2(ReadData _PL_rd ARG_LD)
 		      } while( c != EOF && (unsigned)c <= 0xff && isSymbol(c) );
 					/* TBD: wide symbols? */
 		      goto handle_c;
-		    case LC:
 		    case UC:
+		      var_count++;
+		      /*FALLTHROUGH*/
+		    case LC:
 		      set_start_line;
 		      c = raw_read_identifier(c, _PL_rd);
 		      goto handle_c;
@@ -1492,9 +1515,9 @@ together to avoid memory fragmentation. This   buffer too is reallocated
 if necessary. In this  case,  the   pointers  of  the  existing variable
 structures are relocated.
 
-Note that the variables are kept  in   a  simple  array. This means that
-reading terms with many named variables   result in quadratic behaviour.
-Not sure whether it is worth the trouble to use a hash-table here.
+The variables are kept in a simple  array.  If  a term has more than 16
+variables, lookup uses a hash table  on  top  of  this  array  that  is
+indexed by the variable number (see rehashVariables()).
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 #define MAX_SINGLETONS 256		/* max singletons _reported_ */
@@ -1540,23 +1563,37 @@ linkVariable(Variable var, ReadData _PL_rd)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+rehashVariables() resizes the hash table such that it can hold at least
+var_count  variables,  the  number  of   variable  tokens  found  by
+raw_read().  This is  an  upper  bound  for  the number of variables and
+thus we only rehash once per term.  The bucket array is not freed at the
+end of the read, but kept in LD->read_vars to be reused by the next read.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 static int
 rehashVariables(ReadData _PL_rd)
-{ if ( !var_hash_size )
-  { var_hash_size = 32;
-    var_buckets = PL_malloc(var_hash_size*sizeof(*var_buckets));
-  } else
-  { var_hash_size *= 2;
-    var_buckets = PL_realloc(var_buckets, var_hash_size*sizeof(*var_buckets));
+{ unsigned int size = var_hash_size ? var_hash_size*2 : 32;
+
+  while ( size < var_count )
+    size *= 2;
+
+  if ( size > var_buckets_allocated )
+  { if ( var_buckets )
+      PL_free(var_buckets);
+    var_buckets_allocated = size;
+    if ( !(var_buckets = PL_malloc(size*sizeof(*var_buckets))) )
+    { var_buckets_allocated = 0;
+      var_hash_size = 0;
+      return MEMORY_OVERFLOW;
+    }
   }
 
-  if ( var_buckets )
-  { memset(var_buckets, 0, var_hash_size*sizeof(*var_buckets));
+  var_hash_size = size;
+  memset(var_buckets, 0, var_hash_size*sizeof(*var_buckets));
+  for_vars(v, linkVariable(v, _PL_rd));
 
-    for_vars(v, linkVariable(v, _PL_rd));
-    return 0;
-  } else
-    return MEMORY_OVERFLOW;
+  return 0;
 }
 
 static int
@@ -1623,7 +1660,7 @@ lookupVariable(const char *name, size_t len, ReadData _PL_rd)
   next.signature = (nv<<LMASK_BITS)|TAG_VAR|STG_RESERVED;
   addBuffer(&var_buffer, next, struct variable);
   var = topBuffer(&var_buffer, struct variable) - 1;
-  if ( nv >= 16 )
+  if ( var_hash_size || nv >= 16 )
     hashVariable(var, _PL_rd);
 
   return var;
@@ -2696,6 +2733,11 @@ str_number(cucharp in, ucharp *end, Number value, int flags)
   if ( value->type == V_FLOAT )
   { char *e;
 
+    if ( strtod_fast((char*)start, &e, &value->value.f) && e == (char*)in )
+    { *end = (ucharp)in;
+      return NUM_OK;
+    }
+
     errno = 0;
     value->value.f = strtod((char*)start, &e);
     if ( e != (char*)in && !(*in == '.' && (char*)in+1 == e) )
@@ -3733,6 +3775,53 @@ unify_string_position(term_t positions, Token token ARG_LD)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+canonical_term() is the  complex_term()  replacement  if  the  read  option
+canonical(true) is given.  The term must be a simple term that is followed
+by the stop token.  This avoids the operator queues and the operator lookup
+for every name, which makes a notable difference when reading large files
+of machine generated facts.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+canonical_term(const char *stop, term_t positions, ReadData _PL_rd ARG_LD)
+{ Token token;
+  int rc;
+
+  if ( !(token = get_token(FALSE, _PL_rd)) )
+    return FALSE;
+  if ( token->type == T_PUNCTUATION &&
+       !strchr("([{", token->value.character) )
+    syntaxError("cannot_start_term", _PL_rd);
+  if ( (rc=simple_term(token, positions, _PL_rd PASS_LD)) != TRUE )
+    return rc;
+
+  if ( !(token = get_token(FALSE, _PL_rd)) )
+    return FALSE;
+  switch(token->type)
+  { case T_FULLSTOP:
+      if ( stop == NULL )
+	goto out;
+      break;
+    case T_PUNCTUATION:
+      if ( stop != NULL && strchr(stop, token->value.character) )
+	goto out;
+      break;
+#ifdef O_QUASIQUOTATIONS
+    case T_QQ_BAR:
+      if ( stop != NULL && stop[0] == '|' )
+	goto out;
+      break;
+#endif
+  }
+  syntaxError("canonical_syntax", _PL_rd);
+
+out:
+  unget_token();
+  return TRUE;
+}
+
+
 static int
 complex_term(const char *stop, short maxpri, term_t positions,
 	     ReadData _PL_rd ARG_LD)
@@ -3743,6 +3832,8 @@ complex_term(const char *stop, short maxpri, term_t positions,
   term_t pin;
   Token token;
 
+  if ( _PL_rd->canonical )
+    return canonical_term(stop, positions, _PL_rd PASS_LD);
   if ( _PL_rd->strictness == 0 )
     maxpri = OP_MAXPRIORITY+1;
 
@@ -4546,6 +4637,11 @@ read_term(term_t term, ReadData rd ARG_LD)
 
   if ( !raw_read(rd, &rd->end PASS_LD) )
     fail;
+  if ( rd->vt._var_count > 16 )		/* pre-size the variable table */
+  { growBuffer((Buffer)&rd->vt._var_buffer,
+	       rd->vt._var_count*sizeof(struct variable));
+    rehashVariables(rd);
+  }
 
   if ( !(fid=PL_open_foreign_frame()) )
     return FALSE;
@@ -4751,6 +4847,7 @@ static const opt_spec read_clause_options[] =
   { ATOM_process_comment,   OPT_BOOL },
   { ATOM_comments,	    OPT_TERM },
   { ATOM_syntax_errors,     OPT_ATOM },
+  { ATOM_canonical,	    OPT_BOOL },
   { NULL_ATOM,		    0 }
 };
 
@@ -4799,6 +4896,7 @@ read_clause(IOSTREAM *s, term_t term, term_t options ARG_LD)
   term_t opt_comments = 0;
   int process_comment;
   atom_t syntax_errors = ATOM_dec10;
+  int canonical = FALSE;
   predicate_t comment_hook;
 
   comment_hook = _PL_predicate("comment_hook", 3, "prolog",
@@ -4818,7 +4916,8 @@ retry:
 		     &rd.subtpos,
 		     &process_comment,
 		     &opt_comments,
-		     &syntax_errors) )
+		     &syntax_errors,
+		     &canonical) )
   { PL_close_foreign_frame(fid);
     return FALSE;
   }
@@ -4835,7 +4934,8 @@ retry:
   if ( comments )
     rd.comments = PL_copy_term_ref(comments);
   rd.on_error = syntax_errors;
-  rd.singles = rd.styleCheck & SINGLETON_CHECK ? TRUE : FALSE;
+  rd.canonical = canonical;
+  rd.singles = (!canonical && (rd.styleCheck & SINGLETON_CHECK)) ? TRUE : FALSE;
   if ( (rval=read_term(term, &rd PASS_LD)) &&
        (!tpos || (rval=unify_read_term_position(tpos PASS_LD))) )
   { if ( rd.comments &&
@@ -4895,6 +4995,7 @@ static const opt_spec read_term_options[] =
 #endif
   { ATOM_cycles,	    OPT_BOOL },
   { ATOM_dotlists,	    OPT_BOOL },
+  { ATOM_canonical,	    OPT_BOOL },
   { NULL_ATOM,		    0 }
 };
 
@@ -4933,7 +5034,8 @@ retry:
 		     &rd.quasi_quotations,
 #endif
 		     &rd.cycles,
-		     &rd.dotlists) )
+		     &rd.dotlists,
+		     &rd.canonical) )
     return FALSE;
 
   if ( mname )
@@ -5316,6 +5418,165 @@ PRED_IMPL("$code_class", 2, code_class, 0)
 }
 
 
+		 /*******************************
+		 *	 CLAUSE BOUNDARIES	*
+		 *******************************/
+
+/** '$clause_boundaries'(+Stream, +Offsets, -Boundaries)
+
+Scan the binary Stream for the end of the first clause that ends at or
+after each  byte  offset  in  the  ascending  list  Offsets.  Boundaries
+contains the byte offsets just after  the  end-of-clause  `.`.  This  is
+used by library(read_parallel) to split a  file  into  chunks  that  can
+be parsed independently.
+
+The scanner only tracks quoted text, 0'c  character  codes  and  comments.
+A `.` ends a clause if it is not preceded by a symbol char and followed
+by layout, `%` or the end of the file.  Bytes  above  127  are  handled
+as identifier characters, which is correct for UTF-8 and ISO Latin-1.
+Offsets for which no clause ends before the end of the file are omitted.
+*/
+
+#define CB_CHECK_SIGNALS 0xfffff		/* check signals every 1Mb */
+
+static
+PRED_IMPL("$clause_boundaries", 3, clause_boundaries, 0)
+{ PRED_LD
+  IOSTREAM *s;
+  term_t tail = PL_copy_term_ref(A2);
+  term_t head = PL_new_term_ref();
+  term_t btail = PL_copy_term_ref(A3);
+  term_t bhead = PL_new_term_ref();
+  int64_t target, pos;
+  int c, prev = ' ', prev2 = ' ';
+  int quote = 0;			/* in quoted item */
+  int dot = FALSE;			/* previous char is a candidate end */
+  int rc = TRUE;
+
+  if ( !PL_get_list(tail, head, tail) )
+    return PL_get_nil_ex(tail) && PL_unify_nil(A3);
+  if ( !PL_get_int64_ex(head, &target) )
+    return FALSE;
+  if ( !getBinaryInputStream(A1, &s) )
+    return FALSE;
+
+  pos = Stell64(s);
+  for(;;)
+  { if ( (c = Sgetc(s)) == EOF )
+    { if ( Sferror(s) )
+	rc = FALSE;
+      else if ( dot && pos >= target )
+	rc = ( PL_unify_list(btail, bhead, btail) &&
+	       PL_unify_int64(bhead, pos) );
+      break;
+    }
+    pos++;
+    if ( !(pos & CB_CHECK_SIGNALS) && PL_handle_signals() < 0 )
+    { rc = FALSE;
+      break;
+    }
+
+    if ( quote )
+    { if ( c == '\\' )
+      { if ( Sgetc(s) != EOF )
+	  pos++;
+      } else if ( c == quote )
+      { quote = 0;
+      }
+      prev2 = prev;
+      prev = c;
+      continue;
+    }
+
+    if ( dot )				/* "." followed by layout or % */
+    { dot = FALSE;
+      if ( (c < 128 && isBlank(c)) || c == '%' )
+      { if ( pos-1 >= target )
+	{ if ( !PL_unify_list(btail, bhead, btail) ||
+	       !PL_unify_int64(bhead, pos-1) )
+	  { rc = FALSE;
+	    break;
+	  }
+	  if ( !PL_get_list(tail, head, tail) )
+	  { if ( !PL_get_nil_ex(tail) )
+	      rc = FALSE;
+	    goto out;
+	  }
+	  if ( !PL_get_int64_ex(head, &target) )
+	  { rc = FALSE;
+	    break;
+	  }
+	}
+      }
+    }
+
+    switch(c)
+    { case '%':
+	while( (c=Sgetc(s)) != EOF )
+	{ pos++;
+	  if ( c == '\n' )
+	    break;
+	}
+        c = ' ';
+	break;
+      case '*':
+	if ( prev == '/' )
+	{ int last = 0;
+
+	  while( (c=Sgetc(s)) != EOF )
+	  { pos++;
+	    if ( c == '/' && last == '*' )
+	      break;
+	    last = c;
+	  }
+	  c = ' ';
+	}
+	break;
+      case '\'':
+	if ( prev < 128 && isDigit(prev) )
+	{ if ( prev == '0' && !(prev2 < 128 && isAlpha(prev2)) )
+	  { int c2 = Sgetc(s);		/* 0'c */
+
+	    if ( c2 == '\\' || c2 == '\'' )
+	    { int c3 = Sgetc(s);
+
+	      if ( c3 != EOF )
+	      { if ( c2 == '\\' || c3 == '\'' )
+		  pos++;
+		else
+		  Sungetc(c3, s);
+	      }
+	    }
+	    if ( c2 != EOF )
+	      pos++;
+	  }				/* else R'digits */
+	  c = 'a';
+	  break;
+	}
+	/*FALLTHROUGH*/
+      case '"':
+      case '`':
+	quote = c;
+	break;
+      case '.':
+	if ( !(prev < 128 && isSymbol(prev)) )
+	  dot = TRUE;
+	break;
+    }
+    prev2 = prev;
+    prev = c;
+  }
+
+out:
+  if ( rc )
+    rc = PL_unify_nil(btail);
+  if ( !PL_release_stream(s) )
+    rc = FALSE;
+
+  return rc;
+}
+
+
 		 /*******************************
 		 *      PUBLISH PREDICATES	*
 		 *******************************/
@@ -5330,6 +5591,7 @@ BeginPredDefs(read)
   PRED_DEF("term_string",	  2, term_string,	  0)
   PRED_DEF("$code_class",	  2, code_class,	  0)
   PRED_DEF("$is_named_var",       1, is_named_var,        0)
+  PRED_DEF("$clause_boundaries",  3, clause_boundaries,   0)
 #ifdef O_QUASIQUOTATIONS
   PRED_DEF("$qq_open",            2, qq_open,             0)
 #endif
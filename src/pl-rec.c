@@ -69,6 +69,7 @@ void
 initRecords(void)
 { GD->recorded_db.record_lists = newHTable(8);
   GD->recorded_db.record_lists->free_symbol = free_recordlist_symbol;
+  simpleMutexInit(&GD->recorded_db.shared_mutex);
 }
 
 
@@ -80,6 +81,11 @@ cleanupRecords(void)
   { GD->recorded_db.record_lists = NULL;
     destroyHTable(t);
   }
+  if ( (t=GD->recorded_db.shared) )	/* emptied by the above */
+  { GD->recorded_db.shared = NULL;
+    destroyHTable(t);
+  }
+  simpleMutexDelete(&GD->recorded_db.shared_mutex);
 }
 
 
@@ -111,7 +117,7 @@ firstRecordRecordList(RecordList rl)
 { RecordRef record;
 
   for(record = rl->firstRecord; record; record = record->next)
-  { if ( false(record->record, R_ERASED) )
+  { if ( false(record, R_ERASED) )
       return record;
   }
 
@@ -169,7 +175,7 @@ cleanRecordList(RecordList rl)
   for(r = rl->firstRecord; r; r = next )
   { next = r->next;
 
-    if ( true(r->record, R_ERASED) )
+    if ( true(r, R_ERASED) )
       remove_record(r);
   }
 }
@@ -220,6 +226,21 @@ typedef enum
   EFAST_SERIALIZE
 } cerror;
 
+typedef struct ext_atom
+{ atom_t     atom;			/* The atom */
+  size_t     index;			/* Its index in the record */
+} ext_atom;
+
+#define EXT_ATOMS_FAST 32
+
+typedef struct ext_atoms
+{ ext_atom  *entries;			/* Open hash table */
+  size_t     size;			/* # entries (power of 2) */
+  size_t     count;			/* # atoms in table */
+  int	     locked;			/* Atoms in table are registered */
+  ext_atom   fast[EXT_ATOMS_FAST];	/* Initial table */
+} ext_atoms;
+
 typedef struct
 { tmp_buffer code;			/* code buffer */
   tmp_buffer vars;			/* variable pointers */
@@ -227,6 +248,7 @@ typedef struct
   uint	     nvars;			/* # variables */
   int	     external;			/* Allow for external storage */
   int	     lock;			/* lock compiled atoms */
+  ext_atoms *atoms;			/* Atoms in external record */
   cerror     error;			/* generated error */
   word	     econtext[1];		/* error context */
 } compile_info, *CompileInfo;
@@ -253,16 +275,24 @@ typedef struct
 #define PL_REC_MPQ		(19)	/* GMP rational */
 
 #define PL_TYPE_EXT_COMPOUND_V2	(20)	/* Read V2 external records */
+#define PL_TYPE_EXT_ATOM_REF	(21)	/* Repeated atom in external record */
+#define PL_TYPE_EXT_ARRAY	(22)	/* Numeric array (pl-array.c) */
 
 static const int v2_map[] =
 { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,		/* variable..string */
   11, 12, PL_TYPE_EXT_COMPOUND_V2, 14, 15, 16, 17, 18
 };
 
+static const int v3_map[] =		/* V3 lacks PL_TYPE_EXT_ATOM_REF */
+{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+  10, 11, 12, 13, 14, 15, 16, 17, 18, 19
+};
+
 static const int *v_maps[8] =		/* 3 bits, cannot overflow */
 { NULL,
   NULL,
-  v2_map
+  v2_map,
+  v3_map
 };
 
 
@@ -405,6 +435,103 @@ addAtomValue(CompileInfo info, Atom a)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+External records (version 4) store the text of   an  atom only for its
+first occurrence.  Atoms are numbered in   the order of their first
+occurrence and later occurrences are written as PL_TYPE_EXT_ATOM_REF,
+followed by this number.  This makes records   of terms with many
+repeated atoms and functors smaller  and   avoids  looking  up the atom
+text again when reading the record.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+init_ext_atoms(ext_atoms *map)
+{ map->entries = map->fast;
+  map->size    = EXT_ATOMS_FAST;
+  map->count   = 0;
+  map->locked  = FALSE;
+  memset(map->fast, 0, sizeof(map->fast));
+}
+
+
+static void
+discard_ext_atoms(ext_atoms *map)
+{ if ( map->locked )
+  { size_t i;
+
+    for(i=0; i<map->size; i++)
+    { if ( map->entries[i].atom )
+	PL_unregister_atom(map->entries[i].atom);
+    }
+  }
+  if ( map->entries != map->fast )
+    free(map->entries);
+}
+
+
+static ext_atom *
+lookup_ext_atom(const ext_atoms *map, atom_t a)
+{ size_t mask = map->size-1;
+  size_t i = (size_t)(indexAtom(a)*2654435761U) & mask;
+
+  for(;;)
+  { ext_atom *e = &map->entries[i];
+
+    if ( e->atom == a || !e->atom )
+      return e;
+    i = (i+1) & mask;
+  }
+}
+
+
+static void
+grow_ext_atoms(ext_atoms *map)
+{ ext_atoms old = *map;
+  size_t i;
+
+  map->size *= 2;
+  if ( !(map->entries = calloc(map->size, sizeof(*map->entries))) )
+    outOfCore();
+  for(i=0; i<old.size; i++)
+  { if ( old.entries[i].atom )
+      *lookup_ext_atom(map, old.entries[i].atom) = old.entries[i];
+  }
+  if ( old.entries != map->fast )
+    free(old.entries);
+}
+
+
+/* truncate_ext_atoms() removes the atoms numbered count or higher.  It is
+   used to undo the additions to a persistent (atom table) map if a term
+   cannot be serialized.
+*/
+
+static void
+truncate_ext_atoms(ext_atoms *map, size_t count)
+{ ext_atoms old = *map;
+  size_t i;
+
+  if ( old.count == count )
+    return;
+
+  if ( !(map->entries = calloc(map->size, sizeof(*map->entries))) )
+    outOfCore();
+  map->count = count;
+  for(i=0; i<old.size; i++)
+  { ext_atom *e = &old.entries[i];
+
+    if ( e->atom )
+    { if ( e->index < count )
+	*lookup_ext_atom(map, e->atom) = *e;
+      else if ( map->locked )
+	PL_unregister_atom(e->atom);
+    }
+  }
+  if ( old.entries != map->fast )
+    free(old.entries);
+}
+
+
 static int
 addAtom(CompileInfo info, atom_t a)
 { if ( a == ATOM_nil )
@@ -413,6 +540,16 @@ addAtom(CompileInfo info, atom_t a)
   { addOpCode(info, PL_TYPE_DICT);
   } else if ( unlikely(info->external) )
   { Atom ap = atomValue(a);
+    ext_atom *e = NULL;
+
+    if ( info->atoms )
+    { e = lookup_ext_atom(info->atoms, a);
+      if ( e->atom )
+      { addOpCode(info, PL_TYPE_EXT_ATOM_REF);
+	addSizeInt(info, e->index);
+	return TRUE;
+      }
+    }
 
     if ( true(ap->type, PL_BLOB_TEXT) )
     { if ( isUCSAtom(ap) )
@@ -421,11 +558,33 @@ addAtom(CompileInfo info, atom_t a)
 	addOpCode(info, PL_TYPE_EXT_ATOM);
 
       addAtomValue(info, ap);
+    } else if ( isNumArrayAtom(a) )
+    { int type;
+      size_t length;
+      void *data;
+
+      getNumArrayExternal(a, &type, &length);
+      addOpCode(info, PL_TYPE_EXT_ARRAY);
+      addBuffer(&info->code, (uchar)type, uchar);
+      addSizeInt(info, length);
+      if ( !(data=allocFromBuffer(&info->code,
+				  numArrayExternalSize(type, length))) )
+	outOfCore();
+      copyNumArrayExternal(a, data);
     } else
     { info->error = EFAST_SERIALIZE;
       info->econtext[0] = a;
       return FALSE;
     }
+
+    if ( e )
+    { e->atom  = a;
+      e->index = info->atoms->count++;
+      if ( info->atoms->locked )
+	PL_register_atom(a);
+      if ( info->atoms->count*2 > info->atoms->size )
+	grow_ext_atoms(info->atoms);
+    }
   } else
   { addOpCode(info, PL_TYPE_ATOM);
     addWord(info, a);
@@ -700,6 +859,7 @@ compileTermToHeap__LD(term_t t,
   info.nvars = 0;
   info.external = (flags & R_EXTERNAL);
   info.lock = !(info.external || (flags&R_NOLOCK));
+  info.atoms = NULL;
 
   initTermAgenda(&agenda, 1, valTermRef(t));
   rc = compile_term_to_heap(&agenda, &info PASS_LD);
@@ -712,7 +872,7 @@ compileTermToHeap__LD(term_t t,
     if ( allocate )
       record = (*allocate)(closure, size);
     else
-      record = PL_malloc_atomic_unmanaged(size);
+      record = arena_alloc(size);
 
     if ( record )
     {
@@ -769,6 +929,10 @@ variantRecords(const Record r1, const Record r2)
 
 #define REC_HDR		(REC_SZ|(PL_REC_VERSION<<REC_VSHIFT))
 #define REC_COMPAT(m)	(((m)&(REC_VMASK|REC_SZMASK)) == REC_HDR)
+					/* V3 only lacks PL_TYPE_EXT_ATOM_REF */
+#define REC_V3_HDR	(REC_SZ|(3<<REC_VSHIFT))
+#define REC_CURRENT(m)	(((m)&(REC_VMASK|REC_SZMASK)) == REC_V3_HDR \
+				? (((m)&~REC_VMASK)|(REC_HDR&REC_VMASK)) : (m))
 
 typedef struct record_data
 { int simple;				/* no header */
@@ -802,11 +966,18 @@ rec_error(CompileInfo info)
 }
 
 
+/* compile_external_record() compiles t to an external record.  If table
+   is given, atoms are numbered in this  (persistent) map rather than in a
+   map that is local to the record.  See fast_write/3.
+*/
+
 static int
-compile_external_record(term_t t, record_data *data ARG_LD)
+compile_external_record(term_t t, record_data *data, ext_atoms *table ARG_LD)
 { Word p;
   int first = REC_HDR;
   term_agenda agenda;
+  ext_atoms atoms;
+  size_t natoms = 0;
   int scode, rc;
 
   DEBUG(CHK_SECURE, checkData(valTermRef(t)));
@@ -817,6 +988,7 @@ compile_external_record(term_t t, record_data *data ARG_LD)
   initBuffer(&data->info.code);
   data->info.external = TRUE;
   data->info.lock = FALSE;
+  data->info.atoms = NULL;
 
   if ( isInteger(*p) )			/* integer-only record */
   { int64_t v;
@@ -834,8 +1006,9 @@ compile_external_record(term_t t, record_data *data ARG_LD)
     data->simple = TRUE;
 
     return TRUE;
-  } else if ( isAtom(*p) )		/* atom-only record */
-  { first |= (REC_ATOM|REC_GROUND);
+  } else if ( isAtom(*p) && !isNumArrayAtom(*p) && !table )
+  {					/* atom-only record */
+    first |= (REC_ATOM|REC_GROUND);
     addOpCode(&data->info, first);
     if ( !addAtom(&data->info, *p) )
       return FALSE;
@@ -851,9 +1024,23 @@ general:
   data->info.size = 0;
   data->info.nvars = 0;
 
+  if ( table )
+  { natoms = table->count;
+    data->info.atoms = table;
+  } else
+  { init_ext_atoms(&atoms);
+    data->info.atoms = &atoms;
+  }
   initTermAgenda(&agenda, 1, p);
   rc = compile_term_to_heap(&agenda, &data->info PASS_LD);
   clearTermAgenda(&agenda);
+  data->info.atoms = NULL;
+  if ( table )
+  { if ( !rc )
+      truncate_ext_atoms(table, natoms);
+  } else
+  { discard_ext_atoms(&atoms);
+  }
   if ( data->info.nvars == 0 )
     first |= REC_GROUND;
   restoreVars(&data->info);
@@ -877,7 +1064,7 @@ PL_record_external(term_t t, size_t *len)
 { GET_LD
   record_data data;
 
-  if ( compile_external_record(t, &data PASS_LD) )
+  if ( compile_external_record(t, &data, NULL PASS_LD) )
   { if ( data.simple )
     { int scode = (int)sizeOfBuffer(&data.info.code);
       char *rec = malloc(scode);
@@ -935,7 +1122,7 @@ PRED_IMPL("fast_term_serialized", 2, fast_term_serialized, 0)
   if ( PL_is_variable(string) )
   { record_data data;
 
-    if ( compile_external_record(term, &data PASS_LD) )
+    if ( compile_external_record(term, &data, NULL PASS_LD) )
     { if ( data.simple )
       { int rc;
 
@@ -979,45 +1166,253 @@ PRED_IMPL("fast_term_serialized", 2, fast_term_serialized, 0)
   }
 }
 
-/** fast_write(+Stream, +Term)
+		 /*******************************
+		 *	    ATOM TABLES		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A fast_atom_table extends the numbering of  atoms in external records (see
+addAtom()) over a sequence of records written to or read from a stream.
+The text of an atom is sent only the first  time it appears on the stream;
+later records refer to it using PL_TYPE_EXT_ATOM_REF and its number in the
+table.  This makes exchanging many  small   messages  over a connection
+much cheaper, as the functor and atom names  are sent only once.
+
+The writer and the reader each have their  own table: the writer maps atoms
+to their number and the reader maps  numbers   to  atoms.  Both register
+their atoms.  A table must be used  with   a  single stream and all terms
+written to that stream must use the table.   Each record written using a
+table is prefixed by REC_ATOM_TABLE,  which   makes  fast_read/2 refuse
+these records.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define REC_ATOM_TABLE	0x00		/* Prefix of record using atom table */
+
+typedef struct fast_atom_table
+{ ext_atoms	out;			/* Atoms written: atom --> number */
+  tmp_buffer	in;			/* Atoms read: number --> atom */
+  simpleMutex	mutex;			/* Serialize access */
+} fast_atom_table;
+
+typedef struct fat_ref
+{ fast_atom_table *table;		/* represented table */
+} fat_ref;
+
+
+static fast_atom_table *
+new_fast_atom_table(void)
+{ fast_atom_table *t = allocHeapOrHalt(sizeof(*t));
+
+  init_ext_atoms(&t->out);
+  t->out.locked = TRUE;
+  initBuffer(&t->in);
+  simpleMutexInit(&t->mutex);
+
+  return t;
+}
+
+
+static void
+free_fast_atom_table(fast_atom_table *t)
+{ atom_t *ap = baseBuffer(&t->in, atom_t);
+  atom_t *ep = topBuffer(&t->in, atom_t);
+
+  for(; ap < ep; ap++)
+    PL_unregister_atom(*ap);
+  discardBuffer(&t->in);
+  discard_ext_atoms(&t->out);
+  simpleMutexDelete(&t->mutex);
+  freeHeap(t, sizeof(*t));
+}
+
+
+static int
+write_fast_atom_table_ref(IOSTREAM *s, atom_t aref, int flags)
+{ fat_ref *ref = PL_blob_data(aref, NULL, NULL);
+  (void)flags;
+
+  Sfprintf(s, "<fast_atom_table>(%p)", ref->table);
+  return TRUE;
+}
+
+
+static int
+release_fast_atom_table_ref(atom_t aref)
+{ fat_ref *ref = PL_blob_data(aref, NULL, NULL);
+
+  if ( ref->table )
+    free_fast_atom_table(ref->table);
+
+  return TRUE;
+}
+
+
+static int
+save_fast_atom_table(atom_t aref, IOSTREAM *fd)
+{ fat_ref *ref = PL_blob_data(aref, NULL, NULL);
+  (void)fd;
+
+  return PL_warning("Cannot save reference to <fast_atom_table>(%p)",
+		    ref->table);
+}
+
+
+static atom_t
+load_fast_atom_table(IOSTREAM *fd)
+{ (void)fd;
+
+  return PL_new_atom("<saved-fast_atom_table-ref>");
+}
+
+
+static PL_blob_t fast_atom_table_blob =
+{ PL_BLOB_MAGIC,
+  PL_BLOB_UNIQUE,
+  "fast_atom_table",
+  release_fast_atom_table_ref,
+  NULL,
+  write_fast_atom_table_ref,
+  NULL,
+  save_fast_atom_table,
+  load_fast_atom_table
+};
+
+
+static int
+get_fast_atom_table(term_t t, fast_atom_table **tp)
+{ void *data;
+  PL_blob_t *type;
+
+  if ( PL_get_blob(t, &data, NULL, &type) && type == &fast_atom_table_blob )
+  { fat_ref *ref = data;
+
+    *tp = ref->table;
+    return TRUE;
+  }
+
+  return PL_type_error("fast_atom_table", t);
+}
+
+
+static const opt_spec fast_rw_options[] =
+{ { ATOM_atom_table,	OPT_TERM },
+  { NULL_ATOM,		0 }
+};
+
+static int
+get_fast_rw_options(term_t options, fast_atom_table **tp)
+{ term_t table = 0;
+
+  *tp = NULL;
+  if ( !scan_options(options, 0, ATOM_fast_option, fast_rw_options, &table) )
+    return FALSE;
+  if ( table )
+    return get_fast_atom_table(table, tp);
+
+  return TRUE;
+}
+
+
+/** fast_atom_table(-Table) is det.
 */
 
 static
-PRED_IMPL("fast_write", 2, fast_write, 0)
+PRED_IMPL("fast_atom_table", 1, fast_atom_table, 0)
 { PRED_LD
-  IOSTREAM *out;
+  term_t tmp = PL_new_term_ref();
+  fat_ref ref;
 
-  if ( PL_get_stream(A1, &out, SIO_OUTPUT) )
-  { record_data data;
-    int rc;
+  ref.table = new_fast_atom_table();
+  if ( !PL_put_blob(tmp, &ref, sizeof(ref), &fast_atom_table_blob) )
+  { free_fast_atom_table(ref.table);
+    return FALSE;
+  }
 
-    if ( out->encoding == ENC_OCTET )
-    { if ( (rc=compile_external_record(A2, &data PASS_LD)) )
-      { if ( data.simple )
-	{ size_t len = sizeOfBuffer(&data.info.code);
+  return PL_unify(A1, tmp);
+}
 
-	  rc = (Sfwrite(data.info.code.base, 1, len, out) == len);
-	} else
-	{ size_t shdr  = sizeOfBuffer(&data.hdr);
-	  size_t scode = sizeOfBuffer(&data.info.code);
 
-	  rc = ( Sfwrite(data.hdr.base,       1,  shdr, out) == shdr &&
-		 Sfwrite(data.info.code.base, 1, scode, out) == scode
-	       );
-	}
+		 /*******************************
+		 *	  FAST TERM I/O		*
+		 *******************************/
 
-	discard_record_data(&data);
-      }
+static int
+fast_write_stream(IOSTREAM *out, term_t term, fast_atom_table *table ARG_LD)
+{ record_data data;
+  int rc;
+
+  if ( table )
+    simpleMutexLock(&table->mutex);
+
+  if ( (rc=compile_external_record(term, &data,
+				   table ? &table->out : NULL PASS_LD)) )
+  { if ( table && Sputc(REC_ATOM_TABLE, out) == -1 )
+    { rc = FALSE;
+    } else if ( data.simple )
+    { size_t len = sizeOfBuffer(&data.info.code);
+
+      rc = (Sfwrite(data.info.code.base, 1, len, out) == len);
     } else
-    { rc = PL_permission_error("fast_write", "stream", A1);
+    { size_t shdr  = sizeOfBuffer(&data.hdr);
+      size_t scode = sizeOfBuffer(&data.info.code);
+
+      rc = ( Sfwrite(data.hdr.base,       1,  shdr, out) == shdr &&
+	     Sfwrite(data.info.code.base, 1, scode, out) == scode
+	   );
     }
 
+    discard_record_data(&data);
+  }
+
+  if ( table )
+    simpleMutexUnlock(&table->mutex);
+
+  return rc;
+}
+
+
+static int
+fast_write_term(term_t stream, term_t term, term_t options ARG_LD)
+{ IOSTREAM *out;
+  fast_atom_table *table = NULL;
+
+  if ( options && !get_fast_rw_options(options, &table) )
+    return FALSE;
+
+  if ( PL_get_stream(stream, &out, SIO_OUTPUT) )
+  { int rc;
+
+    if ( out->encoding == ENC_OCTET )
+      rc = fast_write_stream(out, term, table PASS_LD);
+    else
+      rc = PL_permission_error("fast_write", "stream", stream);
+
     return PL_release_stream(out) && rc;
   }
 
   return FALSE;
 }
 
+/** fast_write(+Stream, +Term)
+*/
+
+static
+PRED_IMPL("fast_write", 2, fast_write, 0)
+{ PRED_LD
+
+  return fast_write_term(A1, A2, 0 PASS_LD);
+}
+
+/** fast_write(+Stream, +Term, +Options)
+*/
+
+static
+PRED_IMPL("fast_write", 3, fast_write, 0)
+{ PRED_LD
+
+  return fast_write_term(A1, A2, A3 PASS_LD);
+}
+
 
 #define FASTRW_FAST 512
 
@@ -1066,111 +1461,162 @@ realloc_record(char *rec, char **np, size_t size)
 }
 
 
-static
-PRED_IMPL("fast_read", 2, fast_read, 0)
-{ PRED_LD
-  IOSTREAM *in;
+static int recorded_external(const char *rec, term_t t,
+			     TmpBuffer table ARG_LD);
 
-  if ( PL_get_stream(A1, &in, SIO_INPUT) )
-  { int rc;
+static int
+fast_read_record(IOSTREAM *in, int m, term_t term,
+		 fast_atom_table *table ARG_LD)
+{ char fast[FASTRW_FAST];
+  char *rec = fast;
+  int rc;
 
-    if ( in->encoding == ENC_OCTET )
-    { int m = Sgetc(in);
-      char fast[FASTRW_FAST];
-      char *rec = fast;
-
-      switch(m)
-      { case -1:
-	  rc = PL_unify_atom(A2, ATOM_end_of_file);
-	  goto out;
-        case REC_HDR|REC_INT|REC_GROUND:
-	{ int size = Sgetc(in)&0xff;
-
-	  if ( size <= 8 )
-	  { rec[0] = m;
-	    rec[1] = size;
-	    if ( Sfread(&rec[2], 1, size, in) != size )
-	      rc = PL_syntax_error("fastrw_integer", in);
-	    else
-	      rc = TRUE;
-	  } else
-	  { rc = PL_syntax_error("fastrw_integer", in);
-	  }
-	  break;
-	}
-	case REC_HDR|REC_ATOM|REC_GROUND:
-	{ uchar op = Sgetc(in);
-
-	  switch(op)
-	  { case PL_TYPE_NIL:
-	      rc = PL_unify_nil(A2);
-	      goto out;
-	    case PL_TYPE_DICT:
-	      rc = PL_unify_atom(A2, ATOM_dict);
-	      goto out;
-	    case PL_TYPE_EXT_WATOM:
-	    case PL_TYPE_EXT_ATOM:
-	    { size_t bytes;
-	      char *np;
-
-	      rec[0] = m;
-	      rec[1] = op;
-
-	      if ( (np=readSizeInt(in, &rec[2], &bytes)) &&
-		   (rec = realloc_record(rec, &np, bytes)) &&
-		   Sfread(np, 1, bytes, in) == bytes )
-		rc = TRUE;
-	      else
-		rc = PL_syntax_error("fastrw_atom", in);
-	      break;
-	    }
-	    default:
-	      rc = PL_syntax_error("fastrw_atom_type", in);
-	  }
-	  break;
-	}
-	case REC_HDR|REC_GROUND:
-	case REC_HDR:
-	{ char *np;
-	  size_t codes, gsize, nvars;
+  switch(REC_CURRENT(m))
+  { case -1:
+      return PL_unify_atom(term, ATOM_end_of_file);
+    case REC_HDR|REC_INT|REC_GROUND:
+    { int size = Sgetc(in)&0xff;
+
+      if ( size <= 8 )
+      { rec[0] = m;
+	rec[1] = size;
+	if ( Sfread(&rec[2], 1, size, in) != size )
+	  rc = PL_syntax_error("fastrw_integer", in);
+	else
+	  rc = TRUE;
+      } else
+      { rc = PL_syntax_error("fastrw_integer", in);
+      }
+      break;
+    }
+    case REC_HDR|REC_ATOM|REC_GROUND:
+    { uchar op = Sgetc(in);
+
+      switch(op)
+      { case PL_TYPE_NIL:
+	  return PL_unify_nil(term);
+	case PL_TYPE_DICT:
+	  return PL_unify_atom(term, ATOM_dict);
+	case PL_TYPE_EXT_WATOM:
+	case PL_TYPE_EXT_ATOM:
+	{ size_t bytes;
+	  char *np;
 
 	  rec[0] = m;
+	  rec[1] = op;
 
-	  if ( (np=readSizeInt(in, &rec[1], &codes)) &&
-	       (np=readSizeInt(in, np, &gsize)) &&
-	       ((m&REC_GROUND) || (np=readSizeInt(in, np, &nvars))) &&
-	       (rec = realloc_record(rec, &np, codes)) &&
-	       Sfread(np, 1, codes, in) == codes )
+	  if ( (np=readSizeInt(in, &rec[2], &bytes)) &&
+	       (rec = realloc_record(rec, &np, bytes)) &&
+	       Sfread(np, 1, bytes, in) == bytes )
 	    rc = TRUE;
 	  else
-	    rc = PL_syntax_error("fastrw_term", in);
+	    rc = PL_syntax_error("fastrw_atom", in);
 	  break;
 	}
 	default:
-	  rc = PL_syntax_error("fastrw_magic_expected", in);
+	  rc = PL_syntax_error("fastrw_atom_type", in);
       }
+      break;
+    }
+    case REC_HDR|REC_GROUND:
+    case REC_HDR:
+    { char *np;
+      size_t codes, gsize, nvars;
+
+      rec[0] = m;
+
+      if ( (np=readSizeInt(in, &rec[1], &codes)) &&
+	   (np=readSizeInt(in, np, &gsize)) &&
+	   ((m&REC_GROUND) || (np=readSizeInt(in, np, &nvars))) &&
+	   (rec = realloc_record(rec, &np, codes)) &&
+	   Sfread(np, 1, codes, in) == codes )
+	rc = TRUE;
+      else
+	rc = PL_syntax_error("fastrw_term", in);
+      break;
+    }
+    default:
+      rc = PL_syntax_error("fastrw_magic_expected", in);
+  }
+
+  if ( rc )
+  { term_t tmp;
 
-      if ( rc )
-      { term_t tmp;
+    rc = ( (tmp = PL_new_term_ref()) &&
+	   recorded_external(rec, tmp, table ? &table->in : NULL PASS_LD) &&
+	   PL_unify(term, tmp) );
+  }
 
-	rc = ( (tmp = PL_new_term_ref()) &&
-	       PL_recorded_external(rec, tmp) &&
-	       PL_unify(A2, tmp) );
-      }
+  if ( rec != fast )
+    free(rec);
 
-      if ( rec != fast )
-	free(rec);
-    } else
-    { rc = PL_permission_error("fast_read", "stream", A1);
-    }
+  return rc;
+}
+
+
+static int
+fast_read_stream(IOSTREAM *in, term_t term, fast_atom_table *table ARG_LD)
+{ int m = Sgetc(in);
+  int rc;
+
+  if ( !table )
+    return fast_read_record(in, m, term, NULL PASS_LD);
+
+  if ( m == -1 )
+    return PL_unify_atom(term, ATOM_end_of_file);
+  if ( m != REC_ATOM_TABLE || (m=Sgetc(in)) == -1 )
+    return PL_syntax_error("fastrw_atom_table_expected", in);
+
+  simpleMutexLock(&table->mutex);
+  rc = fast_read_record(in, m, term, table PASS_LD);
+  simpleMutexUnlock(&table->mutex);
+
+  return rc;
+}
+
+
+static int
+fast_read_term(term_t stream, term_t term, term_t options ARG_LD)
+{ IOSTREAM *in;
+  fast_atom_table *table = NULL;
+
+  if ( options && !get_fast_rw_options(options, &table) )
+    return FALSE;
+
+  if ( PL_get_stream(stream, &in, SIO_INPUT) )
+  { int rc;
+
+    if ( in->encoding == ENC_OCTET )
+      rc = fast_read_stream(in, term, table PASS_LD);
+    else
+      rc = PL_permission_error("fast_read", "stream", stream);
 
-  out:
     return PL_release_stream(in) && rc;
   }
 
   return FALSE;
 }
 
+/** fast_read(+Stream, -Term)
+*/
+
+static
+PRED_IMPL("fast_read", 2, fast_read, 0)
+{ PRED_LD
+
+  return fast_read_term(A1, A2, 0 PASS_LD);
+}
+
+/** fast_read(+Stream, -Term, +Options)
+*/
+
+static
+PRED_IMPL("fast_read", 3, fast_read, 0)
+{ PRED_LD
+
+  return fast_read_term(A1, A2, A3 PASS_LD);
+}
+
 
 		 /*******************************
 		 *	   HEAP --> STACK	*
@@ -1188,6 +1634,8 @@ typedef struct
   uint		nvars;			/* Variables seen */
   uint		dicts;			/* # dicts found */
   TmpBuffer	avars;			/* Values stored for attvars */
+  TmpBuffer	atoms;			/* Atoms of an external record */
+  int		lock_atoms;		/* Register atoms added to atoms */
   Word	        vars_buf[MAX_FAST_VARS];
 } copy_info, *CopyInfo;
 
@@ -1322,6 +1770,35 @@ fetchAtomW(CopyInfo b, atom_t *a)
 }
 
 
+static inline void
+addExtAtom(CopyInfo b, atom_t a)
+{ if ( b->atoms )
+  { addBuffer(b->atoms, a, atom_t);
+    if ( b->lock_atoms )
+      PL_register_atom(a);
+  }
+}
+
+
+static void
+fetchNumArray(CopyInfo b, atom_t *a)
+{ int type = *b->data++ & 0xff;
+  size_t length = fetchSizeInt(b);
+
+  *a = newNumArrayExternal(type, length, b->data);
+  b->data += numArrayExternalSize(type, length);
+}
+
+
+static atom_t
+fetchAtomRef(CopyInfo b)
+{ size_t i = fetchSizeInt(b);
+
+  assert(b->atoms && i < entriesBuffer(b->atoms, atom_t));
+  return fetchBuffer(b->atoms, i, atom_t);
+}
+
+
 static void
 fetchChars(CopyInfo b, unsigned len, Word to)
 { fetchMultipleBuf(b, (char *)to, len, char);
@@ -1392,11 +1869,23 @@ copy_record(Word p, CopyInfo b ARG_LD)
       case PL_TYPE_EXT_ATOM:
       { fetchAtom(b, p);
 	PL_unregister_atom(*p);
+	addExtAtom(b, *p);
 	continue;
       }
       case PL_TYPE_EXT_WATOM:
       { fetchAtomW(b, p);
 	PL_unregister_atom(*p);
+	addExtAtom(b, *p);
+	continue;
+      }
+      case PL_TYPE_EXT_ATOM_REF:
+      { *p = fetchAtomRef(b);
+	continue;
+      }
+      case PL_TYPE_EXT_ARRAY:
+      { fetchNumArray(b, p);
+	PL_unregister_atom(*p);
+	addExtAtom(b, *p);
 	continue;
       }
       case PL_TYPE_TAGGED_INTEGER:
@@ -1493,9 +1982,18 @@ copy_record(Word p, CopyInfo b ARG_LD)
 	switch(opcode_atom)
 	{ case PL_TYPE_EXT_ATOM:
 	    fetchAtom(b, &name);
+	    addExtAtom(b, name);
 	    break;
 	  case PL_TYPE_EXT_WATOM:
 	    fetchAtomW(b, &name);
+	    addExtAtom(b, name);
+	    break;
+	  case PL_TYPE_EXT_ATOM_REF:
+	    name = fetchAtomRef(b);
+	    break;
+	  case PL_TYPE_EXT_ARRAY:
+	    fetchNumArray(b, &name);
+	    addExtAtom(b, name);
 	    break;
 	  case PL_TYPE_NIL:
 	    name = ATOM_nil;
@@ -1561,6 +2059,7 @@ copyRecordToGlobal(term_t copy, Record r, int flags ARG_LD)
   b.base = b.data = dataRecord(r);
   b.gbase = b.gstore = gTop;
   b.version_map = NULL;
+  b.atoms = NULL;
 
   if ( (rc=init_copy_vars(&b, r->nvars)) == TRUE )
   { gTop += r->gsize;
@@ -1586,7 +2085,7 @@ is_external(const char *rec, size_t len)
     info.data = info.base = rec;
     fetchBuf(&info, &m, uchar);
 
-    switch(m)
+    switch(REC_CURRENT(m))
     { case REC_HDR|REC_INT|REC_GROUND:
       { uint bytes = *info.data++;
 	return len == bytes+2;
@@ -1694,6 +2193,17 @@ scanAtomsRecord(CopyInfo b, void (*func)(atom_t a))
       { skipAtom(b);
 	continue;
       }
+      case PL_TYPE_EXT_ATOM_REF:
+      { skipSizeInt(b);
+	continue;
+      }
+      case PL_TYPE_EXT_ARRAY:
+      { int type = *b->data++ & 0xff;
+	size_t length = fetchSizeInt(b);
+
+	b->data += numArrayExternalSize(type, length);
+	continue;
+      }
       case PL_TYPE_TAGGED_INTEGER:
       case PL_TYPE_INTEGER:
       { skipLong(b);
@@ -1776,10 +2286,101 @@ unregister_atom_rec(atom_t a)
 #endif
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Shared records. If the flag  record_sharing   is  true, recorda/3 and
+recordz/3 share the Record  of  ground  terms   that  are  identical to a
+term already in the recorded database. As  a   Record  is a flat byte
+sequence, two ground terms are  equal  iff   their  compiled  form is
+equal.  The  table  maps  the  hash  of  the  compiled  code  to  the
+Record.  Hash collisions are not chained: the new record just remains
+private.  Shared records use the  R_DUPLICATE reference count, which is
+only modified while holding shared_mutex such  that a record that drops
+to zero references cannot be found again.
+
+Sharing the whole record rather  than   individual  sub-terms keeps the
+record format and copyRecordToGlobal() unchanged.   The state  that is
+specific to a database entry (R_ERASED and R_DBREF) is kept in the
+RecordRef.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define sizeDataRecord(r) ((size_t)(r)->size - SIZERECORD((r)->flags))
+
+/* hashRecord() and equalRecords() consider the compiled data only. Two
+   ground terms are == iff their records are equal.
+*/
+
+unsigned int
+hashRecord(const Record r)
+{ return MurmurHashAligned2(dataRecord(r), sizeDataRecord(r), MURMUR_SEED);
+}
+
+
+int
+equalRecords(const Record r1, const Record r2)
+{ size_t len = sizeDataRecord(r1);
+
+  return ( len == sizeDataRecord(r2) &&
+	   memcmp(dataRecord(r1), dataRecord(r2), len) == 0 );
+}
+
+
+static void *
+shared_record_key(Record r)
+{ unsigned int h = hashRecord(r);
+
+  return (void*)(((uintptr_t)h>>1)|0x1);	/* avoid reserved keys */
+}
+
+
+static Record
+share_record(Record r)
+{ GET_LD
+  void *key = shared_record_key(r);
+  Record old;
+
+  simpleMutexLock(&GD->recorded_db.shared_mutex);
+  if ( !GD->recorded_db.shared )
+    GD->recorded_db.shared = newHTable(64);
+  if ( (old=lookupHTable(GD->recorded_db.shared, key)) )
+  { if ( equalRecords(old, r) )
+    { ATOMIC_INC(&old->references);
+      simpleMutexUnlock(&GD->recorded_db.shared_mutex);
+      freeRecord(r);
+
+      return old;
+    }
+  } else
+  { set(r, R_SHARED);
+    addNewHTable(GD->recorded_db.shared, key, r);
+  }
+  simpleMutexUnlock(&GD->recorded_db.shared_mutex);
+
+  return r;
+}
+
+
+static int
+release_shared_record(Record r)
+{ int last;
+
+  simpleMutexLock(&GD->recorded_db.shared_mutex);
+  if ( (last = (ATOMIC_DEC(&r->references) == 0)) )
+    deleteHTable(GD->recorded_db.shared, shared_record_key(r));
+  simpleMutexUnlock(&GD->recorded_db.shared_mutex);
+
+  return last;
+}
+
+
 bool
 freeRecord(Record record)
-{ if ( true(record, R_DUPLICATE) && --record->references > 0 )
-    succeed;
+{ if ( true(record, R_SHARED) )
+  { if ( !release_shared_record(record) )
+      succeed;
+  } else if ( true(record, R_DUPLICATE) &&
+	      ATOMIC_DEC(&record->references) > 0 )
+  { succeed;
+  }
 
 #ifdef O_ATOMGC
   if ( false(record, (R_EXTERNAL|R_NOLOCK)) )
@@ -1798,7 +2399,7 @@ freeRecord(Record record)
   }
 #endif
 
-  PL_free(record);
+  arena_free(record, record->size);
 
   succeed;
 }
@@ -1812,7 +2413,7 @@ unallocRecordRef(RecordRef r)
 
 static void
 freeRecordRef(RecordRef r)
-{ int reclaim_now = false(r->record, R_DBREF);
+{ int reclaim_now = false(r, R_DBREF);
 
   freeRecord(r->record);
   if ( reclaim_now )
@@ -1826,10 +2427,15 @@ freeRecordRef(RecordRef r)
 		 *	 EXTERNAL RECORDS	*
 		 *******************************/
 
-int
-PL_recorded_external(const char *rec, term_t t)
-{ GET_LD
-  copy_info b;
+/* recorded_external() decodes an external record.  If table is given, it
+   holds the atoms of previous records, numbered in the order in which they
+   first appeared and new atoms are added to it.  See fast_read/3.
+*/
+
+static int
+recorded_external(const char *rec, term_t t, TmpBuffer table ARG_LD)
+{ copy_info b;
+  tmp_buffer atoms;
   uint gsize;
   uchar m;
   int rc;
@@ -1893,6 +2499,14 @@ PL_recorded_external(const char *rec, term_t t)
   if ( !(b.gbase = b.gstore = allocGlobal(gsize)) )
     return FALSE;			/* global stack overflow */
   b.dicts = 0;
+  if ( table )
+  { b.atoms = table;
+    b.lock_atoms = TRUE;
+  } else
+  { initBuffer(&atoms);
+    b.atoms = &atoms;
+    b.lock_atoms = FALSE;
+  }
   if ( !(m & REC_GROUND) )
   { uint nvars = fetchSizeInt(&b);
 
@@ -1903,6 +2517,8 @@ PL_recorded_external(const char *rec, term_t t)
   } else
   { rc = copy_record(valTermRef(t), &b PASS_LD);
   }
+  if ( !table )
+    discardBuffer(&atoms);
 
   if ( rc != TRUE )
     return raiseStackOverflow(rc);
@@ -1917,6 +2533,14 @@ PL_recorded_external(const char *rec, term_t t)
 }
 
 
+int
+PL_recorded_external(const char *rec, term_t t)
+{ GET_LD
+
+  return recorded_external(rec, t, NULL PASS_LD);
+}
+
+
 int
 PL_erase_external(char *rec)
 { PL_free(rec);
@@ -2038,10 +2662,16 @@ record(term_t key, term_t term, term_t ref, int az)
   if ( ref && !PL_is_variable(ref) )
     return PL_uninstantiation_error(ref);
 
-  if ( !(copy = compileTermToHeap(term, 0)) )
+  if ( GD->recorded_db.share )
+  { if ( !(copy = compileTermToHeap(term, R_DUPLICATE)) )
+      return PL_no_memory();
+    if ( copy->nvars == 0 )
+      copy = share_record(copy);
+  } else if ( !(copy = compileTermToHeap(term, 0)) )
     return PL_no_memory();
   r = allocHeapOrHalt(sizeof(*r));
   r->record = copy;
+  r->flags  = 0;
   if ( ref && !PL_unify_recref(ref, r) )
   { PL_erase(copy);
     freeHeap(r, sizeof(*r));
@@ -2146,7 +2776,7 @@ advance_state(recorded_state *state)
 	cleanRecordList(rl);
     }
     r = r->next;
-  } while ( r && true(r->record, R_ERASED) );
+  } while ( r && true(r, R_ERASED) );
 
   state->r = r;
   return r;
@@ -2384,7 +3014,7 @@ PRED_IMPL("erase", 1, erase, 0)
     PL_LOCK(L_RECORD);
     l = r->list;
     if ( l->references )		/* a recorded has choicepoints */
-    { set(r->record, R_ERASED);
+    { set(r, R_ERASED);
       set(l, RL_DIRTY);
     } else
     { remove_record(r);
@@ -2413,5 +3043,8 @@ BeginPredDefs(rec)
 
   PRED_DEF("fast_term_serialized", 2, fast_term_serialized, 0)
   PRED_DEF("fast_write",	   2, fast_write,	    0)
+  PRED_DEF("fast_write",	   3, fast_write,	    0)
   PRED_DEF("fast_read",		   2, fast_read,	    0)
+  PRED_DEF("fast_read",		   3, fast_read,	    0)
+  PRED_DEF("fast_atom_table",	   1, fast_atom_table,	    0)
 EndPredDefs
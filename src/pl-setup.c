@@ -44,6 +44,7 @@
 #include "pl-dbref.h"
 #include "pl-trie.h"
 #include "pl-tabling.h"
+#include "pl-prof.h"
 #include <sys/stat.h>
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -119,6 +120,8 @@ setupProlog(void)
   initRecords();
   DEBUG(1, Sdprintf("Tries ...\n"));
   initTries();
+  DEBUG(1, Sdprintf("Numeric arrays ...\n"));
+  initNumArrays();
   DEBUG(1, Sdprintf("Tabling ...\n"));
   initTabling();
   DEBUG(1, Sdprintf("Flags ...\n"));
@@ -312,6 +315,12 @@ static struct signame
 #endif
   { SIG_CLAUSE_GC,     "prolog:clause_gc",     0 },
   { SIG_PLABORT,       "prolog:abort",         0 },
+#ifdef SIG_STREAM_OWNER
+  { SIG_STREAM_OWNER,  "prolog:stream_owner",  0 },
+#endif
+#ifdef SIG_PROF_SAMPLE
+  { SIG_PROF_SAMPLE,   "prolog:prof_sample",   0 },
+#endif
 
   { -1,		NULL,     0}
 };
@@ -735,6 +744,13 @@ gc_tune_handler(int sig)
   call_tune_gc_hook();
 }
 
+static void
+gc_event_handler(int sig)
+{ (void)sig;
+
+  call_gc_event_hook();
+}
+
 static void
 cgc_handler(int sig)
 { (void)sig;
@@ -743,6 +759,16 @@ cgc_handler(int sig)
 }
 
 
+#ifdef SIG_STREAM_OWNER
+static void
+stream_owner_handler(int sig)
+{ (void)sig;
+
+  releaseOwnedStreams(FALSE);
+}
+#endif
+
+
 static void
 abort_handler(int sig)
 { (void)sig;
@@ -814,11 +840,18 @@ initSignals(void)
 
   PL_signal(SIG_GC|PL_SIGSYNC,	          gc_handler);
   PL_signal(SIG_TUNE_GC|PL_SIGSYNC,	  gc_tune_handler);
+  PL_signal(SIG_GC_EVENT|PL_SIGSYNC,	  gc_event_handler);
   PL_signal(SIG_CLAUSE_GC|PL_SIGSYNC,     cgc_handler);
   PL_signal(SIG_PLABORT|PL_SIGSYNC,       abort_handler);
 #ifdef SIG_THREAD_SIGNAL
   PL_signal(SIG_THREAD_SIGNAL|PL_SIGSYNC, executeThreadSignals);
 #endif
+#ifdef SIG_STREAM_OWNER
+  PL_signal(SIG_STREAM_OWNER|PL_SIGSYNC,  stream_owner_handler);
+#endif
+#ifdef SIG_PROF_SAMPLE
+  PL_signal(SIG_PROF_SAMPLE|PL_SIGSYNC,   sampleProfilerHandler);
+#endif
 #ifdef SIG_ATOM_GC
   PL_signal(SIG_ATOM_GC|PL_SIGSYNC,       agc_handler);
 #endif
@@ -1070,6 +1103,55 @@ PL_handle_signals(void)
 }
 
 
+int
+PL_signal_pending(void)
+{ GET_LD
+
+  return is_signalled(PASS_LD1);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+PL_set_signal_wakeup() registers a function that  is called by a thread
+that signals the calling thread (thread_signal/2, PL_thread_raise()) after
+the signal is pending.  Foreign code that blocks  on something that is
+not interrupted by the alert signal, e.g.,  a condition variable or a
+computation in another thread, uses this to  wake up and handle the
+signal.  Clearing the function waits for running wakeup calls, such that
+the closure may be destroyed after PL_set_signal_wakeup(NULL, NULL)
+returns.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void
+PL_set_signal_wakeup(void (*wakeup)(void *closure), void *closure)
+{ GET_LD
+
+  if ( !HAS_LD )
+    return;
+
+  LD->signal.wakeup = NULL;
+  MEMORY_BARRIER();
+  while( LD->signal.wakeup_running > 0 )
+    MEMORY_BARRIER();			/* wakeup calls are short */
+  LD->signal.wakeup_closure = closure;
+  MEMORY_BARRIER();
+  LD->signal.wakeup = wakeup;
+}
+
+
+void
+signalWakeup(PL_local_data_t *ld)
+{ if ( ld->signal.wakeup )
+  { void (*wakeup)(void *closure);
+
+    ATOMIC_INC(&ld->signal.wakeup_running);
+    if ( (wakeup = ld->signal.wakeup) )
+      (*wakeup)(ld->signal.wakeup_closure);
+    ATOMIC_DEC(&ld->signal.wakeup_running);
+  }
+}
+
+
 int
 handleSignals(ARG1_LD)
 { int done = 0;
@@ -1426,6 +1508,59 @@ init_stack(Stack s, char *name, size_t size, size_t spare, int gc)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+If the flag stack_reserve is true and the system supports it (see
+stack_reserve_size()),  we  reserve  address   space  for  the  stack
+limit for each stack when the stacks are created. The global and local
+stacks share one region, where the local stack starts at the reserved
+size above the global stack. This  keeps   the  local stack above the
+global stack, while both can grow without moving.  Growing a stack now
+only commits more pages of its region (see grow_stacks()), so its base
+does not change and the stack shifter has no pointers to relocate.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+alloc_reserved_stacks(size_t iglobal, size_t ilocal, size_t itrail ARG_LD)
+{ stack_reservation *r = &LD->stacks.reserve;
+  size_t size = stack_reserve_size(LD->stacks.limit);
+  void *gl, *tr;
+
+  memset(r, 0, sizeof(*r));
+  if ( !size || size < iglobal || size < ilocal || size < itrail )
+    return FALSE;
+
+  if ( !(gl=stack_reserve(2*size)) )
+    return FALSE;
+  if ( !(tr=stack_reserve(size)) )
+  { stack_unreserve(gl, 2*size, 0);
+    return FALSE;
+  }
+
+  if ( !stack_commit(gl, 0, iglobal) )
+    goto nomem;
+  r->global = iglobal;
+  if ( !stack_commit(addPointer(gl, size), 0, ilocal) )
+    goto nomem;
+  r->local = ilocal;
+  if ( !stack_commit(tr, 0, itrail) )
+    goto nomem;
+  r->trail = itrail;
+
+  r->reserved = size;
+  gBase = gl;
+  lBase = addPointer(gl, size);
+  tBase = tr;
+
+  return TRUE;
+
+nomem:
+  stack_unreserve(gl, 2*size, r->global+r->local);
+  stack_unreserve(tr, size, r->trail);
+  memset(r, 0, sizeof(*r));
+  return FALSE;
+}
+
+
 static int
 allocStacks(void)
 { GET_LD
@@ -1446,8 +1581,12 @@ allocStacks(void)
   tBase = NULL;
   aBase = NULL;
 
-  gBase = (Word)       stack_malloc(iglobal + ilocal);
-  tBase = (TrailEntry) stack_malloc(itrail);
+  if ( !alloc_reserved_stacks(iglobal, ilocal, itrail PASS_LD) )
+  { gBase = (Word)       stack_malloc(iglobal + ilocal);
+    tBase = (TrailEntry) stack_malloc(itrail);
+    if ( gBase )
+      lBase = (LocalFrame) addPointer(gBase, iglobal);
+  }
   aBase = (Word *)     stack_malloc(minarg);
 
   if ( !gBase || !tBase || !aBase )
@@ -1457,8 +1596,6 @@ allocStacks(void)
     return FALSE;
   }
 
-  lBase   = (LocalFrame) addPointer(gBase, iglobal);
-
   init_stack((Stack)&LD->stacks.global,
 	     "global",   iglobal, 512*SIZEOF_VOIDP, TRUE);
   init_stack((Stack)&LD->stacks.local,
@@ -1476,22 +1613,32 @@ allocStacks(void)
 
 void
 freeStacks(ARG1_LD)
-{ if ( gBase )
+{ stack_reservation *r = &LD->stacks.reserve;
+
+  if ( gBase )
   { gBase--;
-    stack_free(gBase);
+    if ( r->reserved )
+      stack_unreserve(gBase, 2*r->reserved, r->global+r->local);
+    else
+      stack_free(gBase);
     gTop = NULL; gBase = NULL;
     lTop = NULL; lBase = NULL;
   }
   if ( tBase )
-  { stack_free(tBase);
+  { if ( r->reserved )
+      stack_unreserve(tBase, r->reserved, r->trail);
+    else
+      stack_free(tBase);
     tTop = NULL;
     tBase = NULL;
   }
+  r->reserved = 0;
   if ( aBase )
   { stack_free(aBase);
     aTop = NULL;
     aBase = NULL;
   }
+  freeLargeIndirects(PASS_LD1);
 }
 
 
@@ -1616,6 +1763,8 @@ freePrologLocalData(PL_local_data_t *ld)
 #endif
 
   freeArithLocalData(ld);
+  freeContinuationLocalData(ld);
+  freeGlobLocalData(ld);
 #ifdef O_PLMT
   if ( ld->prolog_flag.table )
   { PL_LOCK(L_PLFLAG);
@@ -1626,8 +1775,11 @@ freePrologLocalData(PL_local_data_t *ld)
 
   if ( ld->qlf.getstr_buffer )
     free(ld->qlf.getstr_buffer);
+  if ( ld->read_vars.buckets )
+    PL_free(ld->read_vars.buckets);
   if ( ld->tabling.node_pool )
     free_alloc_pool(ld->tabling.node_pool);
+  discard_arena_cache(&ld->arena);
 
   clearThreadTablingData(ld);
 }
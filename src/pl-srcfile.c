@@ -403,7 +403,8 @@ delAllModulesSourceFile__unlocked(SourceFile sf)
     { PL_LOCK(L_MODULE);
       m->file = NULL;
       m->line_no = 0;
-      clearHTable(m->public);
+      if ( m->public )
+	clearHTable(m->public);
       PL_UNLOCK(L_MODULE);
     }
 
@@ -665,6 +666,13 @@ unloadFile(SourceFile sf)
   size_t deleted = 0;
   int rc;
 
+  for(cell = sf->procedures; cell; cell = cell->next)
+  { Procedure proc = cell->value;
+
+    if ( proc->definition->codes == SUPERVISOR(lazy) )
+      discardLazyDefinition(proc->definition);
+  }
+
   delayEvents();
   LOCKSRCFILE(sf);
 				      /* remove the clauses */
@@ -738,7 +746,8 @@ PRED_IMPL("$unload_file", 1, unload_file, 0)
       m->file = NULL;
       m->line_no = 0;
       delModuleSourceFile(sf, m);
-      clearHTable(m->public);
+      if ( m->public )
+	clearHTable(m->public);
       setSuperModule(m, MODULE_user);
       UNLOCKMODULE(m);
     }
@@ -767,13 +776,19 @@ static int
 startReconsultFile(SourceFile sf)
 { GET_LD
   sf_reload *r;
+  ListCell cell;
 
   DEBUG(MSG_RECONSULT, Sdprintf("Reconsult %s ...\n", sourceFileName(sf)));
 
-  if ( (r = allocHeap(sizeof(*sf->reload))) )
-  { ListCell cell;
+  for(cell = sf->procedures; cell; cell = cell->next)
+  { Procedure proc = cell->value;
+
+    if ( !loadedDefinition(proc->definition) )
+      return FALSE;
+  }
 
-    memset(r, 0, sizeof(*r));
+  if ( (r = allocHeap(sizeof(*sf->reload))) )
+  { memset(r, 0, sizeof(*r));
     r->procedures        = newHTable(16);
     r->reload_gen        = GEN_RELOAD;
     r->pred_access_count = popNPredicateAccess(0);
@@ -826,18 +841,156 @@ find_clause(ClauseRef cref, gen_t generation)
 }
 
 
+static int
+equal_clause(Clause cl1, Clause cl2)
+{ if ( cl1->code_size == cl2->code_size )
+  { size_t bytes = (size_t)cl1->code_size * sizeof(code);
+
+    return memcmp(cl1->codes, cl2->codes, bytes) == 0;
+  }
+
+  return FALSE;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+If a reloaded clause differs from the  current   clause,  we need to find
+the next clause that is equal to it.  For large predicates with several
+modified clauses, the linear  scan  makes   reloading  quadratic.  We
+therefore create a hash table on the  compiled code of the remaining old
+clauses the first time a large predicate is  modified. Each entry holds
+the ordinal number of the clause, such that we only find clauses after
+the current clause, i.e., the result is the same as for the linear scan.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define RELOAD_INDEX_MIN_CLAUSES 32	/* Smaller: linear scan */
+
+typedef struct reload_entry
+{ ClauseRef	cref;			/* Old clause */
+  size_t	ordinal;		/* Position from index start */
+  unsigned int	hash;			/* Hash of the code */
+} reload_entry;
+
+typedef struct reload_index
+{ size_t	size;			/* Number of entries (power of 2) */
+  size_t	current;		/* Ordinal of r->current_clause */
+  reload_entry	entries[1];		/* The table */
+} reload_index;
+
+static inline unsigned int
+clause_code_hash(Clause clause)
+{ return MurmurHashAligned2(clause->codes,
+			    (size_t)clause->code_size * sizeof(code),
+			    MURMUR_SEED);
+}
+
+
+static reload_index *
+build_reload_index(p_reload *r ARG_LD)
+{ Definition def = r->predicate;
+  reload_index *index;
+  ClauseRef cref;
+  size_t count = 0, size = 4, ordinal = 0;
+
+  acquire_def(def);
+  for(cref = r->current_clause; cref; cref = cref->next)
+  { if ( GLOBALLY_VISIBLE_CLAUSE(cref->value.clause, r->generation) )
+      count++;
+  }
+  while(size < count*2)
+    size *= 2;
+
+  if ( !(index = allocHeap(offsetof(reload_index, entries) +
+			   size*sizeof(reload_entry))) )
+  { release_def(def);
+    return NULL;
+  }
+  memset(index->entries, 0, size*sizeof(reload_entry));
+  index->size    = size;
+  index->current = 0;
+
+  for(cref = r->current_clause; cref; cref = cref->next)
+  { Clause cl = cref->value.clause;
+
+    if ( GLOBALLY_VISIBLE_CLAUSE(cl, r->generation) )
+    { unsigned int hash = clause_code_hash(cl);
+      size_t i = hash & (size-1);
+
+      while ( index->entries[i].cref )
+	i = (i+1) & (size-1);
+      index->entries[i].cref    = cref;
+      index->entries[i].ordinal = ordinal++;
+      index->entries[i].hash    = hash;
+    }
+  }
+  release_def(def);
+
+  return index;
+}
+
+
+static void
+free_reload_index(p_reload *r)
+{ reload_index *index;
+
+  if ( (index = r->index) )
+  { r->index = NULL;
+    freeHeap(index, offsetof(reload_index, entries) +
+		    index->size*sizeof(reload_entry));
+  }
+}
+
+
+/* find_equal_clause() finds the first old clause after the current
+ * clause that is equal to clause.  Returns the clause reference and sets
+ * *ordinal or returns NULL.
+ */
+
+static ClauseRef
+find_equal_clause(SourceFile sf, p_reload *r, Clause clause, size_t *ordinal)
+{ reload_index *index = r->index;
+  unsigned int hash = clause_code_hash(clause);
+  size_t i = hash & (index->size-1);
+  ClauseRef found = NULL;
+
+  for(; index->entries[i].cref; i = (i+1) & (index->size-1))
+  { reload_entry *e = &index->entries[i];
+    Clause c2;
+
+    if ( e->hash != hash ||
+	 e->ordinal <= index->current ||
+	 (found && e->ordinal >= *ordinal) )
+      continue;
+    c2 = e->cref->value.clause;
+    if ( true(r->predicate, P_MULTIFILE) && c2->owner_no != sf->index )
+      continue;
+    if ( equal_clause(c2, clause) )
+    { found = e->cref;
+      *ordinal = e->ordinal;
+    }
+  }
+
+  return found;
+}
+
+
 static void
 advance_clause(p_reload *r ARG_LD)
 { ClauseRef cref;
 
   if ( (cref = r->current_clause) )
-  { acquire_def(r->predicate);
-    for(cref = cref->next; cref; cref = cref->next)
+  { ClauseRef prev = cref;
+
+    acquire_def(r->predicate);
+    for(cref = cref->next; cref; prev = cref, cref = cref->next)
     { if ( GLOBALLY_VISIBLE_CLAUSE(cref->value.clause, r->generation) )
 	break;
     }
     release_def(r->predicate);
+    r->previous_clause = prev;
     r->current_clause = cref;
+    if ( r->index )
+      r->index->current++;
   }
 }
 
@@ -864,16 +1017,6 @@ keep_clause(p_reload *r, Clause clause ARG_LD)
 }
 
 
-static int
-equal_clause(Clause cl1, Clause cl2)
-{ if ( cl1->code_size == cl2->code_size )
-  { size_t bytes = (size_t)cl1->code_size * sizeof(code);
-
-    return memcmp(cl1->codes, cl2->codes, bytes) == 0;
-  }
-
-  return FALSE;
-}
 
 
 int
@@ -980,6 +1123,25 @@ assertProcedureSource(SourceFile sf, Procedure proc, Clause clause ARG_LD)
 
       set(reload, P_MODIFIED);
 
+      if ( !reload->index &&
+	   def->impl.clauses.number_of_clauses >= RELOAD_INDEX_MIN_CLAUSES )
+	reload->index = build_reload_index(reload PASS_LD);
+
+      if ( reload->index )
+      { size_t ordinal = 0;
+
+	if ( (cref2 = find_equal_clause(sf, reload, clause, &ordinal)) )
+	{ reload->current_clause = cref2;
+	  reload->previous_clause = NULL;
+	  reload->index->current = ordinal;
+	  DEBUG(MSG_RECONSULT_CLAUSE,
+		Sdprintf("  Keeping clause %d\n",
+			 clauseNo(cref2->value.clause, reload->generation)));
+	  return keep_clause(reload, clause PASS_LD);
+	}
+	goto insert;
+      }
+
       acquire_def(def);
       for(cref2 = cref->next; cref2; cref2 = cref2->next)
       { Clause c2 = cref2->value.clause;
@@ -1008,6 +1170,7 @@ assertProcedureSource(SourceFile sf, Procedure proc, Clause clause ARG_LD)
 	  release_def(def);
 
 	  reload->current_clause = cref2;
+	  reload->previous_clause = NULL;
 	  DEBUG(MSG_RECONSULT_CLAUSE,
 		Sdprintf("  Keeping clause %d\n",
 			 clauseNo(cref2->value.clause, reload->generation)));
@@ -1016,11 +1179,15 @@ assertProcedureSource(SourceFile sf, Procedure proc, Clause clause ARG_LD)
       }
       release_def(def);
 
+    insert:
       DEBUG(MSG_RECONSULT_CLAUSE,
 	    Sdprintf("  Inserted before clause %d\n",
 		     clauseNo(cref->value.clause, reload->generation)));
-      if ( (cref2 = assertProcedure(proc, clause, cref PASS_LD)) )
-	cref2->value.clause->generation.created = sf->reload->reload_gen;
+      if ( (cref2 = assertProcedureBefore(proc, clause, cref,
+					  reload->previous_clause PASS_LD)) )
+      { cref2->value.clause->generation.created = sf->reload->reload_gen;
+	reload->previous_clause = cref2;
+      }
 
       return cref2;
     } else
@@ -1226,6 +1393,9 @@ static void
 fix_module(Module m, m_reload *r)
 { GET_LD
 
+  if ( !m->public )
+    return;
+
   LOCKMODULE(m);
   for_table(m->public, n, v,
 	    { if ( !r->public ||
@@ -1355,6 +1525,7 @@ end_reconsult_proc(SourceFile sf, Procedure proc, p_reload *r ARG_LD)
   }
   if ( r->args )
     freeHeap(r->args, 0);
+  free_reload_index(r);
   freeHeap(r, sizeof(*r));
 
   return dropped_access;
@@ -1472,7 +1643,18 @@ There are two options.
 
 int
 startConsult(SourceFile f)
-{ if ( f->count++ > 0 )			/* This is a re-consult */
+{ GET_LD
+
+  if ( f->count > 0 && LD->transaction.generation )
+  { term_t file;
+
+    return ( (file=PL_new_term_ref()) &&
+	     PL_put_atom(file, f->name) &&
+	     PL_error(NULL, 0, "inside a transaction",
+		      ERR_PERMISSION, ATOM_reload, ATOM_file, file) );
+  }
+
+  if ( f->count++ > 0 )			/* This is a re-consult */
   { if ( !startReconsultFile(f) )
       return FALSE;
   }
@@ -1499,9 +1681,8 @@ PRED_IMPL("$start_consult", 2, start_consult, 0)
   { SourceFile f = lookupSourceFile(name, TRUE);
 
     f->mtime = time;
-    startConsult(f);
 
-    return TRUE;
+    return startConsult(f);
   }
 
   return FALSE;
@@ -1578,7 +1759,7 @@ PRED_IMPL("$clause_from_source", 4, clause_from_source, 0)
   { Procedure proc = cell->value;
     Definition def = proc->definition;
 
-    if ( def && false(def, P_FOREIGN) )
+    if ( def && false(def, P_FOREIGN) && loadedDefinition(def) )
     { ClauseRef cref;
 
       acquire_def(def);
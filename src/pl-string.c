@@ -167,6 +167,44 @@ PRED_IMPL("text_to_string", 2, text_to_string, 0)
 }
 
 
+/** intern_string(+Text, -String)
+
+String is the interned string holding  Text.   All  interned strings of
+the same text in a thread share their  data, so comparison reduces to a
+pointer comparison and the clause index key is computed only once.
+*/
+
+static
+PRED_IMPL("intern_string", 2, intern_string, 0)
+{ PRED_LD
+  term_t tmp = PL_new_term_ref();
+  Word p;
+  word w;
+
+  if ( !PL_is_string(A1) )
+  { PL_chars_t t;
+    int rc;
+
+    if ( !PL_get_text(A1, &t, CVT_ATOM|CVT_LIST|CVT_NUMBER|CVT_EXCEPTION) )
+      return FALSE;
+    rc = PL_unify_text(tmp, 0, &t, PL_STRING);
+    PL_free_text(&t);
+    if ( !rc )
+      return FALSE;
+  } else
+  { PL_put_term(tmp, A1);
+  }
+
+  p = valTermRef(tmp);
+  deRef(p);
+  if ( !(w = internString(*p PASS_LD)) )
+    return PL_error(NULL, 0, NULL, ERR_NOMEM);
+  *valTermRef(tmp) = w;
+
+  return PL_unify(A2, tmp);
+}
+
+
 /** string_code(?Index, +String, ?Code)
 
 True when the Index'ed character of String has code Code.
@@ -275,6 +313,42 @@ PRED_IMPL("get_string_code", 3, get_string_code, 0)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A char_set allows for fast  membership   tests  of  the characters of a
+text. Characters up to 0xff are  kept  in   a  bitmap,  others  use
+text_chr(). As text_chr(), the set always contains the NUL character.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct char_set
+{ uint32_t	    bits[8];		/* characters 0..0xff */
+  const PL_chars_t *wide;		/* text if it may hold more */
+} char_set;
+
+static void
+init_char_set(char_set *cs, const PL_chars_t *text)
+{ size_t i;
+
+  memset(cs->bits, 0, sizeof(cs->bits));
+  cs->bits[0] = 0x1;
+  cs->wide = (text->encoding == ENC_ISO_LATIN_1 ? NULL : text);
+
+  for(i=0; i<text->length; i++)
+  { int c = text_get_char(text, i);
+
+    if ( c <= 0xff )
+      cs->bits[c>>5] |= (uint32_t)1<<(c&0x1f);
+  }
+}
+
+static inline int
+in_char_set(const char_set *cs, int c)
+{ if ( c <= 0xff )
+    return (cs->bits[c>>5]>>(c&0x1f))&0x1;
+
+  return cs->wide && text_chr(cs->wide, c) != (size_t)-1;
+}
+
+
 /** split_string(+String, +SepChars, +PadChars, -SubStrings) is det.
 */
 
@@ -297,18 +371,22 @@ PRED_IMPL("split_string", 4, split_string, 0)
     term_t head = PL_new_term_ref();
     size_t sep_at = (size_t)-1;
     size_t end;
+    char_set seps, pads;
+
+    init_char_set(&seps, &sep);
+    init_char_set(&pads, &pad);
 
 						/* back skip padding at end */
     for(end=input.length;
 	end > 0 &&
-	text_chr(&pad, text_get_char(&input, end-1)) != (size_t)-1;
+	in_char_set(&pads, text_get_char(&input, end-1));
 	end--)
       ;
 
     for(i=0;;)
     {					/* skip padding */
       while( i<end &&
-	     text_chr(&pad, text_get_char(&input, i)) != (size_t)-1 )
+	     in_char_set(&pads, text_get_char(&input, i)) )
 	i++;
 
       if ( i == end )
@@ -321,11 +399,11 @@ PRED_IMPL("split_string", 4, split_string, 0)
     no_skip_padding:
       last = i;				/* find sep */
       while( i<end &&
-	     text_chr(&sep, text_get_char(&input, i)) == (size_t)-1 )
+	     !in_char_set(&seps, text_get_char(&input, i)) )
 	i++;
       sep_at = i;			/* back skip padding */
       while( i>last &&
-	     text_chr(&pad, text_get_char(&input, i-1)) != (size_t)-1 )
+	     in_char_set(&pads, text_get_char(&input, i-1)) )
 	i--;
 
       if ( !PL_unify_list_ex(tail, head, tail) ||
@@ -337,8 +415,8 @@ PRED_IMPL("split_string", 4, split_string, 0)
 
       i = sep_at+1;
 
-      if ( text_chr(&pad, text_get_char(&input, sep_at)) == (size_t)-1 &&
-	   text_chr(&sep, text_get_char(&input, sep_at+1)) != (size_t)-1 )
+      if ( !in_char_set(&pads, text_get_char(&input, sep_at)) &&
+	   in_char_set(&seps, text_get_char(&input, sep_at+1)) )
 	goto no_skip_padding;
     }
 
@@ -371,6 +449,24 @@ backSkipPadding(const char *in, size_t len, PL_chars_t *pad)
 }
 
 
+/* ascii_stop_set() fills stop with the ASCII characters of text for
+   Sread_ascii()
+*/
+
+static void
+ascii_stop_set(PL_chars_t *text, uint32_t stop[4])
+{ size_t i;
+
+  memset(stop, 0, 4*sizeof(*stop));
+  for(i=0; i<text->length; i++)
+  { int c = text_get_char(text, i);
+
+    if ( c < 0x80 )
+      stop[c>>5] |= (uint32_t)1<<(c&0x1f);
+  }
+}
+
+
 /** read_string(+Stream, +Delimiters, +Padding, -Delimiter, -String)
 */
 
@@ -391,17 +487,23 @@ PRED_IMPL("read_string", 5, read_string, 0)
        PL_get_text(A2, &sep, flags) &&
        PL_get_text(A3, &pad, flags) )
   { int chr;
+    uint32_t stop[4];
+    char chunk[512];
+    size_t n;
 
     do
     { chr = Sgetcode(s);
     } while(chr != EOF && text_chr(&pad, chr) != (size_t)-1);
 
+    ascii_stop_set(&sep, stop);
     for(;;)
     { if ( chr == EOF && Sferror(s) )
 	goto out;
       if ( chr == EOF || text_chr(&sep, chr) != (size_t)-1 )
 	break;
       addUTF8Buffer((Buffer)&tmpbuf, chr);
+      while ( (n=Sread_ascii(s, chunk, sizeof(chunk), stop)) > 0 )
+	addMultipleBuffer((Buffer)&tmpbuf, chunk, n, char);
       chr = Sgetcode(s);
     }
 
@@ -447,11 +549,23 @@ PRED_IMPL("read_string", 3, read_string, 0)
        ( (vlen=PL_is_variable(A2)) ||
 	 PL_get_size_ex(A2, &len)
        ) )
-  { size_t count;
+  { static const uint32_t nostop[4] = {0};
+    char chunk[512];
+    size_t count;
 
     for(count=0; count < len; count++)
-    { int chr = Sgetcode(s);
-      if ( chr == EOF )
+    { size_t n, max = len-count;
+      int chr;
+
+      if ( max > sizeof(chunk) )
+	max = sizeof(chunk);
+      if ( (n=Sread_ascii(s, chunk, max, nostop)) > 0 )
+      { addMultipleBuffer((Buffer)&tmpbuf, chunk, n, char);
+	count += n-1;
+	continue;
+      }
+
+      if ( (chr = Sgetcode(s)) == EOF )
       { if ( Sferror(s) )
 	  goto out;
 	break;
@@ -478,6 +592,167 @@ out:
   return rc;
 }
 
+/** '$read_line_to_codes'(+Stream, -Codes) is det.
+ *  '$read_line_to_codes'(+Stream, -Codes, ?Tail) is det.
+ *
+ * C implementation of read_line_to_codes/2,3 from library(readutil).
+ * The /2 version deletes \r and the trailing newline and returns
+ * `end_of_file` at the end of the input.  The /3 version keeps the
+ * newline and unifies Tail with [] at the end of the input.
+ */
+
+static int
+read_line_to_codes(term_t stream, term_t codes, term_t tail ARG_LD)
+{ IOSTREAM *s = NULL;
+  int keep_nl = (tail != 0);
+  tmp_buffer tmpbuf;
+  int rc = FALSE;
+
+  initBuffer(&tmpbuf);
+  if ( getTextInputStream(stream, &s) )
+  { uint32_t stop[4] = {0};
+    char chunk[512];
+    size_t n;
+    int chr;
+
+    stop[0] = (uint32_t)1<<'\n'|(uint32_t)1<<'\r';
+    for(;;)
+    { while ( (n=Sread_ascii(s, chunk, sizeof(chunk), stop)) > 0 )
+	addMultipleBuffer((Buffer)&tmpbuf, chunk, n, char);
+
+      if ( (chr = Sgetcode(s)) == EOF )
+      { if ( Sferror(s) )
+	  goto out;
+	break;
+      }
+      if ( chr == '\r' && !keep_nl )
+	continue;
+      if ( chr == '\n' && !keep_nl )
+	break;
+      addUTF8Buffer((Buffer)&tmpbuf, chr);
+      if ( chr == '\n' )
+	break;
+    }
+
+    if ( keep_nl )
+    { term_t dl = PL_new_term_refs(2);
+
+      rc = ( dl &&
+	     PL_unify_chars(dl, PL_CODE_LIST|PL_DIFF_LIST|REP_UTF8,
+			    entriesBuffer(&tmpbuf, char),
+			    baseBuffer(&tmpbuf, char)) &&
+	     PL_unify(codes, dl) &&
+	     PL_unify(tail, dl+1) &&
+	     (chr != EOF || PL_unify_nil(tail)) );
+    } else if ( chr == EOF && entriesBuffer(&tmpbuf, char) == 0 )
+    { rc = PL_unify_atom(codes, ATOM_end_of_file);
+    } else
+    { rc = PL_unify_chars(codes, PL_CODE_LIST|REP_UTF8,
+			  entriesBuffer(&tmpbuf, char),
+			  baseBuffer(&tmpbuf, char));
+    }
+  }
+
+out:
+  discardBuffer(&tmpbuf);
+  if ( s )
+  { if ( rc )
+      rc = PL_release_stream(s);
+    else
+      PL_release_stream(s);
+  }
+
+  return rc;
+}
+
+
+static
+PRED_IMPL("$read_line_to_codes", 2, read_line_to_codes, 0)
+{ PRED_LD
+
+  return read_line_to_codes(A1, A2, 0 PASS_LD);
+}
+
+
+static
+PRED_IMPL("$read_line_to_codes", 3, read_line_to_codes, 0)
+{ PRED_LD
+
+  return read_line_to_codes(A1, A2, A3 PASS_LD);
+}
+
+
+/** '$write_lines'(+Stream, +Lines) is det.
+ *
+ * Write each element of Lines, which is  a   list  of  text, followed by a
+ * newline. Runs of printable ASCII are  copied   to  the stream buffer as
+ * a block.
+ */
+
+static int
+put_text(PL_chars_t *text, IOSTREAM *s)
+{ size_t i = 0;
+
+  if ( text->encoding == ENC_ISO_LATIN_1 )
+  { const char *q = text->text.t;
+
+    while( i < text->length )
+    { size_t n = Swrite_ascii(s, q+i, text->length-i);
+
+      if ( n > 0 )
+      { i += n;
+      } else
+      { if ( Sputcode(q[i]&0xff, s) == EOF )
+	  return FALSE;
+	i++;
+      }
+    }
+  } else
+  { for(; i < text->length; i++)
+    { if ( Sputcode(text->text.w[i], s) == EOF )
+	return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+
+static
+PRED_IMPL("$write_lines", 2, write_lines, 0)
+{ PRED_LD
+  IOSTREAM *s;
+  int rc = TRUE;
+
+  if ( getTextOutputStream(A1, &s) )
+  { term_t tail = PL_copy_term_ref(A2);
+    term_t head = PL_new_term_ref();
+    int flags = CVT_ATOM|CVT_STRING|CVT_LIST|CVT_EXCEPTION;
+
+    while( rc && PL_get_list(tail, head, tail) )
+    { PL_chars_t text;
+
+      if ( (rc=PL_get_text(head, &text, flags)) )
+      { if ( !put_text(&text, s) || Sputcode('\n', s) == EOF )
+	  rc = FALSE;
+	PL_free_text(&text);
+      }
+    }
+    if ( rc )
+      rc = PL_get_nil_ex(tail);
+
+    if ( rc )
+      rc = PL_release_stream(s);
+    else
+      PL_release_stream(s);
+
+    return rc;
+  }
+
+  return FALSE;
+}
+
+
 /** open_string(+String, -Stream)
  *
  * Open a string as a stream.
@@ -523,9 +798,13 @@ BeginPredDefs(strings)
   PRED_DEF("string_codes",    2, string_codes,	  0)
   PRED_DEF("string_chars",    2, string_chars,	  0)
   PRED_DEF("text_to_string",  2, text_to_string,  0)
+  PRED_DEF("intern_string",   2, intern_string,   0)
   PRED_DEF("string_code",     3, string_code,	  PL_FA_NONDETERMINISTIC)
   PRED_DEF("get_string_code", 3, get_string_code, 0)
   PRED_DEF("read_string",     5, read_string,     0)
   PRED_DEF("read_string",     3, read_string,     0)
   PRED_DEF("open_string",     2, open_string,     0)
+  PRED_DEF("$read_line_to_codes", 2, read_line_to_codes, 0)
+  PRED_DEF("$read_line_to_codes", 3, read_line_to_codes, 0)
+  PRED_DEF("$write_lines",    2, write_lines,     0)
 EndPredDefs
@@ -39,8 +39,6 @@
 #include "pl-inline.h"
 #include "pl-wrap.h"
 
-#define MAX_FLI_ARGS 10			/* extend switches on change */
-
 Code
 allocCodes(size_t n)
 { Code codes = allocHeapOrHalt(sizeof(code)*(n+1));
@@ -82,7 +80,7 @@ freeSupervisor(Definition def, Code codes, int do_linger)
 
   if ( size > 0 )		/* 0: built-in, see initSupervisors() */
   { if ( do_linger )
-      linger(&def->lingering, free_codes_ptr, codes);
+      linger(&def->lingering, free_codes_ptr, codes, (size+1)*sizeof(code));
     else
       freeHeap(&codes[-1], (size+1)*sizeof(code));
   }
@@ -93,7 +91,8 @@ void
 freeCodesDefinition(Definition def, int do_linger)
 { Code codes;
 
-  if ( (codes=def->codes) != SUPERVISOR(virgin) )
+  if ( (codes=def->codes) != SUPERVISOR(virgin) &&
+       codes != SUPERVISOR(lazy) )	/* see loadLazyDefinition() */
   { if ( (codes = def->codes) )
     { if ( unlikely(codes[0] == encode(S_CALLWRAPPER)) )
       { resetWrappedSupervisor(def);
@@ -112,6 +111,10 @@ Foreign supervisors.  Creates one of:
 
 DET code:  I_FOPEN,     I_FCALLDETVA|I_FCALLDET<N>,   I_FEXITDET
 NDET code: I_FOPENNDET, I_FCALLNDETVA|I_FCALLNDET<N>, I_FEXITNDET, I_FREDO
+
+Typed foreign predicates (see PL_register_typed_foreign_in_module()) use
+a single instruction I_FCALLTYPED <function> <signature> that unboxes the
+arguments, calls the function and exits the frame.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 #ifdef O_PROF_PENTIUM
@@ -166,6 +169,28 @@ createForeignSupervisor(Definition def, Func f)
 }
 
 
+int
+createTypedForeignSupervisor(Definition def, Func f, code signature)
+{ Code codes = allocCodes(3);
+
+  assert(true(def, P_FOREIGN) && false(def, P_NONDET|P_VARARG));
+  assert(def->functor->arity <= MAX_FLI_ARGS);
+
+  codes[0] = encode(I_FCALLTYPED);
+  codes[1] = (code)f;
+  codes[2] = signature;
+  def->codes = codes;
+
+#ifdef O_PROF_PENTIUM
+  assert(prof_foreign_index < MAXPROF);
+  def->prof_index = prof_foreign_index++;
+  def->prof_name  = strdup(predicateName(def));
+#endif
+
+  succeed;
+}
+
+
 		 /*******************************
 		 *	   PROLOG CASES		*
 		 *******************************/
@@ -281,6 +306,76 @@ listSupervisor(Definition def)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+switchSupervisor() creates a supervisor  for   static  predicates with a
+small number of clauses, each with a  distinct   atom  as first argument.
+This is typical for state machines and  opcode tables. The code is
+
+	S_SWITCH <n> <atom1> <clause1> ... <atomN> <clauseN>
+
+where the pairs are sorted on the  atom handle to allow for binary search
+by the VM.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define MAX_SWITCH_CLAUSES 32
+
+typedef struct switch_entry
+{ word		key;
+  ClauseRef	cref;
+} switch_entry;
+
+static int
+cmp_switch_entry(const void *p1, const void *p2)
+{ const switch_entry *e1 = p1;
+  const switch_entry *e2 = p2;
+
+  return e1->key < e2->key ? -1 : e1->key > e2->key ? 1 : 0;
+}
+
+
+static Code
+switchSupervisor(Definition def)
+{ size_t nc = def->impl.clauses.number_of_clauses;
+
+  if ( nc >= 2 && nc <= MAX_SWITCH_CLAUSES )
+  { ClauseRef cref[MAX_SWITCH_CLAUSES];
+    switch_entry table[MAX_SWITCH_CLAUSES];
+    int found = getClauses(def, cref, MAX_SWITCH_CLAUSES);
+    int i;
+    Code codes;
+
+    if ( found < 2 || found > MAX_SWITCH_CLAUSES )
+      return NULL;
+
+    for(i=0; i<found; i++)
+    { if ( !arg1Key(cref[i]->value.clause->codes, &table[i].key) ||
+	   !isAtom(table[i].key) )
+	return NULL;
+      table[i].cref = cref[i];
+    }
+    qsort(table, found, sizeof(*table), cmp_switch_entry);
+    for(i=1; i<found; i++)
+    { if ( table[i].key == table[i-1].key )
+	return NULL;
+    }
+
+    DEBUG(1, Sdprintf("Switch supervisor for %s\n", predicateName(def)));
+
+    codes = allocCodes(found*2+2);
+    codes[0] = encode(S_SWITCH);
+    codes[1] = (code)found;
+    for(i=0; i<found; i++)
+    { codes[i*2+2] = (code)table[i].key;
+      codes[i*2+3] = (code)table[i].cref;
+    }
+
+    return codes;
+  }
+
+  return NULL;
+}
+
+
 static Code
 dynamicSupervisor(Definition def)
 { if ( true(def, P_DYNAMIC) )
@@ -395,6 +490,7 @@ createSupervisor(Definition def)
 	       (codes = multifileSupervisor(def)) ||
 	       (codes = singleClauseSupervisor(def)) ||
 	       (codes = listSupervisor(def)) ||
+	       (codes = switchSupervisor(def)) ||
 	       (codes = staticSupervisor(def)));
   assert(has_codes);
   codes = chainMetaPredicateSupervisor(def, codes);
@@ -487,4 +583,5 @@ initSupervisors(void)
   MAKE_SV1(staticp,      S_STATIC);
   MAKE_SV1(wrapper,      S_WRAP);
   MAKE_SV1(trie_gen,     S_TRIE_GEN);
+  MAKE_SV1(lazy,         S_LAZY);
 }
@@ -41,6 +41,7 @@
 #include "pl-wrap.h"
 #include "pl-event.h"
 #include "pl-allocpool.h"
+#include "pl-tracepoint.h"
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 We provide two answer completion strategies:
@@ -161,6 +162,8 @@ static int	tbl_pred_tripwire(Definition def, atom_t action, atom_t wire);
 #ifdef O_PLMT
 #define	LOCK_SHARED_TABLE(t)	countingMutexLock(&GD->tabling.mutex);
 #define	UNLOCK_SHARED_TABLE(t)	countingMutexUnlock(&GD->tabling.mutex);
+#define TABLE_CVAR(t) \
+	(&GD->tabling.cvar[((uintptr_t)(t)>>5)&(TABLE_WAIT_CVARS-1)])
 
 static inline void
 drop_trie(trie *atrie)
@@ -196,11 +199,14 @@ take_trie(trie *atrie, int tid)
 	  } \
 	  __code; \
 	  drop_trie(__trie); \
-	  cv_broadcast(&GD->tabling.cvar); \
+	  cv_broadcast(TABLE_CVAR(__trie)); \
 	  UNLOCK_SHARED_TABLE(__trie); \
 	} while(0)
 
 static int	wait_for_table_to_complete(trie *atrie);
+static void	notify_streaming_consumers(trie *atrie);
+static int	wait_for_table_answers(trie *atrie, size_t count,
+				       atom_t *status);
 static int	table_needs_work(trie *atrie);
 static void	register_waiting(int tid, trie *atrie);
 static void	unregister_waiting(int tid, trie *atrie);
@@ -2224,6 +2230,82 @@ release_answer_node(trie *atrie, trie_node *node)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+LRU eviction of private tables.  If the  Prolog flag table_space_eviction
+is `true`, creating a new private  table   while  the tables use more
+than TABLE_EVICT_HIGH of the table_space  limit   destroys  the least
+recently used tables until the usage drops below TABLE_EVICT_LOW.  Only
+tables that are complete, not  incremental  (have   no  IDG  node), not
+being enumerated and have no worklist left (no delayed answers) may be
+evicted.  The last access is recorded in `data.accessed` each time the
+table is looked up by '$tbl_variant_table'/5 and friends.
+
+We evict at table creation only, as this is  a safe point: we are not
+in the middle of filling an answer trie.  The node for the new variant
+has no value yet, so it is not a candidate and pruning the evicted nodes
+does not remove it.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define TABLE_EVICT_HIGH(limit) ((limit)/8*7)
+#define TABLE_EVICT_LOW(limit)  ((limit)/4*3)
+
+typedef struct evict_candidate
+{ uint64_t  accessed;
+  trie	   *atrie;
+} evict_candidate;
+
+static void *
+add_evict_candidate(trie_node *n, void *ctx)
+{ TmpBuffer b = ctx;
+
+  if ( n->value )
+  { trie *atrie = symbol_trie(n->value);
+
+    if ( true(atrie, TRIE_COMPLETE) &&
+	 !atrie->data.IDG &&
+	 !atrie->references &&
+	 !WL_IS_WORKLIST(atrie->data.worklist) &&
+	 false(atrie, TRIE_ISSHARED) )
+    { evict_candidate c = { atrie->data.accessed, atrie };
+
+      addBuffer(b, c, evict_candidate);
+    }
+  }
+
+  return NULL;
+}
+
+static int
+compare_evict_candidate(const void *p1, const void *p2)
+{ const evict_candidate *c1 = p1;
+  const evict_candidate *c2 = p2;
+
+  return c1->accessed < c2->accessed ? -1 :
+	 c1->accessed > c2->accessed ?  1 : 0;
+}
+
+static void
+evict_tables(trie *variants, alloc_pool *pool)
+{ if ( pool && pool->size > TABLE_EVICT_HIGH(pool->limit) )
+  { tmp_buffer b;
+    evict_candidate *c, *e;
+
+    initBuffer(&b);
+    map_trie_node(&variants->root, add_evict_candidate, &b);
+    c = baseBuffer(&b, evict_candidate);
+    e = topBuffer(&b, evict_candidate);
+    qsort(c, e-c, sizeof(*c), compare_evict_candidate);
+
+    for(; c < e && pool->size > TABLE_EVICT_LOW(pool->limit); c++)
+    { DEBUG(MSG_TABLING_ABOLISH,
+	    print_answer_table(c->atrie, "Evicting"));
+      trie_delete(variants, c->atrie->data.variant, TRUE);
+    }
+    discardBuffer(&b);
+  }
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 get_answer_table(+Variant, -Return, int flags)
 
@@ -2336,6 +2418,8 @@ retry:
       alloc_pool *pool = LD->tabling.node_pool;
 #endif
 
+      if ( !shared && truePrologFlag(PLFLAG_TABLE_SPACE_EVICTION) )
+	evict_tables(variants, pool);
       if ( !(atrie = trie_create(pool)) )
 	return NULL;
       set(atrie, (flags&AT_MODED) ? TRIE_ISMAP : TRIE_ISSET);
@@ -2371,6 +2455,7 @@ retry:
       return NULL;
     }
 #endif
+    atrie->data.accessed = ++LD->tabling.access_tick;
 
     if ( ret )
     { if ( isEmptyBuffer(&vars) )		/* TBD: only needed first time */
@@ -2436,15 +2521,9 @@ indexOfWord(word w ARG_LD)
       /*FALLTHROUGH*/
       case TAG_STRING:
       case TAG_FLOAT:
-      { Word p = addressIndirect(w);
-	size_t n = wsizeofInd(*p);
-	word k;
-
-	k = MurmurHashAligned2(p+1, n*sizeof(*p), MURMUR_SEED);
-	k &= ~((word)STG_GLOBAL);	/* avoid confusion with functor_t */
-	if ( !k ) k = 1;		/* avoid no-key */
-	return k;
-      }
+	if ( isLargeIndirect(w) )
+	  return largeIndirectKey(w PASS_LD);
+	return indirectIndexKey(addressIndirect(w));
       case TAG_COMPOUND:
 	w = *valPtr(w);			/* functor_t */
 	break;
@@ -2753,6 +2832,9 @@ new_worklist(trie *trie)
     wl->ground = TRUE;
   initBuffer(&wl->delays);
   initBuffer(&wl->pos_undefined);
+#ifdef O_TRIE_STATS
+  wl->created = WallTime();
+#endif
   trie->data.worklist = wl;
 
   return wl;
@@ -2949,6 +3031,10 @@ wkl_add_answer(worklist *wl, trie_node *an ARG_LD)
   DEBUG(MSG_TABLING_WORK,
 	{ print_worklist("Added answer: ", wl);
 	});
+#ifdef O_PLMT
+  if ( wl->table->data.streaming )
+    notify_streaming_consumers(wl->table);
+#endif
 
   return TRUE;
 }
@@ -2957,7 +3043,8 @@ wkl_add_answer(worklist *wl, trie_node *an ARG_LD)
 static int
 wkl_add_suspension(worklist *wl, term_t suspension, int is_tnot,
 		   term_t inst ARG_LD)
-{ potentially_add_to_global_worklist(wl PASS_LD);
+{ TRIE_STAT_INC(wl->table, suspensions);
+  potentially_add_to_global_worklist(wl PASS_LD);
   if ( wl->tail && wl->tail->type == CLUSTER_SUSPENSIONS )
   { if ( !add_to_suspension_cluster(wl->tail, suspension, is_tnot, inst PASS_LD) )
       return FALSE;
@@ -3252,7 +3339,7 @@ PRED_IMPL("$tbl_destroy_table", 1, tbl_destroy_table, 0)
 	  { if ( !delayed_destroy_table(atrie) )
 	    { reset_answer_table(atrie, FALSE);
 	      drop_trie(atrie);
-	      cv_broadcast(&GD->tabling.cvar);
+	      cv_broadcast(TABLE_CVAR(atrie));
 	    }
 	  } else
 	  { set(atrie, TRIE_ABOLISH_ON_COMPLETE);
@@ -3378,7 +3465,8 @@ PRED_IMPL("$tbl_wkl_add_answer", 4, tbl_wkl_add_answer, 0)
 	  { clear(node, TN_IDG_DELETED);
 	    goto update_dl;
 	  } else
-	  { if ( answer_is_conditional(node) )
+	  { TRIE_STAT_INC(wl->table, duplicates);
+	    if ( answer_is_conditional(node) )
 	    { if ( update_delay_list(wl, node, A2, A3 PASS_LD) == UDL_COMPLETE )
 		return PL_unify_atom(A4, ATOM_cut);
 	    }
@@ -4323,6 +4411,143 @@ PRED_IMPL("$tbl_existing_variant_table", 5, tbl_existing_variant_table, 0)
 }
 
 
+/** '$tbl_stream_table'(:Goal, -Trie, -Skeleton) is semidet.
+ *
+ * True when Goal is a call to a shared tabled predicate whose table is
+ * being completed by another thread. Trie is the answer table and
+ * Skeleton is the answer template. This does not claim the table. It
+ * fails if the table is moded, complete, fresh, or owned by the calling
+ * thread; the caller should then simply call Goal.
+ */
+
+static
+PRED_IMPL("$tbl_stream_table", 3, tbl_stream_table, PL_FA_TRANSPARENT)
+{
+#ifdef O_PLMT
+  PRED_LD
+  Procedure proc;
+  Definition def;
+  Module m = NULL;
+  term_t head = PL_new_term_ref();
+  term_t wrapper = PL_new_term_ref();
+  trie *atrie;
+  int rc = FALSE;
+
+  if ( !get_procedure(A1, &proc, 0, GP_RESOLVE) ||
+       false((def=proc->definition), P_TSHARED) ||
+       !PL_strip_module(A1, &m, head) ||
+       !PL_unify_term(wrapper, PL_FUNCTOR, FUNCTOR_colon2,
+			         PL_ATOM, def->module->name,
+			         PL_TERM, head) )
+    return FALSE;
+
+  if ( (atrie=get_answer_table(def, wrapper, A3, NULL,
+			       AT_SHARED|AT_NOCLAIM PASS_LD)) &&
+       false(atrie, TRIE_ISMAP) )
+  { LOCK_SHARED_TABLE(atrie);
+    rc = ( atrie->tid && atrie->tid != PL_thread_self() );
+    UNLOCK_SHARED_TABLE(atrie);
+  }
+
+  return rc && _PL_unify_atomic(A2, atrie->symbol);
+#else
+  return FALSE;
+#endif
+}
+
+
+/** '$tbl_wait_answers'(+Trie, +Count0, -Count, -Status) is det.
+ *
+ * Wait until the shared answer table Trie has more than Count0 answers
+ * or is no longer being completed by another thread.  Count is the
+ * number of answers when we stop waiting.  Status is one of `complete`,
+ * `incomplete` (there are new answers) or `invalid` (the table was
+ * abandoned and must be re-evaluated).
+ */
+
+static
+PRED_IMPL("$tbl_wait_answers", 4, tbl_wait_answers, 0)
+{ PRED_LD
+  trie *atrie;
+  size_t count;
+  atom_t status = ATOM_complete;
+
+  if ( !get_trie(A1, &atrie) ||
+       !PL_get_size_ex(A2, &count) )
+    return FALSE;
+
+#ifdef O_PLMT
+  if ( true(atrie, TRIE_ISSHARED) &&
+       !wait_for_table_answers(atrie, count, &status) )
+    return FALSE;
+#endif
+
+  return ( PL_unify_int64(A3, atrie->value_count) &&
+	   PL_unify_atom(A4, status) );
+}
+
+
+/** '$tbl_subsuming_table'(+Variant, -Trie) is semidet.
+ *
+ * True when Trie is the answer table of a call that subsumes Variant.
+ * This is used for subsumptive tabling.  The lookup is indexed: only
+ * branches of the variant tables that may hold a generalization of
+ * Variant are visited.  Completed tables are preferred.  If there is
+ * no completed table, Trie is the first incomplete one.
+ */
+
+typedef struct subsuming_ctx
+{ trie_node *first;			/* first subsuming table */
+  trie_node *complete;			/* completed subsuming table */
+} subsuming_ctx;
+
+static int
+is_valid_complete_table(trie *atrie)
+{ idg_node *n;
+
+  if ( false(atrie, TRIE_COMPLETE) )
+    return FALSE;
+  if ( (n=atrie->data.IDG) && (n->falsecount > 0 || n->reevaluating) )
+    return FALSE;
+
+  return TRUE;
+}
+
+static int
+subsuming_table(trie_node *n, void *ctx)
+{ subsuming_ctx *sctx = ctx;
+
+  if ( is_valid_complete_table(symbol_trie(n->value)) )
+  { sctx->complete = n;
+    return TRUE;
+  }
+  if ( !sctx->first )
+    sctx->first = n;
+
+  return FALSE;
+}
+
+static
+PRED_IMPL("$tbl_subsuming_table", 2, tbl_subsuming_table, 0)
+{ PRED_LD
+  subsuming_ctx ctx = {0};
+  trie *vtrie;
+  trie_node *n;
+
+  if ( (vtrie=LD->tabling.variant_table) )
+    trie_lookup_subsuming(vtrie, valTermRef(A1), subsuming_table, &ctx PASS_LD);
+#ifdef O_PLMT
+  if ( !ctx.complete && (vtrie=GD->tabling.variant_table) )
+    trie_lookup_subsuming(vtrie, valTermRef(A1), subsuming_table, &ctx PASS_LD);
+#endif
+
+  if ( (n=ctx.complete) || (n=ctx.first) )
+    return _PL_unify_atomic(A2, n->value);
+
+  return FALSE;
+}
+
+
 static
 PRED_IMPL("$tbl_local_variant_table", 1, tbl_local_variant_table, 0)
 { PRED_LD
@@ -4526,6 +4751,9 @@ PRED_IMPL("$tbl_table_complete_all", 3, tbl_table_complete_all, 0)
     size_t ntables = worklist_set_to_array(c->created_worklists, &wls);
     size_t i;
     int rc;
+#ifdef O_TRIE_STATS
+    double now = WallTime();
+#endif
 
     wls_reeval_complete(wls, ntables);
     rc = unify_leader_clause(c, A3 PASS_LD);
@@ -4534,6 +4762,11 @@ PRED_IMPL("$tbl_table_complete_all", 3, tbl_table_complete_all, 0)
     { worklist *wl = wls[i];
       trie *atrie = wl->table;
 
+#ifdef O_TRIE_STATS
+      atrie->stats.eval_time += now - wl->created;
+      atrie->stats.completions++;
+#endif
+
       DEBUG(MSG_TABLING_WORK,
 	    { term_t t = PL_new_term_ref();
 	      unify_trie_term(atrie->data.variant, NULL, t PASS_LD);
@@ -4558,6 +4791,7 @@ PRED_IMPL("$tbl_table_complete_all", 3, tbl_table_complete_all, 0)
     }
     reset_newly_created_worklists(c, WLFS_FREE_NONE);
     c->status = SCC_COMPLETED;
+    TRACEPOINT1(table__complete, c);
 
     if ( c->parent && LD->tabling.component == c )
       LD->tabling.component = c->parent;
@@ -5628,6 +5862,26 @@ PRED_IMPL("$idg_add_dyncall", 1, idg_add_dyncall, 0)
 }
 
 
+/** '$idg_add_edge'(+Caller, +Callee)
+ *
+ * Add a dependency edge that states that the answers of the table
+ * Caller depend on the table Callee.  Used to restore the IDG of saved
+ * tables.  Fails silently if one of the tables is not incremental.
+ */
+
+static
+PRED_IMPL("$idg_add_edge", 2, idg_add_edge, 0)
+{ PRED_LD
+  trie *caller, *callee;
+
+  if ( get_trie(A1, &caller) &&
+       get_trie(A2, &callee) )
+    return idg_add_edge(callee, caller PASS_LD) == TRUE;
+
+  return FALSE;
+}
+
+
 static int
 idg_set_current_wl(term_t wlref ARG_LD)
 { worklist *wl;
@@ -6612,9 +6866,11 @@ Claim ownership for an answer table if the table is incomplete/invalid:
     - If the table is complete, return its compiled trie.  As
       we are in a locked region we can do so safely.
 
-Note that this code uses  a   mutex/condition  variable  pair. Currently
-there is a single mutex. Future versions could  use an array of these to
-reduce contention.
+Note that this code uses a single mutex with an array of condition
+variables, selected by hashing the answer trie (see TABLE_CVAR()).
+Completing or abandoning a table only wakes the threads that wait for a
+table that hashes to the same variable rather than all threads that wait
+for some shared table.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static int
@@ -6806,7 +7062,7 @@ wait_for_table_to_complete(trie *atrie)
 	print_answer_table(atrie, "waiting for %d to complete", atrie->tid));
 
   do
-  { if ( cv_wait(&GD->tabling.cvar, &GD->tabling.mutex.mutex) == EINTR )
+  { if ( cv_wait(TABLE_CVAR(atrie), &GD->tabling.mutex.mutex) == EINTR )
     { if ( PL_handle_signals() < 0 )
       { DEBUG(MSG_TABLING_SHARED,
 	      print_answer_table(atrie, "Ready (interrupted"));
@@ -6822,6 +7078,65 @@ wait_for_table_to_complete(trie *atrie)
 
   return TRUE;
 }
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Answer streaming.  Threads that  stream  answers   from  a  shared table
+that is being completed by another   thread increment data.streaming and
+wait on the table's condition variable for   the answer count to change.
+The producer only takes the lock  to   wake  them  if data.streaming is
+non-zero.  Both the answer count and data.streaming are updated using
+atomic instructions, so either the producer sees  the consumer or the
+consumer sees the new answer before it waits.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+notify_streaming_consumers(trie *atrie)
+{ LOCK_SHARED_TABLE(atrie);
+  cv_broadcast(TABLE_CVAR(atrie));
+  UNLOCK_SHARED_TABLE(atrie);
+}
+
+
+static int
+wait_for_table_answers(trie *atrie, size_t count, atom_t *status)
+{ GET_LD
+  int mytid = PL_thread_self();
+  int rc = TRUE;
+
+  LOCK_SHARED_TABLE(atrie);
+  ATOMIC_INC(&atrie->data.streaming);
+  while( atrie->tid && atrie->tid != mytid && atrie->value_count <= count )
+  { register_waiting(mytid, atrie);
+    if ( is_deadlock(atrie) )
+    { term_t ex;
+
+      unregister_waiting(mytid, atrie);
+      if ( (ex = PL_new_term_ref()) &&
+	   PL_put_atom(ex, ATOM_deadlock) )
+	PL_raise_exception(ex);
+      rc = FALSE;
+      break;
+    }
+    TRIE_STAT_INC(atrie, wait);
+    if ( cv_wait(TABLE_CVAR(atrie), &GD->tabling.mutex.mutex) == EINTR &&
+	 PL_handle_signals() < 0 )
+    { unregister_waiting(mytid, atrie);
+      rc = FALSE;
+      break;
+    }
+    unregister_waiting(mytid, atrie);
+  }
+  ATOMIC_DEC(&atrie->data.streaming);
+
+  if ( atrie->tid == 0 )
+    *status = table_needs_work(atrie) ? ATOM_invalid : ATOM_complete;
+  else
+    *status = ATOM_incomplete;
+  UNLOCK_SHARED_TABLE(atrie);
+
+  return rc;
+}
 #endif /*O_PLMT*/
 
 
@@ -6837,7 +7152,7 @@ a file (see pl-srcfile.c) and we may not use any error condition.
 
 void
 untable_from_clause(Clause cl)
-{ if ( cl->codes[0] == encode(H_FUNCTOR) )
+{ if ( decode(cl->codes[0]) == H_FUNCTOR )
   { GET_LD
     functor_t f = (functor_t)cl->codes[1];
     Module m = cl->predicate->module;
@@ -6859,8 +7174,11 @@ initTabling(void)
 { GET_LD
 
 #ifdef O_PLMT
+  int i;
+
   initSimpleMutex(&GD->tabling.mutex, "L_SHARED_TABLING");
-  cv_init(&GD->tabling.cvar, NULL);
+  for(i=0; i<TABLE_WAIT_CVARS; i++)
+    cv_init(&GD->tabling.cvar[i], NULL);
 #endif
 
   LD->tabling.restraint.max_table_subgoal_size_action  = ATOM_error;
@@ -6899,6 +7217,9 @@ BeginPredDefs(tabling)
   PRED_DEF("$tbl_variant_table",	5, tbl_variant_table,	     0)
   PRED_DEF("$tbl_abstract_table",       6, tbl_abstract_table,       0)
   PRED_DEF("$tbl_existing_variant_table", 5, tbl_existing_variant_table, 0)
+  PRED_DEF("$tbl_stream_table",		3, tbl_stream_table,	     META)
+  PRED_DEF("$tbl_wait_answers",		4, tbl_wait_answers,	     0)
+  PRED_DEF("$tbl_subsuming_table",	2, tbl_subsuming_table,	     0)
   PRED_DEF("$tbl_moded_variant_table",	5, tbl_moded_variant_table,  0)
 #ifdef O_PLMT
   PRED_DEF("$tbl_variant_table",        1, tbl_variant_table,	  NDET)
@@ -6939,6 +7260,7 @@ BeginPredDefs(tabling)
   PRED_DEF("$is_answer_trie",           1, is_answer_trie,           0)
 
   PRED_DEF("$idg_add_dyncall",          1, idg_add_dyncall,          0)
+  PRED_DEF("$idg_add_edge",             2, idg_add_edge,             0)
   PRED_DEF("$idg_set_current",          1, idg_set_current,          0)
   PRED_DEF("$idg_set_current",          2, idg_set_current,          0)
   PRED_DEF("$idg_reset_current",        0, idg_reset_current,        0)
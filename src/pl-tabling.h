@@ -119,6 +119,9 @@ typedef struct worklist
 
   buffer	delays;			/* Delayed answers */
   buffer	pos_undefined;		/* Positive undefined */
+#ifdef O_TRIE_STATS
+  double	created;		/* Wall time at creation */
+#endif
 } worklist;
 
 
@@ -85,8 +85,7 @@ primitiveHashValue(word term, unsigned int *hval ARG_LD)
     case TAG_ATTVAR:
       return FALSE;
     case TAG_ATOM:
-    { *hval = MurmurHashAligned2(&atomValue(term)->hash_value,
-				 sizeof(unsigned int), *hval);
+    { *hval = MurmurHashInt32(atomValue(term)->hash_value, *hval);
       return TRUE;
     }
     case TAG_STRING:
@@ -102,7 +101,7 @@ primitiveHashValue(word term, unsigned int *hval ARG_LD)
       if ( storage(term) == STG_INLINE )
       { int64_t v = valInt(term);
 
-	*hval = MurmurHashAligned2(&v, sizeof(v), *hval);
+	*hval = MurmurHashInt64((uint64_t)v, *hval);
 
 	return TRUE;
       }
@@ -133,8 +132,7 @@ start_term(th_data *work, Buffer b, word w ARG_LD)
   work->in_cycle = 0;
 
   name = nameFunctor(work->functor);
-  work->hash = MurmurHashAligned2(&atomValue(name)->hash_value,
-				  sizeof(unsigned int), work->hash);
+  work->hash = MurmurHashInt32(atomValue(name)->hash_value, work->hash);
 
   DEBUG(1, Sdprintf("Added node %ld, %s/%d, hash=%d\n",
 		    nodeID(work, b),
@@ -172,8 +170,7 @@ next_arg(th_data **workp, Buffer b ARG_LD)
       unsigned int myhash;
 
       myhash = work->in_cycle ? CYCLE_CONST : work->hash;
-      parent->hash = MurmurHashAligned2(&myhash, sizeof(myhash),
-					parent->hash);
+      parent->hash = MurmurHashInt32(myhash, parent->hash);
       if ( work->in_cycle /*&& parent->functor == work->functor*/ ) /* (*) */
       { DEBUG(1, Sdprintf("Mark parent %ld as cycle\n",
 			  nodeID(parent, b)));
@@ -197,8 +194,7 @@ static void
 update_cycle(th_data *here, th_data *start, Buffer b)
 { unsigned int myhash = CYCLE_CONST;
 
-  here->hash = MurmurHashAligned2(&myhash, sizeof(myhash),
-				  here->hash);
+  here->hash = MurmurHashInt32(myhash, here->hash);
   DEBUG(1, Sdprintf("here = %ld, hash -> %d\n",
 		    nodeID(here, b), here->hash));
 
@@ -252,7 +248,7 @@ termHashValue(Word p, unsigned int *hval ARG_LD)
 	  } else
 	  { unsigned int shash = seen->in_cycle ? CYCLE_CONST : seen->hash;
 
-	    work->hash = MurmurHashAligned2(&shash, sizeof(shash), work->hash);
+	    work->hash = MurmurHashInt32(shash, work->hash);
 	    DEBUG(1, Sdprintf("shared with %ld, reusing hash %d node %ld -> %d\n",
 			      valInt(t->definition), seen->hash,
 			      nodeID(work, b), work->hash));
@@ -55,7 +55,11 @@
 #include "pl-tabling.h"
 #include "os/pl-cstack.h"
 #include "pl-prof.h"
+#include "pl-metrics.h"
+#include "pl-tracepoint.h"
 #include "pl-event.h"
+#include "pl-transaction.h"
+#include "pl-comp.h"
 #include <stdio.h>
 #include <math.h>
 
@@ -240,6 +244,7 @@ close_windows_thread(HANDLE wt)
 static Table threadTable;		/* name --> reference symbol */
 static int threads_ready = FALSE;	/* Prolog threads available */
 static Table queueTable;		/* name --> queue */
+static Table localTemplates;		/* Definition --> thread-local template */
 static simpleMutex queueTable_mutex;	/* GC synchronization */
 static int will_exec;			/* process will exec soon */
 
@@ -314,7 +319,9 @@ counting_mutex _PL_mutexes[] =
   COUNT_MUTEX_INITIALIZER("L_INIT_ATOMS"),
   COUNT_MUTEX_INITIALIZER("L_CGCGEN"),
   COUNT_MUTEX_INITIALIZER("L_EVHOOK"),
-  COUNT_MUTEX_INITIALIZER("L_OSDIR")
+  COUNT_MUTEX_INITIALIZER("L_OSDIR"),
+  COUNT_MUTEX_INITIALIZER("L_LAZY"),
+  COUNT_MUTEX_INITIALIZER("L_PROFILE")
 #ifdef __WINDOWS__
 , COUNT_MUTEX_INITIALIZER("L_DDE")
 , COUNT_MUTEX_INITIALIZER("L_CSTACK")
@@ -448,6 +455,9 @@ static void	destroy_thread_message_queue(message_queue *queue);
 static void	init_message_queue(message_queue *queue, size_t max_size);
 static size_t	sizeof_message_queue(message_queue *queue);
 static size_t	sizeof_local_definitions(PL_local_data_t *ld);
+static int	seedLocalDefinitions(ARG1_LD);
+struct tl_template;
+static void	free_tl_template(struct tl_template *t);
 static void	freeThreadSignals(PL_local_data_t *ld);
 static thread_handle *create_thread_handle(PL_thread_info_t *info);
 static void	free_thread_info(PL_thread_info_t *info);
@@ -461,6 +471,8 @@ static int	unify_queue(term_t t, message_queue *q);
 static int	get_message_queue_unlocked__LD(term_t t, message_queue **queue ARG_LD);
 static int	get_message_queue__LD(term_t t, message_queue **queue ARG_LD);
 static void	release_message_queue(message_queue *queue);
+static int	get_send_queue__LD(term_t t, message_queue **queue ARG_LD);
+static void	release_send_queue(message_queue *queue);
 static void	initMessageQueues(void);
 static int	get_thread(term_t t, PL_thread_info_t **info, int warn);
 static int	is_alive(int status);
@@ -642,6 +654,7 @@ freePrologThread(PL_local_data_t *ld, int after_fork)
 	info->in_exit_hooks = FALSE;
 	ld->critical--;   /* endCritical */
       }
+      releaseOwnedStreams(TRUE);
     } else
     { acknowledge = FALSE;
       info->detached = TRUE;		/* cleanup */
@@ -650,16 +663,22 @@ freePrologThread(PL_local_data_t *ld, int after_fork)
   #ifdef O_PROFILE
     if ( ld->profile.active )
       activateProfiler(FALSE, ld);
+    sampleProfilerExitThread(info);
   #endif
 
     destroy_event_list(&ld->event.hook.onthreadexit);
+    abortTransactions(PASS_LD1);
     cleanupLocalDefinitions(ld);
+    TRACEPOINT1(thread__exit, info->pl_tid);
 
     DEBUG(MSG_THREAD, Sdprintf("Destroying data\n"));
     ld->magic = 0;
     if ( ld->stacks.global.base )		/* otherwise not initialised */
     { simpleMutexLock(&ld->thread.scan_lock);
       freeStacks(ld);
+#ifdef O_CLAUSEGC
+      freeCGCCache(ld);
+#endif
       simpleMutexUnlock(&ld->thread.scan_lock);
     }
     freePrologLocalData(ld);
@@ -685,6 +704,9 @@ freePrologThread(PL_local_data_t *ld, int after_fork)
     if ( ld->locale.current )
       releaseLocale(ld->locale.current);
   #endif
+					/* see cleanupLocalDefinitions() */
+    info->local_definitions = ld->thread.local_definitions;
+    ld->thread.local_definitions = NULL;
     info->thread_data = NULL;		/* avoid a loop */
     info->has_tid = FALSE;		/* needed? */
     if ( !after_fork )
@@ -879,6 +901,7 @@ initPrologThreads(void)
     GD->statistics.threads_created = 1;
     pthread_mutex_init(&GD->thread.index.mutex, NULL);
     pthread_cond_init(&GD->thread.index.cond, NULL);
+    GD->thread.index.workers = CpuCount();
     initMutexes();
     link_mutexes();
     threads_ready = TRUE;
@@ -909,11 +932,28 @@ cleanupThreads(void)
   { destroyHTable(threadTable);
     threadTable = NULL;
   }
+  if ( localTemplates )
+  { TableEnum e = newTableEnum(localTemplates);
+    void *v;
+
+    while( advanceTableEnum(e, NULL, &v) )
+      free_tl_template(v);
+    freeTableEnum(e);
+    destroyHTable(localTemplates);
+    localTemplates = NULL;
+  }
   for(i=1; i<GD->thread.thread_max; i++)
   { PL_thread_info_t *info = GD->thread.threads[i];
 
     if ( info )
+    { DefinitionChain ch, next;
+
+      for(ch=info->local_definitions; ch; ch=next)
+      { next = ch->next;
+	freeHeap(ch, sizeof(*ch));
+      }
       freeHeap(info, sizeof(*info));
+    }
   }
   freeHeap(GD->thread.threads,
 	   GD->thread.thread_max * sizeof(*GD->thread.threads));
@@ -1366,10 +1406,21 @@ alloc_thread(void)
 
   if ( info )
   { int i = info->pl_tid;
+    DefinitionChain ldefs;
+
     assert(info->status == PL_THREAD_UNUSED);
+    PL_LOCK(L_THREAD);
+    ldefs = info->local_definitions;
     memset(info, 0, sizeof(*info));
     info->pl_tid = i;
-    PL_LOCK(L_THREAD);
+    ld->thread.local_definitions = ldefs;
+    for( ; ldefs; ldefs = ldefs->next )	/* listeners may have changed */
+    { Definition def = ldefs->definition;
+      Definition local;
+
+      if ( def && (local=getProcDefinitionForThread(def, i)) )
+	local->events = def->events;
+    }
   } else
   { int i;
 
@@ -1486,7 +1537,9 @@ thread no longer exists and -1 if alerting is disabled.
 
 static int
 alertThread(PL_thread_info_t *info)
-{
+{ if ( info->thread_data )
+    signalWakeup(info->thread_data);
+
 #ifdef __WINDOWS__
   if ( info->w32id )
   { PostThreadMessage(info->w32id, WM_SIGNALLED, 0, 0L);
@@ -1651,7 +1704,16 @@ set_system_thread_id(PL_thread_info_t *info)
   info->tid = pthread_self();
   info->has_tid = TRUE;
 #ifdef HAVE_GETTID_SYSCALL
+#ifdef HAVE___THREAD
+  { static __thread pid_t os_tid = 0;	/* avoid a syscall per engine switch */
+
+    if ( !os_tid )
+      os_tid = syscall(__NR_gettid);
+    info->pid = os_tid;
+  }
+#else
   info->pid = syscall(__NR_gettid);
+#endif
 #else
 #ifdef HAVE_GETTID_MACRO
   info->pid = gettid();
@@ -1760,6 +1822,10 @@ start_thread(void *closure)
     PL_LOCK(L_THREAD);
     info->status = PL_THREAD_RUNNING;
     PL_UNLOCK(L_THREAD);
+    TRACEPOINT1(thread__start, info->pl_tid);
+#ifdef O_PROFILE
+    sampleProfilerStartThread(info);
+#endif
 
     if ( info->symbol &&
 	 (th=symbol_thread_handle(info->symbol)) &&
@@ -1769,7 +1835,12 @@ start_thread(void *closure)
     goal = PL_new_term_ref();
     PL_put_atom(goal, ATOM_dthread_init);
 
-    rval = callProlog(MODULE_system, goal, PL_Q_CATCH_EXCEPTION, &ex);
+    if ( seedLocalDefinitions(PASS_LD1) )
+    { rval = callProlog(MODULE_system, goal, PL_Q_CATCH_EXCEPTION, &ex);
+    } else
+    { rval = FALSE;
+      ex = exception_term;
+    }
 
     if ( rval )
     { if ( !PL_recorded(info->goal, goal) )
@@ -1850,6 +1921,8 @@ copy_local_data(PL_local_data_t *ldnew, PL_local_data_t *ldold,
     ldnew->tabling.node_pool = new_alloc_pool(pool->name, pool->limit);
   ldnew->fli.string_buffers.tripwire
 				  = ldold->fli.string_buffers.tripwire;
+  ldnew->gc.pause_budget	  = ldold->gc.pause_budget;
+  ldnew->gc.shrink_gcs		  = ldold->gc.shrink_gcs;
   ldnew->statistics.start_time    = WallTime();
   ldnew->prolog_flag.mask	  = ldold->prolog_flag.mask;
   ldnew->prolog_flag.occurs_check = ldold->prolog_flag.occurs_check;
@@ -2892,6 +2965,139 @@ error:
 
   return rc;
 }
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+'$cpu_nodes'(-Nodes) describes the NUMA  topology for thread placement by
+library(thread_pool).  Nodes is a list holding   a list of CPUs for each
+node, restricted to the CPUs this process may   run  on.  Nodes without
+such CPUs are omitted.  If the topology is   not  available (no sysfs),
+Nodes holds a single node with all CPUs.
+
+Threads started with an affinity for  a   node  allocate their stacks in
+initialise_thread(), i.e., from the new   thread. Using the default
+first-touch policy of the OS, these  stacks and the thread's malloc()
+arena are therefore allocated on the node of the thread.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define SYS_NODE_DIR "/sys/devices/system/node"
+
+static int
+read_cpu_list(const char *file, cpu_set_t *set)
+{ IOSTREAM *fd;
+  char buf[1024];
+  char *s;
+  int rc = FALSE;
+
+  CPU_ZERO(set);
+  if ( !(fd=Sopen_file(file, "r")) )
+    return FALSE;
+  if ( (s=Sfgets(buf, sizeof(buf), fd)) )
+  { rc = TRUE;
+
+    while( *s && *s != '\n' )
+    { char *e;
+      long from = strtol(s, &e, 10), to;
+
+      if ( e == s )
+      { rc = FALSE;
+	break;
+      }
+      to = from;
+      if ( *e == '-' )
+      { s = e+1;
+	to = strtol(s, &e, 10);
+	if ( e == s )
+	{ rc = FALSE;
+	  break;
+	}
+      }
+      for(; from <= to && from < CPU_SETSIZE; from++)
+	CPU_SET(from, set);
+      s = (*e == ',' ? e+1 : e);
+    }
+  }
+  Sclose(fd);
+
+  return rc;
+}
+
+
+/* put_cpu_node() unifies list (a fresh variable) with the CPUs that are
+   in node and allowed.  Returns the number of CPUs or -1 on error.
+*/
+
+static int
+put_cpu_node(term_t list, const cpu_set_t *node, const cpu_set_t *allowed)
+{ GET_LD
+  term_t tail = PL_copy_term_ref(list);
+  term_t head = PL_new_term_ref();
+  int cpu_count = CpuCount();
+  int i, n = 0;
+
+  for(i=0; i<cpu_count && i<CPU_SETSIZE; i++)
+  { if ( CPU_ISSET(i, node) && CPU_ISSET(i, allowed) )
+    { if ( !PL_unify_list(tail, head, tail) ||
+	   !PL_unify_integer(head, i) )
+	return -1;
+      n++;
+    }
+  }
+
+  return PL_unify_nil(tail) ? n : -1;
+}
+
+
+static
+PRED_IMPL("$cpu_nodes", 1, cpu_nodes, 0)
+{ PRED_LD
+  term_t tail = PL_copy_term_ref(A1);
+  term_t head = PL_new_term_ref();
+  term_t cpus = PL_new_term_ref();
+  cpu_set_t allowed, online;
+  int n, found = 0;
+
+  if ( sched_getaffinity(0, sizeof(allowed), &allowed) != 0 )
+  { int i;
+
+    CPU_ZERO(&allowed);
+    for(i=0; i<CpuCount() && i<CPU_SETSIZE; i++)
+      CPU_SET(i, &allowed);
+  }
+
+  if ( read_cpu_list(SYS_NODE_DIR "/online", &online) )
+  { int node;
+
+    for(node=0; node<CPU_SETSIZE; node++)
+    { char file[MAXPATHLEN];
+      cpu_set_t set;
+
+      if ( !CPU_ISSET(node, &online) )
+	continue;
+      Ssnprintf(file, sizeof(file), SYS_NODE_DIR "/node%d/cpulist", node);
+      if ( !read_cpu_list(file, &set) )
+	continue;
+      PL_put_variable(cpus);
+      if ( (n=put_cpu_node(cpus, &set, &allowed)) < 0 )
+	return FALSE;
+      if ( n > 0 )
+      { if ( !PL_unify_list(tail, head, tail) ||
+	     !PL_unify(head, cpus) )
+	  return FALSE;
+	found++;
+      }
+    }
+  }
+
+  if ( !found )				/* unknown topology: one node */
+  { PL_put_variable(cpus);
+    if ( put_cpu_node(cpus, &allowed, &allowed) < 0 ||
+	 !PL_unify_list(tail, head, tail) ||
+	 !PL_unify(head, cpus) )
+      return FALSE;
+  }
+
+  return PL_unify_nil(tail);
+}
 #endif /*HAVE_SCHED_SETAFFINITY*/
 
 
@@ -3559,6 +3765,25 @@ of waiting threads and the number waiting  with a variable. Only if they
 are not equal and there are multiple waiters we must be using broadcast.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Sending to a queue without a  size   limit  does  not need the queue
+mutex. Such messages are pushed onto   queue->incoming  using CAS, after
+which we only need to lock  to  signal   waiting  readers.  The reader
+holds the mutex and moves the incoming  messages   to  the end of the
+ordered queue in drain_incoming() before it scans  the queue. If it must
+wait, it increments queue->waiting, which  is   seen  by  any sender that
+pushes after this, and checks queue->incoming  again before waiting. As
+a result, many threads sending to a   single  queue do not contend on
+the queue mutex unless the reader  is   waiting  for messages. Readers
+always lock the queue as  they  must   be  able  to  skip messages that
+do not unify with a partially instantiated pattern.
+
+Lock-free senders increment queue->senders  while   they  use the queue.
+Senders that find the queue through  a   name  or  thread id do so while
+holding L_THREAD. Destroying the queue  waits   for  queue->senders to
+drop to zero after syncing with L_THREAD.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 typedef struct thread_message
 { struct thread_message *next;		/* next in queue */
   record_t            message;		/* message in queue */
@@ -3567,6 +3792,20 @@ typedef struct thread_message
 } thread_message;
 
 
+static thread_message *
+new_thread_message(record_t rec, word key)
+{ thread_message *msgp;
+
+  if ( (msgp = allocHeap(sizeof(*msgp))) )
+  { msgp->next    = NULL;
+    msgp->message = rec;
+    msgp->key     = key;
+  }
+
+  return msgp;
+}
+
+
 static thread_message *
 create_thread_message(term_t msg ARG_LD)
 { thread_message *msgp;
@@ -3575,13 +3814,8 @@ create_thread_message(term_t msg ARG_LD)
   if ( !(rec=compileTermToHeap(msg, R_NOLOCK)) )
     return NULL;
 
-  if ( (msgp = allocHeap(sizeof(*msgp))) )
-  { msgp->next    = NULL;
-    msgp->message = rec;
-    msgp->key     = getIndexOfTerm(msg);
-  } else
-  { freeRecord(rec);
-  }
+  if ( !(msgp = new_thread_message(rec, getIndexOfTerm(msg))) )
+    freeRecord(rec);
 
   return msgp;
 }
@@ -3596,6 +3830,83 @@ free_thread_message(thread_message *msg)
 }
 
 
+static void
+wakeup_readers(message_queue *queue)
+{ if ( queue->waiting )
+  { if ( queue->waiting > queue->waiting_var && queue->waiting > 1 )
+    { DEBUG(MSG_THREAD,
+	    Sdprintf("%d of %d non-var waiters; broadcasting\n",
+		     queue->waiting - queue->waiting_var,
+		     queue->waiting));
+      cv_broadcast(&queue->cond_var);
+    } else
+    { DEBUG(MSG_THREAD, Sdprintf("%d var waiters; signalling\n", queue->waiting));
+      cv_signal(&queue->cond_var);
+    }
+  } else
+  { DEBUG(MSG_THREAD, Sdprintf("No waiters\n"));
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+push_message() adds a message to a queue without a size limit.  The caller
+must have incremented queue->senders.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+push_message(message_queue *queue, thread_message *msgp)
+{ thread_message *head;
+
+  do
+  { head = queue->incoming;
+    msgp->next = head;
+  } while ( !COMPARE_AND_SWAP_PTR(&queue->incoming, head, msgp) );
+  ATOMIC_INC(&queue->size);
+
+  if ( queue->waiting )
+  { simpleMutexLock(&queue->mutex);
+    wakeup_readers(queue);
+    simpleMutexUnlock(&queue->mutex);
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+drain_incoming() moves the messages  pushed   by  push_message() to the
+end of the queue, reversing them to  restore   the  order in which they
+were sent.  The caller must hold the  queue-mutex.  We lock gc_mutex as
+AGC may be walking the incoming list.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+drain_incoming(message_queue *queue)
+{ if ( queue->incoming )
+  { thread_message *msgp, *next, *first = NULL, *last;
+
+    simpleMutexLock(&queue->gc_mutex);
+    do
+    { msgp = queue->incoming;
+    } while ( !COMPARE_AND_SWAP_PTR(&queue->incoming, msgp, NULL) );
+
+    for(last = msgp; msgp; msgp = next)
+    { next = msgp->next;
+      msgp->next = first;
+      first = msgp;
+    }
+    for(msgp = first; msgp; msgp = msgp->next)
+      msgp->sequence_id = ++queue->sequence_next;
+
+    if ( !queue->head )
+      queue->head = first;
+    else
+      queue->tail->next = first;
+    queue->tail = last;
+    simpleMutexUnlock(&queue->gc_mutex);
+  }
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 queue_message() adds a message to a message queue.  The caller must hold
 the queue-mutex.
@@ -3638,6 +3949,7 @@ queue_message(message_queue *queue, thread_message *msgp,
     queue->wait_for_drain--;
   }
 
+  drain_incoming(queue);
   msgp->sequence_id = ++queue->sequence_next;
   if ( !queue->head )
   { queue->head = queue->tail = msgp;
@@ -3645,22 +3957,8 @@ queue_message(message_queue *queue, thread_message *msgp,
   { queue->tail->next = msgp;
     queue->tail = msgp;
   }
-  queue->size++;
-
-  if ( queue->waiting )
-  { if ( queue->waiting > queue->waiting_var && queue->waiting > 1 )
-    { DEBUG(MSG_THREAD,
-	    Sdprintf("%d of %d non-var waiters; broadcasting\n",
-		     queue->waiting - queue->waiting_var,
-		     queue->waiting));
-      cv_broadcast(&queue->cond_var);
-    } else
-    { DEBUG(MSG_THREAD, Sdprintf("%d var waiters; signalling\n", queue->waiting));
-      cv_signal(&queue->cond_var);
-    }
-  } else
-  { DEBUG(MSG_THREAD, Sdprintf("No waiters\n"));
-  }
+  ATOMIC_INC(&queue->size);
+  wakeup_readers(queue);
 
   return TRUE;
 }
@@ -3833,10 +4131,24 @@ cv_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
 static int
 dispatch_cond_wait(message_queue *queue, queue_wait_type wait,
 		   struct timespec *deadline)
-{ return cv_timedwait((wait == QUEUE_WAIT_READ ? &queue->cond_var
-					       : &queue->drain_var),
-		      &queue->mutex,
-		      deadline);
+{ GET_LD
+  double t0 = WallTime();
+  double t;
+  int rc;
+
+  ATOMIC_INC(&LD->clauses.quiescent);	/* see markPredicatesInEnvironments() */
+  rc = cv_timedwait((wait == QUEUE_WAIT_READ ? &queue->cond_var
+					     : &queue->drain_var),
+		    &queue->mutex,
+		    deadline);
+  ATOMIC_INC(&LD->clauses.quiescent);
+  t = WallTime()-t0;
+  LD->statistics.queue_wait_time += t;
+  metricObserve(MET_QUEUE_WAIT_SECONDS, t);
+  histogramObserve(wait == QUEUE_WAIT_READ ? &queue->read_wait
+					   : &queue->write_wait, t);
+
+  return rc;
 }
 
 #ifdef O_QUEUE_STATS
@@ -3879,6 +4191,31 @@ we also need to lock to avoid  get_message() destroying the record while
 markAtomsMessageQueue() scans it. This fixes the reopened Bug#142.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+static void
+remove_message(message_queue *queue, thread_message *prev,
+	       thread_message *msgp)
+{ if (GD->atoms.gc_active)
+    markAtomsRecord(msgp->message);
+
+  simpleMutexLock(&queue->gc_mutex);	/* see (*) */
+  if ( prev )
+  { if ( !(prev->next = msgp->next) )
+      queue->tail = prev;
+  } else
+  { if ( !(queue->head = msgp->next) )
+      queue->tail = NULL;
+  }
+  simpleMutexUnlock(&queue->gc_mutex);
+
+  free_thread_message(msgp);
+  ATOMIC_DEC(&queue->size);
+  if ( queue->wait_for_drain )
+  { DEBUG(MSG_QUEUE, Sdprintf("Queue drained. wakeup writers\n"));
+    cv_signal(&queue->drain_var);
+  }
+}
+
+
 static int
 get_message(message_queue *queue, term_t msg, struct timespec *deadline ARG_LD)
 { int isvar = PL_is_variable(msg) ? 1 : 0;
@@ -3894,6 +4231,8 @@ get_message(message_queue *queue, term_t msg, struct timespec *deadline ARG_LD)
 
     if ( queue->destroyed )
       return MSG_WAIT_DESTROYED;
+    drain_incoming(queue);
+    msgp = queue->head;
 
     DEBUG(MSG_QUEUE,
 	  if ( queue->size > 0 )
@@ -3940,25 +4279,7 @@ get_message(message_queue *queue, term_t msg, struct timespec *deadline ARG_LD)
       if ( rc )
       { DEBUG(MSG_QUEUE, Sdprintf("%d: match\n", PL_thread_self()));
 
-	if (GD->atoms.gc_active)
-	  markAtomsRecord(msgp->message);
-
-        simpleMutexLock(&queue->gc_mutex);	/* see (*) */
-	if ( prev )
-	{ if ( !(prev->next = msgp->next) )
-	    queue->tail = prev;
-	} else
-	{ if ( !(queue->head = msgp->next) )
-	    queue->tail = NULL;
-	}
-        simpleMutexUnlock(&queue->gc_mutex);
-
-	free_thread_message(msgp);
-	queue->size--;
-	if ( queue->wait_for_drain )
-	{ DEBUG(MSG_QUEUE, Sdprintf("Queue drained. wakeup writers\n"));
-	  cv_signal(&queue->drain_var);
-	}
+	remove_message(queue, prev, msgp);
 
 	PL_close_foreign_frame(fid);
 	return TRUE;
@@ -3972,6 +4293,12 @@ get_message(message_queue *queue, term_t msg, struct timespec *deadline ARG_LD)
 
     queue->waiting++;
     queue->waiting_var += isvar;
+    MEMORY_BARRIER();			/* see push_message() */
+    if ( queue->incoming )
+    { queue->waiting--;
+      queue->waiting_var -= isvar;
+      continue;
+    }
     DEBUG(MSG_QUEUE_WAIT, Sdprintf("%d: waiting on queue\n", PL_thread_self()));
     switch ( dispatch_cond_wait(queue, QUEUE_WAIT_READ, deadline) )
     { case EINTR:
@@ -4011,6 +4338,49 @@ get_message(message_queue *queue, term_t msg, struct timespec *deadline ARG_LD)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+get_messages() waits for a message as get_message() and then removes up
+to max-1 more messages from the  head   of  the queue without releasing
+the queue mutex. We stop early if   the  next message does not fit on
+the global stack, such that we never raise an exception after removing
+a message.  The result is unified with  `list`.  Must be called with
+queue->mutex locked and returns as get_message().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+get_messages(message_queue *queue, size_t max, term_t list,
+	     struct timespec *deadline ARG_LD)
+{ term_t msg  = PL_new_term_ref();
+  term_t l    = PL_new_term_ref();
+  term_t tail = PL_copy_term_ref(l);
+  term_t head = PL_new_term_ref();
+  int rc;
+
+  if ( (rc=get_message(queue, msg, deadline PASS_LD)) != TRUE )
+    return rc;
+  if ( !PL_unify_list(tail, head, tail) ||
+       !PL_unify(head, msg) )
+    return FALSE;
+
+  while ( --max > 0 )
+  { thread_message *msgp;
+
+    drain_incoming(queue);
+    if ( !(msgp = queue->head) ||
+	 !hasGlobalSpace(msgp->message->gsize+3) )
+      break;
+
+    if ( !PL_recorded(msgp->message, msg) ||
+	 !PL_unify_list(tail, head, tail) ||
+	 !PL_unify(head, msg) )
+      return FALSE;
+    remove_message(queue, NULL, msgp);
+  }
+
+  return PL_unify_nil(tail) && PL_unify(list, l);
+}
+
+
 static int
 peek_message(message_queue *queue, term_t msg ARG_LD)
 { thread_message *msgp;
@@ -4018,8 +4388,7 @@ peek_message(message_queue *queue, term_t msg ARG_LD)
   word key = getIndexOfTerm(msg);
   fid_t fid = PL_open_foreign_frame();
 
-  msgp = queue->head;
-
+  drain_incoming(queue);
   for( msgp = queue->head; msgp; msgp = msgp->next )
   { if ( key && msgp->key && key != msgp->key )
       continue;
@@ -4054,6 +4423,9 @@ destroy_message_queue(message_queue *queue)
 
   assert(!queue->waiting && !queue->wait_for_drain);
 
+  while ( queue->senders )		/* see push_message() */
+    Pause(0.0001);
+  drain_incoming(queue);
   for( msgp = queue->head; msgp; msgp = next )
   { next = msgp->next;
 
@@ -4067,6 +4439,8 @@ destroy_message_queue(message_queue *queue)
     cv_destroy(&queue->drain_var);
   if ( !queue->anonymous )
     simpleMutexDelete(&queue->mutex);
+  freeHistogram(&queue->read_wait);
+  freeHistogram(&queue->write_wait);
 }
 
 
@@ -4090,7 +4464,7 @@ destroy_thread_message_queue(message_queue *q)
 	cv_broadcast(&q->cond_var);
       if ( q->wait_for_drain )
 	cv_broadcast(&q->drain_var);
-    } else
+    } else if ( !q->senders )
       done = TRUE;
     simpleMutexUnlock(&q->mutex);
   }
@@ -4122,6 +4496,10 @@ sizeof_message_queue(message_queue *queue)
   { size += sizeof(*msgp);
     size += msgp->message->size;
   }
+  for( msgp = queue->incoming; msgp; msgp = msgp->next )
+  { size += sizeof(*msgp);
+    size += msgp->message->size;
+  }
   simpleMutexUnlock(&queue->gc_mutex);
 
   return size;
@@ -4250,17 +4628,25 @@ wait_queue_message(term_t qterm, message_queue *q, thread_message *msg,
 }
 
 static int
-thread_send_message__LD(term_t queue, term_t msgterm,
-			struct timespec *deadline ARG_LD)
+send_thread_message(term_t queue, thread_message *msg,
+		    struct timespec *deadline ARG_LD)
 { message_queue *q;
-  thread_message *msg;
   int rc;
 
+  if ( !get_send_queue__LD(queue, &q PASS_LD) )
+  { free_thread_message(msg);
+    return FALSE;
+  }
+  if ( q->max_size == 0 )
+  { push_message(q, msg);
+    release_send_queue(q);
+    return TRUE;
+  }
+  release_send_queue(q);
+
   if ( !get_message_queue__LD(queue, &q PASS_LD) )
+  { free_thread_message(msg);
     return FALSE;
-  if ( !(msg = create_thread_message(msgterm PASS_LD)) )
-  { release_message_queue(q);
-    return PL_no_memory();
   }
 
   rc = wait_queue_message(queue, q, msg, deadline PASS_LD);
@@ -4272,6 +4658,54 @@ thread_send_message__LD(term_t queue, term_t msgterm,
   return rc;
 }
 
+static int
+thread_send_message__LD(term_t queue, term_t msgterm,
+			struct timespec *deadline ARG_LD)
+{ thread_message *msg;
+
+  if ( !(msg = create_thread_message(msgterm PASS_LD)) )
+    return PL_no_memory();
+
+  return send_thread_message(queue, msg, deadline PASS_LD);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+thread_broadcast_message(+Queues, +Term)
+    Send Term to each queue  in  Queues.   The  term  is compiled only
+    once. The messages share the record,   which is released by freeRecord()
+    if the last receiver has copied it to its stacks.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static
+PRED_IMPL("thread_broadcast_message", 2, thread_broadcast_message, 0)
+{ PRED_LD
+  term_t tail = PL_copy_term_ref(A1);
+  term_t head = PL_new_term_ref();
+  record_t rec;
+  word key;
+  int rc = TRUE;
+
+  if ( !(rec=compileTermToHeap(A2, R_NOLOCK|R_DUPLICATE)) )
+    return PL_no_memory();
+  key = getIndexOfTerm(A2);
+
+  while( rc && PL_get_list_ex(tail, head, tail) )
+  { thread_message *msg;
+
+    if ( (msg = new_thread_message(PL_duplicate_record(rec), key)) )
+    { rc = send_thread_message(head, msg, NULL PASS_LD);
+    } else
+    { freeRecord(rec);
+      rc = PL_no_memory();
+    }
+  }
+  if ( rc )
+    rc = PL_get_nil_ex(tail);
+  freeRecord(rec);
+
+  return rc;
+}
+
 static
 PRED_IMPL("thread_send_message", 2, thread_send_message, PL_FA_ISO)
 { PRED_LD
@@ -4590,7 +5024,59 @@ get_message_queue__LD(term_t t, message_queue **queue ARG_LD)
 }
 
 
-/* Release a message queue, deleting it if it is no longer needed
+/* Get a message queue for push_message().  This does not lock the queue,
+   but increments queue->senders to avoid the queue from being destroyed.
+   See push_message() for the synchronization.
+*/
+
+static int
+get_send_queue__LD(term_t t, message_queue **queue ARG_LD)
+{ int rc;
+  message_queue *q;
+  PL_blob_t *type;
+  void *data;
+
+  if ( PL_get_blob(t, &data, NULL, &type) && type == &message_queue_blob )
+  { mqref *ref = data;
+
+    q = ref->queue;
+    ATOMIC_INC(&q->senders);
+    if ( !q->destroyed )
+    { *queue = q;
+      return TRUE;
+    }
+    ATOMIC_DEC(&q->senders);
+    return PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_message_queue, t);
+  }
+
+  PL_LOCK(L_THREAD);
+  rc = get_message_queue_unlocked__LD(t, queue PASS_LD);
+  if ( rc )
+  { message_queue *q = *queue;
+
+    ATOMIC_INC(&q->senders);
+    if ( q->destroyed )
+    { ATOMIC_DEC(&q->senders);
+      rc = PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_message_queue, t);
+    }
+  }
+  PL_UNLOCK(L_THREAD);
+
+  return rc;
+}
+
+
+static void
+release_send_queue(message_queue *queue)
+{ ATOMIC_DEC(&queue->senders);
+}
+
+
+/* Release a message queue, deleting it if it is no longer needed.  If the
+   queue is named, lock-free senders may have found it before it was
+   deleted from the queue table.  Syncing with L_THREAD ensures these
+   have incremented queue->senders, which destroy_message_queue() waits
+   for.
 */
 
 static void
@@ -4602,7 +5088,11 @@ release_message_queue(message_queue *queue)
   simpleMutexUnlock(&queue->mutex);
 
   if ( del )
-  { destroy_message_queue(queue);
+  { if ( !queue->anonymous )
+    { PL_LOCK(L_THREAD);
+      PL_UNLOCK(L_THREAD);
+    }
+    destroy_message_queue(queue);
     if ( !queue->anonymous )
       PL_free(queue);
   }
@@ -4719,10 +5209,24 @@ message_queue_max_size_property(message_queue *q, term_t prop ARG_LD)
 }
 
 
+static int		/* message_queue_property(Queue, read_wait(Hist)) */
+message_queue_read_wait_property(message_queue *q, term_t prop ARG_LD)
+{ return unify_histogram(prop, q->read_wait);
+}
+
+
+static int		/* message_queue_property(Queue, write_wait(Hist)) */
+message_queue_write_wait_property(message_queue *q, term_t prop ARG_LD)
+{ return unify_histogram(prop, q->write_wait);
+}
+
+
 static const tprop qprop_list [] =
 { { FUNCTOR_alias1,	    message_queue_alias_property },
   { FUNCTOR_size1,	    message_queue_size_property },
   { FUNCTOR_max_size1,	    message_queue_max_size_property },
+  { FUNCTOR_read_wait1,	    message_queue_read_wait_property },
+  { FUNCTOR_write_wait1,    message_queue_write_wait_property },
   { 0,			    NULL }
 };
 
@@ -4994,6 +5498,52 @@ PRED_IMPL("thread_get_message", 3, thread_get_message, 0)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+thread_get_messages(+Queue, +Max, -List)
+    Wait for a message on Queue and get at most Max messages from it,
+    locking the queue only once.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static
+PRED_IMPL("thread_get_messages", 3, thread_get_messages, 0)
+{ PRED_LD
+  size_t max;
+  int rc;
+
+  if ( !PL_get_size_ex(A2, &max) )
+    return FALSE;
+  if ( max == 0 )
+    return PL_error(NULL, 0, NULL, ERR_DOMAIN, ATOM_not_less_than_one, A2);
+
+  for(;;)
+  { message_queue *q;
+
+    if ( !get_message_queue__LD(A1, &q PASS_LD) )
+      return FALSE;
+
+    rc = get_messages(q, max, A3, NULL PASS_LD);
+    release_message_queue(q);
+
+    switch(rc)
+    { case MSG_WAIT_INTR:
+	if ( PL_handle_signals() >= 0 )
+	  continue;
+	rc = FALSE;
+	break;
+      case MSG_WAIT_DESTROYED:
+	rc = PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_message_queue, A1);
+        break;
+      default:
+	;
+    }
+
+    break;
+  }
+
+  return rc;
+}
+
+
 static
 PRED_IMPL("thread_peek_message", 2, thread_peek_message_2, 0)
 { PRED_LD
@@ -5237,6 +5787,7 @@ PL_thread_attach_engine(PL_thread_attr_t *attr)
       info->stack_limit = attr->stack_limit;
 
     info->cancel = attr->cancel;
+    info->trim_idle = (attr->flags & PL_THREAD_TRIM_IDLE) != 0;
   }
 
   info->goal       = NULL;
@@ -5256,6 +5807,9 @@ PL_thread_attach_engine(PL_thread_attr_t *attr)
   PL_LOCK(L_THREAD);
   info->status = PL_THREAD_RUNNING;
   PL_UNLOCK(L_THREAD);
+#ifdef O_PROFILE
+  sampleProfilerStartThread(info);
+#endif
 
   if ( attr )
   { if ( attr->alias )
@@ -5362,7 +5916,10 @@ PL_set_engine(PL_engine_t new, PL_engine_t *old)
     }
 
     if ( current )
+    { if ( current->thread.info->trim_idle && !current->query )
+	trimOversizedStacks(current);
       detach_engine(current);
+    }
 
     if ( new )
     { TLD_set_LD(new);
@@ -5541,6 +6098,30 @@ signalGCThread(int sig)
 }
 
 
+/* signalIndexBuilder() asks the gc thread to build the pending clause
+   indexes (see pl-index.c). Returns FALSE if there is no gc thread, in
+   which case the caller must build the index itself.
+*/
+
+int
+signalIndexBuilder(void)
+{ GET_LD
+
+  if ( truePrologFlag(PLFLAG_GCTHREAD) &&
+       !GD->bootsession &&
+       (GCthread() > 0 || GC_starting) )
+  { pthread_mutex_lock(&GD->thread.gc.mutex);
+    GD->thread.gc.requests |= GCREQUEST_INDEX;
+    pthread_cond_signal(&GD->thread.gc.cond);
+    pthread_mutex_unlock(&GD->thread.gc.mutex);
+
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+
 static int
 gc_running(void)
 { int tid;
@@ -5584,6 +6165,8 @@ PRED_IMPL("$gc_wait", 1, gc_wait, 0)
       action = ATOM_garbage_collect_atoms;
     else if ( (req&GCREQUEST_CGC) )
       action = ATOM_garbage_collect_clauses;
+    else if ( (req&GCREQUEST_INDEX) )
+      action = ATOM_build_indexes;
     else
       continue;
 
@@ -5604,6 +6187,8 @@ PRED_IMPL("$gc_clear", 1, gc_clear, 0)
       mask = GCREQUEST_AGC;
     else if ( action == ATOM_garbage_collect_clauses )
       mask = GCREQUEST_CGC;
+    else if ( action == ATOM_build_indexes )
+      mask = GCREQUEST_INDEX;
     else
       return PL_domain_error("action", A1);
 
@@ -6157,6 +6742,9 @@ markAtomsMessageQueue(message_queue *queue)
   for(msg=queue->head; msg; msg=msg->next)
   { markAtomsRecord(msg->message);
   }
+  for(msg=queue->incoming; msg; msg=msg->next)
+  { markAtomsRecord(msg->message);
+  }
 }
 
 
@@ -6221,11 +6809,18 @@ registerLocalDefinition(Definition def)
 }
 
 
-static void
-unregisterLocalDefinition(Definition def, PL_local_data_t *ld)
-{ DefinitionChain cell;
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+unregisterLocalDefinition() removes def from the local definitions of
+the thread described by info.  If  the   thread  has  terminated, its
+recycled local definitions are kept  in   info  (see
+cleanupLocalDefinitions()). They are handed  to   a  new thread using
+the same thread id while holding L_THREAD,   so  we must hold L_THREAD
+to find them.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-  for(cell = ld->thread.local_definitions; cell; cell = cell->next)
+static void
+unregisterLocalDefinitionFromChain(Definition def, DefinitionChain cell)
+{ for( ; cell; cell = cell->next)
   { if ( cell->definition == def )
     { cell->definition = NULL;
       return;
@@ -6233,6 +6828,21 @@ unregisterLocalDefinition(Definition def, PL_local_data_t *ld)
   }
 }
 
+static void
+unregisterLocalDefinition(Definition def, PL_local_data_t *ld,
+			  PL_thread_info_t *info)
+{ if ( ld )
+  { unregisterLocalDefinitionFromChain(def, ld->thread.local_definitions);
+  } else
+  { PL_LOCK(L_THREAD);
+    if ( (ld=info->thread_data) )
+      unregisterLocalDefinitionFromChain(def, ld->thread.local_definitions);
+    else
+      unregisterLocalDefinitionFromChain(def, info->local_definitions);
+    PL_UNLOCK(L_THREAD);
+  }
+}
+
 
 LocalDefinitions
 new_ldef_vector(void)
@@ -6265,6 +6875,8 @@ destroyLocalDefinitions(Definition def)
   LocalDefinitions ldefs = def->impl.local;
   int b;
 
+  setThreadLocalTemplate(def, NULL, 0);
+
   for(b=0; b<MAX_BLOCKS; b++)
   { Definition *d0 = ldefs->blocks[b];
 
@@ -6289,10 +6901,10 @@ destroyLocalDefinitions(Definition def)
 			   "with active local definitions\n",
 			   predicateName(def)));
 
-	  unregisterLocalDefinition(def, ld);
+	  unregisterLocalDefinition(def, ld, info);
 	  destroyLocalDefinition(def, tid);
 
-	  if ( LD )
+	  if ( LD && ld )
 	    release_ldata(ld);
 	}
       }
@@ -6327,7 +6939,12 @@ localiseDefinition(Definition def)
   memcpy(local->impl.any.args, def->impl.any.args, bytes);
   clear(local, P_THREAD_LOCAL|P_DIRTYREG);	/* remains P_DYNAMIC */
   local->impl.clauses.first_clause = NULL;
+  local->erased_prefix.last = NULL;
   local->impl.clauses.clause_indexes = NULL;
+  local->range_indexes = NULL;
+  local->index_stats = NULL;
+  local->call_counts = NULL;
+  local->mutex = NULL;
   ATOMIC_INC(&GD->statistics.predicates);
   ATOMIC_ADD(&local->module->code_size, sizeof(*local));
   DEBUG(MSG_PROC_COUNT, Sdprintf("Localise %s\n", predicateName(def)));
@@ -6339,13 +6956,24 @@ localiseDefinition(Definition def)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+cleanupLocalDefinitions() is called when a thread terminates. Rather than
+destroying the local definitions, we remove their clauses and leave them
+in the localization vector of the  predicate.   The  chain is moved to
+the thread info structure by freePrologThread() and handed to the next
+thread that obtains this thread  id  by   alloc_thread().  This avoids
+allocating and initialising a local definition   for each thread-local
+predicate that is used by a new thread, which is significant for servers
+that create many short-lived threads.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 void
 cleanupLocalDefinitions(PL_local_data_t *ld)
-{ DefinitionChain ch = ld->thread.local_definitions;
-  DefinitionChain next;
+{ DefinitionChain *prev = &ld->thread.local_definitions;
+  DefinitionChain ch, next;
   unsigned int id = ld->thread.info->pl_tid;
 
-  for( ; ch; ch = next)
+  for(ch = *prev ; ch; ch = next)
   { Definition def = ch->definition;
     next = ch->next;
 
@@ -6356,13 +6984,173 @@ cleanupLocalDefinitions(PL_local_data_t *ld)
 		     predicateName(def)));
 
       assert(true(def, P_THREAD_LOCAL));
-      destroyLocalDefinition(def, id);
+      recycleLocalDefinition(def, id);
+      prev = &ch->next;
+    } else
+    { *prev = next;
+      freeHeap(ch, sizeof(*ch));
     }
-    freeHeap(ch, sizeof(*ch));
   }
 }
 
 
+		 /*******************************
+		 *   THREAD-LOCAL TEMPLATES	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A thread-local predicate may have a  template: a set of clauses that is
+compiled once by set_thread_local_template/2  and   with  which the local
+definition of each new thread is  seeded   before  the thread runs its
+initialization. Clause objects cannot be shared  between definitions as
+they carry the predicate and the  generation   in  which they are visible,
+so each thread gets a byte copy of the compiled clauses. This avoids
+recompiling the clauses for every thread.   After seeding, the clauses
+are ordinary clauses of the thread's local definition.
+
+The template table is keyed by the   global  (P_THREAD_LOCAL) definition
+and protected by L_THREAD.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct tl_template
+{ size_t	count;			/* # clauses */
+  Clause       *clauses;		/* compiled template clauses */
+} tl_template;
+
+static void
+free_tl_template(struct tl_template *t)
+{ size_t i;
+
+  for(i=0; i<t->count; i++)
+    freeClause(t->clauses[i]);
+  freeHeap(t->clauses, t->count*sizeof(Clause));
+  freeHeap(t, sizeof(*t));
+}
+
+
+/* setThreadLocalTemplate() installs clauses as the template for the
+   thread-local predicate def, taking ownership of the clauses.  If
+   count is 0, the template is removed.
+*/
+
+void
+setThreadLocalTemplate(Definition def, Clause *clauses, size_t count)
+{ GET_LD
+  tl_template *new = NULL;
+  tl_template *old;
+
+  if ( count > 0 )
+  { new = allocHeapOrHalt(sizeof(*new));
+    new->count = count;
+    new->clauses = allocHeapOrHalt(count*sizeof(Clause));
+    memcpy(new->clauses, clauses, count*sizeof(Clause));
+  }
+
+  PL_LOCK(L_THREAD);
+  if ( !localTemplates && new )
+    localTemplates = newHTable(8);
+  if ( localTemplates && (old = lookupHTable(localTemplates, def)) )
+  { if ( new )
+      updateHTable(localTemplates, def, new);
+    else
+      deleteHTable(localTemplates, def);
+  } else
+  { old = NULL;
+    if ( new )
+      addNewHTable(localTemplates, def, new);
+  }
+  PL_UNLOCK(L_THREAD);
+
+  if ( old )
+    free_tl_template(old);
+}
+
+
+static Clause
+clone_template_clause(Clause cl)
+{ size_t size = sizeofClause(cl->code_size);
+  Clause copy = arena_alloc(size);
+
+  memcpy(copy, cl, size);
+  clear(copy, CL_PACKED);
+#ifdef O_ATOMGC
+  forAtomsInClause(copy, PL_register_atom);
+#endif
+
+  return copy;
+}
+
+
+/* seedLocalDefinitions() is called by a new thread before it runs
+   '$thread_init' and adds the template clauses to its local definitions.
+   The clauses are cloned while holding L_THREAD, such that the template
+   cannot be freed under us, and asserted after releasing it.  If adding
+   the clauses raises an exception, the remaining clones are discarded
+   and we return FALSE, leaving the exception for the caller.
+*/
+
+typedef struct tl_seed
+{ Definition	definition;		/* global definition */
+  size_t	count;			/* # cloned clauses */
+} tl_seed;
+
+static int
+seedLocalDefinitions(ARG1_LD)
+{ tmp_buffer seeds, clauses;
+  tl_seed *sv;
+  Clause *cv;
+  size_t i, n, c;
+  int rc = TRUE;
+
+  if ( !localTemplates )
+    return TRUE;
+
+  initBuffer(&seeds);
+  initBuffer(&clauses);
+  PL_LOCK(L_THREAD);
+  { TableEnum e = newTableEnum(localTemplates);
+    void *k, *v;
+
+    while( advanceTableEnum(e, &k, &v) )
+    { tl_template *t = v;
+      tl_seed seed = { (Definition)k, t->count };
+
+      addBuffer(&seeds, seed, tl_seed);
+      for(i=0; i<t->count; i++)
+	addBuffer(&clauses, clone_template_clause(t->clauses[i]), Clause);
+    }
+    freeTableEnum(e);
+  }
+  PL_UNLOCK(L_THREAD);
+
+  sv = baseBuffer(&seeds, tl_seed);
+  cv = baseBuffer(&clauses, Clause);
+  n  = entriesBuffer(&seeds, tl_seed);
+  for(i=0, c=0; i<n; c += sv[i].count, i++)
+  { Definition local = getProcDefinition__LD(sv[i].definition PASS_LD);
+    size_t j;
+
+    for(j=0; j<sv[i].count; j++)
+      cv[c+j]->predicate = local;
+    if ( !rc )
+    { for(j=0; j<sv[i].count; j++)
+	freeClause(cv[c+j]);
+    } else if ( !assertDefinitionList(local, &cv[c], sv[i].count,
+				      CL_END PASS_LD) )
+    { DEBUG(MSG_THREAD,
+	    Sdprintf("Could not seed thread-local predicate %s\n",
+		     predicateName(sv[i].definition)));
+      rc = FALSE;
+    }
+  }
+
+  discardBuffer(&seeds);
+  discardBuffer(&clauses);
+
+  return rc;
+}
+
+
 static size_t
 sizeof_local_definitions(PL_local_data_t *ld)
 { DefinitionChain ch = ld->thread.local_definitions;
@@ -6436,6 +7224,11 @@ isSignalledGCThread(int sig ARG_LD)
 { return PL_pending(sig);
 }
 
+int
+signalIndexBuilder(void)
+{ return FALSE;
+}
+
 
 int
 PL_thread_self()
@@ -6984,6 +7777,7 @@ BeginPredDefs(thread)
   PRED_DEF("$thread_sigwait",	     1, thread_sigwait,	       0)
 #ifdef HAVE_PRED_THREAD_AFFINITY
   PRED_DEF("thread_affinity",        3, thread_affinity,       0)
+  PRED_DEF("$cpu_nodes",             1, cpu_nodes,             0)
 #endif
 
   PRED_DEF("message_queue_create",   1,	message_queue_create,  0)
@@ -6996,6 +7790,8 @@ BeginPredDefs(thread)
   PRED_DEF("thread_get_message",     1,	thread_get_message,    PL_FA_ISO)
   PRED_DEF("thread_get_message",     2,	thread_get_message,    PL_FA_ISO)
   PRED_DEF("thread_get_message",     3,	thread_get_message,    PL_FA_ISO)
+  PRED_DEF("thread_get_messages",    3,	thread_get_messages,   0)
+  PRED_DEF("thread_broadcast_message", 2, thread_broadcast_message, 0)
   PRED_DEF("thread_peek_message",    1,	thread_peek_message_1, PL_FA_ISO)
   PRED_DEF("thread_peek_message",    2,	thread_peek_message_2, PL_FA_ISO)
   PRED_DEF("message_queue_destroy",  1,	message_queue_destroy, PL_FA_ISO)
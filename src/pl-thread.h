@@ -51,6 +51,7 @@
 #define GCREQUEST_AGC   0x01		/* GD->thread.gc.requests */
 #define GCREQUEST_CGC   0x02
 #define GCREQUEST_ABORT 0x04
+#define GCREQUEST_INDEX 0x08
 
 #define EXIT_REQ_PROCESS 1
 #define EXIT_REQ_THREAD  2
@@ -85,11 +86,14 @@ typedef struct _PL_thread_info_t
   size_t	    c_stack_size;	/* system (C-) stack */
   rc_cancel	    (*cancel)(int id);	/* cancel function */
   unsigned short    open_count;		/* for PL_thread_detach_engine() */
+  int		    prof_sample;	/* TRUE: sampled by the profiler */
+  struct sample_table *prof_samples;	/* Samples of this thread */
   unsigned	    detached      : 1;	/* detached thread */
   unsigned	    debug         : 1;	/* thread can be debugged */
   unsigned	    in_exit_hooks : 1;	/* TRUE: running exit hooks */
   unsigned	    has_tid       : 1;	/* TRUE: tid = valid */
   unsigned	    is_engine	  : 1;	/* TRUE: created as engine */
+  unsigned	    trim_idle	  : 1;	/* TRUE: trim stacks on detach */
   thread_status	    status;		/* PL_THREAD_* */
   pthread_t	    tid;		/* Thread identifier */
 #ifdef __linux__
@@ -104,6 +108,7 @@ typedef struct _PL_thread_info_t
   record_t	    return_value;	/* Value (term) returned */
   atom_t	    symbol;		/* thread_handle symbol */
   struct _PL_thread_info_t *next_free;	/* Next in free list */
+  DefinitionChain   local_definitions;	/* Recycled thread-local predicates */
 
 					/* lock-free access to data */
   struct
@@ -152,6 +157,7 @@ typedef struct message_queue
 #endif
   struct thread_message   *head;	/* Head of message queue */
   struct thread_message   *tail;	/* Tail of message queue */
+  struct thread_message   *incoming;	/* Lock-free sent messages (LIFO) */
   uint64_t	       sequence_next;	/* next for sequence id */
   word		       id;		/* Id of the queue */
   size_t	       size;		/* # terms in queue */
@@ -159,6 +165,9 @@ typedef struct message_queue
   int		       waiting;		/* # waiting threads */
   int		       waiting_var;	/* # waiting with unbound */
   int		       wait_for_drain;	/* # threads waiting for write */
+  int		       senders;		/* # lock-free senders active */
+  struct metric_histogram *read_wait;	/* Time waiting for a message */
+  struct metric_histogram *write_wait;	/* Time waiting for space */
   unsigned	anonymous : 1;		/* <message_queue>(0x...) */
   unsigned	initialized : 1;	/* Queue is initialised */
   unsigned	destroyed : 1;		/* Thread is being destroyed */
@@ -170,10 +179,18 @@ typedef struct message_queue
 
 typedef struct pl_mutex
 { pthread_mutex_t mutex;		/* the system mutex */
+  pthread_rwlock_t rw_lock;		/* the system rwlock (if rwlock) */
   int count;				/* lock count */
   int owner;				/* integer id of owner */
   atom_t id;				/* id of the mutex */
+  int spins;				/* Estimated spins to acquire */
+  uint64_t acquired;			/* # times acquired */
+  uint64_t contended;			/* # times we had to wait */
+  double wait_time;			/* Total time waiting */
+  struct metric_histogram *wait_histogram; /* Distribution of waits */
+  int readers;				/* # active readers (rwlock) */
   unsigned anonymous    : 1;		/* <mutex>(0x...) */
+  unsigned rwlock	: 1;		/* Read-write lock */
   unsigned initialized  : 1;		/* Mutex is initialized */
   unsigned destroyed    : 1;		/* Mutex is destroyed */
   unsigned auto_destroy	: 1;		/* asked to destroy */
@@ -211,9 +228,11 @@ extern counting_mutex _PL_mutexes[];	/* Prolog mutexes */
 #define L_CGCGEN       25
 #define L_EVHOOK       26
 #define L_OSDIR	       27
+#define L_LAZY	       28
+#define L_PROFILE      29
 #ifdef __WINDOWS__
-#define L_DDE	       28
-#define L_CSTACK       29
+#define L_DDE	       30
+#define L_CSTACK       31
 #endif
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -268,10 +287,10 @@ countingMutexUnlock(counting_mutex *cm)
 #define PL_UNLOCK(id) IF_MT(id, countingMutexUnlock(&_PL_mutexes[id]))
 #endif
 
-#define LOCKDEF(def)   PL_LOCK(L_PREDICATE)
-#define UNLOCKDEF(def) PL_UNLOCK(L_PREDICATE)
+#define LOCKDEF(def)   lockDefinition(def)
+#define UNLOCKDEF(def) unlockDefinition(def)
 
-#define LOCKMODULE(module)	countingMutexLock((module)->mutex)
+#define LOCKMODULE(module)	countingMutexLock(moduleMutex(module))
 #define UNLOCKMODULE(module)	countingMutexUnlock((module)->mutex)
 
 #define LOCKSRCFILE(sf)		countingMutexLock((sf)->mutex)
@@ -361,11 +380,14 @@ COMMON(const char *)	threadName(int id);
 COMMON(void)		executeThreadSignals(int sig);
 COMMON(foreign_t)	pl_attach_xterm(term_t in, term_t out);
 COMMON(int)		attachConsole(void);
+COMMON(counting_mutex *) moduleMutex(Module m);
 COMMON(Definition)	localiseDefinition(Definition def);
 COMMON(LocalDefinitions) new_ldef_vector(void);
 COMMON(void)		free_ldef_vector(LocalDefinitions ldefs);
 COMMON(void)		cleanupLocalDefinitions(PL_local_data_t *ld);
 COMMON(void)		destroyLocalDefinitions(Definition def);
+COMMON(void)		setThreadLocalTemplate(Definition def, Clause *clauses,
+				       size_t count);
 int			PL_mutex_lock(struct pl_mutex *m);
 int			PL_mutex_unlock(struct pl_mutex *m);
 int			PL_thread_raise(int tid, int sig);
@@ -479,5 +501,6 @@ COMMON(void)		markAccessedPredicates(PL_local_data_t *ld);
 COMMON(int)		cgc_thread_stats(cgc_stats *stats ARG_LD);
 COMMON(int)		signalGCThread(int sig);
 COMMON(int)		isSignalledGCThread(int sig ARG_LD);
+COMMON(int)		signalIndexBuilder(void);
 
 #endif /*PL_THREAD_H_DEFINED*/
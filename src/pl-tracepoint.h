@@ -0,0 +1,100 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef PL_TRACEPOINT_H_INCLUDED
+#define PL_TRACEPOINT_H_INCLUDED
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Static tracepoints for dtrace, SystemTap, perf and bpftrace.  If the system
+provides <sys/sdt.h> (and USDT_PROBES is not disabled), each tracepoint is
+compiled into a single no-op instruction and a description in the ELF
+.note.stapsdt section.  A tracer patches the instruction when it attaches
+to the probe.  Otherwise the macros expand to nothing.
+
+The provider is `swipl`.  A `__` in a probe name is shown as `-` by most
+tools, e.g.
+
+    bpftrace -e 'usdt:/path/libswipl.so:swipl:gc__done { @gained = hist(arg0-arg1); }'
+
+Arguments are evaluated while the probe is disabled, so they must be
+cheap.  Strings are passed as C strings (char*).  The probes are:
+
+    pred__call(module, name, arity)	Predicates with call_counting
+    pred__exit(module, name, arity)
+    pred__redo(module, name, arity)
+    pred__fail(module, name, arity)
+    pred__exception(module, name, arity)
+    gc__start(reason, global_used)	Stack garbage collection
+    gc__done(global_before, global_after)
+    agc__start()			Atom garbage collection
+    agc__done(reclaimed)
+    thread__start(id)			Prolog thread starts running
+    thread__exit(id)			Prolog thread is destroyed
+    index__create(module, name, arity, buckets)	 JIT clause index
+    table__complete(scc)		Tabling SCC is completed
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define O_TRACEPOINTS 1
+
+#define TRACEPOINT0(name) \
+	DTRACE_PROBE(swipl, name)
+#define TRACEPOINT1(name, a1) \
+	DTRACE_PROBE1(swipl, name, a1)
+#define TRACEPOINT2(name, a1, a2) \
+	DTRACE_PROBE2(swipl, name, a1, a2)
+#define TRACEPOINT3(name, a1, a2, a3) \
+	DTRACE_PROBE3(swipl, name, a1, a2, a3)
+#define TRACEPOINT4(name, a1, a2, a3, a4) \
+	DTRACE_PROBE4(swipl, name, a1, a2, a3, a4)
+#else
+#define TRACEPOINT0(name)		 ((void)0)
+#define TRACEPOINT1(name, a1)		 ((void)0)
+#define TRACEPOINT2(name, a1, a2)	 ((void)0)
+#define TRACEPOINT3(name, a1, a2, a3)	 ((void)0)
+#define TRACEPOINT4(name, a1, a2, a3, a4) ((void)0)
+#endif
+
+/* Tracepoint for a port of a predicate.  Arguments are module, name
+   and arity of the Definition
+*/
+
+#define TRACEPOINT_PRED(port, def) \
+	TRACEPOINT3(port, stringAtom((def)->module->name), \
+		    stringAtom((def)->functor->name), \
+		    (int)(def)->functor->arity)
+
+#endif /*PL_TRACEPOINT_H_INCLUDED*/
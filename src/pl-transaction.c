@@ -0,0 +1,362 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pl-incl.h"
+#include "pl-transaction.h"
+
+#undef LD
+#define LD LOCAL_LD
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Database transactions.  transaction/1 runs a goal  such that the changes
+it makes to the clause database  become   visible  to  other threads at
+once if the goal succeeds and are discarded if the goal fails or raises
+an exception.
+
+Inside a transaction we use the same  technique as for reloading a file
+(see pl-srcfile.c): the thread  uses  a   private  generation  that  is
+stored in LD->gen_reload, such that VISIBLE_CLAUSE() treats it specially.
+
+  - Asserted clauses get the private generation as created generation,
+    so they are only visible to this thread.
+  - Retracted clauses get the private generation as erased generation,
+    so they remain visible for all other threads.  If the clause was
+    asserted in the same transaction its created generation is set to
+    GEN_MAX, which makes it invisible to everyone.
+
+All updates are recorded in LD->transaction.updates.  Committing the
+outermost transaction assigns a single new global generation to all of
+them, so readers see all or nothing  and   we  pay for only one global
+generation.  Rolling back restores the retracted clauses and erases the
+asserted ones.  A nested transaction remembers the number of recorded
+updates when it started, so it can roll back its own updates only.  If
+a nested transaction commits its updates become part of the outer one.
+
+If another thread retracts a clause  that   we  retracted  inside the
+transaction, the other thread wins and committing simply skips it.  The
+recorded clauses are protected against clause   GC  using the clause
+reference count.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef enum
+{ TR_ASSERT,
+  TR_RETRACT
+} tr_type;
+
+typedef struct tr_update
+{ Definition	predicate;		/* Predicate that was modified */
+  Clause	clause;			/* Clause added or removed */
+  tr_type	type;			/* TR_ASSERT or TR_RETRACT */
+} tr_update;
+
+#ifdef O_PLMT
+#define GEN_TRANSACTION (GEN_MAX-PL_thread_self())
+#else
+#define GEN_TRANSACTION (GEN_MAX-1)
+#endif
+
+/* transactionReserve() ensures there is space to record one more update.
+   It is called before the predicate is locked, such that the actual
+   recording cannot fail.
+*/
+
+int
+transactionReserve(ARG1_LD)
+{ if ( LD->transaction.count == LD->transaction.size )
+  { size_t size = LD->transaction.size ? LD->transaction.size*2 : 32;
+    tr_update *new = realloc(LD->transaction.updates, size*sizeof(*new));
+
+    if ( !new )
+      return PL_no_memory();
+    LD->transaction.updates = new;
+    LD->transaction.size    = size;
+  }
+
+  return TRUE;
+}
+
+
+static void
+add_update(Definition def, Clause clause, tr_type type ARG_LD)
+{ tr_update *u;
+
+  assert(LD->transaction.count < LD->transaction.size);
+  u = &LD->transaction.updates[LD->transaction.count++];
+  u->predicate = def;
+  u->clause    = clause;
+  u->type      = type;
+  acquire_clause(clause);
+}
+
+
+/* Called from assert_definition() with def locked */
+
+void
+transactionAssertClause(Definition def, Clause clause ARG_LD)
+{ clause->generation.created = LD->transaction.generation;
+  clause->generation.erased  = GEN_MAX;
+  add_update(def, clause, TR_ASSERT PASS_LD);
+}
+
+
+/* Called from retractClauseDefinition() with def locked.  Returns FALSE
+   if the clause was already retracted in this transaction.
+*/
+
+int
+transactionRetractClause(Definition def, Clause clause ARG_LD)
+{ gen_t gen = LD->transaction.generation;
+
+  if ( clause->generation.erased == gen ||
+       clause->generation.created == GEN_MAX )
+    return FALSE;
+
+  if ( clause->generation.created == gen )
+    clause->generation.created = GEN_MAX;
+  else
+    clause->generation.erased = gen;
+  add_update(def, clause, TR_RETRACT PASS_LD);
+
+  return TRUE;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+commit_updates() publishes all recorded  updates.   As  for  reconsult
+(see reconsultFinalizePredicate())  we  move  the   clauses  to  the
+generation global_generation()+1 and  increment   the  global generation
+afterwards, such that the update is atomic  unless another thread also
+increments the generation.  When erasing a clause  we always set the
+erased generation before changing the created generation, such that the
+clause never becomes visible to other threads.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+commit_updates(ARG1_LD)
+{ gen_t gen    = LD->transaction.generation;
+  gen_t update = global_generation()+1;
+  size_t i;
+
+  for(i=0; i<LD->transaction.count; i++)
+  { tr_update *u = &LD->transaction.updates[i];
+    Definition def = u->predicate;
+    Clause cl = u->clause;
+
+    if ( u->type == TR_ASSERT )
+    { if ( cl->generation.created == gen )
+      { LOCKDEF(def);
+	cl->generation.created = update;
+	setLastModifiedPredicate(def, update);
+	UNLOCKDEF(def);
+      }					/* else retracted; see below */
+    } else
+    { if ( cl->generation.created == GEN_MAX )
+      { if ( eraseClauseDefinition(def, cl, update) )
+	  cl->generation.created = update;
+      } else if ( cl->generation.erased == gen )
+      { eraseClauseDefinition(def, cl, update);
+      }
+    }
+  }
+
+  MEMORY_BARRIER();
+  next_global_generation();
+}
+
+
+static void
+rollback_updates(size_t mark ARG_LD)
+{ gen_t gen = LD->transaction.generation;
+  size_t i;
+
+  for(i=LD->transaction.count; i-- > mark; )
+  { tr_update *u = &LD->transaction.updates[i];
+    Definition def = u->predicate;
+    Clause cl = u->clause;
+
+    if ( u->type == TR_RETRACT )
+    { LOCKDEF(def);
+      if ( cl->generation.created == GEN_MAX )
+	cl->generation.created = gen;
+      else if ( cl->generation.erased == gen )
+	cl->generation.erased = GEN_MAX;
+      UNLOCKDEF(def);
+    } else
+    { gen_t now = global_generation();
+
+      if ( eraseClauseDefinition(def, cl, now) )
+	cl->generation.created = now;
+    }
+    release_clause(cl);
+  }
+
+  LD->transaction.count = mark;
+}
+
+
+static void
+release_updates(ARG1_LD)
+{ size_t i;
+
+  for(i=0; i<LD->transaction.count; i++)
+    release_clause(LD->transaction.updates[i].clause);
+  LD->transaction.count = 0;
+}
+
+
+static void
+end_transaction(ARG1_LD)
+{ if ( --LD->transaction.nesting == 0 )
+  { assert(LD->transaction.count == 0);
+    LD->transaction.generation = GEN_INVALID;
+    LD->gen_reload = GEN_INVALID;
+  }
+}
+
+
+/* Called if a thread terminates inside a transaction */
+
+void
+abortTransactions(ARG1_LD)
+{ if ( LD->transaction.generation )
+  { rollback_updates(0 PASS_LD);
+    LD->transaction.nesting = 1;
+    end_transaction(PASS_LD1);
+  }
+
+  if ( LD->transaction.updates )
+  { free(LD->transaction.updates);
+    LD->transaction.updates = NULL;
+    LD->transaction.size = 0;
+  }
+}
+
+
+static int
+get_mark(term_t t, size_t *mark ARG_LD)
+{ if ( !PL_get_size_ex(t, mark) )
+    return FALSE;
+  if ( !LD->transaction.nesting || *mark > LD->transaction.count )
+    return PL_existence_error("transaction", t);
+
+  return TRUE;
+}
+
+
+		 /*******************************
+		 *	PROLOG CONNECTION	*
+		 *******************************/
+
+/** '$transaction_begin'(-Mark) is det.
+ *
+ * Start a (nested) transaction.  Mark is used to commit or roll back
+ * the updates of this transaction.
+ */
+
+static
+PRED_IMPL("$transaction_begin", 1, transaction_begin, 0)
+{ PRED_LD
+
+  if ( !LD->transaction.generation )
+  { if ( LD->gen_reload != GEN_INVALID )
+    { term_t reloading;
+
+      return ( (reloading=PL_new_term_ref()) &&
+	       PL_put_atom(reloading, ATOM_reloading) &&
+	       PL_error(NULL, 0, "while reloading a file",
+			ERR_PERMISSION, ATOM_start, ATOM_transaction,
+			reloading) );
+    }
+    LD->transaction.generation = GEN_TRANSACTION;
+    LD->gen_reload = LD->transaction.generation;
+  }
+  LD->transaction.nesting++;
+
+  return PL_unify_int64(A1, LD->transaction.count);
+}
+
+
+/** '$transaction_commit'(+Mark) is det.
+ *
+ * Commit the transaction started with Mark.  If this is the outermost
+ * transaction, all updates become visible to other threads.
+ */
+
+static
+PRED_IMPL("$transaction_commit", 1, transaction_commit, 0)
+{ PRED_LD
+  size_t mark;
+
+  if ( !get_mark(A1, &mark PASS_LD) )
+    return FALSE;
+
+  if ( LD->transaction.nesting == 1 )
+  { commit_updates(PASS_LD1);
+    release_updates(PASS_LD1);
+  }
+  end_transaction(PASS_LD1);
+
+  return TRUE;
+}
+
+
+/** '$transaction_rollback'(+Mark) is det.
+ *
+ * Discard all updates since the transaction identified by Mark started.
+ */
+
+static
+PRED_IMPL("$transaction_rollback", 1, transaction_rollback, 0)
+{ PRED_LD
+  size_t mark;
+
+  if ( !get_mark(A1, &mark PASS_LD) )
+    return FALSE;
+
+  rollback_updates(mark PASS_LD);
+  end_transaction(PASS_LD1);
+
+  return TRUE;
+}
+
+
+		 /*******************************
+		 *      PUBLISH PREDICATES	*
+		 *******************************/
+
+BeginPredDefs(transaction)
+  PRED_DEF("$transaction_begin",    1, transaction_begin,    0)
+  PRED_DEF("$transaction_commit",   1, transaction_commit,   0)
+  PRED_DEF("$transaction_rollback", 1, transaction_rollback, 0)
+EndPredDefs
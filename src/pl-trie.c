@@ -257,10 +257,10 @@ get_child(trie_node *n, word key ARG_LD)
 { trie_children children = n->children;
 
   if ( children.any )
-  { switch( children.any->type )
+  { switch( trie_children_type(children) )
     { case TN_KEY:
-	if ( children.key->key == key )
-	  return children.key->child;
+	if ( trie_single_child(children)->key == key )
+	  return trie_single_child(children);
         return NULL;
       case TN_HASHED:
 	return lookupHTable(children.hash->table, (void*)key);
@@ -311,10 +311,9 @@ next:
   }
 
   if ( children.any )
-  { switch( children.any->type )
+  { switch( trie_children_type(children) )
     { case TN_KEY:
-      { n = children.key->child;
-	free_to_pool(trie->alloc_pool, children.key, sizeof(*children.key));
+      { n = trie_single_child(children);
 	dealloc = TRUE;
 	goto next;
       }
@@ -322,10 +321,7 @@ next:
       { Table table = children.hash->table;
 	TableEnum e = newTableEnum(table);
 	void *k, *v;
-	trie_children_key *os;
 
-	if ( (os=children.hash->old_single) )	/* see insert_child() (*) note */
-	  free_to_pool(trie->alloc_pool, os, sizeof(*os));
 	free_to_pool(trie->alloc_pool, children.hash, sizeof(*children.hash));
 
 	while(advanceTableEnum(e, &k, &v))
@@ -366,10 +362,9 @@ prune_node(trie *trie, trie_node *n)
     children = p->children;
 
     if ( children.any )
-    { switch( children.any->type )
+    { switch( trie_children_type(children) )
       { case TN_KEY:
-	  if ( COMPARE_AND_SWAP_PTR(&p->children.any, children.any, NULL) )
-	    PL_free(children.any);
+	  COMPARE_AND_SWAP_PTR(&p->children.any, children.any, NULL);
 	  break;
 	case TN_HASHED:
 	  deleteHTable(children.hash->table, (void*)n->key);
@@ -408,9 +403,9 @@ prune_trie(trie *trie, trie_node *root,
   { children = n->children;
 
     if ( children.any )
-    { switch( children.any->type )
+    { switch( trie_children_type(children) )
       { case TN_KEY:
-	{ n = children.key->child;
+	{ n = trie_single_child(children);
 	  continue;
 	}
 	case TN_HASHED:
@@ -445,10 +440,9 @@ prune_trie(trie *trie, trie_node *root,
       children = p->children;
 
       if ( children.any )
-      { switch( children.any->type )
+      { switch( trie_children_type(children) )
 	{ case TN_KEY:
-	    if ( COMPARE_AND_SWAP_PTR(&p->children.any, children.any, NULL) )
-	      PL_free(children.any);
+	    COMPARE_AND_SWAP_PTR(&p->children.any, children.any, NULL);
 	    break;
 	  case TN_HASHED:
 	    deleteHTable(children.hash->table, (void*)n->key);
@@ -473,7 +467,7 @@ prune_trie(trie *trie, trie_node *root,
       { n = ps.n;
 	freeTableEnum(ps.e);
 	popSegStack(&stack, &ps, prune_state);
-	assert(n->children.any->type == TN_HASHED);
+	assert(trie_children_type(n->children) == TN_HASHED);
 	if ( n->children.hash->table->size == 0 )
 	  goto prune;
 	goto next_choice;
@@ -507,94 +501,82 @@ update_var_mask(trie_children_hashed *hnode, word key)
 
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-(*) The single node may be  in  use   with  another  thread. We have two
-options:
-
-  - Use one of the LD _active_ pointers to acquire/release access to the
-    trie nodes and use safe delayed release.
-  - Add the ond _single_ node to the new hash node and delete it along
-    with the hash node when we clean the table.  We have opted for this
-    option as it is simple and the single key is neglectable in size
-    compared to the hash table anyway.
+Insert a child for `key` below `n`. If n has a single child and we add a
+second, the children are moved to a hash table. Another thread may still
+be using the old (tagged) single child pointer. This is safe as the child
+node itself is moved into the table.
+
+Insertion does not lock. The new node  is completely initialised (parent
+and var_mask of the hash) before it  is   published  using  CAS or the
+lock-free addHTable(), so concurrent  readers   never  see  a partially
+initialised node. Values are set using CAS as well, such that exactly one
+of several threads inserting the same key succeeds.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static trie_node *
 insert_child(trie *trie, trie_node *n, word key ARG_LD)
-{ for(;;)
+{ trie_node *new = NULL;
+
+  for(;;)
   { trie_children children = n->children;
-    trie_node *new = new_trie_node(trie, key);
+
+    if ( children.any &&
+	 trie_children_type(children) == TN_KEY &&
+	 trie_single_child(children)->key == key )
+    { if ( new )
+	destroy_node(trie, new);
+      return trie_single_child(children);
+    }
 
     if ( !new )
-      return NULL;			/* resource error */
+    { if ( !(new = new_trie_node(trie, key)) )
+	return NULL;			/* resource error */
+      new->parent = n;
+    }
 
     if ( children.any )
-    { switch( children.any->type )
+    { switch( trie_children_type(children) )
       { case TN_KEY:
-	{ if ( children.key->key == key )
-	  { return children.key->child;
-	  } else
-	  { trie_children_hashed *hnode;
+	{ trie_node *single = trie_single_child(children);
+	  trie_children_hashed *hnode;
 
-	    if ( !(hnode=alloc_from_pool(trie->alloc_pool, sizeof(*hnode))) )
-	    { destroy_node(trie, new);
-	      return NULL;
-	    }
-
-	    hnode->type     = TN_HASHED;
-	    hnode->table    = newHTable(4);
-	    hnode->var_mask = 0;
-	    addHTable(hnode->table, (void*)children.key->key,
-				    children.key->child);
-	    addHTable(hnode->table, (void*)key, (void*)new);
-	    update_var_mask(hnode, children.key->key);
-	    update_var_mask(hnode, new->key);
-	    new->parent = n;
-
-	    if ( COMPARE_AND_SWAP_PTR(&n->children.hash, children.hash, hnode) )
-	    { hnode->old_single = children.key;			/* See (*) */
-	      return new;
-	    } else
-	    { hnode->old_single = NULL;
-	      destroy_node(trie, new);
-	      destroyHTable(hnode->table);
-	      free_to_pool(trie->alloc_pool, hnode, sizeof(*hnode));
-	      continue;
-	    }
+	  if ( !(hnode=alloc_from_pool(trie->alloc_pool, sizeof(*hnode))) )
+	  { destroy_node(trie, new);
+	    return NULL;
 	  }
+
+	  hnode->type     = TN_HASHED;
+	  hnode->table    = newHTable(4);
+	  hnode->var_mask = 0;
+	  addHTable(hnode->table, (void*)single->key, single);
+	  addHTable(hnode->table, (void*)key, (void*)new);
+	  update_var_mask(hnode, single->key);
+	  update_var_mask(hnode, new->key);
+
+	  if ( COMPARE_AND_SWAP_PTR(&n->children.hash, children.hash, hnode) )
+	    return new;
+
+	  destroyHTable(hnode->table);
+	  free_to_pool(trie->alloc_pool, hnode, sizeof(*hnode));
+	  continue;
 	}
 	case TN_HASHED:
-	{ trie_node *old = addHTable(children.hash->table,
-				     (void*)key, (void*)new);
+	{ trie_node *old;
 
-	  if ( new == old )
-	  { new->parent = n;
-	    update_var_mask(children.hash, new->key);
-	  } else
-	  { destroy_node(trie, new);
-	  }
+	  update_var_mask(children.hash, new->key);
+	  old = addHTable(children.hash->table, (void*)key, (void*)new);
+	  if ( new != old )
+	    destroy_node(trie, new);
 	  return old;
 	}
 	default:
 	  assert(0);
       }
     } else
-    { trie_children_key *child;
-
-      if ( !(child=alloc_from_pool(trie->alloc_pool, sizeof(*child))) )
-      { destroy_node(trie, new);
-	return NULL;
-      }
-
-      child->type  = TN_KEY;
-      child->key   = key;
-      child->child = new;
+    { void *single = (void*)((uintptr_t)new | TN_SINGLE_TAG);
 
-      if ( COMPARE_AND_SWAP_PTR(&n->children.key, NULL, child) )
-      { child->child->parent = n;
-	return child->child;
-      }
-      destroy_node(trie, new);
-      free_to_pool(trie->alloc_pool, child, sizeof(*child));
+      if ( COMPARE_AND_SWAP_PTR(&n->children.any, NULL, single) )
+	return new;
     }
   }
 }
@@ -790,6 +772,225 @@ trie_lookup_abstract(trie *trie, trie_node *node, trie_node **nodep,
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Find the terms in `trie` that subsume `k`.  This walks the trie as if we
+look up `k`, but at each point a variable  key of the trie may also match
+the entire subterm of `k`.  A new trie   variable  binds to this subterm,
+while a trie variable that appeared before   must match a subterm that is
+== to its binding.  A variable of `k` only matches a variable key.  Only
+the children that match the current  subterm   or  are a variable key are
+visited, so the search uses the  hashed   children  of the trie the same
+way as trie_lookup().
+
+For each leaf with a value, `func` is called.  If it returns TRUE, the
+search stops and trie_lookup_subsuming() returns TRUE.  If no leaf is
+accepted, it returns FALSE.
+
+The term agenda is emulated by   sub_frame  objects, which are immutable
+after creation and refer to their parent   by index.  This allows for
+resuming the walk on backtracking into a choice for a variable key.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct sub_frame
+{ Word		location;		/* next argument */
+  size_t	size;			/* # arguments left */
+  size_t	depth;			/* # compounds closed after this */
+  size_t	parent;			/* index+1 of parent frame (0: none) */
+} sub_frame;
+
+typedef struct sub_state
+{ trie	       *trie;			/* trie we are searching */
+  tmp_buffer	frames;			/* sub_frame stack */
+  tmp_buffer	bindings;		/* Word: binding of trie var N+1 */
+  int	      (*func)(trie_node *n, void *ctx);
+  void	       *ctx;
+} sub_state;
+
+#define TRIE_VAR_KEY(n) ((((word)(n))<<LMASK_BITS)|TAG_VAR)
+
+static int
+has_var_child(trie_node *n, size_t vn)
+{ trie_children children = n->children;
+
+  switch( trie_children_type(children) )
+  { case TN_KEY:
+      return trie_single_child(children)->key == TRIE_VAR_KEY(vn);
+    case TN_HASHED:
+    { unsigned mask = children.hash->var_mask;
+
+      if ( vn < VMASKBITS )
+	return (mask & (0x1<<(vn-1))) != 0;
+      return (mask & VMASK_SCAN) != 0;
+    }
+    default:
+      assert(0);
+      return FALSE;
+  }
+}
+
+static int
+has_var_children(trie_node *n)
+{ trie_children children = n->children;
+
+  switch( trie_children_type(children) )
+  { case TN_KEY:
+      return tagex(trie_single_child(children)->key) == TAG_VAR;
+    case TN_HASHED:
+      return children.hash->var_mask != 0;
+    default:
+      assert(0);
+      return FALSE;
+  }
+}
+
+static int
+subsuming_walk(sub_state *state, trie_node *node, sub_frame work ARG_LD)
+{ for(;;)
+  { Word p;
+    word key;
+
+    while ( work.size == 0 )
+    { if ( work.depth > 0 )
+      { size_t popn = work.depth;
+
+	work.depth = 0;
+	if ( !work.parent )
+	  break;
+	if ( !(node = get_child(node, TRIE_KEY_POP(popn) PASS_LD)) )
+	  return FALSE;
+      } else if ( work.parent )
+      { work = fetchBuffer(&state->frames, work.parent-1, sub_frame);
+      } else
+	break;
+    }
+    if ( work.size == 0 )
+      return node->value && (*state->func)(node, state->ctx);
+
+    if ( !node->children.any )
+      return FALSE;
+
+    p = work.location++;
+    work.size--;
+    deRef(p);
+
+    if ( has_var_children(node) )
+    { size_t nvars = entriesBuffer(&state->bindings, Word);
+      size_t vn;
+      trie_node *child;
+
+      if ( !canBind(*p) )		/* try the exact key first */
+      { size_t ftop = entriesBuffer(&state->frames, sub_frame);
+	sub_frame w2 = work;
+	int rc = FALSE;
+
+	key = 0;
+	if ( isTerm(*p) )
+	{ Functor f = valueTerm(*p);
+
+	  key = f->definition;
+	  if ( work.size > 0 )
+	  { addBuffer(&state->frames, work, sub_frame);
+	    w2.parent = ftop+1;
+	    w2.depth  = 1;
+	  } else
+	  { w2.depth++;
+	  }
+	  w2.location = f->arguments;
+	  w2.size     = arityFunctor(key);
+	} else if ( isIndirect(*p) )
+	{ key = trie_intern_indirect(state->trie, *p, FALSE PASS_LD);
+	} else
+	{ key = *p;
+	}
+
+	if ( key && (child=get_child(node, key PASS_LD)) )
+	  rc = subsuming_walk(state, child, w2 PASS_LD);
+	seekBuffer(&state->frames, ftop, sub_frame);
+	if ( rc )
+	  return rc;
+      } else if ( tag(*p) == TAG_ATTVAR )
+      { return FALSE;
+      }
+
+      for(vn=1; vn <= nvars; vn++)	/* a trie variable we have seen */
+      { Word b = fetchBuffer(&state->bindings, vn-1, Word);
+
+	if ( (b == p || (!canBind(*p) && !canBind(*b) &&
+			 compareStandard(p, b, TRUE PASS_LD) == CMP_EQUAL)) &&
+	     has_var_child(node, vn) &&
+	     (child=get_child(node, TRIE_VAR_KEY(vn) PASS_LD)) &&
+	     subsuming_walk(state, child, work PASS_LD) )
+	  return TRUE;
+      }
+
+      if ( has_var_child(node, nvars+1) &&	/* a new trie variable */
+	   (child=get_child(node, TRIE_VAR_KEY(nvars+1) PASS_LD)) )
+      { int rc;
+
+	addBuffer(&state->bindings, p, Word);
+	rc = subsuming_walk(state, child, work PASS_LD);
+	seekBuffer(&state->bindings, nvars, Word);
+
+	return rc;
+      }
+
+      return FALSE;
+    } else				/* only the exact key */
+    { if ( canBind(*p) )
+	return FALSE;
+
+      if ( isTerm(*p) )
+      { Functor f = valueTerm(*p);
+
+	key = f->definition;
+	if ( work.size > 0 )
+	{ size_t ftop = entriesBuffer(&state->frames, sub_frame);
+
+	  addBuffer(&state->frames, work, sub_frame);
+	  work.parent = ftop+1;
+	  work.depth  = 1;
+	} else
+	{ work.depth++;
+	}
+	work.location = f->arguments;
+	work.size     = arityFunctor(key);
+      } else if ( isIndirect(*p) )
+      { if ( !(key = trie_intern_indirect(state->trie, *p, FALSE PASS_LD)) )
+	  return FALSE;
+      } else
+      { key = *p;
+      }
+
+      if ( !(node = get_child(node, key PASS_LD)) )
+	return FALSE;
+    }
+  }
+}
+
+
+int
+trie_lookup_subsuming(trie *trie, Word k,
+		      int (*func)(trie_node *n, void *ctx), void *ctx ARG_LD)
+{ sub_state state;
+  sub_frame work = { .location = k, .size = 1 };
+  int rc;
+
+  if ( !is_acyclic(k PASS_LD) )
+    return FALSE;
+
+  state.trie = trie;
+  state.func = func;
+  state.ctx  = ctx;
+  initBuffer(&state.frames);
+  initBuffer(&state.bindings);
+  rc = subsuming_walk(&state, &trie->root, work PASS_LD);
+  discardBuffer(&state.frames);
+  discardBuffer(&state.bindings);
+
+  return rc;
+}
+
+
 trie *
 get_trie_from_node(trie_node *node)
 { trie *trie_ptr;
@@ -933,9 +1134,9 @@ next:
     return rc;
 
   if ( children.any  )
-  { switch( children.any->type )
+  { switch( trie_children_type(children) )
     { case TN_KEY:
-      { n = children.key->child;
+      { n = trie_single_child(children);
 	goto next;
       }
       case TN_HASHED:
@@ -979,9 +1180,8 @@ stat_node(trie_node *n, void *ctx)
     stats->values++;
 
   if ( children.any )
-  { switch( children.any->type )
+  { switch( trie_children_type(children) )
     { case TN_KEY:
-	stats->bytes += sizeof(*children.key);
         break;
       case TN_HASHED:
 	stats->bytes += sizeofTable(children.hash->table);
@@ -1232,28 +1432,29 @@ put_trie_value(term_t t, trie_node *node ARG_LD)
 
 int
 set_trie_value_word(trie *trie, trie_node *node, word val)
-{ if ( node->value )
-  { if ( !equal_value(node->value, val) )
-    { word old = node->value;
+{ word old;
 
-      acquire_key(val);
-      node->value = val;
-      set(node, TN_PRIMARY);
-      release_value(old);
+  acquire_key(val);
+  for(;;)
+  { if ( (old=node->value) )
+    { if ( equal_value(old, val) )
+      { release_key(val);
+	return FALSE;
+      }
+      if ( COMPARE_AND_SWAP_WORD(&node->value, old, val) )
+      { set(node, TN_PRIMARY);
+	release_value(old);
+	trie_discard_clause(trie);
+
+	return TRUE;
+      }
+    } else if ( COMPARE_AND_SWAP_WORD(&node->value, 0, val) )
+    { set(node, TN_PRIMARY);
+      ATOMIC_INC(&trie->value_count);
       trie_discard_clause(trie);
 
       return TRUE;
-    } else
-    { return FALSE;
     }
-  } else
-  { acquire_key(val);
-    node->value = val;
-    set(node, TN_PRIMARY);
-    ATOMIC_INC(&trie->value_count);
-    trie_discard_clause(trie);
-
-    return TRUE;
   }
 }
 
@@ -1338,27 +1539,33 @@ trie_insert(term_t Trie, term_t Key, term_t Value, trie_node **nodep,
     if ( (rc=trie_lookup_abstract(trie, NULL, &node, kp,
 				  TRUE, abstract, NULL PASS_LD)) == TRUE )
     { word val = intern_value(Value PASS_LD);
+      word old;
 
       if ( nodep )
 	*nodep = node;
 
-      if ( node->value )
-      { if ( update )
-	{ if ( !equal_value(node->value, val) )
-	  { word old = node->value;
-
-	    acquire_key(val);
-	    node->value = val;
+      acquire_key(val);
+      for(;;)
+      { if ( !(old=node->value) )
+	{ if ( COMPARE_AND_SWAP_WORD(&node->value, 0, val) )
+	    break;
+	} else if ( update )
+	{ if ( !equal_value(old, val) )
+	  { if ( !COMPARE_AND_SWAP_WORD(&node->value, old, val) )
+	      continue;
 	    set(node, TN_PRIMARY);
 	    release_value(old);
 	    trie_discard_clause(trie);
-	  } else if ( isRecord(val) )
-	  { PL_erase((record_t)val);
+	  } else
+	  { release_key(val);
+	    if ( isRecord(val) )
+	      PL_erase((record_t)val);
 	  }
 
 	  return TRUE;
 	} else
-	{ if ( !equal_value(node->value, val) )
+	{ release_key(val);
+	  if ( !equal_value(old, val) )
 	    PL_permission_error("modify", "trie_key", Key);
 	  if ( isRecord(val) )
 	    PL_erase((record_t)val);
@@ -1366,8 +1573,6 @@ trie_insert(term_t Trie, term_t Key, term_t Value, trie_node **nodep,
 	  return FALSE;
 	}
       }
-      acquire_key(val);
-      node->value = val;
       set(node, TN_PRIMARY);
       ATOMIC_INC(&trie->value_count);
       trie_discard_clause(trie);
@@ -1932,24 +2137,24 @@ add_choice(trie_gen_state *state, descent_state *dstate, trie_node *node ARG_LD)
     has_key = FALSE;
 
   if ( children.any && false(node, state->vflags) )
-  { switch( children.any->type )
+  { switch( trie_children_type(children) )
     { case TN_KEY:
 	if ( !has_key ||
-	     k == children.key->key ||
-	     tagex(children.key->key) == TAG_VAR ||
-	     IS_TRIE_KEY_POP(children.key->key) )
-	{ word key = children.key->key;
+	     k == trie_single_child(children)->key ||
+	     tagex(trie_single_child(children)->key) == TAG_VAR ||
+	     IS_TRIE_KEY_POP(trie_single_child(children)->key) )
+	{ word key = trie_single_child(children)->key;
 
-	  if ( tagex(children.key->key) == TAG_VAR )
+	  if ( tagex(trie_single_child(children)->key) == TAG_VAR )
 	    dstate->prune = FALSE;
 
 	  ch = allocFromBuffer(&state->choicepoints, sizeof(*ch));
 	  ch->key        = key;
-	  ch->child      = children.key->child;
+	  ch->child      = trie_single_child(children);
 	  ch->table_enum = NULL;
 	  ch->table      = NULL;
 
-	  if ( IS_TRIE_KEY_POP(children.key->key) && dstate->compound )
+	  if ( IS_TRIE_KEY_POP(trie_single_child(children)->key) && dstate->compound )
 	  { desc_tstate dts;
 	    popSegStack(&dstate->stack, &dts, desc_tstate);
 	    dstate->term = dts.term;
@@ -2326,12 +2531,20 @@ PRED_IMPL("$trie_property", 2, trie_property, 0)
   static atom_t ATOM_gen_call_count = 0;
   static atom_t ATOM_invalidated = 0;
   static atom_t ATOM_reevaluated = 0;
+  static atom_t ATOM_duplicate_count = 0;
+  static atom_t ATOM_suspension_count = 0;
+  static atom_t ATOM_completion_count = 0;
+  static atom_t ATOM_eval_time = 0;
 
   if ( !ATOM_lookup_count )
-  { ATOM_lookup_count   = PL_new_atom("lookup_count");
-    ATOM_gen_call_count = PL_new_atom("gen_call_count");
-    ATOM_invalidated    = PL_new_atom("invalidated");
-    ATOM_reevaluated    = PL_new_atom("reevaluated");
+  { ATOM_duplicate_count  = PL_new_atom("duplicate_count");
+    ATOM_suspension_count = PL_new_atom("suspension_count");
+    ATOM_completion_count = PL_new_atom("completion_count");
+    ATOM_eval_time        = PL_new_atom("eval_time");
+    ATOM_invalidated      = PL_new_atom("invalidated");
+    ATOM_reevaluated      = PL_new_atom("reevaluated");
+    ATOM_gen_call_count   = PL_new_atom("gen_call_count");
+    ATOM_lookup_count     = PL_new_atom("lookup_count");
   }
 #endif
 
@@ -2379,6 +2592,14 @@ PRED_IMPL("$trie_property", 2, trie_property, 0)
       { return PL_unify_int64(arg, trie->stats.lookups);
       } else if ( name == ATOM_gen_call_count)
       { return PL_unify_int64(arg, trie->stats.gen_call);
+      } else if ( name == ATOM_duplicate_count )
+      { return PL_unify_int64(arg, trie->stats.duplicates);
+      } else if ( name == ATOM_suspension_count )
+      { return PL_unify_int64(arg, trie->stats.suspensions);
+      } else if ( name == ATOM_completion_count )
+      { return PL_unify_int64(arg, trie->stats.completions);
+      } else if ( name == ATOM_eval_time )
+      { return PL_unify_float(arg, trie->stats.eval_time);
 #ifdef O_PLMT
       } else if ( name == ATOM_wait )
       { return PL_unify_int64(arg, trie->stats.wait);
@@ -2578,6 +2799,105 @@ fixup_else(trie_compile_state *state)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+If all children of a hashed node are atoms, small integers or functors we
+prefix the T_TRY_* chain with a  T_SWITCH   instruction,  such that
+enumerating the trie with a  partially   instantiated  term jumps to the
+matching child rather than trying all of them.  The table is reserved when
+we start the node and filled  and  sorted   when  we  know  where the
+children start.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct trie_switch_entry
+{ word		key;				/* Key of the child */
+  size_t	offset;				/* Code offset after the key */
+} trie_switch_entry;
+
+typedef struct trie_switch
+{ trie_switch_entry *table;			/* Entries */
+  size_t	count;				/* #entries added */
+  size_t	size;				/* #children */
+  size_t	loc;				/* Location of the table */
+} trie_switch;
+
+static int
+is_switch_key(word key)
+{ switch(tagex(key))
+  { case TAG_ATOM:
+    case TAG_ATOM|STG_GLOBAL:
+    case TAG_INTEGER:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+static int
+switch_trie_children(Table table, trie_switch *sw, trie_compile_state *state)
+{ TableEnum e = newTableEnum(table);
+  void *k, *v;
+  size_t i, count = 0;
+
+  memset(sw, 0, sizeof(*sw));
+  while( advanceTableEnum(e, &k, &v) )
+  { trie_node *n = v;
+
+    if ( !is_switch_key(n->key) )
+    { freeTableEnum(e);
+      return TRUE;
+    }
+    count++;
+  }
+  freeTableEnum(e);
+
+  if ( count < 2 )
+    return TRUE;
+  if ( !(sw->table = malloc(count*sizeof(*sw->table))) )
+    return PL_no_memory();
+
+  sw->size = count;
+  add_vmi_d(state, T_SWITCH, (code)count);
+  sw->loc = entriesBuffer(&state->codes, code);
+  for(i=0; i<count*2; i++)
+    addBuffer(&state->codes, (code)0, code);
+
+  return TRUE;
+}
+
+static void
+add_switch_entry(trie_switch *sw, trie_node *n, trie_compile_state *state)
+{ trie_switch_entry *se = &sw->table[sw->count++];
+
+  assert(sw->count <= sw->size);
+  se->key    = n->key;			/* skip T_[TRY_]<key> instruction */
+  se->offset = ( entriesBuffer(&state->codes, code) + (state->try ? 3 : 2)
+	       - (sw->loc + sw->size*2) );
+}
+
+static int
+cmp_switch_entry(const void *p1, const void *p2)
+{ const trie_switch_entry *e1 = p1;
+  const trie_switch_entry *e2 = p2;
+
+  return e1->key < e2->key ? -1 : e1->key > e2->key ? 1 : 0;
+}
+
+static void
+fixup_switch(trie_switch *sw, trie_compile_state *state)
+{ Code table = baseBuffer(&state->codes, code) + sw->loc;
+  size_t i;
+
+  assert(sw->count == sw->size);
+  qsort(sw->table, sw->count, sizeof(*sw->table), cmp_switch_entry);
+  for(i=0; i<sw->count; i++)
+  { table[i*2]   = (code)sw->table[i].key;
+    table[i*2+1] = (code)sw->table[i].offset;
+  }
+  free(sw->table);
+  sw->table = NULL;
+}
+
+
 static int
 compile_trie_value(Word v, trie_compile_state *state ARG_LD)
 { term_agenda_P agenda;
@@ -2811,17 +3131,21 @@ next:
 
 children:
   if ( children.any && false(n, TN_PRIMARY|TN_SECONDARY) )
-  { switch( children.any->type )
+  { switch( trie_children_type(children) )
     { case TN_KEY:
       { state->try = FALSE;
-	n = children.key->child;
+	n = trie_single_child(children);
 	goto next;
       }
       case TN_HASHED:
       { Table table = children.hash->table;
-	TableEnum e = newTableEnum(table);
+	TableEnum e;
 	void *k, *v;
+	trie_switch sw;
 
+	if ( !switch_trie_children(table, &sw, state) )
+	  return FALSE;
+	e = newTableEnum(table);
 	if ( !advanceTableEnum(e, &k, &v) )
 	{ freeTableEnum(e);
 	  return TRUE;				/* empty path */
@@ -2830,13 +3154,20 @@ children:
 	for(;;)
 	{ n = v;
 
-	  if ( !(state->try = advanceTableEnum(e, &k, &v)) )
+	  state->try = advanceTableEnum(e, &k, &v);
+	  if ( sw.table )
+	    add_switch_entry(&sw, n, state);
+	  if ( !state->try )
 	  { freeTableEnum(e);
+	    if ( sw.table )
+	      fixup_switch(&sw, state);
 	    goto next;
 	  }
 
 	  if ( (rc=compile_trie_node(n, state PASS_LD)) != TRUE )
 	  { freeTableEnum(e);
+	    if ( sw.table )
+	      free(sw.table);
 	    return rc;
 	  }
 	  fixup_else(state);
@@ -2891,7 +3222,7 @@ create_trie_clause(Definition def, Clause *cp, trie_compile_state *state)
   //size_t clsize    = size + SIZEOF_CREF_CLAUSE;
   Clause cl;
 
-  cl = PL_malloc_atomic(size);
+  cl = arena_alloc(size);
   memset(cl, 0, sizeof(*cl));
   cl->predicate = def;
   cl->code_size = code_size;
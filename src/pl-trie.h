@@ -53,22 +53,25 @@ typedef struct try_children_any
 { tn_node_type type;
 } try_children_any;
 
-typedef struct trie_children_key
-{ tn_node_type type;
-  word key;
-  struct trie_node *child;
-} trie_children_key;
-
 typedef struct trie_children_hashed
 { tn_node_type	type;			/* TN_HASHED */
   Table		table;			/* Key --> child map */
   unsigned	var_mask;		/* Variables in this place */
-  trie_children_key *old_single;	/* Old single node */
 } trie_children_hashed;
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A node with a single child  (TN_KEY)  does   not  use  a separate  child
+object: `children.any` holds the child node itself, tagged with the low
+bit (TN_SINGLE_TAG).  The key is the key of the child.  Most nodes of a
+large answer trie have a single child, so this avoids an allocation and
+a pointer indirection for most nodes.  Use trie_children_type() and
+trie_single_child() to examine the children.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define TN_SINGLE_TAG	0x1
+
 typedef union trie_children
 { try_children_any     *any;
-  trie_children_key    *key;
   trie_children_hashed *hash;
 } trie_children;
 
@@ -95,6 +98,18 @@ typedef struct trie_node
   unsigned		flags;		/* TN_* */
 } trie_node;
 
+static inline tn_node_type
+trie_children_type(trie_children children)
+{ if ( ((uintptr_t)children.any & TN_SINGLE_TAG) )
+    return TN_KEY;
+  return children.any->type;
+}
+
+static inline trie_node *
+trie_single_child(trie_children children)
+{ return (trie_node*)((uintptr_t)children.any & ~(uintptr_t)TN_SINGLE_TAG);
+}
+
 #define TRIE_ISSET	0x0001		/* Trie nodes have no value */
 #define TRIE_ISMAP	0x0002		/* Trie nodes have a value */
 #define TRIE_ISSHARED	0x0004		/* This is a shared answer trie */
@@ -120,6 +135,10 @@ typedef struct trie
   struct
   { uint64_t		lookups;	/* trie_lookup */
     uint64_t		gen_call;	/* trie_gen calls */
+    uint64_t		duplicates;	/* answers that were already there */
+    uint64_t		suspensions;	/* consumers suspended on the table */
+    uint64_t		completions;	/* times the table was completed */
+    double		eval_time;	/* Wall time creation ... completion */
 #ifdef O_PLMT
     unsigned int	deadlock;	/* times involved in a deadlock */
     unsigned int	wait;		/* times waited for */
@@ -130,6 +149,10 @@ typedef struct trie
   { struct worklist *worklist;		/* tabling worklist */
     trie_node	    *variant;		/* node in variant trie */
     struct idg_node *IDG;		/* Node in the IDG graph */
+    uint64_t	     accessed;		/* Last access (LRU eviction) */
+#ifdef O_PLMT
+    int		     streaming;		/* # threads streaming answers */
+#endif
   } data;
 } trie;
 
@@ -176,6 +199,9 @@ COMMON(int)	trie_lookup_abstract(trie *trie,
 				     trie_node *root, trie_node **nodep, Word k,
 				     int add, size_abstract *abstract,
 				     TmpBuffer vars ARG_LD);
+COMMON(int)	trie_lookup_subsuming(trie *trie, Word k,
+				      int (*func)(trie_node *n, void *ctx),
+				      void *ctx ARG_LD);
 COMMON(int)	trie_error(int rc, term_t culprit);
 COMMON(int)	trie_trie_error(int rc, trie *trie);
 COMMON(atom_t)	trie_symbol(trie *trie);
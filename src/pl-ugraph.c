@@ -0,0 +1,682 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, VU University Amsterdam
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pl-incl.h"
+
+#undef LD
+#define LD LOCAL_LD
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Support for library(ugraphs). A ugraph is a list Vertex-Neighbours that
+is ordered by Vertex, where  Neighbours  is   an  ordered  set. The
+predicates below translate the graph into a compact adjacency structure
+(compressed sparse rows:  the  neighbours  of   vertex  I  are  edges
+offsets[I]..offsets[I+1]-1, holding vertex indices),  run the algorithm
+on the indices and translate the result back to terms.
+
+As the order of the vertices is the standard order of terms, ordered
+sets of vertices are simply ascending sets  of indices. The translation
+fails if the graph is not a proper ugraph,   such as when a neighbour is
+not a vertex, after which library(ugraphs) uses the Prolog version.
+
+The vertex pointers are only valid until the next GC. Algorithms first
+compute their result as indices, then  reserve   the  global stack and
+reload the vertex pointers before building the result.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct ugraph
+{ size_t	count;			/* # vertices */
+  Word	       *vertices;		/* Dereferenced vertex terms */
+  size_t       *offsets;		/* count+1 offsets into edges */
+  size_t       *edges;			/* Target vertex indices */
+} ugraph;
+
+
+static inline int
+ug_compare(Word p1, Word p2 ARG_LD)
+{ word w1 = *p1;
+  word w2 = *p2;
+
+  if ( isTaggedInt(w1) && isTaggedInt(w2) )
+  { intptr_t i1 = valInt(w1);
+    intptr_t i2 = valInt(w2);
+
+    return i1 < i2 ? CMP_LESS : i1 == i2 ? CMP_EQUAL : CMP_GREATER;
+  }
+  if ( isAtom(w1) && isAtom(w2) )
+    return w1 == w2 ? CMP_EQUAL : compareAtoms(w1, w2);
+
+  return compareStandard(p1, p2, FALSE PASS_LD);
+}
+
+
+static inline Word
+ug_tail(Word l ARG_LD)
+{ l = TailList(l);
+  deRef(l);
+
+  return l;
+}
+
+
+static void
+free_ugraph(ugraph *g)
+{ free(g->vertices);
+  free(g->offsets);
+  free(g->edges);
+  memset(g, 0, sizeof(*g));
+}
+
+
+static Word
+vertex_pair(Word l, Word *nbs ARG_LD)
+{ Word p = HeadList(l);
+
+  deRef(p);
+  if ( !hasFunctor(*p, FUNCTOR_minus2) )
+    return NULL;
+  p = argTermP(*p, 0);
+  *nbs = p+1;
+  deRef(*nbs);
+  deRef(p);
+
+  return p;
+}
+
+
+/* find_vertex() returns the index of v or -1 */
+
+static ssize_t
+find_vertex(ugraph *g, Word v ARG_LD)
+{ size_t lo = 0, hi = g->count;
+
+  while ( lo < hi )
+  { size_t m = (lo+hi)/2;
+
+    switch( ug_compare(g->vertices[m], v PASS_LD) )
+    { case CMP_LESS:
+	lo = m+1;
+	break;
+      case CMP_EQUAL:
+	return m;
+      case CMP_GREATER:
+	hi = m;
+	break;
+      default:
+	return -1;
+    }
+  }
+
+  return -1;
+}
+
+
+/* get_ugraph() returns TRUE on success, FALSE if t is not a ugraph
+   and -1 after an exception.
+*/
+
+static int
+get_ugraph(term_t t, ugraph *g ARG_LD)
+{ Word l, tail;
+  intptr_t len;
+  size_t i;
+
+  memset(g, 0, sizeof(*g));
+  l = valTermRef(t);
+  deRef(l);
+  len = skip_list(l, &tail PASS_LD);
+  if ( !isNil(*tail) )
+    return FALSE;
+
+  g->count = len;
+  if ( !(g->vertices = malloc((len+1)*sizeof(Word))) ||
+       !(g->offsets  = malloc((len+1)*sizeof(size_t))) )
+  { free_ugraph(g);
+    PL_no_memory();
+    return -1;
+  }
+
+  g->offsets[0] = 0;
+  for(i=0; i<g->count; i++, l = ug_tail(l PASS_LD))
+  { Word v, nbs;
+
+    if ( !(v=vertex_pair(l, &nbs PASS_LD)) ||
+	 (len = skip_list(nbs, &tail PASS_LD), !isNil(*tail)) ||
+	 (i > 0 && ug_compare(g->vertices[i-1], v PASS_LD) != CMP_LESS) )
+    { free_ugraph(g);
+      return FALSE;
+    }
+    g->vertices[i]  = v;
+    g->offsets[i+1] = g->offsets[i]+len;
+  }
+
+  if ( !(g->edges = malloc((g->offsets[g->count]+1)*sizeof(size_t))) )
+  { free_ugraph(g);
+    PL_no_memory();
+    return -1;
+  }
+
+  l = valTermRef(t);
+  deRef(l);
+  for(i=0; i<g->count; i++, l = ug_tail(l PASS_LD))
+  { Word nbs;
+    size_t e = g->offsets[i];
+
+    vertex_pair(l, &nbs PASS_LD);
+    for(; isList(*nbs); nbs = ug_tail(nbs PASS_LD), e++)
+    { Word n = HeadList(nbs);
+      ssize_t ix;
+
+      deRef(n);
+      if ( (ix=find_vertex(g, n PASS_LD)) < 0 ||
+	   (e > g->offsets[i] && (size_t)ix <= g->edges[e-1]) )
+      { free_ugraph(g);
+	return FALSE;
+      }
+      g->edges[e] = ix;
+    }
+  }
+
+  return TRUE;
+}
+
+
+/* reload_vertices() refreshes g->vertices after a possible GC */
+
+static void
+reload_vertices(term_t t, ugraph *g ARG_LD)
+{ Word l = valTermRef(t);
+  size_t i;
+
+  deRef(l);
+  for(i=0; i<g->count; i++, l = ug_tail(l PASS_LD))
+  { Word nbs;
+
+    g->vertices[i] = vertex_pair(l, &nbs PASS_LD);
+  }
+}
+
+
+static int
+reserve_global(term_t graph, ugraph *g, size_t cells ARG_LD)
+{ if ( !hasGlobalSpace(cells) )
+  { int rc;
+
+    if ( (rc=ensureGlobalSpace(cells, ALLOW_GC)) != TRUE )
+      return raiseStackOverflow(rc);
+    reload_vertices(graph, g PASS_LD);
+  }
+
+  return TRUE;
+}
+
+
+static inline word
+vertex_value(ugraph *g, size_t i ARG_LD)
+{ Word v = g->vertices[i];
+
+  return needsRef(*v) ? makeRef(v) : *v;
+}
+
+
+/* Build the list of vertices ix[0..n-1] at p, ending in end.  Returns
+   a pointer past the created cells.
+*/
+
+static Word
+put_vertex_list(ugraph *g, const size_t *ix, size_t n, word end,
+		Word p, word *list ARG_LD)
+{ size_t i;
+
+  if ( n == 0 )
+  { *list = end;
+    return p;
+  }
+  *list = consPtr(p, TAG_COMPOUND|STG_GLOBAL);
+  for(i=0; i<n; i++, p += 3)
+  { p[0] = FUNCTOR_dot2;
+    p[1] = vertex_value(g, ix[i] PASS_LD);
+    p[2] = (i+1 < n ? consPtr(&p[3], TAG_COMPOUND|STG_GLOBAL) : end);
+  }
+
+  return p;
+}
+
+
+		 /*******************************
+		 *	  TOPOLOGICAL SORT	*
+		 *******************************/
+
+/** '$ugraph_top_sort'(+Graph, -Sorted, ?Tail, -Acyclic) is semidet.
+ *
+ * Kahn's algorithm. The zero in-degree vertices are processed as a
+ * stack that initially holds the zero vertices in standard order, such
+ * that the result is the same as for the Prolog implementation. If the
+ * graph is cyclic Acyclic is unified with `false` and Sorted is left
+ * unbound.
+ */
+
+static
+PRED_IMPL("$ugraph_top_sort", 4, ugraph_top_sort, 0)
+{ PRED_LD
+  ugraph g;
+  size_t *indeg = NULL, *stack = NULL, *out = NULL;
+  size_t i, sp = 0, n = 0;
+  int rc;
+
+  if ( (rc=get_ugraph(A1, &g PASS_LD)) != TRUE )
+    return FALSE;
+
+  if ( !(indeg = calloc(g.count+1, sizeof(size_t))) ||
+       !(stack = malloc((g.count+1)*sizeof(size_t))) ||
+       !(out   = malloc((g.count+1)*sizeof(size_t))) )
+  { rc = PL_no_memory();
+    goto out;
+  }
+
+  for(i=0; i<g.offsets[g.count]; i++)
+    indeg[g.edges[i]]++;
+  for(i=g.count; i-- > 0; )
+  { if ( indeg[i] == 0 )
+      stack[sp++] = i;
+  }
+
+  while ( sp > 0 )
+  { size_t v = stack[--sp];
+    size_t e;
+
+    out[n++] = v;
+    for(e=g.offsets[v]; e<g.offsets[v+1]; e++)
+    { if ( --indeg[g.edges[e]] == 0 )
+	stack[sp++] = g.edges[e];
+    }
+  }
+
+  if ( n < g.count )
+  { rc = PL_unify_atom(A4, ATOM_false);
+  } else
+  { term_t r = PL_new_term_ref();
+    term_t tail = PL_new_term_ref();
+
+    if ( n == 0 )
+    { rc = ( PL_unify(A2, A3) &&
+	     PL_unify_atom(A4, ATOM_true) );
+    } else if ( (rc=reserve_global(A1, &g, n*3 PASS_LD)) == TRUE )
+    { Word p = put_vertex_list(&g, out, n, 0, gTop, valTermRef(r) PASS_LD);
+
+      setVar(p[-1]);			/* the open tail */
+      *valTermRef(tail) = makeRefG(&p[-1]);
+      gTop = p;
+      rc = ( PL_unify(A2, r) &&
+	     PL_unify(A3, tail) &&
+	     PL_unify_atom(A4, ATOM_true) );
+    }
+  }
+
+out:
+  free(indeg);
+  free(stack);
+  free(out);
+  free_ugraph(&g);
+
+  return rc;
+}
+
+
+		 /*******************************
+		 *	     REACHABLE		*
+		 *******************************/
+
+/** '$ugraph_reachable'(+Vertex, +Graph, -Vertices) is semidet.
+ *
+ * Vertices is the ordered set of vertices reachable from Vertex,
+ * including Vertex.  Fails if Vertex is not in Graph.
+ */
+
+static
+PRED_IMPL("$ugraph_reachable", 3, ugraph_reachable, 0)
+{ PRED_LD
+  ugraph g;
+  char *seen = NULL;
+  size_t *queue = NULL;
+  size_t qh = 0, qt = 0, i, n;
+  ssize_t start;
+  Word v;
+  int rc;
+
+  if ( (rc=get_ugraph(A2, &g PASS_LD)) != TRUE )
+    return FALSE;
+
+  v = valTermRef(A1);
+  deRef(v);
+  if ( (start=find_vertex(&g, v PASS_LD)) < 0 )
+  { free_ugraph(&g);
+    return FALSE;
+  }
+
+  if ( !(seen  = calloc(g.count+1, sizeof(char))) ||
+       !(queue = malloc((g.count+1)*sizeof(size_t))) )
+  { rc = PL_no_memory();
+    goto out;
+  }
+
+  seen[start] = TRUE;
+  queue[qt++] = start;
+  while ( qh < qt )
+  { size_t u = queue[qh++];
+    size_t e;
+
+    for(e=g.offsets[u]; e<g.offsets[u+1]; e++)
+    { size_t w = g.edges[e];
+
+      if ( !seen[w] )
+      { seen[w] = TRUE;
+	queue[qt++] = w;
+      }
+    }
+  }
+
+  for(i=0, n=0; i<g.count; i++)		/* order by index */
+  { if ( seen[i] )
+      queue[n++] = i;
+  }
+
+  if ( (rc=reserve_global(A2, &g, n*3 PASS_LD)) == TRUE )
+  { term_t r = PL_new_term_ref();
+
+    gTop = put_vertex_list(&g, queue, n, ATOM_nil, gTop, valTermRef(r)
+			   PASS_LD);
+    rc = PL_unify(A3, r);
+  }
+
+out:
+  free(seen);
+  free(queue);
+  free_ugraph(&g);
+
+  return rc;
+}
+
+
+		 /*******************************
+		 *	 TRANSITIVE CLOSURE	*
+		 *******************************/
+
+/* Tarjan's algorithm, without recursion. Components are numbered in
+   the order they are completed, which is a reverse topological order:
+   all components reachable from a component have a lower number.
+*/
+
+typedef struct scc_state
+{ size_t *index;			/* DFS number+1 of vertex (0: new) */
+  size_t *low;				/* lowest reachable DFS number */
+  size_t *comp;				/* component of vertex */
+  size_t *stack;			/* Tarjan's vertex stack */
+  size_t *cstack;			/* DFS call stack: vertices */
+  size_t *epos;				/* DFS call stack: next edge */
+  char	 *onstack;
+  size_t  ncomp;
+} scc_state;
+
+#define NO_COMP ((size_t)-1)
+
+static void
+ugraph_scc(ugraph *g, scc_state *s)
+{ size_t next = 0, sp = 0;
+  size_t root;
+
+  s->ncomp = 0;
+  for(root=0; root<g->count; root++)
+  { size_t csp = 0;
+
+    if ( s->index[root] )
+      continue;
+
+    s->cstack[csp] = root;
+    s->epos[csp++] = g->offsets[root];
+    s->index[root] = s->low[root] = ++next;
+    s->stack[sp++] = root;
+    s->onstack[root] = TRUE;
+
+    while ( csp > 0 )
+    { size_t v = s->cstack[csp-1];
+
+      if ( s->epos[csp-1] < g->offsets[v+1] )
+      { size_t w = g->edges[s->epos[csp-1]++];
+
+	if ( !s->index[w] )
+	{ s->index[w] = s->low[w] = ++next;
+	  s->stack[sp++] = w;
+	  s->onstack[w] = TRUE;
+	  s->cstack[csp] = w;
+	  s->epos[csp++] = g->offsets[w];
+	} else if ( s->onstack[w] && s->index[w] < s->low[v] )
+	{ s->low[v] = s->index[w];
+	}
+      } else
+      { if ( s->low[v] == s->index[v] )
+	{ size_t w;
+
+	  do
+	  { w = s->stack[--sp];
+	    s->onstack[w] = FALSE;
+	    s->comp[w] = s->ncomp;
+	  } while ( w != v );
+	  s->ncomp++;
+	}
+	if ( --csp > 0 )
+	{ size_t u = s->cstack[csp-1];
+
+	  if ( s->low[v] < s->low[u] )
+	    s->low[u] = s->low[v];
+	}
+      }
+    }
+  }
+}
+
+
+static int
+cmp_size_t(const void *p1, const void *p2)
+{ size_t i1 = *(const size_t*)p1;
+  size_t i2 = *(const size_t*)p2;
+
+  return i1 < i2 ? -1 : i1 > i2 ? 1 : 0;
+}
+
+
+/** '$ugraph_transitive_closure'(+Graph, -Closure) is semidet.
+ *
+ * Closure holds an edge V-W if there is a  path of at least one edge
+ * from V to W in Graph. The strongly connected components are computed
+ * first. All vertices of a component share  the same set of reachable
+ * vertices, which is computed once  from   the  sets of the successor
+ * components and is shared by the resulting neighbour lists.
+ */
+
+static
+PRED_IMPL("$ugraph_transitive_closure", 2, ugraph_transitive_closure, 0)
+{ PRED_LD
+  ugraph g;
+  scc_state s;
+  size_t **reach = NULL;		/* component --> sorted vertices */
+  size_t *rlen = NULL;
+  size_t *members = NULL, *mstart = NULL, *stamp = NULL, *buf = NULL;
+  size_t i, c, cells;
+  int rc;
+
+  if ( (rc=get_ugraph(A1, &g PASS_LD)) != TRUE )
+    return FALSE;
+
+  memset(&s, 0, sizeof(s));
+  if ( !(s.index   = calloc(g.count+1, sizeof(size_t))) ||
+       !(s.low     = malloc((g.count+1)*sizeof(size_t))) ||
+       !(s.comp    = malloc((g.count+1)*sizeof(size_t))) ||
+       !(s.stack   = malloc((g.count+1)*sizeof(size_t))) ||
+       !(s.cstack  = malloc((g.count+1)*sizeof(size_t))) ||
+       !(s.epos    = malloc((g.count+1)*sizeof(size_t))) ||
+       !(s.onstack = calloc(g.count+1, sizeof(char))) )
+  { rc = PL_no_memory();
+    goto out;
+  }
+  ugraph_scc(&g, &s);
+
+  if ( !(reach   = calloc(s.ncomp+1, sizeof(size_t*))) ||
+       !(rlen    = calloc(s.ncomp+1, sizeof(size_t))) ||
+       !(mstart  = calloc(s.ncomp+2, sizeof(size_t))) ||
+       !(members = malloc((g.count+1)*sizeof(size_t))) ||
+       !(stamp   = malloc((g.count+1)*sizeof(size_t))) ||
+       !(buf     = malloc((g.count+1)*sizeof(size_t))) )
+  { rc = PL_no_memory();
+    goto out;
+  }
+
+  for(i=0; i<g.count; i++)		/* members by component */
+    mstart[s.comp[i]+2]++;
+  for(c=0; c<s.ncomp; c++)
+    mstart[c+2] += mstart[c+1];
+  for(i=0; i<g.count; i++)
+    members[mstart[s.comp[i]+1]++] = i;
+  for(i=0; i<g.count; i++)
+    stamp[i] = NO_COMP;
+
+  for(c=0; c<s.ncomp; c++)		/* successors have lower numbers */
+  { size_t n = 0, m;
+    int cyclic = FALSE;
+
+#define ADD_VERTEX(w) \
+	do { if ( stamp[w] != c ) { stamp[w] = c; buf[n++] = w; } } while(0)
+
+    for(m=mstart[c]; m<mstart[c+1]; m++)
+    { size_t u = members[m];
+      size_t e;
+
+      for(e=g.offsets[u]; e<g.offsets[u+1]; e++)
+      { size_t w = g.edges[e];
+	size_t d = s.comp[w];
+
+	if ( d == c )
+	{ cyclic = TRUE;
+	} else
+	{ size_t k;
+
+	  for(k=mstart[d]; k<mstart[d+1]; k++)
+	    ADD_VERTEX(members[k]);
+	  for(k=0; k<rlen[d]; k++)
+	    ADD_VERTEX(reach[d][k]);
+	}
+      }
+    }
+    if ( cyclic )
+    { for(m=mstart[c]; m<mstart[c+1]; m++)
+	ADD_VERTEX(members[m]);
+    }
+#undef ADD_VERTEX
+
+    qsort(buf, n, sizeof(size_t), cmp_size_t);
+    if ( n > 0 )
+    { if ( !(reach[c] = malloc(n*sizeof(size_t))) )
+      { rc = PL_no_memory();
+	goto out;
+      }
+      memcpy(reach[c], buf, n*sizeof(size_t));
+    }
+    rlen[c] = n;
+
+    if ( c % 1000 == 999 && PL_handle_signals() < 0 )
+    { rc = FALSE;
+      goto out;
+    }
+  }
+
+  for(cells=g.count*6, c=0; c<s.ncomp; c++)
+    cells += rlen[c]*3;
+
+  if ( (rc=reserve_global(A1, &g, cells PASS_LD)) == TRUE )
+  { term_t r = PL_new_term_ref();
+    word *lists = (word*)buf;		/* component --> closure list */
+    Word p = gTop;
+    Word tail = valTermRef(r);
+
+    assert(sizeof(word) == sizeof(size_t));
+    for(c=0; c<s.ncomp; c++)
+      p = put_vertex_list(&g, reach[c], rlen[c], ATOM_nil, p, &lists[c]
+			  PASS_LD);
+    for(i=0; i<g.count; i++, p += 6)
+    { *tail = consPtr(p, TAG_COMPOUND|STG_GLOBAL);
+      p[0] = FUNCTOR_dot2;
+      p[1] = consPtr(&p[3], TAG_COMPOUND|STG_GLOBAL);
+      p[3] = FUNCTOR_minus2;
+      p[4] = vertex_value(&g, i PASS_LD);
+      p[5] = lists[s.comp[i]];
+      tail = &p[2];
+    }
+    *tail = ATOM_nil;
+    gTop = p;
+    rc = PL_unify(A2, r);
+  }
+
+out:
+  if ( reach )
+  { for(c=0; c<s.ncomp; c++)
+      free(reach[c]);
+    free(reach);
+  }
+  free(rlen);
+  free(mstart);
+  free(members);
+  free(stamp);
+  free(buf);
+  free(s.index);
+  free(s.low);
+  free(s.comp);
+  free(s.stack);
+  free(s.cstack);
+  free(s.epos);
+  free(s.onstack);
+  free_ugraph(&g);
+
+  return rc;
+}
+
+
+		 /*******************************
+		 *      PUBLISH PREDICATES	*
+		 *******************************/
+
+BeginPredDefs(ugraph)
+  PRED_DEF("$ugraph_top_sort",		 4, ugraph_top_sort,	       0)
+  PRED_DEF("$ugraph_reachable",		 3, ugraph_reachable,	       0)
+  PRED_DEF("$ugraph_transitive_closure", 2, ugraph_transitive_closure, 0)
+EndPredDefs
@@ -723,6 +723,93 @@ VMI(H_RLIST, 0, 0, ())
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+H_CODES and H_RCODES: Match a  prefix   of  a  code  list  in  one step.
+Generated for body unifications with a  list   whose  first N cells hold
+character codes in the range 0..255,   notably  the unifications created
+for DCG literals. The codes are  represented   as  an inlined byte string.
+Semantically this is N times H_RLIST  followed   by  H_SMALLINT. After
+the instruction ARGP points at the tail  of   the  last  cell. If we hit
+an unbound tail we create the remaining   cells  and continue in write
+mode, which also makes this work for lazy lists.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+VMI(H_CODES, 0, VM_DYNARGC, (CA1_STRING))
+{ pushArgumentStack((Word)((intptr_t)(ARGP + 1)|umode));
+
+  VMI_GOTO(H_RCODES);
+}
+
+
+VMI(H_RCODES, 0, VM_DYNARGC, (CA1_STRING))
+{ word m = *PC;
+  size_t len = wsizeofInd(m)*sizeof(word) - padHdr(m) - 1;
+  const unsigned char *s = (const unsigned char *)(PC+1) + 1; /* skip 'B' */
+  const unsigned char *e = s+len;
+  Word p, ap;
+  word l;
+
+  PC += wsizeofInd(m)+1;
+
+  if ( umode == uwrite )
+  { ENSURE_GLOBAL_SPACE(3*len, (void)0);
+    p = ARGP;
+  } else
+  { for(;;)
+    { word w;
+
+      deRef2(ARGP, p);
+      w = *p;
+      if ( isTerm(w) )
+      { Word h;
+	word c = consInt(*s);
+
+	if ( functorTerm(w) != FUNCTOR_dot2 )
+	  CLAUSE_FAILED;
+	ARGP = argTermP(w, 0);
+	deRef2(ARGP, h);
+	if ( *h != c )
+	{ if ( !canBind(*h) )
+	    CLAUSE_FAILED;
+	  ENSURE_GLOBAL_SPACE(0, deRef2(ARGP, h));
+	  bindConst(h, c);
+	}
+	ARGP++;
+	if ( ++s == e )
+	  NEXT_INSTRUCTION;
+	continue;
+      }
+      if ( !canBind(w) )
+	CLAUSE_FAILED;
+      ENSURE_GLOBAL_SPACE(3*(e-s), deRef2(ARGP, p));
+      break;
+    }
+  }
+
+  ap = gTop;				/* create the remaining cells */
+  l = consPtr(ap, TAG_COMPOUND|STG_GLOBAL);
+  for(;;)
+  { *ap++ = FUNCTOR_dot2;
+    *ap++ = consInt(*s);
+    if ( ++s == e )
+      break;
+    *ap = consPtr(ap+1, TAG_COMPOUND|STG_GLOBAL);
+    ap++;
+  }
+  setVar(*ap);
+  ARGP = ap;
+  gTop = ap+1;
+
+  if ( umode == uwrite )
+  { *p = l;
+  } else
+  { bindConst(p, l);
+    umode = uwrite;
+  }
+  NEXT_INSTRUCTION;
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 H_POP: Pop the saved argument pointer pushed by H_FUNCTOR and H_LIST.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
@@ -1550,6 +1637,8 @@ retry_continue:
   FR->prof_node = NULL;
 #endif
   LD->statistics.inferences++;
+  if ( unlikely(DEF->call_counts != NULL) )
+    countCall(FR PASS_LD);
 
 #ifdef O_DEBUGLOCAL
 { Word ap = argFrameP(FR, DEF->functor->arity);
@@ -1596,6 +1685,10 @@ retry_continue:
     }
 
     Profile(FR->prof_node = profCall(DEF PASS_LD));
+#ifdef O_PROFILE
+    if ( LD->profile.alloc.active )
+      profAllocCheck(FR PASS_LD);
+#endif
 
 #ifdef O_LIMIT_DEPTH
     { unsigned int depth = levelFrame(FR);
@@ -1673,10 +1766,15 @@ atom-gc ok, but this destroys  the  environment   for  normal  GC if the
 undefined predicate trapping code starts a GC. Therefore, undefined code
 runs normal I_CALL. This isn't too  bad,   as  it only affects the first
 call.
+
+Frames of predicates with call counting (FR_COUNTED)  also use I_CALL, as
+we can only count the exit, failure or  exception   of  the frame after
+the last call has finished.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 VMI(I_DEPART, VIF_BREAK, 1, (CA1_PROC))
-{ if ( (void *)BFR <= (void *)FR && truePrologFlag(PLFLAG_LASTCALL) )
+{ if ( (void *)BFR <= (void *)FR && false(FR, FR_COUNTED) &&
+       truePrologFlag(PLFLAG_LASTCALL) )
   { Procedure proc = (Procedure) *PC++;
 
     if ( !proc->definition->impl.any.defined &&	/* see (*) */
@@ -1828,6 +1926,8 @@ VMI(I_EXIT, VIF_BREAK, 0, ())
   } else
   { leave = NULL;
     clear(FR, FR_INBOX);
+    if ( unlikely(true(FR, FR_COUNTED)) )
+      countFinished(FR, COUNT_EXIT PASS_LD);
   }
 
   PC = FR->programPointer;
@@ -2051,6 +2151,8 @@ VMI(I_CUT, VIF_BREAK, 0, ())
     ARGP = argFrameP(lTop, 0);
     if ( exception_term )
       THROW_EXCEPTION;
+    if ( unlikely(GD->options.tidyTrail) )
+      tidyTrail(PASS_LD1);
   }
 
   NEXT_INSTRUCTION;
@@ -2164,6 +2266,32 @@ VMI(C_FASTCUT, 0, 1, (CA1_CHP))
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+C_DETGUARD follows a type test  or  arithmetic  comparison  that  starts
+the body. If the clause choicepoint is still on top and the remaining
+candidate clause starts with an exclusive guard, the  choicepoint  is
+discarded.  See compileDetGuard() and detGuardPrunes() in pl-comp.c.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+VMI(C_DETGUARD, 0, 3, (CA1_INTEGER,CA1_VAR,CA1_INTEGER))
+{ Choice ch = BFR;
+
+  if ( ch->frame == FR && ch->type == CHP_CLAUSE &&
+       likely(!debugstatus.debugging) &&
+       detGuardPrunes(PC, FR, ch PASS_LD) )
+  { DEBUG(MSG_CUT, Sdprintf("C_DETGUARD: discarding %s for %s\n",
+			    chp_chars(ch), predicateName(DEF)));
+    DiscardMark(ch->mark);
+    BFR = ch->parent;
+    lTop = (LocalFrame)argFrameP(FR, CL->value.clause->variables);
+    ARGP = argFrameP(lTop, 0);
+  }
+
+  PC += 3;
+  NEXT_INSTRUCTION;
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 C_VAR is generated by the compiler to ensure the  instantiation  pattern
 of  the  variables  is  the  same after finishing both paths of the `or'
@@ -2358,6 +2486,8 @@ c_cut:
   }
 
   ARGP = argFrameP(lTop, 0);
+  if ( unlikely(GD->options.tidyTrail) )
+    tidyTrail(PASS_LD1);
 
   DEBUG(MSG_CUT, Sdprintf(" --> BFR = #%ld, lTop = #%ld\n",
 			  loffset(BFR), loffset(lTop)));
@@ -2646,6 +2776,30 @@ VMI(S_VIRGIN, 0, 0, ())
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+S_LAZY: Static predicate from a saved state whose clauses have not yet
+been loaded. loadLazyDefinition() loads them and resets the supervisor to
+S_VIRGIN. As the clauses are added in a new generation we must update the
+generation of the frame.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+VMI(S_LAZY, 0, 0, ())
+{ int rc;
+
+  lTop = (LocalFrame)argFrameP(FR, FR->predicate->functor->arity);
+
+  SAVE_REGISTERS(qid);
+  rc = loadLazyDefinition(DEF);
+  LOAD_REGISTERS(qid);
+  if ( !rc )
+    THROW_EXCEPTION;
+
+  setGenerationFrame(FR);
+  PC = DEF->codes;
+  NEXT_INSTRUCTION;
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 S_UNDEF: Undefined predicate. We could make   two  instructions, one for
 trapping and one not, but the disadvantage of that is that switching the
@@ -2958,7 +3112,7 @@ BEGIN_SHAREDVARS
 ClauseRef cref;
 
 VMI(S_ALLCLAUSES, 0, 0, ())		/* Uses CHP_JUMP */
-{ cref = DEF->impl.clauses.first_clause;
+{ cref = firstClauseRef(DEF, generationFrame(FR));
 
 next_clause:
   ARGP = argFrameP(FR, 0);
@@ -3041,6 +3195,46 @@ VMI(S_LIST, 0, 2, (CA1_CLAUSEREF, CA1_CLAUSEREF))
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+S_SWITCH: Static predicate where each clause has  a distinct atom as its
+first argument. The instruction is followed by the number of clauses and
+a table of <atom,clause> pairs, sorted on  the atom handle. We find the
+clause using binary search and  trust  it,   avoiding  the  JIT  index
+lookup. If the first argument is unbound we fall back to S_STATIC.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+VMI(S_SWITCH, 0, VM_DYNARGC, (CA1_SWITCH))
+{ Word k;
+
+  ARGP = argFrameP(FR, 0);
+  deRef2(ARGP, k);
+  if ( isAtom(*k) )
+  { size_t l = 0, h = (size_t)PC[0];
+    Code table = PC+1;
+
+    while( l < h )
+    { size_t m = (l+h)/2;
+      word a = table[m*2];
+
+      if ( a == *k )
+      { ClauseRef cref = (ClauseRef)table[m*2+1];
+
+	TRUST_CLAUSE(cref);
+      } else if ( a < *k )
+	l = m+1;
+      else
+	h = m;
+    }
+
+    FRAME_FAILED;
+  } else if ( canBind(*k) )
+  { PC = SUPERVISOR(staticp) + 1;
+    VMI_GOTO(S_STATIC);
+  } else
+    FRAME_FAILED;
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Meta-predicate  argument  qualification.  S_MQUAL    qualifies  the  Nth
 argument. S_LMQUAL does the same and resets   the  context module of the
@@ -3391,6 +3585,10 @@ VMI(A_ROUNDTOWARDS_V, 0, 1, (CA1_VAR))
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 A_ADD: Shorthand for A_FUNC2 pl_ar_add()
+
+If both operands are integers and the sum does not overflow, the result
+is computed in place on the arithmetic stack. Integers need no
+clearNumber().
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 VMI(A_ADD, 0, 0, ())
@@ -3398,6 +3596,18 @@ VMI(A_ADD, 0, 0, ())
   int rc;
   number r;
 
+  if ( argv[0].type == V_INTEGER && argv[1].type == V_INTEGER )
+  { int64_t i1 = argv[1].value.i;
+    int64_t i2 = argv[0].value.i;
+
+    if ( (i1^i2) < 0 ||			/* different sign */
+	 (i2 < 0 ? i1 >= PLMININT - i2 : PLMAXINT - i1 >= i2) )
+    { argv[0].value.i = i1+i2;
+      LD->arith.stack.top--;
+      NEXT_INSTRUCTION;
+    }
+  }
+
   SAVE_REGISTERS(qid);
   rc = pl_ar_add(argv+1, argv, &r);
   LOAD_REGISTERS(qid);
@@ -3413,6 +3623,9 @@ VMI(A_ADD, 0, 0, ())
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 A_MUL: Shorthand for A_FUNC2 ar_mul()
+
+Like A_ADD, integers that do not overflow are multiplied in place on the
+arithmetic stack.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 VMI(A_MUL, 0, 0, ())
@@ -3420,6 +3633,18 @@ VMI(A_MUL, 0, 0, ())
   int rc;
   number r;
 
+#ifdef HAVE__BUILTIN_MUL_OVERFLOW
+  if ( argv[0].type == V_INTEGER && argv[1].type == V_INTEGER )
+  { int64_t prod;
+
+    if ( !__builtin_mul_overflow(argv[1].value.i, argv[0].value.i, &prod) )
+    { argv[0].value.i = prod;
+      LD->arith.stack.top--;
+      NEXT_INSTRUCTION;
+    }
+  }
+#endif
+
   SAVE_REGISTERS(qid);
   rc = ar_mul(argv+1, argv, &r);
   LOAD_REGISTERS(qid);
@@ -3433,6 +3658,88 @@ VMI(A_MUL, 0, 0, ())
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A_ADD_F, A_SUB_F, A_MUL_F, A_DIV_F: Float  specialised versions of +, -,
+* and /. These are generated by compileArithArgument() if at least one of
+the operands is known to  be  a   float.  If  both  operands are indeed
+floats, the result is computed in place on the arithmetic stack, which
+avoids the type dispatch, the  SAVE_REGISTERS()   and  the copy of the
+result. If the result is neither a  normal   float  nor  zero we call
+check_float() to deal with the float flags.  If either operand is not a
+float we use the generic function, so the type inference of the compiler
+only needs to be a good guess.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+BEGIN_SHAREDVARS
+  Number fargv;
+  int (*ffunc)(Number n1, Number n2, Number r);
+
+#define AR_FLOAT_FAST(op) \
+  fargv = argvArithStack(2 PASS_LD); \
+  if ( fargv[0].type == V_FLOAT && fargv[1].type == V_FLOAT ) \
+  { fargv[0].value.f = fargv[1].value.f op fargv[0].value.f; \
+    goto a_float_out; \
+  }
+
+VMI(A_ADD_F, 0, 0, ())
+{ AR_FLOAT_FAST(+);
+  ffunc = pl_ar_add;
+
+a_float_generic:
+  { number r;
+    int rc;
+
+    SAVE_REGISTERS(qid);
+    rc = (*ffunc)(fargv+1, fargv, &r);
+    LOAD_REGISTERS(qid);
+    popArgvArithStack(2 PASS_LD);
+    if ( rc )
+    { pushArithStack(&r PASS_LD);
+      NEXT_INSTRUCTION;
+    }
+    AR_THROW_EXCEPTION;
+  }
+
+a_float_out:
+  LD->arith.stack.top--;		/* floats need no clearNumber() */
+  if ( likely(isnormal(fargv[0].value.f) || fargv[0].value.f == 0.0) )
+    NEXT_INSTRUCTION;
+  { int rc;
+
+    SAVE_REGISTERS(qid);
+    rc = check_float(fargv);
+    LOAD_REGISTERS(qid);
+    if ( rc )
+      NEXT_INSTRUCTION;
+    AR_THROW_EXCEPTION;
+  }
+}
+
+VMI(A_SUB_F, 0, 0, ())
+{ AR_FLOAT_FAST(-);
+  ffunc = ar_minus;
+  goto a_float_generic;
+}
+
+VMI(A_MUL_F, 0, 0, ())
+{ AR_FLOAT_FAST(*);
+  ffunc = ar_mul;
+  goto a_float_generic;
+}
+
+VMI(A_DIV_F, 0, 0, ())
+{ fargv = argvArithStack(2 PASS_LD);
+  if ( fargv[0].type == V_FLOAT && fargv[1].type == V_FLOAT &&
+       isfinite(fargv[0].value.f) && fargv[0].value.f != 0.0 )
+  { fargv[0].value.f = fargv[1].value.f / fargv[0].value.f;
+    goto a_float_out;
+  }
+  ffunc = ar_divide;
+  goto a_float_generic;
+}
+END_SHAREDVARS
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 A_ADD_FC: Simple case A is B + <int>, where   A is a firstvar and B is a
 normal variable. This case is very   common,  especially with relatively
@@ -3956,6 +4263,138 @@ VMI(I_FEXITDET, 0, 0, ())
 }
 END_SHAREDVARS
 
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+I_FCALLTYPED function signature:  Call  a   typed  foreign  function  (see
+PL_register_typed_foreign_in_module()). Small integers,   floats  and
+atoms are unboxed directly from the  frame   arguments  and results that
+are small integers or atoms are bound to an unbound output argument. All
+other cases use the PL_get_*_ex()  and   PL_unify_*()  functions  from a
+temporary foreign frame, which also raises the proper errors.
+
+As the function is pure we do not need to create a foreign frame on the
+fast path and we can exit the frame from this instruction.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+VMI(I_FCALLTYPED, 0, 2, (CA1_FOREIGN,CA1_INTEGER))
+{ pl_typed_function_t f = (pl_typed_function_t)*PC++;
+  code sig = *PC++;
+  int arity = DEF->functor->arity;
+  pl_value_t in[MAX_FLI_ARGS];
+  pl_value_t out[MAX_FLI_ARGS];
+  int i, ni, no;
+  int rc;
+
+  lTop = (LocalFrame)argFrameP(FR, arity);
+#ifdef O_DEBUGGER
+  if ( debugstatus.debugging )
+    BFR = newChoice(CHP_DEBUG, FR PASS_LD);
+#endif
+
+  for(i=0, ni=0; i<arity; i++)
+  { int t = FTYPE_ARG(sig, i);
+    Word p;
+
+    if ( (t&FTYPE_OUTPUT) )
+      break;				/* outputs follow the inputs */
+
+    p = argFrameP(FR, i);
+    deRef(p);
+    switch(t)
+    { case FTYPE_INT64:
+	if ( isTaggedInt(*p) )
+	{ in[ni++].i = valInt(*p);
+	  continue;
+	}
+	break;
+      case FTYPE_DOUBLE:
+	if ( isFloat(*p) )
+	{ in[ni++].f = valFloat(*p);
+	  continue;
+	}
+	break;
+      case FTYPE_ATOM:
+	if ( isAtom(*p) )
+	{ in[ni++].a = *p;
+	  continue;
+	}
+	break;
+    }
+
+    { fid_t fid;
+      term_t h = consTermRef(argFrameP(FR, i));
+
+      SAVE_REGISTERS(qid);
+      if ( (fid = PL_open_foreign_frame()) )
+      { switch(t)
+	{ case FTYPE_INT64:  rc = PL_get_int64_ex(h, &in[ni].i); break;
+	  case FTYPE_DOUBLE: rc = PL_get_float_ex(h, &in[ni].f); break;
+	  default:	  rc = PL_get_atom_ex(h, &in[ni].a);  break;
+	}
+	PL_close_foreign_frame(fid);
+      } else
+	rc = FALSE;
+      LOAD_REGISTERS(qid);
+      if ( !rc )
+	THROW_EXCEPTION;
+      ni++;
+    }
+  }
+
+  PROF_FOREIGN;
+  if ( !(*f)(in, out) )
+    FRAME_FAILED;
+
+  for(no=0; i<arity; i++, no++)
+  { int t = FTYPE_ARG(sig, i)&~FTYPE_OUTPUT;
+    Word p = argFrameP(FR, i);
+    word w = 0;
+
+    if ( t == FTYPE_ATOM )
+      w = out[no].a;
+    else if ( t == FTYPE_INT64 && inTaggedNumRange(out[no].i) )
+      w = consInt(out[no].i);
+
+    deRef(p);
+    if ( w )
+    { if ( *p == w )
+	continue;
+      if ( isVar(*p) )
+      { ENSURE_GLOBAL_SPACE(0, { p = argFrameP(FR, i);
+				 deRef(p);
+			       });
+	bindConst(p, w);
+	continue;
+      }
+      if ( !isAttVar(*p) )
+	FRAME_FAILED;
+    }
+
+    { fid_t fid;
+      term_t h = consTermRef(argFrameP(FR, i));
+
+      SAVE_REGISTERS(qid);
+      if ( (fid = PL_open_foreign_frame()) )
+      { switch(t)
+	{ case FTYPE_INT64:  rc = PL_unify_int64(h, out[no].i); break;
+	  case FTYPE_DOUBLE: rc = PL_unify_float(h, out[no].f); break;
+	  default:	  rc = PL_unify_atom(h, out[no].a);  break;
+	}
+	PL_close_foreign_frame(fid);
+      } else
+	rc = FALSE;
+      LOAD_REGISTERS(qid);
+      if ( !rc )
+      { if ( exception_term )
+	  THROW_EXCEPTION;
+	FRAME_FAILED;
+      }
+    }
+  }
+
+  goto exit_checking_wakeup;
+}
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Non-deterministic foreign calls. This  is   compiled  into the following
 supervisor code:
@@ -4179,6 +4618,8 @@ VMI(I_FREDO, 0, 0, ())
       THROW_EXCEPTION;
   }
 
+  if ( unlikely(true(FR, FR_COUNTED)) )
+    countRedo(FR);
   context.context = (word)FR->clause;
   context.control = FRG_REDO;
   context.engine  = LD;
@@ -4245,6 +4686,7 @@ VMI(I_EXITCLEANUP, 0, 0, ())
 
   if ( BFR->frame == FR && BFR->type == CHP_CATCH )
   { DEBUG(3, Sdprintf(" --> BFR = #%ld\n", loffset(BFR->parent)));
+    DiscardMark(BFR->mark);		/* (*) */
     for(BFR = BFR->parent; BFR > (Choice)FR; BFR = BFR->parent)
     { if ( BFR->type == CHP_DEBUG )
 	continue;
@@ -4276,6 +4718,12 @@ which is translated to:
   I_ENTER
   I_CATCH
   I_EXITCATCH
+
+If Goal succeeded deterministically, I_EXITCATCH  removes the choice and
+resets the mark bar as if the choice never existed (*).  Without, each
+binding to a variable older than catch/3   made after the call, e.g., by
+the remainder of a server loop, is  trailed   until  the  next choice is
+created or removed.  The same applies to I_EXITCLEANUP.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 VMI(I_CATCH, 0, 0, ())
@@ -4294,6 +4742,7 @@ VMI(I_CATCH, 0, 0, ())
 VMI(I_EXITCATCH, 0, 0, ())
 { if ( BFR->frame == FR && BFR == (Choice)argFrameP(FR, 3) )
   { assert(BFR->type == CHP_CATCH);
+    DiscardMark(BFR->mark);		/* (*) */
     BFR = BFR->parent;
     set(FR, FR_CATCHED);
   }
@@ -4541,7 +4990,7 @@ again:
 	      LOAD_REGISTERS(qid)
 	    });
 
-      if ( true(FR, FR_WATCHED) )
+      if ( true(FR, FR_CLEANUP|FR_DEBUG) )
       { SAVE_REGISTERS(qid);
 	dbg_discardChoicesAfter(FR, FINISH_EXTERNAL_EXCEPT PASS_LD);
 	LOAD_REGISTERS(qid);
@@ -4554,6 +5003,8 @@ again:
 	dbg_discardChoicesAfter(FR, FINISH_EXTERNAL_EXCEPT_UNDO PASS_LD);
 	LOAD_REGISTERS(qid);
 	discardFrame(FR PASS_LD);
+	if ( true(FR, FR_COUNTED) )
+	  countFinished(FR, COUNT_EXCEPTION PASS_LD);
       }
 
       if ( start_tracer )		/* See (*) */
@@ -5295,7 +5746,9 @@ TBD:
 #define TRIE_TRY \
 	do \
 	{ intptr_t skip = *PC++;				\
-          Choice ch = newChoice(CHP_JUMP, FR PASS_LD);		\
+	  Choice ch;						\
+	  ENSURE_LOCAL_SPACE(sizeof(*ch), THROW_EXCEPTION);	\
+          ch = newChoice(CHP_JUMP, FR PASS_LD);			\
           ch->value.PC = PC+skip;				\
 	} while(0)
 #define TrieNextArg() \
@@ -5756,3 +6209,62 @@ t_const:
   CLAUSE_FAILED;
 }
 END_SHAREDVARS
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+T_SWITCH indexes a trie node whose  children   are  all atoms, small
+integers or functors. It is followed by  the   number  of children and a
+table of <key,offset> pairs sorted on the  key. The offset is relative to
+the end of the table and points just  after the key instruction of the
+child. If the current argument is unbound   we  continue with the normal
+T_TRY_* chain that follows the table.  Otherwise we find the child using
+binary search and jump into it without creating a choicepoint.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+VMI(T_SWITCH, 0, VM_DYNARGC, (CA1_SWITCH))
+{ size_t n = (size_t)PC[0];
+  Code table = PC+1;
+  Word k;
+  word key;
+
+  deRef2(TrieCurrentP, k);
+  if ( canBind(*k) )
+  { PC = table + n*2;
+    NEXT_INSTRUCTION;
+  }
+  if ( isTerm(*k) )
+    key = functorTerm(*k);
+  else if ( isAtom(*k) || isTaggedInt(*k) )
+    key = *k;
+  else
+    CLAUSE_FAILED;
+
+  { size_t l = 0, h = n;
+
+    while( l < h )
+    { size_t m = (l+h)/2;
+      word a = (word)table[m*2];
+
+      if ( a == key )
+      { PC = table + n*2 + (size_t)table[m*2+1];
+
+	if ( isTerm(*k) )
+	{ ENSURE_GLOBAL_SPACE(4, deRef2(TrieCurrentP, k));
+	  TriePushArgP();
+	  TrailAssignment(TrieTermP);
+	  TrailAssignment(TrieOffset);
+	  *TrieTermP  = *k;
+	  *TrieOffset = consInt(1);
+	} else
+	{ TrieNextArg();
+	}
+	NEXT_INSTRUCTION;
+      } else if ( a < key )
+	l = m+1;
+      else
+	h = m;
+    }
+  }
+
+  CLAUSE_FAILED;
+}
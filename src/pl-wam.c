@@ -35,6 +35,7 @@
 */
 
 /*#define O_DEBUG 1*/
+#define _GNU_SOURCE 1			/* get mremap() for pl-alloc.c */
 #include "pl-incl.h"
 #include "pl-comp.h"
 #include "pl-arith.h"
@@ -45,6 +46,7 @@
 #include "pl-event.h"
 #include "pl-tabling.h"
 #include <fenv.h>
+#include <math.h>
 #ifdef _MSC_VER
 #pragma warning(disable: 4102)		/* unreferenced labels */
 #endif
@@ -78,12 +80,66 @@ typedef struct
 
 static count_info counting[I_HIGHEST];
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+We also count  the  sequences  of  two  and three  instructions  that are
+executed.  These  are  the  candidates  for  superinstructions  (see
+mkvmi.c).  Pairs use  a  matrix.  Triples use a fixed open hash table that
+silently stops adding new triples if it is full. Note that, like the other
+counters, these are global and are not updated atomically, and that
+VMI_GOTO() is counted as a transition too.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define TRIPLE_BUCKETS 8192
+
+typedef struct
+{ unsigned int	key;			/* (a*I_HIGHEST+b)*I_HIGHEST+c + 1 */
+  unsigned int	times;
+} triple_count;
+
+static unsigned int pair_counting[I_HIGHEST][I_HIGHEST];
+static triple_count triple_counting[TRIPLE_BUCKETS];
+static code	    last_vmi[2] = {I_HIGHEST, I_HIGHEST};
+
+static void
+count_sequence(code c)
+{ code c1 = last_vmi[0];
+  code c2 = last_vmi[1];
+
+  if ( c1 < I_HIGHEST )
+  { pair_counting[c1][c]++;
+
+    if ( c2 < I_HIGHEST )
+    { unsigned int key = (unsigned int)((c2*I_HIGHEST+c1)*I_HIGHEST+c) + 1;
+      unsigned int i = (key*2654435761U) % TRIPLE_BUCKETS;
+      int probes;
+
+      for(probes=0; probes < TRIPLE_BUCKETS; probes++)
+      { triple_count *t = &triple_counting[i];
+
+	if ( t->key == key )
+	{ t->times++;
+	  break;
+	} else if ( t->key == 0 )
+	{ t->key = key;
+	  t->times = 1;
+	  break;
+	}
+	i = (i+1) % TRIPLE_BUCKETS;
+      }
+    }
+  }
+
+  last_vmi[1] = c1;
+  last_vmi[0] = c;
+}
+
 static void
 count(code c, Code PC)
 { const code_info *info = &codeTable[c];
 
   counting[c].times++;
-  switch(info->argtype)
+  count_sequence(c);
+  switch(info->argtype[0])
   { case CA1_VAR:
     case CA1_FVAR:
     case CA1_CHP:
@@ -107,8 +163,9 @@ count(code c, Code PC)
 
 
 static void
-countHeader()
-{ int m;
+countHeader(void)
+{ GET_LD
+  int m;
   int amax = MAXVAR;
   char last[20];
 
@@ -133,8 +190,9 @@ cmpcounts(const void *p1, const void *p2)
 
 
 word
-pl_count()
-{ int i;
+pl_count(void)
+{ GET_LD
+  int i;
   count_info counts[I_HIGHEST];
   count_info *c;
 
@@ -163,6 +221,85 @@ pl_count()
   succeed;
 }
 
+
+static int
+unify_vmi_sequence(term_t tail, term_t head, unsigned int times,
+		   int len, const code *seq)
+{ GET_LD
+  term_t names = PL_new_term_ref();
+  term_t h = PL_new_term_ref();
+  int i;
+
+  PL_put_nil(names);
+  for(i=len-1; i>=0; i--)
+  { if ( !PL_put_atom_chars(h, codeTable[seq[i]].name) ||
+	 !PL_cons_list(names, h, names) )
+      return FALSE;
+  }
+
+  return ( PL_unify_list(tail, head, tail) &&
+	   PL_unify_term(head,
+			 PL_FUNCTOR, FUNCTOR_minus2,
+			   PL_INT64, (int64_t)times,
+			   PL_TERM, names) );
+}
+
+
+/** '$vmi_sequences'(+Length, -Sequences) is det.
+ *
+ * Sequences is an unsorted list Count-Names,  where Names is a list of
+ * Length (2 or 3) VMI names that were executed Count times in sequence.
+ */
+
+word
+pl_vmi_sequences(term_t length, term_t list)
+{ GET_LD
+  term_t tail = PL_copy_term_ref(list);
+  term_t head = PL_new_term_ref();
+  int len;
+
+  if ( !PL_get_integer_ex(length, &len) )
+    fail;
+
+  if ( len == 2 )
+  { code c1, c2;
+
+    for(c1=0; c1<I_HIGHEST; c1++)
+    { for(c2=0; c2<I_HIGHEST; c2++)
+      { if ( pair_counting[c1][c2] )
+	{ code seq[2];
+
+	  seq[0] = c1;
+	  seq[1] = c2;
+	  if ( !unify_vmi_sequence(tail, head, pair_counting[c1][c2], 2, seq) )
+	    fail;
+	}
+      }
+    }
+  } else if ( len == 3 )
+  { int i;
+
+    for(i=0; i<TRIPLE_BUCKETS; i++)
+    { const triple_count *t = &triple_counting[i];
+
+      if ( t->key )
+      { unsigned int key = t->key-1;
+	code seq[3];
+
+	seq[2] = key%I_HIGHEST; key /= I_HIGHEST;
+	seq[1] = key%I_HIGHEST; key /= I_HIGHEST;
+	seq[0] = key;
+	if ( !unify_vmi_sequence(tail, head, t->times, 3, seq) )
+	  fail;
+      }
+    }
+  } else
+  { return PL_domain_error("vmi_sequence_length", length);
+  }
+
+  return PL_unify_nil(tail);
+}
+
 #else /* ~COUNTING */
 
 #define count(id, pc)			/* no debugging not counting */
@@ -258,7 +395,8 @@ updateAlerted(PL_local_data_t *ld)
 
   if ( is_signalled(PASS_LDARG1(ld)) )		mask |= ALERT_SIGNAL;
 #ifdef O_PROFILE
-  if ( ld->profile.active )			mask |= ALERT_PROFILE;
+  if ( ld->profile.active ||
+       ld->profile.alloc.active )		mask |= ALERT_PROFILE;
 #endif
 #ifdef O_PLMT
   if ( ld->exit_requested )			mask |= ALERT_EXITREQ;
@@ -746,7 +884,27 @@ callCleanupHandler(LocalFrame fr, enum finished reason ARG_LD)
 
 static int
 frameFinished(LocalFrame fr, enum finished reason ARG_LD)
-{ if ( true(fr, FR_CLEANUP) )
+{ if ( true(fr, FR_COUNTED) )
+  { count_port port;
+
+    switch(reason)
+    { case FINISH_EXIT:
+      case FINISH_EXITCLEANUP:
+	port = COUNT_EXIT;
+	break;
+      case FINISH_FAIL:
+	port = COUNT_FAIL;
+	break;
+      case FINISH_EXCEPT:
+	port = COUNT_EXCEPTION;
+	break;
+      default:
+	port = COUNT_DISCARD;
+    }
+    countFinished(fr, port PASS_LD);
+  }
+
+  if ( true(fr, FR_CLEANUP) )
   { size_t fref = consTermRef(fr);
     callCleanupHandler(fr, reason PASS_LD);
     fr = (LocalFrame)valTermRef(fref);
@@ -1352,6 +1510,8 @@ __do_undo(mark *m ARG_LD)
   }
 
   tTop = mt;
+  if ( LD->trail_tidy.scanned > (size_t)(mt - tBase) )
+    LD->trail_tidy.scanned = mt - tBase;
   if ( LD->frozen_bar > m->globaltop )
   { DEBUG(CHK_SECURE, assert(gTop >= LD->frozen_bar));
     reclaim_attvars(LD->frozen_bar PASS_LD);
@@ -1371,6 +1531,57 @@ do_undo(mark *m)
 
 #undef Undo
 #define Undo(m) __do_undo(&m PASS_LD)
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+tidyTrail() is called after a cut if  the  flag  tidy_trail  is  set.  A
+binding is trailed if the variable is older than the newest choicepoint.
+After a cut, entries above the mark  of  the  new  newest  choicepoint
+that refer to global cells above the mark bar or to  local  cells  above
+this choicepoint are no longer needed: backtracking to  the  choicepoint
+discards these cells anyway.  Normally only GC removes such entries.
+
+LD->trail_tidy.scanned is the number of trail entries known to be  tidy
+with respect to the choicepoint at LD->trail_tidy.choice, such that long
+deterministic loops only need to scan the entries added since the  last
+cut.  Undo() lowers this if it resets the trail below it.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+tidyTrail(ARG1_LD)
+{ Choice ch = BFR;
+  TrailEntry top = tTop;
+  TrailEntry te, dest;
+  Word gbar = LD->mark_bar;
+  size_t choff;
+
+  if ( !ch || ch->mark.trailtop >= top )
+    return;
+
+  choff = (Word)ch - (Word)lBase;
+  te = tBase + LD->trail_tidy.scanned;
+  if ( te < ch->mark.trailtop || te > top || choff < LD->trail_tidy.choice )
+    te = ch->mark.trailtop;
+
+  for(dest = te; te < top; )
+  { Word p = te->address;
+    int n = (te+1 < top && isTrailVal(te[1].address)) ? 2 : 1;
+
+    if ( (void*)p >= (void*)lBase ? p > (Word)ch : p >= gbar )
+    { te += n;				/* cell dies when backtracking to ch */
+    } else
+    { while(n-- > 0)
+	*dest++ = *te++;
+    }
+  }
+
+  if ( dest < top )
+  { LD->trail_tidy.reclaimed += (char*)top - (char*)dest;
+    tTop = dest;
+  }
+  LD->trail_tidy.scanned = dest - tBase;
+  LD->trail_tidy.choice  = choff;
+}
 #endif /*O_DESTRUCTIVE_ASSIGNMENT*/
 
 
@@ -1419,6 +1630,24 @@ destroyLocalDefinition(Definition def, unsigned int tid)
   v->blocks[idx][tid] = NULL;
   destroyDefinition(local);
 }
+
+/* Remove all clauses from a local definition, such that it can be reused
+   by the next thread with the same id.  See cleanupLocalDefinitions().
+*/
+
+void
+recycleLocalDefinition(Definition def, unsigned int tid)
+{ size_t idx = MSB(tid);
+  LocalDefinitions v = def->impl.local;
+  Definition local = v->blocks[idx][tid];
+
+  forgetIndexRequests(local);
+  deleteIndexes(&local->impl.clauses, TRUE);
+  deleteRangeIndexes(local);
+  deleteIndexStatistics(local);
+  freeCallCounts(local);
+  removeClausesPredicate(local, 0, FALSE);
+}
 #endif
 
 Definition
@@ -1966,9 +2195,43 @@ dbgRedoFrame(LocalFrame fr, choice_type cht ARG_LD)
 
 #endif /*O_DEBUGGER*/
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+exception_hook_may_apply() checks whether the first  argument of some
+clause of prolog_exception_hook/4 can match the exception. Hooks usually
+only deal with error(Formal, Context) terms.  Exceptions used for control
+flow, e.g. throw(found(X)), thus do not need to run the hook as a query.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+exception_hook_may_apply(Definition def ARG_LD)
+{ word key = getIndexOfTerm(exception_term);
+  gen_t generation = global_generation();
+  ClauseRef cref;
+  int rc = FALSE;
+
+  if ( !key )
+    return TRUE;
+
+  acquire_def(def);
+  for(cref = def->impl.clauses.first_clause; cref; cref = cref->next)
+  { if ( (!cref->d.key || cref->d.key == key) &&
+	 visibleClause(cref->value.clause, generation) )
+    { rc = TRUE;
+      break;
+    }
+  }
+  release_def(def);
+
+  return rc;
+}
+
+
 static int
 exception_hook(qid_t pqid, term_t fr, term_t catchfr_ref ARG_LD)
-{ if ( PROCEDURE_exception_hook4->definition->impl.clauses.first_clause )
+{ Definition def = PROCEDURE_exception_hook4->definition;
+
+  if ( def->impl.clauses.first_clause &&
+       exception_hook_may_apply(def PASS_LD) )
   { if ( !LD->exception.in_hook )
     { wakeup_state wstate;
       qid_t qid;
@@ -2833,6 +3096,15 @@ pl-comp.c
  */
 #define SEPERATE_VMI { static volatile int nop = 0; (void)nop; }
 
+/* Used by the superinstructions from pl-vmi-fused.ic (see mkvmi.c): if
+ * the next instruction is `n`, jump to it directly.
+ */
+#define VMI_FUSED_TRY(n)	if ( *PC == (code)&&n ## _LBL ) \
+				{ DbgPrintInstruction(FR, PC); \
+				  PC++; \
+				  VMI_GOTO(n); \
+				}
+
 #else /* VMCODE_IS_ADDRESS */
 
 code thiscode;
@@ -2855,6 +3127,7 @@ code thiscode;
                                   goto next_instruction; \
 				}
 #define SEPERATE_VMI		(void)0
+#define VMI_FUSED_TRY(n)	(void)0	/* superinstructions are not used */
 
 #endif /* VMCODE_IS_ADDRESS */
 
@@ -2969,6 +3242,7 @@ resumebreak:
 #endif
   {
 #include "pl-vmi.c"
+#include "pl-vmi-fused.ic"
   }
 
 #ifdef O_ATTVAR
@@ -3274,6 +3548,8 @@ next_choice:
       ARGP = argFrameP(FR, 0);
       DiscardMark(ch->mark);
       BFR = ch->parent;
+      if ( unlikely(true(FR, FR_COUNTED)) )
+	countRedo(FR);
       if ( !(CL = nextClause(&ch->value.clause, ARGP, FR, DEF)) )
 	goto next_choice;	/* Can happen of look-ahead was too short */
 
@@ -3362,7 +3638,7 @@ next_choice:
 	    Sdprintf("    REDO #%ld: %s: CATCH\n",
 		     loffset(FR),
 		     predicateName(DEF)));
-            if ( true(ch->frame, FR_WATCHED) )
+            if ( true(ch->frame, FR_CLEANUP|FR_DEBUG) )
       { DiscardMark(ch->mark);
 	environment_frame = FR = ch->frame;
 	lTop = (LocalFrame)(ch+1);
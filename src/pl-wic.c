@@ -116,11 +116,11 @@ Below is an informal description of the format of a `.qlf' file:
 <statement>	::=	'W' <string>			% include wic file
 		      | 'P' <XR/functor>		% predicate
 			    <flags>
-			    {<clause>} <pattern>
+			    <clauses>
 		      |	'O' <XR/modulename>		% pred out of module
 			    <XR/functor>
 			    <flags>
-			    {<clause>} <pattern>
+			    <clauses>
 		      | 'D'
 		        <lineno>			% source line number
 			<term>				% directive
@@ -131,6 +131,13 @@ Below is an informal description of the format of a `.qlf' file:
 		            {<statement>}
 			    'X'
 <flags>		::=	<num>				% Bitwise or of PRED_*
+<clauses>	::=	{<clause>} [<indexes>] <pattern>
+		      | <lazy>
+<lazy>		::=	'L' <#files>			% lazy loaded clauses
+			    {<XR/owner> <XR/source>}	% files of the clauses
+			    <XR id base>		% last XR id of the parent
+			    <#bytes> <clauses>		% as a block of bytes
+			'X'
 <clause>	::=	'C' <#codes>
 			    <line_no>
 			    <owner_file>
@@ -139,6 +146,11 @@ Below is an informal description of the format of a `.qlf' file:
 			    <is_fact>			% 0 or 1
 			    <#n subclause> <codes>
 		      | 'X'				% end of list
+<indexes>	::=	'J' <#indexes> {<index>}	% JIT indexes to create
+<index>		::=	{<num>} 0			% indexed arguments
+			<lg2 buckets>
+			<is_list>			% 0 or 1
+			<float>				% speedup
 <XR>		::=	XR_REF     <num>		% XR id from table
 			XR_NIL				% []
 			XR_CONS				% functor of [_|_]
@@ -215,6 +227,10 @@ typedef struct source_mark
 typedef struct xr_table
 { unsigned int	id;			/* next id to give out */
   struct xr_table* previous;		/* stack */
+  struct xr_table* shared;		/* table for ids <= shared_id */
+  unsigned int	shared_id;		/* last id in the shared table */
+  int		references;		/* lazy clauses using this table */
+  int		popped;			/* popped, but still referenced */
   Word	        blocks[XR_BLOCKS];	/* main table */
   word		preallocated[7];
 } xr_table, *XrTable;
@@ -253,11 +269,21 @@ typedef struct wic_state
 
   int        saved_version;		/* Version saved */
   int	     obfuscate;			/* Obfuscate source */
+  int	     jit_indexes;		/* Save JIT index specifications */
+  int	     lazy_load;			/* Save static code as lazy blocks */
   int	     load_nesting;		/* Nesting level of loadPart() */
   qlf_state *load_state;		/* current load-state */
 
   xr_table *XR;				/* external references */
 
+  struct
+  { IOSTREAM   *fd;			/* Saving a lazy block: main stream */
+    Table	table;			/* Main saved XR table */
+    intptr_t	base;			/* savedXRTableId at start */
+    char       *buffer;			/* Buffer holding the block */
+    size_t	size;			/* Size of the block */
+  } lazy;
+
   struct
   { int		invalid_wide_chars;	/* Cannot represent due to UCS-2 */
   } errors;
@@ -272,6 +298,10 @@ static int	getInt(IOSTREAM *);
 static double	getFloat(IOSTREAM *);
 static bool	loadWicFd(wic_state *state);
 static bool	loadPredicate(wic_state *state, int skip ARG_LD);
+static bool	loadPredicateClauses(wic_state *state, Procedure proc,
+				     int skip, int lazy ARG_LD);
+static bool	loadLazyClausesWic(wic_state *state, Procedure proc,
+				   int skip ARG_LD);
 static bool	loadImport(wic_state *state, int skip ARG_LD);
 static void	saveXRBlobType(wic_state *state, PL_blob_t *type);
 static void	putString(const char *, size_t len, IOSTREAM *);
@@ -324,11 +354,8 @@ pushXrIdTable(wic_state *state)
 
 
 static void
-popXrIdTable(wic_state *state)
-{ XrTable t = state->XR;
-  unsigned int id, idx;
-
-  state->XR = t->previous;		/* pop the stack */
+freeXrIdTable(XrTable t)
+{ unsigned int id, idx;
 
   for(id=0; id < 7; id++)
   { word w = t->preallocated[id];
@@ -336,30 +363,57 @@ popXrIdTable(wic_state *state)
     if ( isAtom(w) )
       PL_unregister_atom(w);
   }
-  for(idx = 3; idx < XR_BLOCKS && t->blocks[idx]; idx++)
-  { size_t bs = (size_t)1<<idx;
-    Word p = t->blocks[idx]+bs;
-    size_t i;
+  for(idx = 3; idx < XR_BLOCKS; idx++)
+  { if ( t->blocks[idx] )
+    { size_t bs = (size_t)1<<idx;
+      Word p = t->blocks[idx]+bs;
+      size_t i;
 
-    for(i=0; i<bs && id < t->id; i++, id++)
-    { word w = p[i];
+      for(i=0; i<bs; i++)
+      { word w = p[i];
 
-      if ( isAtom(w) )
-	PL_unregister_atom(w);
-    }
+	if ( isAtom(w) )
+	  PL_unregister_atom(w);
+      }
 
-    freeHeap(p, bs*sizeof(word));
+      freeHeap(p, bs*sizeof(word));
+    }
   }
 
   freeHeap(t, sizeof(*t));
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A table that is referenced by lazy clauses  (see loadLazyClauses()) is
+only freed after the last lazy definition using it has been loaded.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+popXrIdTable(wic_state *state)
+{ XrTable t = state->XR;
+
+  state->XR = t->previous;		/* pop the stack */
+
+  PL_LOCK(L_LAZY);
+  if ( t->references > 0 )
+  { t->popped = TRUE;
+    t = NULL;
+  }
+  PL_UNLOCK(L_LAZY);
+
+  if ( t )
+    freeXrIdTable(t);
+}
+
+
 static word
 lookupXrId(wic_state *state, unsigned int id)
 { XrTable t = state->XR;
   unsigned int idx = MSB(id);
 
+  if ( id <= t->shared_id )
+    t = t->shared;
   DEBUG(CHK_SECURE, assert(t->blocks[idx]));
   return t->blocks[idx][id];
 }
@@ -375,6 +429,7 @@ storeXrId(wic_state *state, unsigned int id, word value)
     Word newblock;
 
     newblock = allocHeapOrHalt(bs*sizeof(word));
+    memset(newblock, 0, bs*sizeof(word));
     t->blocks[idx] = newblock-bs;
   }
 
@@ -482,6 +537,15 @@ wicGetStringUTF8(IOSTREAM *fd, size_t *length,
 
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+getAtom() is called for the first  occurrence   of  each atom or blob in
+the file. Later occurrences use  XR_REF.  If   the  text  is  completely
+inside the stream buffer and we do  not   track  the position, we create
+the atom directly from the buffer. This   is  the common case for normal
+atoms and always the case for lazy clauses (see loadLazyClauses()). Blob
+types that do not copy their data must use a private copy.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 static atom_t
 getAtom(IOSTREAM *fd, PL_blob_t *type)
 { char buf[1024];
@@ -490,6 +554,20 @@ getAtom(IOSTREAM *fd, PL_blob_t *type)
   size_t i;
   atom_t a;
 
+  if ( !fd->position && (size_t)(fd->limitp - fd->bufp) >= len &&
+       !(type && true(type, PL_BLOB_NOCOPY)) )
+  { s = fd->bufp;
+    fd->bufp += len;
+
+    if ( type )
+    { int new;
+
+      return lookupBlob(s, len, type, &new);
+    } else
+    { return lookupAtom(s, len);
+    }
+  }
+
   if ( len < sizeof(buf) )
     tmp = buf;
   else
@@ -558,32 +636,45 @@ zigzag_decode(uint64_t n)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+getInt64() and getUInt() are by far  the   most  frequently called input
+primitives while loading a state or  QLF   file.  Most  numbers fit in a
+single byte, so we inline that case and  leave decoding multi-byte values
+to a function.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 static int64_t
+getInt64_long(IOSTREAM *fd, int c)
+{ uint64_t v = c&0x7f;
+  int shift = 7;
+
+  for(;;)
+  { c = Qgetc(fd);
+
+    if ( c&0x80 )
+    { uint64_t l = (c&0x7f);
+      v |= l<<shift;
+      DEBUG(MSG_QLF_INTEGER, Sdprintf("%" PRId64 "\n", zigzag_decode(v)));
+      return zigzag_decode(v);
+    } else
+    { uint64_t b = c;
+      v |= b<<shift;
+      shift += 7;
+    }
+  }
+}
+
+
+static inline int64_t
 getInt64(IOSTREAM *fd)
 { int c = Qgetc(fd);
 
   if ( c&0x80 )
   { DEBUG(MSG_QLF_INTEGER, Sdprintf("%" PRId64 "\n", zigzag_decode(c&0x7f)));
     return zigzag_decode(c&0x7f);
-  } else
-  { uint64_t v = c&0x7f;
-    int shift = 7;
-
-    for(;;)
-    { c = Qgetc(fd);
-
-      if ( c&0x80 )
-      { uint64_t l = (c&0x7f);
-	v |= l<<shift;
-	DEBUG(MSG_QLF_INTEGER, Sdprintf("%" PRId64 "\n", zigzag_decode(v)));
-	return zigzag_decode(v);
-      } else
-      { uint64_t b = c;
-	v |= b<<shift;
-	shift += 7;
-      }
-    }
   }
+
+  return getInt64_long(fd, c);
 }
 
 
@@ -596,31 +687,37 @@ getInt(IOSTREAM *fd)
 
 
 static unsigned int
+getUInt_long(IOSTREAM *fd, unsigned int c)
+{ unsigned int v = c&0x7f;
+  int shift = 7;
+
+  for(;;)
+  { c = Qgetc(fd);
+
+    if ( c&0x80 )
+    { unsigned int l = (c&0x7f);
+      v |= l<<shift;
+      DEBUG(MSG_QLF_INTEGER, Sdprintf("%d\n", v));
+      return v;
+    } else
+    { unsigned int b = c;
+      v |= b<<shift;
+      shift += 7;
+    }
+  }
+}
+
+
+static inline unsigned int
 getUInt(IOSTREAM *fd)
 { unsigned int c = Qgetc(fd);
 
   if ( c&0x80 )
   { DEBUG(MSG_QLF_INTEGER, Sdprintf("%d\n", c&0x7f));
     return c&0x7f;
-  } else
-  { unsigned int v = c&0x7f;
-    int shift = 7;
-
-    for(;;)
-    { c = Qgetc(fd);
-
-      if ( c&0x80 )
-      { unsigned int l = (c&0x7f);
-	v |= l<<shift;
-	DEBUG(MSG_QLF_INTEGER, Sdprintf("%d\n", v));
-	return v;
-      } else
-      { unsigned int b = c;
-	v |= b<<shift;
-	shift += 7;
-      }
-    }
   }
+
+  return getUInt_long(fd, c);
 }
 
 
@@ -1116,6 +1213,38 @@ loadPredicateFlags(wic_state *state, Definition def, int skip)
   }
 }
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Load the JIT index specifications saved by saveIndexesWic() and create
+the indexes.  This is called after all clauses of the predicate have been
+loaded.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+loadIndexesWic(wic_state *state, Definition def, int skip)
+{ IOSTREAM *fd = state->wicFd;
+  unsigned int n = getUInt(fd);
+
+  for(; n > 0; n--)
+  { hash_hints hints;
+    unsigned int an;
+    int i = 0;
+
+    memset(&hints, 0, sizeof(hints));
+    while( (an=getUInt(fd)) )
+    { if ( i < MAX_MULTI_INDEX )
+	hints.args[i++] = an > MAXINDEXARG ? MAXINDEXARG+1 : an;
+    }
+    hints.ln_buckets = getUInt(fd);
+    hints.list       = (getUInt(fd) != 0);
+    hints.speedup    = (float)getFloat(fd);
+
+    if ( !skip )
+    { DEBUG(MSG_QLF_PREDICATE, Sdprintf("I"));
+      createIndexFromHints(def, &hints);
+    }
+  }
+}
+
 #ifdef O_GMP
 
 static int
@@ -1248,12 +1377,9 @@ resolve_rlabel(vm_rlabel_state *state, unsigned int id, Code base, Clause clause
 
 static bool
 loadPredicate(wic_state *state, int skip ARG_LD)
-{ IOSTREAM *fd = state->wicFd;
-  Procedure proc;
+{ Procedure proc;
   Definition def;
-  Clause clause;
   functor_t f = (functor_t) loadXR(state);
-  SourceFile csf = NULL;
 
   proc = lookupProcedureToDefine(f, LD->modules.source);
   DEBUG(MSG_QLF_PREDICATE, Sdprintf("Loading %s%s",
@@ -1274,19 +1400,72 @@ loadPredicate(wic_state *state, int skip ARG_LD)
   }
   loadPredicateFlags(state, def, skip);
 
+  return loadPredicateClauses(state, proc, skip, FALSE PASS_LD);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Load the clauses and indexes of proc  up to the terminating 'X'. If lazy
+is TRUE we are loading the clauses of a lazy block and the source files
+of the predicate are already registered by loadLazyClausesWic().
+
+Clauses of static predicates  that  are  not   being  reloaded  are
+collected in `packed` and added  as  a   single  clause  block  (see
+assertClauseBlock()) such that  the  clauses   and  their  clause
+references are contiguous in memory.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+flushPackedClauses(Definition def, tmp_buffer *packed, size_t *count ARG_LD)
+{ if ( *count > 0 )
+  { assertClauseBlock(def, baseBuffer(packed, char), sizeOfBuffer(packed),
+		      *count PASS_LD);
+    emptyBuffer(packed, 65536);
+    *count = 0;
+  }
+}
+
+static bool
+loadPredicateClauses(wic_state *state, Procedure proc, int skip, int lazy
+		     ARG_LD)
+{ IOSTREAM *fd = state->wicFd;
+  Definition def = proc->definition;
+  Clause clause;
+  SourceFile csf = NULL;
+  tmp_buffer buf;			/* reused for all clauses */
+  tmp_buffer packed;			/* clauses for assertClauseBlock() */
+  size_t npacked = 0;
+
+  initBuffer(&buf);
+  initBuffer(&packed);
+
   for(;;)
   { switch(Qgetc(fd) )
     { case 'X':
       { DEBUG(MSG_QLF_PREDICATE, Sdprintf("ok\n"));
+	flushPackedClauses(def, &packed, &npacked PASS_LD);
+	discardBuffer(&buf);
+	discardBuffer(&packed);
 	succeed;
       }
+      case 'J':
+	flushPackedClauses(def, &packed, &npacked PASS_LD);
+	loadIndexesWic(state, def, skip);
+	continue;
+      case 'L':
+	flushPackedClauses(def, &packed, &npacked PASS_LD);
+	if ( lazy || !loadLazyClausesWic(state, proc, skip PASS_LD) )
+	{ discardBuffer(&buf);
+	  discardBuffer(&packed);
+	  return qlfLoadError(state);
+	}
+	continue;
       case 'C':
       { int has_dicts = 0;
-	tmp_buffer buf;
 	vm_rlabel_state lstate;
 
 	DEBUG(MSG_QLF_PREDICATE, Sdprintf("."));
-	initBuffer(&buf);
+	emptyBuffer(&buf, 65536);
 	init_rlabels(&lstate);
 	clause = (Clause)allocFromBuffer(&buf, sizeofClause(0));
 	clause->references = 0;
@@ -1299,7 +1478,7 @@ loadPredicate(wic_state *state, int skip ARG_LD)
 
 	  clause->owner_no = ono;
 	  clause->source_no = sno;
-	  if ( of && of != csf )
+	  if ( of && of != csf && !lazy )
 	  { addProcedureSourceFile(sf, proc);
 	    csf = of;
 	  }
@@ -1382,6 +1561,10 @@ loadPredicate(wic_state *state, int skip ARG_LD)
 	    set(clause, CL_BODY_CONTEXT);
 	    set(def, P_MFCONTEXT);
 	  }
+	  if ( op == C_DETGUARD )
+	  { clause = baseBuffer(&buf, struct clause);
+	    set(clause, CL_DET_GUARD);
+	  }
 	  addCode(encode(op));
 	  DEBUG(0,
 		{ const char ca1_float[2] = {CA1_FLOAT};
@@ -1586,11 +1769,10 @@ loadPredicate(wic_state *state, int skip ARG_LD)
 	  Clause bcl    = baseBuffer(&buf, struct clause);
 
 	  bcl->code_size = ncodes;
-	  clause = (Clause)PL_malloc_atomic(csize);
-	  memcpy(clause, bcl, csize);
+	  fuseClauseCode(bcl);
 
 	  if ( has_dicts )
-	  { if ( !resortDictsInClause(clause) )
+	  { if ( !resortDictsInClause(bcl) )
 	    { outOfCore();
 	      exit(1);
 	    }
@@ -1598,14 +1780,271 @@ loadPredicate(wic_state *state, int skip ARG_LD)
 	  if ( csf )
 	    csf->current_procedure = proc;
 
-	  GD->statistics.codes += clause->code_size;
-	  assertProcedureSource(csf, proc, clause PASS_LD);
+	  GD->statistics.codes += ncodes;
+	  if ( false(def, P_DYNAMIC) && !(csf && csf->reload) )
+	  { addMultipleBuffer(&packed, bcl, csize, char);
+	    npacked++;
+	    if ( csf )
+	      csf->number_of_clauses++;
+	  } else
+	  { flushPackedClauses(def, &packed, &npacked PASS_LD);
+	    clause = (Clause)arena_alloc(csize);
+	    memcpy(clause, bcl, csize);
+	    assertProcedureSource(csf, proc, clause PASS_LD);
+	  }
 	}
+      }
+    }
+  }
+}
+
+
+		 /*******************************
+		 *	   LAZY CLAUSES		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Static predicates of a  saved  state  created  using  lazy_load(true) are
+saved as a block of bytes (see  openLazyBlockWic()).  When loading, the
+block is kept  and  the  predicate  gets  the  S_LAZY supervisor.  The
+clauses are decoded by loadLazyDefinition()  when the predicate is called
+or its clauses are examined.
+
+The block uses the XR ids of the main stream up to `base`.  We therefore
+keep the XR table of the state  alive  while there are lazy definitions
+that refer to it and decode the block   using a fresh XR table that uses
+the main table for ids up to `base`.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct lazy_clauses
+{ char	       *data;			/* Encoded clauses */
+  size_t	size;			/* Size of data */
+  unsigned int	base;			/* Last XR id of the parent */
+  XrTable	xr;			/* XR table of the saved state */
+  Procedure	proc;			/* Predicate to load */
+  int		loading;		/* A thread is loading the clauses */
+} lazy_clauses;
+
+static Table lazy_definitions = NULL;	/* Definition --> lazy_clauses */
+
+static bool
+loadLazyClauses(lazy_clauses *lc ARG_LD)
+{ wic_state state;
+  IOSTREAM s;
+  bool rc;
+
+  memset(&state, 0, sizeof(state));
+  state.wicFile = "<lazy clauses>";
+  if ( !(state.wicFd = Sopen_string(&s, lc->data, lc->size, "r")) )
+    return FALSE;
+
+  pushXrIdTable(&state);
+  state.XR->id        = lc->base;
+  state.XR->shared_id = lc->base;
+  state.XR->shared    = lc->xr;
+  rc = loadPredicateClauses(&state, lc->proc, FALSE, TRUE PASS_LD);
+  freeXrIdTable(state.XR);		/* not referenced: no need to lock */
+
+  if ( state.errors.invalid_wide_chars )
+    Sdprintf("WARNING: %d wide characters could not be represented as UCS-2\n",
+	     state.errors.invalid_wide_chars);
 
-        discardBuffer(&buf);
+  return rc;
+}
+
+
+static void
+freeLazyClauses(lazy_clauses *lc)
+{ XrTable xr = lc->xr;
+
+  if ( --xr->references == 0 && xr->popped )
+    freeXrIdTable(xr);
+  PL_free(lc->data);
+  freeHeap(lc, sizeof(*lc));
+}
+
+
+static bool
+loadLazyClausesWic(wic_state *state, Procedure proc, int skip ARG_LD)
+{ IOSTREAM *fd = state->wicFd;
+  Definition def = proc->definition;
+  unsigned int n = getUInt(fd);
+  lazy_clauses lc;
+
+  for(; n > 0; n--)
+  { SourceFile of = (void *) loadXR(state);
+    SourceFile sf = (void *) loadXR(state);
+
+    if ( !skip && of && sf )
+      addProcedureSourceFile(sf, proc);
+  }
+
+  lc.base = getUInt(fd);
+  lc.size = (size_t)getInt64(fd);
+  lc.xr   = state->XR;
+  lc.proc = proc;
+  lc.loading = FALSE;
+  lc.data = PL_malloc(lc.size);
+  if ( Sfread(lc.data, 1, lc.size, fd) != lc.size )
+  { PL_free(lc.data);
+    return FALSE;
+  }
+
+  if ( skip )
+  { PL_free(lc.data);
+    return TRUE;
+  }
+
+  PL_LOCK(L_LAZY);
+  if ( !def->impl.any.defined &&
+       def->codes == SUPERVISOR(virgin) &&
+       false(def, P_DYNAMIC|P_FOREIGN|P_MULTIFILE|P_THREAD_LOCAL|
+		  P_LOCKED_SUPERVISOR) )
+  { lazy_clauses *copy = allocHeapOrHalt(sizeof(*copy));
+
+    *copy = lc;
+    if ( !lazy_definitions )
+      lazy_definitions = newHTable(64);
+    addNewHTable(lazy_definitions, def, copy);
+    state->XR->references++;
+    set(def, P_LOCKED_SUPERVISOR);
+    def->codes = SUPERVISOR(lazy);
+    PL_UNLOCK(L_LAZY);
+
+    return TRUE;
+  } else
+  { bool rc;
+
+    PL_UNLOCK(L_LAZY);
+    rc = loadLazyClauses(&lc PASS_LD);
+    PL_free(lc.data);
+
+    return rc;
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+claimLazyClauses() returns the lazy clauses of  def,  marking  them as
+being loaded, or NULL if def is  not   lazy.  We  do not hold L_LAZY
+while decoding as adding the clauses   requires  L_PREDICATE, which may
+be held by callers of discardLazyDefinition(). If wait is TRUE, other
+threads wait until the clauses are loaded. Otherwise a predicate that is
+being loaded by another thread is handled as not lazy.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static lazy_clauses *
+claimLazyClauses(Definition def, int wait)
+{ GET_LD
+
+  for(;;)
+  { lazy_clauses *lc = NULL;
+
+    PL_LOCK(L_LAZY);
+    if ( def->codes == SUPERVISOR(lazy) )
+    { lc = lookupHTable(lazy_definitions, def);
+      assert(lc);
+      if ( !lc->loading )
+	lc->loading = TRUE;
+      else
+	lc = wait ? (void*)-1 : NULL;
+    }
+    PL_UNLOCK(L_LAZY);
+
+    if ( lc != (void*)-1 )
+      return lc;
+    Pause(0.001);
+  }
+}
+
+
+static void
+releaseLazyClauses(Definition def, lazy_clauses *lc)
+{ PL_LOCK(L_LAZY);
+  deleteHTable(lazy_definitions, def);
+  clear(def, P_LOCKED_SUPERVISOR);
+  MEMORY_BARRIER();
+  def->codes = SUPERVISOR(virgin);
+  freeLazyClauses(lc);
+  PL_UNLOCK(L_LAZY);
+}
+
+
+/** loadLazyDefinition(Definition def)
+ * Load the clauses of a predicate  that   has  the S_LAZY supervisor.
+ * This is called by S_LAZY and   by  predicates that examine or modify
+ * the clauses.  It is safe to call this if def is not (or no longer)
+ * lazy.  The caller may not hold  the   L_PREDICATE  mutex  or the
+ * mutex of def as we add the clauses using assertProcedure().
+ */
+
+int
+loadLazyDefinition(Definition def)
+{ GET_LD
+  lazy_clauses *lc;
+
+  if ( (lc = claimLazyClauses(def, TRUE)) )
+  { if ( !loadLazyClauses(lc PASS_LD) )
+      fatalError("Failed to load lazy clauses for %s", predicateName(def));
+    releaseLazyClauses(def, lc);
+  }
+
+  return TRUE;
+}
+
+
+/** discardLazyDefinition(Definition def)
+ * Discard the clauses of a lazy predicate without loading them.  Used
+ * by abolishProcedure().
+ */
+
+void
+discardLazyDefinition(Definition def)
+{ lazy_clauses *lc;
+
+  if ( (lc = claimLazyClauses(def, TRUE)) )
+    releaseLazyClauses(def, lc);
+}
+
+
+/** '$load_lazy_definitions'(-Count)
+ * Load all predicates that are still lazy, unifying Count with the number
+ * of predicates loaded by this call.  Predicates that are being loaded by
+ * another thread are skipped.  This allows for decoding the remaining
+ * lazy predicates of a saved state concurrently using multiple threads.
+ * The lazy blocks are independent: each uses its own XR table that is
+ * linked to the (read-only) XR table of the state.
+ */
+
+static
+PRED_IMPL("$load_lazy_definitions", 1, load_lazy_definitions, 0)
+{ PRED_LD
+  int64_t count = 0;
+
+  if ( lazy_definitions )
+  { TableEnum e = newTableEnum(lazy_definitions);
+    void *name;
+
+    while( advanceTableEnum(e, &name, NULL) )
+    { Definition def = name;
+      lazy_clauses *lc;
+
+      if ( (lc = claimLazyClauses(def, FALSE)) )
+      { if ( !loadLazyClauses(lc PASS_LD) )
+	  fatalError("Failed to load lazy clauses for %s", predicateName(def));
+	releaseLazyClauses(def, lc);
+	count++;
+      }
+
+      if ( PL_handle_signals() < 0 )
+      { freeTableEnum(e);
+	return FALSE;
       }
     }
+    freeTableEnum(e);
   }
+
+  return PL_unify_int64(A1, count);
 }
 
 
@@ -1650,7 +2089,7 @@ qlfFixSourcePath(wic_state *state, const char *raw)
 { char buf[MAXPATHLEN];
   char *canonical;
 
-  if ( state->load_state->has_moved &&
+  if ( state->load_state && state->load_state->has_moved &&
        strprefix(raw, state->load_state->save_dir) )
   { char *s;
     size_t lensave = strlen(state->load_state->save_dir);
@@ -1763,11 +2202,11 @@ loadModuleProperties(wic_state *state, Module m, int skip ARG_LD)
 	if ( !skip )
 	{ Procedure proc = lookupProcedure(f, LD->modules.source);
 
-	  addNewHTable(LD->modules.source->public, (void *)f, proc);
+	  addNewHTable(modulePublicTable(LD->modules.source), (void *)f, proc);
           if ( state->currentSource )
             exportProcedureSource(state->currentSource, m, proc);
 	} else
-	{ if ( !lookupHTable(m->public, (void *)f) )
+	{ if ( !m->public || !lookupHTable(m->public, (void *)f) )
 	  { FunctorDef fd = valueFunctor(f);
 
 	    warning("%s: skipped module \"%s\" lacks %s/%d",
@@ -1799,6 +2238,7 @@ loadPart(wic_state *state, Module *module, int skip ARG_LD)
   SourceFile of		= state->currentSource;
   int stchk		= debugstatus.styleCheck;
   access_level_t alevel = LD->prolog_flag.access_level;
+  double start		= GD->options.startupTrace ? WallTime() : 0.0;
 
   switch(Qgetc(fd))
   { case 'M':
@@ -1874,6 +2314,8 @@ loadPart(wic_state *state, Module *module, int skip ARG_LD)
 	  if ( state->currentSource )
 	    endConsult(state->currentSource);
         }
+	if ( start > 0.0 && state->currentSource )
+	  startupTraceAtomEvent(ATOM_qlf, state->currentSource->name, start);
 	LD->modules.source = om;
 	state->currentSource  = of;
 	debugstatus.styleCheck = stchk;
@@ -2131,7 +2573,9 @@ savedXR(wic_state *state, void *xr)
   IOSTREAM *fd = state->wicFd;
   unsigned int id;
 
-  if ( (id = (intptr_t)lookupHTable(state->savedXRTable, xr)) )
+  if ( (id = (intptr_t)lookupHTable(state->savedXRTable, xr)) ||
+       (state->lazy.table &&
+	(id = (intptr_t)lookupHTable(state->lazy.table, xr))) )
   { Sputc(XR_REF, fd);
     putUInt(id, fd);
 
@@ -2757,10 +3201,134 @@ saveWicClause(wic_state *state, Clause clause)
 		*         COMPILATION           *
 		*********************************/
 
+#define MAX_SAVED_INDEXES 16
+
+static void
+saveIndexesWic(wic_state *state, Definition def)
+{ hash_hints hints[MAX_SAVED_INDEXES];
+  int i, n;
+
+  if ( (n=getIndexHints(def, hints, MAX_SAVED_INDEXES)) > 0 )
+  { IOSTREAM *fd = state->wicFd;
+
+    Sputc('J', fd);
+    putUInt(n, fd);
+    for(i=0; i<n; i++)
+    { hash_hints *h = &hints[i];
+      int a;
+
+      for(a=0; a<MAX_MULTI_INDEX && h->args[a]; a++)
+	putUInt(h->args[a], fd);
+      putUInt(0, fd);
+      putUInt(h->ln_buckets, fd);
+      putUInt(h->list, fd);
+      putFloat(h->speedup, fd);
+    }
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Lazy blocks. If the state is saved using lazy_load(true), the clauses of
+static predicates are written to a  memory   stream  that is emitted as
+block of bytes by closeLazyBlockWic().  The  block   has  its  own  XR
+table: new XR entries go to this table and are lost after the block such
+that the block can be decoded  after  the   remainder  of  the state has
+been loaded.  Existing XR entries are  referenced   from  the main table.
+The source files of the clauses   are  emitted before swapping the table
+as they are needed to register the predicate with its files when loading
+the state.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+isLazyPredicateWic(wic_state *state, Definition def, atom_t sclass)
+{ return ( state->lazy_load &&
+	   sclass != ATOM_kernel &&
+	   def->module->class != ATOM_system &&
+	   false(def, P_DYNAMIC|P_THREAD_LOCAL|P_FOREIGN|P_MULTIFILE|
+		      P_LOCKED|P_LOCKED_SUPERVISOR) );
+}
+
+
+static void
+openLazyBlockWic(wic_state *state, Definition def ARG_LD)
+{ IOSTREAM *fd = state->wicFd;
+  ClauseRef c;
+  Clause prev = NULL;
+  unsigned int nfiles = 0;
+
+  Sputc('L', fd);
+  if ( !state->obfuscate )
+  { for(c = def->impl.clauses.first_clause; c; c = c->next)
+    { Clause cl = c->value.clause;
+
+      if ( true(cl, CL_ERASED) )
+	continue;
+      if ( !prev ||
+	   cl->owner_no != prev->owner_no || cl->source_no != prev->source_no )
+	nfiles++;
+      prev = cl;
+    }
+  }
+  putUInt(nfiles, fd);
+  if ( nfiles > 0 )
+  { prev = NULL;
+    for(c = def->impl.clauses.first_clause; c; c = c->next)
+    { Clause cl = c->value.clause;
+
+      if ( true(cl, CL_ERASED) )
+	continue;
+      if ( !prev ||
+	   cl->owner_no != prev->owner_no || cl->source_no != prev->source_no )
+      { saveXRSourceFile(state, indexToSourceFile(cl->owner_no) PASS_LD);
+	saveXRSourceFile(state, indexToSourceFile(cl->source_no) PASS_LD);
+      }
+      prev = cl;
+    }
+  }
+
+  state->lazy.fd     = fd;
+  state->lazy.table  = state->savedXRTable;
+  state->lazy.base   = state->savedXRTableId;
+  state->lazy.buffer = NULL;
+  state->lazy.size   = 0;
+  state->savedXRTable = newHTable(256);
+  state->savedXRTable->free_symbol = freeXRSymbol;
+  if ( !(state->wicFd = Sopenmem(&state->lazy.buffer, &state->lazy.size,
+				 "wb")) )
+    outOfCore();
+  state->wicFd->encoding = fd->encoding;
+}
+
+
+static void
+closeLazyBlockWic(wic_state *state)
+{ IOSTREAM *fd = state->lazy.fd;
+
+  Sclose(state->wicFd);
+  state->wicFd = fd;
+  destroyHTable(state->savedXRTable);
+  state->savedXRTable  = state->lazy.table;
+  state->savedXRTableId = state->lazy.base;
+
+  putUInt(state->lazy.base, fd);
+  putInt64(state->lazy.size, fd);
+  Sfwrite(state->lazy.buffer, 1, state->lazy.size, fd);
+  Sputc('X', fd);
+
+  Sfree(state->lazy.buffer);
+  memset(&state->lazy, 0, sizeof(state->lazy));
+}
+
+
 static void
 closePredicateWic(wic_state *state)
 { if ( state->currentPred )
-  { Sputc('X', state->wicFd);
+  { if ( state->jit_indexes )
+      saveIndexesWic(state, state->currentPred);
+    Sputc('X', state->wicFd);
+    if ( state->lazy.fd )
+      closeLazyBlockWic(state);
     state->currentPred = NULL;
   }
 }
@@ -2788,10 +3356,11 @@ predicateFlags(Definition def, atom_t sclass)
 static void
 openPredicateWic(wic_state *state, Definition def, atom_t sclass ARG_LD)
 { if ( def != state->currentPred)
-  { IOSTREAM *fd = state->wicFd;
+  { IOSTREAM *fd;
     unsigned int mode = predicateFlags(def, sclass);
 
     closePredicateWic(state);
+    fd = state->wicFd;
     state->currentPred = def;
 
     if ( def->module != LD->modules.source )
@@ -2803,6 +3372,8 @@ openPredicateWic(wic_state *state, Definition def, atom_t sclass ARG_LD)
 
     saveXRFunctor(state, def->functor->functor PASS_LD);
     putUInt(mode, fd);
+    if ( isLazyPredicateWic(state, def, sclass) )
+      openLazyBlockWic(state, def PASS_LD);
   }
 }
 
@@ -2838,9 +3409,10 @@ writeWicHeader(wic_state *state)
 
 static bool
 writeWicTrailer(wic_state *state)
-{ IOSTREAM *fd = state->wicFd;
+{ IOSTREAM *fd;
 
   closePredicateWic(state);
+  fd = state->wicFd;
   Sputc('X', fd);
   destroyXR(state);
   Sputc('T', fd);
@@ -2878,9 +3450,10 @@ addClauseWic(wic_state *state, term_t term, atom_t file ARG_LD)
 
 static bool
 addDirectiveWic(wic_state *state, term_t term ARG_LD)
-{ IOSTREAM *fd = state->wicFd;
+{ IOSTREAM *fd;
 
   closePredicateWic(state);
+  fd = state->wicFd;
   Sputc('D', fd);
   putInt64(source_line_no, fd);
 
@@ -3417,9 +3990,11 @@ qlfSaveSource(wic_state *state, SourceFile f)
 
 static bool
 qlfStartModule(wic_state *state, Module m ARG_LD)
-{ IOSTREAM *fd = state->wicFd;
+{ IOSTREAM *fd;
   ListCell c;
+
   closePredicateWic(state);
+  fd = state->wicFd;
   Sputc('Q', fd);
   Sputc('M', fd);
   saveXR(state, m->name);
@@ -3441,16 +4016,18 @@ qlfStartModule(wic_state *state, Module m ARG_LD)
   }
 
   DEBUG(MSG_QLF_SECTION, Sdprintf("MODULE %s\n", stringAtom(m->name)));
-  for_table(m->public, name, value,
-	    { functor_t f = (functor_t)name;
-
-	      DEBUG(MSG_QLF_EXPORT,
-		    Sdprintf("Exported %s/%d\n",
-			     stringAtom(nameFunctor(f)),
-			     arityFunctor(f)));
-	      Sputc('E', fd);
-	      saveXRFunctor(state, f PASS_LD);
-	    })
+  if ( m->public )
+  { for_table(m->public, name, value,
+	      { functor_t f = (functor_t)name;
+
+		DEBUG(MSG_QLF_EXPORT,
+		      Sdprintf("Exported %s/%d\n",
+			       stringAtom(nameFunctor(f)),
+			       arityFunctor(f)));
+		Sputc('E', fd);
+		saveXRFunctor(state, f PASS_LD);
+	      })
+  }
 
   Sputc('X', fd);
 
@@ -3460,9 +4037,10 @@ qlfStartModule(wic_state *state, Module m ARG_LD)
 
 static bool
 qlfStartSubModule(wic_state *state, Module m ARG_LD)
-{ IOSTREAM *fd = state->wicFd;
+{ IOSTREAM *fd;
 
   closePredicateWic(state);
+  fd = state->wicFd;
   Sputc('M', fd);
   saveXR(state, m->name);
 
@@ -3472,9 +4050,10 @@ qlfStartSubModule(wic_state *state, Module m ARG_LD)
 
 static bool
 qlfStartFile(wic_state *state, SourceFile f)
-{ IOSTREAM *fd = state->wicFd;
+{ IOSTREAM *fd;
 
   closePredicateWic(state);
+  fd = state->wicFd;
   Sputc('Q', fd);
   qlfSaveSource(state, f);
 
@@ -3484,9 +4063,10 @@ qlfStartFile(wic_state *state, SourceFile f)
 
 static bool
 qlfEndPart(wic_state *state)
-{ IOSTREAM *fd = state->wicFd;
+{ IOSTREAM *fd;
 
   closePredicateWic(state);
+  fd = state->wicFd;
   Sputc('X', fd);
 
   succeed;
@@ -3702,6 +4282,8 @@ Write a header for a QLF-stream
 
 static const opt_spec open_wic_options[] =
 { { ATOM_obfuscate,	    OPT_BOOL },
+  { ATOM_jit_indexes,	    OPT_BOOL },
+  { ATOM_lazy_load,	    OPT_BOOL },
   { NULL_ATOM,		    0 }
 };
 
@@ -3711,11 +4293,13 @@ PRED_IMPL("$open_wic", 2, open_wic, 0)
 { GET_LD
   IOSTREAM *fd;
   int obfuscate = FALSE;
+  int jit_indexes = FALSE;
+  int lazy_load = FALSE;
 
   assert(V_LABEL > I_HIGHEST);
 
   if ( !scan_options(A2, 0, ATOM_state_option, open_wic_options,
-		     &obfuscate) )
+		     &obfuscate, &jit_indexes, &lazy_load) )
     fail;
 
   if ( PL_get_stream_handle(A1, &fd) )
@@ -3723,6 +4307,8 @@ PRED_IMPL("$open_wic", 2, open_wic, 0)
 
     memset(state, 0, sizeof(*state));
     state->obfuscate = obfuscate;
+    state->jit_indexes = jit_indexes;
+    state->lazy_load = lazy_load;
     state->wicFd = fd;
     writeWicHeader(state);
     state->parent = LD->qlf.current_state;
@@ -4169,4 +4755,5 @@ BeginPredDefs(wic)
   PRED_DEF("$map_id",               2, map_id,		     0)
   PRED_DEF("$unmap_id",             1, unmap_id,             0)
   PRED_DEF("$import_wic",	    3, import_wic,	     0)
+  PRED_DEF("$load_lazy_definitions", 1, load_lazy_definitions, 0)
 EndPredDefs
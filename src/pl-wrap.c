@@ -272,7 +272,8 @@ PRED_IMPL("$c_wrap_predicate", 5, c_wrap_predicate, PL_FA_TRANSPARENT)
   term_t closure = A3;
 
   if ( !PL_get_atom_ex(A2, &wname) ||
-       !get_procedure(A1, &proc, head, GP_DEFINE) )
+       !get_procedure(A1, &proc, head, GP_DEFINE) ||
+       !loadedDefinition(proc->definition) )
     return FALSE;
 
   if ( (codes = find_wrapper(proc->definition, wname)) )
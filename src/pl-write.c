@@ -344,19 +344,39 @@ Putc(int c, IOSTREAM *s)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+PutStringN() writes ISO Latin-1 text. Runs of  printable ASCII are copied
+to the stream buffer as a block using Swrite_ascii(), which notably speeds
+up writing atoms and numbers.  Other characters use Sputcode().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 static bool
-PutString(const char *str, IOSTREAM *s)
+PutStringN(const char *str, size_t length, IOSTREAM *s)
 { const unsigned char *q = (const unsigned char *)str;
+  const unsigned char *e = q+length;
 
-  for( ; *q != EOS; q++ )
-  { if ( Sputcode(*q, s) == EOF )
-      return FALSE;
+  while( q < e )
+  { size_t n = Swrite_ascii(s, (const char*)q, e-q);
+
+    if ( n > 0 )
+    { q += n;
+    } else
+    { if ( Sputcode(*q, s) == EOF )
+	return FALSE;
+      q++;
+    }
   }
 
   return TRUE;
 }
 
 
+static bool
+PutString(const char *str, IOSTREAM *s)
+{ return PutStringN(str, strlen(str), s);
+}
+
+
 static bool
 PutComma(write_options *options)
 { if ( options->spacing == ATOM_next_argument )
@@ -375,20 +395,6 @@ PutBar(write_options *options)
 }
 
 
-static bool
-PutStringN(const char *str, size_t length, IOSTREAM *s)
-{ size_t i;
-  const unsigned char *q = (const unsigned char *)str;
-
-  for(i=0; i<length; i++, q++)
-  { if ( Sputcode(*q, s) == EOF )
-      return FALSE;
-  }
-
-  return TRUE;
-}
-
-
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 PutOpenToken() inserts a space in the  output stream if the last-written
 and given character require a space to ensure a token-break.
@@ -570,10 +576,21 @@ writeQuoted(IOSTREAM *stream, const char *text, size_t len, int quote,
 	    write_options *options)
 { const unsigned char *s = (const unsigned char *)text;
 
+  const unsigned char *e = s+len;
+
   TRY(Putc(quote, stream));
 
-  while(len-- > 0)
-  { TRY(putQuoted(*s++, quote, options->flags, stream));
+  while(s < e)
+  { const unsigned char *r;
+
+    for(r=s; r < e && *r >= ' ' && *r < 0x7f && *r != quote && *r != '\\'; r++)
+      ;
+    if ( r > s )			/* run that needs no escapes */
+    { TRY(PutStringN((const char*)s, r-s, stream));
+      s = r;
+    } else
+    { TRY(putQuoted(*s++, quote, options->flags, stream));
+    }
   }
 
   return Putc(quote, stream);
@@ -869,6 +886,8 @@ reliable read-back. Using %g gets closest,   but %.15g doesn't guarantee
 read-back and %.17g does, but prints 0.1 as 0.100..001, etc.
 
 This uses dtoa.c. See pl-dtoa.c for how this is packed into SWI-Prolog.
+The shortest digits are first  computed  using  dtoa_shortest(),  which
+avoids the bignum arithmetic and locking of dtoa() for almost all floats.
 
 TBD: The number of cases are large. We should see whether it is possible
 to clean this up a bit. The 5 cases   as  such are real: there is no way
@@ -1027,11 +1046,13 @@ char *
 format_float(double f, char *buf)
 { char *end, *o=buf, *s;
   int decpt, sign;
+  char digits[24];
 
   if ( (s=format_special_float(f, buf)) )
     return s;
 
-  s = dtoa(f, 0, 30, &decpt, &sign, &end);
+  if ( !(s = dtoa_shortest(f, digits, &decpt, &sign, &end)) )
+    s = dtoa(f, 0, 30, &decpt, &sign, &end);
   DEBUG(2, Sdprintf("decpt=%d, sign=%d, len = %d, '%s'\n",
 		    decpt, sign, end-s, s));
 
@@ -1090,7 +1111,8 @@ format_float(double f, char *buf)
     }
   }
 
-  freedtoa(s);
+  if ( s != digits )
+    freedtoa(s);
 
   return buf;
 }
@@ -1135,7 +1157,7 @@ WriteNumber(Number n, write_options *options)
   { case V_INTEGER:
     { char buf[32];
 
-      sprintf(buf, "%" PRId64, n->value.i);
+      i64toa(n->value.i, buf);
       return PutToken(buf, options->out);
     }
 #ifdef O_GMP